@@ -0,0 +1,373 @@
+// compi_bench - compile-time throughput benchmark
+// -------------------------------------------------------------
+// Purpose: Measure lexing, parsing and VHDL generation separately on
+//          synthetic (or user-supplied) inputs and report throughput
+// -------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synthetic.h"
+#include "parse.h"
+#include "parser_context.h"
+#include "codegen_vhdl.h"
+#include "output_buffer.h"
+#include "profile.h"
+#include "arena.h"
+#include "utils.h"
+
+#define DEFAULT_REPEAT 5
+#define DEFAULT_SEED 1u
+
+// Median of each phase over the repetitions
+typedef struct {
+    double lex_seconds;
+    double parse_seconds;
+    double codegen_seconds;
+    unsigned long tokens;
+    unsigned long ast_nodes;
+    size_t source_bytes;
+    size_t output_bytes;
+} BenchResult;
+
+typedef struct {
+    const char *name;
+    char *source;
+    size_t length;
+} BenchInput;
+
+static void print_usage(const char *program_name)
+{
+    printf("Usage: %s [--workload=NAME|all] [--scale=N] [--repeat=N] [--seed=N] [--json]\n", program_name);
+    printf("       %s --input=FILE [--repeat=N] [--json]\n", program_name);
+    printf("       %s --emit=FILE [--workload=NAME] [--scale=N] [--seed=N]\n", program_name);
+    printf("Workloads:");
+    for (int workload = 0; workload < SYNTH_WORKLOAD_COUNT; ++workload)
+    {
+        printf(" %s", synth_workload_name((SynthWorkload)workload));
+    }
+    printf("\n");
+}
+
+// Helper: value of "--name=value", or NULL if arg is not that option
+static const char* option_value(const char *arg, const char *name)
+{
+    size_t length = strlen(name);
+
+    if (strncmp(arg, name, length) == 0 && arg[length] == '=')
+    {
+        return arg + length + 1;
+    }
+    return NULL;
+}
+
+static int compare_seconds(const void *left, const void *right)
+{
+    double difference = *(const double*)left - *(const double*)right;
+    return (difference > 0) - (difference < 0);
+}
+
+static double median(double *samples, int count)
+{
+    qsort(samples, (size_t)count, sizeof(double), compare_seconds);
+    return samples[count / 2];
+}
+
+// -------------------------------------------------------------
+// Phases
+// -------------------------------------------------------------
+static unsigned long run_lexer(const BenchInput *input)
+{
+    ParserContext ctx;
+    unsigned long tokens = 0;
+
+    parser_context_init(&ctx);
+    ctx_lexer_begin_memory(&ctx, input->source, input->length);
+    while (ctx.current_token.type != TOKEN_EOF)
+    {
+        ctx_advance(&ctx);
+        tokens++;
+    }
+    parser_context_destroy(&ctx);
+    return tokens;
+}
+
+// Parse into ctx/arena; the caller destroys both
+static ASTNode* run_parser(const BenchInput *input, ParserContext *ctx, Arena *arena)
+{
+    parser_context_init(ctx);
+    arena_init(arena, 0);
+    ctx->arena = arena;
+    ctx->filename = input->name;
+    ctx_lexer_begin_memory(ctx, input->source, input->length);
+    return parse_program_ctx(ctx);
+}
+
+static int bench_input(const BenchInput *input, int repeat, BenchResult *result)
+{
+    double *lex_samples = (double*)calloc((size_t)repeat, sizeof(double));
+    double *parse_samples = (double*)calloc((size_t)repeat, sizeof(double));
+    double *codegen_samples = (double*)calloc((size_t)repeat, sizeof(double));
+    int succeeded = 1;
+
+    if (!lex_samples || !parse_samples || !codegen_samples)
+    {
+        perror("Failed to allocate memory for benchmark samples");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->source_bytes = input->length;
+
+    // Repetition 0 is a warm-up and is not recorded
+    for (int iteration = 0; iteration <= repeat && succeeded; ++iteration)
+    {
+        ParserContext ctx;
+        Arena arena;
+        OutputBuffer out;
+        ASTNode *program = NULL;
+        double start = 0.0;
+        double lex_seconds = 0.0;
+        double parse_seconds = 0.0;
+        double codegen_seconds = 0.0;
+
+        start = profile_now();
+        result->tokens = run_lexer(input);
+        lex_seconds = profile_now() - start;
+
+        start = profile_now();
+        program = run_parser(input, &ctx, &arena);
+        parse_seconds = profile_now() - start;
+
+        if (program == NULL || ctx.error_count > 0)
+        {
+            fprintf(stderr, "%s: input did not parse cleanly\n", input->name);
+            succeeded = 0;
+        }
+        else
+        {
+            result->ast_nodes = profile_count_nodes(program);
+
+            output_buffer_init(&out, NULL);
+            start = profile_now();
+            generate_vhdl_buffer(&ctx, program, &out);
+            codegen_seconds = profile_now() - start;
+            result->output_bytes = out.length;
+            output_buffer_free(&out);
+        }
+
+        parser_context_destroy(&ctx);
+        arena_release(&arena);
+
+        if (iteration > 0)
+        {
+            lex_samples[iteration - 1] = lex_seconds;
+            parse_samples[iteration - 1] = parse_seconds;
+            codegen_samples[iteration - 1] = codegen_seconds;
+        }
+    }
+
+    if (succeeded)
+    {
+        result->lex_seconds = median(lex_samples, repeat);
+        result->parse_seconds = median(parse_samples, repeat);
+        result->codegen_seconds = median(codegen_samples, repeat);
+    }
+
+    free(lex_samples);
+    free(parse_samples);
+    free(codegen_samples);
+    return succeeded;
+}
+
+// -------------------------------------------------------------
+// Reporting
+// -------------------------------------------------------------
+static double per_second(double amount, double seconds)
+{
+    return seconds > 0.0 ? amount / seconds : 0.0;
+}
+
+static void print_text_header(int repeat, int scale, unsigned seed)
+{
+    printf("compi_bench: median of %d runs, scale=%d seed=%u\n", repeat, scale, seed);
+    printf("%-12s %10s %10s %10s  %12s %12s %12s\n", "workload", "lex ms", "parse ms", "codegen ms",
+           "Mtokens/s", "Mnodes/s", "MB out/s");
+}
+
+static void print_text_result(const char *name, const BenchResult *result)
+{
+    printf("%-12s %10.2f %10.2f %10.2f  %12.2f %12.2f %12.2f\n", name,
+           result->lex_seconds * 1e3, result->parse_seconds * 1e3, result->codegen_seconds * 1e3,
+           per_second((double)result->tokens, result->lex_seconds) / 1e6,
+           per_second((double)result->ast_nodes, result->parse_seconds) / 1e6,
+           per_second((double)result->output_bytes, result->codegen_seconds) / 1e6);
+}
+
+static void print_json_result(const char *name, const BenchResult *result,
+                              int repeat, int scale, unsigned seed)
+{
+    printf("{\"workload\": \"%s\", \"scale\": %d, \"seed\": %u, \"repeat\": %d", name, scale, seed, repeat);
+    printf(", \"source_bytes\": %zu, \"tokens\": %lu, \"ast_nodes\": %lu, \"output_bytes\": %zu",
+           result->source_bytes, result->tokens, result->ast_nodes, result->output_bytes);
+    printf(", \"lex_ms\": %.3f, \"parse_ms\": %.3f, \"codegen_ms\": %.3f",
+           result->lex_seconds * 1e3, result->parse_seconds * 1e3, result->codegen_seconds * 1e3);
+    printf(", \"tokens_per_s\": %.0f, \"nodes_per_s\": %.0f, \"output_bytes_per_s\": %.0f}\n",
+           per_second((double)result->tokens, result->lex_seconds),
+           per_second((double)result->ast_nodes, result->parse_seconds),
+           per_second((double)result->output_bytes, result->codegen_seconds));
+}
+
+static char* read_whole_file(const char *path, size_t *length)
+{
+    FILE *file = fopen(path, "rb");
+    char *text = NULL;
+    long size = 0;
+
+    if (!file)
+    {
+        perror("Error opening benchmark input");
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+
+    text = (char*)xrealloc(NULL, (size_t)size + 1);
+    *length = fread(text, 1, (size_t)size, file);
+    text[*length] = '\0';
+    fclose(file);
+    return text;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *workload_name = "all";
+    const char *input_path = NULL;
+    const char *emit_path = NULL;
+    const char *value = NULL;
+    int scale = 1;
+    int repeat = DEFAULT_REPEAT;
+    unsigned seed = DEFAULT_SEED;
+    int json = 0;
+    int failures = 0;
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        const char *arg = argv[arg_index];
+
+        if ((value = option_value(arg, "--workload")) != NULL)
+        {
+            workload_name = value;
+        }
+        else if ((value = option_value(arg, "--scale")) != NULL)
+        {
+            scale = atoi(value);
+        }
+        else if ((value = option_value(arg, "--repeat")) != NULL)
+        {
+            repeat = atoi(value);
+        }
+        else if ((value = option_value(arg, "--seed")) != NULL)
+        {
+            seed = (unsigned)strtoul(value, NULL, 10);
+        }
+        else if ((value = option_value(arg, "--input")) != NULL)
+        {
+            input_path = value;
+        }
+        else if ((value = option_value(arg, "--emit")) != NULL)
+        {
+            emit_path = value;
+        }
+        else if (strcmp(arg, "--json") == 0)
+        {
+            json = 1;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return strcmp(arg, "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (scale < 1 || repeat < 1 ||
+        (strcmp(workload_name, "all") != 0 && synth_workload_from_name(workload_name) < 0))
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Write one generated input for inspection or for timing the compi binary
+    if (emit_path)
+    {
+        int workload = synth_workload_from_name(workload_name);
+        size_t length = 0;
+        char *source = synth_generate(workload < 0 ? SYNTH_MIXED : (SynthWorkload)workload, scale, seed, &length);
+        FILE *file = fopen(emit_path, "wb");
+
+        if (!file || fwrite(source, 1, length, file) != length || fclose(file) != 0)
+        {
+            perror("Error writing synthetic input");
+            return EXIT_FAILURE;
+        }
+        free(source);
+        return EXIT_SUCCESS;
+    }
+
+    if (!json)
+    {
+        print_text_header(repeat, scale, seed);
+    }
+
+    for (int workload = 0; workload < SYNTH_WORKLOAD_COUNT; ++workload)
+    {
+        BenchInput input;
+        BenchResult result;
+
+        if (input_path)
+        {
+            input.name = input_path;
+            input.source = read_whole_file(input_path, &input.length);
+            if (!input.source)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            if (strcmp(workload_name, "all") != 0 && synth_workload_from_name(workload_name) != workload)
+            {
+                continue;
+            }
+            input.name = synth_workload_name((SynthWorkload)workload);
+            input.source = synth_generate((SynthWorkload)workload, scale, seed, &input.length);
+        }
+
+        if (bench_input(&input, repeat, &result))
+        {
+            if (json)
+            {
+                print_json_result(input.name, &result, repeat, scale, seed);
+            }
+            else
+            {
+                print_text_result(input.name, &result);
+            }
+        }
+        else
+        {
+            failures++;
+        }
+        free(input.source);
+
+        // A user-supplied input is measured once, not once per workload
+        if (input_path)
+        {
+            break;
+        }
+    }
+
+    return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
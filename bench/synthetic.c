@@ -0,0 +1,259 @@
+// Synthetic C input generator for compi_bench
+// -------------------------------------------------------------
+// Purpose: Build large, deterministic translation units in the subset of
+//          C that compi accepts, scaled by a single multiplier
+// -------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synthetic.h"
+#include "output_buffer.h"
+
+// Per-scale sizes of each workload
+#define EXPRESSION_FUNCTIONS 48
+#define EXPRESSION_TREE_DEPTH 8
+#define EXPRESSION_CHAIN_DEPTH 48
+#define SMALL_FUNCTIONS 2000
+#define ARRAY_FUNCTIONS 24
+#define ARRAY_ELEMENTS 1024
+#define STRUCT_DECLARATIONS 400
+#define STRUCT_FIELDS 8
+
+static const char *s_workload_names[SYNTH_WORKLOAD_COUNT] = {
+    "expressions",
+    "functions",
+    "arrays",
+    "structs",
+    "mixed",
+};
+
+// '|' is left out: compi does not accept it inside parentheses yet
+static const char *s_binary_operators[] = { "+", "-", "*", "&", "^", "<<" };
+static const char *s_parameters[] = { "a", "b", "c" };
+
+#define COUNT_OF(array) (sizeof(array) / sizeof((array)[0]))
+
+// Fixed LCG so the output never depends on the C library's rand()
+typedef struct {
+    unsigned state;
+} SynthRandom;
+
+static unsigned synth_next(SynthRandom *random, unsigned bound)
+{
+    random->state = random->state * 1103515245u + 12345u;
+    return (random->state >> 16) % bound;
+}
+
+const char* synth_workload_name(SynthWorkload workload)
+{
+    if ((int)workload < 0 || workload >= SYNTH_WORKLOAD_COUNT)
+    {
+        return "unknown";
+    }
+    return s_workload_names[workload];
+}
+
+int synth_workload_from_name(const char *name)
+{
+    for (int workload = 0; workload < SYNTH_WORKLOAD_COUNT; ++workload)
+    {
+        if (strcmp(name, s_workload_names[workload]) == 0)
+        {
+            return workload;
+        }
+    }
+    return -1;
+}
+
+// -------------------------------------------------------------
+// Expression trees
+// -------------------------------------------------------------
+static void emit_leaf(OutputBuffer *out, SynthRandom *random)
+{
+    if (synth_next(random, 3) == 0)
+    {
+        out_int(out, (long)synth_next(random, 256));
+    }
+    else
+    {
+        out_puts(out, s_parameters[synth_next(random, COUNT_OF(s_parameters))]);
+    }
+}
+
+static void emit_expression_tree(OutputBuffer *out, SynthRandom *random, int depth)
+{
+    // Mostly full trees, with some early leaves so shapes vary
+    if (depth == 0 || synth_next(random, 8) == 0)
+    {
+        emit_leaf(out, random);
+        return;
+    }
+
+    out_putc(out, '(');
+    emit_expression_tree(out, random, depth - 1);
+    out_putc(out, ' ');
+    out_puts(out, s_binary_operators[synth_next(random, COUNT_OF(s_binary_operators))]);
+    out_putc(out, ' ');
+    emit_expression_tree(out, random, depth - 1);
+    out_putc(out, ')');
+}
+
+static void emit_expression_functions(OutputBuffer *out, SynthRandom *random, int count)
+{
+    for (int function_idx = 0; function_idx < count; ++function_idx)
+    {
+        out_printf(out, "int expr_%d(int a, int b, int c) {\n", function_idx);
+
+        out_puts(out, "    int wide = ");
+        emit_expression_tree(out, random, EXPRESSION_TREE_DEPTH);
+        out_puts(out, ";\n");
+
+        // Left-deep chain: ((((a + 1) + 2) ...) nested parentheses
+        out_puts(out, "    int deep = ");
+        for (int level = 0; level < EXPRESSION_CHAIN_DEPTH; ++level)
+        {
+            out_putc(out, '(');
+        }
+        out_putc(out, 'a');
+        for (int level = 0; level < EXPRESSION_CHAIN_DEPTH; ++level)
+        {
+            out_putc(out, ' ');
+            out_puts(out, s_binary_operators[synth_next(random, COUNT_OF(s_binary_operators))]);
+            out_putc(out, ' ');
+            emit_leaf(out, random);
+            out_putc(out, ')');
+        }
+        out_puts(out, ";\n");
+
+        out_puts(out, "    return wide ^ deep;\n}\n\n");
+    }
+}
+
+// -------------------------------------------------------------
+// Many small functions
+// -------------------------------------------------------------
+static void emit_small_functions(OutputBuffer *out, SynthRandom *random, int count)
+{
+    for (int function_idx = 0; function_idx < count; ++function_idx)
+    {
+        out_printf(out, "int fn_%d(int a, int b) {\n", function_idx);
+        out_puts(out, "    int acc = a;\n");
+
+        switch (synth_next(random, 3))
+        {
+            case 0:
+                out_printf(out, "    if (a > %u) {\n        acc = acc + b;\n    } else {\n        acc = acc - b;\n    }\n",
+                           synth_next(random, 100));
+                break;
+            case 1:
+                out_printf(out, "    while (acc < %u) {\n        acc = acc + 1;\n    }\n",
+                           synth_next(random, 100) + 1);
+                break;
+            default:
+                out_printf(out, "    for (int i = 0; i < %u; i++) {\n        acc = acc ^ i;\n    }\n",
+                           synth_next(random, 16) + 1);
+                break;
+        }
+
+        // Call an earlier function so calls appear in expression position
+        if (function_idx > 0)
+        {
+            out_printf(out, "    acc = acc + fn_%u(b, acc);\n", synth_next(random, (unsigned)function_idx));
+        }
+        out_puts(out, "    return acc;\n}\n\n");
+    }
+}
+
+// -------------------------------------------------------------
+// Array initializers
+// -------------------------------------------------------------
+static void emit_array_functions(OutputBuffer *out, SynthRandom *random, int count)
+{
+    for (int function_idx = 0; function_idx < count; ++function_idx)
+    {
+        out_printf(out, "int table_%d(int a) {\n", function_idx);
+        out_printf(out, "    int lut[%d] = {", ARRAY_ELEMENTS);
+        for (int element = 0; element < ARRAY_ELEMENTS; ++element)
+        {
+            if (element > 0)
+            {
+                out_puts(out, element % 16 == 0 ? ",\n        " : ", ");
+            }
+            out_int(out, (long)synth_next(random, 65536));
+        }
+        out_puts(out, "};\n");
+        out_printf(out, "    lut[%u] = a;\n", synth_next(random, ARRAY_ELEMENTS));
+        out_printf(out, "    return lut[a] + lut[%u];\n}\n\n", synth_next(random, ARRAY_ELEMENTS));
+    }
+}
+
+// -------------------------------------------------------------
+// Struct declarations
+// -------------------------------------------------------------
+static void emit_struct_units(OutputBuffer *out, SynthRandom *random, int count)
+{
+    for (int struct_idx = 0; struct_idx < count; ++struct_idx)
+    {
+        out_printf(out, "struct S%d {", struct_idx);
+        for (int field = 0; field < STRUCT_FIELDS; ++field)
+        {
+            out_printf(out, " int f%d;", field);
+        }
+        out_puts(out, " };\n");
+    }
+    out_putc(out, '\n');
+
+    for (int struct_idx = 0; struct_idx < count; ++struct_idx)
+    {
+        unsigned first = synth_next(random, STRUCT_FIELDS);
+        unsigned second = synth_next(random, STRUCT_FIELDS);
+
+        out_printf(out, "int use_s%d(int a, int b) {\n", struct_idx);
+        out_printf(out, "    struct S%d s;\n", struct_idx);
+        out_printf(out, "    s.f%u = a;\n", first);
+        out_printf(out, "    s.f%u = b + s.f%u;\n", second, first);
+        out_printf(out, "    return s.f%u + s.f%u;\n}\n\n", first, second);
+    }
+}
+
+char* synth_generate(SynthWorkload workload, int scale, unsigned seed, size_t *length)
+{
+    OutputBuffer out;
+    SynthRandom random = { seed };
+
+    if (scale < 1)
+    {
+        scale = 1;
+    }
+
+    output_buffer_init(&out, NULL);
+    out_printf(&out, "// compi_bench synthetic input: workload=%s scale=%d seed=%u\n\n",
+               synth_workload_name(workload), scale, seed);
+
+    switch (workload)
+    {
+        case SYNTH_EXPRESSIONS:
+            emit_expression_functions(&out, &random, EXPRESSION_FUNCTIONS * scale);
+            break;
+        case SYNTH_FUNCTIONS:
+            emit_small_functions(&out, &random, SMALL_FUNCTIONS * scale);
+            break;
+        case SYNTH_ARRAYS:
+            emit_array_functions(&out, &random, ARRAY_FUNCTIONS * scale);
+            break;
+        case SYNTH_STRUCTS:
+            emit_struct_units(&out, &random, STRUCT_DECLARATIONS * scale);
+            break;
+        case SYNTH_MIXED:
+        default:
+            emit_struct_units(&out, &random, STRUCT_DECLARATIONS * scale / 4);
+            emit_expression_functions(&out, &random, EXPRESSION_FUNCTIONS * scale / 4);
+            emit_small_functions(&out, &random, SMALL_FUNCTIONS * scale / 4);
+            emit_array_functions(&out, &random, ARRAY_FUNCTIONS * scale / 4);
+            break;
+    }
+
+    return output_buffer_take(&out, length);
+}
@@ -0,0 +1,34 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <stddef.h>
+
+/**
+ * Shapes of generated C input, each stressing a different part of compi
+ */
+typedef enum {
+    SYNTH_EXPRESSIONS,         // Deep, wide expression trees
+    SYNTH_FUNCTIONS,           // Thousands of small functions with control flow
+    SYNTH_ARRAYS,              // Large array initializers and indexed access
+    SYNTH_STRUCTS,             // Many struct declarations and field traffic
+    SYNTH_MIXED,               // All of the above in one translation unit
+    SYNTH_WORKLOAD_COUNT
+} SynthWorkload;
+
+const char* synth_workload_name(SynthWorkload workload);
+
+// Workload with the given name, or -1 if there is none
+int synth_workload_from_name(const char *name);
+
+/**
+ * Generate a C translation unit that compi accepts without errors.
+ * The output depends only on (workload, scale, seed), so runs are
+ * comparable between commits.
+ *
+ * @param scale  Size multiplier (1 = a few hundred KiB of source at most)
+ * @param length Receives the text length (may be NULL)
+ * @return Heap-allocated NUL-terminated source; release with free()
+ */
+char* synth_generate(SynthWorkload workload, int scale, unsigned seed, size_t *length);
+
+#endif // SYNTHETIC_H
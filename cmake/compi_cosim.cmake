@@ -0,0 +1,106 @@
+# Co-simulation of one C source (run with cmake -P, see compi_add_cosim)
+#
+#   COMPI     compi executable          SOURCE   C file to compile
+#   WORK_DIR  scratch directory         VECTORS  vectors per function
+#   GHDL      ghdl executable           CC       host C compiler
+#   OPTIONS   extra compi options, separated by "|"
+#
+# Compiles SOURCE with --testbench, runs the vector program built from the
+# same source on the host, simulates every testbench with GHDL and writes
+# cosim.txt (one line per entity: vectors, errors, latency, cycles and
+# results per cycle). Fails if any entity mismatches or does not finish;
+# a design or testbench GHDL cannot analyse or elaborate is reported as
+# such rather than as a mismatch.
+
+foreach(required COMPI SOURCE WORK_DIR VECTORS GHDL CC)
+  if(NOT DEFINED ${required})
+    message(FATAL_ERROR "compi_cosim.cmake: ${required} is not set")
+  endif()
+endforeach()
+
+string(REPLACE "|" ";" compi_options "${OPTIONS}")
+get_filename_component(stem "${SOURCE}" NAME_WE)
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+execute_process(
+  COMMAND "${COMPI}" ${compi_options} --testbench=${VECTORS} "${SOURCE}" "${WORK_DIR}/${stem}.vhdl"
+  RESULT_VARIABLE status OUTPUT_QUIET)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "compi failed on ${SOURCE}")
+endif()
+
+# Analyse the design on its own before anything is simulated: a design
+# GHDL rejects is an analysis error of the generated VHDL, not a mismatch
+foreach(unit "${stem}.vhdl" "${stem}_tb.vhdl")
+  execute_process(
+    COMMAND "${GHDL}" -a --std=08 -frelaxed "${unit}"
+    WORKING_DIRECTORY "${WORK_DIR}"
+    RESULT_VARIABLE status OUTPUT_VARIABLE output ERROR_VARIABLE output)
+  if(NOT status EQUAL 0)
+    file(WRITE "${WORK_DIR}/cosim.txt" "analysis error in ${unit}\n${output}")
+    message(FATAL_ERROR "GHDL analysis error in ${unit} (generated from ${SOURCE}):\n${output}")
+  endif()
+endforeach()
+
+# Reference results: the C source itself, compiled for the host
+execute_process(
+  COMMAND "${CC}" -std=gnu11 -fwrapv -w -o "${WORK_DIR}/${stem}_tb_vectors" "${WORK_DIR}/${stem}_tb_vectors.c"
+  RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "could not build the vector program for ${SOURCE}")
+endif()
+execute_process(
+  COMMAND "${WORK_DIR}/${stem}_tb_vectors"
+  WORKING_DIRECTORY "${WORK_DIR}"
+  RESULT_VARIABLE status OUTPUT_VARIABLE benches)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "the vector program for ${SOURCE} failed")
+endif()
+string(REGEX MATCHALL "[A-Za-z0-9_]+_tb" benches "${benches}")
+
+set(report "")
+set(failures 0)
+foreach(bench IN LISTS benches)
+  execute_process(
+    COMMAND "${GHDL}" -e --std=08 -frelaxed ${bench}
+    WORKING_DIRECTORY "${WORK_DIR}"
+    RESULT_VARIABLE status OUTPUT_VARIABLE output ERROR_VARIABLE output)
+  if(NOT status EQUAL 0)
+    string(REGEX REPLACE "\n+$" "" output "${output}")
+    string(REPLACE "\n" " " output "${output}")
+    set(line "${bench}: elaboration error (exit status ${status}) ${output}")
+    math(EXPR failures "${failures} + 1")
+    message(STATUS "cosim ${line}")
+    string(APPEND report "${line}\n")
+    continue()
+  endif()
+  execute_process(
+    COMMAND "${GHDL}" -r --std=08 -frelaxed ${bench} --assert-level=error
+    WORKING_DIRECTORY "${WORK_DIR}"
+    RESULT_VARIABLE status OUTPUT_VARIABLE output ERROR_VARIABLE output)
+  if(output MATCHES "cosim ([A-Za-z0-9_]+): vectors=([0-9]+) errors=([0-9]+) latency=([0-9]+) cycles=([0-9]+)")
+    set(line "${CMAKE_MATCH_1}: vectors=${CMAKE_MATCH_2} errors=${CMAKE_MATCH_3} latency=${CMAKE_MATCH_4} cycles=${CMAKE_MATCH_5}")
+    if(CMAKE_MATCH_5 GREATER 0)
+      # Results per cycle, to three decimals
+      math(EXPR milli "${CMAKE_MATCH_2} * 1000 / ${CMAKE_MATCH_5}")
+      math(EXPR whole "${milli} / 1000")
+      math(EXPR fraction "${milli} % 1000 + 1000")
+      string(SUBSTRING "${fraction}" 1 3 fraction)
+      string(APPEND line " throughput=${whole}.${fraction}")
+    endif()
+    if(NOT CMAKE_MATCH_3 EQUAL 0 OR NOT status EQUAL 0)
+      math(EXPR failures "${failures} + 1")
+    endif()
+  else()
+    set(line "${bench}: did not report (exit status ${status})")
+    math(EXPR failures "${failures} + 1")
+  endif()
+  message(STATUS "cosim ${line}")
+  string(APPEND report "${line}\n")
+endforeach()
+file(WRITE "${WORK_DIR}/cosim.txt" "${report}")
+
+if(failures GREATER 0)
+  message(FATAL_ERROR "${failures} testbench(es) of ${SOURCE} failed; see ${WORK_DIR}")
+endif()
@@ -0,0 +1,28 @@
+// Loops lowered by modulo scheduling (#pragma compi pipeline); each call
+// starts the loop over, so back-to-back calls must not see the counter
+// or the pipeline stages of the call before
+
+// Sum of k * i for i below n (at most 15 iterations)
+int scaled_sum(int n, int k) {
+    int m = n & 15;
+    int s = 0;
+#pragma compi pipeline
+    for (int i = 0; i < m; i++) {
+        int t = i * k;
+        s = s + t;
+    }
+    return s;
+}
+
+// The same with a while loop and II=2
+int stepped_sum(int n, int k) {
+    int m = n & 15;
+    int s = 1;
+    int i = 0;
+#pragma compi pipeline II=2
+    while (i < m) {
+        s = s + (i ^ k);
+        i = i + 1;
+    }
+    return s;
+}
@@ -0,0 +1,110 @@
+// Fuzz targets - shared timing and reporting
+// -------------------------------------------------------------
+// Purpose: Per-input time budgets and throughput statistics
+// -------------------------------------------------------------
+
+#include <stdlib.h>
+
+#include "fuzz_common.h"
+#include "profile.h"
+
+typedef struct {
+    unsigned long inputs;
+    size_t bytes;
+    double seconds;
+    double slowest_seconds;
+    size_t slowest_bytes;
+    double budget_ms;
+    double budget_us_per_byte;
+    FILE *timing_log;
+    int ready;
+} FuzzStats;
+
+static FuzzStats s_stats;
+
+static void print_summary_at_exit(void)
+{
+    fuzz_print_summary(stderr);
+}
+
+// Helper: positive number from the environment, or fallback
+static double env_number(const char *name, double fallback)
+{
+    const char *text = getenv(name);
+    char *end = NULL;
+    double value = 0.0;
+
+    if (text == NULL)
+    {
+        return fallback;
+    }
+    value = strtod(text, &end);
+    return (end != text && value > 0.0) ? value : fallback;
+}
+
+static void fuzz_setup(void)
+{
+    const char *log_path = getenv("COMPI_FUZZ_TIMING_LOG");
+
+    s_stats.budget_ms = env_number("COMPI_FUZZ_BUDGET_MS", FUZZ_BASE_BUDGET_MS);
+    s_stats.budget_us_per_byte = env_number("COMPI_FUZZ_US_PER_BYTE", FUZZ_BUDGET_US_PER_BYTE);
+    if (log_path != NULL)
+    {
+        s_stats.timing_log = fopen(log_path, "a");
+        if (s_stats.timing_log == NULL)
+        {
+            perror("Error opening fuzz timing log");
+        }
+    }
+    atexit(print_summary_at_exit);
+    s_stats.ready = 1;
+}
+
+double fuzz_input_begin(void)
+{
+    if (!s_stats.ready)
+    {
+        fuzz_setup();
+    }
+    return profile_now();
+}
+
+void fuzz_input_end(double start, size_t size)
+{
+    double seconds = profile_now() - start;
+    double budget_ms = s_stats.budget_ms + (double)size * s_stats.budget_us_per_byte / 1000.0;
+
+    s_stats.inputs++;
+    s_stats.bytes += size;
+    s_stats.seconds += seconds;
+    if (seconds > s_stats.slowest_seconds)
+    {
+        s_stats.slowest_seconds = seconds;
+        s_stats.slowest_bytes = size;
+    }
+    if (s_stats.timing_log != NULL)
+    {
+        fprintf(s_stats.timing_log, "%zu %.0f\n", size, seconds * 1e6);
+        fflush(s_stats.timing_log);
+    }
+
+    if (seconds * 1000.0 > budget_ms)
+    {
+        fprintf(stderr, "compi fuzz: slow input, %zu bytes took %.1f ms (budget %.1f ms)\n",
+                size, seconds * 1000.0, budget_ms);
+        abort();
+    }
+}
+
+void fuzz_print_summary(FILE *stream)
+{
+    if (s_stats.inputs == 0)
+    {
+        return;
+    }
+    fprintf(stream, "compi fuzz: %lu inputs, %zu bytes in %.2f ms (%.2f MB/s), "
+            "slowest %zu bytes in %.2f ms\n",
+            s_stats.inputs, s_stats.bytes, s_stats.seconds * 1000.0,
+            s_stats.seconds > 0.0 ? (double)s_stats.bytes / s_stats.seconds / 1e6 : 0.0,
+            s_stats.slowest_bytes, s_stats.slowest_seconds * 1000.0);
+}
@@ -0,0 +1,44 @@
+// Fuzz targets - shared timing and reporting
+// -------------------------------------------------------------
+// Purpose: Give every input a time budget that grows linearly with its
+//          size, so quadratic (or worse) behaviour is reported like a
+//          crash, and keep throughput statistics for the summary
+// -------------------------------------------------------------
+
+#ifndef FUZZ_COMMON_H
+#define FUZZ_COMMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Budget of one input: FUZZ_BASE_BUDGET_MS plus FUZZ_BUDGET_US_PER_BYTE
+// for each byte (override with COMPI_FUZZ_BUDGET_MS / COMPI_FUZZ_US_PER_BYTE).
+// The per-byte rate is far below the compiler's real throughput, so only
+// super-linear work exceeds it.
+#define FUZZ_BASE_BUDGET_MS 250.0
+#define FUZZ_BUDGET_US_PER_BYTE 20.0
+
+/**
+ * Entry point of a fuzz target, called by libFuzzer or the replay driver
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/**
+ * Start timing one input
+ */
+double fuzz_input_begin(void);
+
+/**
+ * Record the input's execution time (appended to COMPI_FUZZ_TIMING_LOG as
+ * "bytes microseconds" when that is set) and abort() if it exceeded its
+ * budget, so the fuzzer keeps the input as a reproducer
+ */
+void fuzz_input_end(double start, size_t size);
+
+/**
+ * Print inputs run, bytes, throughput and the slowest input
+ */
+void fuzz_print_summary(FILE *stream);
+
+#endif // FUZZ_COMMON_H
@@ -0,0 +1,90 @@
+// compi_fuzz_compile - whole-pipeline fuzz target
+// -------------------------------------------------------------
+// Purpose: Parse arbitrary bytes from memory, then run the default
+//          optimization passes and VHDL generation into a memory buffer
+//          on every input that parses
+// -------------------------------------------------------------
+
+#include <pthread.h>
+
+#include "fuzz_common.h"
+#include "parse.h"
+#include "parser_context.h"
+#include "optimize.h"
+#include "codegen_vhdl.h"
+#include "output_buffer.h"
+#include "arena.h"
+
+typedef struct {
+    ParserContext *ctx;
+    ASTNode *program;
+} FuzzBackEnd;
+
+static void* run_back_end(void *argument)
+{
+    FuzzBackEnd *back_end = (FuzzBackEnd*)argument;
+    OptimizeOptions optimize;
+    OutputBuffer out;
+
+    optimize_options_default(&optimize);
+    optimize_program(back_end->program, &optimize);
+    output_buffer_init(&out, NULL);
+    generate_vhdl_buffer(back_end->ctx, back_end->program, &out);
+    output_buffer_free(&out);
+    return NULL;
+}
+
+// Helper: deep trees get a thread with the stack compile_unit would give
+// them, so the target does not report overflows the compiler avoids
+static void run_with_stack(FuzzBackEnd *back_end)
+{
+    size_t stack_size = ast_stack_size(back_end->program);
+    pthread_attr_t attributes;
+    pthread_t worker;
+    int started = 0;
+
+    if (stack_size > 0 && pthread_attr_init(&attributes) == 0)
+    {
+        started = pthread_attr_setstacksize(&attributes, stack_size) == 0 &&
+                  pthread_create(&worker, &attributes, run_back_end, back_end) == 0;
+        pthread_attr_destroy(&attributes);
+    }
+    if (started)
+    {
+        pthread_join(worker, NULL);
+    }
+    else
+    {
+        run_back_end(back_end);
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    ParserContext ctx;
+    Arena arena;
+    CodegenOptions codegen;
+    FuzzBackEnd back_end;
+    double start = fuzz_input_begin();
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    codegen_options_default(&codegen);
+    ctx.arena = &arena;
+    ctx.filename = "fuzz.c";
+    ctx.codegen = &codegen;
+    ctx.diagnostics.buffered = 1;
+    ctx_lexer_begin_memory(&ctx, (const char*)data, size);
+
+    back_end.ctx = &ctx;
+    back_end.program = parse_program_ctx(&ctx);
+    if (back_end.program != NULL)
+    {
+        run_with_stack(&back_end);
+    }
+
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+    fuzz_input_end(start, size);
+    return 0;
+}
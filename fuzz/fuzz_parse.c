@@ -0,0 +1,32 @@
+// compi_fuzz_parse - parser fuzz target
+// -------------------------------------------------------------
+// Purpose: Lex and parse arbitrary bytes from memory with a private
+//          ParserContext; syntax errors are expected, crashes and
+//          super-linear parse times are not
+// -------------------------------------------------------------
+
+#include "fuzz_common.h"
+#include "parse.h"
+#include "parser_context.h"
+#include "arena.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    ParserContext ctx;
+    Arena arena;
+    double start = fuzz_input_begin();
+
+    // Diagnostics stay buffered and are dropped with the context
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx.filename = "fuzz.c";
+    ctx.diagnostics.buffered = 1;
+    ctx_lexer_begin_memory(&ctx, (const char*)data, size);
+    parse_program_ctx(&ctx);
+
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+    fuzz_input_end(start, size);
+    return 0;
+}
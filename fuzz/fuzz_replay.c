@@ -0,0 +1,121 @@
+// Fuzz targets - replay driver
+// -------------------------------------------------------------
+// Purpose: main() for builds without libFuzzer: run files, and every
+//          regular file in directories, through LLVMFuzzerTestOneInput
+//          once each (corpus regression runs, reproducing a crash)
+// -------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "fuzz_common.h"
+#include "utils.h"
+
+// Helper: whole file in an allocated buffer; NULL if it cannot be read
+static uint8_t* read_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t *data = NULL;
+    long length = 0;
+
+    if (file == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        data = (uint8_t*)xrealloc(NULL, length > 0 ? (size_t)length : 1);
+        *size = fread(data, 1, (size_t)length, file);
+    }
+    else
+    {
+        perror(path);
+    }
+    fclose(file);
+    return data;
+}
+
+static int replay_file(const char *path, int verbose)
+{
+    size_t size = 0;
+    uint8_t *data = read_file(path, &size);
+
+    if (data == NULL)
+    {
+        return 0;
+    }
+    if (verbose)
+    {
+        fprintf(stderr, "%s (%zu bytes)\n", path, size);
+    }
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return 1;
+}
+
+static int replay_path(const char *path, int verbose)
+{
+    struct stat info;
+    DIR *directory = NULL;
+    struct dirent *entry = NULL;
+    int replayed = 1;
+
+    if (stat(path, &info) != 0)
+    {
+        perror(path);
+        return 0;
+    }
+    if (!S_ISDIR(info.st_mode))
+    {
+        return replay_file(path, verbose);
+    }
+
+    directory = opendir(path);
+    if (directory == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+    while ((entry = readdir(directory)) != NULL)
+    {
+        size_t length = strlen(path) + strlen(entry->d_name) + 2;
+        char *child = (char*)xrealloc(NULL, length);
+
+        snprintf(child, length, "%s/%s", path, entry->d_name);
+        if (stat(child, &info) == 0 && S_ISREG(info.st_mode))
+        {
+            replayed &= replay_file(child, verbose);
+        }
+        free(child);
+    }
+    closedir(directory);
+    return replayed;
+}
+
+int main(int argc, char **argv)
+{
+    int verbose = 0;
+    int replayed = 1;
+    int path_count = 0;
+
+    for (int arg_index = 1; arg_index < argc; ++arg_index)
+    {
+        if (strcmp(argv[arg_index], "-v") == 0)
+        {
+            verbose = 1;
+            continue;
+        }
+        replayed &= replay_path(argv[arg_index], verbose);
+        path_count++;
+    }
+    if (path_count == 0)
+    {
+        fprintf(stderr, "Usage: %s [-v] <file|directory> ...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    return replayed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
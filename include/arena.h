@@ -0,0 +1,47 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Default size of each arena block; larger requests get a dedicated block
+#define ARENA_DEFAULT_BLOCK_SIZE (256 * 1024)
+
+typedef struct ArenaBlock ArenaBlock;
+
+/**
+ * Bump allocator owning every allocation made for one compilation.
+ *
+ * Allocation is a pointer bump inside the current block; individual
+ * allocations are never freed. arena_release() returns all blocks at once.
+ */
+typedef struct {
+    ArenaBlock *head;          // Current block (most recently allocated)
+    size_t block_size;         // Size used for new blocks
+    size_t bytes_allocated;    // Bytes handed out (including alignment padding)
+    size_t bytes_reserved;     // Bytes obtained from malloc for blocks
+} Arena;
+
+/**
+ * Initialise an empty arena
+ *
+ * @param arena      Arena to initialise
+ * @param block_size Block size in bytes (0 selects ARENA_DEFAULT_BLOCK_SIZE)
+ */
+void arena_init(Arena *arena, size_t block_size);
+
+/**
+ * Allocate size bytes aligned for any object type (never returns NULL)
+ */
+void* arena_alloc(Arena *arena, size_t size);
+
+/**
+ * Copy a NUL-terminated string into the arena
+ */
+char* arena_strdup(Arena *arena, const char *text);
+
+/**
+ * Release every block owned by the arena and reset it to empty
+ */
+void arena_release(Arena *arena);
+
+#endif // ARENA_H
@@ -0,0 +1,125 @@
+#ifndef AST_IMAGE_H
+#define AST_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "astnode.h"
+#include "arena.h"
+#include "output_buffer.h"
+#include "symbol_structs.h"
+
+/**
+ * Binary image of a parsed translation unit: the AST plus its struct table,
+ * for later pipeline stages and external tools to use without parsing again.
+ *
+ * The image is position independent (every link is an index) and is read
+ * in place, so a memory-mapped file needs no decoding. All integers are
+ * 32-bit in the byte order of the writer; every section starts on a 4-byte
+ * boundary at the offset recorded in the header:
+ *
+ *   AstImageHeader
+ *   AstImageNode[node_count]      breadth-first, node 0 is the program; the
+ *                                 children of a node are consecutive nodes
+ *   AstImageString[string_count]  each a NUL-terminated run of text
+ *   AstImageStruct[struct_count]  in declaration order
+ *   AstImageField[field_count]    each struct's fields consecutive
+ *   char text[text_size]
+ */
+
+#define AST_IMAGE_MAGIC "compiAST"
+#define AST_IMAGE_MAGIC_SIZE 8
+#define AST_IMAGE_VERSION 1
+#define AST_IMAGE_BYTE_ORDER 0x01020304u   // Reads back swapped on a foreign host
+#define AST_IMAGE_NONE UINT32_MAX          // No string (NULL value)
+
+typedef struct {
+    char magic[AST_IMAGE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t node_count;
+    uint32_t node_offset;
+    uint32_t string_count;
+    uint32_t string_offset;
+    uint32_t struct_count;
+    uint32_t struct_offset;
+    uint32_t field_count;
+    uint32_t field_offset;
+    uint32_t text_size;
+    uint32_t text_offset;
+} AstImageHeader;
+
+typedef struct {
+    uint8_t type;              // NodeType
+    uint8_t token_type;        // TokenType
+    uint16_t reserved;
+    uint32_t token_line;
+    uint32_t token_offset;     // Position in the original source
+    uint32_t token_length;
+    uint32_t token_text;       // String index of the lexeme
+    uint32_t value;            // String index, or AST_IMAGE_NONE
+    int32_t array_size;
+    uint32_t first_child;      // Node index of the first child (0 = none)
+    uint32_t child_count;
+} AstImageNode;
+
+typedef struct {
+    uint32_t offset;           // Into the text section
+    uint32_t length;           // Bytes before the NUL
+} AstImageString;
+
+typedef struct {
+    uint32_t name;             // String index
+    uint32_t first_field;      // Index into the field section
+    uint32_t field_count;
+} AstImageStruct;
+
+typedef struct {
+    uint32_t name;             // String indices
+    uint32_t type;
+} AstImageField;
+
+/**
+ * Validated view of an image held in memory (typically a mapped file)
+ */
+typedef struct {
+    const AstImageHeader *header;
+    const AstImageNode *nodes;
+    const AstImageString *strings;
+    const AstImageStruct *structs;
+    const AstImageField *fields;
+    const char *text;
+} AstImage;
+
+/**
+ * Cheap check for the magic at the start of data (the rest is not validated)
+ */
+int ast_image_recognize(const void *data, size_t length);
+
+/**
+ * Point image into data after checking the header, every section bound
+ * and every index, so the accessors and ast_image_load need no checks.
+ * data must be 4-byte aligned and outlive the view.
+ *
+ * @return 1 if data holds a well-formed image of this version, 0 otherwise
+ */
+int ast_image_open(AstImage *image, const void *data, size_t length);
+
+// Text of a string index (NULL for AST_IMAGE_NONE)
+const char* ast_image_string(const AstImage *image, uint32_t string_index);
+
+/**
+ * Append the image of program and structs to out. Equal strings are
+ * stored once.
+ */
+void ast_image_write(const ASTNode *program, const StructTable *structs, OutputBuffer *out);
+
+/**
+ * Rebuild the tree of an open image in arena: the nodes and the child
+ * vectors are one allocation each and the text one copy, so the image can
+ * be released afterwards. The struct table is refilled from the image.
+ *
+ * @return The program node
+ */
+ASTNode* ast_image_load(const AstImage *image, Arena *arena, StructTable *structs);
+
+#endif // AST_IMAGE_H
@@ -2,6 +2,7 @@
 #define ASTNODE_H
 
 #include "token.h"
+#include "arena.h"
 
 // AST Node Types
 typedef enum {
@@ -15,7 +16,7 @@ typedef enum {
     NODE_LITERAL,
     NODE_IDENTIFIER,
     NODE_ASSIGNMENT,
-    NODE_BINARY_OP,
+    NODE_UNARY_EXPR,           // value = operator ("!", "~", "-"), one operand child
     NODE_IF_STATEMENT,
     NODE_ELSE_IF_STATEMENT,
     NODE_ELSE_STATEMENT,
@@ -23,19 +24,24 @@ typedef enum {
     NODE_FOR_STATEMENT,
     NODE_BREAK_STATEMENT,
     NODE_CONTINUE_STATEMENT,
-    NODE_FUNC_CALL
+    NODE_FUNC_CALL,
+    NODE_INDEX_EXPR,           // children: array, index expression
+    NODE_MEMBER_EXPR           // value = field name, child: struct expression
 } NodeType;
 
 
-// AST Node structure
+// AST Node structure. Fields are ordered so the node packs into one
+// 64-byte cache line with no padding (checked in astnode.c).
 typedef struct ASTNode {
     NodeType type;
     Token token;               // Original token (if applicable)
+    int array_size;            // Element count of an array NODE_VAR_DECL (0 = scalar)
     char *value;               // Value or additional info
     struct ASTNode *parent;    // Parent node
     struct ASTNode **children; // Child nodes
     int num_children;          // Number of children
     int capacity;              // Capacity of children array
+    Arena *arena;              // Owning arena (NULL when heap-allocated)
 } ASTNode;
 
 
@@ -44,4 +50,61 @@ ASTNode* create_node(NodeType type);
 void free_node(ASTNode* node);
 void add_child(ASTNode* parent, ASTNode* child);
 
+/**
+ * Copy text into storage owned by the node (its arena, or the heap) and make
+ * it the node's value, replacing any previous value
+ */
+void set_node_value(ASTNode *node, const char *text);
+
+/**
+ * Make the interned operator op the node's operator: token.id carries the id
+ * that code generation switches on, value its text
+ */
+void set_node_operator(ASTNode *node, InternId op);
+
+/**
+ * Arguments of the pragma `name` attached to a NODE_STATEMENT by
+ * "#pragma [compi] name args" lines before it, or NULL if there is none.
+ * The arguments run to the next '\n' or the end of the string ("" = none).
+ */
+const char* find_node_pragma(const ASTNode *node, const char *name);
+
+// Limitation: only expression parsing, free_node, print_ast and the
+// profiling walks are iterative. Nested statements are still parsed
+// recursively on the caller's stack, and the optimizer and code generator
+// still recurse once per level of tree depth. For deep trees compile_unit runs them on a thread
+// whose stack is sized from ast_stack_size(), so their depth is bounded by
+// what the system lets one thread reserve. If that thread cannot be
+// created, they run on the caller's stack and a deep enough tree still
+// overflows it. AST_STACK_BYTES_PER_LEVEL is an estimate of their deepest
+// frames, not a measured bound.
+//
+// Call stack the recursive passes use per level of tree depth, and what a
+// default thread stack is trusted to hold
+#define AST_STACK_BYTES_PER_LEVEL 1024
+#define AST_DEFAULT_STACK_BYTES (4 * 1024 * 1024)
+
+/**
+ * Number of nodes on the longest root-to-leaf path (0 for NULL), measured
+ * without recursion
+ */
+int ast_depth(const ASTNode *root);
+
+/**
+ * Thread stack size the recursive passes need to walk root: 0 if the
+ * default stack suffices, otherwise a size for pthread_attr_setstacksize
+ */
+size_t ast_stack_size(const ASTNode *root);
+
+/**
+ * Select the arena used by create_node() on the calling thread.
+ *
+ * While an arena is active, nodes, child vectors and node values are carved
+ * out of it and free_node() on them is a no-op; the whole tree is released
+ * with arena_release(). Passing NULL restores per-node heap allocation.
+ *
+ * @return The previously active arena
+ */
+Arena* ast_use_arena(Arena *arena);
+
 #endif // ASTNODE_H
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "profile.h"
+#include "optimize.h"
+#include "codegen_vhdl.h"
+#include "symbol_table.h"
+#include "error_handler.h"
+
+// Format of the --time-report output
+typedef enum {
+    TIME_REPORT_OFF,
+    TIME_REPORT_TEXT,
+    TIME_REPORT_JSON
+} TimeReportFormat;
+
+/**
+ * Options shared by every translation unit of one compi run
+ */
+typedef struct {
+    int verbose;               // Print per-phase progress messages
+    int skip_teardown;         // Leave AST/context memory to process exit
+    TimeReportFormat time_report; // Per-unit timers/counters (batch_run prints them)
+    TimeReportFormat estimate; // Per-entity area/depth estimate (same formats, printed by compile_unit)
+    OptimizeOptions optimize;  // AST passes run between parsing and codegen
+    CodegenOptions codegen;    // Shape of the generated hardware
+    int split_units;           // One design file per function (see compile_unit)
+    int codegen_jobs;          // Threads generating split units (0 = batch_default_jobs())
+    int max_errors;            // Syntax errors reported per unit (0 = PARSER_DEFAULT_MAX_ERRORS)
+    DiagnosticFormat diagnostics; // How each unit's buffered diagnostics are written
+    int testbench_vectors;     // Vectors per testbench written next to the output (0 = none)
+    int stream;                // Generate and release each function as soon as it is parsed
+} CompileOptions;
+
+/**
+ * Compile one C file into one VHDL file with its own ParserContext and arena.
+ * Safe to call from several threads at once.
+ *
+ * With split_units each function goes to "<stem>.<function>.vhd" next to
+ * output_path, and output_path holds "package <stem>_types" with the
+ * struct records (used by every entity file) and the list of entity files.
+ * With testbench_vectors the testbenches and their vector program go to
+ * "<stem>_tb.vhdl" and "<stem>_tb_vectors.c" next to output_path.
+ * With stream the unit goes through compile_stream() (VHDL output only).
+ *
+ * @param error_count Receives the number of errors reported (may be NULL)
+ * @param profile     Receives phase timings and counters (may be NULL)
+ * @return 1 on success, 0 if the file could not be opened, parsed or written
+ */
+int compile_unit(const char *input_path, const char *output_path,
+                 const CompileOptions *options, int *error_count,
+                 CompileProfile *profile);
+
+/**
+ * Print one unit's --time-report to stderr in the requested format
+ */
+void print_time_report(const CompileProfile *profile, const char *input_path,
+                       TimeReportFormat format);
+
+/**
+ * One input of a batch run and its outcome
+ */
+typedef struct {
+    char *input_path;
+    char *output_path;
+    int succeeded;
+    int error_count;
+    CompileProfile profile;   // Filled when CompileOptions.time_report is set
+} BatchJob;
+
+typedef struct {
+    BatchJob *jobs;
+    int count;
+    int capacity;
+    SymbolTable outputs;       // Interned output path -> job index
+} BatchList;
+
+void batch_init(BatchList *batch);
+void batch_free(BatchList *batch);
+
+/**
+ * Queue input_path for compilation. When output_path is NULL the output is
+ * named after the input (".c" replaced by ".vhdl"), placed in out_dir when
+ * given, otherwise next to the input.
+ *
+ * @return 1 on success, 0 (after reporting both inputs) if another queued
+ *         input already writes the same output path
+ */
+int batch_add(BatchList *batch, const char *input_path,
+              const char *output_path, const char *out_dir);
+
+/**
+ * Queue every entry of a manifest file: one "input.c [output.vhdl]" per
+ * line; blank lines and lines starting with '#' are ignored.
+ *
+ * @return 1 on success, 0 if the manifest could not be read or two of its
+ *         entries (or an earlier input) share an output path
+ */
+int batch_load_manifest(BatchList *batch, const char *manifest_path,
+                        const char *out_dir);
+
+/**
+ * Create the directory path and any missing parents (--out-dir)
+ *
+ * @return 1 on success or if it exists, 0 after reporting the error
+ */
+int batch_make_directory(const char *path);
+
+/**
+ * Number of worker threads used when none is requested (online CPUs)
+ */
+int batch_default_jobs(void);
+
+/**
+ * Compile every queued job on a pool of worker_count threads (0 selects
+ * batch_default_jobs()) and print one status line per input, in order,
+ * followed by the time reports when options->time_report is set.
+ *
+ * @return Number of inputs that failed
+ */
+int batch_run(BatchList *batch, int worker_count, const CompileOptions *options);
+
+#endif // BATCH_H
@@ -3,8 +3,168 @@
 
 #include <stdio.h>
 #include "astnode.h"
+#include "parser_context.h"
+#include "output_buffer.h"
+
+// Constant-trip for loops up to this many iterations are unrolled fully
+#define DEFAULT_UNROLL_LIMIT 16
+
+// Local arrays of at least this many elements go to block RAM (with --fsm)
+#define DEFAULT_BRAM_THRESHOLD 1024
+
+/**
+ * Choices that shape the generated hardware. Read by the generators through
+ * the active ParserContext (ctx->codegen); NULL there means all defaults.
+ */
+// How the clocked process of a function resets its control registers
+typedef enum {
+    RESET_ASYNC,               // First branch of the process, outside the clock edge
+    RESET_SYNC,                // Inside the clock edge, after the body
+    RESET_NONE                 // No reset logic; control registers get power-up values
+} ResetStyle;
+
+typedef struct CodegenOptions {
+    int pipeline_stages;       // Register stages per function (0 = unpipelined, no valid ports)
+    int share_limit;           // Max exclusive operations bound to one unit (< 2 = no sharing)
+    int share_adders;          // Also share + and - (by default only *, / and %)
+    int unroll_limit;          // Unroll constant-trip loops of at most this many iterations (0 = only on #pragma unroll)
+    int fsm;                   // Lower functions with while/break/continue to a start/done state machine
+    int bram_threshold;        // State machine arrays of at least this many elements use block RAM (0 = never)
+    int narrow_widths;         // Shrink int locals to the bits their value range needs
+    int fixed_integer_bits;    // --fixed-point=Qm.n: float/double as m integer bits (0 = off)
+    int fixed_fraction_bits;   // ... and n fraction bits
+    int combinational;         // Emit pure straight-line functions without clock or registers
+    int strength_reduce;       // Lower * / % by constants to shifts, shift-adds and reciprocal multiplies
+    int eliminate_common;      // Compute repeated subexpressions once on a shared signal
+    ResetStyle reset;          // Reset of the control registers (data registers are never reset)
+    const char *cache_dir;     // Reuse the text of unchanged functions from this directory (NULL = off)
+} CodegenOptions;
+// New fields that change the generated text also belong in the cache key
+// (cache_mix_options in codegen_vhdl_cache.c)
+
+// Defaults: one clocked process per function, no handshake ports, no sharing,
+// small constant-trip loops unrolled
+void codegen_options_default(CodegenOptions *options);
+
+/**
+ * Parse a fixed-point format, "Qm.n" or "m.n": m integer bits (sign
+ * included, at least 1) and n fraction bits, at most 64 bits in all
+ *
+ * @return 1 if well-formed, 0 otherwise
+ */
+int codegen_parse_fixed_point(const char *text, int *integer_bits, int *fraction_bits);
 
 // Generate VHDL code from an AST root node
 void generate_vhdl(ASTNode* node, FILE* output);
 
+/**
+ * Generate VHDL for a tree parsed with ctx (struct layouts and diagnostics
+ * come from ctx). Safe to call concurrently with distinct contexts.
+ * Output is buffered and written to the stream in large chunks.
+ *
+ * @return 1 on success, 0 if writing to output failed
+ */
+int generate_vhdl_ctx(ParserContext *ctx, ASTNode *node, FILE *output);
+
+/**
+ * Generate VHDL for a tree parsed with ctx into out. With an in-memory
+ * buffer (no sink) the complete output is left in out; streaming buffers
+ * are not flushed, so the caller decides when the final chunk is written.
+ */
+void generate_vhdl_buffer(ParserContext *ctx, ASTNode *node, OutputBuffer *out);
+
+/**
+ * Streaming generation: emit_vhdl_header(), then for each function
+ * generate_vhdl_structs() with the structs registered since the last call
+ * followed by generate_vhdl_function(). When every struct precedes the
+ * functions this is the text generate_vhdl_buffer() writes for the program.
+ * The function must be a child of its program node, like the functions it
+ * calls.
+ */
+void generate_vhdl_function(ParserContext *ctx, ASTNode *function, OutputBuffer *out);
+
+/**
+ * Records of the structs of ctx registered from index first on
+ *
+ * @return Number of structs registered (the next call's first)
+ */
+int generate_vhdl_structs(ParserContext *ctx, int first, OutputBuffer *out);
+
+// Library and use clauses every generated design file starts with
+void emit_vhdl_header(OutputBuffer *out);
+
+/**
+ * The entity and architecture of one function, generated on its own
+ */
+typedef struct {
+    const char *name;          // Function (and entity) name
+    OutputBuffer text;         // In memory, without the library clauses
+    int cache_hit;             // 1 spliced from cache_dir, 0 generated and stored, -1 no cache
+} CodegenUnit;
+
+/**
+ * Generate every function of a program parsed with ctx into its own unit,
+ * on up to worker_count threads. Functions connected by calls are
+ * generated by the same thread, so the text matches generate_vhdl_ctx.
+ *
+ * @param units Receives the units in source order (free with codegen_units_free)
+ * @return Number of units
+ */
+int generate_vhdl_units(ParserContext *ctx, ASTNode *root, int worker_count, CodegenUnit **units);
+
+void codegen_units_free(CodegenUnit *units, int count);
+
+/**
+ * Append "package <package_name>" holding the record types of every struct
+ * ctx declares, for split entities to use
+ *
+ * @return Number of structs (0: nothing was written)
+ */
+int generate_vhdl_package(ParserContext *ctx, const char *package_name, OutputBuffer *out);
+
+/**
+ * First-order area and timing estimate of one generated entity
+ */
+typedef struct {
+    const char *name;          // Function (and entity) name
+    long luts;                 // 6-input LUTs
+    long registers;            // Flip-flops
+    long dsps;                 // 25x18 DSP multipliers
+    long brams;                // 36 Kb block RAMs
+    int depth;                 // Longest path between registers, in operator levels
+    long instances;            // Entities it instantiates (calls the inliner kept)
+} CodegenEstimate;
+
+/**
+ * Estimate every function of a program parsed with ctx under the options in
+ * ctx->codegen, from operator widths and the lowering each function gets.
+ * Nothing is generated.
+ *
+ * @param estimates Receives one entry per function in source order (free())
+ * @return Number of entries
+ */
+int estimate_vhdl(ParserContext *ctx, ASTNode *root, CodegenEstimate **estimates);
+
+// Report with one row per entity and a total row
+void estimate_print_text(const CodegenEstimate *estimates, int count, const char *filename, OutputBuffer *out);
+
+// Report as a single JSON object (no trailing newline)
+void estimate_print_json(const CodegenEstimate *estimates, int count, const char *filename, OutputBuffer *out);
+
+// Vectors per testbench when --testbench gives no count
+#define TESTBENCH_DEFAULT_VECTORS 64
+
+/**
+ * Self-checking testbenches for a program parsed with ctx: one "<name>_tb"
+ * entity per function whose ports are integers of at most 32 bits (others get
+ * a comment), and a C program that includes source_path and writes the
+ * "<name>.vec" files they read. The testbenches report latency and cycle
+ * counts. Uses the options in ctx->codegen, like generate_vhdl_buffer.
+ *
+ * @param vector_count Vectors per function
+ * @return Number of testbenches
+ */
+int generate_testbench(ParserContext *ctx, ASTNode *root, const char *source_path, int vector_count,
+                       OutputBuffer *vhdl, OutputBuffer *vectors);
+
 #endif // CODEGEN_VHDL_H
@@ -0,0 +1,35 @@
+#ifndef COMPILE_STREAM_H
+#define COMPILE_STREAM_H
+
+#include <stddef.h>
+#include "parser_context.h"
+#include "optimize.h"
+#include "output_buffer.h"
+
+/**
+ * What a streaming compilation kept in memory
+ */
+typedef struct {
+    int function_count;        // Functions generated
+    int retained_count;        // Functions kept after generation because another one calls them
+    unsigned long node_count;  // AST nodes of every function generated
+    size_t peak_ast_bytes;     // Most arena memory held by the AST at any one time
+} CompileStreamStats;
+
+/**
+ * Compile the source loaded into ctx (ctx_lexer_begin) one function at a
+ * time: each function is optimised and generated into out as soon as it
+ * is parsed, then released. Functions that some function body calls stay
+ * in memory for their callers (inlining, instances), and a function that
+ * calls one defined further down waits for it, so the output matches
+ * whole-program compilation apart from that order and memory is bounded
+ * by the largest function plus the called ones. ctx->arena is required.
+ *
+ * @param stats Receives counters (may be NULL)
+ * @return 1 on success, 0 on syntax errors (out then holds the functions
+ *         generated before the first error)
+ */
+int compile_stream(ParserContext *ctx, const OptimizeOptions *optimize, OutputBuffer *out,
+                   CompileStreamStats *stats);
+
+#endif // COMPILE_STREAM_H
@@ -1,6 +1,8 @@
 #ifndef ERROR_HANDLER_H
 #define ERROR_HANDLER_H
 
+#include <stdio.h>
+#include "output_buffer.h"
 
 // Error severity levels
 typedef enum {
@@ -30,6 +32,57 @@ typedef struct {
     const char* source_line; // The actual source line text (NULL if not available)
 } ErrorLocation;
 
+// Output format of diagnostics
+typedef enum {
+    DIAGNOSTIC_FORMAT_TEXT,  // Human-readable, coloured when enabled
+    DIAGNOSTIC_FORMAT_JSON   // One JSON object per diagnostic and line
+} DiagnosticFormat;
+
+// Offset into DiagnosticList.text for a missing string
+#define DIAGNOSTIC_NO_TEXT ((size_t)-1)
+
+/**
+ * One reported message. Strings are offsets into the list's text pool.
+ */
+typedef struct {
+    ErrorSeverity severity;
+    ErrorCategory category;
+    size_t code;
+    size_t filename;
+    size_t source_line;
+    size_t message;
+    int line;
+    int column;
+    int first_note;          // Hints and suggestions: notes[first_note ..
+    int note_count;          // first_note + note_count)
+} DiagnosticRecord;
+
+// A hint (add_error_hint) or suggestion (add_suggestion) of a record
+typedef struct {
+    int is_suggestion;
+    size_t text;
+} DiagnosticNote;
+
+/**
+ * Diagnostics of one translation unit, kept in report order.
+ *
+ * Each ParserContext owns one, so units compiled on different threads
+ * never share a buffer. While buffered is 0 every message is written to
+ * stderr as it is reported; otherwise messages are only recorded, and
+ * diagnostics_flush() writes them in one locked write. A zero-initialised
+ * list is empty and unbuffered.
+ */
+typedef struct {
+    DiagnosticRecord *records;
+    int count;
+    int capacity;
+    DiagnosticNote *notes;
+    int note_count;
+    int note_capacity;
+    OutputBuffer text;       // NUL-terminated strings the records point into
+    int buffered;
+} DiagnosticList;
+
 /**
  * Report a message with specified severity level and enhanced location info
  * 
@@ -87,14 +140,14 @@ void log_warning(ErrorCategory category, int line, const char* format, ...);
 void log_error(ErrorCategory category, int line, const char* format, ...);
 
 /**
- * Get the current error count
+ * Get the error count of the calling thread's current ParserContext
  * 
  * @return Number of errors reported
  */
 int get_error_count(void);
 
 /**
- * Get the current warning count
+ * Get the warning count of the calling thread's current ParserContext
  * 
  * @return Number of warnings reported
  */
@@ -112,6 +165,17 @@ void reset_error_counters(void);
  */
 int has_errors(void);
 
+/**
+ * Write the diagnostics of a list to stream in order, as one locked write,
+ * and empty the list (it stays buffered)
+ */
+void diagnostics_flush(DiagnosticList *list, FILE *stream, DiagnosticFormat format);
+
+/**
+ * Release the storage of a list
+ */
+void diagnostics_free(DiagnosticList *list);
+
 /**
  * Enable or disable colored output
  * 
@@ -0,0 +1,116 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Interned string handle; 0 is reserved for "no string" and maps to ""
+typedef uint32_t InternId;
+
+#define INTERN_NONE ((InternId)0)
+
+// Strings interned ahead of everything else, so their ids are compile-time
+// constants: keyword, type and operator checks become integer compares, and
+// the lexer hands out operator and punctuation ids without an intern lookup.
+// Keywords must stay contiguous (KW_IF .. KW_VOID).
+#define INTERN_PREDEFINED(X) \
+    X(KW_IF, "if")                \
+    X(KW_ELSE, "else")            \
+    X(KW_WHILE, "while")          \
+    X(KW_FOR, "for")              \
+    X(KW_RETURN, "return")        \
+    X(KW_BREAK, "break")          \
+    X(KW_CONTINUE, "continue")    \
+    X(KW_STRUCT, "struct")        \
+    X(KW_INT, "int")              \
+    X(KW_FLOAT, "float")          \
+    X(KW_CHAR, "char")            \
+    X(KW_DOUBLE, "double")        \
+    X(KW_VOID, "void")            \
+    X(OP_ASSIGN, "=")             \
+    X(OP_PLUS, "+")               \
+    X(OP_MINUS, "-")              \
+    X(OP_MULTIPLY, "*")           \
+    X(OP_DIVIDE, "/")             \
+    X(OP_MODULO, "%")             \
+    X(OP_LESS, "<")               \
+    X(OP_GREATER, ">")            \
+    X(OP_LESS_EQUAL, "<=")        \
+    X(OP_GREATER_EQUAL, ">=")     \
+    X(OP_EQUAL, "==")             \
+    X(OP_NOT_EQUAL, "!=")         \
+    X(OP_SHIFT_LEFT, "<<")        \
+    X(OP_SHIFT_RIGHT, ">>")       \
+    X(OP_BITWISE_AND, "&")        \
+    X(OP_BITWISE_OR, "|")         \
+    X(OP_BITWISE_XOR, "^")        \
+    X(OP_LOGICAL_AND, "&&")       \
+    X(OP_LOGICAL_OR, "||")        \
+    X(OP_LOGICAL_NOT, "!")        \
+    X(OP_BITWISE_NOT, "~")        \
+    X(OP_DOT, ".")                \
+    X(OP_INCREMENT, "++")         \
+    X(OP_DECREMENT, "--")         \
+    X(PUNCT_SEMICOLON, ";")       \
+    X(PUNCT_PAREN_OPEN, "(")      \
+    X(PUNCT_PAREN_CLOSE, ")")     \
+    X(PUNCT_BRACE_OPEN, "{")      \
+    X(PUNCT_BRACE_CLOSE, "}")     \
+    X(PUNCT_BRACKET_OPEN, "[")    \
+    X(PUNCT_BRACKET_CLOSE, "]")   \
+    X(PUNCT_COMMA, ",")
+
+#define INTERN_ENUM_ENTRY(name, text) INTERN_##name,
+enum {
+    INTERN_PREDEFINED_BASE = INTERN_NONE,
+    INTERN_PREDEFINED(INTERN_ENUM_ENTRY)
+    INTERN_PREDEFINED_END
+};
+#undef INTERN_ENUM_ENTRY
+
+#define INTERN_PREDEFINED_COUNT (INTERN_PREDEFINED_END - 1)
+
+// True if the id is one of the C keywords recognised by the lexer
+#define intern_is_keyword(id) ((id) >= INTERN_KW_IF && (id) <= INTERN_KW_VOID)
+
+/**
+ * Intern a byte range and return its id.
+ *
+ * Equal byte sequences always yield the same id, so comparing ids (or the
+ * canonical pointers from intern_text) replaces strcmp. The text does not
+ * need to be NUL-terminated; the stored copy is.
+ *
+ * @param text   First byte of the string
+ * @param length Number of bytes
+ * @return       Id of the canonical copy (never INTERN_NONE)
+ */
+InternId intern_string(const char *text, size_t length);
+
+/**
+ * Intern a NUL-terminated string (NULL interns as INTERN_NONE)
+ */
+InternId intern_cstr(const char *text);
+
+/**
+ * Look up a string without inserting it
+ *
+ * @return Id if the string was interned before, INTERN_NONE otherwise
+ */
+InternId intern_find(const char *text, size_t length);
+
+/**
+ * Canonical NUL-terminated text for an id; INTERN_NONE yields ""
+ */
+const char* intern_text(InternId id);
+
+/**
+ * Byte length of an interned string
+ */
+size_t intern_length(InternId id);
+
+/**
+ * Number of distinct strings interned so far
+ */
+size_t intern_count(void);
+
+#endif // INTERN_H
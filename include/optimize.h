@@ -0,0 +1,147 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include <stdint.h>
+#include "astnode.h"
+#include "symbol_table.h"
+
+// Calls to functions of at most this many expression nodes are inlined
+#define DEFAULT_INLINE_LIMIT 16
+
+/**
+ * AST passes run between parse_program_ctx() and generate_vhdl_ctx().
+ * Each pass rewrites the tree in place; nodes keep their owning arena, so
+ * trees parsed with ctx->arena stay releasable in one step.
+ */
+typedef struct {
+    int fold_constants;        // Fold literals, simplify identities, propagate constants
+    int eliminate_dead_code;   // Drop unreachable code, constant branches and unused locals
+    int inline_calls;          // Substitute calls to small straight-line functions
+    int inline_limit;          // Largest inlined body (expression nodes) without a pragma
+    int balance_expressions;   // Regroup chains of associative operators into balanced trees
+} OptimizeOptions;
+
+// Every pass enabled
+void optimize_options_default(OptimizeOptions *options);
+
+// Every pass disabled (--no-optimize)
+void optimize_options_none(OptimizeOptions *options);
+
+/**
+ * Run the enabled passes over a NODE_PROGRAM tree, repeating them while
+ * one pass still exposes work for another
+ *
+ * @return Number of rewrites made
+ */
+int optimize_program(ASTNode *program, const OptimizeOptions *options);
+
+/**
+ * Run the enabled passes over one function of program, which is rewritten
+ * alone; calls in it still resolve against every function of program
+ * (streaming compilation optimises each function as it is parsed)
+ *
+ * @return Number of rewrites made
+ */
+int optimize_function(ASTNode *program, ASTNode *function, const OptimizeOptions *options);
+
+/**
+ * Replace calls to functions whose body is a straight sequence of scalar
+ * declarations and assignments ending in a return by that return value,
+ * with the arguments substituted for the parameters. "#pragma compi inline"
+ * on the first statement of a function always inlines it, "inline off"
+ * never does; otherwise the substituted value may have at most limit nodes.
+ * Calls made as statements, recursive calls, boolean results and arguments
+ * with calls that would be dropped or duplicated are kept.
+ *
+ * @return Number of calls inlined
+ */
+int inline_calls(ASTNode *program, int limit);
+
+/**
+ * Fold literal subexpressions (C int semantics, 32-bit wrap-around),
+ * simplify x*1, x+0, x-0, x^0, x|0, x<<0, x>>0 (and x*0, x&0 when x has no
+ * calls), and substitute scalar int variables whose declaration initializer
+ * is a literal and which are never assigned. Identities and (x + c1) + c2
+ * regrouping only apply when x is an int or char, so double operands keep
+ * their literals. Repeats until nothing changes.
+ *
+ * @return Number of rewrites made
+ */
+int fold_constants(ASTNode *program);
+
+/**
+ * Fold one subtree built after the passes ran (a loop body copy with the
+ * index substituted, say) by the literal and identity rules of
+ * fold_constants(), typing names by the declarations in function. No
+ * constant propagation.
+ *
+ * @return The node that now stands in place of node
+ */
+ASTNode* fold_subtree(const ASTNode *function, ASTNode *node);
+
+/**
+ * Remove statements after a return, break or continue in the same block,
+ * resolve if/else-if/while/for whose condition is an int literal, and drop
+ * local variables that are never read together with every write to them
+ * (writes whose right-hand side calls a function are kept, and so is the
+ * declaration of the local they write).
+ *
+ * @return Number of rewrites made
+ */
+int eliminate_dead_code(ASTNode *program);
+
+/**
+ * Regroup chains of one associative operator (+ * & | ^ && ||) into
+ * balanced trees, so an n-term chain is ceil(log2(n)) operators deep
+ * instead of n - 1. Operands keep their left-to-right order. + and * chains
+ * are only regrouped when every operand is an int, char or intN_t/uintN_t
+ * of at most 32 bits, whose arithmetic wraps at 32 bits for any grouping.
+ *
+ * @return Number of chains regrouped
+ */
+int balance_expressions(ASTNode *program);
+
+// The passes restricted to the function `only` of program (NULL = every function)
+int inline_calls_function(ASTNode *program, ASTNode *only, int limit);
+int fold_constants_function(ASTNode *program, ASTNode *only);
+int eliminate_dead_code_function(ASTNode *program, ASTNode *only);
+int balance_expressions_function(ASTNode *program, ASTNode *only);
+
+// Helpers shared by the passes
+
+// 1 and the value if node is a decimal int literal that fits in 32 bits
+int optimize_int_literal(const ASTNode *node, int32_t *value);
+
+// 1 if the subtree can be dropped without losing a function call
+int optimize_is_pure(const ASTNode *node);
+
+// 1 if node yields a VHDL boolean rather than a vector in codegen
+int optimize_is_boolean_valued(const ASTNode *node);
+
+// 1 if node is the NODE_STATEMENT built by parse_return_statement
+int optimize_is_return_statement(const ASTNode *node);
+
+/**
+ * Names whose value wraps at 32 bits like the C int literals are folded in:
+ * int, char and intN_t/uintN_t of at most 32 bits. Float, double, wider
+ * types and structs do not wrap there.
+ */
+typedef struct {
+    SymbolTable functions;     // Function name -> 1 if its result wraps at 32 bits
+    SymbolTable locals;        // Parameter/local name -> 1 if it wraps at 32 bits
+} OptimizeWrapScope;
+
+// Bind the functions of program (NULL or not a NODE_PROGRAM: none)
+void optimize_wrap_scope_init(OptimizeWrapScope *scope, const ASTNode *program);
+
+// Replace the locals by the parameters and locals of function
+void optimize_wrap_scope_enter(OptimizeWrapScope *scope, const ASTNode *function);
+
+void optimize_wrap_scope_free(OptimizeWrapScope *scope);
+
+// 1 if node's value wraps at 32 bits, given whether its first child and
+// every child do
+int optimize_wraps_at_int(const OptimizeWrapScope *scope, const ASTNode *node, int first_wraps,
+                          int children_wrap);
+
+#endif // OPTIMIZE_H
@@ -0,0 +1,76 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Initial capacity of an output buffer
+#define OUTPUT_BUFFER_INITIAL_CAPACITY (64 * 1024)
+
+// A streaming buffer drains to its sink once it holds this many bytes
+#define OUTPUT_BUFFER_FLUSH_THRESHOLD (1024 * 1024)
+
+/**
+ * Growable append-only text buffer every code generator writes through.
+ *
+ * With a sink the buffer streams: it is written out in large chunks
+ * whenever OUTPUT_BUFFER_FLUSH_THRESHOLD bytes accumulate, and by
+ * output_buffer_flush(). Without a sink the whole output stays in memory
+ * and can be read with output_buffer_data() or taken over with
+ * output_buffer_take().
+ */
+typedef struct {
+    char *data;                // Pending bytes, always NUL-terminated
+    size_t length;             // Bytes pending in data
+    size_t capacity;           // Allocated size of data (excluding the NUL)
+    FILE *sink;                // Stream drained into (NULL = in memory)
+    size_t bytes_written;      // Bytes already drained to sink
+    int write_failed;          // Set once a write to sink fails
+} OutputBuffer;
+
+/**
+ * Initialise an empty buffer
+ *
+ * @param buffer Buffer to initialise
+ * @param sink   Stream to drain into, or NULL to keep the output in memory
+ */
+void output_buffer_init(OutputBuffer *buffer, FILE *sink);
+
+/**
+ * Write pending bytes to the sink (no-op for in-memory buffers)
+ *
+ * @return 1 on success, 0 if any write to the sink has failed
+ */
+int output_buffer_flush(OutputBuffer *buffer);
+
+/**
+ * Pending output as a NUL-terminated string (the whole output when the
+ * buffer has no sink). Valid until the next append.
+ */
+const char* output_buffer_data(const OutputBuffer *buffer);
+
+/**
+ * Hand the pending output to the caller (free() it) and reset the buffer
+ *
+ * @param length Receives the string length (may be NULL)
+ */
+char* output_buffer_take(OutputBuffer *buffer, size_t *length);
+
+/**
+ * Release the storage; pending bytes are discarded, so flush first
+ */
+void output_buffer_free(OutputBuffer *buffer);
+
+// Append primitives used by the code generators
+void out_write(OutputBuffer *out, const char *text, size_t length);
+void out_puts(OutputBuffer *out, const char *text);
+void out_putc(OutputBuffer *out, char character);
+void out_int(OutputBuffer *out, long value);
+
+#if defined(__GNUC__) || defined(__clang__)
+void out_printf(OutputBuffer *out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+#else
+void out_printf(OutputBuffer *out, const char *format, ...);
+#endif
+
+#endif // OUTPUT_BUFFER_H
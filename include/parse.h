@@ -2,12 +2,41 @@
 #define PARSE_H
 
 #include "astnode.h"
+#include "parser_context.h"
 
 // Parsing interface (monolithic for now; will be split further)
 
 // Forward declarations still needed locally
 ASTNode* parse_program(FILE *input);
 
+/**
+ * Parse the source loaded into ctx (ctx_lexer_begin / ctx_lexer_begin_memory).
+ * Uses only the context's state, so independent contexts may be parsed on
+ * different threads at once. Fatal errors are counted in ctx->error_count
+ * and make this return NULL instead of exiting; nodes built before the
+ * error are only reclaimed when ctx->arena is set.
+ */
+ASTNode* parse_program_ctx(ParserContext *ctx);
+
+/**
+ * Receives one top-level declaration (function or struct) of
+ * parse_program_stream. It was built in arena, which the sink now owns
+ * (arena_release() and free() it, or keep it while the nodes are needed).
+ */
+typedef void (*DeclarationSink)(void *data, ASTNode *program, ASTNode *declaration, Arena *arena);
+
+/**
+ * Parse like parse_program_ctx, but build each top-level declaration in an
+ * arena of its own and hand it to sink as soon as it is complete instead
+ * of adding it to the program, so the whole tree never exists at once.
+ * ctx->arena is required and holds the program node. After a syntax error
+ * the remaining declarations are still checked but not handed on.
+ *
+ * @return The program node (children are whatever sink added), or NULL
+ *         on syntax errors
+ */
+ASTNode* parse_program_stream(ParserContext *ctx, DeclarationSink sink, void *data);
+
 // Other parsing entry points are in their own headers now
 #include "parse_struct.h"
 #include "parse_function.h"
@@ -3,10 +3,14 @@
 
 #include <stdio.h>
 #include "astnode.h"
+#include "parser_context.h"
 
-ASTNode* parse_primary(FILE *input);
-ASTNode* parse_expression_prec(FILE *input, int min_prec);
-ASTNode* parse_expression(FILE *input);
-ASTNode* parse_function_call_args(FILE *input, const char *function_name);
+ASTNode* parse_primary(ParserContext *ctx);
+ASTNode* parse_expression_prec(ParserContext *ctx, int min_prec);
+ASTNode* parse_expression(ParserContext *ctx);
+ASTNode* parse_function_call_args(ParserContext *ctx, const char *function_name);
+
+// Field accesses / array indexes after an already-consumed identifier
+ASTNode* parse_postfix_access(ParserContext *ctx, Token identifier_token);
 
 #endif // PARSE_EXPRESSION_H
@@ -3,8 +3,9 @@
 
 #include <stdio.h>
 #include "astnode.h"
+#include "parser_context.h"
 #include "token.h"
 
-ASTNode* parse_function(FILE *input, Token return_type, Token func_name);
+ASTNode* parse_function(ParserContext *ctx, Token return_type, Token func_name);
 
 #endif // PARSE_FUNCTION_H
@@ -3,7 +3,15 @@
 
 #include <stdio.h>
 #include "astnode.h"
+#include "parser_context.h"
 
-ASTNode* parse_statement(FILE *input);
+ASTNode* parse_statement(ParserContext *ctx);
+
+/**
+ * parse_statement() behind a recovery point: after a syntax error the rest
+ * of the statement is skipped and NULL returned, so the enclosing block
+ * goes on with the next statement.
+ */
+ASTNode* parse_statement_with_recovery(ParserContext *ctx);
 
 #endif // PARSE_STATEMENT_H
@@ -3,9 +3,10 @@
 
 #include <stdio.h>
 #include "astnode.h"
+#include "parser_context.h"
 #include "token.h"
 
 // Parse struct definition: struct Name { ... };
-ASTNode* parse_struct(FILE *input, Token struct_name_tok);
+ASTNode* parse_struct(ParserContext *ctx, Token struct_name_tok);
 
 #endif // PARSE_STRUCT_H
@@ -0,0 +1,152 @@
+#ifndef PARSER_CONTEXT_H
+#define PARSER_CONTEXT_H
+
+#include <stdio.h>
+#include <setjmp.h>
+#include "token.h"
+#include "arena.h"
+#include "symbol_table.h"
+#include "symbol_structs.h"
+#include "error_handler.h"
+
+// Pending operator of the iterative expression parser (parse_expression.c)
+typedef struct {
+    int kind;                  // Open parenthesis, prefix or binary operator
+    Token token;               // Operator or '(' token
+    int precedence;            // Binary operators only
+} ExprOperator;
+
+// Syntax errors reported per unit before parsing gives up (--max-errors)
+#define PARSER_DEFAULT_MAX_ERRORS 20
+
+/**
+ * Complete state of one compilation: lexer position, current token,
+ * symbol tables, loop nesting and diagnostics counters.
+ *
+ * Separate contexts share nothing mutable (the string interner is
+ * internally locked), so each thread can compile its own translation unit.
+ * A zero-initialised context is not valid; use parser_context_init().
+ */
+struct ParserContext {
+    // Lexer
+    SourceBuffer source;       // Text being scanned
+    FILE *bound_input;         // Stream the source was loaded from (legacy API)
+    int source_exhausted;      // EOF token already returned
+    Token current_token;
+    int current_line;
+
+    // Parser
+    int loop_depth;            // Nesting of while/for (for break/continue)
+    SymbolTable arrays;        // Array name -> size, scoped
+    StructTable structs;       // Struct declarations of this unit
+    Arena *arena;              // AST allocation arena (NULL = heap)
+    struct ASTNode **expr_operands; // Expression parser work stacks; a nested
+    int expr_operand_count;    // expression (index, call argument) works
+    int expr_operand_capacity; // above the entries of its parent
+    ExprOperator *expr_operators;
+    int expr_operator_count;
+    int expr_operator_capacity;
+
+    // Diagnostics
+    const char *filename;      // Reported in diagnostics (may be NULL)
+    DiagnosticList diagnostics; // Messages reported while this context is current
+    int error_count;
+    int warning_count;
+    int max_errors;            // Syntax errors before parsing stops (0 = no limit)
+    long last_error_offset;    // Token of the last syntax error (-1 = none)
+    jmp_buf *recover_target;   // Innermost recovery point (NULL = abort)
+    jmp_buf *abort_target;     // Where fatal errors unwind to (NULL = exit)
+
+    // Code generation
+    const struct CodegenOptions *codegen; // VHDL generation options (NULL = defaults)
+
+    // Instrumentation
+    struct CompileProfile *profile; // Timers and counters (NULL = not profiled)
+};
+
+void parser_context_init(ParserContext *ctx);
+
+/**
+ * Release the source buffer, symbol tables and diagnostics (an attached
+ * arena is owned by the caller and left alone)
+ */
+void parser_context_destroy(ParserContext *ctx);
+
+/**
+ * Context used by the calling thread's convenience API (advance(),
+ * find_struct_index(), log_error(), ...): the one activated with
+ * parser_context_activate(), or the process-wide default context.
+ */
+ParserContext* parser_context_current(void);
+
+/**
+ * Make ctx the calling thread's current context (NULL restores the default)
+ *
+ * @return The previously active context (NULL if it was the default)
+ */
+ParserContext* parser_context_activate(ParserContext *ctx);
+
+// Process-wide context behind the legacy FILE* / global-token API
+ParserContext* parser_context_default(void);
+
+/**
+ * Abandon the compilation after a fatal error has been reported.
+ * Unwinds to ctx->abort_target when set, otherwise exits the process.
+ */
+void parser_fatal(ParserContext *ctx);
+
+/**
+ * Report a syntax error at the current token and unwind to the innermost
+ * recovery point, which skips to the next statement or declaration so the
+ * rest of the unit is still checked. An error at the same token as the
+ * previous one is a cascade of it and is not reported. Once max_errors
+ * errors have been reported parsing stops as after parser_fatal().
+ */
+#if defined(__GNUC__) || defined(__clang__)
+void parser_syntax_error(ParserContext *ctx, const char *format, ...) __attribute__((format(printf, 2, 3)));
+#else
+void parser_syntax_error(ParserContext *ctx, const char *format, ...);
+#endif
+
+/**
+ * Parser state saved by a recovery point. Usage:
+ *
+ *     ParserRecovery recovery;
+ *     parser_recovery_push(ctx, &recovery);
+ *     if (setjmp(recovery.target) == 0) {
+ *         ... parse ...
+ *     } else {
+ *         parser_recovery_restore(ctx, &recovery);
+ *         ... skip to a synchronizing token ...
+ *     }
+ *     parser_recovery_pop(ctx, &recovery);
+ */
+typedef struct {
+    jmp_buf target;
+    jmp_buf *outer;            // Enclosing recovery point
+    uint32_t start_offset;     // First token of the construct being parsed
+    int loop_depth;
+    int scope_depth;           // Of ctx->arrays
+    int expr_operand_count;
+    int expr_operator_count;
+} ParserRecovery;
+
+void parser_recovery_push(ParserContext *ctx, ParserRecovery *recovery);
+
+// Undo the scopes, loops and expression stack entries left open by the error
+void parser_recovery_restore(ParserContext *ctx, const ParserRecovery *recovery);
+
+void parser_recovery_pop(ParserContext *ctx, const ParserRecovery *recovery);
+
+// Lexer operations on an explicit context
+int ctx_lexer_begin(ParserContext *ctx, FILE *input);
+void ctx_lexer_begin_memory(ParserContext *ctx, const char *data, size_t length);
+void ctx_lexer_end(ParserContext *ctx);
+void ctx_advance(ParserContext *ctx);
+int ctx_match(const ParserContext *ctx, TokenType type);
+int ctx_consume(ParserContext *ctx, TokenType type);
+LexerMark ctx_lexer_mark(const ParserContext *ctx);
+void ctx_lexer_reset_to(ParserContext *ctx, const LexerMark *mark);
+int ctx_token_column(const ParserContext *ctx, Token token);
+
+#endif // PARSER_CONTEXT_H
@@ -0,0 +1,81 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "astnode.h"
+
+/**
+ * Compilation phases timed by --time-report. PROFILE_PHASE_SYMBOLS is
+ * nested inside PROFILE_PHASE_PARSE (symbol-table work done while parsing).
+ */
+typedef enum {
+    PROFILE_PHASE_LOAD,        // Reading/mapping the source file
+    PROFILE_PHASE_PARSE,       // Lexing and parsing into the AST
+    PROFILE_PHASE_SYMBOLS,     // Array/struct table registration and lookup
+    PROFILE_PHASE_OPTIMIZE,    // AST optimisation passes
+    PROFILE_PHASE_CODEGEN,     // VHDL emission including buffered writes
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+/**
+ * Timers and counters for one translation unit
+ */
+typedef struct CompileProfile {
+    double phase_seconds[PROFILE_PHASE_COUNT];
+    double total_seconds;
+    unsigned long token_count;         // Tokens scanned (re-scans after backtracking included)
+    unsigned long ast_node_count;
+    unsigned long symbol_operations;   // Symbol-table calls made by the parser
+    size_t source_bytes;
+    size_t ast_bytes;                  // Arena bytes reserved for the AST
+    size_t output_bytes;               // VHDL bytes written
+    unsigned long cache_hits;          // Functions spliced from --cache-dir
+    unsigned long cache_misses;        // Functions generated and stored there
+    long peak_memory_kb;               // Process peak RSS when the unit finished
+} CompileProfile;
+
+// Instrumentation hooks. They read ctx->profile (NULL = not profiled) and
+// expand to nothing unless the build defines COMPI_PROFILING.
+#ifdef COMPI_PROFILING
+#define PROFILE_TIMER_START(ctx, timer) \
+    double timer = (ctx)->profile ? profile_now() : 0.0
+#define PROFILE_TIMER_STOP(ctx, timer, phase) \
+    do { \
+        if ((ctx)->profile) { \
+            (ctx)->profile->phase_seconds[phase] += profile_now() - (timer); \
+        } \
+    } while (0)
+#define PROFILE_COUNT(ctx, counter, amount) \
+    do { \
+        if ((ctx)->profile) { \
+            (ctx)->profile->counter += (amount); \
+        } \
+    } while (0)
+#else
+#define PROFILE_TIMER_START(ctx, timer) ((void)0)
+#define PROFILE_TIMER_STOP(ctx, timer, phase) ((void)0)
+#define PROFILE_COUNT(ctx, counter, amount) ((void)0)
+#endif
+
+// 1 when the instrumentation hooks were compiled in
+int profile_available(void);
+
+void profile_reset(CompileProfile *profile);
+
+// Monotonic wall-clock time in seconds
+double profile_now(void);
+
+// Number of nodes in the tree rooted at node
+unsigned long profile_count_nodes(const ASTNode *node);
+
+// Peak resident set size of the process in KiB (0 if unknown)
+long profile_peak_memory_kb(void);
+
+// Human-readable report for one unit
+void profile_print_text(const CompileProfile *profile, const char *filename, FILE *out);
+
+// Report for one unit as a single JSON object (no trailing newline)
+void profile_print_json(const CompileProfile *profile, const char *filename, FILE *out);
+
+#endif // PROFILE_H
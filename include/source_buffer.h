@@ -0,0 +1,58 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Ownership of the bytes referenced by a SourceBuffer
+typedef enum {
+    SOURCE_STORAGE_NONE,     // Borrowed memory (caller keeps it alive)
+    SOURCE_STORAGE_HEAP,     // Read into a heap block, released with free()
+    SOURCE_STORAGE_MAPPED    // Memory-mapped file, released with munmap()
+} SourceStorage;
+
+/**
+ * Whole-file view of the source text scanned by the lexer.
+ *
+ * The lexer walks the bytes with pointer arithmetic instead of pulling
+ * characters through stdio. Token offsets index into `data`, so the buffer
+ * must stay alive for as long as tokens referring to it are in use.
+ * `data` is not guaranteed to be NUL-terminated; always bound by `length`.
+ */
+typedef struct {
+    const char *data;        // First byte of the source text
+    size_t length;           // Number of valid bytes in data
+    size_t pos;              // Scan cursor (byte offset of next unread char)
+    SourceStorage storage;   // How data must be released
+    size_t mapped_length;    // Length passed to mmap (SOURCE_STORAGE_MAPPED)
+} SourceBuffer;
+
+/**
+ * Load the remaining contents of a stream into a buffer.
+ *
+ * Regular files are memory-mapped when the platform supports it; other
+ * streams (pipes, terminals) are read in large blocks. The stream is left
+ * positioned at end-of-file.
+ *
+ * @param buffer Buffer to initialise
+ * @param input  Stream positioned at the first byte to scan
+ * @return 1 on success, 0 on I/O or allocation failure (buffer is empty)
+ */
+int source_buffer_from_file(SourceBuffer *buffer, FILE *input);
+
+/**
+ * Wrap caller-owned memory; nothing is copied and nothing is freed.
+ */
+void source_buffer_from_memory(SourceBuffer *buffer, const char *data, size_t length);
+
+/**
+ * 1-based column of a byte offset (0 if the offset is outside the buffer)
+ */
+int source_column(const SourceBuffer *buffer, size_t offset);
+
+/**
+ * Release the storage owned by a buffer and reset it to empty.
+ */
+void source_buffer_release(SourceBuffer *buffer);
+
+#endif // SOURCE_BUFFER_H
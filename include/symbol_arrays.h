@@ -1,16 +1,23 @@
 #ifndef SYMBOL_ARRAYS_H
 #define SYMBOL_ARRAYS_H
 
-// Simple per-function array table info (used for static bounds checking)
-typedef struct {
-    char name[64];
-    int size; // number of elements
-} ArrayInfo;
+#include "symbol_table.h"
 
-extern ArrayInfo g_arrays[128];
-extern int g_array_count;
+// Array sizes used for static bounds checking, scoped per function and block
 
+// Table operations (array name -> element count)
+void array_table_register(SymbolTable *arrays, const char *name, int size);
+int array_table_size(const SymbolTable *arrays, const char *name);
+
+// Convenience wrappers on the array table of the current ParserContext
 void register_array(const char *name, int size);
 int find_array_size(const char *name);
 
+// Open / close a function or block scope for array declarations
+void array_scope_push(void);
+void array_scope_pop(void);
+
+// Forget every registered array (start of a new translation unit)
+void reset_array_symbols(void);
+
 #endif // SYMBOL_ARRAYS_H
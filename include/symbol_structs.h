@@ -1,19 +1,56 @@
 #ifndef SYMBOL_STRUCTS_H
 #define SYMBOL_STRUCTS_H
 
+#include "intern.h"
+#include "symbol_table.h"
+
+// One struct member; names point at interned text
+typedef struct {
+    const char *field_name;
+    const char *field_type;
+} StructField;
+
 // Struct metadata description
 typedef struct {
-    char name[64];
-    struct { char field_name[64]; char field_type[32]; } fields[32];
+    const char *name;          // Interned struct name
+    StructField *fields;       // Fields in declaration order
     int field_count;
+    int field_capacity;
+    SymbolTable field_lookup;  // Field name -> index into fields
 } StructInfo;
 
-// Global struct table (simple flat array for now)
-extern StructInfo g_structs[64];
-extern int g_struct_count;
+/**
+ * Struct declarations of one translation unit: a dense array in declaration
+ * order plus a hashed name index. A zero-initialised table is empty.
+ */
+typedef struct {
+    StructInfo *items;
+    int count;
+    int capacity;
+    SymbolTable index;         // Struct name -> index into items
+} StructTable;
+
+// Table operations
+int struct_table_register(StructTable *table, const char *name);
+void struct_table_add_field(StructTable *table, int struct_index,
+                            const char *field_name, const char *field_type);
+int struct_table_find(const StructTable *table, InternId name);
+const StructInfo* struct_table_at(const StructTable *table, int struct_index);
+const char* struct_table_field_type(const StructTable *table, InternId struct_name,
+                                    InternId field_name);
+void struct_table_reset(StructTable *table);
+void struct_table_free(StructTable *table);
+
+// Convenience wrappers on the struct table of the current ParserContext
+int register_struct(const char *name);
+void add_struct_field(int struct_index, const char *field_name, const char *field_type);
+void reset_struct_symbols(void);
 
 // Lookup helpers
+int struct_count(void);
+const StructInfo* struct_info_at(int struct_index);
 int find_struct_index(const char *name);
+int find_struct_index_id(InternId name);
 const char* struct_field_type(const char *struct_name, const char *field_name);
 
 #endif // SYMBOL_STRUCTS_H
@@ -0,0 +1,71 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include "intern.h"
+
+/**
+ * One name binding. Bindings made in inner scopes shadow outer ones and are
+ * dropped again when their scope is popped.
+ */
+typedef struct {
+    InternId name;
+    int value;
+    int scope_depth;
+    int shadowed;              // Binding index hidden by this one, or -1
+} SymbolBinding;
+
+/**
+ * Hashed, scoped map from interned names to integer values.
+ *
+ * Lookup is an open-addressed probe keyed by InternId; every table grows on
+ * demand, so there is no fixed limit on names or scopes. A zero-initialised
+ * table is empty and ready to use.
+ */
+typedef struct {
+    SymbolBinding *bindings;   // Binding stack, innermost scope last
+    int binding_count;
+    int binding_capacity;
+    InternId *slot_names;      // Hash slots: name key (INTERN_NONE = empty)
+    int *slot_bindings;        // Hash slots: visible binding index, or -1
+    int slot_count;            // Power of two (0 until first define)
+    int used_slots;
+    int *scope_marks;          // binding_count at each scope_push
+    int scope_depth;
+    int scope_capacity;
+} SymbolTable;
+
+void symbol_table_init(SymbolTable *table);
+
+/**
+ * Release all storage and leave the table empty
+ */
+void symbol_table_free(SymbolTable *table);
+
+/**
+ * Drop every binding and scope but keep the allocated storage
+ */
+void symbol_table_clear(SymbolTable *table);
+
+void symbol_scope_push(SymbolTable *table);
+
+/**
+ * Leave the innermost scope, restoring any bindings it shadowed
+ * (the outermost scope cannot be popped)
+ */
+void symbol_scope_pop(SymbolTable *table);
+
+/**
+ * Bind name to value in the innermost scope. Redefining a name within the
+ * same scope updates the value.
+ */
+void symbol_define(SymbolTable *table, InternId name, int value);
+
+/**
+ * Find the innermost visible binding of name
+ *
+ * @param value Receives the bound value when found (may be NULL)
+ * @return      1 if name is bound, 0 otherwise
+ */
+int symbol_lookup(const SymbolTable *table, InternId name, int *value);
+
+#endif // SYMBOL_TABLE_H
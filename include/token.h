@@ -3,6 +3,10 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "source_buffer.h"
+#include "intern.h"
 
 // Token types
 typedef enum {
@@ -19,17 +23,38 @@ typedef enum {
     TOKEN_BRACKET_OPEN,
     TOKEN_BRACKET_CLOSE,
     TOKEN_COMMA,
+    TOKEN_PRAGMA,        // #pragma line; the lexeme is the text after "pragma"
     TOKEN_EOF
 } TokenType;
 
-// Token structure
+// Token structure (16 bytes; cheap to pass and return by value)
+// The lexeme is interned, so its text is available through token_text()
+// for as long as the process lives, independent of the source buffer.
 typedef struct {
-    TokenType type;
-    char value[256];
-    int line; // Add this field
+    uint32_t offset;     // Byte offset of the lexeme in the source buffer
+    uint32_t length;     // Byte length of the lexeme
+    InternId id;         // Interned lexeme
+    uint32_t line : 24;  // Line where the token starts
+    uint32_t type : 8;   // TokenType
 } Token;
 
-// Current token (shared parsing state - to be moved into ParserContext later)
+// Text of a token (never NULL; "" for EOF)
+static inline const char* token_text(Token token)
+{
+    return intern_text(token.id);
+}
+
+// Saved lexer position, used by the parser for bounded backtracking
+typedef struct {
+    size_t pos;
+    int line;
+    Token token;
+} LexerMark;
+
+// Compilation state; see parser_context.h
+typedef struct ParserContext ParserContext;
+
+// Current token of the legacy API (mirrors the default ParserContext)
 extern Token current_token;
 
 // Keyword check
@@ -38,6 +63,25 @@ int is_keyword(const char *str);
 // Tokenizer function
 Token get_next_token(FILE* input);
 
+// Scan the next token directly from a source buffer, counting newlines in *line
+Token lexer_scan(SourceBuffer *source, int *line);
+
+// Same, using the legacy current_line counter
+Token lexer_next_token(SourceBuffer *source);
+
+// Bind the lexer to a stream (loaded whole) or to caller-owned memory
+int lexer_begin(FILE *input);
+void lexer_begin_memory(const char *data, size_t length);
+void lexer_end(void);
+const SourceBuffer* lexer_source(void);
+
+// 1-based column of a token in the source currently bound to the lexer
+int token_column(Token token);
+
+// Save / restore the scan position together with current_token
+LexerMark lexer_mark(void);
+void lexer_reset_to(const LexerMark *mark);
+
 void advance(FILE *input);
 int match(TokenType type);
 int consume(FILE *input, TokenType type);
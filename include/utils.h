@@ -1,7 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stddef.h>
 #include "astnode.h"  // ASTNode definition
+#include "intern.h"
 
 // Operator precedence constants (mirrors C precedence ordering)
 // Higher number = higher precedence
@@ -21,10 +23,45 @@
 #define PREC_PARENTHESIZED_MIN  1   // Minimum precedence for parenthesized expressions
 #define PREC_TOP_LEVEL_MIN     -2   // Minimum precedence for top-level expressions
 
-char* ctype_to_vhdl(const char* ctype);
+/**
+ * realloc() that reports the failure and exits, as every allocation in the
+ * compiler does; a size of 0 still returns a unique block
+ */
+void* xrealloc(void *memory, size_t size);
+
+/**
+ * Grow a doubling array: the capacity becomes initial when it is 0 and
+ * doubles otherwise, and the array is reallocated to match
+ */
+void* grow_array(void *memory, int *capacity, int initial, size_t element_size);
+
+// Widest intN_t / uintN_t (and _BitInt(N)) type
+#define CTYPE_MAX_EXPLICIT_WIDTH 64
+#define CTYPE_VHDL_NAME_SIZE 48
+
+const char* ctype_to_vhdl(const char* ctype);
+
+/**
+ * Width of an explicit-width integer type: intN_t or uintN_t with N in
+ * 1..CTYPE_MAX_EXPLICIT_WIDTH (the lexer spells _BitInt(N) as intN_t)
+ *
+ * @param is_signed Set to 0 for uintN_t (may be NULL)
+ * @return N, or 0 for any other type
+ */
+int ctype_explicit_width(const char* ctype, int* is_signed);
 void print_ast(ASTNode* node, int level);
 int is_number_str(const char *s);
 int is_negative_literal(const char* value);
 int get_precedence(const char *op);
+int get_precedence_id(InternId op);
+
+// A name ("x") or a negated name ("-x") as the parser stores it, or NULL
+const char* identifier_name(const ASTNode *node);
+
+// The function of the program (function's parent) a call names, or NULL
+ASTNode* find_callee(const ASTNode *function, const ASTNode *call);
+
+// The declaration of name under node (a parameter or local of a function), or NULL
+const ASTNode* find_declaration(const ASTNode *node, const char *name);
 
 #endif
\ No newline at end of file
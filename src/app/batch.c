@@ -0,0 +1,682 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "parse.h"
+#include "parser_context.h"
+#include "codegen_vhdl.h"
+#include "arena.h"
+#include "intern.h"
+#include "utils.h"
+#include "ast_image.h"
+#include "compile_stream.h"
+
+#define BATCH_INITIAL_JOBS 16
+#define MANIFEST_LINE_LENGTH 4096
+#define SPLIT_PACKAGE_SUFFIX "_types"
+#define AST_IMAGE_EXTENSION ".ast"
+
+static char* batch_strdup(const char *text)
+{
+    size_t length = strlen(text);
+    char *copy = (char*)xrealloc(NULL, length + 1);
+
+    memcpy(copy, text, length + 1);
+    return copy;
+}
+
+// Helper: "<stem>_types" from output_path, reduced to a VHDL identifier
+static char* split_package_name(const char *output_path)
+{
+    const char *base = strrchr(output_path, '/');
+    const char *stem = base ? base + 1 : output_path;
+    const char *dot = strrchr(stem, '.');
+    size_t stem_length = dot && dot != stem ? (size_t)(dot - stem) : strlen(stem);
+    char *name = (char*)xrealloc(NULL, stem_length + 2 + sizeof(SPLIT_PACKAGE_SUFFIX));
+    size_t length = 0;
+
+    // A letter first, no "__", and the suffix supplies a non-underscore end
+    if (stem_length == 0 || !isalpha((unsigned char)stem[0])) {
+        name[length++] = 'u';
+    }
+    for (size_t index = 0; index < stem_length; index++) {
+        char character = isalnum((unsigned char)stem[index]) ? stem[index] : '_';
+
+        if (character == '_' && length > 0 && name[length - 1] == '_') {
+            continue;
+        }
+        name[length++] = character;
+    }
+    if (length > 0 && name[length - 1] == '_') {
+        length--;
+    }
+    memcpy(name + length, SPLIT_PACKAGE_SUFFIX, sizeof(SPLIT_PACKAGE_SUFFIX));
+    return name;
+}
+
+// Helper: write one split design file, reporting failures like compile_unit
+static int write_split_file(const char *path, const char *header, size_t header_length,
+                            const char *package_use, const OutputBuffer *text)
+{
+    FILE *file = fopen(path, "w");
+    int written = 0;
+
+    if (!file) {
+        perror("Error opening output file");
+        return 0;
+    }
+    written = fwrite(header, 1, header_length, file) == header_length;
+    if (package_use) {
+        written = written && fprintf(file, "use work.%s.all;\n\n", package_use) >= 0;
+    }
+    written = written && fwrite(text->data, 1, text->length, file) == text->length;
+    if (fclose(file) != 0 || !written) {
+        perror("Error writing output file");
+        return 0;
+    }
+    return 1;
+}
+
+// Helper: generate split units in parallel and write them next to output_path,
+// as "<stem>.<function>.vhd" so units sharing a directory never share a file
+static int write_split_units(ParserContext *ctx, ASTNode *program, const char *output_path,
+                             FILE *fout, const CompileOptions *options)
+{
+    const char *base = strrchr(output_path, '/');
+    const char *stem = base ? base + 1 : output_path;
+    const char *dot = strrchr(stem, '.');
+    size_t prefix_length = dot && dot != stem ? (size_t)(dot - output_path) : strlen(output_path);
+    size_t stem_length = prefix_length - (size_t)(stem - output_path);
+    char *package_name = split_package_name(output_path);
+    int worker_count = options->codegen_jobs > 0 ? options->codegen_jobs : batch_default_jobs();
+    CodegenUnit *units = NULL;
+    OutputBuffer header;
+    OutputBuffer package;
+    OutputBuffer listing;
+    int unit_count = 0;
+    int has_package = 0;
+    int succeeded = 1;
+    size_t bytes = 0;
+
+    output_buffer_init(&header, NULL);
+    emit_vhdl_header(&header);
+    output_buffer_init(&package, NULL);
+    has_package = generate_vhdl_package(ctx, package_name, &package) > 0;
+    output_buffer_init(&listing, fout);
+    if (has_package) {
+        out_write(&listing, header.data, header.length);
+        out_write(&listing, package.data, package.length);
+    } else {
+        // Context clauses alone are not a design unit
+        out_puts(&listing, "-- VHDL generated by compi\n");
+    }
+
+    unit_count = generate_vhdl_units(ctx, program, worker_count, &units);
+    out_puts(&listing, "\n-- Entities, one design file each:\n");
+    for (int unit_idx = 0; unit_idx < unit_count && succeeded; unit_idx++) {
+        char *path = (char*)xrealloc(NULL, prefix_length + 1 + strlen(units[unit_idx].name) + sizeof(".vhd"));
+
+        sprintf(path, "%.*s.%s.vhd", (int)prefix_length, output_path, units[unit_idx].name);
+        out_printf(&listing, "--   %.*s.%s.vhd\n", (int)stem_length, stem, units[unit_idx].name);
+        succeeded = write_split_file(path, header.data, header.length,
+                                     has_package ? package_name : NULL, &units[unit_idx].text);
+        bytes += header.length + units[unit_idx].text.length;
+        free(path);
+    }
+
+    succeeded = output_buffer_flush(&listing) && succeeded;
+    PROFILE_COUNT(ctx, output_bytes, bytes + listing.bytes_written);
+    codegen_units_free(units, unit_count);
+    output_buffer_free(&listing);
+    output_buffer_free(&package);
+    output_buffer_free(&header);
+    free(package_name);
+    return succeeded;
+}
+
+// Helper: output_path with its extension replaced by suffix
+static char* sibling_path(const char *output_path, const char *suffix)
+{
+    const char *base = strrchr(output_path, '/');
+    const char *stem = base ? base + 1 : output_path;
+    const char *dot = strrchr(stem, '.');
+    size_t length = dot && dot != stem ? (size_t)(dot - output_path) : strlen(output_path);
+    char *path = (char*)xrealloc(NULL, length + strlen(suffix) + 1);
+
+    sprintf(path, "%.*s%s", (int)length, output_path, suffix);
+    return path;
+}
+
+// Helper: write "<stem>_tb.vhdl" and "<stem>_tb_vectors.c" next to output_path
+static int write_testbench(ParserContext *ctx, ASTNode *program, const char *input_path,
+                           const char *output_path, int vector_count)
+{
+    char *bench_path = sibling_path(output_path, "_tb.vhdl");
+    char *vectors_path = sibling_path(output_path, "_tb_vectors.c");
+    char *source_path = realpath(input_path, NULL);
+    OutputBuffer bench;
+    OutputBuffer vectors;
+    int succeeded = 0;
+
+    output_buffer_init(&bench, NULL);
+    output_buffer_init(&vectors, NULL);
+    // The vector program includes the source, so it needs a path that
+    // resolves from wherever it is compiled
+    generate_testbench(ctx, program, source_path ? source_path : input_path, vector_count,
+                       &bench, &vectors);
+    succeeded = write_split_file(bench_path, "", 0, NULL, &bench) &&
+                write_split_file(vectors_path, "", 0, NULL, &vectors);
+
+    output_buffer_free(&vectors);
+    output_buffer_free(&bench);
+    free(source_path);
+    free(vectors_path);
+    free(bench_path);
+    return succeeded;
+}
+
+// Helper: output_path names an AST image rather than a VHDL file
+static int is_ast_image_path(const char *output_path)
+{
+    size_t length = strlen(output_path);
+    size_t extension_length = strlen(AST_IMAGE_EXTENSION);
+
+    return length > extension_length &&
+           strcmp(output_path + length - extension_length, AST_IMAGE_EXTENSION) == 0;
+}
+
+// Helper: rebuild the AST of an image input instead of parsing it
+static ASTNode* load_ast_image(ParserContext *ctx, const char *input_path)
+{
+    AstImage image;
+
+    if (!ast_image_open(&image, ctx->source.data, ctx->source.length)) {
+        fprintf(stderr, "%s: not a valid compi AST image (version %d)\n", input_path, AST_IMAGE_VERSION);
+        ctx->error_count++;
+        return NULL;
+    }
+    return ast_image_load(&image, ctx->arena, &ctx->structs);
+}
+
+// Optimisation and code generation of one parsed unit
+typedef struct {
+    ParserContext *ctx;
+    ASTNode *program;
+    const char *input_path;
+    const char *output_path;
+    FILE *fout;
+    const CompileOptions *options;
+    int succeeded;
+} CompileBackEnd;
+
+// Helper: the --estimate report of one unit, written to stderr in one piece
+// so reports of parallel batch jobs do not interleave
+static void print_estimate(ParserContext *ctx, ASTNode *program, const char *input_path,
+                           TimeReportFormat format)
+{
+    CodegenEstimate *estimates = NULL;
+    int count = estimate_vhdl(ctx, program, &estimates);
+    OutputBuffer report;
+
+    output_buffer_init(&report, NULL);
+    if (format == TIME_REPORT_JSON) {
+        estimate_print_json(estimates, count, input_path, &report);
+        out_putc(&report, '\n');
+    } else {
+        estimate_print_text(estimates, count, input_path, &report);
+    }
+    flockfile(stderr);
+    fwrite(output_buffer_data(&report), 1, report.length, stderr);
+    funlockfile(stderr);
+    output_buffer_free(&report);
+    free(estimates);
+}
+
+static void* compile_back_end(void *argument)
+{
+    CompileBackEnd *back_end = (CompileBackEnd*)argument;
+    ParserContext *ctx = back_end->ctx;
+    const CompileOptions *options = back_end->options;
+
+    PROFILE_TIMER_START(ctx, optimize_timer);
+    optimize_program(back_end->program, &options->optimize);
+    PROFILE_TIMER_STOP(ctx, optimize_timer, PROFILE_PHASE_OPTIMIZE);
+
+    if (options->estimate) {
+        print_estimate(ctx, back_end->program, back_end->input_path, options->estimate);
+    }
+
+    if (options->verbose) {
+        printf("Generating VHDL code...\n");
+    }
+    PROFILE_TIMER_START(ctx, codegen_timer);
+    if (is_ast_image_path(back_end->output_path)) {
+        OutputBuffer image;
+
+        output_buffer_init(&image, back_end->fout);
+        ast_image_write(back_end->program, &ctx->structs, &image);
+        back_end->succeeded = output_buffer_flush(&image);
+        PROFILE_COUNT(ctx, output_bytes, image.bytes_written);
+        output_buffer_free(&image);
+    } else if (options->split_units) {
+        back_end->succeeded = write_split_units(ctx, back_end->program, back_end->output_path,
+                                                back_end->fout, options);
+    } else {
+        back_end->succeeded = generate_vhdl_ctx(ctx, back_end->program, back_end->fout);
+    }
+    if (options->testbench_vectors > 0 && !is_ast_image_path(back_end->output_path)) {
+        back_end->succeeded = write_testbench(ctx, back_end->program, back_end->input_path,
+                                              back_end->output_path, options->testbench_vectors) &&
+                              back_end->succeeded;
+    }
+    PROFILE_TIMER_STOP(ctx, codegen_timer, PROFILE_PHASE_CODEGEN);
+    return NULL;
+}
+
+// Helper: the passes after parsing recurse once per tree level, so a tree
+// too deep for the current stack is handed to a thread with a larger one
+static void run_back_end(CompileBackEnd *back_end, size_t stack_size)
+{
+    pthread_attr_t attributes;
+    pthread_t worker;
+    int started = 0;
+
+    if (stack_size > 0 && pthread_attr_init(&attributes) == 0) {
+        started = pthread_attr_setstacksize(&attributes, stack_size) == 0 &&
+                  pthread_create(&worker, &attributes, compile_back_end, back_end) == 0;
+        pthread_attr_destroy(&attributes);
+    }
+    if (started) {
+        pthread_join(worker, NULL);
+    } else {
+        compile_back_end(back_end);
+    }
+}
+
+// Helper: --stream; parsing, optimisation and generation interleave, so
+// the parse phase is reported without the time of the other two
+static int compile_streamed(ParserContext *ctx, FILE *fout, const CompileOptions *options,
+                            CompileProfile *profile)
+{
+    CompileStreamStats stats;
+    OutputBuffer out;
+    double back_end_seconds = 0.0;
+    int succeeded = 0;
+
+    if (profile) {
+        back_end_seconds = profile->phase_seconds[PROFILE_PHASE_OPTIMIZE] +
+                           profile->phase_seconds[PROFILE_PHASE_CODEGEN];
+    }
+    output_buffer_init(&out, fout);
+    PROFILE_TIMER_START(ctx, parse_timer);
+    succeeded = compile_stream(ctx, &options->optimize, &out, &stats);
+    PROFILE_TIMER_STOP(ctx, parse_timer, PROFILE_PHASE_PARSE);
+    succeeded = output_buffer_flush(&out) && succeeded;
+    PROFILE_COUNT(ctx, output_bytes, out.bytes_written);
+    output_buffer_free(&out);
+
+    if (profile) {
+        profile->phase_seconds[PROFILE_PHASE_PARSE] -=
+            profile->phase_seconds[PROFILE_PHASE_OPTIMIZE] +
+            profile->phase_seconds[PROFILE_PHASE_CODEGEN] - back_end_seconds;
+        profile->ast_node_count = stats.node_count;
+        profile->ast_bytes = stats.peak_ast_bytes;
+    }
+    return succeeded;
+}
+
+int compile_unit(const char *input_path, const char *output_path,
+                 const CompileOptions *options, int *error_count,
+                 CompileProfile *profile)
+{
+    FILE *fin = NULL;
+    FILE *fout = NULL;
+    ASTNode *program = NULL;
+    ParserContext ctx;
+    Arena ast_arena;
+    int succeeded = 0;
+    int streamed = options->stream && !is_ast_image_path(output_path);
+    double start_time = 0.0;
+
+    if (error_count) {
+        *error_count = 0;
+    }
+    if (profile) {
+        profile_reset(profile);
+        start_time = profile_now();
+    }
+
+    fin = fopen(input_path, "r");
+    if (!fin) {
+        perror("Error opening input file");
+        return 0;
+    }
+
+    fout = fopen(output_path, "w");
+    if (!fout) {
+        perror("Error opening output file");
+        fclose(fin);
+        return 0;
+    }
+
+    if (options->verbose) {
+        printf("Parsing input file...\n");
+    }
+
+    // The whole AST lives in one arena so teardown is a single release
+    arena_init(&ast_arena, 0);
+    parser_context_init(&ctx);
+    ctx.arena = &ast_arena;
+    ctx.filename = input_path;
+    ctx.profile = profile;
+    ctx.codegen = &options->codegen;
+    ctx.diagnostics.buffered = 1;
+    if (options->max_errors > 0) {
+        ctx.max_errors = options->max_errors;
+    }
+
+    PROFILE_TIMER_START(&ctx, load_timer);
+    if (ctx_lexer_begin(&ctx, fin)) {
+        PROFILE_TIMER_STOP(&ctx, load_timer, PROFILE_PHASE_LOAD);
+        PROFILE_COUNT(&ctx, source_bytes, ctx.source.length);
+        if (ast_image_recognize(ctx.source.data, ctx.source.length)) {
+            streamed = 0;
+        }
+        if (streamed) {
+            succeeded = compile_streamed(&ctx, fout, options, profile);
+        } else {
+            PROFILE_TIMER_START(&ctx, parse_timer);
+            if (ast_image_recognize(ctx.source.data, ctx.source.length)) {
+                program = load_ast_image(&ctx, input_path);
+            } else {
+                program = parse_program_ctx(&ctx);
+            }
+            PROFILE_TIMER_STOP(&ctx, parse_timer, PROFILE_PHASE_PARSE);
+        }
+    }
+
+    #ifdef DEBUG
+        print_ast(program, 0);
+    #endif
+
+    if (streamed) {
+        // Generated while parsing; a syntax error drops what was written
+        if (!succeeded) {
+            fflush(fout);
+            if (ftruncate(fileno(fout), 0) == 0) {
+                rewind(fout);
+            }
+        }
+    } else if (program) {
+        CompileBackEnd back_end = { &ctx, program, input_path, output_path, fout, options, 0 };
+
+        run_back_end(&back_end, ast_stack_size(program));
+        succeeded = back_end.succeeded;
+    }
+    if (!program && !succeeded) {
+        fprintf(fout, "-- VHDL code generation failed\n");
+        fprintf(fout, "-- AST was not generated successfully\n");
+    }
+
+    // The unit's diagnostics go out together, never interleaved with
+    // those of units compiled on other threads
+    diagnostics_flush(&ctx.diagnostics, stderr, options->diagnostics);
+
+    fclose(fin);
+    if (fclose(fout) != 0) {
+        perror("Error writing output file");
+        succeeded = 0;
+    }
+
+    if (error_count) {
+        *error_count = ctx.error_count;
+    }
+    if (profile && !streamed) {
+        profile->ast_node_count = profile_count_nodes(program);
+        profile->ast_bytes = ast_arena.bytes_reserved;
+    }
+    if (profile) {
+        profile->peak_memory_kb = profile_peak_memory_kb();
+        profile->total_seconds = profile_now() - start_time;
+    }
+
+    // With skip_teardown the process exit reclaims the AST instead
+    if (!options->skip_teardown) {
+        parser_context_destroy(&ctx);
+        arena_release(&ast_arena);
+    }
+
+    return succeeded;
+}
+
+void print_time_report(const CompileProfile *profile, const char *input_path,
+                       TimeReportFormat format)
+{
+    if (format == TIME_REPORT_JSON) {
+        profile_print_json(profile, input_path, stderr);
+        fputc('\n', stderr);
+    } else if (format == TIME_REPORT_TEXT) {
+        profile_print_text(profile, input_path, stderr);
+    }
+}
+
+void batch_init(BatchList *batch)
+{
+    memset(batch, 0, sizeof(*batch));
+    symbol_table_init(&batch->outputs);
+}
+
+void batch_free(BatchList *batch)
+{
+    for (int job_idx = 0; job_idx < batch->count; job_idx++) {
+        free(batch->jobs[job_idx].input_path);
+        free(batch->jobs[job_idx].output_path);
+    }
+    free(batch->jobs);
+    symbol_table_free(&batch->outputs);
+    batch_init(batch);
+}
+
+// Helper: derive "<out_dir>/<stem>.vhdl" (or "<dir>/<stem>.vhdl") from input
+static char* default_output_path(const char *input_path, const char *out_dir)
+{
+    const char *base = strrchr(input_path, '/');
+    const char *stem = base ? base + 1 : input_path;
+    const char *dot = strrchr(stem, '.');
+    size_t stem_length = dot && dot != stem ? (size_t)(dot - stem) : strlen(stem);
+    size_t dir_length = 0;
+    const char *dir = NULL;
+    char *path = NULL;
+
+    if (out_dir) {
+        dir = out_dir;
+        dir_length = strlen(out_dir);
+        while (dir_length > 1 && dir[dir_length - 1] == '/') {
+            dir_length--;
+        }
+    } else if (base) {
+        dir = input_path;
+        dir_length = (size_t)(base - input_path);
+    }
+
+    path = (char*)xrealloc(NULL, dir_length + 1 + stem_length + sizeof(".vhdl"));
+    if (dir) {
+        sprintf(path, "%.*s/%.*s.vhdl", (int)dir_length, dir, (int)stem_length, stem);
+    } else {
+        sprintf(path, "%.*s.vhdl", (int)stem_length, stem);
+    }
+    return path;
+}
+
+int batch_add(BatchList *batch, const char *input_path,
+              const char *output_path, const char *out_dir)
+{
+    BatchJob *job = NULL;
+    char *path = output_path ? batch_strdup(output_path)
+                             : default_output_path(input_path, out_dir);
+    InternId path_id = intern_cstr(path);
+    int other_idx = 0;
+
+    // Two jobs writing one file would race and both report success
+    if (symbol_lookup(&batch->outputs, path_id, &other_idx)) {
+        printf("Error: %s and %s would both be written to %s\n",
+               batch->jobs[other_idx].input_path, input_path, path);
+        free(path);
+        return 0;
+    }
+
+    if (batch->count >= batch->capacity) {
+        batch->capacity = batch->capacity ? batch->capacity * 2 : BATCH_INITIAL_JOBS;
+        batch->jobs = (BatchJob*)xrealloc(batch->jobs, (size_t)batch->capacity * sizeof(BatchJob));
+    }
+
+    symbol_define(&batch->outputs, path_id, batch->count);
+    job = &batch->jobs[batch->count++];
+    job->input_path = batch_strdup(input_path);
+    job->output_path = path;
+    job->succeeded = 0;
+    job->error_count = 0;
+    profile_reset(&job->profile);
+    return 1;
+}
+
+int batch_load_manifest(BatchList *batch, const char *manifest_path,
+                        const char *out_dir)
+{
+    char line[MANIFEST_LINE_LENGTH];
+    FILE *manifest = fopen(manifest_path, "r");
+    int succeeded = 1;
+
+    if (!manifest) {
+        perror("Error opening manifest file");
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), manifest)) {
+        char *input_path = strtok(line, " \t\r\n");
+        char *output_path = NULL;
+
+        if (!input_path || input_path[0] == '#') {
+            continue;
+        }
+        output_path = strtok(NULL, " \t\r\n");
+        if (!batch_add(batch, input_path, output_path, out_dir)) {
+            succeeded = 0;
+        }
+    }
+
+    fclose(manifest);
+    return succeeded;
+}
+
+int batch_make_directory(const char *path)
+{
+    char *partial = batch_strdup(path);
+    int made = 1;
+
+    // Each parent first, like mkdir -p
+    for (char *cursor = partial + 1; made && *cursor; cursor++) {
+        if (*cursor != '/') {
+            continue;
+        }
+        *cursor = '\0';
+        made = mkdir(partial, 0777) == 0 || errno == EEXIST;
+        *cursor = '/';
+    }
+    made = made && (mkdir(partial, 0777) == 0 || errno == EEXIST);
+    if (!made) {
+        perror("Error creating output directory");
+    }
+    free(partial);
+    return made;
+}
+
+int batch_default_jobs(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+// Work queue shared by the pool: each worker claims the next unstarted job
+typedef struct {
+    BatchList *batch;
+    const CompileOptions *options;
+    atomic_int next_job;
+} BatchQueue;
+
+static void* batch_worker(void *arg)
+{
+    BatchQueue *queue = (BatchQueue*)arg;
+    int job_idx = 0;
+
+    while ((job_idx = atomic_fetch_add(&queue->next_job, 1)) < queue->batch->count) {
+        BatchJob *job = &queue->batch->jobs[job_idx];
+        job->succeeded = compile_unit(job->input_path, job->output_path,
+                                      queue->options, &job->error_count,
+                                      queue->options->time_report ? &job->profile : NULL);
+    }
+    return NULL;
+}
+
+int batch_run(BatchList *batch, int worker_count, const CompileOptions *options)
+{
+    BatchQueue queue;
+    pthread_t *workers = NULL;
+    int started = 0;
+    int failures = 0;
+
+    if (worker_count <= 0) {
+        worker_count = batch_default_jobs();
+    }
+    if (worker_count > batch->count) {
+        worker_count = batch->count;
+    }
+
+    queue.batch = batch;
+    queue.options = options;
+    atomic_init(&queue.next_job, 0);
+
+    // The calling thread is worker 0
+    workers = (pthread_t*)xrealloc(NULL, (size_t)(worker_count > 1 ? worker_count : 1) * sizeof(pthread_t));
+    for (int worker_idx = 1; worker_idx < worker_count; worker_idx++) {
+        if (pthread_create(&workers[started], NULL, batch_worker, &queue) != 0) {
+            break;
+        }
+        started++;
+    }
+    batch_worker(&queue);
+    for (int worker_idx = 0; worker_idx < started; worker_idx++) {
+        pthread_join(workers[worker_idx], NULL);
+    }
+    free(workers);
+
+    for (int job_idx = 0; job_idx < batch->count; job_idx++) {
+        const BatchJob *job = &batch->jobs[job_idx];
+        if (job->succeeded) {
+            printf("OK      %s -> %s\n", job->input_path, job->output_path);
+        } else {
+            if (job->error_count > 0) {
+                printf("FAILED  %s (%d error%s)\n", job->input_path, job->error_count,
+                       job->error_count == 1 ? "" : "s");
+            } else {
+                printf("FAILED  %s\n", job->input_path);
+            }
+            failures++;
+        }
+    }
+    printf("Compiled %d of %d files\n", batch->count - failures, batch->count);
+
+    // Reports follow the status lines in input order (JSON: one object per line)
+    for (int job_idx = 0; job_idx < batch->count && options->time_report; job_idx++) {
+        print_time_report(&batch->jobs[job_idx].profile, batch->jobs[job_idx].input_path,
+                          options->time_report);
+    }
+
+    return failures;
+}
@@ -1,63 +1,271 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include "parse.h"
-#include "codegen_vhdl.h"
+#include "batch.h"
+
+
+static void print_usage(const char *program_name)
+{
+    printf("Usage: %s [options] <input.c> <output.vhdl>\n", program_name);
+    printf("       %s --batch [--jobs=N] [--out-dir=DIR] [--manifest=FILE] [options] [input.c ...]\n",
+           program_name);
+    printf("Options: [--no-teardown] [--no-optimize] [--time-report[=json]] [--estimate[=json]]\n"
+           "         [--pipeline-stages=N] [--share=N] [--share-adders] [--unroll-limit=N]\n"
+           "         [--fsm] [--bram-threshold=N] [--narrow-widths] [--fixed-point=Qm.n]\n"
+           "         [--inline-limit=N] [--no-balance] [--no-strength-reduction] [--no-cse]\n"
+           "         [--combinational] [--cache-dir=DIR] [--split] [--codegen-jobs=N]\n"
+           "         [--max-errors=N] [--diagnostics=text|json] [--testbench[=N]]\n"
+           "         [--stream] [--reset=async|sync|none]\n");
+}
+
+// Helper: value of "--name=value", or NULL if arg is not that option
+static const char* option_value(const char *arg, const char *name)
+{
+    size_t length = strlen(name);
+
+    if (strncmp(arg, name, length) == 0 && arg[length] == '=') {
+        return arg + length + 1;
+    }
+    return NULL;
+}
 
 
 int main(int argc, char *argv[])
 {
 
-    FILE *fin = NULL;
-    FILE *fout = NULL;
-    ASTNode *program = NULL;
+    CompileOptions options = { .verbose = 1, .skip_teardown = 0, .time_report = TIME_REPORT_OFF };
+    CompileProfile profile;
+    BatchList batch;
+    const char **positional = NULL;
+    int positional_count = 0;
+    const char *manifest_path = NULL;
+    const char *out_dir = NULL;
+    const char *value = NULL;
+    int batch_mode = 0;
+    int worker_count = 0;
+    int failures = 0;
 
-    // Check arguments
-    if (argc < 3) {
-        printf("Usage: %s <input.c> <output.vhdl>\n", argv[0]);
+    optimize_options_default(&options.optimize);
+    codegen_options_default(&options.codegen);
+    batch_init(&batch);
+    positional = (const char**)calloc((size_t)argc, sizeof(const char*));
+    if (!positional) {
+        perror("Failed to allocate memory for arguments");
         exit(EXIT_FAILURE);
     }
 
-    // Open input file
-    fin = fopen(argv[1], "r");
-    if (!fin) {
-        perror("Error opening input file");
+    // Parse options and positional arguments
+    for (int arg_index = 1; arg_index < argc; arg_index++) {
+        const char *arg = argv[arg_index];
+
+        if (strcmp(arg, "--no-teardown") == 0) {
+            options.skip_teardown = 1;
+        } else if (strcmp(arg, "--no-optimize") == 0) {
+            optimize_options_none(&options.optimize);
+        } else if (strcmp(arg, "--time-report") == 0) {
+            options.time_report = TIME_REPORT_TEXT;
+        } else if ((value = option_value(arg, "--time-report")) != NULL) {
+            if (strcmp(value, "json") == 0) {
+                options.time_report = TIME_REPORT_JSON;
+            } else if (strcmp(value, "text") == 0) {
+                options.time_report = TIME_REPORT_TEXT;
+            } else {
+                printf("Invalid time report format: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(arg, "--estimate") == 0) {
+            options.estimate = TIME_REPORT_TEXT;
+        } else if ((value = option_value(arg, "--estimate")) != NULL) {
+            if (strcmp(value, "json") == 0) {
+                options.estimate = TIME_REPORT_JSON;
+            } else if (strcmp(value, "text") == 0) {
+                options.estimate = TIME_REPORT_TEXT;
+            } else {
+                printf("Invalid estimate format: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((value = option_value(arg, "--inline-limit")) != NULL) {
+            options.optimize.inline_limit = atoi(value);
+            if (options.optimize.inline_limit < 0) {
+                printf("Invalid inline limit: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((value = option_value(arg, "--diagnostics")) != NULL) {
+            if (strcmp(value, "json") == 0) {
+                options.diagnostics = DIAGNOSTIC_FORMAT_JSON;
+            } else if (strcmp(value, "text") == 0) {
+                options.diagnostics = DIAGNOSTIC_FORMAT_TEXT;
+            } else {
+                printf("Invalid diagnostics format: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((value = option_value(arg, "--reset")) != NULL) {
+            if (strcmp(value, "async") == 0) {
+                options.codegen.reset = RESET_ASYNC;
+            } else if (strcmp(value, "sync") == 0) {
+                options.codegen.reset = RESET_SYNC;
+            } else if (strcmp(value, "none") == 0) {
+                options.codegen.reset = RESET_NONE;
+            } else {
+                printf("Invalid reset style: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((value = option_value(arg, "--max-errors")) != NULL) {
+            options.max_errors = atoi(value);
+            if (options.max_errors <= 0) {
+                printf("Invalid error limit: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(arg, "--no-balance") == 0) {
+            options.optimize.balance_expressions = 0;
+        } else if ((value = option_value(arg, "--pipeline-stages")) != NULL) {
+            options.codegen.pipeline_stages = atoi(value);
+            if (options.codegen.pipeline_stages <= 0) {
+                printf("Invalid pipeline stage count: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((value = option_value(arg, "--share")) != NULL) {
+            options.codegen.share_limit = atoi(value);
+            if (options.codegen.share_limit <= 0) {
+                printf("Invalid sharing limit: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((value = option_value(arg, "--unroll-limit")) != NULL) {
+            options.codegen.unroll_limit = atoi(value);
+            if (options.codegen.unroll_limit < 0) {
+                printf("Invalid unroll limit: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((value = option_value(arg, "--bram-threshold")) != NULL) {
+            options.codegen.bram_threshold = atoi(value);
+            if (options.codegen.bram_threshold < 0) {
+                printf("Invalid block RAM threshold: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(arg, "--share-adders") == 0) {
+            options.codegen.share_adders = 1;
+        } else if (strcmp(arg, "--fsm") == 0) {
+            options.codegen.fsm = 1;
+        } else if (strcmp(arg, "--combinational") == 0) {
+            options.codegen.combinational = 1;
+        } else if (strcmp(arg, "--narrow-widths") == 0) {
+            options.codegen.narrow_widths = 1;
+        } else if (strcmp(arg, "--no-strength-reduction") == 0) {
+            options.codegen.strength_reduce = 0;
+        } else if (strcmp(arg, "--no-cse") == 0) {
+            options.codegen.eliminate_common = 0;
+        } else if ((value = option_value(arg, "--cache-dir")) != NULL) {
+            options.codegen.cache_dir = value;
+        } else if ((value = option_value(arg, "--fixed-point")) != NULL) {
+            if (!codegen_parse_fixed_point(value, &options.codegen.fixed_integer_bits,
+                                           &options.codegen.fixed_fraction_bits)) {
+                printf("Invalid fixed-point format: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(arg, "--testbench") == 0) {
+            options.testbench_vectors = TESTBENCH_DEFAULT_VECTORS;
+        } else if ((value = option_value(arg, "--testbench")) != NULL) {
+            options.testbench_vectors = atoi(value);
+            if (options.testbench_vectors <= 0) {
+                printf("Invalid testbench vector count: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(arg, "--stream") == 0) {
+            options.stream = 1;
+        } else if (strcmp(arg, "--split") == 0) {
+            options.split_units = 1;
+        } else if ((value = option_value(arg, "--codegen-jobs")) != NULL) {
+            options.codegen_jobs = atoi(value);
+            if (options.codegen_jobs <= 0) {
+                printf("Invalid codegen job count: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(arg, "--batch") == 0) {
+            batch_mode = 1;
+        } else if ((value = option_value(arg, "--jobs")) != NULL) {
+            worker_count = atoi(value);
+            if (worker_count <= 0) {
+                printf("Invalid job count: %s\n", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if ((value = option_value(arg, "--out-dir")) != NULL) {
+            out_dir = value;
+        } else if ((value = option_value(arg, "--manifest")) != NULL) {
+            manifest_path = value;
+        } else if (strncmp(arg, "--", 2) == 0) {
+            printf("Unknown option: %s\n", arg);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        } else {
+            positional[positional_count++] = arg;
+        }
+    }
+
+    if (options.time_report && !profile_available()) {
+        printf("--time-report requires a build with COMPI_PROFILING enabled\n");
         exit(EXIT_FAILURE);
     }
 
-    // Open output file
-    fout = fopen(argv[2], "w");
-    if (!fout) {
-        perror("Error opening output file");
-        fclose(fin);
+    // Those need the whole program at once
+    if (options.stream && (options.split_units || options.testbench_vectors > 0 || options.estimate)) {
+        printf("--stream cannot be combined with --split, --testbench or --estimate\n");
         exit(EXIT_FAILURE);
     }
 
-    printf("Parsing input file...\n");
-
-    // Parse the program and build the AST
-    program = parse_program(fin);
-
-    #ifdef DEBUG
-        print_ast(program, 0); // Print the AST for debugging if -d is passed
-    #endif
-
-    // Generate VHDL code from the AST
-    if (program) {
-        printf("Generating VHDL code...\n");
-        generate_vhdl(program, fout);
-        free_node(program);
-    } else {
-        fprintf(fout, "-- VHDL code generation failed\n");
-        fprintf(fout, "-- AST was not generated successfully\n");
-        fclose(fin);
-        fclose(fout);
+    // Batch options imply batch mode
+    if (manifest_path || out_dir || worker_count > 0) {
+        batch_mode = 1;
+    }
+
+    if (batch_mode) {
+        int queued = 1;
+
+        if (out_dir && !batch_make_directory(out_dir)) {
+            exit(EXIT_FAILURE);
+        }
+        for (int input_idx = 0; input_idx < positional_count; input_idx++) {
+            if (!batch_add(&batch, positional[input_idx], NULL, out_dir)) {
+                queued = 0;
+            }
+        }
+        if (manifest_path && !batch_load_manifest(&batch, manifest_path, out_dir)) {
+            queued = 0;
+        }
+        if (!queued) {
+            exit(EXIT_FAILURE);
+        }
+        if (batch.count == 0) {
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+
+        // Parallel progress lines would interleave; report per file instead
+        options.verbose = 0;
+        // Files already keep every worker busy
+        if (options.codegen_jobs == 0) {
+            options.codegen_jobs = 1;
+        }
+        failures = batch_run(&batch, worker_count, &options);
+        batch_free(&batch);
+        free(positional);
+        exit(failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    // Check arguments
+    if (positional_count != 2) {
+        print_usage(argv[0]);
         exit(EXIT_FAILURE);
     }
 
-    fclose(fin);
-    fclose(fout);
+    failures = !compile_unit(positional[0], positional[1], &options, NULL,
+                             options.time_report ? &profile : NULL);
+    if (options.time_report) {
+        print_time_report(&profile, positional[0], options.time_report);
+    }
+    free(positional);
+    if (failures) {
+        exit(EXIT_FAILURE);
+    }
 
     printf("Compilation finished.\n");
     exit(EXIT_SUCCESS);
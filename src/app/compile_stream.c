@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "compile_stream.h"
+#include "parse.h"
+#include "codegen_vhdl.h"
+#include "symbol_table.h"
+#include "profile.h"
+#include "utils.h"
+
+// Starting capacity of the callee list and of the pending/retained lists
+#define STREAM_INITIAL_CALLEES 16
+#define STREAM_INITIAL_FUNCTIONS 8
+
+// Functions defined in and called from the source, from a lexer-only pass
+typedef struct {
+    SymbolTable defined;       // Names followed by '(' outside any body
+    SymbolTable called;        // Names followed by '(' inside a body
+} StreamNames;
+
+typedef struct {
+    ParserContext *ctx;
+    const OptimizeOptions *optimize;
+    OutputBuffer *out;
+    StreamNames names;
+    SymbolTable generated;     // Names of the functions generated so far
+    ASTNode **pending;         // Parsed, waiting for callees defined further down
+    int pending_count;
+    int pending_capacity;
+    ASTNode **retained;        // Generated functions kept for their callers
+    int retained_capacity;
+    SymbolTable retained_names; // Name -> index in retained
+    ASTNode **callees;         // Retained functions the one being optimised calls
+    int callee_capacity;
+    int struct_count;          // Structs whose records were written
+    size_t resident_bytes;     // Arenas of the retained and pending functions
+    CompileStreamStats stats;
+} CompileStream;
+
+// One function's optimisation and generation (run on a larger stack when
+// the function is deep)
+typedef struct {
+    CompileStream *stream;
+    ASTNode *callees;          // NODE_PROGRAM of function and the functions it calls
+    ASTNode *function;
+} StreamJob;
+
+// Helper: lex the whole source once (without counting the tokens twice)
+// and rewind; a name followed by '(' at brace depth 0 is a definition,
+// anywhere else a call
+static void stream_scan_names(ParserContext *ctx, StreamNames *names)
+{
+    LexerMark start = ctx_lexer_mark(ctx);
+    struct CompileProfile *profile = ctx->profile;
+    InternId previous = INTERN_NONE;
+    int depth = 0;
+
+    ctx->profile = NULL;
+    ctx_advance(ctx);
+    while (!ctx_match(ctx, TOKEN_EOF)) {
+        if (ctx_match(ctx, TOKEN_BRACE_OPEN)) {
+            depth++;
+        } else if (ctx_match(ctx, TOKEN_BRACE_CLOSE) && depth > 0) {
+            depth--;
+        } else if (ctx_match(ctx, TOKEN_PARENTHESIS_OPEN) && previous != INTERN_NONE) {
+            symbol_define(depth == 0 ? &names->defined : &names->called, previous, 1);
+        }
+        previous = ctx_match(ctx, TOKEN_IDENTIFIER) ? ctx->current_token.id : INTERN_NONE;
+        ctx_advance(ctx);
+    }
+    ctx_lexer_reset_to(ctx, &start);
+    ctx->profile = profile;
+}
+
+// Helper: visit the name of every call in function's body other than a
+// call to itself; stops when visit returns 0
+static void stream_walk_calls(const ASTNode *function, int (*visit)(void *data, InternId callee),
+                              void *data)
+{
+    const ASTNode **stack = NULL;
+    int count = 0;
+    int capacity = 0;
+    int more = 1;
+
+    if (function->num_children > 0) {
+        capacity = function->num_children > 64 ? function->num_children : 64;
+        stack = (const ASTNode**)xrealloc(NULL, (size_t)capacity * sizeof(ASTNode*));
+        for (int child_idx = 0; child_idx < function->num_children; child_idx++) {
+            stack[count++] = function->children[child_idx];
+        }
+    }
+    while (count > 0 && more) {
+        const ASTNode *node = stack[--count];
+
+        if (!node) {
+            continue;
+        }
+        if (node->type == NODE_FUNC_CALL && node->value && function->value &&
+            strcmp(node->value, function->value) != 0) {
+            more = visit(data, intern_cstr(node->value));
+        }
+        if (count + node->num_children > capacity) {
+            capacity = (count + node->num_children) * 2;
+            stack = (const ASTNode**)xrealloc((void*)stack, (size_t)capacity * sizeof(ASTNode*));
+        }
+        for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+            stack[count++] = node->children[child_idx];
+        }
+    }
+    free((void*)stack);
+}
+
+typedef struct {
+    const CompileStream *stream;
+    int ready;
+} StreamReadiness;
+
+static int stream_check_callee(void *data, InternId callee)
+{
+    StreamReadiness *readiness = (StreamReadiness*)data;
+
+    readiness->ready = !symbol_lookup(&readiness->stream->names.defined, callee, NULL) ||
+                       symbol_lookup(&readiness->stream->generated, callee, NULL);
+    return readiness->ready;
+}
+
+// Helper: 1 once every function that function calls and the source
+// defines has been generated, so their bodies are final when it is
+static int stream_ready(const CompileStream *stream, const ASTNode *function)
+{
+    StreamReadiness readiness = { stream, 1 };
+
+    stream_walk_calls(function, stream_check_callee, &readiness);
+    return readiness.ready;
+}
+
+typedef struct {
+    CompileStream *stream;
+    SymbolTable seen;
+    int count;
+} StreamCallees;
+
+static int stream_add_callee(void *data, InternId callee)
+{
+    StreamCallees *callees = (StreamCallees*)data;
+    CompileStream *stream = callees->stream;
+    int index = 0;
+
+    if (symbol_lookup(&stream->retained_names, callee, &index) &&
+        !symbol_lookup(&callees->seen, callee, NULL)) {
+        symbol_define(&callees->seen, callee, 1);
+        if (callees->count + 1 >= stream->callee_capacity) {
+            stream->callees = (ASTNode**)grow_array(stream->callees, &stream->callee_capacity,
+                                                    STREAM_INITIAL_CALLEES, sizeof(ASTNode*));
+        }
+        stream->callees[callees->count++] = stream->retained[index];
+    }
+    return 1;
+}
+
+// Helper: the passes look callees up among the program's functions; a
+// program of just function and what it calls keeps that lookup from
+// growing with the number of functions retained so far
+static void stream_callee_program(CompileStream *stream, ASTNode *function, ASTNode *view)
+{
+    StreamCallees callees;
+
+    callees.stream = stream;
+    callees.count = 0;
+    symbol_table_init(&callees.seen);
+    stream_walk_calls(function, stream_add_callee, &callees);
+    symbol_table_free(&callees.seen);
+    if (callees.count + 1 > stream->callee_capacity) {
+        stream->callees = (ASTNode**)grow_array(stream->callees, &stream->callee_capacity,
+                                                STREAM_INITIAL_CALLEES, sizeof(ASTNode*));
+    }
+    stream->callees[callees.count++] = function;
+
+    memset(view, 0, sizeof(*view));
+    view->type = NODE_PROGRAM;
+    view->children = stream->callees;
+    view->num_children = callees.count;
+    view->capacity = callees.count;
+}
+
+static void* stream_run_job(void *argument)
+{
+    StreamJob *job = (StreamJob*)argument;
+    CompileStream *stream = job->stream;
+    ParserContext *ctx = stream->ctx;
+    Arena *previous = ast_use_arena(job->function->arena);
+
+    PROFILE_TIMER_START(ctx, optimize_timer);
+    optimize_function(job->callees, job->function, stream->optimize);
+    PROFILE_TIMER_STOP(ctx, optimize_timer, PROFILE_PHASE_OPTIMIZE);
+
+    PROFILE_TIMER_START(ctx, codegen_timer);
+    stream->struct_count = generate_vhdl_structs(ctx, stream->struct_count, stream->out);
+    generate_vhdl_function(ctx, job->function, stream->out);
+    PROFILE_TIMER_STOP(ctx, codegen_timer, PROFILE_PHASE_CODEGEN);
+
+    ast_use_arena(previous);
+    return NULL;
+}
+
+// Helper: the passes recurse once per tree level, like the whole-program
+// back end, so a deep function is handed to a thread with a larger stack
+static void stream_run(StreamJob *job)
+{
+    size_t stack_size = ast_stack_size(job->function);
+    pthread_attr_t attributes;
+    pthread_t worker;
+    int started = 0;
+
+    if (stack_size > 0 && pthread_attr_init(&attributes) == 0) {
+        started = pthread_attr_setstacksize(&attributes, stack_size) == 0 &&
+                  pthread_create(&worker, &attributes, stream_run_job, job) == 0;
+        pthread_attr_destroy(&attributes);
+    }
+    if (started) {
+        pthread_join(worker, NULL);
+    } else {
+        stream_run_job(job);
+    }
+}
+
+// Generate function (a child of program), then release it unless a body
+// calls it
+static void stream_generate(CompileStream *stream, ASTNode *program, ASTNode *function)
+{
+    ASTNode callees;
+    StreamJob job = { stream, &callees, function };
+    Arena *arena = function->arena;
+
+    // The passes allocate too, so it is counted once they are done
+    stream->resident_bytes -= arena->bytes_reserved;
+    stream_callee_program(stream, function, &callees);
+    stream_run(&job);
+    if (stream->resident_bytes + arena->bytes_reserved > stream->stats.peak_ast_bytes) {
+        stream->stats.peak_ast_bytes = stream->resident_bytes + arena->bytes_reserved;
+    }
+    stream->stats.function_count++;
+    stream->stats.node_count += profile_count_nodes(function);
+    if (function->value) {
+        symbol_define(&stream->generated, intern_cstr(function->value), 1);
+    }
+
+    if (function->value && symbol_lookup(&stream->names.called, intern_cstr(function->value), NULL)) {
+        if (stream->stats.retained_count == stream->retained_capacity) {
+            stream->retained = (ASTNode**)grow_array(stream->retained, &stream->retained_capacity,
+                                                     STREAM_INITIAL_FUNCTIONS, sizeof(ASTNode*));
+        }
+        symbol_define(&stream->retained_names, intern_cstr(function->value), stream->stats.retained_count);
+        stream->retained[stream->stats.retained_count++] = function;
+        stream->resident_bytes += arena->bytes_reserved;
+        return;
+    }
+    for (int child_idx = 0; child_idx < program->num_children; child_idx++) {
+        if (program->children[child_idx] == function) {
+            memmove(&program->children[child_idx], &program->children[child_idx + 1],
+                    (size_t)(program->num_children - child_idx - 1) * sizeof(ASTNode*));
+            program->num_children--;
+            break;
+        }
+    }
+    arena_release(arena);
+    free(arena);
+}
+
+// Helper: generate the waiting functions whose callees are now complete,
+// in source order, until none is left that can go
+static void stream_drain(CompileStream *stream, ASTNode *program, int force)
+{
+    int progress = 1;
+
+    while (progress) {
+        progress = 0;
+        for (int index = 0; index < stream->pending_count; index++) {
+            ASTNode *function = stream->pending[index];
+
+            if (!force && !stream_ready(stream, function)) {
+                continue;
+            }
+            memmove(&stream->pending[index], &stream->pending[index + 1],
+                    (size_t)(stream->pending_count - index - 1) * sizeof(ASTNode*));
+            stream->pending_count--;
+            stream_generate(stream, program, function);
+            progress = 1;
+            break;
+        }
+    }
+}
+
+static void stream_declaration(void *data, ASTNode *program, ASTNode *declaration, Arena *arena)
+{
+    CompileStream *stream = (CompileStream*)data;
+
+    // The struct table keeps the layout; records are written before the
+    // next function
+    if (declaration->type != NODE_FUNCTION_DECL) {
+        arena_release(arena);
+        free(arena);
+        return;
+    }
+
+    add_child(program, declaration);
+    if (stream->pending_count == stream->pending_capacity) {
+        stream->pending = (ASTNode**)grow_array(stream->pending, &stream->pending_capacity,
+                                                STREAM_INITIAL_FUNCTIONS, sizeof(ASTNode*));
+    }
+    stream->pending[stream->pending_count++] = declaration;
+    stream->resident_bytes += arena->bytes_reserved;
+    stream_drain(stream, program, 0);
+}
+
+int compile_stream(ParserContext *ctx, const OptimizeOptions *optimize, OutputBuffer *out,
+                   CompileStreamStats *stats)
+{
+    CompileStream stream;
+    ASTNode *program = NULL;
+
+    memset(&stream, 0, sizeof(stream));
+    stream.ctx = ctx;
+    stream.optimize = optimize;
+    stream.out = out;
+    symbol_table_init(&stream.names.defined);
+    symbol_table_init(&stream.names.called);
+    symbol_table_init(&stream.generated);
+    symbol_table_init(&stream.retained_names);
+
+    stream_scan_names(ctx, &stream.names);
+    emit_vhdl_header(out);
+    program = parse_program_stream(ctx, stream_declaration, &stream);
+
+    // Callees that never came (mutual recursion) no longer hold anyone up
+    if (program) {
+        stream_drain(&stream, program, 1);
+        stream.struct_count = generate_vhdl_structs(ctx, stream.struct_count, out);
+    }
+    for (int index = 0; index < stream.pending_count; index++) {
+        arena_release(stream.pending[index]->arena);
+        free(stream.pending[index]->arena);
+    }
+    for (int index = 0; index < stream.stats.retained_count; index++) {
+        Arena *arena = stream.retained[index]->arena;
+
+        arena_release(arena);
+        free(arena);
+    }
+    if (program) {
+        program->num_children = 0;
+    }
+
+    if (stats) {
+        *stats = stream.stats;
+    }
+    free(stream.pending);
+    free(stream.retained);
+    free(stream.callees);
+    symbol_table_free(&stream.retained_names);
+    symbol_table_free(&stream.generated);
+    symbol_table_free(&stream.names.called);
+    symbol_table_free(&stream.names.defined);
+    return program != NULL;
+}
@@ -0,0 +1,334 @@
+// VHDL Code Generator - Incremental Compilation Cache Implementation
+// -------------------------------------------------------------
+// The canonical input of a function is the serialized function subtree in
+// preorder (node kind, token kind and text, value, array size and child
+// count of every node), then each struct the subtree declares something
+// with, the subtrees of its callees and the options. Line numbers and
+// offsets are left out, so moving a function or editing another one keeps
+// its entry. Entries are files <key>.vhdl, named by the 64-bit FNV-1a hash
+// of that input:
+//
+//   compi-cache <input length>\n<canonical input><generated text>
+//
+// A hit requires the stored input to match byte for byte, so two inputs
+// with the same hash never share text.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_cache.h"
+#include "symbol_structs.h"
+#include "utils.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_PATH_SIZE 4096
+#define CACHE_TEMPORARY_SUFFIX ".XXXXXX" // mkstemp template after an entry path
+#define CACHE_FNV_OFFSET 14695981039346656037ull
+#define CACHE_FNV_PRIME 1099511628211ull
+#define CACHE_ENTRY_MAGIC "compi-cache "
+#define CACHE_ENTRY_MODE 0644
+
+typedef struct {
+    CacheInput *input;
+    const ASTNode *program;        // Where callees are looked up
+    const SymbolTable *callees;    // Function name -> index among program's children
+    const ASTNode **functions;     // Functions already hashed (calls may recurse)
+    int function_count;
+    int function_capacity;
+    unsigned char *structs;        // Struct index -> already hashed
+    int struct_total;
+} CacheKey;
+
+static void cache_mix_bytes(CacheKey *key, const void *data, size_t length)
+{
+    const unsigned char *bytes = (const unsigned char*)data;
+
+    out_write(&key->input->canonical, (const char*)data, length);
+    for (size_t index = 0; index < length; ++index)
+    {
+        key->input->hash = (key->input->hash ^ bytes[index]) * CACHE_FNV_PRIME;
+    }
+}
+
+static void cache_mix_int(CacheKey *key, long value)
+{
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%ld;", value);
+
+    cache_mix_bytes(key, text, (size_t)length);
+}
+
+// Text with its terminator, so "ab" + "c" and "a" + "bc" differ; NULL differs from ""
+static void cache_mix_text(CacheKey *key, const char *text)
+{
+    if (text == NULL)
+    {
+        cache_mix_bytes(key, "\x01", 1);
+        return;
+    }
+    cache_mix_bytes(key, text, strlen(text) + 1);
+}
+
+// -------------------------------------------------------------
+// Dependencies
+// -------------------------------------------------------------
+static void cache_mix_struct(CacheKey *key, int struct_index)
+{
+    const StructInfo *info = struct_info_at(struct_index);
+
+    if (info == NULL || struct_index >= key->struct_total || key->structs[struct_index])
+    {
+        return;
+    }
+    key->structs[struct_index] = 1;
+    cache_mix_text(key, info->name);
+    cache_mix_int(key, info->field_count);
+    for (int field_index = 0; field_index < info->field_count; ++field_index)
+    {
+        int nested = find_struct_index(info->fields[field_index].field_type);
+
+        cache_mix_text(key, info->fields[field_index].field_name);
+        cache_mix_text(key, info->fields[field_index].field_type);
+        if (nested >= 0)
+        {
+            cache_mix_struct(key, nested);
+        }
+    }
+}
+
+static void cache_mix_function(CacheKey *key, const ASTNode *function);
+
+static void cache_mix_callee(CacheKey *key, const char *name)
+{
+    int child_index = -1;
+
+    if (key->program == NULL || name == NULL ||
+        !symbol_lookup(key->callees, intern_find(name, strlen(name)), &child_index))
+    {
+        return;
+    }
+    cache_mix_function(key, key->program->children[child_index]);
+}
+
+static void cache_mix_node(CacheKey *key, const ASTNode *node)
+{
+    int struct_index = -1;
+
+    if (node == NULL)
+    {
+        cache_mix_int(key, -1);
+        return;
+    }
+    cache_mix_int(key, node->type);
+    cache_mix_int(key, node->token.type);
+    cache_mix_text(key, token_text(node->token));
+    cache_mix_text(key, node->value);
+    cache_mix_int(key, node->array_size);
+    cache_mix_int(key, node->num_children);
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        cache_mix_node(key, node->children[child_index]);
+    }
+
+    // Dependencies after the structure, so they cannot alias node text.
+    // Struct-typed declarations (parameters, locals, the return type) carry
+    // the struct name as their token, so every layout the function can
+    // reach is hashed here, nested fields included.
+    struct_index = find_struct_index_id(node->token.id);
+    if (struct_index >= 0)
+    {
+        cache_mix_struct(key, struct_index);
+    }
+    if (node->type == NODE_FUNC_CALL)
+    {
+        cache_mix_callee(key, node->value);
+    }
+}
+
+static void cache_mix_function(CacheKey *key, const ASTNode *function)
+{
+    for (int function_index = 0; function_index < key->function_count; ++function_index)
+    {
+        if (key->functions[function_index] == function)
+        {
+            cache_mix_int(key, function_index);
+            return;
+        }
+    }
+    if (key->function_count == key->function_capacity)
+    {
+        key->function_capacity = key->function_capacity ? key->function_capacity * 2 : 8;
+        key->functions = (const ASTNode**)xrealloc((void*)key->functions,
+                                                     (size_t)key->function_capacity * sizeof(ASTNode*));
+    }
+    key->functions[key->function_count++] = function;
+    cache_mix_node(key, function);
+}
+
+// Every field that shapes generated text (the cache directory does not)
+static void cache_mix_options(CacheKey *key, const CodegenOptions *options)
+{
+    cache_mix_int(key, options->pipeline_stages);
+    cache_mix_int(key, options->share_limit);
+    cache_mix_int(key, options->share_adders);
+    cache_mix_int(key, options->unroll_limit);
+    cache_mix_int(key, options->fsm);
+    cache_mix_int(key, options->bram_threshold);
+    cache_mix_int(key, options->narrow_widths);
+    cache_mix_int(key, options->fixed_integer_bits);
+    cache_mix_int(key, options->fixed_fraction_bits);
+    cache_mix_int(key, options->combinational);
+    cache_mix_int(key, options->strength_reduce);
+    cache_mix_int(key, options->eliminate_common);
+    cache_mix_int(key, options->reset);
+}
+
+void cache_index_functions(const ASTNode *program, SymbolTable *functions)
+{
+    for (int child_index = 0; child_index < program->num_children; ++child_index)
+    {
+        const ASTNode *child = program->children[child_index];
+        InternId name_id = INTERN_NONE;
+
+        if (child->type != NODE_FUNCTION_DECL || child->value == NULL)
+        {
+            continue;
+        }
+        // The first definition of a name is the one calls resolve to
+        name_id = intern_cstr(child->value);
+        if (!symbol_lookup(functions, name_id, NULL))
+        {
+            symbol_define(functions, name_id, child_index);
+        }
+    }
+}
+
+void cache_input_build(CacheInput *input, const ASTNode *function, const SymbolTable *functions,
+                       const CodegenOptions *options)
+{
+    CacheKey key;
+
+    memset(&key, 0, sizeof(key));
+    input->hash = CACHE_FNV_OFFSET;
+    output_buffer_init(&input->canonical, NULL);
+    key.input = input;
+    key.program = function->parent;
+    key.callees = functions;
+    key.struct_total = struct_count();
+    key.structs = (unsigned char*)xrealloc(NULL, (size_t)key.struct_total + 1);
+    memset(key.structs, 0, (size_t)key.struct_total + 1);
+
+    cache_mix_int(&key, CACHE_FORMAT_VERSION);
+    cache_mix_function(&key, function);
+    cache_mix_options(&key, options);
+
+    free((void*)key.functions);
+    free(key.structs);
+}
+
+void cache_input_free(CacheInput *input)
+{
+    output_buffer_free(&input->canonical);
+}
+
+// -------------------------------------------------------------
+// Entries
+// -------------------------------------------------------------
+// Entries are readable by everyone the umask allows, like any other output
+// file; mkstemp alone would leave them private to their writer
+static pthread_once_t s_mode_once = PTHREAD_ONCE_INIT;
+static mode_t s_entry_mode = CACHE_ENTRY_MODE;
+
+static void cache_read_umask(void)
+{
+    // The umask can only be read by replacing it
+    mode_t mask = umask(0);
+
+    umask(mask);
+    s_entry_mode = CACHE_ENTRY_MODE & ~mask;
+}
+
+int cache_load(const char *directory, const CacheInput *input, OutputBuffer *out)
+{
+    char path[CACHE_PATH_SIZE];
+    FILE *entry = NULL;
+    char *text = NULL;
+    char *header_end = NULL;
+    long length = 0;
+    unsigned long long input_length = 0;
+    size_t body = 0;
+    int loaded = 0;
+
+    snprintf(path, sizeof(path), "%s/%016" PRIx64 ".vhdl", directory, input->hash);
+    entry = fopen(path, "rb");
+    if (entry == NULL)
+    {
+        return 0;
+    }
+    if (fseek(entry, 0, SEEK_END) == 0 && (length = ftell(entry)) > 0 && fseek(entry, 0, SEEK_SET) == 0)
+    {
+        text = (char*)xrealloc(NULL, (size_t)length + 1);
+        if (fread(text, 1, (size_t)length, entry) == (size_t)length)
+        {
+            text[length] = '\0';
+            header_end = strchr(text, '\n');
+        }
+        if (header_end != NULL && strncmp(text, CACHE_ENTRY_MAGIC, strlen(CACHE_ENTRY_MAGIC)) == 0)
+        {
+            input_length = strtoull(text + strlen(CACHE_ENTRY_MAGIC), NULL, 10);
+            body = (size_t)(header_end + 1 - text);
+        }
+        // Same hash is not enough: the whole input must match
+        if (body > 0 && input_length == input->canonical.length &&
+            (size_t)length - body >= input->canonical.length &&
+            memcmp(text + body, input->canonical.data, input->canonical.length) == 0)
+        {
+            body += input->canonical.length;
+            out_write(out, text + body, (size_t)length - body);
+            loaded = 1;
+        }
+        free(text);
+    }
+    fclose(entry);
+    return loaded;
+}
+
+void cache_store(const char *directory, const CacheInput *input, const char *text, size_t length)
+{
+    char path[CACHE_PATH_SIZE];
+    char temporary[CACHE_PATH_SIZE + sizeof(CACHE_TEMPORARY_SUFFIX)];
+    FILE *entry = NULL;
+    int descriptor = -1;
+    int written = 0;
+
+    pthread_once(&s_mode_once, cache_read_umask);
+    snprintf(path, sizeof(path), "%s/%016" PRIx64 ".vhdl", directory, input->hash);
+    // Written next to the entry under a name no other thread or process
+    // holds, then renamed over it in one step
+    snprintf(temporary, sizeof(temporary), "%s" CACHE_TEMPORARY_SUFFIX, path);
+    descriptor = mkstemp(temporary);
+    if (descriptor < 0)
+    {
+        return;
+    }
+    entry = (fchmod(descriptor, s_entry_mode) == 0) ? fdopen(descriptor, "wb") : NULL;
+    if (entry == NULL)
+    {
+        close(descriptor);
+        remove(temporary);
+        return;
+    }
+    written = (fprintf(entry, CACHE_ENTRY_MAGIC "%zu\n", input->canonical.length) > 0);
+    written = (fwrite(input->canonical.data, 1, input->canonical.length, entry) ==
+               input->canonical.length) && written;
+    written = (fwrite(text, 1, length, entry) == length) && written;
+    written = (fclose(entry) == 0) && written;
+    if (!written || rename(temporary, path) != 0)
+    {
+        remove(temporary);
+    }
+}
@@ -0,0 +1,63 @@
+// VHDL Code Generator - Incremental Compilation Cache
+// -------------------------------------------------------------
+// Purpose: Key the entity/architecture text of each function by a hash of
+//          everything it is generated from, and keep it in a directory so
+//          unchanged functions are spliced in instead of regenerated
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_CACHE_H
+#define CODEGEN_VHDL_CACHE_H
+
+#include <stdint.h>
+#include "output_buffer.h"
+#include "astnode.h"
+#include "codegen_vhdl.h"
+#include "symbol_table.h"
+
+// Bump when the generated text or the entry layout changes for the same input
+#define CACHE_FORMAT_VERSION 3
+
+/**
+ * Everything the text of one function is generated from: its subtree
+ * (source positions left out), the struct layouts it uses, the functions
+ * it calls (transitively, as they are inlined or instantiated) and every
+ * option that shapes the output
+ */
+typedef struct {
+    uint64_t hash;             // FNV-1a of canonical; names the entry
+    OutputBuffer canonical;    // Serialized input, compared on every hit
+} CacheInput;
+
+/**
+ * Bind the name of every function in program to its child index, so
+ * callees are found without scanning the program
+ */
+void cache_index_functions(const ASTNode *program, SymbolTable *functions);
+
+/**
+ * Serialize and hash the input of function
+ *
+ * @param functions Index of function's program from cache_index_functions()
+ */
+void cache_input_build(CacheInput *input, const ASTNode *function, const SymbolTable *functions,
+                       const CodegenOptions *options);
+
+void cache_input_free(CacheInput *input);
+
+/**
+ * Append the text cached for input in directory to out
+ *
+ * @return 1 on a hit, 0 if nothing usable is cached or the stored input
+ *         differs (out is untouched)
+ */
+int cache_load(const char *directory, const CacheInput *input, OutputBuffer *out);
+
+/**
+ * Store length bytes of text for input. The file is written under a
+ * temporary name, given mode 0644 less the umask and renamed, so concurrent
+ * compilers never read a partial entry; failures only cost the next
+ * compilation a regeneration.
+ */
+void cache_store(const char *directory, const CacheInput *input, const char *text, size_t length);
+
+#endif // CODEGEN_VHDL_CACHE_H
@@ -0,0 +1,249 @@
+// VHDL Code Generator - Call Instantiation Implementation
+// -------------------------------------------------------------
+// Every C function is generated as an entity, so a call that survives
+// inlining becomes a component instance of the callee: the arguments are
+// driven onto signals outside the process, and the caller reads the
+// instance's (registered) result port where the call stood. Each call site
+// gets its own instance; nested calls chain through their result signals.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_calls.h"
+#include "codegen_vhdl_constants.h"
+#include "symbol_structs.h"
+#include "utils.h"
+#include "intern.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define CALL_NAME_SIZE 256
+
+// -------------------------------------------------------------
+// Call plan
+// -------------------------------------------------------------
+// Helper: ports of the callee, or -1 when an array parameter has no port to map
+static int parameter_count(const ASTNode *function)
+{
+    int count = 0;
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        const ASTNode *child = function->children[child_index];
+
+        if (child->type == NODE_VAR_DECL && child->array_size > 0)
+        {
+            return -1;
+        }
+        count += (child->type == NODE_VAR_DECL);
+    }
+    return count;
+}
+
+static ASTNode* call_output_reference(CallPlan *plan, const CallInstance *instance)
+{
+    char name[CALL_NAME_SIZE];
+    Arena *previous = ast_use_arena(&plan->scratch);
+    ASTNode *reference = create_node(NODE_EXPRESSION);
+
+    snprintf(name, sizeof(name), "%s_%d_result", instance->callee->value, instance->number);
+    set_node_value(reference, name);
+    ast_use_arena(previous);
+    return reference;
+}
+
+static void call_add_instance(CallPlan *plan, ASTNode *function, ASTNode *parent, int child_index)
+{
+    ASTNode *call = parent->children[child_index];
+    ASTNode *callee = find_callee(function, call);
+    CallInstance *instance = NULL;
+    int number = 0;
+
+    if (callee == NULL || callee == function || parameter_count(callee) != call->num_children)
+    {
+        return;
+    }
+
+    // Numbered per callee, in the order the calls appear
+    for (int instance_index = 0; instance_index < plan->instance_count; ++instance_index)
+    {
+        number += (plan->instances[instance_index].callee == callee);
+    }
+
+    if (plan->instance_count == plan->instance_capacity)
+    {
+        plan->instance_capacity = plan->instance_capacity ? plan->instance_capacity * 2 : 4;
+        plan->instances = (CallInstance*)xrealloc(plan->instances,
+                                                   (size_t)plan->instance_capacity * sizeof(CallInstance));
+    }
+    instance = &plan->instances[plan->instance_count++];
+    memset(instance, 0, sizeof(*instance));
+    instance->call = call;
+    instance->parent = parent;
+    instance->child_index = child_index;
+    instance->callee = callee;
+    instance->number = number;
+    instance->output = call_output_reference(plan, instance);
+}
+
+static void call_collect(CallPlan *plan, ASTNode *function, ASTNode *node)
+{
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        ASTNode *child = node->children[child_index];
+
+        if (child == NULL)
+        {
+            continue;
+        }
+        // A call made as a statement only matters for its side effects
+        if (child->type == NODE_FUNC_CALL &&
+            !(node->type == NODE_STATEMENT && node->token.id != INTERN_KW_RETURN))
+        {
+            call_add_instance(plan, function, node, child_index);
+        }
+        call_collect(plan, function, child);
+    }
+}
+
+int call_plan_function(ASTNode *function, CallPlan *plan)
+{
+    memset(plan, 0, sizeof(*plan));
+    arena_init(&plan->scratch, 0);
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        if (function->children[child_index]->type == NODE_STATEMENT)
+        {
+            call_collect(plan, function, function->children[child_index]);
+        }
+    }
+    return plan->instance_count;
+}
+
+void call_plan_free(CallPlan *plan)
+{
+    free(plan->instances);
+    arena_release(&plan->scratch);
+    memset(plan, 0, sizeof(*plan));
+}
+
+void call_bind(CallPlan *plan)
+{
+    for (int instance_index = 0; instance_index < plan->instance_count; ++instance_index)
+    {
+        CallInstance *instance = &plan->instances[instance_index];
+        instance->parent->children[instance->child_index] = instance->output;
+    }
+}
+
+void call_unbind(CallPlan *plan)
+{
+    for (int instance_index = 0; instance_index < plan->instance_count; ++instance_index)
+    {
+        CallInstance *instance = &plan->instances[instance_index];
+        instance->parent->children[instance->child_index] = instance->call;
+    }
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Helper: VHDL type of a port declared like declaration (parameter or function)
+static void emit_port_type(const ASTNode *declaration, OutputBuffer *out)
+{
+    if (declaration->token.id == INTERN_NONE)
+    {
+        out_printf(out, "std_logic_vector(%d downto 0)", VHDL_BIT_WIDTH - 1);
+    }
+    else if (find_struct_index_id(declaration->token.id) >= 0)
+    {
+        out_printf(out, "%s_t", token_text(declaration->token));
+    }
+    else
+    {
+        out_puts(out, ctype_to_vhdl(token_text(declaration->token)));
+    }
+}
+
+void emit_call_signals(const CallPlan *plan, OutputBuffer *out)
+{
+    for (int instance_index = 0; instance_index < plan->instance_count; ++instance_index)
+    {
+        const CallInstance *instance = &plan->instances[instance_index];
+        const ASTNode *callee = instance->callee;
+
+        for (int child_index = 0; child_index < callee->num_children; ++child_index)
+        {
+            const ASTNode *parameter = callee->children[child_index];
+
+            if (parameter->type == NODE_VAR_DECL)
+            {
+                out_printf(out, "  signal %s_%d_%s : ", callee->value, instance->number, parameter->value);
+                emit_port_type(parameter, out);
+                out_puts(out, ";\n");
+            }
+        }
+        out_printf(out, "  signal %s_%d_result : ", callee->value, instance->number);
+        emit_port_type(callee, out);
+        out_puts(out, ";\n");
+    }
+}
+
+void emit_call_instances(const CallPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    for (int instance_index = 0; instance_index < plan->instance_count; ++instance_index)
+    {
+        const CallInstance *instance = &plan->instances[instance_index];
+        const ASTNode *callee = instance->callee;
+        int argument_index = 0;
+
+        out_printf(out, "  -- Call: %s\n", callee->value);
+        for (int child_index = 0; child_index < callee->num_children; ++child_index)
+        {
+            const ASTNode *parameter = callee->children[child_index];
+
+            if (parameter->type == NODE_VAR_DECL)
+            {
+                out_printf(out, "  %s_%d_%s <= ", callee->value, instance->number, parameter->value);
+                node_generator(instance->call->children[argument_index++], out);
+                out_puts(out, ";\n");
+            }
+        }
+
+        out_printf(out, "  %s_%d_inst : entity work.%s\n", callee->value, instance->number, callee->value);
+        out_puts(out, "    port map (\n");
+        if (instance->has_clock)
+        {
+            out_puts(out, "      clk => clk,\n");
+            out_puts(out, "      reset => reset,\n");
+        }
+        if (instance->has_valid)
+        {
+            out_puts(out, "      valid_in => '1',\n");
+        }
+        if (instance->has_start)
+        {
+            out_puts(out, "      start => '1',\n");
+        }
+        for (int child_index = 0; child_index < callee->num_children; ++child_index)
+        {
+            const ASTNode *parameter = callee->children[child_index];
+
+            if (parameter->type == NODE_VAR_DECL)
+            {
+                out_printf(out, "      %s => %s_%d_%s,\n", parameter->value,
+                           callee->value, instance->number, parameter->value);
+            }
+        }
+        if (instance->has_valid)
+        {
+            out_puts(out, "      valid_out => open,\n");
+        }
+        if (instance->has_start)
+        {
+            out_puts(out, "      done => open,\n");
+        }
+        out_printf(out, "      result => %s_%d_result\n", callee->value, instance->number);
+        out_puts(out, "    );\n");
+    }
+}
@@ -0,0 +1,64 @@
+// VHDL Code Generator - Call Instantiation
+// -------------------------------------------------------------
+// Purpose: Lower the calls the inliner leaves to instances of the callee
+//          entity: argument signals driven concurrently, the instance's
+//          result port read wherever the call stood
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_CALLS_H
+#define CODEGEN_VHDL_CALLS_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "arena.h"
+
+// -------------------------------------------------------------
+// Call plan
+// -------------------------------------------------------------
+typedef struct {
+    ASTNode *call;             // NODE_FUNC_CALL
+    ASTNode *parent;           // Node whose child it is (swapped for the result)
+    int child_index;
+    ASTNode *callee;           // NODE_FUNCTION_DECL of the same program
+    int number;                // Signals are named <callee>_<number>_<port>
+    int has_start;             // Callee is a state machine (start/done ports)
+    int has_valid;             // Callee has valid_in/valid_out ports
+    int has_clock;             // Callee has clk/reset ports (not combinational)
+    ASTNode *output;           // Reference to <callee>_<number>_result, swapped in while bound
+} CallInstance;
+
+typedef struct {
+    CallInstance *instances;
+    int instance_count;
+    int instance_capacity;
+    Arena scratch;             // Result reference nodes
+} CallPlan;
+
+/**
+ * Give every call of function to another function of its program (with a
+ * matching argument count) an instance of the callee's entity. Calls made
+ * as statements have no result to read and are left out, as are recursive
+ * calls. The handshake flags are left 0 for the caller to fill in.
+ *
+ * @return Number of instances (plan still needs call_plan_free)
+ */
+int call_plan_function(ASTNode *function, CallPlan *plan);
+
+void call_plan_free(CallPlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Architecture declarations of the argument and result signals
+void emit_call_signals(const CallPlan *plan, OutputBuffer *out);
+
+// Argument assignments and one entity instance per call (call after
+// call_bind, so arguments read the results of nested calls); handshake
+// inputs are tied active, outputs left open
+void emit_call_instances(const CallPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+// Point every call at its instance's result (undo with call_unbind)
+void call_bind(CallPlan *plan);
+void call_unbind(CallPlan *plan);
+
+#endif // CODEGEN_VHDL_CALLS_H
@@ -0,0 +1,270 @@
+// VHDL Code Generator - Combinational Functions Implementation
+// -------------------------------------------------------------
+// A function whose body only computes values feeds its result straight
+// from its inputs: every local is one signal with one concurrent driver,
+// and the return expression drives the result port. Locals must be read
+// only after their single assignment, so the assignments form an acyclic
+// network (x = x / 42 would be a combinational loop). Calls are allowed
+// when the callee is combinational too; its instance has no clock, so the
+// whole chain settles within the caller's cycle.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_combinational.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_statements.h"
+#include "codegen_vhdl_fixed.h"
+#include "codegen_vhdl_widths.h"
+#include "symbol_structs.h"
+#include "symbol_table.h"
+#include "intern.h"
+#include "utils.h"
+#include <string.h>
+
+// Callee chains deeper than this are not followed (and end mutual recursion)
+#define MAX_COMBINATIONAL_DEPTH 8
+
+typedef struct {
+    const ASTNode *function;
+    int auto_detect;
+    int depth;
+    SymbolTable ready;         // Parameters and locals already assigned
+    SymbolTable pending;       // Locals declared without a value
+} CombinationalCheck;
+
+static int combinational_check(const ASTNode *function, int auto_detect, int depth);
+
+// -------------------------------------------------------------
+// Helper: "#pragma compi combinational [off]" on the first statement
+// (1 = requested, -1 = refused, 0 = not given)
+// -------------------------------------------------------------
+static int combinational_pragma(const ASTNode *function)
+{
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        const ASTNode *child = function->children[child_index];
+        const char *arguments = NULL;
+
+        if (child->type != NODE_STATEMENT)
+        {
+            continue;
+        }
+        arguments = find_node_pragma(child, "combinational");
+        if (arguments == NULL)
+        {
+            return 0;
+        }
+        return (strncmp(arguments, "off", 3) == 0) ? -1 : 1;
+    }
+    return 0;
+}
+
+// Helper: a scalar of a built-in type (structs and arrays need records and memories)
+static int is_scalar_port(const ASTNode *declaration)
+{
+    return declaration->value != NULL && declaration->array_size == 0 &&
+           declaration->token.type == TOKEN_KEYWORD && declaration->token.id != INTERN_KW_VOID &&
+           find_struct_index_id(declaration->token.id) < 0;
+}
+
+// -------------------------------------------------------------
+// Eligibility
+// -------------------------------------------------------------
+static int combinational_expression(CombinationalCheck *check, const ASTNode *node)
+{
+    const char *name = NULL;
+    const ASTNode *callee = NULL;
+
+    if (node->type == NODE_EXPRESSION)
+    {
+        name = identifier_name(node);
+        return node->value != NULL && node->num_children == 0 &&
+               (name == NULL || symbol_lookup(&check->ready, intern_cstr(name), NULL));
+    }
+    if (node->type == NODE_FUNC_CALL)
+    {
+        callee = find_callee(check->function, node);
+        if (callee == NULL || callee == check->function ||
+            !combinational_check(callee, check->auto_detect, check->depth + 1))
+        {
+            return 0;
+        }
+    }
+    else if (node->type != NODE_BINARY_EXPR && node->type != NODE_UNARY_EXPR)
+    {
+        return 0; // Array elements and struct fields
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (!combinational_expression(check, node->children[child_index]))
+        {
+            return 0;
+        }
+    }
+    return node->value != NULL;
+}
+
+static int combinational_statement(CombinationalCheck *check, const ASTNode *construct)
+{
+    const char *name = NULL;
+    InternId name_id = INTERN_NONE;
+
+    if (construct->type == NODE_VAR_DECL)
+    {
+        name_id = intern_cstr(construct->value ? construct->value : "");
+        if (!is_scalar_port(construct) || construct->num_children > 1 ||
+            symbol_lookup(&check->ready, name_id, NULL) || symbol_lookup(&check->pending, name_id, NULL))
+        {
+            return 0;
+        }
+        if (construct->num_children == 0)
+        {
+            symbol_define(&check->pending, name_id, 1);
+            return 1;
+        }
+        if (!combinational_expression(check, construct->children[FIRST_CHILD_INDEX]))
+        {
+            return 0;
+        }
+        symbol_define(&check->ready, name_id, 1);
+        return 1;
+    }
+
+    // The one assignment of a local declared without a value
+    if (construct->type != NODE_ASSIGNMENT || construct->num_children != 2 ||
+        (name = identifier_name(construct->children[FIRST_CHILD_INDEX])) == NULL ||
+        construct->children[FIRST_CHILD_INDEX]->value[0] == '-')
+    {
+        return 0;
+    }
+    name_id = intern_cstr(name);
+    if (!symbol_lookup(&check->pending, name_id, NULL) || symbol_lookup(&check->ready, name_id, NULL) ||
+        !combinational_expression(check, construct->children[FIRST_CHILD_INDEX + 1]))
+    {
+        return 0;
+    }
+    symbol_define(&check->ready, name_id, 1);
+    return 1;
+}
+
+static int combinational_body(CombinationalCheck *check)
+{
+    const ASTNode *function = check->function;
+    int returned = 0;
+
+    if (function->token.type != TOKEN_KEYWORD || function->token.id == INTERN_KW_VOID ||
+        find_struct_index_id(function->token.id) >= 0)
+    {
+        return 0;
+    }
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        const ASTNode *child = function->children[child_index];
+
+        if (child->type == NODE_VAR_DECL)
+        {
+            if (!is_scalar_port(child))
+            {
+                return 0;
+            }
+            symbol_define(&check->ready, intern_cstr(child->value), 1);
+            continue;
+        }
+        // Nothing may follow the return
+        if (child->type != NODE_STATEMENT || child->num_children != 1 || returned)
+        {
+            return 0;
+        }
+        if (child->token.id == INTERN_KW_RETURN)
+        {
+            if (!combinational_expression(check, child->children[FIRST_CHILD_INDEX]))
+            {
+                return 0;
+            }
+            returned = 1;
+        }
+        else if (!combinational_statement(check, child->children[FIRST_CHILD_INDEX]))
+        {
+            return 0;
+        }
+    }
+    return returned;
+}
+
+static int combinational_check(const ASTNode *function, int auto_detect, int depth)
+{
+    CombinationalCheck check;
+    int request = combinational_pragma(function);
+    int eligible = 0;
+
+    if (depth >= MAX_COMBINATIONAL_DEPTH || request < 0 || (request == 0 && !auto_detect))
+    {
+        return 0;
+    }
+
+    memset(&check, 0, sizeof(check));
+    check.function = function;
+    check.auto_detect = auto_detect;
+    check.depth = depth;
+    symbol_table_init(&check.ready);
+    symbol_table_init(&check.pending);
+    eligible = combinational_body(&check);
+    symbol_table_free(&check.ready);
+    symbol_table_free(&check.pending);
+    return eligible;
+}
+
+int combinational_function(const ASTNode *function, int auto_detect)
+{
+    return combinational_check(function, auto_detect, 0);
+}
+
+int combinational_requested(const ASTNode *function)
+{
+    return combinational_pragma(function) > 0;
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+void emit_combinational_body(ASTNode *function, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+        ASTNode *construct = NULL;
+
+        if (child->type != NODE_STATEMENT || child->num_children != 1)
+        {
+            continue;
+        }
+        construct = child->children[FIRST_CHILD_INDEX];
+
+        if (child->token.id == INTERN_KW_RETURN)
+        {
+            out_puts(out, INDENT_LEVEL_1);
+            out_puts(out, "result <= ");
+            // Converted to or from the fixed-point format of the result first
+            if (!emit_fixed_store(construct, NULL, 0, out, node_generator))
+            {
+                int is_signed = 0;
+                int width = width_of_result(&is_signed);
+
+                emit_width_fitted(construct, width, is_signed, out, node_generator);
+            }
+            out_puts(out, ";\n");
+        }
+        else if (construct->type == NODE_VAR_DECL)
+        {
+            emit_variable_initializer(construct, out, INDENT_LEVEL_1, node_generator);
+        }
+        else
+        {
+            // The assignment emitter indents twice; indent once here instead
+            out_puts(out, INDENT_LEVEL_1);
+            emit_variable_assignment(construct, out, INDENT_LEVEL_0, node_generator);
+        }
+    }
+}
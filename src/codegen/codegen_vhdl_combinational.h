@@ -0,0 +1,30 @@
+// VHDL Code Generator - Combinational Functions
+// -------------------------------------------------------------
+// Purpose: Emit pure straight-line functions as concurrent signal
+//          assignments, with no clock, reset or result register, so a
+//          call costs no cycle and composes into larger combinational paths
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_COMBINATIONAL_H
+#define CODEGEN_VHDL_COMBINATIONAL_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+
+/**
+ * Whether function is generated combinationally: "#pragma compi
+ * combinational" on its first statement asks for it, "... off" refuses it,
+ * otherwise auto_detect decides. Either way the function must be side-effect
+ * free and loop free: scalar parameters, scalar locals assigned once from
+ * values already computed, one final return, and calls only to functions
+ * that are combinational themselves.
+ */
+int combinational_function(const ASTNode *function, int auto_detect);
+
+// Whether the pragma asked for function, so a refusal can be reported
+int combinational_requested(const ASTNode *function);
+
+// Concurrent assignments of the body of a combinational function
+void emit_combinational_body(ASTNode *function, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+#endif // CODEGEN_VHDL_COMBINATIONAL_H
@@ -41,6 +41,7 @@ const char *VHDL_OP_EQUAL = "=";
 const char *VHDL_OP_NOT_EQUAL = "/=";
 const char *VHDL_OP_AND = " and ";
 const char *VHDL_OP_OR = " or ";
+const char *VHDL_OP_REM = "rem";  // C % truncates like rem, not like mod
 
 // -------------------------------------------------------------
 // C type name constants
@@ -9,12 +9,7 @@
 // -------------------------------------------------------------
 // Buffer size constants
 // -------------------------------------------------------------
-#define MAX_PARAMETERS 128
-#define MAX_BUFFER_SIZE 256
-#define ARRAY_NAME_BUFFER_SIZE 64
-#define ARRAY_INDEX_BUFFER_SIZE 64
-#define ARRAY_SIZE_BUFFER_SIZE 32
-#define BITSTRING_BUFFER_SIZE 40
+#define BITSTRING_BUFFER_SIZE 72 // Widest explicit-width literal (64 bits) and its NUL
 
 // -------------------------------------------------------------
 // VHDL type constants
@@ -65,6 +60,7 @@ extern const char *VHDL_OP_EQUAL;
 extern const char *VHDL_OP_NOT_EQUAL;
 extern const char *VHDL_OP_AND;
 extern const char *VHDL_OP_OR;
+extern const char *VHDL_OP_REM;
 
 // -------------------------------------------------------------
 // C type name constants
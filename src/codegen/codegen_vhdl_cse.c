@@ -0,0 +1,399 @@
+// VHDL Code Generator - Common Subexpression Elimination Implementation
+// -------------------------------------------------------------
+// Every operator of a clocked process infers its own unit, so a formula
+// repeated in several statements is built several times. Binary
+// expressions are value-numbered bottom-up: leaves by their text and
+// operators by (operator, left value, right value). A value occurring more
+// than once becomes a concurrent assignment to cse_<id>, and every
+// occurrence reads that signal instead.
+//
+// The concurrent assignment reads the same signals the process reads at the
+// clock edge (signal assignments in the process only take effect after it),
+// so cse_<id> equals the expression in every statement that repeats it,
+// whatever was assigned between them. Values are created after their
+// operands, so walking them from the last one visits each repeated
+// expression before the values inside it: hoisting a value used n times
+// leaves one copy of its operands, in its definition.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_cse.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "symbol_structs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CSE_NAME_SIZE 32
+
+static int is_numbered_operator(InternId operator_id)
+{
+    switch (operator_id)
+    {
+        case INTERN_OP_PLUS:
+        case INTERN_OP_MINUS:
+        case INTERN_OP_MULTIPLY:
+        case INTERN_OP_DIVIDE:
+        case INTERN_OP_MODULO:
+        case INTERN_OP_SHIFT_LEFT:
+        case INTERN_OP_SHIFT_RIGHT:
+        case INTERN_OP_BITWISE_AND:
+        case INTERN_OP_BITWISE_OR:
+        case INTERN_OP_BITWISE_XOR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int is_commutative(InternId operator_id)
+{
+    return operator_id == INTERN_OP_PLUS || operator_id == INTERN_OP_MULTIPLY ||
+           operator_id == INTERN_OP_BITWISE_AND || operator_id == INTERN_OP_BITWISE_OR ||
+           operator_id == INTERN_OP_BITWISE_XOR;
+}
+
+// Helper: operands the cse_<id> signals can hold: int scalars and integer literals
+static int is_numbered_leaf(const ASTNode *function, const ASTNode *node)
+{
+    const ASTNode *declaration = NULL;
+    const char *name = NULL;
+
+    if (node->type != NODE_EXPRESSION || node->value == NULL || node->num_children > 0)
+    {
+        return 0;
+    }
+    if (is_numeric_literal(node->value) || is_negative_numeric_literal(node->value))
+    {
+        return strchr(node->value, '.') == NULL;
+    }
+    name = (node->value[0] == '-') ? node->value + 1 : node->value;
+    declaration = find_declaration(function, name);
+    return declaration != NULL && declaration->token.id == INTERN_KW_INT && declaration->array_size == 0;
+}
+
+// -------------------------------------------------------------
+// Value table
+// -------------------------------------------------------------
+static unsigned cse_hash(InternId operator_id, int left, int right)
+{
+    unsigned hash = 2166136261u;
+
+    hash = (hash ^ (unsigned)operator_id) * 16777619u;
+    hash = (hash ^ (unsigned)left) * 16777619u;
+    hash = (hash ^ (unsigned)right) * 16777619u;
+    return hash;
+}
+
+static void cse_rehash(CsePlan *plan)
+{
+    plan->slot_capacity = (plan->slot_capacity > 0) ? plan->slot_capacity * 2 : 64;
+    plan->slots = (int*)xrealloc(plan->slots, (size_t)plan->slot_capacity * sizeof(int));
+    for (int slot = 0; slot < plan->slot_capacity; ++slot)
+    {
+        plan->slots[slot] = -1;
+    }
+    for (int value_index = 0; value_index < plan->value_count; ++value_index)
+    {
+        const CseValue *value = &plan->values[value_index];
+        unsigned slot = cse_hash(value->operator_id, value->left, value->right) & (unsigned)(plan->slot_capacity - 1);
+
+        while (plan->slots[slot] >= 0)
+        {
+            slot = (slot + 1) & (unsigned)(plan->slot_capacity - 1);
+        }
+        plan->slots[slot] = value_index;
+    }
+}
+
+static int cse_number(CsePlan *plan, InternId operator_id, int left, int right, int size, ASTNode *node)
+{
+    unsigned slot = 0;
+    CseValue *value = NULL;
+
+    if (2 * (plan->value_count + 1) > plan->slot_capacity)
+    {
+        cse_rehash(plan);
+    }
+    slot = cse_hash(operator_id, left, right) & (unsigned)(plan->slot_capacity - 1);
+    while (plan->slots[slot] >= 0)
+    {
+        value = &plan->values[plan->slots[slot]];
+        if (value->operator_id == operator_id && value->left == left && value->right == right)
+        {
+            return plan->slots[slot];
+        }
+        slot = (slot + 1) & (unsigned)(plan->slot_capacity - 1);
+    }
+
+    if (plan->value_count >= plan->value_capacity)
+    {
+        plan->value_capacity = (plan->value_capacity > 0) ? plan->value_capacity * 2 : 32;
+        plan->values = (CseValue*)xrealloc(plan->values, (size_t)plan->value_capacity * sizeof(CseValue));
+    }
+    value = &plan->values[plan->value_count];
+    memset(value, 0, sizeof(*value));
+    value->operator_id = operator_id;
+    value->left = left;
+    value->right = right;
+    value->size = size;
+    value->definition = node;
+    value->id = -1;
+    plan->slots[slot] = plan->value_count;
+    return plan->value_count++;
+}
+
+static void cse_add_use(CsePlan *plan, ASTNode *parent, int child_index, int value)
+{
+    CseUse *use = NULL;
+
+    if (plan->use_count >= plan->use_capacity)
+    {
+        plan->use_capacity = (plan->use_capacity > 0) ? plan->use_capacity * 2 : 32;
+        plan->uses = (CseUse*)xrealloc(plan->uses, (size_t)plan->use_capacity * sizeof(CseUse));
+    }
+    use = &plan->uses[plan->use_count++];
+    use->parent = parent;
+    use->child_index = child_index;
+    use->original = parent->children[child_index];
+    use->value = value;
+    plan->values[value].uses++;
+}
+
+// -------------------------------------------------------------
+// Collection
+// -------------------------------------------------------------
+// Value of parent->children[child_index], or -1 when it cannot be numbered
+static int cse_collect_expression(CsePlan *plan, const ASTNode *function, ASTNode *parent, int child_index)
+{
+    ASTNode *node = parent->children[child_index];
+    InternId operator_id = INTERN_NONE;
+    int left = 0;
+    int right = 0;
+    int value = 0;
+
+    if (node == NULL)
+    {
+        return -1;
+    }
+    if (is_numbered_leaf(function, node))
+    {
+        return cse_number(plan, INTERN_NONE, (int)intern_cstr(node->value), 0, 0, node);
+    }
+    if (node->type != NODE_BINARY_EXPR || node->value == NULL || node->num_children != 2)
+    {
+        return -1;
+    }
+    operator_id = node->token.id;
+    left = cse_collect_expression(plan, function, node, FIRST_CHILD_INDEX);
+    right = cse_collect_expression(plan, function, node, FIRST_CHILD_INDEX + 1);
+    if (!is_numbered_operator(operator_id) || left < 0 || right < 0)
+    {
+        return -1;
+    }
+    if (is_commutative(operator_id) && right < left)
+    {
+        int swapped = left;
+        left = right;
+        right = swapped;
+    }
+    value = cse_number(plan, operator_id, left, right,
+                       1 + plan->values[left].size + plan->values[right].size, node);
+    cse_add_use(plan, parent, child_index, value);
+    return value;
+}
+
+static void cse_collect_statement(CsePlan *plan, const ASTNode *function, ASTNode *statement);
+
+static void cse_collect_block(CsePlan *plan, const ASTNode *function, ASTNode *block, int first_statement)
+{
+    for (int child_index = first_statement; child_index < block->num_children; ++child_index)
+    {
+        ASTNode *child = block->children[child_index];
+
+        if (child->type == NODE_STATEMENT)
+        {
+            cse_collect_statement(plan, function, child);
+        }
+        else if (child->type == NODE_ELSE_IF_STATEMENT)
+        {
+            cse_collect_block(plan, function, child, FIRST_STATEMENT_INDEX);
+        }
+        else if (child->type == NODE_ELSE_STATEMENT)
+        {
+            cse_collect_block(plan, function, child, 0);
+        }
+    }
+}
+
+static void cse_collect_statement(CsePlan *plan, const ASTNode *function, ASTNode *statement)
+{
+    for (int child_index = 0; child_index < statement->num_children; ++child_index)
+    {
+        ASTNode *child = statement->children[child_index];
+
+        switch (child->type)
+        {
+            case NODE_VAR_DECL:
+                // Scalar initializers only; arrays and structs are emitted per element
+                if (child->num_children > 0 && child->array_size == 0 &&
+                    find_struct_index_id(child->token.id) < 0)
+                {
+                    cse_collect_expression(plan, function, child, FIRST_CHILD_INDEX);
+                }
+                break;
+
+            case NODE_ASSIGNMENT:
+                if (child->num_children == 2)
+                {
+                    cse_collect_expression(plan, function, child, FIRST_CHILD_INDEX + 1);
+                }
+                break;
+
+            case NODE_IF_STATEMENT:
+                cse_collect_block(plan, function, child, FIRST_STATEMENT_INDEX);
+                break;
+
+            case NODE_BINARY_EXPR:
+                // Returned expression
+                cse_collect_expression(plan, function, statement, child_index);
+                break;
+
+            default:
+                // Loop bodies see a different counter value per iteration
+                break;
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// Selection
+// -------------------------------------------------------------
+// Hoisting a value of n uses leaves one copy of each operator inside it
+static void cse_release_operands(CsePlan *plan, int value_index, int copies)
+{
+    const CseValue *value = &plan->values[value_index];
+
+    if (value->operator_id == INTERN_NONE)
+    {
+        return;
+    }
+    plan->values[value->left].uses -= copies;
+    plan->values[value->right].uses -= copies;
+    cse_release_operands(plan, value->left, copies);
+    cse_release_operands(plan, value->right, copies);
+}
+
+int cse_plan_function(ASTNode *function, CsePlan *plan)
+{
+    memset(plan, 0, sizeof(*plan));
+    arena_init(&plan->scratch, 0);
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        if (function->children[child_index]->type == NODE_STATEMENT)
+        {
+            cse_collect_statement(plan, function, function->children[child_index]);
+        }
+    }
+
+    for (int value_index = plan->value_count - 1; value_index >= 0; --value_index)
+    {
+        CseValue *value = &plan->values[value_index];
+
+        if (value->operator_id != INTERN_NONE && value->uses >= 2)
+        {
+            value->id = 0;
+            cse_release_operands(plan, value_index, value->uses - 1);
+        }
+    }
+
+    // Numbered operands first, so the concurrent assignments read in order
+    for (int value_index = 0; value_index < plan->value_count; ++value_index)
+    {
+        CseValue *value = &plan->values[value_index];
+        char name[CSE_NAME_SIZE];
+        Arena *previous = NULL;
+
+        if (value->id < 0)
+        {
+            continue;
+        }
+        value->id = plan->hoisted_count++;
+        snprintf(name, sizeof(name), "cse_%d", value->id);
+        previous = ast_use_arena(&plan->scratch);
+        value->reference = create_node(NODE_EXPRESSION);
+        set_node_value(value->reference, name);
+        ast_use_arena(previous);
+    }
+    return plan->hoisted_count;
+}
+
+void cse_plan_free(CsePlan *plan)
+{
+    free(plan->values);
+    free(plan->slots);
+    free(plan->uses);
+    arena_release(&plan->scratch);
+    memset(plan, 0, sizeof(*plan));
+}
+
+void cse_bind(CsePlan *plan)
+{
+    for (int use_index = 0; use_index < plan->use_count; ++use_index)
+    {
+        CseUse *use = &plan->uses[use_index];
+        const CseValue *value = &plan->values[use->value];
+
+        if (value->reference != NULL)
+        {
+            use->parent->children[use->child_index] = value->reference;
+        }
+    }
+}
+
+void cse_unbind(CsePlan *plan)
+{
+    for (int use_index = 0; use_index < plan->use_count; ++use_index)
+    {
+        CseUse *use = &plan->uses[use_index];
+        use->parent->children[use->child_index] = use->original;
+    }
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+void emit_cse_signals(const CsePlan *plan, OutputBuffer *out)
+{
+    for (int value_index = 0; value_index < plan->value_count; ++value_index)
+    {
+        const CseValue *value = &plan->values[value_index];
+
+        if (value->reference != NULL)
+        {
+            out_printf(out, "  signal cse_%d : std_logic_vector(%d downto 0);\n", value->id, VHDL_BIT_WIDTH - 1);
+        }
+    }
+}
+
+void emit_cse_values(const CsePlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    if (plan->hoisted_count == 0)
+    {
+        return;
+    }
+    out_puts(out, "  -- Common subexpressions\n");
+    for (int value_index = 0; value_index < plan->value_count; ++value_index)
+    {
+        const CseValue *value = &plan->values[value_index];
+
+        if (value->reference != NULL)
+        {
+            out_printf(out, "  cse_%d <= ", value->id);
+            node_generator(value->definition, out);
+            out_puts(out, ";\n");
+        }
+    }
+}
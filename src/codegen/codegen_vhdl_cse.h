@@ -0,0 +1,79 @@
+// VHDL Code Generator - Common Subexpression Elimination
+// -------------------------------------------------------------
+// Purpose: Give every arithmetic subexpression that a function computes
+//          more than once a value number, compute it once on a concurrent
+//          signal and read that signal wherever it was repeated
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_CSE_H
+#define CODEGEN_VHDL_CSE_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "arena.h"
+#include "intern.h"
+
+// -------------------------------------------------------------
+// Value numbering
+// -------------------------------------------------------------
+// A leaf (name or literal) or an operator applied to two earlier values.
+// Commutative operators keep their operands in value order, so a * b and
+// b * a get the same number.
+typedef struct {
+    InternId operator_id;      // INTERN_NONE for a leaf
+    int left;                  // Operand values (a leaf keeps its interned text in left)
+    int right;
+    int size;                  // Operators in the expression (0 for a leaf)
+    int uses;                  // Occurrences not inside another hoisted value
+    ASTNode *definition;       // First occurrence, emitted once when hoisted
+    int id;                    // Signal cse_<id> (-1 = computed in place)
+    ASTNode *reference;        // Reference to cse_<id>, swapped in while bound
+} CseValue;
+
+// An occurrence of a binary expression with a value number
+typedef struct {
+    ASTNode *parent;
+    int child_index;
+    ASTNode *original;
+    int value;
+} CseUse;
+
+typedef struct {
+    CseValue *values;
+    int value_count;
+    int value_capacity;
+    int *slots;                // Open-addressed (operator, left, right) -> value
+    int slot_capacity;
+    CseUse *uses;
+    int use_count;
+    int use_capacity;
+    int hoisted_count;         // Values computed on a cse_<id> signal
+    Arena scratch;             // cse_<id> reference nodes
+} CsePlan;
+
+/**
+ * Number the binary expressions of function's assignments, initializers
+ * and returns (loop bodies and operands that call a function are left
+ * alone) and hoist every value still used twice once its larger repeated
+ * expressions are hoisted. Operands must be int scalars or literals.
+ *
+ * @return Number of hoisted values (plan still needs cse_plan_free)
+ */
+int cse_plan_function(ASTNode *function, CsePlan *plan);
+
+void cse_plan_free(CsePlan *plan);
+
+// Point every occurrence of a hoisted value at its signal (undo with cse_unbind)
+void cse_bind(CsePlan *plan);
+void cse_unbind(CsePlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Architecture declarations of the cse_<id> signals
+void emit_cse_signals(const CsePlan *plan, OutputBuffer *out);
+
+// Concurrent assignment of each hoisted value (call while bound)
+void emit_cse_values(const CsePlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+#endif // CODEGEN_VHDL_CSE_H
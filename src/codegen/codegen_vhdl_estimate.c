@@ -0,0 +1,790 @@
+// VHDL Code Generator - Area and Timing Estimates Implementation
+// -------------------------------------------------------------
+// A first-order cost model over the optimised AST, so a kernel's size and
+// speed can be compared before synthesis. Widths come from the declared C
+// types (ctype_to_vhdl) and, with --narrow-widths, from the same width plan
+// the emitters use; each operator is then charged for a typical 6-input
+// LUT fabric with 25x18 DSP multipliers and 36 Kb block RAMs.
+//
+// Depth is counted in operator levels between registers: locals of a
+// clocked function are registers, so each statement starts a new path,
+// while in a combinational function paths run on through its locals.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_combinational.h"
+#include "codegen_vhdl_strength.h"
+#include "codegen_vhdl_unroll.h"
+#include "codegen_vhdl_widths.h"
+#include "symbol_structs.h"
+#include "symbol_table.h"
+#include "token.h"
+#include "utils.h"
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// DSP multiplier inputs (wider products take several DSPs)
+#define ESTIMATE_DSP_WIDE_INPUT 25
+#define ESTIMATE_DSP_NARROW_INPUT 18
+
+// Bits of one block RAM
+#define ESTIMATE_BRAM_BITS 36864
+
+// 2:1 muxes per LUT bit when an array element is selected by a variable index
+#define ESTIMATE_MUX_INPUTS_PER_LUT 4
+
+// Width, depth and value of an evaluated expression
+typedef struct {
+    int width;
+    int depth;
+    int is_constant;
+    long long constant;
+} EstimateValue;
+
+// A parameter or local of the function being estimated
+typedef struct {
+    int width;                 // Bits of one element
+    int array_size;            // 0 for scalars
+    int depth;                 // Combinational functions: levels to compute it
+} EstimateSignal;
+
+// Counter of the fully unrolled loop being walked: a constant in every copy
+typedef struct {
+    InternId name_id;
+    long long start;
+} EstimateInduction;
+
+typedef struct {
+    CodegenEstimate *result;
+    const CodegenOptions *options;
+    int combinational;
+    long repeat;               // Copies of the current statements (unrolled loops)
+    SymbolTable names;         // Name -> index into signals
+    EstimateSignal *signals;
+    int signal_count;
+    int signal_capacity;
+    int result_width;
+    EstimateInduction *inductions;
+    int induction_count;       // Nesting depth of unrolled loops
+    int induction_capacity;
+} EstimateState;
+
+static EstimateValue estimate_expression(EstimateState *state, ASTNode *node);
+static void estimate_statement(EstimateState *state, ASTNode *node, int mux_level);
+
+static int estimate_max(int left, int right)
+{
+    return (left > right) ? left : right;
+}
+
+// Smallest k with 2^k >= value
+static int estimate_log2_ceiling(long long value)
+{
+    int bits = 0;
+
+    while ((1LL << bits) < value && bits < 62)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+// -------------------------------------------------------------
+// Helper: bits of a C type as ctype_to_vhdl lays it out (structs: the
+// sum of their fields)
+// -------------------------------------------------------------
+static int estimate_type_width(const char *type_name)
+{
+    int struct_index = find_struct_index(type_name);
+    int high_bit = VHDL_BIT_WIDTH - 1;
+
+    if (struct_index >= 0)
+    {
+        const StructInfo *info = struct_info_at(struct_index);
+        int width = 0;
+
+        for (int field_index = 0; field_index < info->field_count; ++field_index)
+        {
+            width += estimate_type_width(info->fields[field_index].field_type);
+        }
+        return width;
+    }
+    if (sscanf(ctype_to_vhdl(type_name), "std_logic_vector(%d downto 0)", &high_bit) != 1)
+    {
+        high_bit = VHDL_BIT_WIDTH - 1;
+    }
+    return high_bit + 1;
+}
+
+// -------------------------------------------------------------
+// Helper: charge an operator, scaled by the unrolled copies it stands for
+// -------------------------------------------------------------
+static void estimate_charge(EstimateState *state, long luts, long dsps)
+{
+    state->result->luts += luts * state->repeat;
+    state->result->dsps += dsps * state->repeat;
+}
+
+static EstimateSignal* estimate_signal(EstimateState *state, const char *name)
+{
+    int index = 0;
+
+    if (name == NULL || !symbol_lookup(&state->names, intern_find(name, strlen(name)), &index))
+    {
+        return NULL;
+    }
+    return &state->signals[index];
+}
+
+// -------------------------------------------------------------
+// Helper: a parameter or local; locals are registers (arrays of at least
+// --bram-threshold elements are block RAM under --fsm)
+// -------------------------------------------------------------
+static void estimate_declare(EstimateState *state, const ASTNode *declaration, int is_parameter)
+{
+    EstimateSignal *signal = NULL;
+    int is_signed = 0;
+    int width = 0;
+    long bits = 0;
+
+    if (declaration->value == NULL)
+    {
+        return;
+    }
+    width = (declaration->array_size > 0) ? width_of_array(declaration->value, &is_signed)
+                                          : width_of_signal(declaration->value, &is_signed);
+    if (width == 0)
+    {
+        width = estimate_type_width(token_text(declaration->token));
+    }
+
+    if (state->signal_count == state->signal_capacity)
+    {
+        state->signal_capacity = state->signal_capacity ? state->signal_capacity * 2 : 16;
+        state->signals = (EstimateSignal*)xrealloc(state->signals,
+                                                   (size_t)state->signal_capacity * sizeof(EstimateSignal));
+    }
+    signal = &state->signals[state->signal_count];
+    signal->width = width;
+    signal->array_size = declaration->array_size;
+    signal->depth = 0;
+    symbol_define(&state->names, intern_cstr(declaration->value), state->signal_count++);
+
+    if (is_parameter || state->combinational)
+    {
+        return;
+    }
+    bits = (long)width * (declaration->array_size > 0 ? declaration->array_size : 1);
+    if (declaration->array_size > 0 && state->options->fsm && state->options->bram_threshold > 0 &&
+        declaration->array_size >= state->options->bram_threshold)
+    {
+        state->result->brams += (bits + ESTIMATE_BRAM_BITS - 1) / ESTIMATE_BRAM_BITS;
+    }
+    else
+    {
+        state->result->registers += bits;
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: a value reaches a register (or, combinationally, a local) after
+// depth levels; mux_level enclosing conditions add a select each
+// -------------------------------------------------------------
+static void estimate_store(EstimateState *state, EstimateSignal *target, int width, int depth, int mux_level)
+{
+    int path = depth + mux_level;
+
+    if (mux_level > 0)
+    {
+        estimate_charge(state, width, 0);
+    }
+    if (state->combinational && target != NULL)
+    {
+        target->depth = estimate_max(target->depth, path);
+    }
+    state->result->depth = estimate_max(state->result->depth, path);
+}
+
+// -------------------------------------------------------------
+// Expressions
+// -------------------------------------------------------------
+static EstimateValue estimate_leaf(EstimateState *state, ASTNode *node)
+{
+    EstimateValue value = { VHDL_BIT_WIDTH, 0, 0, 0 };
+    EstimateSignal *signal = NULL;
+    char *end = NULL;
+
+    if (node->value == NULL)
+    {
+        return value;
+    }
+    if (is_numeric_literal(node->value))
+    {
+        long long magnitude = strtoll(node->value, &end, 10);
+
+        if (*end == '\0')
+        {
+            value.is_constant = 1;
+            value.constant = magnitude;
+            magnitude = (magnitude < 0) ? -magnitude : magnitude;
+            value.width = estimate_log2_ceiling(magnitude + 1) + (node->value[0] == '-');
+            value.width = estimate_max(value.width, 1);
+        }
+        return value;
+    }
+    for (int induction_index = 0; induction_index < state->induction_count; ++induction_index)
+    {
+        if (state->inductions[induction_index].name_id == intern_find(node->value, strlen(node->value)))
+        {
+            value.is_constant = 1;
+            value.constant = state->inductions[induction_index].start;
+            return value;
+        }
+    }
+    signal = estimate_signal(state, node->value);
+    if (signal != NULL)
+    {
+        value.width = signal->width;
+        value.depth = signal->depth;
+    }
+    return value;
+}
+
+// An element read: a mux over the elements unless the index is constant
+static EstimateValue estimate_index(EstimateState *state, ASTNode *node)
+{
+    EstimateValue value = estimate_expression(state, node->children[FIRST_CHILD_INDEX]);
+    EstimateValue index = estimate_expression(state, node->children[FIRST_CHILD_INDEX + 1]);
+    ASTNode *array = node->children[FIRST_CHILD_INDEX];
+    EstimateSignal *signal = (array->type == NODE_EXPRESSION) ? estimate_signal(state, array->value) : NULL;
+    int elements = (signal != NULL) ? signal->array_size : 0;
+
+    value.depth = estimate_max(value.depth, index.depth);
+    value.is_constant = 0;
+    if (!index.is_constant && elements > 1)
+    {
+        estimate_charge(state, (long)value.width * ((elements + ESTIMATE_MUX_INPUTS_PER_LUT - 1) /
+                                                    ESTIMATE_MUX_INPUTS_PER_LUT), 0);
+        value.depth += estimate_log2_ceiling(elements) / 2 + 1;
+    }
+    return value;
+}
+
+static EstimateValue estimate_unary(EstimateState *state, ASTNode *node)
+{
+    EstimateValue value = estimate_expression(state, node->children[FIRST_CHILD_INDEX]);
+    InternId operator_id = node->token.id;
+
+    value.is_constant = 0;
+    if (operator_id == INTERN_OP_LOGICAL_NOT)
+    {
+        // A zero test over the operand
+        estimate_charge(state, (value.width + 5) / 6, 0);
+        value.width = 1;
+        value.depth++;
+    }
+    else if (operator_id == INTERN_OP_MINUS)
+    {
+        estimate_charge(state, value.width, 0);
+        value.depth++;
+    }
+    // ~ folds into whatever reads it
+    return value;
+}
+
+// Helper: DSPs of a full width_a x width_b product
+static long estimate_dsps(int width_a, int width_b)
+{
+    int wide = estimate_max(width_a, width_b);
+    int narrow = (width_a < width_b) ? width_a : width_b;
+
+    return (long)((wide + ESTIMATE_DSP_WIDE_INPUT - 1) / ESTIMATE_DSP_WIDE_INPUT) *
+           ((narrow + ESTIMATE_DSP_NARROW_INPUT - 1) / ESTIMATE_DSP_NARROW_INPUT);
+}
+
+static EstimateValue estimate_binary(EstimateState *state, ASTNode *node)
+{
+    EstimateValue left = estimate_expression(state, node->children[FIRST_CHILD_INDEX]);
+    EstimateValue right = estimate_expression(state, node->children[FIRST_CHILD_INDEX + 1]);
+    InternId operator_id = node->token.id;
+    EstimateValue value = { estimate_max(left.width, right.width), estimate_max(left.depth, right.depth), 0, 0 };
+    int width = value.width;
+    // Strength reduction lowers * / % by a constant (loop counters of
+    // unrolled copies included) without a multiplier or divider
+    int constant_operand = state->options->strength_reduce && (left.is_constant != right.is_constant);
+    long long constant = left.is_constant ? left.constant : right.constant;
+
+    if (constant < 0)
+    {
+        constant = -constant;
+    }
+
+    switch (operator_id)
+    {
+        case INTERN_OP_PLUS:
+        case INTERN_OP_MINUS:
+            // One LUT per bit feeding the carry chain
+            value.width = (width < VHDL_BIT_WIDTH) ? width + 1 : VHDL_BIT_WIDTH;
+            estimate_charge(state, value.width, 0);
+            value.depth++;
+            break;
+
+        case INTERN_OP_MULTIPLY:
+            value.width = (left.width + right.width < VHDL_BIT_WIDTH) ? left.width + right.width : VHDL_BIT_WIDTH;
+            if (constant_operand)
+            {
+                // Shifted adds, nothing at all for a power of two
+                if ((constant & (constant - 1)) != 0)
+                {
+                    estimate_charge(state, (long)value.width * (STRENGTH_MAX_TERMS - 1), 0);
+                    value.depth += STRENGTH_MAX_TERMS - 1;
+                }
+            }
+            else
+            {
+                estimate_charge(state, 0, estimate_dsps(left.width, right.width));
+                value.depth++;
+            }
+            break;
+
+        case INTERN_OP_DIVIDE:
+        case INTERN_OP_MODULO:
+            if (constant_operand && right.is_constant)
+            {
+                // A shift with a rounding bias, or a reciprocal multiply
+                // and a correcting subtraction
+                estimate_charge(state, width,
+                                ((constant & (constant - 1)) != 0) ? estimate_dsps(width, VHDL_BIT_WIDTH) : 0);
+                value.depth += 2;
+            }
+            else
+            {
+                // Restoring array divider: a subtractor per quotient bit
+                estimate_charge(state, (long)width * width, 0);
+                value.depth += width;
+            }
+            break;
+
+        case INTERN_OP_EQUAL:
+        case INTERN_OP_NOT_EQUAL:
+            estimate_charge(state, (width + 2) / 3, 0);
+            value.width = 1;
+            value.depth++;
+            break;
+
+        case INTERN_OP_LESS:
+        case INTERN_OP_LESS_EQUAL:
+        case INTERN_OP_GREATER:
+        case INTERN_OP_GREATER_EQUAL:
+            estimate_charge(state, width, 0);
+            value.width = 1;
+            value.depth++;
+            break;
+
+        case INTERN_OP_BITWISE_AND:
+        case INTERN_OP_BITWISE_OR:
+        case INTERN_OP_BITWISE_XOR:
+            estimate_charge(state, width, 0);
+            value.depth++;
+            break;
+
+        case INTERN_OP_SHIFT_LEFT:
+        case INTERN_OP_SHIFT_RIGHT:
+            value.width = left.width;
+            // A constant shift is wiring; otherwise a barrel shifter
+            if (!right.is_constant)
+            {
+                int stages = estimate_log2_ceiling(left.width);
+
+                estimate_charge(state, (long)left.width * ((stages + 1) / 2), 0);
+                value.depth += (stages + 1) / 2;
+            }
+            break;
+
+        case INTERN_OP_LOGICAL_AND:
+        case INTERN_OP_LOGICAL_OR:
+            estimate_charge(state, 1, 0);
+            value.width = 1;
+            value.depth++;
+            break;
+
+        default:
+            break;
+    }
+    return value;
+}
+
+static EstimateValue estimate_expression(EstimateState *state, ASTNode *node)
+{
+    EstimateValue value = { VHDL_BIT_WIDTH, 0, 0, 0 };
+
+    if (node == NULL)
+    {
+        return value;
+    }
+    switch (node->type)
+    {
+        case NODE_EXPRESSION:
+            return estimate_leaf(state, node);
+        case NODE_INDEX_EXPR:
+            if (node->num_children == 2)
+            {
+                return estimate_index(state, node);
+            }
+            break;
+        case NODE_MEMBER_EXPR:
+            value = estimate_expression(state, node->children[FIRST_CHILD_INDEX]);
+            value.width = VHDL_BIT_WIDTH;
+            return value;
+        case NODE_UNARY_EXPR:
+            if (node->num_children == 1 && node->value != NULL)
+            {
+                return estimate_unary(state, node);
+            }
+            break;
+        case NODE_BINARY_EXPR:
+            if (node->num_children == 2 && node->value != NULL)
+            {
+                return estimate_binary(state, node);
+            }
+            break;
+        case NODE_FUNC_CALL:
+            // An instance of the callee's entity, estimated on its own
+            for (int child_index = 0; child_index < node->num_children; ++child_index)
+            {
+                EstimateValue argument = estimate_expression(state, node->children[child_index]);
+                value.depth = estimate_max(value.depth, argument.depth);
+            }
+            state->result->instances += state->repeat;
+            return value;
+        default:
+            break;
+    }
+    return value;
+}
+
+// -------------------------------------------------------------
+// Statements
+// -------------------------------------------------------------
+static void estimate_assignment(EstimateState *state, ASTNode *node, int mux_level)
+{
+    ASTNode *target = node->children[FIRST_CHILD_INDEX];
+    EstimateValue value = estimate_expression(state, node->children[FIRST_CHILD_INDEX + 1]);
+    EstimateSignal *signal = NULL;
+    int width = VHDL_BIT_WIDTH;
+
+    if (target->type == NODE_EXPRESSION)
+    {
+        signal = estimate_signal(state, target->value);
+    }
+    else if (target->type == NODE_INDEX_EXPR && target->num_children == 2)
+    {
+        // The index selects which element's write enable is set
+        EstimateValue index = estimate_expression(state, target->children[FIRST_CHILD_INDEX + 1]);
+
+        value.depth = estimate_max(value.depth, index.depth + 1);
+        if (target->children[FIRST_CHILD_INDEX]->type == NODE_EXPRESSION)
+        {
+            signal = estimate_signal(state, target->children[FIRST_CHILD_INDEX]->value);
+        }
+    }
+    if (signal != NULL)
+    {
+        width = signal->width;
+    }
+    estimate_store(state, (target->type == NODE_EXPRESSION) ? signal : NULL, width, value.depth, mux_level);
+}
+
+static void estimate_for_loop(EstimateState *state, ASTNode *statement, ASTNode *for_node, int mux_level)
+{
+    LoopBounds bounds;
+    long saved_repeat = state->repeat;
+    const char *pragma = find_node_pragma(statement, "unroll");
+    int unrolled = 0;
+
+    // A fully unrolled loop is copies of its body without a counter;
+    // other loops are counted once
+    unrolled = analyze_for_loop(for_node, &bounds) && bounds.trip_count > 0 &&
+               (pragma != NULL || bounds.trip_count <= state->options->unroll_limit);
+    if (unrolled)
+    {
+        state->repeat *= (long)bounds.trip_count;
+        if (state->induction_count == state->induction_capacity)
+        {
+            state->induction_capacity = state->induction_capacity ? state->induction_capacity * 2 : 4;
+            state->inductions = (EstimateInduction*)xrealloc(state->inductions,
+                                                              (size_t)state->induction_capacity * sizeof(EstimateInduction));
+        }
+        state->inductions[state->induction_count].name_id = intern_cstr(bounds.variable);
+        state->inductions[state->induction_count++].start = bounds.start;
+    }
+    for (int child_index = 0; child_index < for_node->num_children; ++child_index)
+    {
+        ASTNode *child = for_node->children[child_index];
+
+        if (!unrolled || child->type == NODE_STATEMENT)
+        {
+            estimate_statement(state, child, mux_level);
+        }
+    }
+    if (unrolled)
+    {
+        state->induction_count--;
+    }
+    state->repeat = saved_repeat;
+}
+
+static void estimate_statement(EstimateState *state, ASTNode *node, int mux_level)
+{
+    EstimateSignal *signal = NULL;
+    EstimateValue value;
+
+    if (node == NULL)
+    {
+        return;
+    }
+    switch (node->type)
+    {
+        case NODE_STATEMENT:
+            if (node->token.id == INTERN_KW_RETURN && node->num_children > 0)
+            {
+                value = estimate_expression(state, node->children[FIRST_CHILD_INDEX]);
+                estimate_store(state, NULL, state->result_width, value.depth, mux_level);
+                return;
+            }
+            if (node->num_children == 1 && node->children[FIRST_CHILD_INDEX]->type == NODE_FOR_STATEMENT)
+            {
+                estimate_for_loop(state, node, node->children[FIRST_CHILD_INDEX], mux_level);
+                return;
+            }
+            break;
+
+        case NODE_VAR_DECL:
+            estimate_declare(state, node, 0);
+            signal = estimate_signal(state, node->value);
+            if (signal != NULL && node->num_children > 0 && node->array_size == 0)
+            {
+                value = estimate_expression(state, node->children[FIRST_CHILD_INDEX]);
+                estimate_store(state, signal, signal->width, value.depth, mux_level);
+            }
+            return;
+
+        case NODE_ASSIGNMENT:
+            if (node->num_children == 2)
+            {
+                estimate_assignment(state, node, mux_level);
+            }
+            return;
+
+        case NODE_IF_STATEMENT:
+        case NODE_ELSE_IF_STATEMENT:
+        case NODE_WHILE_STATEMENT:
+            // The condition selects between the branches' values
+            value = estimate_expression(state, node->children[FIRST_CHILD_INDEX]);
+            state->result->depth = estimate_max(state->result->depth, value.depth + mux_level + 1);
+            for (int child_index = 1; child_index < node->num_children; ++child_index)
+            {
+                estimate_statement(state, node->children[child_index], mux_level + 1);
+            }
+            return;
+
+        case NODE_ELSE_STATEMENT:
+            for (int child_index = 0; child_index < node->num_children; ++child_index)
+            {
+                estimate_statement(state, node->children[child_index], mux_level);
+            }
+            return;
+
+        case NODE_BINARY_EXPR:
+        case NODE_UNARY_EXPR:
+        case NODE_FUNC_CALL:
+        case NODE_EXPRESSION:
+            // Loop conditions and increments, calls made as statements
+            value = estimate_expression(state, node);
+            state->result->depth = estimate_max(state->result->depth, value.depth + mux_level);
+            return;
+
+        default:
+            break;
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        estimate_statement(state, node->children[child_index], mux_level);
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: one entity, with the width plan the emitters would use
+// -------------------------------------------------------------
+static void estimate_function(ASTNode *function, CodegenEstimate *result)
+{
+    const CodegenOptions *options = codegen_current_options();
+    EstimateState state;
+    WidthPlan widths;
+    const WidthPlan *previous_widths = NULL;
+    int is_signed = 0;
+    int stages = 1;
+
+    memset(&state, 0, sizeof(state));
+    memset(result, 0, sizeof(*result));
+    result->name = (function->value != NULL) ? function->value : DEFAULT_FUNCTION_NAME;
+    state.result = result;
+    state.options = options;
+    state.repeat = 1;
+    state.combinational = combinational_function(function, options->combinational);
+    symbol_table_init(&state.names);
+    width_plan_function(function, options->narrow_widths && options->pipeline_stages == 0, &widths);
+    previous_widths = width_plan_activate(&widths);
+
+    state.result_width = width_of_result(&is_signed);
+    if (state.result_width == 0)
+    {
+        state.result_width = (function->token.id != INTERN_NONE) ? estimate_type_width(token_text(function->token))
+                                                                 : VHDL_BIT_WIDTH;
+    }
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+
+        if (child->type == NODE_VAR_DECL)
+        {
+            estimate_declare(&state, child, 1);
+        }
+        else
+        {
+            estimate_statement(&state, child, 0);
+        }
+    }
+
+    if (!state.combinational)
+    {
+        result->registers += state.result_width;
+        // Retimed stages each hold a result-wide value and a valid bit
+        if (options->pipeline_stages > 0)
+        {
+            stages = options->pipeline_stages;
+            result->registers += (long)(stages - 1) * state.result_width + stages;
+            result->depth = (result->depth + stages - 1) / stages;
+        }
+    }
+
+    width_plan_activate(previous_widths);
+    width_plan_free(&widths);
+    symbol_table_free(&state.names);
+    free(state.signals);
+    free(state.inductions);
+}
+
+// -------------------------------------------------------------
+// Public entry points
+// -------------------------------------------------------------
+int estimate_vhdl(ParserContext *ctx, ASTNode *root, CodegenEstimate **estimates)
+{
+    ParserContext *previous = parser_context_activate(ctx);
+    int count = 0;
+
+    *estimates = (CodegenEstimate*)xrealloc(NULL, (size_t)root->num_children * sizeof(CodegenEstimate));
+    for (int child_index = 0; child_index < root->num_children; ++child_index)
+    {
+        if (root->children[child_index]->type == NODE_FUNCTION_DECL)
+        {
+            estimate_function(root->children[child_index], &(*estimates)[count++]);
+        }
+    }
+    parser_context_activate(previous);
+    return count;
+}
+
+// Helper: sums over every entity, the deepest path of any of them
+static CodegenEstimate estimate_total(const CodegenEstimate *estimates, int count)
+{
+    CodegenEstimate total;
+
+    memset(&total, 0, sizeof(total));
+    total.name = "total";
+    for (int index = 0; index < count; ++index)
+    {
+        total.luts += estimates[index].luts;
+        total.registers += estimates[index].registers;
+        total.dsps += estimates[index].dsps;
+        total.brams += estimates[index].brams;
+        total.instances += estimates[index].instances;
+        total.depth = estimate_max(total.depth, estimates[index].depth);
+    }
+    return total;
+}
+
+static void estimate_print_row(const CodegenEstimate *estimate, OutputBuffer *out)
+{
+    out_printf(out, "  %-20s %8ld %8ld %6ld %6ld %6d %9ld\n", estimate->name, estimate->luts,
+               estimate->registers, estimate->dsps, estimate->brams, estimate->depth, estimate->instances);
+}
+
+void estimate_print_text(const CodegenEstimate *estimates, int count, const char *filename, OutputBuffer *out)
+{
+    CodegenEstimate total = estimate_total(estimates, count);
+
+    out_printf(out, "Estimate for %s\n", filename ? filename : "<input>");
+    out_printf(out, "  %-20s %8s %8s %6s %6s %6s %9s\n", "entity", "LUT", "FF", "DSP", "BRAM", "depth",
+               "instances");
+    for (int index = 0; index < count; ++index)
+    {
+        estimate_print_row(&estimates[index], out);
+    }
+    estimate_print_row(&total, out);
+}
+
+// Helper: write text as a JSON string literal
+static void estimate_print_json_string(const char *text, OutputBuffer *out)
+{
+    out_putc(out, '"');
+    for (const char *cursor = text; *cursor; cursor++)
+    {
+        unsigned char character = (unsigned char)*cursor;
+
+        if (character == '"' || character == '\\')
+        {
+            out_printf(out, "\\%c", character);
+        }
+        else if (character < 0x20)
+        {
+            out_printf(out, "\\u%04x", character);
+        }
+        else
+        {
+            out_putc(out, (char)character);
+        }
+    }
+    out_putc(out, '"');
+}
+
+static void estimate_print_json_counts(const CodegenEstimate *estimate, OutputBuffer *out)
+{
+    out_printf(out, "\"luts\": %ld, \"registers\": %ld, \"dsps\": %ld, \"brams\": %ld, \"depth\": %d, "
+               "\"instances\": %ld", estimate->luts, estimate->registers, estimate->dsps, estimate->brams,
+               estimate->depth, estimate->instances);
+}
+
+void estimate_print_json(const CodegenEstimate *estimates, int count, const char *filename, OutputBuffer *out)
+{
+    CodegenEstimate total = estimate_total(estimates, count);
+
+    out_puts(out, "{\"file\": ");
+    estimate_print_json_string(filename ? filename : "", out);
+    out_puts(out, ", \"entities\": [");
+    for (int index = 0; index < count; ++index)
+    {
+        out_puts(out, index ? ", {\"name\": " : "{\"name\": ");
+        estimate_print_json_string(estimates[index].name, out);
+        out_puts(out, ", ");
+        estimate_print_json_counts(&estimates[index], out);
+        out_putc(out, '}');
+    }
+    out_puts(out, "], \"total\": {");
+    estimate_print_json_counts(&total, out);
+    out_puts(out, "}}");
+}
@@ -4,133 +4,157 @@
 #include "codegen_vhdl_expressions.h"
 #include "codegen_vhdl_constants.h"
 #include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_fixed.h"
+#include "codegen_vhdl_strength.h"
+#include "codegen_vhdl_widths.h"
 #include "utils.h"
+#include "intern.h"
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
 
 // Forward declarations for mutual recursion
-static void generate_node(ASTNode *node, FILE *output_file);
+static void generate_node(ASTNode *node, OutputBuffer *out);
 
 // -------------------------------------------------------------
 // Binary expression (both arithmetic and comparison)
 // -------------------------------------------------------------
-void generate_binary_expression(ASTNode *node, FILE *output_file)
+void generate_binary_expression(ASTNode *node, OutputBuffer *out)
 {
     const char *operator = node->value;
-    const char *normalized_operator = operator;
+    InternId operator_id = node->token.id;
     ASTNode *left_operand  = node->children[FIRST_CHILD_INDEX];
     ASTNode *right_operand = node->children[FIRST_CHILD_INDEX + 1];
 
-    // Normalize operator for VHDL
-    if (strcmp(operator, OP_EQUAL) == 0)
+    // Arithmetic and comparisons over fixed-point values are rescaled
+    if (fixed_generate_expression(node, out, generate_node))
     {
-        normalized_operator = VHDL_OP_EQUAL;
-    }
-    else if (strcmp(operator, OP_NOT_EQUAL) == 0)
-    {
-        normalized_operator = VHDL_OP_NOT_EQUAL;
-    }
-
-    // Logical short-circuit operators (&&, ||) converted to boolean expressions
-    if (strcmp(node->value, OP_LOGICAL_AND) == 0 || strcmp(node->value, OP_LOGICAL_OR) == 0)
-    {
-        const char *vhdl_logical = (strcmp(node->value, OP_LOGICAL_AND) == 0) ? VHDL_OP_AND : VHDL_OP_OR;
-        emit_boolean_gate_expression(left_operand, right_operand, vhdl_logical, output_file);
         return;
     }
-
-    // Comparison operations produce booleans
-    if (strcmp(normalized_operator, VHDL_OP_EQUAL) == 0 || 
-        strcmp(normalized_operator, VHDL_OP_NOT_EQUAL) == 0 ||
-        strcmp(normalized_operator, OP_LESS_THAN) == 0 ||
-        strcmp(normalized_operator, OP_LESS_EQUAL) == 0 ||
-        strcmp(normalized_operator, OP_GREATER_THAN) == 0 ||
-        strcmp(normalized_operator, OP_GREATER_EQUAL) == 0)
+    // Multiplies and divides by constants need no multiplier or divider
+    if (strength_generate_expression(node, out, generate_node))
     {
-        // Emit left operand with type conversion
-        emit_typed_operand(left_operand, output_file, 0, generate_node);
-        
-        fprintf(output_file, " %s ", normalized_operator);
-        
-        // Emit right operand with type conversion
-        emit_typed_operand(right_operand, output_file, 0, generate_node);
-        
         return;
     }
 
-    // Bitwise operations
-    if (strcmp(operator, OP_BITWISE_AND) == 0)
-    {
-        fprintf(output_file, "unsigned(");
-        generate_node(left_operand, output_file);
-        fprintf(output_file, ") and unsigned(");
-        generate_node(right_operand, output_file);
-        fprintf(output_file, ")");
-        return;
+    switch (operator_id)
+    {
+        // Logical short-circuit operators (&&, ||) converted to boolean expressions
+        case INTERN_OP_LOGICAL_AND:
+            emit_boolean_gate_expression(left_operand, right_operand, VHDL_OP_AND, out);
+            return;
+        case INTERN_OP_LOGICAL_OR:
+            emit_boolean_gate_expression(left_operand, right_operand, VHDL_OP_OR, out);
+            return;
+
+        // Comparison operations produce booleans (== and != normalized for VHDL)
+        case INTERN_OP_EQUAL:
+        case INTERN_OP_NOT_EQUAL:
+        case INTERN_OP_LESS:
+        case INTERN_OP_LESS_EQUAL:
+        case INTERN_OP_GREATER:
+        case INTERN_OP_GREATER_EQUAL:
+            // Emit left operand with type conversion
+            emit_typed_operand(left_operand, out, 0, generate_node);
+            
+            if (operator_id == INTERN_OP_EQUAL)
+            {
+                out_putc(out, ' ');
+                out_puts(out, VHDL_OP_EQUAL);
+                out_putc(out, ' ');
+            }
+            else if (operator_id == INTERN_OP_NOT_EQUAL)
+            {
+                out_putc(out, ' ');
+                out_puts(out, VHDL_OP_NOT_EQUAL);
+                out_putc(out, ' ');
+            }
+            else
+            {
+                out_putc(out, ' ');
+                out_puts(out, operator);
+                out_putc(out, ' ');
+            }
+            
+            // Emit right operand with type conversion
+            emit_typed_operand(right_operand, out, 0, generate_node);
+            return;
+
+        // Bitwise operations
+        case INTERN_OP_BITWISE_AND:
+        case INTERN_OP_BITWISE_OR:
+        case INTERN_OP_BITWISE_XOR:
+            out_puts(out, "unsigned(");
+            generate_node(left_operand, out);
+            out_printf(out, ") %s unsigned(",
+                    operator_id == INTERN_OP_BITWISE_AND ? "and" :
+                    operator_id == INTERN_OP_BITWISE_OR ? "or" : "xor");
+            generate_node(right_operand, out);
+            out_puts(out, ")");
+            return;
+
+        case INTERN_OP_SHIFT_LEFT:
+        case INTERN_OP_SHIFT_RIGHT:
+            out_printf(out, "%s(unsigned(",
+                    operator_id == INTERN_OP_SHIFT_LEFT ? "shift_left" : "shift_right");
+            generate_node(left_operand, out);
+            out_puts(out, "), to_integer(unsigned(");
+            generate_node(right_operand, out);
+            out_puts(out, "))))");
+            return;
+
+        default:
+            break;
     }
-    
-    if (strcmp(operator, OP_BITWISE_OR) == 0)
+
+    // Fallback: arithmetic or unknown operators
+    emit_arithmetic_operand(left_operand, operator_id, 0, out);
+    out_putc(out, ' ');
+    out_puts(out, (operator_id == INTERN_OP_MODULO) ? VHDL_OP_REM : operator);
+    out_putc(out, ' ');
+    emit_arithmetic_operand(right_operand, operator_id, 1, out);
+}
+
+// -------------------------------------------------------------
+// Helper: Emit an arithmetic operand, parenthesised when it binds looser
+// than its parent (or as tightly, on the right: a - (b - c))
+// -------------------------------------------------------------
+void emit_arithmetic_operand(ASTNode *operand, InternId parent_operator_id, int is_right_operand, OutputBuffer *out)
+{
+    int parent_precedence = get_precedence_id(parent_operator_id);
+    int operand_precedence = 0;
+    int needs_parentheses = 0;
+
+    if (operand->type == NODE_BINARY_EXPR && operand->value != NULL && parent_precedence != PREC_UNKNOWN)
     {
-        fprintf(output_file, "unsigned(");
-        generate_node(left_operand, output_file);
-        fprintf(output_file, ") or unsigned(");
-        generate_node(right_operand, output_file);
-        fprintf(output_file, ")");
-        return;
+        operand_precedence = get_precedence_id(operand->token.id);
+        needs_parentheses = (operand_precedence < parent_precedence) ||
+                            (is_right_operand && operand_precedence == parent_precedence);
     }
-    
-    if (strcmp(operator, OP_BITWISE_XOR) == 0)
+
+    if (needs_parentheses)
     {
-        fprintf(output_file, "unsigned(");
-        generate_node(left_operand, output_file);
-        fprintf(output_file, ") xor unsigned(");
-        generate_node(right_operand, output_file);
-        fprintf(output_file, ")");
-        return;
+        out_putc(out, '(');
+        generate_node(operand, out);
+        out_putc(out, ')');
     }
-    
-    if (strcmp(operator, OP_SHIFT_LEFT) == 0)
+    else
     {
-        fprintf(output_file, "shift_left(unsigned(");
-        generate_node(left_operand, output_file);
-        fprintf(output_file, "), to_integer(unsigned(");
-        generate_node(right_operand, output_file);
-        fprintf(output_file, "))))");
-        return;
+        generate_node(operand, out);
     }
-    
-    if (strcmp(operator, OP_SHIFT_RIGHT) == 0)
-    {
-        fprintf(output_file, "shift_right(unsigned(");
-        generate_node(left_operand, output_file);
-        fprintf(output_file, "), to_integer(unsigned(");
-        generate_node(right_operand, output_file);
-        fprintf(output_file, "))))");
-        return;
-    }
-
-    // Fallback: arithmetic or unknown operators
-    generate_node(left_operand, output_file);
-    fprintf(output_file, " %s ", operator);
-    generate_node(right_operand, output_file);
 }
 
 // -------------------------------------------------------------
-// Expression (identifier / literal / array access / struct field)
+// Expression (identifier / literal)
 // -------------------------------------------------------------
-void generate_expression(ASTNode *node, FILE *output_file)
+void generate_expression(ASTNode *node, OutputBuffer *out)
 {
-    if (node->value == NULL)
-    {
-        fprintf(output_file, "%s", UNKNOWN_IDENTIFIER);
-        return;
-    }
+    int is_signed = 0;
+    int width = 0;
 
-    // Array element like name[index]
-    if (strchr(node->value, '[') != NULL)
+    if (node->value == NULL)
     {
-        emit_array_element_access(node->value, output_file);
+        out_puts(out, UNKNOWN_IDENTIFIER);
         return;
     }
 
@@ -138,197 +162,205 @@ void generate_expression(ASTNode *node, FILE *output_file)
     {
         if (isalpha(node->value[1]) || node->value[1] == '_')
         {
-            fprintf(output_file, "-unsigned(%s)", node->value + 1);
+            out_puts(out, "-unsigned(");
+            out_puts(out, node->value + 1);
+            out_putc(out, ')');
         }
         else
         {
-            emit_signed_cast(node->value, output_file);
+            emit_signed_cast(node->value, out);
         }
         return;
     }
 
-    // Struct field encoded as a__b -> a.b
-    if (strstr(node->value, "__") != NULL)
+    // Narrower signals take part in expressions at the full 32 bits
+    width = width_of_signal(node->value, &is_signed);
+    if (width > 0 && width < VHDL_BIT_WIDTH)
     {
-        char buffer[MAX_BUFFER_SIZE];
-        char *char_ptr = NULL;
-        
-        strncpy(buffer, node->value, sizeof(buffer) - 1);
-        buffer[sizeof(buffer) - 1] = '\0';
-        
-        for (char_ptr = buffer; *char_ptr != '\0'; ++char_ptr)
-        {
-            if (*char_ptr == '_' && *(char_ptr + 1) == '_')
-            {
-                *char_ptr = '.';
-                memmove(char_ptr + 1, char_ptr + 2, strlen(char_ptr + 2) + 1);
-            }
-        }
-        
-        fprintf(output_file, "%s", buffer);
+        emit_width_extension_begin(is_signed, out);
+        emit_mapped_signal_name(node->value, out);
+        emit_width_extension_end(out);
         return;
     }
 
     // Use mapped signal name for variables
-    emit_mapped_signal_name(node->value, output_file);
+    emit_mapped_signal_name(node->value, out);
 }
 
 // -------------------------------------------------------------
-// Unary operations (stored as NODE_BINARY_OP w/ value '!','~')
+// Unary operations (NODE_UNARY_EXPR w/ value '!','~','-')
 // -------------------------------------------------------------
-void generate_unary_operation(ASTNode *node, FILE *output_file)
+void generate_unary_operation(ASTNode *node, OutputBuffer *out)
 {
     ASTNode *inner_expression = NULL;
+    InternId unary_operator_id = INTERN_NONE;
 
     if (node->value == NULL || node->num_children != 1)
     {
-        fprintf(output_file, "-- unsupported unary op");
+        out_puts(out, "-- unsupported unary op");
         return;
     }
 
     inner_expression = node->children[FIRST_CHILD_INDEX];
+    unary_operator_id = node->token.id;
 
-    if (strcmp(node->value, OP_LOGICAL_NOT) == 0)
+    if (unary_operator_id == INTERN_OP_LOGICAL_NOT)
     {
         if (is_node_boolean_expression(inner_expression))
         {
-            fprintf(output_file, "not (");
-            generate_node(inner_expression, output_file);
-            fprintf(output_file, ")");
+            out_puts(out, "not (");
+            generate_node(inner_expression, out);
+            out_puts(out, ")");
         }
         else
         {
-            fprintf(output_file, "(unsigned(");
-            generate_node(inner_expression, output_file);
-            fprintf(output_file, ") = 0)");
+            out_puts(out, "(unsigned(");
+            generate_node(inner_expression, out);
+            out_puts(out, ") = 0)");
         }
     }
-    else if (strcmp(node->value, OP_BITWISE_NOT) == 0)
+    else if (unary_operator_id == INTERN_OP_BITWISE_NOT)
     {
-        fprintf(output_file, "not unsigned(");
-        generate_node(inner_expression, output_file);
-        fprintf(output_file, ")");
+        out_puts(out, "not unsigned(");
+        generate_node(inner_expression, out);
+        out_puts(out, ")");
+    }
+    else if (unary_operator_id == INTERN_OP_MINUS)
+    {
+        if (fixed_generate_expression(node, out, generate_node))
+        {
+            return;
+        }
+        if (inner_expression->type == NODE_EXPRESSION && inner_expression->value != NULL)
+        {
+            out_puts(out, "-unsigned(");
+            out_puts(out, inner_expression->value);
+            out_putc(out, ')');
+        }
+        else
+        {
+            out_puts(out, "0 - ");
+            generate_node(inner_expression, out);
+        }
     }
     else
     {
-        fprintf(output_file, "-- unsupported unary op");
+        out_puts(out, "-- unsupported unary op");
     }
 }
 
 // -------------------------------------------------------------
 // Function call generation
 // -------------------------------------------------------------
-void generate_function_call(ASTNode *node, FILE *output_file)
+void generate_function_call(ASTNode *node, OutputBuffer *out)
 {
     int argument_index = 0;
     
     if (node == NULL || node->value == NULL)
     {
-        fprintf(output_file, "-- Error: unknown function call");
+        out_puts(out, "-- Error: unknown function call");
         return;
     }
     
     // Emit function name
-    fprintf(output_file, "%s(", node->value);
+    out_puts(out, node->value);
+    out_putc(out, '(');
     
     // Emit comma-separated arguments
     for (argument_index = 0; argument_index < node->num_children; argument_index++)
     {
         if (argument_index > 0)
         {
-            fprintf(output_file, ", ");
+            out_puts(out, ", ");
         }
         
-        generate_node(node->children[argument_index], output_file);
+        generate_node(node->children[argument_index], out);
     }
     
-    fprintf(output_file, ")");
+    out_puts(out, ")");
 }
 
 // -------------------------------------------------------------
-// Helper: Emit array element access
+// Array element access: name[index] -> name(index)
 // -------------------------------------------------------------
-void emit_array_element_access(const char *array_expression, FILE *output_file)
+void generate_index_expression(ASTNode *node, OutputBuffer *out)
 {
-    char array_name[ARRAY_NAME_BUFFER_SIZE] = {0};
-    char array_index[ARRAY_INDEX_BUFFER_SIZE] = {0};
-    const char *left_bracket = NULL;
-    const char *index_start = NULL;
-    const char *index_end = NULL;
-    int name_length = 0;
-    int index_length = 0;
-
-    if (array_expression == NULL)
+    if (node->num_children != 2)
     {
-        fprintf(output_file, "-- Invalid array ref");
+        out_puts(out, "-- Invalid array index");
         return;
     }
 
-    left_bracket = strchr(array_expression, '[');
+    generate_node(node->children[FIRST_CHILD_INDEX], out);
+    out_puts(out, "(");
+    generate_node(node->children[FIRST_CHILD_INDEX + 1], out);
+    out_puts(out, ")");
+}
 
-    if (left_bracket == NULL)
+// -------------------------------------------------------------
+// Struct field access: record.field
+// -------------------------------------------------------------
+void generate_member_expression(ASTNode *node, OutputBuffer *out)
+{
+    if (node->num_children != 1 || node->value == NULL)
     {
-        fprintf(output_file, "%s", array_expression);
+        out_puts(out, "-- Invalid field access");
         return;
     }
 
-    name_length = (int)(left_bracket - array_expression);
-    strncpy(array_name, array_expression, name_length);
-    array_name[name_length] = '\0';
-    
-    index_start = left_bracket + 1;
-    index_end = strchr(index_start, ']');
-
-    if (index_end != NULL && index_end > index_start)
-    {
-        index_length = (int)(index_end - index_start);
-        strncpy(array_index, index_start, index_length);
-        array_index[index_length] = '\0';
-        
-        fprintf(output_file, "%s(%s)", array_name, array_index);
-    }
-    else
-    {
-        fprintf(output_file, "-- Invalid array index");
-    }
+    generate_node(node->children[FIRST_CHILD_INDEX], out);
+    out_putc(out, '.');
+    out_puts(out, node->value);
 }
 
 // -------------------------------------------------------------
 // Helper: Emit conditional expression
 // -------------------------------------------------------------
-void emit_conditional_expression(ASTNode *condition, FILE *output_file)
+void emit_conditional_expression(ASTNode *condition, OutputBuffer *out)
 {
     if (condition == NULL)
     {
-        fprintf(output_file, "(%s)", VHDL_FALSE);
+        out_putc(out, '(');
+        out_puts(out, VHDL_FALSE);
+        out_putc(out, ')');
         return;
     }
     
     if (condition->type == NODE_BINARY_EXPR)
     {
-        if (is_boolean_comparison_operator(condition->value))
+        if (is_boolean_comparison_operator(condition->token.id))
         {
-            generate_node(condition, output_file);
+            generate_node(condition, out);
         }
         else
         {
-            fprintf(output_file, "unsigned(");
-            generate_node(condition, output_file);
-            fprintf(output_file, ") /= 0");
+            out_puts(out, "unsigned(");
+            generate_node(condition, out);
+            out_puts(out, ") /= 0");
         }
     }
-    else if (condition->type == NODE_BINARY_OP)
+    else if (condition->type == NODE_UNARY_EXPR)
     {
-        generate_node(condition, output_file);
+        generate_node(condition, out);
     }
     else if (condition->type == NODE_EXPRESSION && condition->value != NULL)
     {
-        fprintf(output_file, "unsigned(%s) /= 0", condition->value);
+        out_puts(out, "unsigned(");
+        out_puts(out, condition->value);
+        out_puts(out, ") /= 0");
+    }
+    else if (condition->type == NODE_INDEX_EXPR || condition->type == NODE_MEMBER_EXPR)
+    {
+        out_puts(out, "unsigned(");
+        generate_node(condition, out);
+        out_puts(out, ") /= 0");
     }
     else
     {
         const char *condition_value = (condition->value != NULL) ? condition->value : VHDL_FALSE;
-        fprintf(output_file, "(%s)", condition_value);
+        out_putc(out, '(');
+        out_puts(out, condition_value);
+        out_putc(out, ')');
     }
 }
 
@@ -336,45 +368,45 @@ void emit_conditional_expression(ASTNode *condition, FILE *output_file)
 // Helper: Emit boolean gate expression (AND/OR)
 // -------------------------------------------------------------
 void emit_boolean_gate_expression(ASTNode *left_operand, ASTNode *right_operand, 
-                                  const char *logical_operator, FILE *output_file)
+                                  const char *logical_operator, OutputBuffer *out)
 {
-    fprintf(output_file, "(");
+    out_puts(out, "(");
     
     if (is_node_boolean_expression(left_operand))
     {
-        fprintf(output_file, "(");
-        generate_node(left_operand, output_file);
-        fprintf(output_file, ")");
+        out_puts(out, "(");
+        generate_node(left_operand, out);
+        out_puts(out, ")");
     }
     else
     {
-        fprintf(output_file, "unsigned(");
-        generate_node(left_operand, output_file);
-        fprintf(output_file, ") /= 0");
+        out_puts(out, "unsigned(");
+        generate_node(left_operand, out);
+        out_puts(out, ") /= 0");
     }
     
-    fprintf(output_file, "%s", logical_operator);
+    out_puts(out, logical_operator);
     
     if (is_node_boolean_expression(right_operand))
     {
-        fprintf(output_file, "(");
-        generate_node(right_operand, output_file);
-        fprintf(output_file, ")");
+        out_puts(out, "(");
+        generate_node(right_operand, out);
+        out_puts(out, ")");
     }
     else
     {
-        fprintf(output_file, "unsigned(");
-        generate_node(right_operand, output_file);
-        fprintf(output_file, ") /= 0");
+        out_puts(out, "unsigned(");
+        generate_node(right_operand, out);
+        out_puts(out, ") /= 0");
     }
     
-    fprintf(output_file, ")");
+    out_puts(out, ")");
 }
 
 // -------------------------------------------------------------
 // Minimal node dispatcher for mutual recursion
 // -------------------------------------------------------------
-static void generate_node(ASTNode *node, FILE *output_file)
+static void generate_node(ASTNode *node, OutputBuffer *out)
 {
     if (node == NULL)
     {
@@ -384,19 +416,27 @@ static void generate_node(ASTNode *node, FILE *output_file)
     switch (node->type)
     {
         case NODE_BINARY_EXPR:
-            generate_binary_expression(node, output_file);
+            generate_binary_expression(node, out);
             break;
             
-        case NODE_BINARY_OP:
-            generate_unary_operation(node, output_file);
+        case NODE_UNARY_EXPR:
+            generate_unary_operation(node, out);
             break;
             
         case NODE_EXPRESSION:
-            generate_expression(node, output_file);
+            generate_expression(node, out);
             break;
             
         case NODE_FUNC_CALL:
-            generate_function_call(node, output_file);
+            generate_function_call(node, out);
+            break;
+            
+        case NODE_INDEX_EXPR:
+            generate_index_expression(node, out);
+            break;
+            
+        case NODE_MEMBER_EXPR:
+            generate_member_expression(node, out);
             break;
             
         default:
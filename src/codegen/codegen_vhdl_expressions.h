@@ -6,23 +6,26 @@
 #ifndef CODEGEN_VHDL_EXPRESSIONS_H
 #define CODEGEN_VHDL_EXPRESSIONS_H
 
-#include <stdio.h>
+#include "output_buffer.h"
 #include "astnode.h"
+#include "intern.h"
 
 // -------------------------------------------------------------
 // Expression generation
 // -------------------------------------------------------------
-void generate_binary_expression(ASTNode *node, FILE *output_file);
-void generate_expression(ASTNode *node, FILE *output_file);
-void generate_unary_operation(ASTNode *node, FILE *output_file);
-void generate_function_call(ASTNode *node, FILE *output_file);
+void generate_binary_expression(ASTNode *node, OutputBuffer *out);
+void generate_expression(ASTNode *node, OutputBuffer *out);
+void generate_unary_operation(ASTNode *node, OutputBuffer *out);
+void generate_function_call(ASTNode *node, OutputBuffer *out);
+void generate_index_expression(ASTNode *node, OutputBuffer *out);
+void generate_member_expression(ASTNode *node, OutputBuffer *out);
 
 // -------------------------------------------------------------
 // Expression emission helpers
 // -------------------------------------------------------------
-void emit_array_element_access(const char *array_expression, FILE *output_file);
-void emit_conditional_expression(ASTNode *condition, FILE *output_file);
+void emit_conditional_expression(ASTNode *condition, OutputBuffer *out);
 void emit_boolean_gate_expression(ASTNode *left_operand, ASTNode *right_operand, 
-                                  const char *logical_operator, FILE *output_file);
+                                  const char *logical_operator, OutputBuffer *out);
+void emit_arithmetic_operand(ASTNode *operand, InternId parent_operator_id, int is_right_operand, OutputBuffer *out);
 
 #endif // CODEGEN_VHDL_EXPRESSIONS_H
@@ -0,0 +1,620 @@
+// VHDL Code Generator - Fixed-Point Lowering Implementation
+// -------------------------------------------------------------
+// A float or double signal in Qm.n holds round(value * 2^n) as an
+// (m + n)-bit two's complement vector. Addition and subtraction of values
+// in one format are plain signed adders; a product carries 2n fraction
+// bits and is shifted back by n, a quotient needs its dividend shifted up
+// by n first. Both keep a single DSP / divider per operator, in one cycle.
+//
+// Every expression is computed in the widest format of the fixed-point
+// signals it reads (integer operands and literals are converted into it),
+// then aligned to the format of the signal it is stored into. A store into
+// an integer drops the fraction bits.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_fixed.h"
+#include "codegen_vhdl.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_widths.h"
+#include "symbol_structs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define FIXED_TYPE_NAME_SIZE sizeof("int-2147483648_t") // "int%d_t" for any int
+
+static _Thread_local const FixedPlan *s_active_plan = NULL;
+
+// What an expression computes: an integer, a real constant (no format of
+// its own), or a value in some fixed-point format
+typedef enum {
+    FIXED_KIND_INTEGER,
+    FIXED_KIND_LITERAL,
+    FIXED_KIND_FIXED
+} FixedKind;
+
+static int fixed_width(FixedFormat format)
+{
+    return format.integer_bits + format.fraction_bits;
+}
+
+// -------------------------------------------------------------
+// Format parsing: "Qm.n" or "m.n"
+// -------------------------------------------------------------
+int codegen_parse_fixed_point(const char *text, int *integer_bits, int *fraction_bits)
+{
+    char *end = NULL;
+    long integer_part = 0;
+    long fraction_part = 0;
+
+    if (text == NULL)
+    {
+        return 0;
+    }
+    if (*text == 'Q' || *text == 'q')
+    {
+        text++;
+    }
+    integer_part = strtol(text, &end, 10);
+    if (end == text || *end != '.')
+    {
+        return 0;
+    }
+    text = end + 1;
+    fraction_part = strtol(text, &end, 10);
+    if (end == text || (*end != '\0' && *end != '\n' && *end != ' ' && *end != '\t'))
+    {
+        return 0;
+    }
+    if (integer_part < 1 || fraction_part < 0 || integer_part + fraction_part > CTYPE_MAX_EXPLICIT_WIDTH)
+    {
+        return 0;
+    }
+    *integer_bits = (int)integer_part;
+    *fraction_bits = (int)fraction_part;
+    return 1;
+}
+
+// -------------------------------------------------------------
+// Plan
+// -------------------------------------------------------------
+static int is_real_type(InternId type_id)
+{
+    return type_id == INTERN_KW_FLOAT || type_id == INTERN_KW_DOUBLE;
+}
+
+// Helper: swap the type token of node for the int<m+n>_t holding format
+static void fixed_retype(FixedPlan *plan, ASTNode *node, FixedFormat format)
+{
+    char type_name[FIXED_TYPE_NAME_SIZE];
+
+    if (plan->retyped_count == plan->retyped_capacity)
+    {
+        plan->retyped_capacity = plan->retyped_capacity ? plan->retyped_capacity * 2 : 8;
+        plan->retyped = xrealloc(plan->retyped, (size_t)plan->retyped_capacity * sizeof(FixedRetype));
+    }
+    plan->retyped[plan->retyped_count].node = node;
+    plan->retyped[plan->retyped_count].type_id = node->token.id;
+    plan->retyped_count++;
+    snprintf(type_name, sizeof(type_name), "int%d_t", fixed_width(format));
+    node->token.id = intern_cstr(type_name);
+}
+
+static void fixed_add_signal(FixedPlan *plan, ASTNode *declaration, FixedFormat format)
+{
+    FixedSignal *signal = NULL;
+
+    if (plan->signal_count == plan->signal_capacity)
+    {
+        plan->signal_capacity = plan->signal_capacity ? plan->signal_capacity * 2 : 8;
+        plan->signals = xrealloc(plan->signals, (size_t)plan->signal_capacity * sizeof(FixedSignal));
+    }
+    signal = &plan->signals[plan->signal_count++];
+    signal->name_id = intern_cstr(declaration->value);
+    signal->format = format;
+    signal->is_array = (declaration->array_size > 0);
+    fixed_retype(plan, declaration, format);
+}
+
+// Helper: a declaration with the format its pragma (on statement) asks for
+static void fixed_add_declaration(FixedPlan *plan, ASTNode *declaration, const ASTNode *statement,
+                                  const FixedFormat *default_format)
+{
+    FixedFormat format = *default_format;
+    const char *pragma = find_node_pragma(statement, "fixed");
+
+    if (declaration->value == NULL || !is_real_type(declaration->token.id))
+    {
+        return;
+    }
+    if (pragma != NULL && !codegen_parse_fixed_point(pragma, &format.integer_bits, &format.fraction_bits))
+    {
+        format = *default_format;
+    }
+    if (format.integer_bits > 0)
+    {
+        fixed_add_signal(plan, declaration, format);
+    }
+}
+
+static void fixed_collect(FixedPlan *plan, ASTNode *node, const FixedFormat *default_format)
+{
+    if (node->type == NODE_VAR_DECL)
+    {
+        // For loop initializers have no statement of their own
+        fixed_add_declaration(plan, node, NULL, default_format);
+        return;
+    }
+    if (node->type == NODE_STATEMENT && node->num_children == 1 &&
+        node->children[FIRST_CHILD_INDEX]->type == NODE_VAR_DECL)
+    {
+        fixed_add_declaration(plan, node->children[FIRST_CHILD_INDEX], node, default_format);
+        return;
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        fixed_collect(plan, node->children[child_index], default_format);
+    }
+}
+
+int fixed_plan_function(ASTNode *function, const FixedFormat *default_format, FixedPlan *plan)
+{
+    FixedFormat none = { 0, 0 };
+
+    memset(plan, 0, sizeof(*plan));
+    if (default_format == NULL)
+    {
+        default_format = &none;
+    }
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        fixed_collect(plan, function->children[child_index], default_format);
+    }
+    if (default_format->integer_bits > 0 && is_real_type(function->token.id))
+    {
+        plan->result = *default_format;
+        fixed_retype(plan, function, *default_format);
+    }
+    return plan->signal_count;
+}
+
+void fixed_plan_free(FixedPlan *plan)
+{
+    for (int index = plan->retyped_count - 1; index >= 0; --index)
+    {
+        plan->retyped[index].node->token.id = plan->retyped[index].type_id;
+    }
+    free(plan->signals);
+    free(plan->retyped);
+    memset(plan, 0, sizeof(*plan));
+}
+
+const FixedPlan* fixed_plan_activate(const FixedPlan *plan)
+{
+    const FixedPlan *previous = s_active_plan;
+
+    s_active_plan = plan;
+    return previous;
+}
+
+// -------------------------------------------------------------
+// Helper: format of a signal of the active plan (0 integer bits = none)
+// -------------------------------------------------------------
+static FixedFormat fixed_format_of_signal(const char *name, int is_array)
+{
+    FixedFormat none = { 0, 0 };
+
+    if (s_active_plan == NULL || name == NULL)
+    {
+        return none;
+    }
+    if (*name == '-')
+    {
+        name++;
+    }
+    for (int index = 0; index < s_active_plan->signal_count; ++index)
+    {
+        const FixedSignal *signal = &s_active_plan->signals[index];
+
+        if (signal->is_array == is_array && strcmp(intern_text(signal->name_id), name) == 0)
+        {
+            return signal->format;
+        }
+    }
+    return none;
+}
+
+// -------------------------------------------------------------
+// Expression classification
+// -------------------------------------------------------------
+static int is_fixed_arithmetic(InternId operator_id)
+{
+    return operator_id == INTERN_OP_PLUS || operator_id == INTERN_OP_MINUS ||
+           operator_id == INTERN_OP_MULTIPLY || operator_id == INTERN_OP_DIVIDE;
+}
+
+static int is_fixed_comparison(InternId operator_id)
+{
+    return operator_id == INTERN_OP_EQUAL || operator_id == INTERN_OP_NOT_EQUAL ||
+           operator_id == INTERN_OP_LESS || operator_id == INTERN_OP_LESS_EQUAL ||
+           operator_id == INTERN_OP_GREATER || operator_id == INTERN_OP_GREATER_EQUAL;
+}
+
+static int is_numeric_text(const char *text)
+{
+    return is_numeric_literal(text) || is_negative_numeric_literal(text);
+}
+
+// Helper: the kind of two operands combined (formats: the wider of each part)
+static FixedKind fixed_merge(FixedKind left, FixedFormat left_format, FixedKind right, FixedFormat right_format,
+                             FixedFormat *format)
+{
+    if (left == FIXED_KIND_FIXED && right == FIXED_KIND_FIXED)
+    {
+        format->integer_bits = (left_format.integer_bits > right_format.integer_bits) ?
+                               left_format.integer_bits : right_format.integer_bits;
+        format->fraction_bits = (left_format.fraction_bits > right_format.fraction_bits) ?
+                                left_format.fraction_bits : right_format.fraction_bits;
+        return FIXED_KIND_FIXED;
+    }
+    if (left == FIXED_KIND_FIXED || right == FIXED_KIND_FIXED)
+    {
+        *format = (left == FIXED_KIND_FIXED) ? left_format : right_format;
+        return FIXED_KIND_FIXED;
+    }
+    return (left == FIXED_KIND_LITERAL || right == FIXED_KIND_LITERAL) ? FIXED_KIND_LITERAL : FIXED_KIND_INTEGER;
+}
+
+static FixedKind fixed_kind_of(const ASTNode *node, FixedFormat *format)
+{
+    InternId operator_id = INTERN_NONE;
+
+    format->integer_bits = 0;
+    format->fraction_bits = 0;
+    if (node == NULL)
+    {
+        return FIXED_KIND_INTEGER;
+    }
+
+    switch (node->type)
+    {
+        case NODE_EXPRESSION:
+            if (node->value == NULL)
+            {
+                return FIXED_KIND_INTEGER;
+            }
+            if (is_numeric_text(node->value))
+            {
+                return (strchr(node->value, '.') != NULL) ? FIXED_KIND_LITERAL : FIXED_KIND_INTEGER;
+            }
+            *format = fixed_format_of_signal(node->value, 0);
+            return (format->integer_bits > 0) ? FIXED_KIND_FIXED : FIXED_KIND_INTEGER;
+
+        case NODE_INDEX_EXPR:
+            if (node->num_children == 2 && node->children[FIRST_CHILD_INDEX]->type == NODE_EXPRESSION)
+            {
+                *format = fixed_format_of_signal(node->children[FIRST_CHILD_INDEX]->value, 1);
+            }
+            return (format->integer_bits > 0) ? FIXED_KIND_FIXED : FIXED_KIND_INTEGER;
+
+        case NODE_UNARY_EXPR:
+            if (node->value == NULL || node->num_children != 1 ||
+                node->token.id != INTERN_OP_MINUS)
+            {
+                return FIXED_KIND_INTEGER;
+            }
+            return fixed_kind_of(node->children[FIRST_CHILD_INDEX], format);
+
+        case NODE_BINARY_EXPR:
+        {
+            FixedFormat left_format;
+            FixedFormat right_format;
+            FixedKind left = FIXED_KIND_INTEGER;
+            FixedKind right = FIXED_KIND_INTEGER;
+
+            if (node->value == NULL || node->num_children != 2)
+            {
+                return FIXED_KIND_INTEGER;
+            }
+            operator_id = node->token.id;
+            if (!is_fixed_arithmetic(operator_id))
+            {
+                return FIXED_KIND_INTEGER;
+            }
+            left = fixed_kind_of(node->children[FIRST_CHILD_INDEX], &left_format);
+            right = fixed_kind_of(node->children[FIRST_CHILD_INDEX + 1], &right_format);
+            return fixed_merge(left, left_format, right, right_format, format);
+        }
+
+        default:
+            return FIXED_KIND_INTEGER;
+    }
+}
+
+// -------------------------------------------------------------
+// Emission helpers (all of them produce a signed of the format's width)
+// -------------------------------------------------------------
+static void fixed_emit_value(ASTNode *node, FixedFormat format, OutputBuffer *out,
+                             void (*node_generator)(ASTNode*, OutputBuffer*));
+
+// Helper: a signed of width holding bits
+static void fixed_emit_bits(long long bits, int width, OutputBuffer *out)
+{
+    if (bits >= INT32_MIN && bits <= INT32_MAX)
+    {
+        out_printf(out, "to_signed(%lld, %d)", bits, width);
+        return;
+    }
+
+    // Beyond the range of a VHDL integer: spell the bits
+    out_puts(out, "signed'(\"");
+    for (int bit = width - 1; bit >= 0; --bit)
+    {
+        out_putc(out, (((unsigned long long)bits >> bit) & 1) ? '1' : '0');
+    }
+    out_puts(out, "\")");
+}
+
+// Helper: a real constant scaled into format (saturating)
+static void fixed_emit_constant(double value, FixedFormat format, OutputBuffer *out)
+{
+    int width = fixed_width(format);
+    double scaled = nearbyint(ldexp(value, format.fraction_bits));
+    double limit = ldexp(1.0, width - 1);
+    long long largest = (long long)(((unsigned long long)1 << (width - 1)) - 1);
+    long long bits = 0;
+
+    if (scaled >= limit)
+    {
+        bits = largest;
+    }
+    else if (scaled < -limit)
+    {
+        bits = -largest - 1;
+    }
+    else
+    {
+        bits = (long long)scaled;
+    }
+    fixed_emit_bits(bits, width, out);
+}
+
+// Helper: wrap a value in from format so it is read in to format
+static void fixed_align_begin(FixedFormat from, FixedFormat to, OutputBuffer *out)
+{
+    if (to.fraction_bits > from.fraction_bits)
+    {
+        out_puts(out, "shift_left(resize(");
+    }
+    else if (to.fraction_bits < from.fraction_bits)
+    {
+        out_puts(out, "resize(shift_right(");
+    }
+    else if (fixed_width(to) != fixed_width(from))
+    {
+        out_puts(out, "resize(");
+    }
+}
+
+static void fixed_align_end(FixedFormat from, FixedFormat to, OutputBuffer *out)
+{
+    if (to.fraction_bits > from.fraction_bits)
+    {
+        out_printf(out, ", %d), %d)", fixed_width(to), to.fraction_bits - from.fraction_bits);
+    }
+    else if (to.fraction_bits < from.fraction_bits)
+    {
+        out_printf(out, ", %d), %d)", from.fraction_bits - to.fraction_bits, fixed_width(to));
+    }
+    else if (fixed_width(to) != fixed_width(from))
+    {
+        out_printf(out, ", %d)", fixed_width(to));
+    }
+}
+
+// Helper: + - * / computed in format
+static void fixed_emit_arithmetic(ASTNode *node, FixedFormat format, OutputBuffer *out,
+                                  void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    ASTNode *left = node->children[FIRST_CHILD_INDEX];
+    ASTNode *right = node->children[FIRST_CHILD_INDEX + 1];
+    int width = fixed_width(format);
+
+    switch (node->token.id)
+    {
+        case INTERN_OP_MULTIPLY:
+            // The product has 2n fraction bits
+            out_puts(out, "resize(shift_right(");
+            fixed_emit_value(left, format, out, node_generator);
+            out_puts(out, " * ");
+            fixed_emit_value(right, format, out, node_generator);
+            out_printf(out, ", %d), %d)", format.fraction_bits, width);
+            break;
+
+        case INTERN_OP_DIVIDE:
+            // Pre-scale the dividend so the quotient keeps n fraction bits
+            out_puts(out, "resize(shift_left(resize(");
+            fixed_emit_value(left, format, out, node_generator);
+            out_printf(out, ", %d), %d) / ", 2 * width, format.fraction_bits);
+            fixed_emit_value(right, format, out, node_generator);
+            out_printf(out, ", %d)", width);
+            break;
+
+        default:
+            out_putc(out, '(');
+            fixed_emit_value(left, format, out, node_generator);
+            out_printf(out, " %s ", node->value);
+            fixed_emit_value(right, format, out, node_generator);
+            out_putc(out, ')');
+            break;
+    }
+}
+
+static void fixed_emit_value(ASTNode *node, FixedFormat format, OutputBuffer *out,
+                             void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    FixedFormat own;
+    FixedKind kind = fixed_kind_of(node, &own);
+
+    // Constants: scaled at compile time
+    if (node->type == NODE_EXPRESSION && node->value != NULL && is_numeric_text(node->value))
+    {
+        fixed_emit_constant(strtod(node->value, NULL), format, out);
+        return;
+    }
+
+    if (kind == FIXED_KIND_INTEGER)
+    {
+        out_printf(out, "shift_left(resize(signed(");
+        node_generator(node, out);
+        out_printf(out, "), %d), %d)", fixed_width(format), format.fraction_bits);
+        return;
+    }
+
+    // Real constants only: computed in the format they are used in
+    if (kind == FIXED_KIND_LITERAL)
+    {
+        own = format;
+    }
+
+    fixed_align_begin(own, format, out);
+    if (node->type == NODE_BINARY_EXPR)
+    {
+        fixed_emit_arithmetic(node, own, out, node_generator);
+    }
+    else if (node->type == NODE_UNARY_EXPR)
+    {
+        out_puts(out, "(-");
+        fixed_emit_value(node->children[FIRST_CHILD_INDEX], own, out, node_generator);
+        out_putc(out, ')');
+    }
+    else if (node->type == NODE_EXPRESSION && node->value[0] == '-')
+    {
+        out_puts(out, "(-signed(");
+        emit_mapped_signal_name(node->value + 1, out);
+        out_puts(out, "))");
+    }
+    else if (node->type == NODE_EXPRESSION)
+    {
+        // Read at its own width (not extended like a narrow integer)
+        out_puts(out, "signed(");
+        emit_mapped_signal_name(node->value, out);
+        out_putc(out, ')');
+    }
+    else
+    {
+        out_puts(out, "signed(");
+        node_generator(node, out);
+        out_putc(out, ')');
+    }
+    fixed_align_end(own, format, out);
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+int fixed_generate_expression(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    FixedFormat format;
+    FixedFormat left_format;
+    FixedFormat right_format;
+    InternId operator_id = INTERN_NONE;
+    FixedKind kind = FIXED_KIND_INTEGER;
+
+    if (s_active_plan == NULL || s_active_plan->signal_count == 0 || node->value == NULL)
+    {
+        return 0;
+    }
+    operator_id = node->token.id;
+
+    if (node->type == NODE_BINARY_EXPR && node->num_children == 2 && is_fixed_comparison(operator_id))
+    {
+        kind = fixed_merge(fixed_kind_of(node->children[FIRST_CHILD_INDEX], &left_format), left_format,
+                           fixed_kind_of(node->children[FIRST_CHILD_INDEX + 1], &right_format), right_format,
+                           &format);
+        if (kind != FIXED_KIND_FIXED)
+        {
+            return 0;
+        }
+        fixed_emit_value(node->children[FIRST_CHILD_INDEX], format, out, node_generator);
+        out_printf(out, " %s ", (operator_id == INTERN_OP_EQUAL) ? VHDL_OP_EQUAL :
+                                (operator_id == INTERN_OP_NOT_EQUAL) ? VHDL_OP_NOT_EQUAL : node->value);
+        fixed_emit_value(node->children[FIRST_CHILD_INDEX + 1], format, out, node_generator);
+        return 1;
+    }
+
+    // Arithmetic outside of a store (conditions, call arguments): its own format
+    if (fixed_kind_of(node, &format) != FIXED_KIND_FIXED)
+    {
+        return 0;
+    }
+    out_puts(out, "std_logic_vector(");
+    fixed_emit_value(node, format, out, node_generator);
+    out_putc(out, ')');
+    return 1;
+}
+
+int emit_fixed_store(ASTNode *value, const char *target, int is_array, OutputBuffer *out,
+                     void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    FixedFormat target_format = { 0, 0 };
+    FixedFormat value_format;
+    int is_signed = 0;
+    int width = 0;
+
+    if (s_active_plan == NULL)
+    {
+        return 0;
+    }
+    target_format = (target == NULL) ? s_active_plan->result : fixed_format_of_signal(target, is_array);
+
+    if (target_format.integer_bits > 0)
+    {
+        // Booleans stay as they are (0 or 1 of any type)
+        if (is_node_boolean_expression(value))
+        {
+            return 0;
+        }
+        out_puts(out, "std_logic_vector(");
+        fixed_emit_value(value, target_format, out, node_generator);
+        out_putc(out, ')');
+        return 1;
+    }
+
+    if (fixed_kind_of(value, &value_format) != FIXED_KIND_FIXED)
+    {
+        return 0;
+    }
+
+    // Into an integer: drop the fraction bits, rounding toward zero as C
+    // does. shift_right floors, so a negative value is first biased by
+    // 2^n - 1 (the sign bits masked down to the fraction).
+    width = (target == NULL) ? width_of_result(&is_signed) :
+            is_array ? width_of_array(target, &is_signed) : width_of_signal(target, &is_signed);
+    out_puts(out, "std_logic_vector(resize(shift_right(");
+    fixed_emit_value(value, value_format, out, node_generator);
+    out_puts(out, " + (shift_right(");
+    fixed_emit_value(value, value_format, out, node_generator);
+    out_printf(out, ", %d) and ", fixed_width(value_format) - 1);
+    fixed_emit_bits((long long)(((unsigned long long)1 << value_format.fraction_bits) - 1),
+                    fixed_width(value_format), out);
+    out_printf(out, "), %d), %d))", value_format.fraction_bits, (width > 0) ? width : VHDL_BIT_WIDTH);
+    return 1;
+}
+
+int fixed_element_value(const char *array, const char *literal, long long *value)
+{
+    FixedFormat format = fixed_format_of_signal(array, 1);
+
+    if (format.integer_bits == 0 || literal == NULL)
+    {
+        return 0;
+    }
+    *value = (long long)nearbyint(ldexp(strtod(literal, NULL), format.fraction_bits));
+    return 1;
+}
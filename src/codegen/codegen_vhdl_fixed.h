@@ -0,0 +1,93 @@
+// VHDL Code Generator - Fixed-Point Lowering
+// -------------------------------------------------------------
+// Purpose: Lower float and double signals to scaled two's complement
+//          (Qm.n) so their arithmetic maps onto plain adders and DSP
+//          multipliers instead of being computed as integers
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_FIXED_H
+#define CODEGEN_VHDL_FIXED_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "intern.h"
+
+// -------------------------------------------------------------
+// Fixed-point plan
+// -------------------------------------------------------------
+// Qm.n: m integer bits (sign included) and n fraction bits
+typedef struct {
+    int integer_bits;          // 0 = not fixed-point
+    int fraction_bits;
+} FixedFormat;
+
+typedef struct {
+    InternId name_id;
+    FixedFormat format;
+    int is_array;              // Format of the elements
+} FixedSignal;
+
+// A float/double declaration retyped as intW_t, and its original type
+typedef struct {
+    ASTNode *node;
+    InternId type_id;
+} FixedRetype;
+
+typedef struct {
+    FixedSignal *signals;
+    int signal_count;
+    int signal_capacity;
+    FixedRetype *retyped;
+    int retyped_count;
+    int retyped_capacity;
+    FixedFormat result;        // Format of the result port
+} FixedPlan;
+
+/**
+ * Give the float and double signals of a function a fixed-point format:
+ * "#pragma compi fixed Qm.n" before a declaration, otherwise the default
+ * (parameters and the result always use the default). Their declarations
+ * are retyped as int<m+n>_t, so they are declared with m + n bits.
+ *
+ * @param default_format --fixed-point format (NULL or 0 integer bits = off)
+ * @return Number of fixed-point signals (plan still needs fixed_plan_free,
+ *         which restores the types)
+ */
+int fixed_plan_function(ASTNode *function, const FixedFormat *default_format, FixedPlan *plan);
+
+void fixed_plan_free(FixedPlan *plan);
+
+// Make plan the one the emitters consult on this thread (NULL = none);
+// returns the previously active plan
+const FixedPlan* fixed_plan_activate(const FixedPlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+/**
+ * Emit a binary or unary expression over fixed-point values: + - * /
+ * rescaled in the widest format of their operands, comparisons as signed
+ * compares in a common format
+ *
+ * @return 1 if emitted, 0 if the expression is not fixed-point
+ */
+int fixed_generate_expression(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+/**
+ * Emit value stored into target (a scalar or array name; NULL = the result
+ * port), converted to the target's format: into fixed-point, or from
+ * fixed-point down to an integer (rounding towards minus infinity)
+ *
+ * @return 1 if emitted, 0 if neither side is fixed-point
+ */
+int emit_fixed_store(ASTNode *value, const char *target, int is_array, OutputBuffer *out,
+                     void (*node_generator)(ASTNode*, OutputBuffer*));
+
+/**
+ * Scaled value of a literal of a fixed-point array initializer
+ *
+ * @return 1 and *value set if the array is fixed-point
+ */
+int fixed_element_value(const char *array, const char *literal, long long *value);
+
+#endif // CODEGEN_VHDL_FIXED_H
@@ -0,0 +1,1462 @@
+// VHDL Code Generator - State Machine Lowering Implementation
+// -------------------------------------------------------------
+// A while loop in a clocked process has no bound a synthesis tool can
+// unroll, so functions with data-dependent control are lowered to states
+// instead: one state runs per clock cycle, loops become back edges and
+// break/continue become jumps. The function waits in state_idle until
+// start is '1' and pulses done together with the new result.
+//
+// Signal assignments take effect after the clock edge, so a statement may
+// only share a state with earlier statements whose results it does not
+// read. Runs of straight-line statements are list-scheduled as soon as
+// possible under that rule:
+//     read after write   -> a later state than the writer
+//     write after write  -> the same state or later (the last assignment wins)
+//     write after read   -> the same state or later (the reader sees the old value)
+// A branch condition or return value is evaluated in the last state of the
+// run unless that state assigns something it reads.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_fsm.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_reset.h"
+#include "codegen_vhdl_expressions.h"
+#include "codegen_vhdl_statements.h"
+#include "codegen_vhdl_types.h"
+#include "codegen_vhdl_unroll.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+// Actions and transitions sit one level below the "when" of their state
+#define FSM_STATE_INDENT "    "
+#define FSM_STATES_PER_LINE 8
+
+// Jump whose destination is only known once the construct is lowered
+typedef struct {
+    int state;
+    int alternative;           // Patch the not-taken edge of a branch
+} FsmEdge;
+
+typedef struct {
+    FsmEdge *edges;
+    int count;
+    int capacity;
+} FsmEdgeList;
+
+typedef struct {
+    FsmEdgeList breaks;
+    FsmEdgeList continues;
+} FsmLoop;
+
+static void fsm_lower_sequence(FsmPlan *plan, ASTNode *parent, int first, int last,
+                               FsmLoop *loop, ASTNode *tail, int *current);
+
+// -------------------------------------------------------------
+// Name sets
+// -------------------------------------------------------------
+static int fsm_set_contains(const FsmNameSet *set, InternId id)
+{
+    for (int index = 0; index < set->count; ++index)
+    {
+        if (set->ids[index] == id)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void fsm_set_add(FsmNameSet *set, InternId id)
+{
+    if (fsm_set_contains(set, id))
+    {
+        return;
+    }
+    if (set->count >= set->capacity)
+    {
+        set->capacity = (set->capacity > 0) ? set->capacity * 2 : 8;
+        set->ids = (InternId*)xrealloc(set->ids, (size_t)set->capacity * sizeof(InternId));
+    }
+    set->ids[set->count++] = id;
+}
+
+static void fsm_set_merge(FsmNameSet *set, const FsmNameSet *other)
+{
+    for (int index = 0; index < other->count; ++index)
+    {
+        fsm_set_add(set, other->ids[index]);
+    }
+}
+
+static int fsm_sets_intersect(const FsmNameSet *first, const FsmNameSet *second)
+{
+    for (int index = 0; index < first->count; ++index)
+    {
+        if (fsm_set_contains(second, first->ids[index]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void fsm_set_free(FsmNameSet *set)
+{
+    free(set->ids);
+    memset(set, 0, sizeof(*set));
+}
+
+// -------------------------------------------------------------
+// Helper: signals read and assigned by a statement
+// -------------------------------------------------------------
+static void fsm_collect_reads(const ASTNode *node, FsmNameSet *reads)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+
+    if ((node->type == NODE_EXPRESSION || node->type == NODE_IDENTIFIER) && node->value != NULL &&
+        (isalpha((unsigned char)node->value[0]) || node->value[0] == '_'))
+    {
+        fsm_set_add(reads, intern_cstr(node->value));
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        fsm_collect_reads(node->children[child_index], reads);
+    }
+}
+
+// Element and field assignments write the whole signal
+static void fsm_collect_target(const ASTNode *target, FsmNameSet *reads, FsmNameSet *writes)
+{
+    if (target->type == NODE_INDEX_EXPR && target->num_children == 2)
+    {
+        fsm_collect_target(target->children[FIRST_CHILD_INDEX], reads, writes);
+        fsm_collect_reads(target->children[FIRST_CHILD_INDEX + 1], reads);
+    }
+    else if (target->type == NODE_MEMBER_EXPR && target->num_children > 0)
+    {
+        fsm_collect_target(target->children[FIRST_CHILD_INDEX], reads, writes);
+    }
+    else if (target->value != NULL)
+    {
+        fsm_set_add(writes, intern_cstr(target->value));
+    }
+}
+
+static void fsm_collect_access(const ASTNode *node, FsmNameSet *reads, FsmNameSet *writes)
+{
+    switch (node->type)
+    {
+        case NODE_VAR_DECL:
+            // An array declaration emits no action: its initial value is the signal's
+            if (node->value != NULL && node->array_size == 0)
+            {
+                fsm_set_add(writes, intern_cstr(node->value));
+            }
+            for (int child_index = 0; child_index < node->num_children; ++child_index)
+            {
+                fsm_collect_reads(node->children[child_index], reads);
+            }
+            break;
+
+        case NODE_ASSIGNMENT:
+            if (node->num_children == 2)
+            {
+                fsm_collect_target(node->children[FIRST_CHILD_INDEX], reads, writes);
+                fsm_collect_reads(node->children[FIRST_CHILD_INDEX + 1], reads);
+            }
+            break;
+
+        case NODE_STATEMENT:
+        case NODE_IF_STATEMENT:
+        case NODE_ELSE_IF_STATEMENT:
+        case NODE_ELSE_STATEMENT:
+            for (int child_index = 0; child_index < node->num_children; ++child_index)
+            {
+                fsm_collect_access(node->children[child_index], reads, writes);
+            }
+            break;
+
+        default:
+            fsm_collect_reads(node, reads);
+            break;
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: statements that fit in a single state
+// -------------------------------------------------------------
+static int fsm_if_is_simple(ASTNode *if_node);
+
+static int fsm_statement_is_simple(ASTNode *statement)
+{
+    if (statement->token.id == INTERN_KW_RETURN)
+    {
+        return 0;
+    }
+
+    for (int child_index = 0; child_index < statement->num_children; ++child_index)
+    {
+        ASTNode *child = statement->children[child_index];
+
+        switch (child->type)
+        {
+            case NODE_WHILE_STATEMENT:
+            case NODE_FOR_STATEMENT:
+            case NODE_BREAK_STATEMENT:
+            case NODE_CONTINUE_STATEMENT:
+                return 0;
+
+            case NODE_IF_STATEMENT:
+                if (!fsm_if_is_simple(child))
+                {
+                    return 0;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+    return 1;
+}
+
+// Simple statements none of which reads what an earlier one assigns
+static int fsm_sequence_is_simple(ASTNode *parent, int first)
+{
+    FsmNameSet written = {0};
+    int simple = 1;
+
+    for (int index = first; index < parent->num_children && simple; ++index)
+    {
+        ASTNode *statement = parent->children[index];
+        FsmNameSet reads = {0};
+        FsmNameSet writes = {0};
+
+        if (statement->type != NODE_STATEMENT)
+        {
+            continue;
+        }
+        if (!fsm_statement_is_simple(statement))
+        {
+            simple = 0;
+            break;
+        }
+
+        fsm_collect_access(statement, &reads, &writes);
+        simple = !fsm_sets_intersect(&reads, &written);
+        fsm_set_merge(&written, &writes);
+        fsm_set_free(&reads);
+        fsm_set_free(&writes);
+    }
+
+    fsm_set_free(&written);
+    return simple;
+}
+
+static int fsm_if_is_simple(ASTNode *if_node)
+{
+    if (!fsm_sequence_is_simple(if_node, FIRST_STATEMENT_INDEX))
+    {
+        return 0;
+    }
+
+    for (int branch_index = FIRST_STATEMENT_INDEX; branch_index < if_node->num_children; ++branch_index)
+    {
+        ASTNode *branch = if_node->children[branch_index];
+
+        if (branch->type == NODE_ELSE_IF_STATEMENT &&
+            !fsm_sequence_is_simple(branch, FIRST_STATEMENT_INDEX))
+        {
+            return 0;
+        }
+        if (branch->type == NODE_ELSE_STATEMENT && !fsm_sequence_is_simple(branch, 0))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// continue statements of this loop (nested loops own theirs)
+static int fsm_has_continue(const ASTNode *node)
+{
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        const ASTNode *child = node->children[child_index];
+
+        if (child->type == NODE_CONTINUE_STATEMENT)
+        {
+            return 1;
+        }
+        if (child->type != NODE_WHILE_STATEMENT && child->type != NODE_FOR_STATEMENT &&
+            fsm_has_continue(child))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 1 = always true, 0 = always false, -1 = data dependent
+static int fsm_condition_value(const ASTNode *condition)
+{
+    if (condition->type == NODE_EXPRESSION && is_numeric_literal(condition->value))
+    {
+        return strtoll(condition->value, NULL, 0) != 0;
+    }
+    return -1;
+}
+
+// -------------------------------------------------------------
+// Function selection
+// -------------------------------------------------------------
+static int fsm_control_needed(ASTNode *node)
+{
+    LoopBounds bounds;
+
+    switch (node->type)
+    {
+        case NODE_WHILE_STATEMENT:
+        case NODE_BREAK_STATEMENT:
+        case NODE_CONTINUE_STATEMENT:
+            return 1;
+
+        case NODE_FOR_STATEMENT:
+            if (!analyze_for_loop(node, &bounds))
+            {
+                return 1;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (fsm_control_needed(node->children[child_index]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int fsm_function_needed(ASTNode *function)
+{
+    return function != NULL && fsm_control_needed(function);
+}
+
+// -------------------------------------------------------------
+// States and edges
+// -------------------------------------------------------------
+static int fsm_add_state(FsmPlan *plan)
+{
+    FsmState *state = NULL;
+
+    if (plan->state_count >= plan->state_capacity)
+    {
+        plan->state_capacity = (plan->state_capacity > 0) ? plan->state_capacity * 2 : 16;
+        plan->states = (FsmState*)xrealloc(plan->states,
+            (size_t)plan->state_capacity * sizeof(FsmState));
+    }
+
+    state = &plan->states[plan->state_count];
+    memset(state, 0, sizeof(*state));
+    state->transition = FSM_GOTO;
+    state->target = -1;
+    state->alternative = -1;
+    return plan->state_count++;
+}
+
+static void fsm_add_action(FsmPlan *plan, int state_index, ASTNode *action, const FsmNameSet *writes)
+{
+    FsmState *state = &plan->states[state_index];
+
+    if (state->action_count >= state->action_capacity)
+    {
+        state->action_capacity = (state->action_capacity > 0) ? state->action_capacity * 2 : 4;
+        state->actions = (ASTNode**)xrealloc(state->actions,
+            (size_t)state->action_capacity * sizeof(ASTNode*));
+    }
+    state->actions[state->action_count++] = action;
+    fsm_set_merge(&state->writes, writes);
+}
+
+static void fsm_goto(FsmPlan *plan, int from, int to)
+{
+    plan->states[from].transition = FSM_GOTO;
+    plan->states[from].target = to;
+}
+
+static void fsm_branch(FsmPlan *plan, int from, ASTNode *condition, int taken)
+{
+    plan->states[from].transition = FSM_BRANCH;
+    plan->states[from].condition = condition;
+    plan->states[from].target = taken;
+}
+
+static void fsm_edge_add(FsmEdgeList *list, int state, int alternative)
+{
+    if (list->count >= list->capacity)
+    {
+        list->capacity = (list->capacity > 0) ? list->capacity * 2 : 4;
+        list->edges = (FsmEdge*)xrealloc(list->edges, (size_t)list->capacity * sizeof(FsmEdge));
+    }
+    list->edges[list->count].state = state;
+    list->edges[list->count].alternative = alternative;
+    list->count++;
+}
+
+static void fsm_edge_patch(FsmPlan *plan, FsmEdgeList *list, int target)
+{
+    for (int index = 0; index < list->count; ++index)
+    {
+        FsmState *state = &plan->states[list->edges[index].state];
+
+        if (list->edges[index].alternative)
+        {
+            state->alternative = target;
+        }
+        else
+        {
+            state->target = target;
+        }
+    }
+    free(list->edges);
+    memset(list, 0, sizeof(*list));
+}
+
+// -------------------------------------------------------------
+// Block RAM accesses
+// -------------------------------------------------------------
+static void fsm_append_access(MemoryAccess **accesses, int *count, int *capacity, const MemoryAccess *access)
+{
+    if (*count >= *capacity)
+    {
+        *capacity = (*capacity > 0) ? *capacity * 2 : 4;
+        *accesses = (MemoryAccess*)xrealloc(*accesses, (size_t)*capacity * sizeof(MemoryAccess));
+    }
+    (*accesses)[(*count)++] = *access;
+}
+
+// Element reads of block RAM arrays below node (the target of a write is not read)
+static void fsm_collect_memory_reads(FsmPlan *plan, ASTNode *node, ASTNode *parent, int child_index,
+                                     MemoryAccess **accesses, int *count, int *capacity)
+{
+    int memory = memory_find(plan->memories, node);
+
+    if (memory >= 0)
+    {
+        MemoryAccess access = { node, parent, child_index, NULL, memory, 0, -1 };
+
+        // The port output is swapped in through the parent
+        if (parent == NULL)
+        {
+            plan->failed_memory = memory;
+            return;
+        }
+        fsm_append_access(accesses, count, capacity, &access);
+        return;
+    }
+
+    for (int index = 0; index < node->num_children; ++index)
+    {
+        if (node->type == NODE_ASSIGNMENT && index == FIRST_CHILD_INDEX &&
+            memory_find(plan->memories, node->children[index]) >= 0)
+        {
+            continue;
+        }
+        fsm_collect_memory_reads(plan, node->children[index], node, index, accesses, count, capacity);
+    }
+}
+
+// mem[index] = value as a statement of its own
+static int fsm_memory_write(const FsmPlan *plan, ASTNode *action, MemoryAccess *write)
+{
+    ASTNode *assignment = unwrap_statement_node(action);
+    int memory = -1;
+
+    if (plan->memories == NULL || assignment->type != NODE_ASSIGNMENT || assignment->num_children != 2)
+    {
+        return 0;
+    }
+    memory = memory_find(plan->memories, assignment->children[FIRST_CHILD_INDEX]);
+    if (memory < 0)
+    {
+        return 0;
+    }
+
+    if (write != NULL)
+    {
+        MemoryAccess access = { assignment->children[FIRST_CHILD_INDEX], NULL, 0,
+                                assignment->children[FIRST_CHILD_INDEX + 1], memory, 0, -1 };
+        *write = access;
+    }
+    return 1;
+}
+
+// The write enable is selected by the state only, so conditional writes need states of their own
+static int fsm_writes_memory(const FsmPlan *plan, ASTNode *node)
+{
+    if (plan->memories == NULL)
+    {
+        return 0;
+    }
+    if (node->type == NODE_ASSIGNMENT && node->num_children == 2 &&
+        memory_find(plan->memories, node->children[FIRST_CHILD_INDEX]) >= 0)
+    {
+        return 1;
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (fsm_writes_memory(plan, node->children[child_index]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// At most MEMORY_PORT_COUNT reads of one memory can be served by one state
+static int fsm_reads_exceed_ports(FsmPlan *plan, const MemoryAccess *accesses, int count)
+{
+    for (int index = 0; index < count; ++index)
+    {
+        int same = 0;
+
+        for (int other = 0; other < count; ++other)
+        {
+            if (accesses[other].memory == accesses[index].memory && accesses[other].value == NULL)
+            {
+                same++;
+            }
+        }
+        if (accesses[index].value == NULL && same > MEMORY_PORT_COUNT)
+        {
+            plan->failed_memory = accesses[index].memory;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------
+// List scheduling of straight-line statements
+// -------------------------------------------------------------
+static void fsm_push_pending(FsmPlan *plan, ASTNode *node)
+{
+    FsmPendingAction *action = NULL;
+    MemoryAccess write;
+    int access_capacity = 0;
+
+    if (plan->pending_count >= plan->pending_capacity)
+    {
+        plan->pending_capacity = (plan->pending_capacity > 0) ? plan->pending_capacity * 2 : 16;
+        plan->pending = (FsmPendingAction*)xrealloc(plan->pending,
+            (size_t)plan->pending_capacity * sizeof(FsmPendingAction));
+    }
+
+    action = &plan->pending[plan->pending_count++];
+    memset(action, 0, sizeof(*action));
+    action->node = node;
+    fsm_collect_access(node, &action->reads, &action->writes);
+
+    if (plan->memories != NULL)
+    {
+        fsm_collect_memory_reads(plan, node, NULL, 0, &action->accesses, &action->access_count, &access_capacity);
+        if (fsm_memory_write(plan, node, &write))
+        {
+            fsm_append_access(&action->accesses, &action->access_count, &access_capacity, &write);
+        }
+        fsm_reads_exceed_ports(plan, action->accesses, action->access_count);
+    }
+}
+
+static void fsm_free_pending(FsmPendingAction *action)
+{
+    fsm_set_free(&action->reads);
+    fsm_set_free(&action->writes);
+    free(action->accesses);
+    action->accesses = NULL;
+    action->access_count = 0;
+}
+
+// Level of the state presenting an access of a pending action
+static int fsm_access_level(const FsmPendingAction *action, const MemoryAccess *access)
+{
+    return (access->value == NULL) ? action->level - 1 : action->level;
+}
+
+// Give every access of pending[index] a free port at its level (0 = none left)
+static int fsm_assign_ports(FsmPlan *plan, int index)
+{
+    FsmPendingAction *action = &plan->pending[index];
+
+    for (int access_index = 0; access_index < action->access_count; ++access_index)
+    {
+        MemoryAccess *access = &action->accesses[access_index];
+        int level = fsm_access_level(action, access);
+        int port = 0;
+        int port_limit = (access->value == NULL) ? MEMORY_PORT_COUNT : 1;
+
+        for (port = 0; port < port_limit; ++port)
+        {
+            int busy = 0;
+
+            for (int earlier = 0; earlier <= index && !busy; ++earlier)
+            {
+                const FsmPendingAction *before = &plan->pending[earlier];
+                int before_count = (earlier == index) ? access_index : before->access_count;
+
+                for (int other = 0; other < before_count && !busy; ++other)
+                {
+                    const MemoryAccess *taken = &before->accesses[other];
+
+                    busy = (taken->memory == access->memory && taken->port == port &&
+                            fsm_access_level(before, taken) == level);
+                }
+            }
+            if (!busy)
+            {
+                break;
+            }
+        }
+        if (port == port_limit)
+        {
+            return 0;
+        }
+        access->port = port;
+    }
+    return 1;
+}
+
+// Reads present their address one state ahead (after every writer of the
+// index and of the memory), and each memory port serves one access per state
+static void fsm_place_memory_accesses(FsmPlan *plan, int index)
+{
+    FsmPendingAction *action = &plan->pending[index];
+    FsmNameSet addressed = {0};
+    int reads_memory = 0;
+
+    for (int access_index = 0; access_index < action->access_count; ++access_index)
+    {
+        if (action->accesses[access_index].value == NULL)
+        {
+            reads_memory = 1;
+            fsm_collect_reads(action->accesses[access_index].node, &addressed);
+        }
+    }
+
+    if (reads_memory)
+    {
+        int earliest = 1;
+
+        for (int earlier = 0; earlier < index; ++earlier)
+        {
+            const FsmPendingAction *before = &plan->pending[earlier];
+
+            if (fsm_sets_intersect(&addressed, &before->writes) && before->level + 2 > earliest)
+            {
+                earliest = before->level + 2;
+            }
+        }
+        if (earliest > action->level)
+        {
+            action->level = earliest;
+        }
+    }
+    fsm_set_free(&addressed);
+
+    if (plan->failed_memory >= 0)
+    {
+        return;
+    }
+    while (!fsm_assign_ports(plan, index))
+    {
+        action->level++;
+    }
+}
+
+// Schedule the pending statements from *current on; *current becomes the last state used
+static void fsm_flush(FsmPlan *plan, int *current)
+{
+    int last_level = 0;
+    int *level_states = NULL;
+
+    if (plan->pending_count == 0)
+    {
+        return;
+    }
+
+    if (plan->states[*current].action_count > 0 || plan->states[*current].memory_accesses > 0)
+    {
+        int next = fsm_add_state(plan);
+
+        fsm_goto(plan, *current, next);
+        *current = next;
+    }
+
+    for (int index = 0; index < plan->pending_count; ++index)
+    {
+        FsmPendingAction *action = &plan->pending[index];
+
+        for (int earlier = 0; earlier < index; ++earlier)
+        {
+            const FsmPendingAction *before = &plan->pending[earlier];
+            int earliest = before->level;
+
+            if (fsm_sets_intersect(&action->reads, &before->writes))
+            {
+                earliest = before->level + 1;
+            }
+            else if (!fsm_sets_intersect(&action->writes, &before->writes) &&
+                     !fsm_sets_intersect(&action->writes, &before->reads))
+            {
+                continue;
+            }
+            if (earliest > action->level)
+            {
+                action->level = earliest;
+            }
+        }
+        if (action->access_count > 0)
+        {
+            fsm_place_memory_accesses(plan, index);
+        }
+        if (action->level > last_level)
+        {
+            last_level = action->level;
+        }
+    }
+
+    level_states = (int*)xrealloc(NULL, (size_t)(last_level + 1) * sizeof(int));
+    level_states[0] = *current;
+    for (int level = 1; level <= last_level; ++level)
+    {
+        level_states[level] = fsm_add_state(plan);
+        fsm_goto(plan, level_states[level - 1], level_states[level]);
+    }
+
+    for (int index = 0; index < plan->pending_count; ++index)
+    {
+        FsmPendingAction *action = &plan->pending[index];
+
+        fsm_add_action(plan, level_states[action->level], action->node, &action->writes);
+        for (int access_index = 0; access_index < action->access_count && plan->failed_memory < 0; ++access_index)
+        {
+            MemoryAccess *access = &action->accesses[access_index];
+
+            access->state = level_states[fsm_access_level(action, access)];
+            plan->states[access->state].memory_accesses++;
+            memory_add_access(plan->memories, access);
+        }
+        fsm_free_pending(action);
+    }
+
+    *current = level_states[last_level];
+    plan->pending_count = 0;
+    free(level_states);
+}
+
+// Present the block RAM reads of an expression in *current; it is evaluated in the state after
+static void fsm_request_reads(FsmPlan *plan, int *current, ASTNode *expression)
+{
+    MemoryAccess *accesses = NULL;
+    int count = 0;
+    int capacity = 0;
+    int next = 0;
+    FsmNameSet addressed = {0};
+
+    if (plan->memories == NULL)
+    {
+        return;
+    }
+    fsm_collect_memory_reads(plan, expression, NULL, 0, &accesses, &count, &capacity);
+    if (count == 0 || fsm_reads_exceed_ports(plan, accesses, count))
+    {
+        free(accesses);
+        return;
+    }
+
+    for (int index = 0; index < count; ++index)
+    {
+        fsm_collect_reads(accesses[index].node, &addressed);
+    }
+    if (plan->states[*current].memory_accesses > 0 ||
+        fsm_sets_intersect(&addressed, &plan->states[*current].writes))
+    {
+        next = fsm_add_state(plan);
+        fsm_goto(plan, *current, next);
+        *current = next;
+    }
+
+    for (int index = 0; index < count; ++index)
+    {
+        // Ports in order of appearance, per memory
+        for (int earlier = 0; earlier < index; ++earlier)
+        {
+            if (accesses[earlier].memory == accesses[index].memory)
+            {
+                accesses[index].port++;
+            }
+        }
+        accesses[index].state = *current;
+        plan->states[*current].memory_accesses++;
+        memory_add_access(plan->memories, &accesses[index]);
+    }
+
+    next = fsm_add_state(plan);
+    fsm_goto(plan, *current, next);
+    *current = next;
+    fsm_set_free(&addressed);
+    free(accesses);
+}
+
+// State that evaluates expression: *current, or a fresh one after it when *current assigns an input
+static int fsm_decision_state(FsmPlan *plan, int *current, ASTNode *expression)
+{
+    FsmNameSet reads = {0};
+
+    fsm_request_reads(plan, current, expression);
+    fsm_collect_reads(expression, &reads);
+    if (fsm_sets_intersect(&reads, &plan->states[*current].writes))
+    {
+        int next = fsm_add_state(plan);
+
+        fsm_goto(plan, *current, next);
+        *current = next;
+    }
+    fsm_set_free(&reads);
+    return *current;
+}
+
+// Test the loop condition after state from; body < 0 allocates the body entry
+static int fsm_test_condition(FsmPlan *plan, int from, ASTNode *condition, int body, FsmEdgeList *exits)
+{
+    int always = (fsm_condition_value(condition) == 1);
+    int decision = from;
+
+    if (!always)
+    {
+        decision = fsm_decision_state(plan, &decision, condition);
+    }
+    if (body < 0)
+    {
+        body = fsm_add_state(plan);
+    }
+
+    if (always)
+    {
+        fsm_goto(plan, decision, body);
+    }
+    else
+    {
+        fsm_branch(plan, decision, condition, body);
+        fsm_edge_add(exits, decision, 1);
+    }
+    return body;
+}
+
+// -------------------------------------------------------------
+// Control constructs
+// -------------------------------------------------------------
+static void fsm_lower_loop(FsmPlan *plan, ASTNode *loop_node, int *current)
+{
+    ASTNode *condition = NULL;
+    ASTNode *increment = NULL;
+    int first_body = FIRST_STATEMENT_INDEX;
+    int last_body = loop_node->num_children;
+    int has_continue = fsm_has_continue(loop_node);
+    FsmLoop loop;
+    FsmEdgeList exits = {0};
+    int body = 0;
+    int end = 0;
+
+    if (loop_node->num_children == 0)
+    {
+        return;
+    }
+
+    if (loop_node->type == NODE_FOR_STATEMENT)
+    {
+        // Same layout generate_for_loop reads: [init], condition, body..., [increment]
+        ASTNode *init = unwrap_statement_node(loop_node->children[FIRST_CHILD_INDEX]);
+        int condition_index = 0;
+
+        if (init->type == NODE_ASSIGNMENT || init->type == NODE_VAR_DECL)
+        {
+            fsm_push_pending(plan, init);
+            condition_index = 1;
+        }
+        if (condition_index >= loop_node->num_children)
+        {
+            fsm_flush(plan, current);
+            return;
+        }
+        if (loop_node->children[last_body - 1]->type == NODE_ASSIGNMENT && last_body - 1 != condition_index)
+        {
+            increment = loop_node->children[last_body - 1];
+            last_body--;
+        }
+        condition = loop_node->children[condition_index];
+        first_body = condition_index + 1;
+    }
+    else
+    {
+        condition = loop_node->children[FIRST_CHILD_INDEX];
+    }
+
+    fsm_flush(plan, current);
+    if (fsm_condition_value(condition) == 0)
+    {
+        return;
+    }
+
+    memset(&loop, 0, sizeof(loop));
+    body = fsm_test_condition(plan, *current, condition, -1, &exits);
+    end = body;
+    fsm_lower_sequence(plan, loop_node, first_body, last_body, &loop,
+                       has_continue ? NULL : increment, &end);
+
+    if (has_continue)
+    {
+        // Latch state shared by the end of the body and every continue
+        int latch = fsm_add_state(plan);
+
+        if (end >= 0)
+        {
+            fsm_goto(plan, end, latch);
+        }
+        fsm_edge_patch(plan, &loop.continues, latch);
+        if (increment != NULL)
+        {
+            fsm_push_pending(plan, increment);
+            fsm_flush(plan, &latch);
+        }
+        end = latch;
+    }
+    if (end >= 0)
+    {
+        fsm_test_condition(plan, end, condition, body, &exits);
+    }
+
+    *current = fsm_add_state(plan);
+    fsm_edge_patch(plan, &exits, *current);
+    fsm_edge_patch(plan, &loop.breaks, *current);
+    free(loop.continues.edges);
+}
+
+static void fsm_lower_if(FsmPlan *plan, ASTNode *if_node, FsmLoop *loop, int *current)
+{
+    FsmEdgeList joins = {0};
+    int open_test = fsm_decision_state(plan, current, if_node->children[FIRST_CHILD_INDEX]);
+    int arm = fsm_add_state(plan);
+
+    fsm_branch(plan, open_test, if_node->children[FIRST_CHILD_INDEX], arm);
+    fsm_lower_sequence(plan, if_node, FIRST_STATEMENT_INDEX, if_node->num_children, loop, NULL, &arm);
+    if (arm >= 0)
+    {
+        fsm_edge_add(&joins, arm, 0);
+    }
+
+    for (int branch_index = FIRST_STATEMENT_INDEX; branch_index < if_node->num_children; ++branch_index)
+    {
+        ASTNode *branch = if_node->children[branch_index];
+        int first = 0;
+
+        if (branch->type == NODE_ELSE_IF_STATEMENT)
+        {
+            int test = fsm_add_state(plan);
+
+            plan->states[open_test].alternative = test;
+            fsm_decision_state(plan, &test, branch->children[FIRST_CHILD_INDEX]);
+            arm = fsm_add_state(plan);
+            fsm_branch(plan, test, branch->children[FIRST_CHILD_INDEX], arm);
+            open_test = test;
+            first = FIRST_STATEMENT_INDEX;
+        }
+        else if (branch->type == NODE_ELSE_STATEMENT)
+        {
+            arm = fsm_add_state(plan);
+            plan->states[open_test].alternative = arm;
+            open_test = -1;
+        }
+        else
+        {
+            continue;
+        }
+
+        fsm_lower_sequence(plan, branch, first, branch->num_children, loop, NULL, &arm);
+        if (arm >= 0)
+        {
+            fsm_edge_add(&joins, arm, 0);
+        }
+    }
+    if (open_test >= 0)
+    {
+        fsm_edge_add(&joins, open_test, 1);
+    }
+
+    if (joins.count == 0)
+    {
+        *current = -1;
+        return;
+    }
+    *current = fsm_add_state(plan);
+    fsm_edge_patch(plan, &joins, *current);
+}
+
+// Lower parent->children[first, last); *current is -1 once control never falls through
+static void fsm_lower_sequence(FsmPlan *plan, ASTNode *parent, int first, int last,
+                               FsmLoop *loop, ASTNode *tail, int *current)
+{
+    for (int index = first; index < last && *current >= 0; ++index)
+    {
+        ASTNode *statement = parent->children[index];
+        ASTNode *construct = NULL;
+
+        if (statement->type != NODE_STATEMENT)
+        {
+            continue;
+        }
+
+        if (statement->token.id == INTERN_KW_RETURN)
+        {
+            int returning = 0;
+
+            fsm_flush(plan, current);
+            returning = fsm_decision_state(plan, current, statement);
+            plan->states[returning].transition = FSM_RETURN;
+            plan->states[returning].result = statement;
+            *current = -1;
+            continue;
+        }
+
+        if (fsm_statement_is_simple(statement) && !(statement->num_children > 0 &&
+            statement->children[FIRST_CHILD_INDEX]->type == NODE_IF_STATEMENT &&
+            fsm_writes_memory(plan, statement)))
+        {
+            fsm_push_pending(plan, statement);
+            continue;
+        }
+
+        construct = statement->children[FIRST_CHILD_INDEX];
+        switch (construct->type)
+        {
+            case NODE_WHILE_STATEMENT:
+            case NODE_FOR_STATEMENT:
+                // Flushes itself, so a for initializer joins the statements before it
+                fsm_lower_loop(plan, construct, current);
+                break;
+
+            case NODE_IF_STATEMENT:
+                fsm_flush(plan, current);
+                fsm_lower_if(plan, construct, loop, current);
+                break;
+
+            case NODE_BREAK_STATEMENT:
+            case NODE_CONTINUE_STATEMENT:
+                fsm_flush(plan, current);
+                if (loop != NULL)
+                {
+                    fsm_edge_add(construct->type == NODE_BREAK_STATEMENT ? &loop->breaks : &loop->continues,
+                                 *current, 0);
+                    *current = -1;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (tail != NULL && *current >= 0)
+    {
+        fsm_push_pending(plan, tail);
+    }
+    if (*current >= 0)
+    {
+        fsm_flush(plan, current);
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: drop states that only jump on
+// -------------------------------------------------------------
+static int fsm_forward(const FsmPlan *plan, int target)
+{
+    for (int hops = 0; target >= 0 && hops < plan->state_count; ++hops)
+    {
+        const FsmState *state = &plan->states[target];
+
+        if (state->action_count > 0 || state->memory_accesses > 0 ||
+            state->transition != FSM_GOTO || state->target == target)
+        {
+            break;
+        }
+        target = state->target;
+    }
+    return target;
+}
+
+// Jumps through empty states go straight to their destination, then the
+// states still reachable from the entry are renumbered in program order
+static void fsm_compact(FsmPlan *plan)
+{
+    int *renumbered = (int*)xrealloc(NULL, (size_t)plan->state_count * sizeof(int));
+    int *stack = (int*)xrealloc(NULL, (size_t)plan->state_count * sizeof(int));
+    int stack_count = 0;
+    int kept = 0;
+    int entry = 0;
+
+    for (int state_index = 0; state_index < plan->state_count; ++state_index)
+    {
+        FsmState *state = &plan->states[state_index];
+
+        renumbered[state_index] = -1;
+        if (state->transition == FSM_RETURN)
+        {
+            continue;
+        }
+        state->target = fsm_forward(plan, state->target);
+        if (state->transition == FSM_BRANCH)
+        {
+            state->alternative = fsm_forward(plan, state->alternative);
+            if (state->alternative == state->target)
+            {
+                state->transition = FSM_GOTO;
+            }
+        }
+    }
+
+    // Mark reachable states (-2), the entry stays state_0
+    entry = fsm_forward(plan, 0);
+    renumbered[entry] = -2;
+    stack[stack_count++] = entry;
+    while (stack_count > 0)
+    {
+        const FsmState *state = &plan->states[stack[--stack_count]];
+        int successors[2] = { -1, -1 };
+
+        if (state->transition != FSM_RETURN)
+        {
+            successors[0] = state->target;
+        }
+        if (state->transition == FSM_BRANCH)
+        {
+            successors[1] = state->alternative;
+        }
+        for (int successor = 0; successor < 2; ++successor)
+        {
+            if (successors[successor] >= 0 && renumbered[successors[successor]] == -1)
+            {
+                renumbered[successors[successor]] = -2;
+                stack[stack_count++] = successors[successor];
+            }
+        }
+    }
+
+    renumbered[entry] = kept++;
+    for (int state_index = 0; state_index < plan->state_count; ++state_index)
+    {
+        if (renumbered[state_index] == -2)
+        {
+            renumbered[state_index] = kept++;
+        }
+    }
+
+    for (int state_index = 0; state_index < plan->state_count; ++state_index)
+    {
+        FsmState state = plan->states[state_index];
+
+        if (renumbered[state_index] < 0)
+        {
+            free(state.actions);
+            fsm_set_free(&state.writes);
+            continue;
+        }
+        if (state.target >= 0)
+        {
+            state.target = renumbered[state.target];
+        }
+        if (state.alternative >= 0)
+        {
+            state.alternative = renumbered[state.alternative];
+        }
+        // Kept states only move down, so nothing still unread is overwritten
+        plan->states[renumbered[state_index]] = state;
+    }
+    plan->state_count = kept;
+
+    if (plan->memories != NULL)
+    {
+        MemoryPlan *memories = plan->memories;
+        int access_kept = 0;
+
+        for (int index = 0; index < memories->access_count; ++index)
+        {
+            MemoryAccess access = memories->accesses[index];
+
+            if (renumbered[access.state] >= 0)
+            {
+                access.state = renumbered[access.state];
+                memories->accesses[access_kept++] = access;
+            }
+        }
+        memories->access_count = access_kept;
+    }
+
+    free(renumbered);
+    free(stack);
+}
+
+// -------------------------------------------------------------
+// Plan construction
+// -------------------------------------------------------------
+int fsm_plan_function(ASTNode *function, MemoryPlan *memories, FsmPlan *plan)
+{
+    int current = 0;
+
+    for (;;)
+    {
+        memset(plan, 0, sizeof(*plan));
+        plan->function = function;
+        plan->memories = memories;
+        plan->failed_memory = -1;
+        current = fsm_add_state(plan);
+        fsm_lower_sequence(plan, function, 0, function->num_children, NULL, NULL, &current);
+        if (plan->failed_memory < 0)
+        {
+            break;
+        }
+
+        // Retry with that array in registers
+        memory_drop(memories, plan->failed_memory);
+        fsm_plan_free(plan);
+    }
+
+    // Falling off the end finishes without a result
+    if (current >= 0)
+    {
+        plan->states[current].transition = FSM_RETURN;
+        plan->states[current].result = NULL;
+    }
+    fsm_compact(plan);
+    return plan->state_count;
+}
+
+void fsm_plan_free(FsmPlan *plan)
+{
+    for (int state_index = 0; state_index < plan->state_count; ++state_index)
+    {
+        free(plan->states[state_index].actions);
+        fsm_set_free(&plan->states[state_index].writes);
+    }
+    for (int index = 0; index < plan->pending_count; ++index)
+    {
+        fsm_free_pending(&plan->pending[index]);
+    }
+    free(plan->states);
+    free(plan->pending);
+    memset(plan, 0, sizeof(*plan));
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Locals of loop and if bodies hold their value across states, so they need signals too
+static void emit_fsm_nested_signals(ASTNode *node, int nested, FsmNameSet *declared, OutputBuffer *out)
+{
+    int is_body_owner = (node->type == NODE_WHILE_STATEMENT || node->type == NODE_FOR_STATEMENT ||
+                         node->type == NODE_IF_STATEMENT || node->type == NODE_ELSE_IF_STATEMENT ||
+                         node->type == NODE_ELSE_STATEMENT);
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        ASTNode *child = node->children[child_index];
+
+        if (child->type == NODE_VAR_DECL && child->value != NULL)
+        {
+            InternId name_id = intern_cstr(child->value);
+
+            if (!fsm_set_contains(declared, name_id))
+            {
+                fsm_set_add(declared, name_id);
+                if (nested)
+                {
+                    process_variable_declaration_for_signals(child, out);
+                }
+            }
+            continue;
+        }
+        emit_fsm_nested_signals(child, nested || (is_body_owner && child->type == NODE_STATEMENT),
+                                declared, out);
+    }
+}
+
+void emit_fsm_signals(const FsmPlan *plan, OutputBuffer *out)
+{
+    FsmNameSet declared = {0};
+
+    emit_fsm_nested_signals(plan->function, 0, &declared, out);
+    fsm_set_free(&declared);
+
+    out_puts(out, "  type state_type is (state_idle");
+    for (int state_index = 0; state_index < plan->state_count; ++state_index)
+    {
+        if ((state_index + 1) % FSM_STATES_PER_LINE == 0)
+        {
+            out_printf(out, ",\n                      state_%d", state_index);
+        }
+        else
+        {
+            out_printf(out, ", state_%d", state_index);
+        }
+    }
+    out_puts(out, ");\n");
+    out_puts(out, "  signal state : state_type");
+    emit_power_up_value("state_idle", out);
+    out_puts(out, ";\n");
+}
+
+void emit_fsm_reset(OutputBuffer *out)
+{
+    out_puts(out, "      state <= state_idle;\n");
+    out_puts(out, "      done <= '0';\n");
+}
+
+// -------------------------------------------------------------
+// Helper: statement output moved under the "when" of its state
+// -------------------------------------------------------------
+static void emit_fsm_indented(OutputBuffer *lines, OutputBuffer *out)
+{
+    size_t position = 0;
+
+    while (position < lines->length)
+    {
+        const char *line = lines->data + position;
+        const char *end = memchr(line, '\n', lines->length - position);
+        size_t length = (end != NULL) ? (size_t)(end - line) + 1 : lines->length - position;
+
+        out_puts(out, FSM_STATE_INDENT);
+        out_write(out, line, length);
+        position += length;
+    }
+    // Keep the allocation for the next state
+    lines->length = 0;
+}
+
+static void emit_fsm_action(const FsmPlan *plan, ASTNode *action, OutputBuffer *out,
+                            void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    // Stored by the RAM process from the port signals
+    if (fsm_memory_write(plan, action, NULL))
+    {
+        return;
+    }
+
+    switch (action->type)
+    {
+        case NODE_ASSIGNMENT:
+            emit_variable_assignment(action, out, INDENT_LEVEL_3, node_generator);
+            break;
+
+        case NODE_VAR_DECL:
+            if (action->array_size == 0)
+            {
+                emit_variable_initializer(action, out, INDENT_LEVEL_3, node_generator);
+            }
+            break;
+
+        default:
+            node_generator(action, out);
+            break;
+    }
+}
+
+static void emit_fsm_next(int target, OutputBuffer *out, const char *indentation)
+{
+    if (target >= 0)
+    {
+        out_printf(out, "%sstate <= state_%d;\n", indentation, target);
+    }
+    else
+    {
+        out_printf(out, "%sstate <= state_idle;\n", indentation);
+    }
+}
+
+void emit_fsm_states(const FsmPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    OutputBuffer lines;
+
+    output_buffer_init(&lines, NULL);
+    out_puts(out, "      done <= '0';\n");
+    out_puts(out, "      case state is\n");
+    out_puts(out, "        when state_idle =>\n");
+    out_puts(out, "          if start = '1' then\n");
+    emit_fsm_next(0, out, "            ");
+    out_puts(out, "          end if;\n");
+
+    for (int state_index = 0; state_index < plan->state_count; ++state_index)
+    {
+        const FsmState *state = &plan->states[state_index];
+
+        out_printf(out, "        when state_%d =>\n", state_index);
+        for (int access_index = 0; plan->memories != NULL && access_index < plan->memories->access_count; ++access_index)
+        {
+            const MemoryAccess *access = &plan->memories->accesses[access_index];
+
+            if (access->state == state_index)
+            {
+                out_printf(out, "          -- %s port %c: %s\n",
+                           plan->memories->arrays[access->memory].name,
+                           'a' + access->port, (access->value != NULL) ? "write" : "address");
+            }
+        }
+        for (int action_index = 0; action_index < state->action_count; ++action_index)
+        {
+            emit_fsm_action(plan, state->actions[action_index], &lines, node_generator);
+        }
+        emit_fsm_indented(&lines, out);
+
+        switch (state->transition)
+        {
+            case FSM_GOTO:
+                emit_fsm_next(state->target, out, "          ");
+                break;
+
+            case FSM_BRANCH:
+                out_puts(out, "          if ");
+                emit_conditional_expression(state->condition, out);
+                out_puts(out, " then\n");
+                emit_fsm_next(state->target, out, "            ");
+                out_puts(out, "          else\n");
+                emit_fsm_next(state->alternative, out, "            ");
+                out_puts(out, "          end if;\n");
+                break;
+
+            case FSM_RETURN:
+                if (state->result != NULL)
+                {
+                    node_generator(state->result, &lines);
+                    emit_fsm_indented(&lines, out);
+                }
+                out_puts(out, "          done <= '1';\n");
+                out_puts(out, "          state <= state_idle;\n");
+                break;
+        }
+    }
+
+    out_puts(out, "      end case;\n");
+    output_buffer_free(&lines);
+}
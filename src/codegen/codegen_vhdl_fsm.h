@@ -0,0 +1,100 @@
+// VHDL Code Generator - State Machine Lowering
+// -------------------------------------------------------------
+// Purpose: Lower functions with data-dependent control (while loops,
+//          break, continue) to an explicit state machine that runs one
+//          state per clock cycle behind a start/done handshake
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_FSM_H
+#define CODEGEN_VHDL_FSM_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "intern.h"
+#include "codegen_vhdl_memory.h"
+
+// -------------------------------------------------------------
+// State machine plan
+// -------------------------------------------------------------
+typedef enum {
+    FSM_GOTO,                  // Unconditionally to target
+    FSM_BRANCH,                // condition ? target : alternative
+    FSM_RETURN                 // Drive result, pulse done, back to state_idle
+} FsmTransition;
+
+typedef struct {
+    InternId *ids;
+    int count;
+    int capacity;
+} FsmNameSet;
+
+typedef struct {
+    ASTNode **actions;         // Statements executed in this state, in program order
+    int action_count;
+    int action_capacity;
+    FsmNameSet writes;         // Signals assigned by the actions
+    FsmTransition transition;
+    ASTNode *condition;        // FSM_BRANCH
+    int target;
+    int alternative;
+    ASTNode *result;           // FSM_RETURN: return statement (NULL = no value)
+    int memory_accesses;       // Block RAM addresses presented in this state
+} FsmState;
+
+// Simple statement waiting to be scheduled into states
+typedef struct {
+    ASTNode *node;
+    FsmNameSet reads;
+    FsmNameSet writes;
+    int level;                 // State offset assigned by the scheduler
+    MemoryAccess *accesses;    // Block RAM reads and write (port and state still unset)
+    int access_count;
+} FsmPendingAction;
+
+typedef struct {
+    ASTNode *function;
+    MemoryPlan *memories;      // Arrays in block RAM (NULL = none)
+    int failed_memory;         // Memory whose accesses could not be scheduled (-1 = none)
+    FsmState *states;          // state_<index>; state_0 follows state_idle on start
+    int state_count;
+    int state_capacity;
+    FsmPendingAction *pending;
+    int pending_count;
+    int pending_capacity;
+} FsmPlan;
+
+/**
+ * Whether a function needs the state machine: it has a while loop, a
+ * break or continue, or a for loop without a constant trip count (functions
+ * with block RAM arrays are sequenced as well, see memory_plan_function)
+ */
+int fsm_function_needed(ASTNode *function);
+
+/**
+ * Lower the body of a function to states. Runs of simple statements are
+ * list-scheduled: a statement shares the earliest state that none of its
+ * inputs are still being computed in. Reads of block RAM arrays present
+ * their address one state before the value is used; a memory whose reads
+ * cannot be scheduled that way is dropped back to registers.
+ *
+ * @param memories Block RAM arrays of the function (may be NULL)
+ * @return Number of states (plan still needs fsm_plan_free)
+ */
+int fsm_plan_function(ASTNode *function, MemoryPlan *memories, FsmPlan *plan);
+
+void fsm_plan_free(FsmPlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Architecture declarations of the state type, the state register and the
+// locals declared inside loops and ifs (the top-level ones are declared as usual)
+void emit_fsm_signals(const FsmPlan *plan, OutputBuffer *out);
+
+// Reset branch assignments of the state register and done
+void emit_fsm_reset(OutputBuffer *out);
+
+// Clocked branch: the case statement over all states
+void emit_fsm_states(const FsmPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+#endif // CODEGEN_VHDL_FSM_H
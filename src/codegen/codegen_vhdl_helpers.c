@@ -4,10 +4,27 @@
 #include "codegen_vhdl_helpers.h"
 #include "codegen_vhdl_constants.h"
 #include "symbol_structs.h"
+#include "parser_context.h"
+#include "intern.h"
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
 
+static const CodegenOptions s_default_codegen_options = {
+    .unroll_limit = DEFAULT_UNROLL_LIMIT,
+    .bram_threshold = DEFAULT_BRAM_THRESHOLD
+};
+
+// -------------------------------------------------------------
+// Options of the active context
+// -------------------------------------------------------------
+const CodegenOptions* codegen_current_options(void)
+{
+    const CodegenOptions *options = parser_context_current()->codegen;
+
+    return (options != NULL) ? options : &s_default_codegen_options;
+}
+
 // -------------------------------------------------------------
 // Helper function to check if a variable name needs remapping
 // Returns 1 if the variable name conflicts with reserved VHDL port names
@@ -26,37 +43,39 @@ int is_signal_name_reserved(const char *variable_name)
 // Helper function to emit a potentially remapped signal name
 // Writes the signal name to output, adding '_local' suffix if needed
 // -------------------------------------------------------------
-void emit_mapped_signal_name(const char *variable_name, FILE *output_file)
+void emit_mapped_signal_name(const char *variable_name, OutputBuffer *out)
 {
     if (is_signal_name_reserved(variable_name))
     {
-        fprintf(output_file, "%s%s", variable_name, SIGNAL_SUFFIX_LOCAL);
+        out_puts(out, variable_name);
+        out_puts(out, SIGNAL_SUFFIX_LOCAL);
     }
     else
     {
         const char *name_to_emit = (variable_name != NULL) ? variable_name : UNKNOWN_IDENTIFIER;
-        fprintf(output_file, "%s", name_to_emit);
+        out_puts(out, name_to_emit);
     }
 }
 
 // -------------------------------------------------------------
 // Check if operator is a boolean comparison operator
 // -------------------------------------------------------------
-int is_boolean_comparison_operator(const char *operator)
+int is_boolean_comparison_operator(InternId operator)
 {
-    if (operator == NULL)
+    switch (operator)
     {
-        return 0;
+        case INTERN_OP_EQUAL:
+        case INTERN_OP_NOT_EQUAL:
+        case INTERN_OP_LESS:
+        case INTERN_OP_LESS_EQUAL:
+        case INTERN_OP_GREATER:
+        case INTERN_OP_GREATER_EQUAL:
+        case INTERN_OP_LOGICAL_AND:
+        case INTERN_OP_LOGICAL_OR:
+            return 1;
+        default:
+            return 0;
     }
-
-    return (strcmp(operator, OP_EQUAL) == 0 ||
-            strcmp(operator, OP_NOT_EQUAL) == 0 ||
-            strcmp(operator, OP_LESS_THAN) == 0 ||
-            strcmp(operator, OP_LESS_EQUAL) == 0 ||
-            strcmp(operator, OP_GREATER_THAN) == 0 ||
-            strcmp(operator, OP_GREATER_EQUAL) == 0 ||
-            strcmp(operator, OP_LOGICAL_AND) == 0 ||
-            strcmp(operator, OP_LOGICAL_OR) == 0);
 }
 
 // -------------------------------------------------------------
@@ -71,12 +90,10 @@ int is_node_boolean_expression(ASTNode *node)
     
     if (node->type == NODE_BINARY_EXPR && node->value != NULL)
     {
-        return is_boolean_comparison_operator(node->value);
+        return is_boolean_comparison_operator(node->token.id);
     }
     
-    if (node->type == NODE_BINARY_OP && 
-        node->value != NULL && 
-        strcmp(node->value, OP_LOGICAL_NOT) == 0)
+    if (node->type == NODE_UNARY_EXPR && node->token.id == INTERN_OP_LOGICAL_NOT)
     {
         return 1;
     }
@@ -168,36 +185,44 @@ int is_negative_numeric_literal(const char *value)
 /**
  * Emit VHDL unsigned cast for a literal value
  * @param value The value to cast (must be numeric)
- * @param output_file Output stream
+ * @param out Output buffer
  */
-void emit_unsigned_cast(const char *value, FILE *output_file)
+void emit_unsigned_cast(const char *value, OutputBuffer *out)
 {
-    fprintf(output_file, "to_unsigned(%s, %d)", value, VHDL_BIT_WIDTH);
+    out_puts(out, "to_unsigned(");
+    out_puts(out, value);
+    out_puts(out, ", ");
+    out_int(out, VHDL_BIT_WIDTH);
+    out_putc(out, ')');
 }
 
 /**
  * Emit VHDL signed cast for a literal value
  * @param value The value to cast (must be numeric)
- * @param output_file Output stream
+ * @param out Output buffer
  */
-void emit_signed_cast(const char *value, FILE *output_file)
+void emit_signed_cast(const char *value, OutputBuffer *out)
 {
-    fprintf(output_file, "to_signed(%s, %d)", value, VHDL_BIT_WIDTH);
+    out_puts(out, "to_signed(");
+    out_puts(out, value);
+    out_puts(out, ", ");
+    out_int(out, VHDL_BIT_WIDTH);
+    out_putc(out, ')');
 }
 
 /**
  * Emit a typed operand with appropriate VHDL casting
  * Handles both literal values and complex expressions
  * @param operand AST node representing the operand
- * @param output_file Output stream
+ * @param out Output buffer
  * @param is_signed 1 if operand should be treated as signed, 0 for unsigned
  * @param node_generator Function pointer to generate nested nodes
  */
-void emit_typed_operand(ASTNode *operand, FILE *output_file, int is_signed, void (*node_generator)(ASTNode*, FILE*))
+void emit_typed_operand(ASTNode *operand, OutputBuffer *out, int is_signed, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     if (operand == NULL)
     {
-        fprintf(output_file, "0");
+        out_puts(out, "0");
         return;
     }
     
@@ -206,36 +231,38 @@ void emit_typed_operand(ASTNode *operand, FILE *output_file, int is_signed, void
     {
         if (is_negative_numeric_literal(operand->value))
         {
-            emit_signed_cast(operand->value, output_file);
+            emit_signed_cast(operand->value, out);
         }
         else if (is_numeric_literal(operand->value))
         {
             if (is_signed)
             {
-                emit_signed_cast(operand->value, output_file);
+                emit_signed_cast(operand->value, out);
             }
             else
             {
-                emit_unsigned_cast(operand->value, output_file);
+                emit_unsigned_cast(operand->value, out);
             }
         }
         else
         {
             // Variable or expression - wrap in unsigned/signed cast
-            fprintf(output_file, "%s(", is_signed ? "signed" : "unsigned");
-            fprintf(output_file, "%s", operand->value);
-            fprintf(output_file, ")");
+            out_puts(out, is_signed ? "signed" : "unsigned");
+            out_putc(out, '(');
+            out_puts(out, operand->value);
+            out_puts(out, ")");
         }
     }
     else
     {
         // Complex expression - recursively generate and wrap
-        fprintf(output_file, "%s(", is_signed ? "signed" : "unsigned");
+        out_puts(out, is_signed ? "signed" : "unsigned");
+        out_putc(out, '(');
         if (node_generator != NULL)
         {
-            node_generator(operand, output_file);
+            node_generator(operand, out);
         }
-        fprintf(output_file, ")");
+        out_puts(out, ")");
     }
 }
 
@@ -243,70 +270,17 @@ void emit_typed_operand(ASTNode *operand, FILE *output_file, int is_signed, void
 // Array utilities
 // -------------------------------------------------------------
 
-/**
- * Parse array declaration to extract name and size
- * @param value String like "arr[10]"
- * @param name_out Buffer to store extracted name
- * @param name_size Size of name_out buffer
- * @param size_out Pointer to store extracted size
- * @return 1 if successfully parsed, 0 otherwise
- */
-int parse_array_declaration(const char *value, char *name_out, int name_size, int *size_out)
-{
-    const char *bracket_pos = NULL;
-    const char *size_start = NULL;
-    const char *size_end = NULL;
-    int name_length = 0;
-    char size_buffer[ARRAY_SIZE_BUFFER_SIZE] = {0};
-    
-    if (value == NULL || name_out == NULL || size_out == NULL)
-    {
-        return 0;
-    }
-    
-    bracket_pos = strchr(value, '[');
-    if (bracket_pos == NULL)
-    {
-        return 0;
-    }
-    
-    // Extract array name
-    name_length = (int)(bracket_pos - value);
-    if (name_length >= name_size)
-    {
-        name_length = name_size - 1;
-    }
-    strncpy(name_out, value, name_length);
-    name_out[name_length] = '\0';
-    
-    // Extract array size
-    size_start = bracket_pos + 1;
-    size_end = strchr(size_start, ']');
-    
-    if (size_end == NULL || size_end <= size_start)
-    {
-        return 0;
-    }
-    
-    strncpy(size_buffer, size_start, size_end - size_start);
-    size_buffer[size_end - size_start] = '\0';
-    
-    *size_out = atoi(size_buffer);
-    
-    return (*size_out > 0) ? 1 : 0;
-}
-
 /**
  * Emit VHDL array type and signal declaration
  * @param name Array name
  * @param type VHDL element type
  * @param size Array size
- * @param output_file Output stream
+ * @param out Output buffer
  */
-void emit_array_type_and_signal(const char *name, const char *type, int size, FILE *output_file)
+void emit_array_type_and_signal(const char *name, const char *type, int size, OutputBuffer *out)
 {
-    fprintf(output_file, "  type %s_type is array (0 to %d) of %s;\n", name, size - 1, type);
-    fprintf(output_file, "  signal %s : %s_type;\n", name, name);
+    out_printf(out, "  type %s_type is array (0 to %d) of %s;\n", name, size - 1, type);
+    out_printf(out, "  signal %s : %s_type;\n", name, name);
 }
 
 // -------------------------------------------------------------
@@ -344,31 +318,32 @@ ASTNode* unwrap_statement_node(ASTNode *node)
 
 /**
  * Emit field-by-field assignments between two struct instances
- * @param struct_index Index in g_structs array
+ * @param struct_index Index in the struct symbol table
  * @param target_name Name of target struct variable
  * @param source_name Name of source struct variable
- * @param output_file Output stream
+ * @param out Output buffer
  * @param indentation Indentation string for each line
  */
 void emit_struct_field_assignments(int struct_index, const char *target_name, 
-                                   const char *source_name, FILE *output_file, 
+                                   const char *source_name, OutputBuffer *out, 
                                    const char *indentation)
 {
     int field_index = 0;
+    const StructInfo *struct_info = struct_info_at(struct_index);
     
-    if (struct_index < 0 || target_name == NULL || source_name == NULL)
+    if (struct_info == NULL || target_name == NULL || source_name == NULL)
     {
         return;
     }
     
-    for (field_index = 0; field_index < g_structs[struct_index].field_count; ++field_index)
+    for (field_index = 0; field_index < struct_info->field_count; ++field_index)
     {
-        fprintf(output_file, "%s%s.%s <= %s.%s;\n", 
+        out_printf(out, "%s%s.%s <= %s.%s;\n", 
                 indentation,
                 target_name,
-                g_structs[struct_index].fields[field_index].field_name,
+                struct_info->fields[field_index].field_name,
                 source_name,
-                g_structs[struct_index].fields[field_index].field_name);
+                struct_info->fields[field_index].field_name);
     }
 }
 
@@ -6,19 +6,30 @@
 #ifndef CODEGEN_VHDL_HELPERS_H
 #define CODEGEN_VHDL_HELPERS_H
 
-#include <stdio.h>
+#include "output_buffer.h"
 #include "astnode.h"
+#include "codegen_vhdl.h"
+
+// -------------------------------------------------------------
+// Generation options
+// -------------------------------------------------------------
+// Options of the context being generated (defaults when none were given)
+const CodegenOptions* codegen_current_options(void);
+
+// Handshake ports of the entity generated for function: start/done (state
+// machines and pipelined loops), valid_in/valid_out (pipelined) and clk/reset
+void function_handshake(ASTNode *function, int *has_start, int *has_valid, int *has_clock);
 
 // -------------------------------------------------------------
 // Signal name mapping
 // -------------------------------------------------------------
 int is_signal_name_reserved(const char *variable_name);
-void emit_mapped_signal_name(const char *variable_name, FILE *output_file);
+void emit_mapped_signal_name(const char *variable_name, OutputBuffer *out);
 
 // -------------------------------------------------------------
 // Type checking
 // -------------------------------------------------------------
-int is_boolean_comparison_operator(const char *operator);
+int is_boolean_comparison_operator(InternId operator);
 int is_node_boolean_expression(ASTNode *node);
 int is_plain_identifier(const char *expression_value);
 
@@ -31,15 +42,14 @@ int is_negative_numeric_literal(const char *value);
 // -------------------------------------------------------------
 // Type conversion utilities
 // -------------------------------------------------------------
-void emit_unsigned_cast(const char *value, FILE *output_file);
-void emit_signed_cast(const char *value, FILE *output_file);
-void emit_typed_operand(ASTNode *operand, FILE *output_file, int is_signed, void (*node_generator)(ASTNode*, FILE*));
+void emit_unsigned_cast(const char *value, OutputBuffer *out);
+void emit_signed_cast(const char *value, OutputBuffer *out);
+void emit_typed_operand(ASTNode *operand, OutputBuffer *out, int is_signed, void (*node_generator)(ASTNode*, OutputBuffer*));
 
 // -------------------------------------------------------------
 // Array utilities
 // -------------------------------------------------------------
-int parse_array_declaration(const char *value, char *name_out, int name_size, int *size_out);
-void emit_array_type_and_signal(const char *name, const char *type, int size, FILE *output_file);
+void emit_array_type_and_signal(const char *name, const char *type, int size, OutputBuffer *out);
 
 // -------------------------------------------------------------
 // Statement utilities
@@ -50,7 +60,7 @@ ASTNode* unwrap_statement_node(ASTNode *node);
 // Struct field utilities
 // -------------------------------------------------------------
 void emit_struct_field_assignments(int struct_index, const char *target_name, 
-                                   const char *source_name, FILE *output_file, 
+                                   const char *source_name, OutputBuffer *out, 
                                    const char *indentation);
 
 #endif // CODEGEN_VHDL_HELPERS_H
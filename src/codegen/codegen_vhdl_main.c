@@ -6,6 +6,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "codegen_vhdl.h"
 #include "codegen_vhdl_constants.h"
@@ -13,28 +15,100 @@
 #include "codegen_vhdl_types.h"
 #include "codegen_vhdl_expressions.h"
 #include "codegen_vhdl_statements.h"
+#include "codegen_vhdl_pipeline.h"
+#include "codegen_vhdl_sharing.h"
+#include "codegen_vhdl_unroll.h"
+#include "codegen_vhdl_fsm.h"
+#include "codegen_vhdl_memory.h"
+#include "codegen_vhdl_widths.h"
+#include "codegen_vhdl_fixed.h"
+#include "codegen_vhdl_calls.h"
+#include "codegen_vhdl_combinational.h"
+#include "codegen_vhdl_stream.h"
+#include "codegen_vhdl_modulo.h"
+#include "codegen_vhdl_cse.h"
+#include "codegen_vhdl_cache.h"
+#include "codegen_vhdl_reset.h"
+#include "parser_context.h"
 #include "symbol_structs.h"
+#include "profile.h"
 #include "utils.h"
 
 // -------------------------------------------------------------
 // Forward declarations
 // -------------------------------------------------------------
-static void generate_node(ASTNode *node, FILE *output_file);
-static void generate_program(ASTNode *node, FILE *output_file);
-static void generate_function_declaration(ASTNode *node, FILE *output_file);
+static void generate_node(ASTNode *node, OutputBuffer *out);
+static void generate_program(ASTNode *node, OutputBuffer *out);
+static int generate_cached_function(ASTNode *node, const SymbolTable *functions, OutputBuffer *out);
+static void count_cache_result(ParserContext *ctx, int result);
+static void generate_function_declaration(ASTNode *node, OutputBuffer *out);
 
 // -------------------------------------------------------------
-// Public entry point
+// Public entry points
 // -------------------------------------------------------------
+void codegen_options_default(CodegenOptions *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->unroll_limit = DEFAULT_UNROLL_LIMIT;
+    options->bram_threshold = DEFAULT_BRAM_THRESHOLD;
+    options->strength_reduce = 1;
+    options->eliminate_common = 1;
+}
+
 void generate_vhdl(ASTNode *root, FILE *output_file)
 {
-    generate_node(root, output_file);
+    OutputBuffer out;
+
+    output_buffer_init(&out, output_file);
+    generate_node(root, &out);
+    output_buffer_flush(&out);
+    output_buffer_free(&out);
+}
+
+void generate_vhdl_buffer(ParserContext *ctx, ASTNode *root, OutputBuffer *out)
+{
+    // Generators look struct layouts up through the current context
+    ParserContext *previous = parser_context_activate(ctx);
+
+    generate_node(root, out);
+    parser_context_activate(previous);
+}
+
+int generate_vhdl_ctx(ParserContext *ctx, ASTNode *root, FILE *output_file)
+{
+    OutputBuffer out;
+    int succeeded = 0;
+
+    output_buffer_init(&out, output_file);
+    generate_vhdl_buffer(ctx, root, &out);
+    succeeded = output_buffer_flush(&out);
+    PROFILE_COUNT(ctx, output_bytes, out.bytes_written);
+    output_buffer_free(&out);
+    return succeeded;
+}
+
+void generate_vhdl_function(ParserContext *ctx, ASTNode *function, OutputBuffer *out)
+{
+    ParserContext *previous = parser_context_activate(ctx);
+
+    generate_node(function, out);
+    parser_context_activate(previous);
+}
+
+int generate_vhdl_structs(ParserContext *ctx, int first, OutputBuffer *out)
+{
+    ParserContext *previous = parser_context_activate(ctx);
+    int count = struct_count();
+
+    emit_struct_declarations_from(first, out);
+    parser_context_activate(previous);
+    return count;
 }
 
 // -------------------------------------------------------------
 // Node dispatcher - routes AST nodes to appropriate generators
 // -------------------------------------------------------------
-static void generate_node(ASTNode *node, FILE *output_file)
+static void generate_node(ASTNode *node, OutputBuffer *out)
 {
     if (node == NULL)
     {
@@ -44,52 +118,59 @@ static void generate_node(ASTNode *node, FILE *output_file)
     switch (node->type)
     {
         case NODE_PROGRAM:
-            generate_program(node, output_file);
+            generate_program(node, out);
             break;
             
         case NODE_FUNCTION_DECL:
-            generate_function_declaration(node, output_file);
+            generate_function_declaration(node, out);
             break;
             
         case NODE_STATEMENT:
-            generate_statement_block(node, output_file, generate_node);
+            generate_statement_block(node, out, generate_node);
             break;
             
         case NODE_WHILE_STATEMENT:
-            generate_while_loop(node, output_file, generate_node);
+            generate_while_loop(node, out, generate_node);
             break;
             
         case NODE_FOR_STATEMENT:
-            generate_for_loop(node, output_file, generate_node);
+            generate_for_loop(node, out, generate_node);
             break;
             
         case NODE_IF_STATEMENT:
-            generate_if_statement(node, output_file, generate_node);
+            generate_if_statement(node, out, generate_node);
             break;
             
         case NODE_BREAK_STATEMENT:
-            generate_break_statement(node, output_file);
+            generate_break_statement(node, out);
             break;
             
         case NODE_CONTINUE_STATEMENT:
-            generate_continue_statement(node, output_file);
+            generate_continue_statement(node, out);
             break;
             
         case NODE_BINARY_EXPR:
-            generate_binary_expression(node, output_file);
+            generate_binary_expression(node, out);
             break;
             
-        case NODE_BINARY_OP:
-            // Unary ops are stored in BINARY_OP nodes in the parser
-            generate_unary_operation(node, output_file);
+        case NODE_UNARY_EXPR:
+            generate_unary_operation(node, out);
             break;
             
         case NODE_EXPRESSION:
-            generate_expression(node, output_file);
+            generate_expression(node, out);
             break;
             
         case NODE_FUNC_CALL:
-            generate_function_call(node, output_file);
+            generate_function_call(node, out);
+            break;
+            
+        case NODE_INDEX_EXPR:
+            generate_index_expression(node, out);
+            break;
+            
+        case NODE_MEMBER_EXPR:
+            generate_member_expression(node, out);
             break;
             
         default:
@@ -101,120 +182,760 @@ static void generate_node(ASTNode *node, FILE *output_file)
 // -------------------------------------------------------------
 // Program (top-level) code generation
 // -------------------------------------------------------------
-static void generate_program(ASTNode *node, FILE *output_file)
+void emit_vhdl_header(OutputBuffer *out)
+{
+    out_puts(out, "-- VHDL generated by compi\n\n");
+    out_puts(out, "library IEEE;\n");
+    out_puts(out, "use IEEE.STD_LOGIC_1164.ALL;\n");
+    out_puts(out, "use IEEE.NUMERIC_STD.ALL;\n\n");
+}
+
+static void generate_program(ASTNode *node, OutputBuffer *out)
 {
+    SymbolTable functions;
     int child_index = 0;
 
     // Emit VHDL header
-    fprintf(output_file, "-- VHDL generated by compi\n\n");
-    fprintf(output_file, "library IEEE;\n");
-    fprintf(output_file, "use IEEE.STD_LOGIC_1164.ALL;\n");
-    fprintf(output_file, "use IEEE.NUMERIC_STD.ALL;\n\n");
+    emit_vhdl_header(out);
 
     // Emit struct type declarations
-    emit_all_struct_declarations(output_file);
+    emit_all_struct_declarations(out);
 
     // Generate code for all child nodes (functions)
+    symbol_table_init(&functions);
+    if (codegen_current_options()->cache_dir != NULL)
+    {
+        cache_index_functions(node, &functions);
+    }
     for (child_index = 0; child_index < node->num_children; ++child_index)
     {
-        generate_node(node->children[child_index], output_file);
+        if (node->children[child_index]->type == NODE_FUNCTION_DECL)
+        {
+            count_cache_result(parser_context_current(),
+                               generate_cached_function(node->children[child_index], &functions, out));
+            continue;
+        }
+        generate_node(node->children[child_index], out);
+    }
+    symbol_table_free(&functions);
+}
+
+// -------------------------------------------------------------
+// Function declaration through the --cache-dir cache
+// -------------------------------------------------------------
+// Returns 1 when the text was spliced from the cache, 0 when it was
+// generated and stored, -1 when no cache is in use. Callers count hits and
+// misses, so concurrent split generation never shares a profile counter.
+static int generate_cached_function(ASTNode *node, const SymbolTable *functions, OutputBuffer *out)
+{
+    const CodegenOptions *options = codegen_current_options();
+    CacheInput input;
+    OutputBuffer text;
+
+    if (options->cache_dir == NULL)
+    {
+        generate_function_declaration(node, out);
+        return -1;
+    }
+    cache_input_build(&input, node, functions, options);
+    if (cache_load(options->cache_dir, &input, out))
+    {
+        cache_input_free(&input);
+        return 1;
+    }
+    output_buffer_init(&text, NULL);
+    generate_function_declaration(node, &text);
+    cache_store(options->cache_dir, &input, text.data, text.length);
+    out_write(out, text.data, text.length);
+    output_buffer_free(&text);
+    cache_input_free(&input);
+    return 0;
+}
+
+static void count_cache_result(ParserContext *ctx, int result)
+{
+    if (result == 1)
+    {
+        PROFILE_COUNT(ctx, cache_hits, 1);
+    }
+    else if (result == 0)
+    {
+        PROFILE_COUNT(ctx, cache_misses, 1);
+    }
+}
+
+// -------------------------------------------------------------
+// Split generation - one unit per function on a thread pool
+// -------------------------------------------------------------
+// Generating a function rewrites its own subtree for a while (unrolled
+// loops, bound plans) and reads the subtrees of the functions it calls, so
+// functions connected by calls form one job that a single thread generates
+// in source order. Unrelated jobs run in parallel; struct layouts, options
+// and the program node itself are only read.
+typedef struct {
+    ParserContext *ctx;
+    ASTNode **functions;       // Program functions in source order
+    SymbolTable callees;       // Function name -> child index in the program
+    int *function_of_child;    // Program child index -> index in functions
+    CodegenUnit *units;        // Same order as functions
+    int *job_first;            // First function of each job
+    int *job_next;             // Function -> next function of its job (-1 = last)
+    int job_count;
+    atomic_int next_job;
+} SplitQueue;
+
+static int split_find(int *groups, int index)
+{
+    while (groups[index] != index)
+    {
+        groups[index] = groups[groups[index]];
+        index = groups[index];
+    }
+    return index;
+}
+
+// Helper: join function_index with every program function node calls
+static void split_link_calls(const ASTNode *node, const SplitQueue *queue, int *groups, int function_index)
+{
+    int callee_child = -1;
+
+    if (node == NULL)
+    {
+        return;
+    }
+    if (node->type == NODE_FUNC_CALL && node->value != NULL &&
+        symbol_lookup(&queue->callees, intern_find(node->value, strlen(node->value)), &callee_child))
+    {
+        groups[split_find(groups, function_index)] = split_find(groups, queue->function_of_child[callee_child]);
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        split_link_calls(node->children[child_index], queue, groups, function_index);
+    }
+}
+
+static void* split_worker(void *argument)
+{
+    SplitQueue *queue = (SplitQueue*)argument;
+    ParserContext *previous = parser_context_activate(queue->ctx);
+    int job_index = 0;
+
+    while ((job_index = atomic_fetch_add(&queue->next_job, 1)) < queue->job_count)
+    {
+        for (int function_index = queue->job_first[job_index]; function_index >= 0;
+             function_index = queue->job_next[function_index])
+        {
+            CodegenUnit *unit = &queue->units[function_index];
+
+            unit->cache_hit = generate_cached_function(queue->functions[function_index], &queue->callees,
+                                                       &unit->text);
+        }
     }
+    parser_context_activate(previous);
+    return NULL;
+}
+
+int generate_vhdl_units(ParserContext *ctx, ASTNode *root, int worker_count, CodegenUnit **units)
+{
+    SplitQueue queue;
+    pthread_t *workers = NULL;
+    pthread_attr_t attributes;
+    size_t stack_size = 0;
+    int *groups = NULL;
+    int *job_of_group = NULL;
+    int *job_last = NULL;
+    int function_count = 0;
+    int started = 0;
+
+    *units = NULL;
+    if (root == NULL || root->type != NODE_PROGRAM)
+    {
+        return 0;
+    }
+    memset(&queue, 0, sizeof(queue));
+    queue.ctx = ctx;
+    queue.functions = (ASTNode**)xrealloc(NULL, (size_t)root->num_children * sizeof(ASTNode*));
+    queue.function_of_child = (int*)xrealloc(NULL, (size_t)root->num_children * sizeof(int));
+    for (int child_index = 0; child_index < root->num_children; ++child_index)
+    {
+        queue.function_of_child[child_index] = function_count;
+        if (root->children[child_index]->type == NODE_FUNCTION_DECL)
+        {
+            queue.functions[function_count++] = root->children[child_index];
+        }
+    }
+    symbol_table_init(&queue.callees);
+    cache_index_functions(root, &queue.callees);
+
+    // Call graph components, numbered in order of their first function
+    groups = (int*)xrealloc(NULL, (size_t)function_count * sizeof(int));
+    for (int function_index = 0; function_index < function_count; ++function_index)
+    {
+        groups[function_index] = function_index;
+    }
+    for (int function_index = 0; function_index < function_count; ++function_index)
+    {
+        split_link_calls(queue.functions[function_index], &queue, groups, function_index);
+    }
+    job_of_group = (int*)xrealloc(NULL, (size_t)function_count * sizeof(int));
+    job_last = (int*)xrealloc(NULL, (size_t)function_count * sizeof(int));
+    queue.job_first = (int*)xrealloc(NULL, (size_t)function_count * sizeof(int));
+    queue.job_next = (int*)xrealloc(NULL, (size_t)function_count * sizeof(int));
+    memset(job_of_group, -1, (size_t)function_count * sizeof(int));
+    for (int function_index = 0; function_index < function_count; ++function_index)
+    {
+        int group = split_find(groups, function_index);
+
+        queue.job_next[function_index] = -1;
+        if (job_of_group[group] < 0)
+        {
+            job_of_group[group] = queue.job_count;
+            queue.job_first[queue.job_count++] = function_index;
+        }
+        else
+        {
+            queue.job_next[job_last[job_of_group[group]]] = function_index;
+        }
+        job_last[job_of_group[group]] = function_index;
+    }
+
+    queue.units = (CodegenUnit*)xrealloc(NULL, (size_t)function_count * sizeof(CodegenUnit));
+    for (int function_index = 0; function_index < function_count; ++function_index)
+    {
+        const char *name = queue.functions[function_index]->value;
+
+        queue.units[function_index].name = (name != NULL) ? name : DEFAULT_FUNCTION_NAME;
+        output_buffer_init(&queue.units[function_index].text, NULL);
+        queue.units[function_index].cache_hit = -1;
+    }
+    atomic_init(&queue.next_job, 0);
+
+    // The calling thread is worker 0
+    if (worker_count > queue.job_count)
+    {
+        worker_count = queue.job_count;
+    }
+    workers = (pthread_t*)xrealloc(NULL, (size_t)(worker_count > 1 ? worker_count : 1) * sizeof(pthread_t));
+    if (worker_count > 1)
+    {
+        // Deep trees need the stack compile_unit gave the calling thread
+        stack_size = ast_stack_size(root);
+        pthread_attr_init(&attributes);
+        if (stack_size > 0)
+        {
+            pthread_attr_setstacksize(&attributes, stack_size);
+        }
+        for (int worker_index = 1; worker_index < worker_count; ++worker_index)
+        {
+            if (pthread_create(&workers[started], &attributes, split_worker, &queue) != 0)
+            {
+                break;
+            }
+            started++;
+        }
+        pthread_attr_destroy(&attributes);
+    }
+    split_worker(&queue);
+    for (int worker_index = 0; worker_index < started; ++worker_index)
+    {
+        pthread_join(workers[worker_index], NULL);
+    }
+
+    for (int function_index = 0; function_index < function_count; ++function_index)
+    {
+        count_cache_result(ctx, queue.units[function_index].cache_hit);
+    }
+
+    free(workers);
+    free(groups);
+    free(job_of_group);
+    free(job_last);
+    free(queue.job_first);
+    free(queue.job_next);
+    free(queue.functions);
+    free(queue.function_of_child);
+    symbol_table_free(&queue.callees);
+    *units = queue.units;
+    return function_count;
+}
+
+void codegen_units_free(CodegenUnit *units, int count)
+{
+    for (int unit_index = 0; unit_index < count; ++unit_index)
+    {
+        output_buffer_free(&units[unit_index].text);
+    }
+    free(units);
+}
+
+int generate_vhdl_package(ParserContext *ctx, const char *package_name, OutputBuffer *out)
+{
+    ParserContext *previous = parser_context_activate(ctx);
+    int declared = struct_count();
+
+    if (declared > 0)
+    {
+        out_printf(out, "package %s is\n\n", package_name);
+        emit_all_struct_declarations(out);
+        out_puts(out, "end package;\n");
+    }
+    parser_context_activate(previous);
+    return declared;
 }
 
 // -------------------------------------------------------------
 // Function declaration -> VHDL entity + architecture
 // -------------------------------------------------------------
-static void generate_function_declaration(ASTNode *node, FILE *output_file)
+static void generate_function_declaration(ASTNode *node, OutputBuffer *out)
 {
     const char *function_name = (node->value != NULL) ? node->value : DEFAULT_FUNCTION_NAME;
-    ASTNode *parameters[MAX_PARAMETERS] = {NULL};
-    int parameter_count = 0;
     int child_index = 0;
+    const CodegenOptions *options = codegen_current_options();
+    UnrollExpansion expansion;
+    int expanded = 0;
+    MemoryPlan memories;
+    int memory_count = 0;
+    int combinational = 0;
+    int sequenced = 0;
+    int pipelined = 0;
+    int planned = 0;
+    int stage_count = 1;
+    int shared = 0;
+    PipelinePlan plan;
+    SharingPlan sharing;
+    FsmPlan machine;
+    WidthPlan widths;
+    const WidthPlan *previous_widths = NULL;
+    FixedFormat fixed_default = { options->fixed_integer_bits, options->fixed_fraction_bits };
+    FixedPlan fixed;
+    const FixedPlan *previous_fixed = NULL;
+    int fixed_count = 0;
+    CallPlan calls;
+    int call_count = 0;
+    StreamPlan stream;
+    int streamed = 0;
+    ModuloPlan loop_plan;
+    int looped = 0;
+    CsePlan common;
+    int common_count = 0;
+
+    // Plan before any output: the stage count shapes the declarations.
+    // A state machine spreads one call over many cycles, so it is never
+    // retimed or shared (mux selects would see later-cycle conditions).
+    // Block RAM needs the state machine to wait for its read latency.
+    // Its unrolled loops are scheduled as copies with constant indices;
+    // other functions keep the loops for the regular unroll lowering.
+    // A streamed loop runs one iteration per beat instead of all at once,
+    // a pipelined loop one every II cycles.
+    streamed = stream_plan_function(node, &stream);
+    if (streamed)
+    {
+        memset(&loop_plan, 0, sizeof(loop_plan));
+    }
+    else
+    {
+        looped = modulo_plan_function(node, &loop_plan);
+    }
+    expanded = (options->fsm && !streamed && !looped);
+    if (expanded)
+    {
+        unroll_expand_function(node, options->unroll_limit, &expansion);
+    }
+    // A combinational function has no loops or arrays and no registers to retime
+    memory_count = memory_plan_function(node, options->fsm ? options->bram_threshold : 0, &memories);
+    combinational = combinational_function(node, options->combinational);
+    sequenced = (options->fsm && !combinational && !streamed && !looped &&
+                 (memory_count > 0 || fsm_function_needed(node)));
+    pipelined = (options->pipeline_stages > 0 && !sequenced && !combinational && !streamed && !looped);
+    if (expanded && !sequenced)
+    {
+        unroll_restore(&expansion);
+        expanded = 0;
+    }
+    // Real signals become Qm.n integers before their widths are collected;
+    // the retimed registers of the pipeliner only hold integer arithmetic
+    if (pipelined)
+    {
+        memset(&fixed, 0, sizeof(fixed));
+    }
+    else
+    {
+        fixed_count = fixed_plan_function(node, &fixed_default, &fixed);
+    }
+    previous_fixed = fixed_plan_activate(&fixed);
+    // Narrowed on the tree as it is emitted (expanded copies included);
+    // retimed registers are sized from the int types the pipeliner expects,
+    // delay registers from the declared ones
+    width_plan_function(node, options->narrow_widths && !pipelined && !looped, &widths);
+    previous_widths = width_plan_activate(&widths);
+    // Calls the inliner left become instances of the callee entity
+    call_count = call_plan_function(node, &calls);
+    for (int instance_index = 0; instance_index < call_count; ++instance_index)
+    {
+        CallInstance *instance = &calls.instances[instance_index];
+        function_handshake(instance->callee, &instance->has_start, &instance->has_valid, &instance->has_clock);
+    }
+    if (sequenced)
+    {
+        fsm_plan_function(node, &memories, &machine);
+    }
+    if (pipelined)
+    {
+        // Instance results are registered, so stages would not line up
+        planned = pipeline_plan_function(node, options->pipeline_stages, &plan) && call_count == 0;
+        if (planned)
+        {
+            stage_count = plan.stage_count;
+        }
+    }
+    // Shared units compute integer products, never rescaled ones. Repeated
+    // subexpressions are bound first, so only one copy is left to share;
+    // their signals are full int width.
+    if (!planned && !sequenced && !streamed && !looped)
+    {
+        if (options->eliminate_common && fixed_count == 0 && !options->narrow_widths)
+        {
+            common_count = cse_plan_function(node, &common);
+            cse_bind(&common);
+        }
+        else
+        {
+            memset(&common, 0, sizeof(common));
+        }
+        shared = sharing_plan_function(node, (fixed_count > 0) ? 0 : options->share_limit,
+                                       options->share_adders, &sharing);
+    }
 
     // Entity declaration header
-    fprintf(output_file, "-- Function: %s\n", function_name);
-    fprintf(output_file, "entity %s is\n", function_name);
-    fprintf(output_file, "  port (\n");
-    fprintf(output_file, "    clk   : in  std_logic;\n");
-    fprintf(output_file, "    reset : in  std_logic;\n");
+    out_puts(out, "-- Function: ");
+    out_puts(out, function_name);
+    out_putc(out, '\n');
+    out_puts(out, "entity ");
+    out_puts(out, function_name);
+    out_puts(out, " is\n");
+    out_puts(out, "  port (\n");
+    if (!combinational)
+    {
+        out_puts(out, "    clk   : in  std_logic;\n");
+        out_puts(out, "    reset : in  std_logic;\n");
+    }
+    if (pipelined)
+    {
+        out_puts(out, "    valid_in  : in  std_logic;\n");
+    }
+    if (sequenced || looped)
+    {
+        out_puts(out, "    start : in  std_logic;\n");
+    }
 
-    // Collect function parameters (variable declaration children)
+    // Emit input ports for each parameter (variable declaration children);
+    // read straight from the node, so there is no limit on their number
     for (child_index = 0; child_index < node->num_children; ++child_index)
     {
-        ASTNode *child_node = node->children[child_index];
-        
-        if (child_node->type == NODE_VAR_DECL)
+        ASTNode *parameter = node->children[child_index];
+        int struct_index = 0;
+        int is_struct_type = 0;
+
+        if (parameter->type != NODE_VAR_DECL)
         {
-            parameters[parameter_count] = child_node;
-            parameter_count++;
+            continue;
         }
-    }
+        struct_index = find_struct_index_id(parameter->token.id);
+        is_struct_type = (struct_index >= 0);
 
-    // Emit input ports for each parameter
-    for (child_index = 0; child_index < parameter_count; ++child_index)
-    {
-        ASTNode *parameter = parameters[child_index];
-        int struct_index = find_struct_index(parameter->token.value);
-        int is_struct_type = (struct_index >= 0);
-        
+        if (streamed && emit_stream_ports(&stream, parameter, out))
+        {
+            continue;
+        }
         if (is_struct_type)
         {
-            fprintf(output_file, "    %s : in %s_t;\n", 
-                    parameter->value, parameter->token.value);
+            out_printf(out, "    %s : in %s_t;\n", 
+                    parameter->value, token_text(parameter->token));
         }
         else
         {
-            fprintf(output_file, "    %s : in %s;\n", 
-                    parameter->value, ctype_to_vhdl(parameter->token.value));
+            out_printf(out, "    %s : in %s;\n", 
+                    parameter->value, ctype_to_vhdl(token_text(parameter->token)));
         }
     }
 
+    if (pipelined)
+    {
+        out_puts(out, "    valid_out : out std_logic;\n");
+    }
+    if (sequenced || streamed || looped)
+    {
+        out_puts(out, "    done  : out std_logic");
+        emit_power_up_value("'0'", out);
+        out_puts(out, ";\n");
+    }
+
     // Emit output port (result)
-    if (node->token.value != NULL && strlen(node->token.value) > 0)
+    if (node->token.id != INTERN_NONE)
     {
-        int return_struct_index = find_struct_index(node->token.value);
+        int return_struct_index = find_struct_index_id(node->token.id);
         int is_struct_return = (return_struct_index >= 0);
         
         if (is_struct_return)
         {
-            fprintf(output_file, "    result : out %s_t\n", node->token.value);
+            out_puts(out, "    result : out ");
+            out_puts(out, token_text(node->token));
+            out_puts(out, "_t\n");
         }
         else
         {
-            fprintf(output_file, "    result : out %s\n", 
-                    ctype_to_vhdl(node->token.value));
+            out_printf(out, "    result : out %s\n", 
+                    ctype_to_vhdl(token_text(node->token)));
         }
     }
     else
     {
-        fprintf(output_file, "    result : out std_logic_vector(%d downto 0)\n", 
+        out_printf(out, "    result : out std_logic_vector(%d downto 0)\n", 
                 VHDL_BIT_WIDTH - 1);
     }
     
-    fprintf(output_file, "  );\nend entity;\n\n");
+    out_puts(out, "  );\nend entity;\n\n");
 
     // Architecture declaration
-    fprintf(output_file, "architecture behavioral of %s is\n", function_name);
-    emit_function_local_signals(node, output_file);
-    fprintf(output_file, "begin\n");
-    fprintf(output_file, "  process(clk, reset)\n");
-    fprintf(output_file, "  begin\n");
-    fprintf(output_file, "    if reset = '1' then\n");
-    fprintf(output_file, "      -- Reset logic (user-defined)\n");
-    fprintf(output_file, "    elsif rising_edge(clk) then\n");
-
-    // Generate function body statements
-    for (child_index = 0; child_index < node->num_children; ++child_index)
+    out_puts(out, "architecture behavioral of ");
+    out_puts(out, function_name);
+    out_puts(out, " is\n");
+    if (planned)
     {
-        ASTNode *child = node->children[child_index];
-        
-        if (child->type == NODE_STATEMENT)
+        emit_pipeline_signals(&plan, out);
+    }
+    else
+    {
+        emit_function_local_signals(node, sequenced ? memory_declares : NULL, &memories, out);
+        if (sequenced)
+        {
+            emit_fsm_signals(&machine, out);
+            emit_memory_signals(&memories, out);
+        }
+        else if (streamed)
+        {
+            emit_stream_signals(&stream, out);
+        }
+        else if (looped)
+        {
+            emit_modulo_signals(&loop_plan, out);
+        }
+        else
+        {
+            emit_cse_signals(&common, out);
+            emit_sharing_signals(&sharing, out);
+        }
+    }
+    emit_call_signals(&calls, out);
+    if (pipelined)
+    {
+        emit_valid_signal(stage_count, out);
+    }
+    out_puts(out, "begin\n");
+    if (pipelined && !planned)
+    {
+        out_puts(out, "  -- Not pipelined: only straight-line int functions are retimed\n");
+    }
+    if (!combinational && combinational_requested(node))
+    {
+        out_puts(out, "  -- Not combinational: needs a loop-free body of scalars assigned once\n");
+    }
+    if (!streamed && stream.array_count > 0)
+    {
+        out_puts(out, "  -- Not streamed: needs one loop reading and writing the arrays at its counter\n");
+    }
+    if (loop_plan.requested_ii > 0)
+    {
+        emit_modulo_report(&loop_plan, out);
+    }
+    if (call_count > 0)
+    {
+        // Bound for the rest of the body: the process reads the instance results
+        call_bind(&calls);
+        emit_call_instances(&calls, out, generate_node);
+    }
+    if (common_count > 0)
+    {
+        emit_cse_values(&common, out, generate_node);
+    }
+    if (shared > 0)
+    {
+        // Bound for the rest of the body: muxes and process read the unit outputs
+        sharing_bind(&sharing);
+        emit_sharing_units(&sharing, out, generate_node);
+    }
+    if (sequenced)
+    {
+        // Reads are bound to the port outputs once the address muxes are out
+        emit_memory_ports(&memories, out, generate_node);
+        memory_bind(&memories);
+    }
+    if (streamed)
+    {
+        // Bound for the rest of the body: elements are the tdata of a beat
+        emit_stream_control(&stream, out);
+        stream_bind(&stream);
+    }
+    if (looped)
+    {
+        // Bound for the rest of the body: reads of earlier cycles are delayed
+        modulo_bind(&loop_plan);
+    }
+    if (combinational)
+    {
+        // No process: the body drives its signals and the result port directly
+        emit_combinational_body(node, out, generate_node);
+    }
+    else
+    {
+        // Only control registers are reset; the body's data registers are not
+        OutputBuffer resets;
+        ResetPlan reset_plan;
+
+        output_buffer_init(&resets, NULL);
+        if (!planned)
+        {
+            reset_plan_function(node, &reset_plan);
+        }
+        else
+        {
+            memset(&reset_plan, 0, sizeof(reset_plan));
+        }
+        if (pipelined)
+        {
+            emit_valid_reset(&resets);
+        }
+        if (sequenced)
+        {
+            emit_fsm_reset(&resets);
+        }
+        if (streamed)
+        {
+            emit_stream_reset(&stream, &resets);
+        }
+        if (looped)
+        {
+            emit_modulo_reset(&loop_plan, &resets);
+        }
+        emit_reset_registers(&reset_plan, &resets, generate_node);
+        emit_process_begin(&resets, out);
+        if (pipelined)
+        {
+            emit_valid_shift(stage_count, out);
+        }
+
+        if (planned)
+        {
+            emit_pipeline_stages(&plan, out, generate_node);
+        }
+        else if (sequenced)
+        {
+            emit_fsm_states(&machine, out, generate_node);
+        }
+        else if (streamed)
+        {
+            emit_stream_beats(node, &stream, out, generate_node);
+        }
+        else if (looped)
         {
-            generate_node(child, output_file);
+            emit_modulo_process(node, &loop_plan, out, generate_node);
         }
+        else
+        {
+            // Generate function body statements
+            for (child_index = 0; child_index < node->num_children; ++child_index)
+            {
+                ASTNode *child = node->children[child_index];
+            
+                if (child->type == NODE_STATEMENT)
+                {
+                    generate_node(child, out);
+                }
+            }
+        }
+
+        emit_process_end(&resets, out);
+        reset_plan_free(&reset_plan);
+        output_buffer_free(&resets);
+    }
+    if (pipelined)
+    {
+        emit_valid_output(stage_count, out);
+    }
+    out_puts(out, "end architecture;\n\n");
+
+    if (call_count > 0)
+    {
+        call_unbind(&calls);
+    }
+    call_plan_free(&calls);
+    if (streamed)
+    {
+        stream_unbind(&stream);
+    }
+    stream_plan_free(&stream);
+    if (looped)
+    {
+        modulo_unbind(&loop_plan);
+    }
+    modulo_plan_free(&loop_plan);
+    if (shared > 0)
+    {
+        sharing_unbind(&sharing);
+    }
+    if (!planned && !sequenced && !streamed && !looped)
+    {
+        sharing_plan_free(&sharing);
+        cse_unbind(&common);
+        cse_plan_free(&common);
+    }
+    if (sequenced)
+    {
+        memory_unbind(&memories);
+        fsm_plan_free(&machine);
+    }
+    width_plan_activate(previous_widths);
+    width_plan_free(&widths);
+    fixed_plan_activate(previous_fixed);
+    fixed_plan_free(&fixed);
+    memory_plan_free(&memories);
+    if (expanded)
+    {
+        unroll_restore(&expansion);
     }
+    if (pipelined)
+    {
+        pipeline_plan_free(&plan);
+    }
+}
 
-    fprintf(output_file, "    end if;\n");
-    fprintf(output_file, "  end process;\n");
-    fprintf(output_file, "end architecture;\n\n");
+// -------------------------------------------------------------
+// Handshake ports of the entity generated for function (the decisions at
+// the top of generate_function_declaration)
+// -------------------------------------------------------------
+void function_handshake(ASTNode *function, int *has_start, int *has_valid, int *has_clock)
+{
+    const CodegenOptions *options = codegen_current_options();
+    UnrollExpansion expansion;
+    MemoryPlan memories;
+    ModuloPlan loop_plan;
+
+    *has_start = 0;
+    *has_valid = 0;
+    *has_clock = !combinational_function(function, options->combinational);
+    if (!*has_clock)
+    {
+        return;
+    }
+    *has_start = modulo_plan_function(function, &loop_plan);
+    modulo_plan_free(&loop_plan);
+    if (options->fsm && !*has_start)
+    {
+        unroll_expand_function(function, options->unroll_limit, &expansion);
+        *has_start = (memory_plan_function(function, options->bram_threshold, &memories) > 0 ||
+                      fsm_function_needed(function));
+        memory_plan_free(&memories);
+        unroll_restore(&expansion);
+    }
+    *has_valid = (options->pipeline_stages > 0 && !*has_start);
 }
@@ -0,0 +1,730 @@
+// VHDL Code Generator - Block RAM Inference Implementation
+// -------------------------------------------------------------
+// An array signal read with a variable index inside the process becomes a
+// multiplexer tree over flip-flops, which does not scale past a few hundred
+// elements. Synthesis tools map an array to block RAM (or ROM, when it is
+// never written) only when it is accessed through the registered-port
+// template:
+//
+//     if rising_edge(clk) then
+//       if en = '1' then
+//         if we = '1' then mem(addr) <= din; end if;
+//         dout <= mem(addr);
+//       end if;
+//     end if;
+//
+// The state machine presents the address of every access one state ahead:
+// the port signals are concurrent multiplexers selected by the current
+// state, and the data is read from <name>_dout_<port> in the next state.
+// Port a serves reads and writes, port b is only added for a second read in
+// the same state, which keeps the template single-writer.
+// A partitioned array becomes one such memory per bank. Its indices must be
+// constants (unrolled loops), so the bank of every access is known and
+// accesses to different banks are independent ports.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_memory.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_types.h"
+#include "symbol_structs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define MEMORY_NAME_SIZE 128
+#define MEMORY_MAX_BANKS 64
+
+static const char MEMORY_PORT_SUFFIX[MEMORY_PORT_COUNT] = { 'a', 'b' };
+
+// -------------------------------------------------------------
+// Helper: value of a constant index (literals, + - * and unary minus)
+// -------------------------------------------------------------
+static int memory_constant_index(const ASTNode *node, long long *value)
+{
+    long long left = 0;
+    long long right = 0;
+    char *end = NULL;
+
+    if (node->type == NODE_EXPRESSION && node->value != NULL && is_numeric_literal(node->value))
+    {
+        *value = strtoll(node->value, &end, 10);
+        return *end == '\0';
+    }
+    if (node->num_children == 0 ||
+        !memory_constant_index(node->children[FIRST_CHILD_INDEX], &left))
+    {
+        return 0;
+    }
+    if (node->type == NODE_UNARY_EXPR && node->token.id == INTERN_OP_MINUS)
+    {
+        *value = -left;
+        return 1;
+    }
+    if (node->type != NODE_BINARY_EXPR || node->num_children != 2 ||
+        !memory_constant_index(node->children[FIRST_CHILD_INDEX + 1], &right))
+    {
+        return 0;
+    }
+
+    switch (node->token.id)
+    {
+        case INTERN_OP_PLUS: *value = left + right; break;
+        case INTERN_OP_MINUS: *value = left - right; break;
+        case INTERN_OP_MULTIPLY: *value = left * right; break;
+        default: return 0;
+    }
+    return 1;
+}
+
+// Bank of array element index, and its offset in that bank
+static int memory_bank_of(const MemoryArray *array, long long index, int *offset)
+{
+    if (array->partition == MEMORY_PARTITION_CYCLIC)
+    {
+        *offset = (int)(index / array->bank_count);
+        return (int)(index % array->bank_count);
+    }
+    *offset = (int)(index % array->size);
+    return (int)(index / array->size);
+}
+
+// Array element held at offset of a bank
+static int memory_element(const MemoryArray *bank, int offset)
+{
+    if (bank->partition == MEMORY_PARTITION_CYCLIC)
+    {
+        return offset * bank->bank_count + bank->bank;
+    }
+    return bank->bank * bank->size + offset;
+}
+
+// Every bank of the array goes back to registers together
+static void memory_deactivate(MemoryPlan *plan, int memory)
+{
+    int first = memory - plan->arrays[memory].bank;
+
+    for (int bank = 0; bank < plan->arrays[first].bank_count; ++bank)
+    {
+        plan->arrays[first + bank].active = 0;
+    }
+}
+
+static int memory_by_name(const MemoryPlan *plan, const char *name)
+{
+    InternId name_id = INTERN_NONE;
+
+    if (name == NULL || plan->array_count == 0)
+    {
+        return -1;
+    }
+
+    name_id = intern_cstr(name);
+    for (int index = 0; index < plan->array_count; ++index)
+    {
+        if (plan->arrays[index].active && plan->arrays[index].name_id == name_id)
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+// -------------------------------------------------------------
+// Candidate selection
+// -------------------------------------------------------------
+static int memory_referenced(const MemoryPlan *plan, const ASTNode *node)
+{
+    if (node->type == NODE_EXPRESSION && memory_by_name(plan, node->value) >= 0)
+    {
+        return 1;
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (memory_referenced(plan, node->children[child_index]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Any use other than mem[index] with a memory-free index keeps the registers
+static void memory_check_uses(MemoryPlan *plan, ASTNode *node, const ASTNode *parent, int child_index)
+{
+    int memory = -1;
+
+    if (node->type == NODE_EXPRESSION)
+    {
+        memory = memory_by_name(plan, node->value);
+        if (memory >= 0 && !(parent != NULL && parent->type == NODE_INDEX_EXPR && child_index == 0))
+        {
+            memory_deactivate(plan, memory);
+        }
+    }
+    else if (node->type == NODE_VAR_DECL)
+    {
+        // A nested declaration shadowing the memory
+        memory = memory_by_name(plan, node->value);
+        if (memory >= 0 && plan->arrays[memory].declaration != node)
+        {
+            memory_deactivate(plan, memory);
+        }
+    }
+    else if (node->type == NODE_INDEX_EXPR && node->num_children == 2)
+    {
+        memory = memory_find(plan, node);
+        if (memory >= 0 && memory_referenced(plan, node->children[FIRST_CHILD_INDEX + 1]))
+        {
+            memory_deactivate(plan, memory);
+        }
+    }
+    else if (node->type == NODE_ASSIGNMENT && node->num_children == 2)
+    {
+        memory = memory_find(plan, node->children[FIRST_CHILD_INDEX]);
+        if (memory >= 0)
+        {
+            plan->arrays[memory].read_only = 0;
+        }
+    }
+
+    for (int index = 0; index < node->num_children; ++index)
+    {
+        memory_check_uses(plan, node->children[index], node, index);
+    }
+}
+
+static void memory_add_candidate(MemoryPlan *plan, ASTNode *declaration, MemoryPartition partition,
+                                 int bank, int bank_count)
+{
+    MemoryArray *array = NULL;
+    char name[MEMORY_NAME_SIZE];
+
+    if (plan->array_count >= plan->array_capacity)
+    {
+        plan->array_capacity = (plan->array_capacity > 0) ? plan->array_capacity * 2 : 4;
+        plan->arrays = (MemoryArray*)xrealloc(plan->arrays,
+            (size_t)plan->array_capacity * sizeof(MemoryArray));
+    }
+
+    array = &plan->arrays[plan->array_count++];
+    memset(array, 0, sizeof(*array));
+    array->declaration = declaration;
+    array->name_id = intern_cstr(declaration->value);
+    array->name = declaration->value;
+    array->size = declaration->array_size / bank_count;
+    array->partition = partition;
+    array->bank = bank;
+    array->bank_count = bank_count;
+    array->active = 1;
+    array->read_only = 1;
+    if (bank_count > 1)
+    {
+        snprintf(name, sizeof(name), "%s_bank%d", declaration->value, bank);
+        array->name = arena_strdup(&plan->scratch, name);
+    }
+}
+
+// Every element access of a partitioned array must pick its bank at compile time
+static int memory_indices_constant(const ASTNode *node, const ASTNode *declaration)
+{
+    if (node->type == NODE_INDEX_EXPR && node->num_children == 2 &&
+        node->children[FIRST_CHILD_INDEX]->type == NODE_EXPRESSION &&
+        node->children[FIRST_CHILD_INDEX]->value != NULL &&
+        strcmp(node->children[FIRST_CHILD_INDEX]->value, declaration->value) == 0)
+    {
+        long long index = 0;
+
+        if (!memory_constant_index(node->children[FIRST_CHILD_INDEX + 1], &index) ||
+            index < 0 || index >= declaration->array_size)
+        {
+            return 0;
+        }
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (!memory_indices_constant(node->children[child_index], declaration))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// The array as one memory, as factor banks, or not at all (registers)
+static void memory_add_candidates(MemoryPlan *plan, ASTNode *function, ASTNode *statement,
+                                  ASTNode *declaration, int threshold)
+{
+    const char *pragma = find_node_pragma(statement, "partition");
+    MemoryPartition partition = MEMORY_PARTITION_NONE;
+    int factor = 1;
+
+    if (pragma != NULL && !memory_parse_partition(pragma, &partition, &factor))
+    {
+        partition = MEMORY_PARTITION_NONE;
+    }
+    if (partition == MEMORY_PARTITION_COMPLETE)
+    {
+        return;
+    }
+
+    if (partition != MEMORY_PARTITION_NONE && factor <= declaration->array_size &&
+        declaration->array_size % factor == 0 && memory_indices_constant(function, declaration))
+    {
+        for (int bank = 0; bank < factor; ++bank)
+        {
+            memory_add_candidate(plan, declaration, partition, bank, factor);
+        }
+        return;
+    }
+    if (declaration->array_size >= threshold)
+    {
+        memory_add_candidate(plan, declaration, MEMORY_PARTITION_NONE, 0, 1);
+    }
+}
+
+int memory_parse_partition(const char *arguments, MemoryPartition *partition, int *factor)
+{
+    const char *cursor = arguments;
+
+    *partition = MEMORY_PARTITION_NONE;
+    *factor = 0;
+    while (*cursor != '\0' && *cursor != '\n')
+    {
+        size_t length = strcspn(cursor, " \t\n");
+
+        if (length == 6 && strncmp(cursor, "cyclic", length) == 0)
+        {
+            *partition = MEMORY_PARTITION_CYCLIC;
+        }
+        else if (length == 5 && strncmp(cursor, "block", length) == 0)
+        {
+            *partition = MEMORY_PARTITION_BLOCK;
+        }
+        else if (length == 8 && strncmp(cursor, "complete", length) == 0)
+        {
+            *partition = MEMORY_PARTITION_COMPLETE;
+        }
+        else if (length > 7 && strncmp(cursor, "factor=", 7) == 0)
+        {
+            char *end = NULL;
+            long value = strtol(cursor + 7, &end, 10);
+
+            if (end != cursor + length || value < 2 || value > MEMORY_MAX_BANKS)
+            {
+                return 0;
+            }
+            *factor = (int)value;
+        }
+        else if (length > 0)
+        {
+            return 0;
+        }
+        cursor += length;
+        cursor += strspn(cursor, " \t");
+    }
+
+    if (*partition == MEMORY_PARTITION_COMPLETE)
+    {
+        return 1;
+    }
+    return *partition != MEMORY_PARTITION_NONE && *factor >= 2;
+}
+
+static ASTNode* memory_output_reference(MemoryPlan *plan, const MemoryArray *array, int port)
+{
+    char name[MEMORY_NAME_SIZE];
+    Arena *previous = ast_use_arena(&plan->scratch);
+    ASTNode *reference = create_node(NODE_EXPRESSION);
+
+    snprintf(name, sizeof(name), "%s_dout_%c", array->name, MEMORY_PORT_SUFFIX[port]);
+    set_node_value(reference, name);
+    ast_use_arena(previous);
+    return reference;
+}
+
+int memory_plan_function(ASTNode *function, int threshold, MemoryPlan *plan)
+{
+    int active_count = 0;
+
+    memset(plan, 0, sizeof(*plan));
+    arena_init(&plan->scratch, 0);
+
+    if (threshold <= 0)
+    {
+        return 0;
+    }
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+        ASTNode *declaration = unwrap_statement_node(child);
+
+        if (child->type == NODE_STATEMENT && declaration->type == NODE_VAR_DECL &&
+            declaration->array_size > 0 && declaration->value != NULL &&
+            find_struct_index_id(declaration->token.id) < 0)
+        {
+            memory_add_candidates(plan, function, child, declaration, threshold);
+        }
+    }
+    if (plan->array_count == 0)
+    {
+        return 0;
+    }
+
+    memory_check_uses(plan, function, NULL, 0);
+    for (int index = 0; index < plan->array_count; ++index)
+    {
+        MemoryArray *array = &plan->arrays[index];
+
+        if (array->active)
+        {
+            active_count++;
+            for (int port = 0; port < MEMORY_PORT_COUNT; ++port)
+            {
+                array->outputs[port] = memory_output_reference(plan, array, port);
+            }
+        }
+    }
+    return active_count;
+}
+
+void memory_plan_free(MemoryPlan *plan)
+{
+    free(plan->arrays);
+    free(plan->accesses);
+    arena_release(&plan->scratch);
+    memset(plan, 0, sizeof(*plan));
+}
+
+int memory_find(const MemoryPlan *plan, const ASTNode *node)
+{
+    const ASTNode *base = NULL;
+    int memory = -1;
+    long long index = 0;
+    int offset = 0;
+
+    if (plan == NULL || node == NULL || node->type != NODE_INDEX_EXPR || node->num_children != 2)
+    {
+        return -1;
+    }
+
+    base = node->children[FIRST_CHILD_INDEX];
+    memory = (base->type == NODE_EXPRESSION) ? memory_by_name(plan, base->value) : -1;
+    if (memory >= 0 && plan->arrays[memory].bank_count > 1 &&
+        memory_constant_index(node->children[FIRST_CHILD_INDEX + 1], &index) &&
+        index >= 0 && index < plan->arrays[memory].declaration->array_size)
+    {
+        memory += memory_bank_of(&plan->arrays[memory], index, &offset);
+    }
+    return memory;
+}
+
+void memory_drop(MemoryPlan *plan, int memory)
+{
+    memory_deactivate(plan, memory);
+    plan->access_count = 0;
+}
+
+int memory_declares(const void *plan, const ASTNode *declaration)
+{
+    const MemoryPlan *memories = (const MemoryPlan*)plan;
+
+    for (int index = 0; index < memories->array_count; ++index)
+    {
+        const MemoryArray *array = &memories->arrays[index];
+
+        if (array->active && array->bank_count > 1 && array->declaration == declaration)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void memory_add_access(MemoryPlan *plan, const MemoryAccess *access)
+{
+    if (plan->access_count >= plan->access_capacity)
+    {
+        plan->access_capacity = (plan->access_capacity > 0) ? plan->access_capacity * 2 : 16;
+        plan->accesses = (MemoryAccess*)xrealloc(plan->accesses,
+            (size_t)plan->access_capacity * sizeof(MemoryAccess));
+    }
+    plan->accesses[plan->access_count++] = *access;
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+static int memory_port_used(const MemoryPlan *plan, int memory, int port)
+{
+    for (int index = 0; index < plan->access_count; ++index)
+    {
+        if (plan->accesses[index].memory == memory && plan->accesses[index].port == port)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Storage of the banks of a partitioned array, each with its share of the initializer
+static void emit_memory_banks(const MemoryArray *first, OutputBuffer *out)
+{
+    const ASTNode *declaration = first->declaration;
+    const char *name = declaration->value;
+    const ASTNode *initializer = NULL;
+
+    if (declaration->num_children > 0 && declaration->children[FIRST_CHILD_INDEX]->value != NULL &&
+        strcmp(declaration->children[FIRST_CHILD_INDEX]->value, ARRAY_INIT_MARKER) == 0)
+    {
+        initializer = declaration->children[FIRST_CHILD_INDEX];
+    }
+
+    out_printf(out, "  -- %s partitioned %s by %d\n", name,
+               (first->partition == MEMORY_PARTITION_CYCLIC) ? "cyclic" : "block", first->bank_count);
+    out_printf(out, "  type %s_bank_type is array (0 to %d) of %s;\n", name, first->size - 1,
+               ctype_to_vhdl(token_text(declaration->token)));
+    for (int bank = 0; bank < first->bank_count; ++bank)
+    {
+        const MemoryArray *array = first + bank;
+
+        out_printf(out, "  signal %s : %s_bank_type", array->name, name);
+        if (initializer != NULL && memory_element(array, 0) < initializer->num_children)
+        {
+            out_puts(out, " := (");
+            for (int offset = 0; offset < array->size; ++offset)
+            {
+                int element = memory_element(array, offset);
+
+                if (element >= initializer->num_children)
+                {
+                    break;
+                }
+                out_puts(out, (offset > 0) ? ", " : "");
+                emit_array_element_literal(declaration, initializer->children[element]->value, out);
+            }
+            out_putc(out, ')');
+        }
+        out_puts(out, ";\n");
+    }
+}
+
+void emit_memory_signals(const MemoryPlan *plan, OutputBuffer *out)
+{
+    for (int memory = 0; memory < plan->array_count; ++memory)
+    {
+        const MemoryArray *array = &plan->arrays[memory];
+        const char *name = array->name;
+        const char *element_type = ctype_to_vhdl(token_text(array->declaration->token));
+
+        if (!array->active)
+        {
+            continue;
+        }
+
+        if (array->bank_count > 1 && array->bank == 0)
+        {
+            emit_memory_banks(array, out);
+        }
+        out_printf(out, "  -- %s %s: %d x %s, read latency 1\n",
+                   array->read_only ? "Block ROM" : "Block RAM",
+                   name, array->size, element_type);
+        for (int port = 0; port < MEMORY_PORT_COUNT; ++port)
+        {
+            char suffix = MEMORY_PORT_SUFFIX[port];
+
+            if (!memory_port_used(plan, memory, port))
+            {
+                continue;
+            }
+            out_printf(out, "  signal %s_addr_%c : integer range 0 to %d;\n",
+                       name, suffix, array->size - 1);
+            out_printf(out, "  signal %s_en_%c : std_logic;\n", name, suffix);
+            if (port == 0 && !array->read_only)
+            {
+                out_printf(out, "  signal %s_we_%c : std_logic;\n", name, suffix);
+                out_printf(out, "  signal %s_din_%c : %s;\n", name, suffix, element_type);
+            }
+            out_printf(out, "  signal %s_dout_%c : %s;\n", name, suffix, element_type);
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: "<signal> <= <value> when state = state_<n> else ..." over the accesses of one port
+// -------------------------------------------------------------
+static void emit_port_condition(const MemoryPlan *plan, int memory, int port, int writes_only, OutputBuffer *out)
+{
+    int first = 1;
+
+    for (int index = 0; index < plan->access_count; ++index)
+    {
+        const MemoryAccess *access = &plan->accesses[index];
+
+        if (access->memory != memory || access->port != port || (writes_only && access->value == NULL))
+        {
+            continue;
+        }
+        out_printf(out, "%sstate = state_%d", first ? "" : " or ", access->state);
+        first = 0;
+    }
+    if (first)
+    {
+        out_puts(out, "false");
+    }
+}
+
+static void emit_port_address(const MemoryPlan *plan, const MemoryAccess *access, OutputBuffer *out,
+                              void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    const MemoryArray *array = &plan->arrays[access->memory];
+    const ASTNode *address = access->node->children[FIRST_CHILD_INDEX + 1];
+    long long index = 0;
+    int offset = 0;
+
+    // The bank is fixed at compile time, so is the address within it
+    if (array->bank_count > 1 && memory_constant_index(address, &index))
+    {
+        memory_bank_of(array, index, &offset);
+        out_printf(out, "%d", offset);
+        return;
+    }
+    if (address->type == NODE_EXPRESSION && is_numeric_literal(address->value))
+    {
+        out_puts(out, address->value);
+        return;
+    }
+    out_puts(out, "to_integer(unsigned(");
+    node_generator((ASTNode*)address, out);
+    out_puts(out, "))");
+}
+
+static void emit_port_mux(const MemoryPlan *plan, int memory, int port, int stored_value,
+                          const char *signal, const char *fallback, OutputBuffer *out,
+                          void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    int pending_else = 0;
+
+    out_printf(out, "  %s <= ", signal);
+    for (int index = 0; index < plan->access_count; ++index)
+    {
+        const MemoryAccess *access = &plan->accesses[index];
+
+        if (access->memory != memory || access->port != port || (stored_value && access->value == NULL))
+        {
+            continue;
+        }
+        if (pending_else)
+        {
+            out_puts(out, " else\n    ");
+        }
+        if (stored_value)
+        {
+            node_generator(access->value, out);
+        }
+        else
+        {
+            emit_port_address(plan, access, out, node_generator);
+        }
+        out_printf(out, " when state = state_%d", access->state);
+        pending_else = 1;
+    }
+    if (pending_else)
+    {
+        out_puts(out, " else\n    ");
+    }
+    out_printf(out, "%s;\n", fallback);
+}
+
+void emit_memory_ports(const MemoryPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    char signal[MEMORY_NAME_SIZE];
+
+    for (int memory = 0; memory < plan->array_count; ++memory)
+    {
+        const MemoryArray *array = &plan->arrays[memory];
+        const char *name = array->name;
+
+        if (!array->active)
+        {
+            continue;
+        }
+
+        for (int port = 0; port < MEMORY_PORT_COUNT; ++port)
+        {
+            char suffix = MEMORY_PORT_SUFFIX[port];
+
+            if (!memory_port_used(plan, memory, port))
+            {
+                continue;
+            }
+            snprintf(signal, sizeof(signal), "%s_addr_%c", name, suffix);
+            emit_port_mux(plan, memory, port, 0, signal, "0", out, node_generator);
+            out_printf(out, "  %s_en_%c <= '1' when ", name, suffix);
+            emit_port_condition(plan, memory, port, 0, out);
+            out_puts(out, " else '0';\n");
+            if (port == 0 && !array->read_only)
+            {
+                out_printf(out, "  %s_we_%c <= '1' when ", name, suffix);
+                emit_port_condition(plan, memory, port, 1, out);
+                out_puts(out, " else '0';\n");
+                snprintf(signal, sizeof(signal), "%s_din_%c", name, suffix);
+                emit_port_mux(plan, memory, port, 1, signal, "(others => '0')", out, node_generator);
+            }
+        }
+
+        // Inference template: no reset, registered output
+        out_printf(out, "  %s_ram : process(clk)\n", name);
+        out_puts(out, "  begin\n");
+        out_puts(out, "    if rising_edge(clk) then\n");
+        for (int port = 0; port < MEMORY_PORT_COUNT; ++port)
+        {
+            char suffix = MEMORY_PORT_SUFFIX[port];
+
+            if (!memory_port_used(plan, memory, port))
+            {
+                continue;
+            }
+            out_printf(out, "      if %s_en_%c = '1' then\n", name, suffix);
+            if (port == 0 && !array->read_only)
+            {
+                out_printf(out, "        if %s_we_a = '1' then\n", name);
+                out_printf(out, "          %s(%s_addr_a) <= %s_din_a;\n", name, name, name);
+                out_puts(out, "        end if;\n");
+            }
+            out_printf(out, "        %s_dout_%c <= %s(%s_addr_%c);\n", name, suffix, name, name, suffix);
+            out_puts(out, "      end if;\n");
+        }
+        out_puts(out, "    end if;\n");
+        out_puts(out, "  end process;\n");
+    }
+}
+
+void memory_bind(MemoryPlan *plan)
+{
+    for (int index = 0; index < plan->access_count; ++index)
+    {
+        MemoryAccess *access = &plan->accesses[index];
+
+        if (access->value == NULL && access->parent->children[access->child_index] == access->node)
+        {
+            access->parent->children[access->child_index] = plan->arrays[access->memory].outputs[access->port];
+        }
+    }
+}
+
+void memory_unbind(MemoryPlan *plan)
+{
+    for (int index = 0; index < plan->access_count; ++index)
+    {
+        MemoryAccess *access = &plan->accesses[index];
+
+        if (access->value == NULL &&
+            access->parent->children[access->child_index] == plan->arrays[access->memory].outputs[access->port])
+        {
+            access->parent->children[access->child_index] = access->node;
+        }
+    }
+}
@@ -0,0 +1,114 @@
+// VHDL Code Generator - Block RAM Inference
+// -------------------------------------------------------------
+// Purpose: Map large local arrays of state machine functions onto the
+//          block RAM / ROM inference template: a clocked read port with
+//          one cycle of latency, plus a second read port when needed
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_MEMORY_H
+#define CODEGEN_VHDL_MEMORY_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "arena.h"
+#include "intern.h"
+
+// Port a reads and writes, port b only reads
+#define MEMORY_PORT_COUNT 2
+
+// "#pragma compi partition <kind> [factor=N]" on an array declaration
+typedef enum {
+    MEMORY_PARTITION_NONE,
+    MEMORY_PARTITION_CYCLIC,   // Element k in bank k % factor
+    MEMORY_PARTITION_BLOCK,    // Element k in bank k / (size / factor)
+    MEMORY_PARTITION_COMPLETE  // Kept as registers: every element readable at once
+} MemoryPartition;
+
+// -------------------------------------------------------------
+// Memory plan
+// -------------------------------------------------------------
+// One block RAM: a whole array, or one bank of a partitioned array
+typedef struct {
+    ASTNode *declaration;      // Top-level array declaration
+    InternId name_id;
+    const char *name;          // Signal prefix: the array, or <array>_bank<n>
+    int size;                  // Elements held
+    MemoryPartition partition;
+    int bank;                  // Banks of one array are consecutive entries
+    int bank_count;            // 1 = not partitioned
+    int active;                // 0 = left as a register array
+    int read_only;             // Never assigned: inferred as ROM
+    ASTNode *outputs[MEMORY_PORT_COUNT]; // References to <name>_dout_a/_b, swapped in while bound
+} MemoryArray;
+
+// One element access, placed in a state by the scheduler
+typedef struct {
+    ASTNode *node;             // NODE_INDEX_EXPR into the memory
+    ASTNode *parent;           // Read: node whose child it is (swapped for the port output)
+    int child_index;
+    ASTNode *value;            // Write: value stored (NULL = read)
+    int memory;
+    int port;
+    int state;                 // Address presented (read data valid in the next state)
+} MemoryAccess;
+
+typedef struct {
+    MemoryArray *arrays;
+    int array_count;
+    int array_capacity;
+    MemoryAccess *accesses;
+    int access_count;
+    int access_capacity;
+    Arena scratch;             // Port output reference nodes
+} MemoryPlan;
+
+/**
+ * Parse the arguments of a partition pragma: cyclic, block or complete,
+ * and factor=N (required for cyclic and block, at least 2)
+ *
+ * @return 1 if well-formed, 0 to ignore the pragma
+ */
+int memory_parse_partition(const char *arguments, MemoryPartition *partition, int *factor);
+
+/**
+ * Select the local arrays of at least threshold elements that are only
+ * ever accessed element-wise (threshold <= 0 selects none). An array with
+ * a cyclic or block partition pragma is split into factor memories of any
+ * size when every index is a constant (see unroll_expand_function), so
+ * accesses to different banks share a state; "complete" keeps registers.
+ *
+ * @return Number of memories placed in block RAM (plan still needs memory_plan_free)
+ */
+int memory_plan_function(ASTNode *function, int threshold, MemoryPlan *plan);
+
+void memory_plan_free(MemoryPlan *plan);
+
+// Memory index of an element access into a block RAM array, or -1
+int memory_find(const MemoryPlan *plan, const ASTNode *node);
+
+// Keep a memory (with the other banks of its array) as registers after all;
+// forgets all scheduled accesses
+void memory_drop(MemoryPlan *plan, int memory);
+
+// Whether the plan declares the storage of an array itself (its banks); the
+// signature fits emit_function_local_signals
+int memory_declares(const void *plan, const ASTNode *declaration);
+
+void memory_add_access(MemoryPlan *plan, const MemoryAccess *access);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Architecture declarations of the port signals (an unpartitioned array
+// itself is a local) and of the banks of partitioned arrays
+void emit_memory_signals(const MemoryPlan *plan, OutputBuffer *out);
+
+// Port multiplexers selected by the FSM state, and one clocked RAM process
+// per memory (call before memory_bind)
+void emit_memory_ports(const MemoryPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+// Point every scheduled read at its port output (undo with memory_unbind)
+void memory_bind(MemoryPlan *plan);
+void memory_unbind(MemoryPlan *plan);
+
+#endif // CODEGEN_VHDL_MEMORY_H
@@ -0,0 +1,927 @@
+// VHDL Code Generator - Loop Pipelining Implementation
+// -------------------------------------------------------------
+// Every body statement is one registered operation, so the schedule is a
+// start time per statement, counted in cycles from the issue of its
+// iteration. Dependences constrain the times:
+//
+//   time[target] >= time[source] + latency - II * distance
+//
+// A statement reading a scalar waits one cycle for the statement that
+// assigns it, in the same iteration (distance 0) or, when the assignment
+// comes later in the body, in the previous one (distance 1). Array reads
+// and writes keep their order within and across iterations. Without
+// resource limits the smallest feasible II is the recurrence bound, found
+// by raising the requested II until the longest-path relaxation of the
+// constraints converges (no positive cycle).
+//
+// Iterations overlap, so a signal may have been overwritten by a later
+// iteration before a statement reads it. Each read therefore takes the
+// value the signal had a fixed number of cycles ago, from a chain of delay
+// registers shifted every cycle (<name>_d1, <name>_d2, ...). With the issue
+// at time 0 and the counter updated there, body statements read the
+// counter of their iteration time[statement] cycles back.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_modulo.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_reset.h"
+#include "codegen_vhdl_types.h"
+#include "codegen_vhdl_expressions.h"
+#include "codegen_vhdl_statements.h"
+#include "symbol_structs.h"
+#include "symbol_table.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MODULO_NAME_SIZE 256
+
+// Statements of a stage sit two levels under the clocked branch
+#define MODULO_INDENT "    "
+
+// An array element read or written by an operation
+typedef struct {
+    InternId array_id;
+    const char *name;
+    int operation;
+    int is_write;
+} ModuloAccess;
+
+typedef struct {
+    ModuloPlan *plan;
+    const ASTNode *function;
+    InternId counter_id;
+    SymbolTable definitions;   // Scalar -> operation assigning it
+    ModuloAccess *accesses;
+    int access_count;
+    int access_capacity;
+} ModuloAnalysis;
+
+// Helper: delay registers copy the signal, so it must be a plain scalar
+static int is_plain_scalar(const ASTNode *declaration)
+{
+    return declaration != NULL && declaration->array_size == 0 && declaration->token.type == TOKEN_KEYWORD &&
+           declaration->token.id != INTERN_KW_VOID && declaration->token.id != INTERN_KW_FLOAT &&
+           declaration->token.id != INTERN_KW_DOUBLE && find_struct_index_id(declaration->token.id) < 0;
+}
+
+// Helper: "#pragma compi pipeline [II=N]" (0 = not given)
+static int requested_interval(const ASTNode *statement)
+{
+    const char *arguments = find_node_pragma(statement, "pipeline");
+    const char *setting = NULL;
+    int interval = 0;
+
+    if (arguments == NULL)
+    {
+        return 0;
+    }
+    setting = strstr(arguments, "II=");
+    if (setting == NULL)
+    {
+        setting = strstr(arguments, "ii=");
+    }
+    interval = (setting != NULL) ? atoi(setting + 3) : 1;
+    return (interval > 0) ? interval : 1;
+}
+
+static int modulo_add_edge(ModuloPlan *plan, int source, int target, int latency, int distance, const char *name)
+{
+    ModuloEdge *edge = NULL;
+
+    if (plan->edge_count == plan->edge_capacity)
+    {
+        plan->edge_capacity = plan->edge_capacity ? plan->edge_capacity * 2 : 16;
+        plan->edges = (ModuloEdge*)xrealloc(plan->edges, (size_t)plan->edge_capacity * sizeof(ModuloEdge));
+    }
+    edge = &plan->edges[plan->edge_count];
+    edge->source = source;
+    edge->target = target;
+    edge->latency = latency;
+    edge->distance = distance;
+    edge->name = name;
+    return plan->edge_count++;
+}
+
+static void modulo_add_read(ModuloPlan *plan, ASTNode *parent, int child_index, int edge)
+{
+    ModuloRead *read = NULL;
+
+    if (plan->read_count == plan->read_capacity)
+    {
+        plan->read_capacity = plan->read_capacity ? plan->read_capacity * 2 : 16;
+        plan->reads = (ModuloRead*)xrealloc(plan->reads, (size_t)plan->read_capacity * sizeof(ModuloRead));
+    }
+    read = &plan->reads[plan->read_count++];
+    read->parent = parent;
+    read->child_index = child_index;
+    read->original = parent->children[child_index];
+    read->delayed = NULL;
+    read->edge = edge;
+}
+
+static void modulo_add_access(ModuloAnalysis *analysis, const ASTNode *base, int operation, int is_write)
+{
+    ModuloAccess *access = NULL;
+
+    if (analysis->access_count == analysis->access_capacity)
+    {
+        analysis->access_capacity = analysis->access_capacity ? analysis->access_capacity * 2 : 8;
+        analysis->accesses = (ModuloAccess*)xrealloc(analysis->accesses,
+                                                     (size_t)analysis->access_capacity * sizeof(ModuloAccess));
+    }
+    access = &analysis->accesses[analysis->access_count++];
+    access->name = base->value;
+    access->array_id = intern_cstr(base->value);
+    access->operation = operation;
+    access->is_write = is_write;
+}
+
+// -------------------------------------------------------------
+// Dependence graph
+// -------------------------------------------------------------
+static int modulo_define(ModuloAnalysis *analysis, const char *name, const ASTNode *declaration, int operation)
+{
+    InternId name_id = intern_cstr(name);
+
+    // One assignment per scalar, never the counter
+    if (name_id == analysis->counter_id || symbol_lookup(&analysis->definitions, name_id, NULL) ||
+        !is_plain_scalar(declaration))
+    {
+        return 0;
+    }
+    symbol_define(&analysis->definitions, name_id, operation);
+    return 1;
+}
+
+// Outputs of a body statement: the scalars it assigns and the arrays it writes
+static int modulo_collect_definitions(ModuloAnalysis *analysis, const ASTNode *node, int operation, int top_level)
+{
+    const ASTNode *target = NULL;
+
+    switch (node->type)
+    {
+        case NODE_FOR_STATEMENT:
+        case NODE_WHILE_STATEMENT:
+        case NODE_BREAK_STATEMENT:
+        case NODE_CONTINUE_STATEMENT:
+        case NODE_FUNC_CALL:
+        case NODE_MEMBER_EXPR:
+            return 0;
+
+        case NODE_STATEMENT:
+            if (node->token.id == INTERN_KW_RETURN)
+            {
+                return 0;
+            }
+            break;
+
+        case NODE_VAR_DECL:
+            if (!top_level || node->num_children != 1 ||
+                !modulo_define(analysis, node->value ? node->value : "", node, operation))
+            {
+                return 0;
+            }
+            break;
+
+        case NODE_ASSIGNMENT:
+            if (node->num_children != 2)
+            {
+                return 0;
+            }
+            target = node->children[FIRST_CHILD_INDEX];
+            if (target->type == NODE_INDEX_EXPR && target->num_children == 2 &&
+                identifier_name(target->children[FIRST_CHILD_INDEX]) != NULL)
+            {
+                modulo_add_access(analysis, target->children[FIRST_CHILD_INDEX], operation, 1);
+            }
+            else if (identifier_name(target) == NULL || target->value[0] == '-' ||
+                     !modulo_define(analysis, target->value,
+                                    find_declaration(analysis->function, target->value), operation))
+            {
+                return 0;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (!modulo_collect_definitions(analysis, node->children[child_index], operation,
+                                        node->type == NODE_STATEMENT && top_level))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Inputs of a body statement: an edge from whatever produced each scalar
+static void modulo_collect_reads(ModuloAnalysis *analysis, ASTNode *node, int operation)
+{
+    ModuloPlan *plan = analysis->plan;
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        ASTNode *child = node->children[child_index];
+        const char *name = identifier_name(child);
+        int is_target = (node->type == NODE_ASSIGNMENT && child_index == FIRST_CHILD_INDEX);
+        int source = 0;
+
+        if (name != NULL)
+        {
+            InternId name_id = intern_find(name, strlen(name));
+
+            if (is_target || (node->type == NODE_INDEX_EXPR && child_index == FIRST_CHILD_INDEX))
+            {
+                continue;
+            }
+            if (name_id == analysis->counter_id)
+            {
+                modulo_add_read(plan, node, child_index, modulo_add_edge(plan, 0, operation, 0, 0, name));
+            }
+            else if (symbol_lookup(&analysis->definitions, name_id, &source))
+            {
+                modulo_add_read(plan, node, child_index,
+                                modulo_add_edge(plan, source, operation, 1, (source >= operation), name));
+            }
+            continue;
+        }
+        if (child->type == NODE_INDEX_EXPR && !is_target && child->num_children == 2 &&
+            identifier_name(child->children[FIRST_CHILD_INDEX]) != NULL)
+        {
+            modulo_add_access(analysis, child->children[FIRST_CHILD_INDEX], operation, 0);
+        }
+        modulo_collect_reads(analysis, child, operation);
+    }
+}
+
+// Helper: whether node reads a value the body produces (or calls anything)
+static int reads_body_values(const ModuloAnalysis *analysis, const ASTNode *node)
+{
+    const char *name = identifier_name(node);
+
+    if (node->type == NODE_FUNC_CALL ||
+        (name != NULL && symbol_lookup(&analysis->definitions, intern_find(name, strlen(name)), NULL)))
+    {
+        return 1;
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (reads_body_values(analysis, node->children[child_index]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Element accesses of one array stay in order within and across iterations
+static void modulo_order_accesses(ModuloAnalysis *analysis)
+{
+    for (int first = 0; first < analysis->access_count; ++first)
+    {
+        for (int second = first + 1; second < analysis->access_count; ++second)
+        {
+            const ModuloAccess *early = &analysis->accesses[first];
+            const ModuloAccess *late = &analysis->accesses[second];
+            int p = early->operation;
+            int q = late->operation;
+
+            if (early->array_id != late->array_id || p == q || (!early->is_write && !late->is_write))
+            {
+                continue;
+            }
+            if (early->is_write && !late->is_write)
+            {
+                // Read after write, before the next iteration's write
+                modulo_add_edge(analysis->plan, p, q, 1, 0, early->name);
+                modulo_add_edge(analysis->plan, q, p, 0, 1, early->name);
+            }
+            else
+            {
+                // Write after read or write, before the later one's next iteration
+                modulo_add_edge(analysis->plan, p, q, 0, 0, early->name);
+                modulo_add_edge(analysis->plan, q, p, 1, 1, early->name);
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// Loop shape
+// -------------------------------------------------------------
+// Body statements of the loop: [first, last)
+static void loop_body_range(const ModuloPlan *plan, int *first, int *last)
+{
+    if (plan->loop->type == NODE_FOR_STATEMENT)
+    {
+        *first = FIRST_STATEMENT_INDEX + 1;
+        *last = plan->loop->num_children - 1;
+    }
+    else
+    {
+        *first = FIRST_STATEMENT_INDEX;
+        *last = plan->loop->num_children - 1; // The counter update is issued separately
+    }
+}
+
+static int modulo_loop_shape(ModuloPlan *plan, const ASTNode *function)
+{
+    ASTNode *loop = plan->loop;
+    ASTNode *last = NULL;
+    const char *counter = NULL;
+
+    if (loop->type == NODE_FOR_STATEMENT)
+    {
+        if (loop->num_children < 3 ||
+            (loop->children[FIRST_CHILD_INDEX]->type != NODE_VAR_DECL &&
+             loop->children[FIRST_CHILD_INDEX]->type != NODE_ASSIGNMENT))
+        {
+            return 0;
+        }
+        plan->init = loop->children[FIRST_CHILD_INDEX];
+        plan->condition = loop->children[FIRST_STATEMENT_INDEX];
+        plan->increment = loop->children[loop->num_children - 1];
+    }
+    else
+    {
+        if (loop->num_children < 2)
+        {
+            return 0;
+        }
+        plan->condition = loop->children[FIRST_CHILD_INDEX];
+        last = loop->children[loop->num_children - 1];
+        if (last->type != NODE_STATEMENT || last->num_children != 1)
+        {
+            return 0;
+        }
+        plan->increment = last->children[FIRST_CHILD_INDEX];
+    }
+
+    if (plan->increment->type != NODE_ASSIGNMENT || plan->increment->num_children != 2 ||
+        (counter = identifier_name(plan->increment->children[FIRST_CHILD_INDEX])) == NULL ||
+        plan->increment->children[FIRST_CHILD_INDEX]->value[0] == '-' ||
+        !is_plain_scalar(find_declaration(function, counter)))
+    {
+        return 0;
+    }
+    plan->variable = counter;
+    return 1;
+}
+
+static int modulo_analyze(ModuloPlan *plan, ModuloAnalysis *analysis)
+{
+    int first = 0;
+    int last = 0;
+
+    loop_body_range(plan, &first, &last);
+    plan->operation_count = 1 + (last - first);
+    plan->operations = (ModuloOperation*)xrealloc(NULL, (size_t)plan->operation_count * sizeof(ModuloOperation));
+    memset(plan->operations, 0, (size_t)plan->operation_count * sizeof(ModuloOperation));
+    for (int child_index = first; child_index < last; ++child_index)
+    {
+        ASTNode *statement = plan->loop->children[child_index];
+
+        if (statement->type != NODE_STATEMENT)
+        {
+            return 0;
+        }
+        plan->operations[1 + child_index - first].statement = statement;
+    }
+
+    for (int operation = 1; operation < plan->operation_count; ++operation)
+    {
+        if (!modulo_collect_definitions(analysis, plan->operations[operation].statement, operation, 1))
+        {
+            return 0;
+        }
+    }
+    // The counter is updated and tested on issue, from values the body leaves alone
+    if (reads_body_values(analysis, plan->condition) || reads_body_values(analysis, plan->increment) ||
+        (plan->init != NULL && reads_body_values(analysis, plan->init)))
+    {
+        return 0;
+    }
+    for (int operation = 1; operation < plan->operation_count; ++operation)
+    {
+        modulo_collect_reads(analysis, plan->operations[operation].statement, operation);
+    }
+    modulo_order_accesses(analysis);
+    return 1;
+}
+
+// -------------------------------------------------------------
+// Scheduling
+// -------------------------------------------------------------
+// Longest-path times at interval ii; 0 when a recurrence does not fit
+static int modulo_schedule(ModuloPlan *plan, int ii)
+{
+    for (int operation = 0; operation < plan->operation_count; ++operation)
+    {
+        plan->operations[operation].time = (operation > 0) ? 1 : 0;
+    }
+    for (int pass = 0; pass <= plan->operation_count; ++pass)
+    {
+        int changed = 0;
+
+        for (int edge_index = 0; edge_index < plan->edge_count; ++edge_index)
+        {
+            const ModuloEdge *edge = &plan->edges[edge_index];
+            int time = plan->operations[edge->source].time + edge->latency - ii * edge->distance;
+
+            if (time > plan->operations[edge->target].time)
+            {
+                plan->operations[edge->target].time = time;
+                changed = 1;
+            }
+        }
+        if (!changed)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Helper: cycles around the recurrence an edge from the previous iteration closes
+static int recurrence_length(const ModuloPlan *plan, const ModuloEdge *carried)
+{
+    int *length = (int*)xrealloc(NULL, (size_t)plan->operation_count * sizeof(int));
+    int cycles = 0;
+
+    // Same-iteration edges run forward in the body, so one sweep is enough
+    for (int operation = 0; operation < plan->operation_count; ++operation)
+    {
+        length[operation] = -1;
+    }
+    length[carried->target] = 0;
+    for (int operation = carried->target; operation < plan->operation_count; ++operation)
+    {
+        for (int edge_index = 0; length[operation] >= 0 && edge_index < plan->edge_count; ++edge_index)
+        {
+            const ModuloEdge *edge = &plan->edges[edge_index];
+
+            if (edge->source == operation && edge->distance == 0 &&
+                length[operation] + edge->latency > length[edge->target])
+            {
+                length[edge->target] = length[operation] + edge->latency;
+            }
+        }
+    }
+    cycles = (length[carried->source] >= 0) ? length[carried->source] + carried->latency : 0;
+    free(length);
+    return cycles;
+}
+
+static void modulo_find_recurrence(ModuloPlan *plan)
+{
+    for (int edge_index = 0; edge_index < plan->edge_count; ++edge_index)
+    {
+        const ModuloEdge *edge = &plan->edges[edge_index];
+        int cycles = (edge->distance > 0) ? recurrence_length(plan, edge) : 0;
+
+        if (cycles > plan->recurrence_cycles)
+        {
+            plan->recurrence_cycles = cycles;
+            plan->recurrence = edge->name;
+        }
+    }
+}
+
+// Delay registers for the reads of earlier cycles
+static void modulo_assign_delays(ModuloPlan *plan, const ASTNode *function)
+{
+    for (int read_index = 0; read_index < plan->read_count; ++read_index)
+    {
+        ModuloRead *read = &plan->reads[read_index];
+        const ModuloEdge *edge = &plan->edges[read->edge];
+        int delay = plan->operations[edge->target].time - plan->operations[edge->source].time -
+                    edge->latency + plan->ii * edge->distance;
+        InternId name_id = intern_cstr(edge->name);
+        ModuloChain *chain = NULL;
+        char name[MODULO_NAME_SIZE];
+        Arena *previous = NULL;
+
+        if (delay <= 0)
+        {
+            continue;
+        }
+        for (int chain_index = 0; chain_index < plan->chain_count; ++chain_index)
+        {
+            if (plan->chains[chain_index].name_id == name_id)
+            {
+                chain = &plan->chains[chain_index];
+            }
+        }
+        if (chain == NULL)
+        {
+            if (plan->chain_count == plan->chain_capacity)
+            {
+                plan->chain_capacity = plan->chain_capacity ? plan->chain_capacity * 2 : 8;
+                plan->chains = (ModuloChain*)xrealloc(plan->chains,
+                                                      (size_t)plan->chain_capacity * sizeof(ModuloChain));
+            }
+            chain = &plan->chains[plan->chain_count++];
+            chain->name_id = name_id;
+            chain->name = edge->name;
+            chain->declaration = find_declaration(function, edge->name);
+            chain->depth = 0;
+        }
+        if (delay > chain->depth)
+        {
+            chain->depth = delay;
+        }
+
+        // Negated reads keep their sign
+        snprintf(name, sizeof(name), "%s%s_d%d", (read->original->value[0] == '-') ? "-" : "", edge->name, delay);
+        previous = ast_use_arena(&plan->scratch);
+        read->delayed = create_node(NODE_EXPRESSION);
+        set_node_value(read->delayed, name);
+        ast_use_arena(previous);
+    }
+}
+
+// -------------------------------------------------------------
+// Function shape
+// -------------------------------------------------------------
+// Helper: code outside the loop: no loops, calls or early returns
+static int modulo_scalar_code(const ASTNode *node)
+{
+    if (node->type == NODE_FOR_STATEMENT || node->type == NODE_WHILE_STATEMENT ||
+        node->type == NODE_BREAK_STATEMENT || node->type == NODE_CONTINUE_STATEMENT ||
+        node->type == NODE_FUNC_CALL || (node->type == NODE_STATEMENT && node->token.id == INTERN_KW_RETURN))
+    {
+        return 0;
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (!modulo_scalar_code(node->children[child_index]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int modulo_function_shape(ModuloPlan *plan, ASTNode *function)
+{
+    plan->loop_index = -1;
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+        int interval = 0;
+
+        if (child->type == NODE_VAR_DECL)
+        {
+            continue;
+        }
+        if (child->type != NODE_STATEMENT)
+        {
+            return 0;
+        }
+        interval = (child->num_children == 1) ? requested_interval(child) : 0;
+        if (plan->loop_index < 0 && interval > 0 &&
+            (child->children[FIRST_CHILD_INDEX]->type == NODE_FOR_STATEMENT ||
+             child->children[FIRST_CHILD_INDEX]->type == NODE_WHILE_STATEMENT))
+        {
+            plan->requested_ii = interval;
+            plan->loop_index = child_index;
+            plan->loop = child->children[FIRST_CHILD_INDEX];
+        }
+        else if (plan->loop_index < 0)
+        {
+            if (!modulo_scalar_code(child))
+            {
+                return 0;
+            }
+        }
+        else if (plan->result != NULL || child->token.id != INTERN_KW_RETURN || child->num_children != 1 ||
+                 !modulo_scalar_code(child->children[FIRST_CHILD_INDEX]))
+        {
+            return 0;
+        }
+        else
+        {
+            plan->result = child;
+        }
+    }
+    return plan->loop != NULL;
+}
+
+// Helper: the interval the first pipeline pragma below node asks for
+static int pipeline_requested(const ASTNode *node)
+{
+    int interval = (node->type == NODE_STATEMENT) ? requested_interval(node) : 0;
+
+    for (int child_index = 0; interval == 0 && child_index < node->num_children; ++child_index)
+    {
+        interval = pipeline_requested(node->children[child_index]);
+    }
+    return interval;
+}
+
+int modulo_plan_function(ASTNode *function, ModuloPlan *plan)
+{
+    ModuloAnalysis analysis;
+    int analyzed = 0;
+
+    memset(plan, 0, sizeof(*plan));
+    arena_init(&plan->scratch, 0);
+    // Reported as not pipelined from here on
+    plan->requested_ii = pipeline_requested(function);
+    if (plan->requested_ii == 0)
+    {
+        return 0;
+    }
+    if (!modulo_function_shape(plan, function) || !modulo_loop_shape(plan, function))
+    {
+        return 0;
+    }
+
+    memset(&analysis, 0, sizeof(analysis));
+    analysis.plan = plan;
+    analysis.function = function;
+    analysis.counter_id = intern_cstr(plan->variable);
+    symbol_table_init(&analysis.definitions);
+    analyzed = modulo_analyze(plan, &analysis);
+    symbol_table_free(&analysis.definitions);
+    free(analysis.accesses);
+    if (!analyzed)
+    {
+        return 0;
+    }
+
+    for (int ii = plan->requested_ii; ii <= MODULO_MAX_II; ++ii)
+    {
+        if (modulo_schedule(plan, ii))
+        {
+            plan->ii = ii;
+            break;
+        }
+    }
+    if (plan->ii == 0)
+    {
+        return 0;
+    }
+    plan->stage_count = 1;
+    for (int operation = 1; operation < plan->operation_count; ++operation)
+    {
+        if (plan->operations[operation].time > plan->stage_count)
+        {
+            plan->stage_count = plan->operations[operation].time;
+        }
+    }
+    if (plan->ii > plan->requested_ii)
+    {
+        modulo_find_recurrence(plan);
+    }
+    modulo_assign_delays(plan, function);
+    return 1;
+}
+
+void modulo_plan_free(ModuloPlan *plan)
+{
+    free(plan->operations);
+    free(plan->edges);
+    free(plan->reads);
+    free(plan->chains);
+    arena_release(&plan->scratch);
+    memset(plan, 0, sizeof(*plan));
+}
+
+void modulo_bind(ModuloPlan *plan)
+{
+    for (int read_index = 0; read_index < plan->read_count; ++read_index)
+    {
+        ModuloRead *read = &plan->reads[read_index];
+
+        if (read->delayed != NULL)
+        {
+            read->parent->children[read->child_index] = read->delayed;
+        }
+    }
+}
+
+void modulo_unbind(ModuloPlan *plan)
+{
+    for (int read_index = 0; read_index < plan->read_count; ++read_index)
+    {
+        ModuloRead *read = &plan->reads[read_index];
+        read->parent->children[read->child_index] = read->original;
+    }
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+void emit_modulo_signals(const ModuloPlan *plan, OutputBuffer *out)
+{
+    for (int operation = 1; operation < plan->operation_count; ++operation)
+    {
+        ASTNode *statement = plan->operations[operation].statement;
+
+        for (int child_index = 0; child_index < statement->num_children; ++child_index)
+        {
+            if (statement->children[child_index]->type == NODE_VAR_DECL)
+            {
+                process_variable_declaration_for_signals(statement->children[child_index], out);
+            }
+        }
+    }
+    for (int chain_index = 0; chain_index < plan->chain_count; ++chain_index)
+    {
+        const ModuloChain *chain = &plan->chains[chain_index];
+
+        for (int delay = 1; delay <= chain->depth; ++delay)
+        {
+            out_printf(out, "  signal %s_d%d : %s;\n", chain->name, delay,
+                       ctype_to_vhdl(token_text(chain->declaration->token)));
+        }
+    }
+    out_puts(out, "  signal pipe_busy : std_logic");
+    emit_power_up_value("'0'", out);
+    out_puts(out, ";\n");
+    out_puts(out, "  signal pipe_issuing : std_logic");
+    emit_power_up_value("'0'", out);
+    out_puts(out, ";\n");
+    out_printf(out, "  signal pipe_valid : std_logic_vector(1 to %d)", plan->stage_count);
+    emit_power_up_value("(others => '0')", out);
+    out_puts(out, ";\n");
+    if (plan->ii > 1)
+    {
+        out_printf(out, "  signal pipe_phase : integer range 0 to %d;\n", plan->ii - 1);
+    }
+}
+
+void emit_modulo_report(const ModuloPlan *plan, OutputBuffer *out)
+{
+    if (plan->ii == 0)
+    {
+        out_puts(out, "  -- Loop not pipelined: needs a counter loop of straight-line statements\n");
+        return;
+    }
+    out_printf(out, "  -- Pipelined loop over %s: II=%d", plan->variable, plan->ii);
+    if (plan->ii > plan->requested_ii && plan->recurrence != NULL)
+    {
+        out_printf(out, " (requested %d, recurrence on %s takes %d cycles)", plan->requested_ii,
+                   plan->recurrence, plan->recurrence_cycles);
+    }
+    out_printf(out, ", %d stage%s\n", plan->stage_count, (plan->stage_count == 1) ? "" : "s");
+}
+
+void emit_modulo_reset(const ModuloPlan *plan, OutputBuffer *out)
+{
+    (void)plan;
+    out_puts(out, "      pipe_busy <= '0';\n");
+    out_puts(out, "      pipe_issuing <= '0';\n");
+    out_puts(out, "      pipe_valid <= (others => '0');\n");
+    out_puts(out, "      done <= '0';\n");
+}
+
+// -------------------------------------------------------------
+// Helper: statement output moved under the branch it runs in
+// -------------------------------------------------------------
+static void emit_modulo_indented(OutputBuffer *lines, const char *indentation, OutputBuffer *out)
+{
+    size_t position = 0;
+
+    while (position < lines->length)
+    {
+        const char *line = lines->data + position;
+        const char *end = memchr(line, '\n', lines->length - position);
+        size_t length = (end != NULL) ? (size_t)(end - line) + 1 : lines->length - position;
+
+        out_puts(out, indentation);
+        out_write(out, line, length);
+        position += length;
+    }
+    lines->length = 0;
+}
+
+// Helper: the counter initialisation or update at the given indentation
+static void emit_counter_statement(ASTNode *construct, const char *indentation, OutputBuffer *out,
+                                   void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    if (construct->type == NODE_VAR_DECL)
+    {
+        emit_variable_initializer(construct, out, indentation, node_generator);
+    }
+    else
+    {
+        // The assignment emitter indents scalar targets twice
+        out_puts(out, indentation);
+        emit_variable_assignment(construct, out, INDENT_LEVEL_0, node_generator);
+    }
+}
+
+void emit_modulo_process(ASTNode *function, const ModuloPlan *plan, OutputBuffer *out,
+                         void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    OutputBuffer lines;
+
+    output_buffer_init(&lines, NULL);
+    out_puts(out, "      done <= '0';\n");
+    for (int chain_index = 0; chain_index < plan->chain_count; ++chain_index)
+    {
+        const ModuloChain *chain = &plan->chains[chain_index];
+
+        out_printf(out, "      %s_d1 <= ", chain->name);
+        emit_mapped_signal_name(chain->name, out);
+        out_puts(out, ";\n");
+        for (int delay = 2; delay <= chain->depth; ++delay)
+        {
+            out_printf(out, "      %s_d%d <= %s_d%d;\n", chain->name, delay, chain->name, delay - 1);
+        }
+    }
+    if (plan->stage_count > 1)
+    {
+        out_printf(out, "      pipe_valid(2 to %d) <= pipe_valid(1 to %d);\n", plan->stage_count, plan->stage_count - 1);
+    }
+    out_puts(out, "      pipe_valid(1) <= '0';\n");
+
+    // Idle: on start the prelude, the counter and the pipeline state all
+    // begin afresh, so a call never sees the one before it
+    out_puts(out, "      if pipe_busy = '0' then\n");
+    out_puts(out, "        if start = '1' then\n");
+    for (int child_index = 0; child_index < plan->loop_index; ++child_index)
+    {
+        if (function->children[child_index]->type == NODE_STATEMENT)
+        {
+            node_generator(function->children[child_index], &lines);
+        }
+    }
+    emit_modulo_indented(&lines, MODULO_INDENT, out);
+    if (plan->init != NULL)
+    {
+        emit_counter_statement(plan->init, "          ", out, node_generator);
+    }
+    out_puts(out, "          pipe_busy <= '1';\n");
+    out_puts(out, "          pipe_issuing <= '1';\n");
+    out_puts(out, "          pipe_valid <= (others => '0');\n");
+    if (plan->ii > 1)
+    {
+        out_puts(out, "          pipe_phase <= 0;\n");
+    }
+    out_puts(out, "        end if;\n");
+    out_puts(out, "      else\n");
+
+    // Issue: a new iteration every II cycles while the condition holds
+    if (plan->ii > 1)
+    {
+        out_printf(out, "        if pipe_phase = %d then\n", plan->ii - 1);
+        out_puts(out, "          pipe_phase <= 0;\n");
+        out_puts(out, "        else\n");
+        out_puts(out, "          pipe_phase <= pipe_phase + 1;\n");
+        out_puts(out, "        end if;\n");
+        out_printf(out, "        if pipe_issuing = '1' and pipe_phase = %d then\n", plan->ii - 1);
+    }
+    else
+    {
+        out_puts(out, "        if pipe_issuing = '1' then\n");
+    }
+    out_puts(out, "          if ");
+    emit_conditional_expression(plan->condition, out);
+    out_puts(out, " then\n");
+    out_puts(out, "            pipe_valid(1) <= '1';\n");
+    emit_counter_statement(plan->increment, "            ", out, node_generator);
+    out_puts(out, "          else\n");
+    out_puts(out, "            pipe_issuing <= '0';\n");
+    out_puts(out, "          end if;\n");
+    out_puts(out, "        end if;\n");
+
+    // Stages: each statement for the iteration issued that many cycles ago
+    for (int stage = 1; stage <= plan->stage_count; ++stage)
+    {
+        for (int operation = 1; operation < plan->operation_count; ++operation)
+        {
+            if (plan->operations[operation].time == stage)
+            {
+                node_generator(plan->operations[operation].statement, &lines);
+            }
+        }
+        if (lines.length > 0)
+        {
+            out_printf(out, "        if pipe_valid(%d) = '1' then\n", stage);
+            emit_modulo_indented(&lines, MODULO_INDENT, out);
+            out_puts(out, "        end if;\n");
+        }
+    }
+
+    // Epilogue done: the last iteration has left every stage
+    out_puts(out, "        if pipe_issuing = '0' and unsigned(pipe_valid) = 0 then\n");
+    if (plan->result != NULL)
+    {
+        node_generator(plan->result, &lines);
+        emit_modulo_indented(&lines, MODULO_INDENT, out);
+    }
+    out_puts(out, "          done <= '1';\n");
+    out_puts(out, "          pipe_busy <= '0';\n");
+    out_puts(out, "        end if;\n");
+    out_puts(out, "      end if;\n");
+    output_buffer_free(&lines);
+}
@@ -0,0 +1,124 @@
+// VHDL Code Generator - Loop Pipelining
+// -------------------------------------------------------------
+// Purpose: Modulo-schedule the body of a "#pragma compi pipeline II=N"
+//          loop so a new iteration starts every N cycles while earlier
+//          ones are still in flight (prologue, kernel and epilogue run
+//          under one stage-valid shift register)
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_MODULO_H
+#define CODEGEN_VHDL_MODULO_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "arena.h"
+#include "intern.h"
+
+// Initiation intervals above this are not searched
+#define MODULO_MAX_II 64
+
+// -------------------------------------------------------------
+// Modulo plan
+// -------------------------------------------------------------
+// Operation 0 is the issue of an iteration (the counter update); the body
+// statements follow in program order
+typedef struct {
+    ASTNode *statement;        // NODE_STATEMENT of the body (NULL for the issue)
+    int time;                  // Cycles after the issue of its iteration
+} ModuloOperation;
+
+// time[target] >= time[source] + latency - II * distance
+typedef struct {
+    int source;
+    int target;
+    int latency;
+    int distance;              // 1 when the value comes from the previous iteration
+    const char *name;          // Scalar or array the dependence is on
+} ModuloEdge;
+
+// A read of a value produced in an earlier cycle of its iteration
+typedef struct {
+    ASTNode *parent;
+    int child_index;
+    ASTNode *original;
+    ASTNode *delayed;          // <name>_d<delay>, NULL while it reads the signal itself
+    int edge;                  // Dependence it follows
+} ModuloRead;
+
+// Registers holding a signal's values of the last depth cycles
+typedef struct {
+    InternId name_id;
+    const char *name;
+    const ASTNode *declaration;
+    int depth;
+} ModuloChain;
+
+typedef struct {
+    int requested_ii;          // From the pragma (0 = no pipelined loop asked for)
+    int ii;                    // Achieved initiation interval (0 = not pipelined)
+    int stage_count;           // Latest operation time
+    const char *recurrence;    // Value whose recurrence raised the II, or NULL
+    int recurrence_cycles;
+    ASTNode *loop;             // NODE_FOR_STATEMENT or NODE_WHILE_STATEMENT
+    int loop_index;            // Function child holding the loop
+    const char *variable;      // Counter updated on issue
+    ASTNode *init;             // for-loop initialisation, or NULL
+    ASTNode *condition;
+    ASTNode *increment;        // Counter assignment
+    ASTNode *result;           // Return statement after the loop, or NULL
+    ModuloOperation *operations;
+    int operation_count;
+    ModuloEdge *edges;
+    int edge_count;
+    int edge_capacity;
+    ModuloRead *reads;
+    int read_count;
+    int read_capacity;
+    ModuloChain *chains;
+    int chain_count;
+    int chain_capacity;
+    Arena scratch;             // Delayed read references
+} ModuloPlan;
+
+/**
+ * Plan function when it is a loop-free scalar prelude, one loop marked
+ * "#pragma compi pipeline [II=N]" and at most a return. The loop must
+ * update one counter in its increment (for) or last statement (while),
+ * test only the counter and values the body does not write, and hold
+ * straight-line statements (ifs allowed) that assign each scalar once.
+ * Every statement takes one cycle after the values it reads; the II is
+ * raised from N until every recurrence fits.
+ *
+ * @return 1 if the loop is pipelined (plan still needs modulo_plan_free
+ *         either way; requested_ii tells whether the pragma was given)
+ */
+int modulo_plan_function(ASTNode *function, ModuloPlan *plan);
+
+void modulo_plan_free(ModuloPlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Loop body locals, delay chains and the issue/stage control signals
+void emit_modulo_signals(const ModuloPlan *plan, OutputBuffer *out);
+
+// "-- Pipelined loop" line reporting the achieved II and what limits it
+void emit_modulo_report(const ModuloPlan *plan, OutputBuffer *out);
+
+// Reset branch of the process
+void emit_modulo_reset(const ModuloPlan *plan, OutputBuffer *out);
+
+/**
+ * Clocked branch of the process: the prelude on start, then an iteration
+ * issued every II cycles while the condition holds, each body statement
+ * under the valid bit of its stage, and result/done once the last
+ * iteration has drained. Call after modulo_bind.
+ */
+void emit_modulo_process(ASTNode *function, const ModuloPlan *plan, OutputBuffer *out,
+                         void (*node_generator)(ASTNode*, OutputBuffer*));
+
+// Point reads of earlier cycles at their delay registers (undo with modulo_unbind)
+void modulo_bind(ModuloPlan *plan);
+void modulo_unbind(ModuloPlan *plan);
+
+#endif // CODEGEN_VHDL_MODULO_H
@@ -0,0 +1,630 @@
+// VHDL Code Generator - Pipeline Register Insertion Implementation
+// -------------------------------------------------------------
+// A straight-line function is one dataflow graph: locals are substituted by
+// their initializers, so the returned expression reads only inputs. Every
+// operator gets a height (its depth above the inputs) and the stage
+//     stage = ceil(height * stage_count / root_height)
+// so each stage holds about the same number of operator levels. A value read
+// in a later stage than the one computing it is carried forward through one
+// register per stage, which keeps the throughput at one result per clock.
+// Boolean-valued nodes (comparisons, !) are never registered: VHDL keeps them
+// as boolean, so they are recomputed in the stage that reads them.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_pipeline.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_reset.h"
+#include "symbol_structs.h"
+#include "intern.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+#define PIPELINE_NAME_SIZE 32
+
+// Child pointer replaced while one stage expression is emitted
+typedef struct {
+    ASTNode *parent;
+    int child_index;
+    ASTNode *original;
+} PipelineSwap;
+
+typedef struct {
+    PipelineSwap *swaps;
+    int count;
+    int capacity;
+} PipelineSwapList;
+
+// -------------------------------------------------------------
+// Node -> value index hash
+// -------------------------------------------------------------
+static size_t pipeline_slot_of(const PipelinePlan *plan, const ASTNode *node)
+{
+    uintptr_t key = (uintptr_t)node;
+
+    key ^= key >> 17;
+    key *= (uintptr_t)0x9E3779B97F4A7C15ull;
+    return (size_t)(key >> 7) & (size_t)(plan->slot_count - 1);
+}
+
+static int pipeline_find(const PipelinePlan *plan, const ASTNode *node)
+{
+    size_t slot = 0;
+
+    if (plan->slot_count == 0)
+    {
+        return -1;
+    }
+
+    for (slot = pipeline_slot_of(plan, node); plan->slot_nodes[slot] != NULL;
+         slot = (slot + 1) & (size_t)(plan->slot_count - 1))
+    {
+        if (plan->slot_nodes[slot] == node)
+        {
+            return plan->slot_values[slot];
+        }
+    }
+    return -1;
+}
+
+static void pipeline_insert(PipelinePlan *plan, const ASTNode *node, int value_index)
+{
+    size_t slot = 0;
+
+    // Keep the table at most half full
+    if ((plan->value_count + 1) * 2 > plan->slot_count)
+    {
+        const ASTNode **old_nodes = plan->slot_nodes;
+        int *old_values = plan->slot_values;
+        int old_count = plan->slot_count;
+
+        plan->slot_count = (old_count > 0) ? old_count * 2 : 64;
+        plan->slot_nodes = (const ASTNode**)calloc((size_t)plan->slot_count, sizeof(ASTNode*));
+        plan->slot_values = (int*)calloc((size_t)plan->slot_count, sizeof(int));
+        if (plan->slot_nodes == NULL || plan->slot_values == NULL)
+        {
+            perror("Failed to allocate memory for pipeline plan");
+            exit(EXIT_FAILURE);
+        }
+
+        for (int old_slot = 0; old_slot < old_count; ++old_slot)
+        {
+            if (old_nodes[old_slot] != NULL)
+            {
+                pipeline_insert(plan, old_nodes[old_slot], old_values[old_slot]);
+            }
+        }
+        free(old_nodes);
+        free(old_values);
+    }
+
+    slot = pipeline_slot_of(plan, node);
+    while (plan->slot_nodes[slot] != NULL)
+    {
+        slot = (slot + 1) & (size_t)(plan->slot_count - 1);
+    }
+    plan->slot_nodes[slot] = node;
+    plan->slot_values[slot] = value_index;
+}
+
+static int pipeline_add_value(PipelinePlan *plan, ASTNode *node, int height)
+{
+    PipelineValue *value = NULL;
+
+    if (plan->value_count >= plan->value_capacity)
+    {
+        plan->value_capacity = (plan->value_capacity > 0) ? plan->value_capacity * 2 : 32;
+        plan->values = (PipelineValue*)xrealloc(plan->values,
+            (size_t)plan->value_capacity * sizeof(PipelineValue));
+    }
+
+    value = &plan->values[plan->value_count];
+    memset(value, 0, sizeof(*value));
+    value->node = node;
+    value->id = plan->value_count;
+    value->height = height;
+    return plan->value_count++;
+}
+
+// -------------------------------------------------------------
+// Helper: identifier leaf (not a literal)
+// -------------------------------------------------------------
+static int is_identifier_leaf(const ASTNode *node)
+{
+    return node->type == NODE_EXPRESSION && node->value != NULL &&
+           (isalpha((unsigned char)node->value[0]) || node->value[0] == '_');
+}
+
+// -------------------------------------------------------------
+// Helper: follow locals to the expression that defines them
+// -------------------------------------------------------------
+static ASTNode* pipeline_resolve(const PipelinePlan *plan, ASTNode *node)
+{
+    int local_index = 0;
+
+    while (is_identifier_leaf(node) &&
+           symbol_lookup(&plan->locals, intern_cstr(node->value), &local_index))
+    {
+        node = plan->local_initializers[local_index];
+    }
+    return node;
+}
+
+// -------------------------------------------------------------
+// Helper: value index of an input identifier (created on first read)
+// -------------------------------------------------------------
+static int pipeline_input(PipelinePlan *plan, ASTNode *identifier)
+{
+    InternId name = intern_cstr(identifier->value);
+    int value_index = 0;
+
+    if (!symbol_lookup(&plan->inputs, name, &value_index))
+    {
+        value_index = pipeline_add_value(plan, identifier, 0);
+        symbol_define(&plan->inputs, name, value_index);
+    }
+    return value_index;
+}
+
+// -------------------------------------------------------------
+// Eligibility: expressions the planner can retime
+// -------------------------------------------------------------
+static int pipeline_expression_supported(PipelinePlan *plan, ASTNode *node)
+{
+    int local_index = 0;
+
+    switch (node->type)
+    {
+        case NODE_EXPRESSION:
+            if (node->value == NULL || node->num_children > 0)
+            {
+                return 0;
+            }
+            if (is_identifier_leaf(node) &&
+                !symbol_lookup(&plan->locals, intern_cstr(node->value), &local_index))
+            {
+                pipeline_input(plan, node);
+            }
+            return 1;
+
+        case NODE_BINARY_EXPR:
+        case NODE_UNARY_EXPR:
+        case NODE_FUNC_CALL:
+            for (int child_index = 0; child_index < node->num_children; ++child_index)
+            {
+                if (!pipeline_expression_supported(plan, node->children[child_index]))
+                {
+                    return 0;
+                }
+            }
+            return node->value != NULL;
+
+        default:
+            // Arrays and struct fields need memories, not registers
+            return 0;
+    }
+}
+
+static int pipeline_declaration_supported(PipelinePlan *plan, ASTNode *declaration)
+{
+    InternId name = INTERN_NONE;
+
+    if (declaration->value == NULL || declaration->token.id != INTERN_KW_INT ||
+        declaration->array_size > 0 || declaration->num_children != 1)
+    {
+        return 0;
+    }
+
+    name = intern_cstr(declaration->value);
+    // Each name must mean one value for the whole function
+    if (symbol_lookup(&plan->locals, name, NULL) || symbol_lookup(&plan->inputs, name, NULL) ||
+        !pipeline_expression_supported(plan, declaration->children[FIRST_CHILD_INDEX]))
+    {
+        return 0;
+    }
+
+    if (plan->local_count >= plan->local_capacity)
+    {
+        plan->local_capacity = (plan->local_capacity > 0) ? plan->local_capacity * 2 : 16;
+        plan->local_initializers = (ASTNode**)xrealloc(plan->local_initializers,
+            (size_t)plan->local_capacity * sizeof(ASTNode*));
+    }
+    plan->local_initializers[plan->local_count] = declaration->children[FIRST_CHILD_INDEX];
+    symbol_define(&plan->locals, name, plan->local_count++);
+    return 1;
+}
+
+static int pipeline_function_supported(PipelinePlan *plan, ASTNode *function)
+{
+    if (function->token.id != INTERN_KW_INT)
+    {
+        return 0;
+    }
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+        ASTNode *construct = NULL;
+
+        if (child->type == NODE_VAR_DECL)
+        {
+            if (child->token.id != INTERN_KW_INT || child->array_size > 0)
+            {
+                return 0;
+            }
+            continue;
+        }
+
+        // Nothing may follow the return
+        if (child->type != NODE_STATEMENT || plan->root != NULL)
+        {
+            return 0;
+        }
+
+        if (child->token.id == INTERN_KW_RETURN)
+        {
+            if (child->num_children != 1 ||
+                !pipeline_expression_supported(plan, child->children[FIRST_CHILD_INDEX]))
+            {
+                return 0;
+            }
+            plan->root = child->children[FIRST_CHILD_INDEX];
+            continue;
+        }
+
+        construct = unwrap_statement_node(child);
+        if (child->num_children != 1 || construct->type != NODE_VAR_DECL ||
+            !pipeline_declaration_supported(plan, construct))
+        {
+            return 0;
+        }
+    }
+
+    return plan->root != NULL;
+}
+
+// -------------------------------------------------------------
+// Planning passes
+// -------------------------------------------------------------
+// Height of every value below node; returns the height of node
+static int pipeline_measure(PipelinePlan *plan, ASTNode *node)
+{
+    int height = 0;
+    int value_index = 0;
+
+    node = pipeline_resolve(plan, node);
+    if (node->type == NODE_EXPRESSION)
+    {
+        return 0;
+    }
+
+    value_index = pipeline_find(plan, node);
+    if (value_index >= 0)
+    {
+        return plan->values[value_index].height;
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        int child_height = pipeline_measure(plan, node->children[child_index]);
+        if (child_height > height)
+        {
+            height = child_height;
+        }
+    }
+
+    value_index = pipeline_add_value(plan, node, height + 1);
+    pipeline_insert(plan, node, value_index);
+    return height + 1;
+}
+
+// Helper: node is emitted inside its reader's stage instead of registered
+static int pipeline_inlined(const PipelineValue *value, int reader_stage)
+{
+    return value->stage == reader_stage || is_node_boolean_expression(value->node);
+}
+
+// Record in which stages the operands of node (computed in stage) are read
+static void pipeline_schedule(PipelinePlan *plan, ASTNode *node, int stage)
+{
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        ASTNode *operand = pipeline_resolve(plan, node->children[child_index]);
+        PipelineValue *value = NULL;
+
+        if (operand->type == NODE_EXPRESSION)
+        {
+            if (is_identifier_leaf(operand))
+            {
+                value = &plan->values[pipeline_input(plan, operand)];
+                if (value->last_use < stage)
+                {
+                    value->last_use = stage;
+                }
+            }
+            continue;
+        }
+
+        value = &plan->values[pipeline_find(plan, operand)];
+        if (pipeline_inlined(value, stage))
+        {
+            pipeline_schedule(plan, operand, stage);
+            continue;
+        }
+
+        if (value->last_use < stage)
+        {
+            value->last_use = stage;
+        }
+        if (!value->produced)
+        {
+            value->produced = 1;
+            pipeline_schedule(plan, operand, value->stage);
+        }
+    }
+}
+
+int pipeline_plan_function(ASTNode *function, int requested_stages, PipelinePlan *plan)
+{
+    int root_height = 0;
+
+    memset(plan, 0, sizeof(*plan));
+    symbol_table_init(&plan->locals);
+    symbol_table_init(&plan->inputs);
+    arena_init(&plan->scratch, 0);
+    plan->function = function;
+
+    if (!pipeline_function_supported(plan, function))
+    {
+        plan->root = NULL;
+        return 0;
+    }
+
+    plan->root = pipeline_resolve(plan, plan->root);
+    root_height = pipeline_measure(plan, plan->root);
+    plan->stage_count = (root_height < requested_stages) ? root_height : requested_stages;
+    if (plan->stage_count < 1)
+    {
+        plan->stage_count = 1;
+    }
+
+    for (int value_index = 0; value_index < plan->value_count; ++value_index)
+    {
+        PipelineValue *value = &plan->values[value_index];
+        if (value->height > 0)
+        {
+            value->stage = (value->height * plan->stage_count + root_height - 1) / root_height;
+        }
+    }
+
+    if (plan->root->type != NODE_EXPRESSION)
+    {
+        pipeline_schedule(plan, plan->root, plan->stage_count);
+    }
+    else if (is_identifier_leaf(plan->root))
+    {
+        plan->values[pipeline_input(plan, plan->root)].last_use = plan->stage_count;
+    }
+    return 1;
+}
+
+void pipeline_plan_free(PipelinePlan *plan)
+{
+    free(plan->values);
+    free(plan->slot_nodes);
+    free(plan->slot_values);
+    free(plan->local_initializers);
+    symbol_table_free(&plan->locals);
+    symbol_table_free(&plan->inputs);
+    arena_release(&plan->scratch);
+    memset(plan, 0, sizeof(*plan));
+}
+
+// -------------------------------------------------------------
+// Helper: first stage whose register holds the value
+// -------------------------------------------------------------
+static int pipeline_first_register(const PipelineValue *value)
+{
+    return (value->stage > 0) ? value->stage : 1;
+}
+
+// -------------------------------------------------------------
+// Stage register declarations
+// -------------------------------------------------------------
+void emit_pipeline_signals(const PipelinePlan *plan, OutputBuffer *out)
+{
+    for (int value_index = 0; value_index < plan->value_count; ++value_index)
+    {
+        const PipelineValue *value = &plan->values[value_index];
+
+        for (int stage = pipeline_first_register(value); stage < value->last_use; ++stage)
+        {
+            out_printf(out, "  signal pipe%d_%d : std_logic_vector(%d downto 0);\n",
+                       stage, value->id, VHDL_BIT_WIDTH - 1);
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: replace one operand by a reference to a register
+// -------------------------------------------------------------
+static void pipeline_swap(PipelineSwapList *list, ASTNode *parent, int child_index, ASTNode *replacement)
+{
+    if (list->count >= list->capacity)
+    {
+        list->capacity = (list->capacity > 0) ? list->capacity * 2 : 16;
+        list->swaps = (PipelineSwap*)xrealloc(list->swaps,
+            (size_t)list->capacity * sizeof(PipelineSwap));
+    }
+
+    list->swaps[list->count].parent = parent;
+    list->swaps[list->count].child_index = child_index;
+    list->swaps[list->count].original = parent->children[child_index];
+    list->count++;
+    parent->children[child_index] = replacement;
+}
+
+static ASTNode* pipeline_register_reference(PipelinePlan *plan, int stage, int value_id)
+{
+    char name[PIPELINE_NAME_SIZE];
+    Arena *previous = ast_use_arena(&plan->scratch);
+    ASTNode *reference = create_node(NODE_EXPRESSION);
+
+    snprintf(name, sizeof(name), "pipe%d_%d", stage, value_id);
+    set_node_value(reference, name);
+    ast_use_arena(previous);
+    return reference;
+}
+
+// Point every operand of node (computed in stage) at what that stage sees:
+// an input port, a register of an earlier stage, or an inlined subtree
+static void pipeline_bind_operands(PipelinePlan *plan, ASTNode *node, int stage, PipelineSwapList *list)
+{
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        ASTNode *operand = node->children[child_index];
+        ASTNode *resolved = pipeline_resolve(plan, operand);
+        const PipelineValue *value = NULL;
+        int value_index = 0;
+
+        if (resolved->type == NODE_EXPRESSION)
+        {
+            if (is_identifier_leaf(resolved) && stage > 1)
+            {
+                value_index = pipeline_input(plan, resolved);
+                pipeline_swap(list, node, child_index,
+                              pipeline_register_reference(plan, stage - 1, plan->values[value_index].id));
+            }
+            else if (resolved != operand)
+            {
+                pipeline_swap(list, node, child_index, resolved);
+            }
+            continue;
+        }
+
+        value_index = pipeline_find(plan, resolved);
+        if (value_index < 0)
+        {
+            // Already a register reference from an enclosing binding
+            continue;
+        }
+
+        value = &plan->values[value_index];
+        if (pipeline_inlined(value, stage))
+        {
+            if (resolved != operand)
+            {
+                pipeline_swap(list, node, child_index, resolved);
+            }
+            pipeline_bind_operands(plan, resolved, stage, list);
+        }
+        else
+        {
+            pipeline_swap(list, node, child_index,
+                          pipeline_register_reference(plan, stage - 1, value->id));
+        }
+    }
+}
+
+static void emit_stage_expression(PipelinePlan *plan, ASTNode *node, int stage,
+                                  OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    PipelineSwapList list = { NULL, 0, 0 };
+
+    if (node->type == NODE_EXPRESSION)
+    {
+        if (is_identifier_leaf(node) && stage > 1)
+        {
+            out_printf(out, "pipe%d_%d", stage - 1, plan->values[pipeline_input(plan, node)].id);
+        }
+        else
+        {
+            node_generator(node, out);
+        }
+        return;
+    }
+
+    pipeline_bind_operands(plan, node, stage, &list);
+    node_generator(node, out);
+
+    // Undo in reverse, so operands swapped twice end up original again
+    for (int swap_index = list.count - 1; swap_index >= 0; --swap_index)
+    {
+        PipelineSwap *swap = &list.swaps[swap_index];
+        swap->parent->children[swap->child_index] = swap->original;
+    }
+    free(list.swaps);
+}
+
+// -------------------------------------------------------------
+// Clocked process body
+// -------------------------------------------------------------
+void emit_pipeline_stages(PipelinePlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    for (int stage = 1; stage <= plan->stage_count; ++stage)
+    {
+        out_printf(out, "%s-- Stage %d\n", INDENT_LEVEL_3, stage);
+
+        for (int value_index = 0; value_index < plan->value_count; ++value_index)
+        {
+            PipelineValue *value = &plan->values[value_index];
+
+            if (stage >= value->last_use || stage < pipeline_first_register(value))
+            {
+                continue;
+            }
+
+            out_printf(out, "%spipe%d_%d <= ", INDENT_LEVEL_3, stage, value->id);
+            if (stage > pipeline_first_register(value))
+            {
+                out_printf(out, "pipe%d_%d", stage - 1, value->id);
+            }
+            else if (value->stage == 0)
+            {
+                emit_mapped_signal_name(value->node->value, out);
+            }
+            else
+            {
+                emit_stage_expression(plan, value->node, stage, out, node_generator);
+            }
+            out_puts(out, ";\n");
+        }
+    }
+
+    out_printf(out, "%sresult <= ", INDENT_LEVEL_3);
+    emit_stage_expression(plan, plan->root, plan->stage_count, out, node_generator);
+    out_puts(out, ";\n");
+}
+
+// -------------------------------------------------------------
+// Valid handshake
+// -------------------------------------------------------------
+void emit_valid_signal(int stage_count, OutputBuffer *out)
+{
+    out_printf(out, "  signal valid_pipe : std_logic_vector(1 to %d)", stage_count);
+    emit_power_up_value("(others => '0')", out);
+    out_puts(out, ";\n");
+}
+
+void emit_valid_reset(OutputBuffer *out)
+{
+    out_puts(out, "      valid_pipe <= (others => '0');\n");
+}
+
+void emit_valid_shift(int stage_count, OutputBuffer *out)
+{
+    out_puts(out, "      valid_pipe(1) <= valid_in;\n");
+    for (int stage = 2; stage <= stage_count; ++stage)
+    {
+        out_printf(out, "      valid_pipe(%d) <= valid_pipe(%d);\n", stage, stage - 1);
+    }
+}
+
+void emit_valid_output(int stage_count, OutputBuffer *out)
+{
+    out_printf(out, "  valid_out <= valid_pipe(%d);\n", stage_count);
+}
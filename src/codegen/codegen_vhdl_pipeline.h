@@ -0,0 +1,75 @@
+// VHDL Code Generator - Pipeline Register Insertion
+// -------------------------------------------------------------
+// Purpose: Retime the dataflow of straight-line functions into register
+//          stages behind a valid_in/valid_out handshake
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_PIPELINE_H
+#define CODEGEN_VHDL_PIPELINE_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "arena.h"
+#include "symbol_table.h"
+
+// -------------------------------------------------------------
+// Pipeline plan
+// -------------------------------------------------------------
+// One value of the dataflow: an operator node or a function input
+typedef struct {
+    ASTNode *node;             // Operator node, or the first identifier naming an input
+    int id;                    // Registers are named pipe<stage>_<id>
+    int height;                // Operator levels up to and including this node (0 = input)
+    int stage;                 // Stage computing the value (0 = input port)
+    int last_use;              // Latest stage reading the value
+    int produced;              // Computation already scheduled
+} PipelineValue;
+
+typedef struct {
+    ASTNode *function;
+    ASTNode *root;             // Returned expression
+    int stage_count;           // Register stages = latency in clock cycles
+    PipelineValue *values;
+    int value_count;
+    int value_capacity;
+    const ASTNode **slot_nodes; // Node -> value index hash (NULL = empty)
+    int *slot_values;
+    int slot_count;
+    SymbolTable locals;        // Local name -> index into local_initializers
+    ASTNode **local_initializers;
+    int local_count;
+    int local_capacity;
+    SymbolTable inputs;        // Input name -> value index
+    Arena scratch;             // Register reference nodes used while emitting
+} PipelinePlan;
+
+/**
+ * Plan the stages of one function. Only straight-line int functions qualify:
+ * scalar int locals initialised once, then a single return.
+ *
+ * @param requested_stages Maximum number of register stages (>= 1)
+ * @return 1 if the function was planned, 0 if it must be generated as is
+ *         (plan is then empty but still needs pipeline_plan_free)
+ */
+int pipeline_plan_function(ASTNode *function, int requested_stages, PipelinePlan *plan);
+
+void pipeline_plan_free(PipelinePlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Architecture declarations of the stage registers
+void emit_pipeline_signals(const PipelinePlan *plan, OutputBuffer *out);
+
+// Clocked process body: each stage's registers, result in the last stage
+void emit_pipeline_stages(PipelinePlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+// -------------------------------------------------------------
+// Valid handshake (valid_out follows valid_in by stage_count cycles)
+// -------------------------------------------------------------
+void emit_valid_signal(int stage_count, OutputBuffer *out);
+void emit_valid_reset(OutputBuffer *out);
+void emit_valid_shift(int stage_count, OutputBuffer *out);
+void emit_valid_output(int stage_count, OutputBuffer *out);
+
+#endif // CODEGEN_VHDL_PIPELINE_H
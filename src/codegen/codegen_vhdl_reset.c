@@ -0,0 +1,206 @@
+// VHDL Code Generator - Process Reset Implementation
+// -------------------------------------------------------------
+// A register that a reset assigns is also gated by the reset everywhere
+// else it is written, which keeps it out of the registers of DSP and RAM
+// primitives and adds a control set. Only control-path registers need a
+// known value after reset: handshake flags and states (reset by the module
+// that owns them) and the locals that decide where control goes. Data
+// registers are recomputed before they are read, so they are left alone.
+//
+// --reset=async keeps the reset as the first branch of the process.
+// --reset=sync tests it after the body, inside the clock edge, so the last
+// assignment wins and nothing else depends on it. --reset=none drops it;
+// control registers then start from the value on their declaration. The
+// reset port stays in every style so instances and testbenches connect the
+// same way.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_reset.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_statements.h"
+#include "codegen_vhdl.h"
+#include "symbol_structs.h"
+#include "symbol_table.h"
+#include "intern.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -------------------------------------------------------------
+// Helper: names of the identifiers read by a condition
+// -------------------------------------------------------------
+static void collect_condition_names(const ASTNode *node, SymbolTable *names)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+    if (node->type == NODE_EXPRESSION && node->token.type == TOKEN_IDENTIFIER && node->value != NULL)
+    {
+        symbol_define(names, intern_cstr(node->value), 1);
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        collect_condition_names(node->children[child_index], names);
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: every condition of the tree (if, else if, while, for)
+// -------------------------------------------------------------
+static void collect_control_names(const ASTNode *node, SymbolTable *names)
+{
+    int condition_index = -1;
+
+    if (node == NULL)
+    {
+        return;
+    }
+    if ((node->type == NODE_IF_STATEMENT || node->type == NODE_ELSE_IF_STATEMENT ||
+         node->type == NODE_WHILE_STATEMENT) && node->num_children > 0)
+    {
+        condition_index = 0;
+    }
+    else if (node->type == NODE_FOR_STATEMENT && node->num_children > 0)
+    {
+        // The initialisation, when present, comes first (see generate_for_loop)
+        const ASTNode *first = node->children[0];
+
+        condition_index = (first->type == NODE_ASSIGNMENT || first->type == NODE_VAR_DECL) ? 1 : 0;
+    }
+    if (condition_index >= 0 && condition_index < node->num_children)
+    {
+        collect_condition_names(node->children[condition_index], names);
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        collect_control_names(node->children[child_index], names);
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: a number, or a negated one
+// -------------------------------------------------------------
+static int is_constant_initializer(const ASTNode *node)
+{
+    if (node->type == NODE_UNARY_EXPR && node->value != NULL && strcmp(node->value, "-") == 0 &&
+        node->num_children == 1)
+    {
+        node = node->children[0];
+    }
+    return node->type == NODE_EXPRESSION && node->token.type == TOKEN_NUMBER && node->num_children == 0;
+}
+
+int reset_plan_function(ASTNode *function, ResetPlan *plan)
+{
+    SymbolTable control;
+
+    memset(plan, 0, sizeof(*plan));
+    symbol_table_init(&control);
+    collect_control_names(function, &control);
+
+    // Locals are the declarations of the body blocks (as in
+    // emit_function_local_signals)
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *block = function->children[child_index];
+
+        if (block->type != NODE_STATEMENT)
+        {
+            continue;
+        }
+        for (int statement_index = 0; statement_index < block->num_children; ++statement_index)
+        {
+            ASTNode *declaration = block->children[statement_index];
+
+            if (declaration->type != NODE_VAR_DECL || declaration->value == NULL ||
+                declaration->array_size > 0 || declaration->num_children == 0 ||
+                find_struct_index_id(declaration->token.id) >= 0 ||
+                !is_constant_initializer(declaration->children[0]) ||
+                !symbol_lookup(&control, intern_cstr(declaration->value), NULL))
+            {
+                continue;
+            }
+            if (plan->register_count == plan->register_capacity)
+            {
+                plan->register_capacity = (plan->register_capacity > 0) ? plan->register_capacity * 2 : 4;
+                plan->registers = (ASTNode**)xrealloc(plan->registers,
+                                                      (size_t)plan->register_capacity * sizeof(ASTNode*));
+            }
+            plan->registers[plan->register_count++] = declaration;
+        }
+    }
+
+    symbol_table_free(&control);
+    return plan->register_count;
+}
+
+void reset_plan_free(ResetPlan *plan)
+{
+    free(plan->registers);
+    memset(plan, 0, sizeof(*plan));
+}
+
+void emit_reset_registers(const ResetPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    for (int register_index = 0; register_index < plan->register_count; ++register_index)
+    {
+        emit_variable_initializer(plan->registers[register_index], out, INDENT_LEVEL_3, node_generator);
+    }
+}
+
+// -------------------------------------------------------------
+// Process framing
+// -------------------------------------------------------------
+void emit_process_begin(const OutputBuffer *resets, OutputBuffer *out)
+{
+    ResetStyle style = codegen_current_options()->reset;
+
+    if (style == RESET_ASYNC && resets->length > 0)
+    {
+        out_puts(out, "  process(clk, reset)\n");
+        out_puts(out, "  begin\n");
+        out_puts(out, "    if reset = '1' then\n");
+        out_write(out, resets->data, resets->length);
+        out_puts(out, "    elsif rising_edge(clk) then\n");
+        return;
+    }
+    out_puts(out, "  process(clk)\n");
+    out_puts(out, "  begin\n");
+    out_puts(out, "    if rising_edge(clk) then\n");
+}
+
+void emit_process_end(const OutputBuffer *resets, OutputBuffer *out)
+{
+    size_t position = 0;
+
+    if (codegen_current_options()->reset == RESET_SYNC && resets->length > 0)
+    {
+        out_puts(out, "      if reset = '1' then\n");
+        // One level deeper than the reset lines were written
+        while (position < resets->length)
+        {
+            const char *line = resets->data + position;
+            const char *end = memchr(line, '\n', resets->length - position);
+            size_t length = (end != NULL) ? (size_t)(end - line) + 1 : resets->length - position;
+
+            out_puts(out, "  ");
+            out_write(out, line, length);
+            position += length;
+        }
+        out_puts(out, "      end if;\n");
+    }
+    out_puts(out, "    end if;\n");
+    out_puts(out, "  end process;\n");
+}
+
+void emit_power_up_value(const char *value, OutputBuffer *out)
+{
+    if (codegen_current_options()->reset == RESET_NONE)
+    {
+        out_puts(out, " := ");
+        out_puts(out, value);
+    }
+}
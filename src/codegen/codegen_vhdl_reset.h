@@ -0,0 +1,42 @@
+// VHDL Code Generator - Process Reset
+// -------------------------------------------------------------
+// Purpose: Frame the clocked process for the selected reset style and
+//          reset only the control-path registers, so datapath registers
+//          stay free of reset logic and pack into DSP and RAM primitives
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_RESET_H
+#define CODEGEN_VHDL_RESET_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+
+typedef struct {
+    ASTNode **registers;       // Control locals (NODE_VAR_DECL) reset to their initializer
+    int register_count;
+    int register_capacity;
+} ResetPlan;
+
+/**
+ * Find the control-path locals of function: scalar locals declared with a
+ * constant initializer whose value some if/while/for condition reads.
+ * Locals that only carry data are left out.
+ *
+ * @return Number of registers found
+ */
+int reset_plan_function(ASTNode *function, ResetPlan *plan);
+void reset_plan_free(ResetPlan *plan);
+
+// Assignments of the planned registers' initial values, as reset lines
+void emit_reset_registers(const ResetPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+// Opening and closing of the clocked process for the current reset style;
+// resets holds its reset lines (empty = nothing to reset, no reset logic)
+void emit_process_begin(const OutputBuffer *resets, OutputBuffer *out);
+void emit_process_end(const OutputBuffer *resets, OutputBuffer *out);
+
+// " := value" on a control register's declaration with --reset=none,
+// which leaves its power-up value as the only initialisation
+void emit_power_up_value(const char *value, OutputBuffer *out);
+
+#endif // CODEGEN_VHDL_RESET_H
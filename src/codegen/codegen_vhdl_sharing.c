@@ -0,0 +1,575 @@
+// VHDL Code Generator - Resource Sharing Implementation
+// -------------------------------------------------------------
+// Every arithmetic operator of a clocked process infers its own functional
+// unit, even when the operators sit in different arms of one if chain and
+// can never be used in the same cycle. Those operations are bound to one
+// unit: each unit operand becomes a concurrent multiplexer selected by the
+// arm conditions, and the operator itself is instantiated once.
+//
+// The concurrent statements read the same signals the process reads at the
+// clock edge (signal assignments in the process only take effect after it),
+// so the multiplexed result equals the expression it replaces. Loop bodies
+// are left alone, and operations whose operands call a function are never
+// bound. Units only mix operations of equal nesting level, so a unit operand
+// can read a lower-level unit but never form a combinational loop.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_sharing.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_expressions.h"
+#include "codegen_vhdl_strength.h"
+#include "symbol_structs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define SHARING_NAME_SIZE 32
+
+// -------------------------------------------------------------
+// Helper: signal prefix of a unit
+// -------------------------------------------------------------
+static const char* sharing_kind(InternId operator_id)
+{
+    switch (operator_id)
+    {
+        case INTERN_OP_MULTIPLY: return "mul";
+        case INTERN_OP_DIVIDE:   return "div";
+        case INTERN_OP_MODULO:   return "mod";
+        case INTERN_OP_PLUS:     return "add";
+        default:                 return "sub";
+    }
+}
+
+static int is_shareable_operator(InternId operator_id, int share_adders)
+{
+    switch (operator_id)
+    {
+        case INTERN_OP_MULTIPLY:
+        case INTERN_OP_DIVIDE:
+        case INTERN_OP_MODULO:
+            return 1;
+        case INTERN_OP_PLUS:
+        case INTERN_OP_MINUS:
+            return share_adders;
+        default:
+            return 0;
+    }
+}
+
+// -------------------------------------------------------------
+// Collection
+// -------------------------------------------------------------
+static void sharing_push_arm(SharingPlan *plan, ASTNode *if_node, int arm_index)
+{
+    if (plan->path_depth >= plan->path_capacity)
+    {
+        plan->path_capacity = (plan->path_capacity > 0) ? plan->path_capacity * 2 : 8;
+        plan->path = (SharingChoice*)xrealloc(plan->path,
+            (size_t)plan->path_capacity * sizeof(SharingChoice));
+    }
+    plan->path[plan->path_depth].if_node = if_node;
+    plan->path[plan->path_depth].arm_index = arm_index;
+    plan->path_depth++;
+}
+
+static void sharing_add_operation(SharingPlan *plan, ASTNode *parent, int child_index, int level)
+{
+    SharedOperation *operation = NULL;
+
+    if (plan->operation_count >= plan->operation_capacity)
+    {
+        plan->operation_capacity = (plan->operation_capacity > 0) ? plan->operation_capacity * 2 : 16;
+        plan->operations = (SharedOperation*)xrealloc(plan->operations,
+            (size_t)plan->operation_capacity * sizeof(SharedOperation));
+    }
+    while (plan->choice_count + plan->path_depth > plan->choice_capacity)
+    {
+        plan->choice_capacity = (plan->choice_capacity > 0) ? plan->choice_capacity * 2 : 32;
+        plan->choices = (SharingChoice*)xrealloc(plan->choices,
+            (size_t)plan->choice_capacity * sizeof(SharingChoice));
+    }
+
+    operation = &plan->operations[plan->operation_count++];
+    operation->node = parent->children[child_index];
+    operation->parent = parent;
+    operation->child_index = child_index;
+    operation->level = level;
+    operation->first_choice = plan->choice_count;
+    operation->choice_count = plan->path_depth;
+    operation->unit = -1;
+    operation->next_in_unit = -1;
+
+    memcpy(&plan->choices[plan->choice_count], plan->path,
+           (size_t)plan->path_depth * sizeof(SharingChoice));
+    plan->choice_count += plan->path_depth;
+}
+
+// Collect the operations of parent->children[child_index]. Returns the
+// deepest candidate level in the subtree; *calls is set when it calls a function.
+static int sharing_collect_expression(SharingPlan *plan, ASTNode *parent, int child_index,
+                                      int share_adders, int *calls)
+{
+    ASTNode *node = parent->children[child_index];
+    int level = 0;
+    int operand_calls = 0;
+    InternId operator_id = INTERN_NONE;
+
+    if (node == NULL)
+    {
+        return 0;
+    }
+    if (node->type == NODE_FUNC_CALL)
+    {
+        *calls = 1;
+        return 0;
+    }
+
+    for (int operand_index = 0; operand_index < node->num_children; ++operand_index)
+    {
+        int operand_level = sharing_collect_expression(plan, node, operand_index, share_adders, &operand_calls);
+        if (operand_level > level)
+        {
+            level = operand_level;
+        }
+    }
+    if (operand_calls)
+    {
+        *calls = 1;
+        return level;
+    }
+
+    if (node->type != NODE_BINARY_EXPR || node->value == NULL || node->num_children != 2)
+    {
+        return level;
+    }
+
+    operator_id = node->token.id;
+    // Strength-reduced operations leave no unit worth sharing
+    if (!is_shareable_operator(operator_id, share_adders) || strength_reducible(node))
+    {
+        return level;
+    }
+
+    // Operations outside every if arm can never be exclusive with another
+    if (plan->path_depth > 0)
+    {
+        sharing_add_operation(plan, parent, child_index, level + 1);
+    }
+    return level + 1;
+}
+
+static void sharing_collect_statement(SharingPlan *plan, ASTNode *statement, int share_adders);
+
+static void sharing_collect_arm(SharingPlan *plan, ASTNode *if_node, ASTNode *arm, int arm_index,
+                                int first_statement, int share_adders)
+{
+    sharing_push_arm(plan, if_node, arm_index);
+    for (int statement_index = first_statement; statement_index < arm->num_children; ++statement_index)
+    {
+        ASTNode *child = arm->children[statement_index];
+        if (child->type == NODE_STATEMENT)
+        {
+            sharing_collect_statement(plan, child, share_adders);
+        }
+    }
+    plan->path_depth--;
+}
+
+static void sharing_collect_if(SharingPlan *plan, ASTNode *if_node, int share_adders)
+{
+    // Then arm: the statements directly under the if
+    sharing_push_arm(plan, if_node, 0);
+    for (int child_index = FIRST_STATEMENT_INDEX; child_index < if_node->num_children; ++child_index)
+    {
+        ASTNode *child = if_node->children[child_index];
+        if (child->type == NODE_STATEMENT)
+        {
+            sharing_collect_statement(plan, child, share_adders);
+        }
+    }
+    plan->path_depth--;
+
+    for (int child_index = FIRST_STATEMENT_INDEX; child_index < if_node->num_children; ++child_index)
+    {
+        ASTNode *child = if_node->children[child_index];
+        if (child->type == NODE_ELSE_IF_STATEMENT)
+        {
+            sharing_collect_arm(plan, if_node, child, child_index, FIRST_STATEMENT_INDEX, share_adders);
+        }
+        else if (child->type == NODE_ELSE_STATEMENT)
+        {
+            sharing_collect_arm(plan, if_node, child, child_index, 0, share_adders);
+        }
+    }
+}
+
+static void sharing_collect_statement(SharingPlan *plan, ASTNode *statement, int share_adders)
+{
+    int calls = 0;
+
+    for (int child_index = 0; child_index < statement->num_children; ++child_index)
+    {
+        ASTNode *child = statement->children[child_index];
+
+        switch (child->type)
+        {
+            case NODE_VAR_DECL:
+                // Scalar initializers only; arrays and structs are emitted per element
+                if (child->num_children > 0 && child->array_size == 0 &&
+                    find_struct_index_id(child->token.id) < 0)
+                {
+                    sharing_collect_expression(plan, child, FIRST_CHILD_INDEX, share_adders, &calls);
+                }
+                break;
+
+            case NODE_ASSIGNMENT:
+                if (child->num_children == 2)
+                {
+                    sharing_collect_expression(plan, child, FIRST_CHILD_INDEX + 1, share_adders, &calls);
+                }
+                break;
+
+            case NODE_IF_STATEMENT:
+                sharing_collect_if(plan, child, share_adders);
+                break;
+
+            case NODE_BINARY_EXPR:
+            case NODE_UNARY_EXPR:
+                // Returned expression
+                sharing_collect_expression(plan, statement, child_index, share_adders, &calls);
+                break;
+
+            default:
+                // Loops, break/continue and plain returns bind nothing
+                break;
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// Binding
+// -------------------------------------------------------------
+// Two operations are exclusive when their paths first differ in the arm
+// taken through the same if chain
+static int sharing_exclusive(const SharingPlan *plan, const SharedOperation *first, const SharedOperation *second)
+{
+    int depth = (first->choice_count < second->choice_count) ? first->choice_count : second->choice_count;
+
+    for (int choice_index = 0; choice_index < depth; ++choice_index)
+    {
+        const SharingChoice *a = &plan->choices[first->first_choice + choice_index];
+        const SharingChoice *b = &plan->choices[second->first_choice + choice_index];
+
+        if (a->if_node != b->if_node)
+        {
+            return 0;
+        }
+        if (a->arm_index != b->arm_index)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int sharing_fits(const SharingPlan *plan, const SharedUnit *unit, const SharedOperation *operation)
+{
+    for (int member = unit->first_operation; member >= 0; member = plan->operations[member].next_in_unit)
+    {
+        if (!sharing_exclusive(plan, &plan->operations[member], operation))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int sharing_new_unit(SharingPlan *plan, InternId operator_id, int level)
+{
+    SharedUnit *unit = NULL;
+
+    if (plan->unit_count >= plan->unit_capacity)
+    {
+        plan->unit_capacity = (plan->unit_capacity > 0) ? plan->unit_capacity * 2 : 8;
+        plan->units = (SharedUnit*)xrealloc(plan->units,
+            (size_t)plan->unit_capacity * sizeof(SharedUnit));
+    }
+
+    unit = &plan->units[plan->unit_count];
+    memset(unit, 0, sizeof(*unit));
+    unit->operator_id = operator_id;
+    unit->level = level;
+    unit->first_operation = -1;
+    unit->last_operation = -1;
+    unit->id = -1;
+    return plan->unit_count++;
+}
+
+static void sharing_join(SharingPlan *plan, int unit_index, int operation_index)
+{
+    SharedUnit *unit = &plan->units[unit_index];
+
+    if (unit->last_operation >= 0)
+    {
+        plan->operations[unit->last_operation].next_in_unit = operation_index;
+    }
+    else
+    {
+        unit->first_operation = operation_index;
+    }
+    unit->last_operation = operation_index;
+    unit->operation_count++;
+    plan->operations[operation_index].unit = unit_index;
+}
+
+// Leading arms every member of the unit passes through
+static int sharing_common_choices(const SharingPlan *plan, const SharedUnit *unit)
+{
+    const SharedOperation *first = &plan->operations[unit->first_operation];
+    int common = first->choice_count;
+
+    for (int member = first->next_in_unit; member >= 0; member = plan->operations[member].next_in_unit)
+    {
+        const SharedOperation *operation = &plan->operations[member];
+        int depth = 0;
+
+        while (depth < common && depth < operation->choice_count &&
+               plan->choices[first->first_choice + depth].if_node == plan->choices[operation->first_choice + depth].if_node &&
+               plan->choices[first->first_choice + depth].arm_index == plan->choices[operation->first_choice + depth].arm_index)
+        {
+            depth++;
+        }
+        common = depth;
+    }
+    return common;
+}
+
+static ASTNode* sharing_output_reference(SharingPlan *plan, const SharedUnit *unit)
+{
+    char name[SHARING_NAME_SIZE];
+    Arena *previous = ast_use_arena(&plan->scratch);
+    ASTNode *reference = create_node(NODE_EXPRESSION);
+
+    snprintf(name, sizeof(name), "%s%d_y", sharing_kind(unit->operator_id), unit->id);
+    set_node_value(reference, name);
+    ast_use_arena(previous);
+    return reference;
+}
+
+int sharing_plan_function(ASTNode *function, int operation_limit, int share_adders, SharingPlan *plan)
+{
+    memset(plan, 0, sizeof(*plan));
+    arena_init(&plan->scratch, 0);
+
+    if (operation_limit < 2)
+    {
+        return 0;
+    }
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+        if (child->type == NODE_STATEMENT)
+        {
+            sharing_collect_statement(plan, child, share_adders);
+        }
+    }
+
+    // Greedy first fit in source order
+    for (int operation_index = 0; operation_index < plan->operation_count; ++operation_index)
+    {
+        SharedOperation *operation = &plan->operations[operation_index];
+        InternId operator_id = operation->node->token.id;
+        int unit_index = -1;
+
+        for (int candidate = 0; candidate < plan->unit_count; ++candidate)
+        {
+            SharedUnit *unit = &plan->units[candidate];
+            if (unit->operator_id == operator_id && unit->level == operation->level &&
+                unit->operation_count < operation_limit && sharing_fits(plan, unit, operation))
+            {
+                unit_index = candidate;
+                break;
+            }
+        }
+        if (unit_index < 0)
+        {
+            unit_index = sharing_new_unit(plan, operator_id, operation->level);
+        }
+        sharing_join(plan, unit_index, operation_index);
+    }
+
+    // A unit with one operation is just the operator itself
+    for (int unit_index = 0; unit_index < plan->unit_count; ++unit_index)
+    {
+        SharedUnit *unit = &plan->units[unit_index];
+
+        if (unit->operation_count < 2)
+        {
+            plan->operations[unit->first_operation].unit = -1;
+            continue;
+        }
+        unit->id = plan->shared_count++;
+        unit->common_choices = sharing_common_choices(plan, unit);
+        unit->output = sharing_output_reference(plan, unit);
+    }
+    return plan->shared_count;
+}
+
+void sharing_plan_free(SharingPlan *plan)
+{
+    free(plan->operations);
+    free(plan->choices);
+    free(plan->path);
+    free(plan->units);
+    arena_release(&plan->scratch);
+    memset(plan, 0, sizeof(*plan));
+}
+
+void sharing_bind(SharingPlan *plan)
+{
+    for (int operation_index = 0; operation_index < plan->operation_count; ++operation_index)
+    {
+        SharedOperation *operation = &plan->operations[operation_index];
+        if (operation->unit >= 0)
+        {
+            operation->parent->children[operation->child_index] = plan->units[operation->unit].output;
+        }
+    }
+}
+
+void sharing_unbind(SharingPlan *plan)
+{
+    for (int operation_index = 0; operation_index < plan->operation_count; ++operation_index)
+    {
+        SharedOperation *operation = &plan->operations[operation_index];
+        if (operation->unit >= 0)
+        {
+            operation->parent->children[operation->child_index] = operation->node;
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+void emit_sharing_signals(const SharingPlan *plan, OutputBuffer *out)
+{
+    static const char *const ports[] = { "a", "b", "y" };
+
+    for (int unit_index = 0; unit_index < plan->unit_count; ++unit_index)
+    {
+        const SharedUnit *unit = &plan->units[unit_index];
+
+        if (unit->id < 0)
+        {
+            continue;
+        }
+        for (size_t port = 0; port < sizeof(ports) / sizeof(ports[0]); ++port)
+        {
+            out_printf(out, "  signal %s%d_%s : std_logic_vector(%d downto 0);\n",
+                       sharing_kind(unit->operator_id), unit->id, ports[port], VHDL_BIT_WIDTH - 1);
+        }
+    }
+}
+
+// Condition under which one arm of an if chain is taken
+static void emit_arm_condition(const SharingChoice *choice, OutputBuffer *out)
+{
+    ASTNode *if_node = choice->if_node;
+    int emitted = 0;
+
+    // Every term parenthesised: VHDL rejects unparenthesised mixes of and/or
+    if (choice->arm_index == 0)
+    {
+        out_putc(out, '(');
+        emit_conditional_expression(if_node->children[FIRST_CHILD_INDEX], out);
+        out_putc(out, ')');
+        return;
+    }
+
+    out_puts(out, "not (");
+    emit_conditional_expression(if_node->children[FIRST_CHILD_INDEX], out);
+    out_putc(out, ')');
+    emitted = 1;
+
+    for (int child_index = FIRST_STATEMENT_INDEX; child_index <= choice->arm_index; ++child_index)
+    {
+        ASTNode *arm = if_node->children[child_index];
+
+        if (arm->type != NODE_ELSE_IF_STATEMENT)
+        {
+            continue;
+        }
+        out_puts(out, emitted ? " and " : "");
+        if (child_index < choice->arm_index)
+        {
+            out_puts(out, "not (");
+            emit_conditional_expression(arm->children[FIRST_CHILD_INDEX], out);
+            out_putc(out, ')');
+        }
+        else
+        {
+            out_putc(out, '(');
+            emit_conditional_expression(arm->children[FIRST_CHILD_INDEX], out);
+            out_putc(out, ')');
+        }
+        emitted = 1;
+    }
+}
+
+static void emit_operation_guard(const SharingPlan *plan, const SharedUnit *unit,
+                                 const SharedOperation *operation, OutputBuffer *out)
+{
+    for (int choice_index = unit->common_choices; choice_index < operation->choice_count; ++choice_index)
+    {
+        if (choice_index > unit->common_choices)
+        {
+            out_puts(out, " and ");
+        }
+        emit_arm_condition(&plan->choices[operation->first_choice + choice_index], out);
+    }
+}
+
+// <kind><id>_<port> <= x when guard else y when guard else z;
+static void emit_operand_mux(const SharingPlan *plan, const SharedUnit *unit, int operand_index,
+                             const char *port, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    out_printf(out, "  %s%d_%s <= ", sharing_kind(unit->operator_id), unit->id, port);
+
+    for (int member = unit->first_operation; member >= 0; member = plan->operations[member].next_in_unit)
+    {
+        const SharedOperation *operation = &plan->operations[member];
+
+        node_generator(operation->node->children[operand_index], out);
+        if (operation->next_in_unit >= 0)
+        {
+            out_puts(out, " when ");
+            emit_operation_guard(plan, unit, operation, out);
+            out_puts(out, " else ");
+        }
+    }
+    out_puts(out, ";\n");
+}
+
+void emit_sharing_units(const SharingPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    for (int unit_index = 0; unit_index < plan->unit_count; ++unit_index)
+    {
+        const SharedUnit *unit = &plan->units[unit_index];
+        const char *kind = sharing_kind(unit->operator_id);
+
+        if (unit->id < 0)
+        {
+            continue;
+        }
+        out_printf(out, "  -- Shared %s unit: %d operations\n", kind, unit->operation_count);
+        emit_operand_mux(plan, unit, FIRST_CHILD_INDEX, "a", out, node_generator);
+        emit_operand_mux(plan, unit, FIRST_CHILD_INDEX + 1, "b", out, node_generator);
+        out_printf(out, "  %s%d_y <= %s%d_a %s %s%d_b;\n", kind, unit->id, kind, unit->id,
+                   (unit->operator_id == INTERN_OP_MODULO) ? VHDL_OP_REM
+                                                           : plan->operations[unit->first_operation].node->value,
+                   kind, unit->id);
+    }
+}
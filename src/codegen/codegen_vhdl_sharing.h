@@ -0,0 +1,88 @@
+// VHDL Code Generator - Resource Sharing
+// -------------------------------------------------------------
+// Purpose: Bind arithmetic operations that are never active in the same
+//          clock cycle (different arms of one if chain) to a single
+//          functional unit behind operand multiplexers
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_SHARING_H
+#define CODEGEN_VHDL_SHARING_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "arena.h"
+#include "intern.h"
+
+// -------------------------------------------------------------
+// Sharing plan
+// -------------------------------------------------------------
+// One arm taken on the way to an operation
+typedef struct {
+    ASTNode *if_node;
+    int arm_index;             // 0 = then arm, else child index of the ELSE_IF/ELSE
+} SharingChoice;
+
+typedef struct {
+    ASTNode *node;             // Bound binary expression
+    ASTNode *parent;           // Node whose child it is (swapped for the unit output)
+    int child_index;
+    int level;                 // 1 + deepest candidate below it; units only mix equal levels
+    int first_choice;          // Arms enclosing it, outermost first (into choices)
+    int choice_count;
+    int unit;                  // Index into units (-1 = not shared)
+    int next_in_unit;          // Next member of the same unit (-1 = last)
+} SharedOperation;
+
+typedef struct {
+    InternId operator_id;
+    int level;
+    int first_operation;
+    int last_operation;
+    int operation_count;
+    int common_choices;        // Leading arms shared by every member
+    int id;                    // Signals are named <kind><id>_a/_b/_y (-1 = dropped)
+    ASTNode *output;           // Reference to <kind><id>_y, swapped in while bound
+} SharedUnit;
+
+typedef struct {
+    SharedOperation *operations;
+    int operation_count;
+    int operation_capacity;
+    SharingChoice *choices;
+    int choice_count;
+    int choice_capacity;
+    SharingChoice *path;       // Arms enclosing the statement being collected
+    int path_depth;
+    int path_capacity;
+    SharedUnit *units;
+    int unit_count;
+    int unit_capacity;
+    int shared_count;          // Units with at least two operations
+    Arena scratch;             // Unit output reference nodes
+} SharingPlan;
+
+/**
+ * Group the operations of one function into shared units.
+ *
+ * @param operation_limit Maximum operations per unit (>= 2 to share anything)
+ * @param share_adders    Also bind + and - (otherwise only *, / and %)
+ * @return Number of shared units (plan still needs sharing_plan_free)
+ */
+int sharing_plan_function(ASTNode *function, int operation_limit, int share_adders, SharingPlan *plan);
+
+void sharing_plan_free(SharingPlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Architecture declarations of the unit operand and output signals
+void emit_sharing_signals(const SharingPlan *plan, OutputBuffer *out);
+
+// Point every bound operation at its unit output (undo with sharing_unbind)
+void sharing_bind(SharingPlan *plan);
+void sharing_unbind(SharingPlan *plan);
+
+// Concurrent operand multiplexers and one operator per unit (call while bound)
+void emit_sharing_units(const SharingPlan *plan, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+#endif // CODEGEN_VHDL_SHARING_H
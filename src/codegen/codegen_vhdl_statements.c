@@ -5,16 +5,22 @@
 #include "codegen_vhdl_constants.h"
 #include "codegen_vhdl_helpers.h"
 #include "codegen_vhdl_expressions.h"
+#include "codegen_vhdl_unroll.h"
+#include "codegen_vhdl_fixed.h"
+#include "codegen_vhdl_widths.h"
 #include "symbol_structs.h"
 #include "utils.h"
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
 
+static void emit_stored_value(ASTNode *value, const char *target, int is_array, int width, int is_signed,
+                              OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
 // -------------------------------------------------------------
 // Statement block generation
 // -------------------------------------------------------------
-void generate_statement_block(ASTNode *node, FILE *output_file, void (*node_generator)(ASTNode*, FILE*))
+void generate_statement_block(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     int child_index = 0;
 
@@ -26,44 +32,60 @@ void generate_statement_block(ASTNode *node, FILE *output_file, void (*node_gene
         {
             case NODE_VAR_DECL:
             {
-                char *array_bracket = (child->value != NULL) ? strchr(child->value, '[') : NULL;
-                int struct_index = find_struct_index(child->token.value);
+                int is_array = (child->array_size > 0);
+                int struct_index = find_struct_index_id(child->token.id);
                 int is_struct = (struct_index >= 0);
                 
-                if (child->num_children > 0 && array_bracket == NULL && is_struct)
+                if (child->num_children > 0 && !is_array && is_struct)
                 {
                     ASTNode *initializer = child->children[FIRST_CHILD_INDEX];
-                    emit_struct_field_initializations(child, struct_index, initializer, output_file, node_generator);
+                    emit_struct_field_initializations(child, struct_index, initializer, out, node_generator);
                 }
-                else if (child->num_children > 0 && array_bracket == NULL)
+                else if (child->num_children > 0 && !is_array)
                 {
-                    emit_variable_initializer(child, output_file, INDENT_LEVEL_3, node_generator);
+                    emit_variable_initializer(child, out, INDENT_LEVEL_3, node_generator);
                 }
                 break;
             }
             
             case NODE_ASSIGNMENT:
-                emit_variable_assignment(child, output_file, INDENT_LEVEL_3, node_generator);
+                emit_variable_assignment(child, out, INDENT_LEVEL_3, node_generator);
                 break;
                 
+            case NODE_FOR_STATEMENT:
+                // Constant-trip loops are unrolled; the rest become while loops
+                if (!generate_unrolled_for_loop(node, child, codegen_current_options()->unroll_limit,
+                                                out, node_generator))
+                {
+                    node_generator(child, out);
+                }
+                break;
+
             case NODE_IF_STATEMENT:
             case NODE_WHILE_STATEMENT:
-            case NODE_FOR_STATEMENT:
             case NODE_BREAK_STATEMENT:
             case NODE_CONTINUE_STATEMENT:
-                node_generator(child, output_file);
+                node_generator(child, out);
                 break;
 
             case NODE_EXPRESSION:
-                emit_expression_as_return(child, node, output_file, node_generator);
+            case NODE_INDEX_EXPR:
+            case NODE_MEMBER_EXPR:
+                emit_expression_as_return(child, node, out, node_generator);
                 break;
                 
             case NODE_BINARY_EXPR:
-            case NODE_BINARY_OP:
-                fprintf(output_file, "%sresult <= ", INDENT_LEVEL_3);
-                node_generator(child, output_file);
-                fprintf(output_file, ";\n");
+            case NODE_UNARY_EXPR:
+            {
+                int is_signed = 0;
+                int width = width_of_result(&is_signed);
+
+                out_puts(out, INDENT_LEVEL_3);
+                out_puts(out, "result <= ");
+                emit_stored_value(child, NULL, 0, width, is_signed, out, node_generator);
+                out_puts(out, ";\n");
                 break;
+            }
                 
             default:
                 // Intentionally ignored node types
@@ -75,27 +97,29 @@ void generate_statement_block(ASTNode *node, FILE *output_file, void (*node_gene
 // -------------------------------------------------------------
 // While loop generation
 // -------------------------------------------------------------
-void generate_while_loop(ASTNode *node, FILE *output_file, void (*node_generator)(ASTNode*, FILE*))
+void generate_while_loop(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     int statement_index = FIRST_STATEMENT_INDEX;
     ASTNode *condition = node->children[FIRST_CHILD_INDEX];
     
-    fprintf(output_file, "%swhile ", INDENT_LEVEL_3);
-    emit_conditional_expression(condition, output_file);
-    fprintf(output_file, " loop\n");
+    out_puts(out, INDENT_LEVEL_3);
+    out_puts(out, "while ");
+    emit_conditional_expression(condition, out);
+    out_puts(out, " loop\n");
     
     for (statement_index = FIRST_STATEMENT_INDEX; statement_index < node->num_children; ++statement_index)
     {
-        node_generator(node->children[statement_index], output_file);
+        node_generator(node->children[statement_index], out);
     }
     
-    fprintf(output_file, "%send loop;\n", INDENT_LEVEL_3);
+    out_puts(out, INDENT_LEVEL_3);
+    out_puts(out, "end loop;\n");
 }
 
 // -------------------------------------------------------------
 // For loop generation (converted to VHDL while loop)
 // -------------------------------------------------------------
-void generate_for_loop(ASTNode *node, FILE *output_file, void (*node_generator)(ASTNode*, FILE*))
+void generate_for_loop(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     int condition_index = 0;
     int statement_index = 0;
@@ -119,11 +143,11 @@ void generate_for_loop(ASTNode *node, FILE *output_file, void (*node_generator)(
     {
         if (first_child->type == NODE_ASSIGNMENT && first_child->num_children == 2)
         {
-            emit_variable_assignment(first_child, output_file, INDENT_LEVEL_3, node_generator);
+            emit_variable_assignment(first_child, out, INDENT_LEVEL_3, node_generator);
         }
         else if (first_child->type == NODE_VAR_DECL && first_child->num_children > 0)
         {
-            emit_variable_initializer(first_child, output_file, INDENT_LEVEL_3, node_generator);
+            emit_variable_initializer(first_child, out, INDENT_LEVEL_3, node_generator);
         }
         
         condition_index = 1;
@@ -150,9 +174,10 @@ void generate_for_loop(ASTNode *node, FILE *output_file, void (*node_generator)(
     }
 
     // Emit while loop with condition
-    fprintf(output_file, "%swhile ", INDENT_LEVEL_3);
-    emit_conditional_expression(condition, output_file);
-    fprintf(output_file, " loop\n");
+    out_puts(out, INDENT_LEVEL_3);
+    out_puts(out, "while ");
+    emit_conditional_expression(condition, out);
+    out_puts(out, " loop\n");
 
     // Emit loop body statements (excluding increment)
     for (statement_index = condition_index + 1; 
@@ -164,30 +189,32 @@ void generate_for_loop(ASTNode *node, FILE *output_file, void (*node_generator)(
             continue; // Skip increment, emit it at the end
         }
         
-        node_generator(node->children[statement_index], output_file);
+        node_generator(node->children[statement_index], out);
     }
 
     // Emit increment at end of loop body
     if (increment != NULL && increment->num_children == 2)
     {
-        emit_variable_assignment(increment, output_file, INDENT_LEVEL_4, node_generator);
+        emit_variable_assignment(increment, out, INDENT_LEVEL_4, node_generator);
     }
 
-    fprintf(output_file, "%send loop;\n", INDENT_LEVEL_3);
+    out_puts(out, INDENT_LEVEL_3);
+    out_puts(out, "end loop;\n");
 }
 
 // -------------------------------------------------------------
 // If / ElseIf / Else statement generation
 // -------------------------------------------------------------
-void generate_if_statement(ASTNode *node, FILE *output_file, void (*node_generator)(ASTNode*, FILE*))
+void generate_if_statement(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     int branch_index = 0;
     int statement_index = 0;
     ASTNode *condition = node->children[FIRST_CHILD_INDEX];
 
-    fprintf(output_file, "%sif ", INDENT_LEVEL_3);
-    emit_conditional_expression(condition, output_file);
-    fprintf(output_file, " then\n");
+    out_puts(out, INDENT_LEVEL_3);
+    out_puts(out, "if ");
+    emit_conditional_expression(condition, out);
+    out_puts(out, " then\n");
 
     for (branch_index = FIRST_STATEMENT_INDEX; 
          branch_index < node->num_children; 
@@ -199,61 +226,81 @@ void generate_if_statement(ASTNode *node, FILE *output_file, void (*node_generat
         {
             ASTNode *elseif_condition = branch->children[FIRST_CHILD_INDEX];
             
-            fprintf(output_file, "%selsif ", INDENT_LEVEL_3);
-            emit_conditional_expression(elseif_condition, output_file);
-            fprintf(output_file, " then\n");
+            out_puts(out, INDENT_LEVEL_3);
+            out_puts(out, "elsif ");
+            emit_conditional_expression(elseif_condition, out);
+            out_puts(out, " then\n");
             
             for (statement_index = FIRST_STATEMENT_INDEX; 
                  statement_index < branch->num_children; 
                  ++statement_index)
             {
-                node_generator(branch->children[statement_index], output_file);
+                node_generator(branch->children[statement_index], out);
             }
         }
         else if (branch->type == NODE_ELSE_STATEMENT)
         {
-            fprintf(output_file, "%selse\n", INDENT_LEVEL_3);
+            out_puts(out, INDENT_LEVEL_3);
+            out_puts(out, "else\n");
             
             for (statement_index = 0; 
                  statement_index < branch->num_children; 
                  ++statement_index)
             {
-                node_generator(branch->children[statement_index], output_file);
+                node_generator(branch->children[statement_index], out);
             }
         }
         else
         {
-            node_generator(branch, output_file);
+            node_generator(branch, out);
         }
     }
     
-    fprintf(output_file, "%send if;\n", INDENT_LEVEL_3);
+    out_puts(out, INDENT_LEVEL_3);
+    out_puts(out, "end if;\n");
 }
 
 // -------------------------------------------------------------
 // Break statement generation
 // -------------------------------------------------------------
-void generate_break_statement(ASTNode *node, FILE *output_file)
+void generate_break_statement(ASTNode *node, OutputBuffer *out)
 {
     (void)node; // Suppress unused parameter warning
-    fprintf(output_file, "%sexit;\n", INDENT_LEVEL_3);
+    out_puts(out, INDENT_LEVEL_3);
+    out_puts(out, "exit;\n");
 }
 
 // -------------------------------------------------------------
 // Continue statement generation
 // -------------------------------------------------------------
-void generate_continue_statement(ASTNode *node, FILE *output_file)
+void generate_continue_statement(ASTNode *node, OutputBuffer *out)
 {
     (void)node; // Suppress unused parameter warning
-    fprintf(output_file, "%snext;\n", INDENT_LEVEL_3);
+    out_puts(out, INDENT_LEVEL_3);
+    out_puts(out, "next;\n");
+}
+
+// -------------------------------------------------------------
+// Helper: Emit a value stored into target (NULL = the result port), in
+// the target's fixed-point format or fitted to its width
+// -------------------------------------------------------------
+static void emit_stored_value(ASTNode *value, const char *target, int is_array, int width, int is_signed,
+                              OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    if (!emit_fixed_store(value, target, is_array, out, node_generator))
+    {
+        emit_width_fitted(value, width, is_signed, out, node_generator);
+    }
 }
 
 // -------------------------------------------------------------
 // Helper: Emit variable initializer
 // -------------------------------------------------------------
-void emit_variable_initializer(ASTNode *declaration, FILE *output_file, const char *indentation, void (*node_generator)(ASTNode*, FILE*))
+void emit_variable_initializer(ASTNode *declaration, OutputBuffer *out, const char *indentation, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     ASTNode *initializer = NULL;
+    int is_signed = 0;
+    int width = 0;
 
     if (declaration == NULL || declaration->num_children == 0)
     {
@@ -261,26 +308,24 @@ void emit_variable_initializer(ASTNode *declaration, FILE *output_file, const ch
     }
 
     initializer = declaration->children[FIRST_CHILD_INDEX];
-    fprintf(output_file, "%s", indentation);
-    emit_mapped_signal_name(declaration->value, output_file);
-    fprintf(output_file, " <= ");
-    node_generator(initializer, output_file);
-    fprintf(output_file, ";\n");
+    width = width_of_signal(declaration->value, &is_signed);
+    out_puts(out, indentation);
+    emit_mapped_signal_name(declaration->value, out);
+    out_puts(out, " <= ");
+    emit_stored_value(initializer, declaration->value, 0, width, is_signed, out, node_generator);
+    out_puts(out, ";\n");
 }
 
 // -------------------------------------------------------------
 // Helper: Emit variable assignment
 // -------------------------------------------------------------
-void emit_variable_assignment(ASTNode *assignment, FILE *output_file, const char *indentation, void (*node_generator)(ASTNode*, FILE*))
+void emit_variable_assignment(ASTNode *assignment, OutputBuffer *out, const char *indentation, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     ASTNode *left_hand_side = NULL;
     ASTNode *right_hand_side = NULL;
-    char array_name[ARRAY_NAME_BUFFER_SIZE] = {0};
-    char array_index[ARRAY_INDEX_BUFFER_SIZE] = {0};
-    const char *left_bracket = NULL;
-    const char *index_start = NULL;
-    const char *index_end = NULL;
-    int name_length = 0;
+    ASTNode *array = NULL;
+    int is_signed = 0;
+    int width = 0;
 
     if (assignment == NULL || assignment->num_children != 2)
     {
@@ -290,82 +335,72 @@ void emit_variable_assignment(ASTNode *assignment, FILE *output_file, const char
     left_hand_side = assignment->children[FIRST_CHILD_INDEX];
     right_hand_side = assignment->children[FIRST_CHILD_INDEX + 1];
 
-    fprintf(output_file, "%s", indentation);
+    out_puts(out, indentation);
 
-    if (left_hand_side->value != NULL && strchr(left_hand_side->value, '[') != NULL)
+    if (left_hand_side->type == NODE_INDEX_EXPR || left_hand_side->type == NODE_MEMBER_EXPR)
     {
-        // Array element assignment
-        left_bracket = strchr(left_hand_side->value, '[');
-        
-        if (left_bracket != NULL)
+        // Array element or struct field assignment
+        array = left_hand_side->children[FIRST_CHILD_INDEX];
+        node_generator(left_hand_side, out);
+        out_puts(out, " <= ");
+        if (left_hand_side->type == NODE_INDEX_EXPR && array->type == NODE_EXPRESSION)
         {
-            name_length = (int)(left_bracket - left_hand_side->value);
-            strncpy(array_name, left_hand_side->value, name_length);
-            array_name[name_length] = '\0';
-            
-            index_start = left_bracket + 1;
-            index_end = strchr(index_start, ']');
-            
-            if (index_end != NULL && index_end > index_start)
-            {
-                int index_length = (int)(index_end - index_start);
-                strncpy(array_index, index_start, index_length);
-                array_index[index_length] = '\0';
-                
-                fprintf(output_file, "%s(%s) <= ", array_name, array_index);
-                node_generator(right_hand_side, output_file);
-                fprintf(output_file, ";\n");
-                return;
-            }
+            width = width_of_array(array->value, &is_signed);
+            emit_stored_value(right_hand_side, array->value, 1, width, is_signed, out, node_generator);
         }
-        
-        fprintf(output_file, "-- Invalid array index\n");
+        else
+        {
+            emit_width_fitted(right_hand_side, width, is_signed, out, node_generator);
+        }
+        out_puts(out, ";\n");
         return;
     }
 
-    fprintf(output_file, "%s", indentation);
-    emit_mapped_signal_name(left_hand_side->value, output_file);
-    fprintf(output_file, " <= ");
-    node_generator(right_hand_side, output_file);
-    fprintf(output_file, ";\n");
+    width = width_of_signal(left_hand_side->value, &is_signed);
+    emit_mapped_signal_name(left_hand_side->value, out);
+    out_puts(out, " <= ");
+    emit_stored_value(right_hand_side, left_hand_side->value, 0, width, is_signed, out, node_generator);
+    out_puts(out, ";\n");
 }
 
 // -------------------------------------------------------------
 // Helper: Emit struct field initializations
 // -------------------------------------------------------------
 void emit_struct_field_initializations(ASTNode *var_decl, int struct_index, 
-                                       ASTNode *initializer, FILE *output_file, void (*node_generator)(ASTNode*, FILE*))
+                                       ASTNode *initializer, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     int field_index = 0;
+    const StructInfo *struct_info = struct_info_at(struct_index);
     
-    if (initializer != NULL && 
+    if (struct_info != NULL &&
+        initializer != NULL && 
         initializer->value != NULL && 
         strcmp(initializer->value, STRUCT_INIT_MARKER) == 0)
     {
-        for (field_index = 0; field_index < g_structs[struct_index].field_count; ++field_index)
+        for (field_index = 0; field_index < struct_info->field_count; ++field_index)
         {
-            const char *field_name = g_structs[struct_index].fields[field_index].field_name;
+            const char *field_name = struct_info->fields[field_index].field_name;
             const char *field_value = (field_index < initializer->num_children) ? 
                                       initializer->children[field_index]->value : DEFAULT_ZERO_VALUE;
             
-            if (strcmp(g_structs[struct_index].fields[field_index].field_type, C_TYPE_INT) == 0)
+            if (strcmp(struct_info->fields[field_index].field_type, C_TYPE_INT) == 0)
             {
                 if (is_numeric_literal(field_value) || is_negative_numeric_literal(field_value))
                 {
-                    fprintf(output_file, "%s%s.%s <= ", 
+                    out_printf(out, "%s%s.%s <= ", 
                             INDENT_LEVEL_3, var_decl->value, field_name);
-                    emit_unsigned_cast(field_value, output_file);
-                    fprintf(output_file, ";\n");
+                    emit_unsigned_cast(field_value, out);
+                    out_puts(out, ";\n");
                 }
                 else
                 {
-                    fprintf(output_file, "%s%s.%s <= %s;\n", 
+                    out_printf(out, "%s%s.%s <= %s;\n", 
                             INDENT_LEVEL_3, var_decl->value, field_name, field_value);
                 }
             }
             else
             {
-                fprintf(output_file, "%s%s.%s <= %s;\n", 
+                out_printf(out, "%s%s.%s <= %s;\n", 
                         INDENT_LEVEL_3, var_decl->value, field_name, field_value);
             }
         }
@@ -373,9 +408,11 @@ void emit_struct_field_initializations(ASTNode *var_decl, int struct_index,
     else
     {
         const char *var_name = (var_decl->value != NULL) ? var_decl->value : UNKNOWN_IDENTIFIER;
-        fprintf(output_file, "%s%s <= ", INDENT_LEVEL_3, var_name);
-        node_generator(initializer, output_file);
-        fprintf(output_file, ";\n");
+        out_puts(out, INDENT_LEVEL_3);
+        out_puts(out, var_name);
+        out_puts(out, " <= ");
+        node_generator(initializer, out);
+        out_puts(out, ";\n");
     }
 }
 
@@ -383,7 +420,7 @@ void emit_struct_field_initializations(ASTNode *var_decl, int struct_index,
 // Helper: Handle expression as function return value
 // -------------------------------------------------------------
 void emit_expression_as_return(ASTNode *expression, ASTNode *parent_statement, 
-                               FILE *output_file, void (*node_generator)(ASTNode*, FILE*))
+                               OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
 {
     int is_struct_return_type = 0;
     const char *struct_return_name = NULL;
@@ -391,39 +428,49 @@ void emit_expression_as_return(ASTNode *expression, ASTNode *parent_statement,
     if (parent_statement->parent != NULL && 
         parent_statement->parent->type == NODE_FUNCTION_DECL)
     {
-        struct_return_name = parent_statement->parent->token.value;
+        struct_return_name = token_text(parent_statement->parent->token);
         is_struct_return_type = (struct_return_name != NULL && 
-                                 find_struct_index(struct_return_name) >= 0);
+                                 find_struct_index_id(parent_statement->parent->token.id) >= 0);
     }
     
-    int is_plain = is_plain_identifier(expression->value);
+    int is_plain = (expression->type == NODE_EXPRESSION && is_plain_identifier(expression->value));
     
     if (is_struct_return_type && expression->value != NULL && is_plain)
     {
         emit_struct_field_copy_to_result(expression, parent_statement->parent, 
-                                        output_file, INDENT_LEVEL_3);
+                                        out, INDENT_LEVEL_3);
     }
     else
     {
-        fprintf(output_file, "%sresult <= ", INDENT_LEVEL_3);
+        out_puts(out, INDENT_LEVEL_3);
+        out_puts(out, "result <= ");
         
-        if (expression->value != NULL && is_negative_numeric_literal(expression->value))
+        // Converted to or from the fixed-point format of the result first
+        if (!emit_fixed_store(expression, NULL, 0, out, node_generator))
         {
-            if (isalpha(expression->value[1]) || expression->value[1] == '_')
+            if (expression->value != NULL && is_negative_numeric_literal(expression->value))
             {
-                fprintf(output_file, "-unsigned(%s)", expression->value + 1);
+                if (isalpha(expression->value[1]) || expression->value[1] == '_')
+                {
+                    out_puts(out, "-unsigned(");
+                    out_puts(out, expression->value + 1);
+                    out_putc(out, ')');
+                }
+                else
+                {
+                    emit_signed_cast(expression->value, out);
+                }
             }
             else
             {
-                emit_signed_cast(expression->value, output_file);
+                int is_signed = 0;
+                int width = width_of_result(&is_signed);
+
+                emit_width_fitted(expression, width, is_signed, out, node_generator);
             }
         }
-        else
-        {
-            node_generator(expression, output_file);
-        }
         
-        fprintf(output_file, ";\n");
+        out_puts(out, ";\n");
     }
 }
 
@@ -431,9 +478,8 @@ void emit_expression_as_return(ASTNode *expression, ASTNode *parent_statement,
 // Helper: Copy struct fields to result port
 // -------------------------------------------------------------
 void emit_struct_field_copy_to_result(ASTNode *expression, ASTNode *function_node, 
-                                      FILE *output_file, const char *indentation)
+                                      OutputBuffer *out, const char *indentation)
 {
-    const char *struct_return_name = NULL;
     int struct_index = 0;
 
     if (function_node == NULL || expression == NULL || expression->value == NULL)
@@ -441,8 +487,7 @@ void emit_struct_field_copy_to_result(ASTNode *expression, ASTNode *function_nod
         return;
     }
 
-    struct_return_name = function_node->token.value;
-    struct_index = find_struct_index(struct_return_name);
+    struct_index = find_struct_index_id(function_node->token.id);
 
     if (struct_index < 0)
     {
@@ -450,5 +495,5 @@ void emit_struct_field_copy_to_result(ASTNode *expression, ASTNode *function_nod
     }
 
     emit_struct_field_assignments(struct_index, "result", expression->value, 
-                                  output_file, indentation);
+                                  out, indentation);
 }
@@ -6,29 +6,29 @@
 #ifndef CODEGEN_VHDL_STATEMENTS_H
 #define CODEGEN_VHDL_STATEMENTS_H
 
-#include <stdio.h>
+#include "output_buffer.h"
 #include "astnode.h"
 
 // -------------------------------------------------------------
 // Statement generation
 // -------------------------------------------------------------
-void generate_statement_block(ASTNode *node, FILE *output_file, void (*node_generator)(ASTNode*, FILE*));
-void generate_while_loop(ASTNode *node, FILE *output_file, void (*node_generator)(ASTNode*, FILE*));
-void generate_for_loop(ASTNode *node, FILE *output_file, void (*node_generator)(ASTNode*, FILE*));
-void generate_if_statement(ASTNode *node, FILE *output_file, void (*node_generator)(ASTNode*, FILE*));
-void generate_break_statement(ASTNode *node, FILE *output_file);
-void generate_continue_statement(ASTNode *node, FILE *output_file);
+void generate_statement_block(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+void generate_while_loop(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+void generate_for_loop(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+void generate_if_statement(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+void generate_break_statement(ASTNode *node, OutputBuffer *out);
+void generate_continue_statement(ASTNode *node, OutputBuffer *out);
 
 // -------------------------------------------------------------
 // Statement emission helpers
 // -------------------------------------------------------------
-void emit_variable_initializer(ASTNode *declaration, FILE *output_file, const char *indentation, void (*node_generator)(ASTNode*, FILE*));
-void emit_variable_assignment(ASTNode *assignment, FILE *output_file, const char *indentation, void (*node_generator)(ASTNode*, FILE*));
+void emit_variable_initializer(ASTNode *declaration, OutputBuffer *out, const char *indentation, void (*node_generator)(ASTNode*, OutputBuffer*));
+void emit_variable_assignment(ASTNode *assignment, OutputBuffer *out, const char *indentation, void (*node_generator)(ASTNode*, OutputBuffer*));
 void emit_struct_field_initializations(ASTNode *var_decl, int struct_index, 
-                                       ASTNode *initializer, FILE *output_file, void (*node_generator)(ASTNode*, FILE*));
+                                       ASTNode *initializer, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
 void emit_expression_as_return(ASTNode *expression, ASTNode *parent_statement, 
-                              FILE *output_file, void (*node_generator)(ASTNode*, FILE*));
+                              OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
 void emit_struct_field_copy_to_result(ASTNode *expression, ASTNode *function_node, 
-                                      FILE *output_file, const char *indentation);
+                                      OutputBuffer *out, const char *indentation);
 
 #endif // CODEGEN_VHDL_STATEMENTS_H
@@ -0,0 +1,705 @@
+// VHDL Code Generator - Stream Interfaces Implementation
+// -------------------------------------------------------------
+// A function that walks its array parameters element by element in one
+// loop does not need the arrays at once: each array becomes an AXI-Stream
+// port and each loop iteration consumes one beat of every input stream and
+// produces one beat of every output stream. The loop counter counts beats,
+// a frame ends on the trip count or an input tlast, and the cycle after the
+// last beat registers the return value, pulses done and runs the prelude
+// (the statements before the loop) again for the next frame.
+//
+// A beat fires when every input has tvalid and every output register is
+// empty or being drained this cycle, so with tready held high the body
+// runs every cycle (II=1); output tvalid never depends on tready.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_stream.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_reset.h"
+#include "codegen_vhdl_types.h"
+#include "codegen_vhdl_unroll.h"
+#include "symbol_structs.h"
+#include "utils.h"
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define STREAM_NAME_SIZE 256
+
+// Beat statements sit one level under "if stream_fire = '1' then"
+#define STREAM_INDENT "  "
+
+// Helper: "#pragma compi stream off" on the first statement
+static int stream_refused(const ASTNode *function)
+{
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        const ASTNode *child = function->children[child_index];
+        const char *arguments = NULL;
+
+        if (child->type != NODE_STATEMENT)
+        {
+            continue;
+        }
+        arguments = find_node_pragma(child, "stream");
+        return arguments != NULL && strncmp(arguments, "off", 3) == 0;
+    }
+    return 0;
+}
+
+static int is_name(const ASTNode *node, const char *name)
+{
+    return node != NULL && node->type == NODE_EXPRESSION && node->num_children == 0 &&
+           node->value != NULL && strcmp(node->value, name) == 0;
+}
+
+static int is_literal(const ASTNode *node, int64_t *value)
+{
+    if (node == NULL || node->type != NODE_EXPRESSION || node->num_children > 0 ||
+        !is_numeric_literal(node->value) || strchr(node->value, '.') != NULL)
+    {
+        return 0;
+    }
+    *value = strtoll(node->value, NULL, 0);
+    return 1;
+}
+
+// Helper: the stream port of an array parameter named by node, or NULL
+static StreamPort* find_port(StreamPlan *plan, const ASTNode *node)
+{
+    for (int port_index = 0; port_index < plan->array_count; ++port_index)
+    {
+        if (is_name(node, plan->ports[port_index].parameter->value))
+        {
+            return &plan->ports[port_index];
+        }
+    }
+    return NULL;
+}
+
+// Helper: a scalar parameter of function named by node
+static int is_scalar_parameter(const ASTNode *function, const ASTNode *node)
+{
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        const ASTNode *child = function->children[child_index];
+
+        if (child->type == NODE_VAR_DECL && child->array_size == 0 && child->value != NULL &&
+            is_name(node, child->value))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void stream_add_binding(StreamPlan *plan, ASTNode *parent, int child_index)
+{
+    StreamBinding *binding = NULL;
+
+    if (plan->binding_count == plan->binding_capacity)
+    {
+        plan->binding_capacity = plan->binding_capacity ? plan->binding_capacity * 2 : 8;
+        plan->bindings = (StreamBinding*)xrealloc(plan->bindings,
+                                                  (size_t)plan->binding_capacity * sizeof(StreamBinding));
+    }
+    binding = &plan->bindings[plan->binding_count++];
+    binding->parent = parent;
+    binding->child_index = child_index;
+    binding->original = parent->children[child_index];
+    binding->data = NULL;
+}
+
+// -------------------------------------------------------------
+// Eligibility
+// -------------------------------------------------------------
+// Helper: code outside the loop: no arrays of the interface, loops or calls
+static int stream_scalar_code(StreamPlan *plan, const ASTNode *node)
+{
+    if (node->type == NODE_FOR_STATEMENT || node->type == NODE_WHILE_STATEMENT ||
+        node->type == NODE_BREAK_STATEMENT || node->type == NODE_CONTINUE_STATEMENT ||
+        node->type == NODE_FUNC_CALL || find_port(plan, node) != NULL ||
+        (node->type == NODE_STATEMENT && node->token.id == INTERN_KW_RETURN))
+    {
+        return 0;
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (!stream_scalar_code(plan, node->children[child_index]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Helper: loop body code from child first_child of node on: input streams
+// are read only as name[i], the loop variable is never written
+static int stream_body_code(StreamPlan *plan, ASTNode *node, int first_child)
+{
+    for (int child_index = first_child; child_index < node->num_children; ++child_index)
+    {
+        ASTNode *child = node->children[child_index];
+        StreamPort *port = (child->type == NODE_INDEX_EXPR && child->num_children == 2)
+                               ? find_port(plan, child->children[FIRST_CHILD_INDEX]) : NULL;
+
+        if (child->type == NODE_FOR_STATEMENT || child->type == NODE_WHILE_STATEMENT ||
+            child->type == NODE_BREAK_STATEMENT || child->type == NODE_CONTINUE_STATEMENT ||
+            child->type == NODE_FUNC_CALL || find_port(plan, child) != NULL ||
+            (child->type == NODE_STATEMENT && child->token.id == INTERN_KW_RETURN) ||
+            (child->type == NODE_VAR_DECL && child->value != NULL && strcmp(child->value, plan->variable) == 0) ||
+            (node->type == NODE_ASSIGNMENT && child_index == FIRST_CHILD_INDEX && is_name(child, plan->variable)))
+        {
+            return 0;
+        }
+        if (port != NULL)
+        {
+            // Outputs are written once per beat, and never read back
+            if (port->is_output || !is_name(child->children[FIRST_CHILD_INDEX + 1], plan->variable) ||
+                (node->type == NODE_ASSIGNMENT && child_index == FIRST_CHILD_INDEX))
+            {
+                return 0;
+            }
+            stream_add_binding(plan, node, child_index);
+            continue;
+        }
+        if (!stream_body_code(plan, child, 0))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Helper: the output stream written by body statement "name[i] = value;"
+static StreamPort* stream_output_write(StreamPlan *plan, const ASTNode *statement)
+{
+    const ASTNode *assignment = NULL;
+    const ASTNode *target = NULL;
+
+    if (statement->type != NODE_STATEMENT || statement->num_children != 1 ||
+        statement->children[FIRST_CHILD_INDEX]->type != NODE_ASSIGNMENT)
+    {
+        return NULL;
+    }
+    assignment = statement->children[FIRST_CHILD_INDEX];
+    if (assignment->num_children != 2)
+    {
+        return NULL;
+    }
+    target = assignment->children[FIRST_CHILD_INDEX];
+    if (target->type != NODE_INDEX_EXPR || target->num_children != 2 ||
+        !is_name(target->children[FIRST_CHILD_INDEX + 1], plan->variable))
+    {
+        return NULL;
+    }
+    return find_port(plan, target->children[FIRST_CHILD_INDEX]);
+}
+
+// for (int i = 0; i < bound; i = i + 1) with a literal or parameter bound
+static int stream_loop(StreamPlan *plan, ASTNode *function, ASTNode *loop)
+{
+    ASTNode *init = NULL;
+    ASTNode *condition = NULL;
+    ASTNode *increment = NULL;
+    ASTNode *update = NULL;
+    int64_t value = 0;
+    int last_body_index = loop->num_children - 1;
+
+    if (loop->num_children < 3)
+    {
+        return 0;
+    }
+
+    init = loop->children[FIRST_CHILD_INDEX];
+    if (init->type == NODE_VAR_DECL && init->array_size == 0 && init->num_children == 1 &&
+        is_literal(init->children[FIRST_CHILD_INDEX], &value) && value == 0)
+    {
+        plan->variable = init->value;
+    }
+    else if (init->type == NODE_ASSIGNMENT && init->num_children == 2 &&
+             init->children[FIRST_CHILD_INDEX]->type == NODE_EXPRESSION &&
+             is_literal(init->children[FIRST_CHILD_INDEX + 1], &value) && value == 0)
+    {
+        plan->variable = init->children[FIRST_CHILD_INDEX]->value;
+    }
+    if (plan->variable == NULL)
+    {
+        return 0;
+    }
+
+    condition = loop->children[FIRST_STATEMENT_INDEX];
+    if (condition->type != NODE_BINARY_EXPR || condition->num_children != 2 ||
+        condition->token.id != INTERN_OP_LESS || !is_name(condition->children[FIRST_CHILD_INDEX], plan->variable))
+    {
+        return 0;
+    }
+    plan->bound = condition->children[FIRST_CHILD_INDEX + 1];
+    if (is_literal(plan->bound, &value) ? (value <= 0 || value > INT32_MAX)
+                                        : !is_scalar_parameter(function, plan->bound))
+    {
+        return 0;
+    }
+
+    increment = loop->children[last_body_index];
+    if (last_body_index <= FIRST_STATEMENT_INDEX || increment->type != NODE_ASSIGNMENT ||
+        increment->num_children != 2 || !is_name(increment->children[FIRST_CHILD_INDEX], plan->variable))
+    {
+        return 0;
+    }
+    update = increment->children[FIRST_CHILD_INDEX + 1];
+    if (update->type != NODE_BINARY_EXPR || update->num_children != 2 ||
+        update->token.id != INTERN_OP_PLUS || !is_name(update->children[FIRST_CHILD_INDEX], plan->variable) ||
+        !is_literal(update->children[FIRST_CHILD_INDEX + 1], &value) || value != 1)
+    {
+        return 0;
+    }
+
+    // Outputs first: reads of them anywhere in the body disqualify the loop
+    for (int child_index = FIRST_STATEMENT_INDEX + 1; child_index < last_body_index; ++child_index)
+    {
+        StreamPort *port = stream_output_write(plan, loop->children[child_index]);
+
+        if (port != NULL)
+        {
+            if (port->is_output)
+            {
+                return 0;
+            }
+            port->is_output = 1;
+        }
+    }
+    for (int child_index = FIRST_STATEMENT_INDEX + 1; child_index < last_body_index; ++child_index)
+    {
+        ASTNode *statement = loop->children[child_index];
+
+        if (statement->type == NODE_STATEMENT && statement->token.id == INTERN_KW_RETURN)
+        {
+            return 0;
+        }
+        if (stream_output_write(plan, statement) != NULL)
+        {
+            ASTNode *assignment = statement->children[FIRST_CHILD_INDEX];
+
+            stream_add_binding(plan, assignment, FIRST_CHILD_INDEX);
+            if (!stream_body_code(plan, assignment, FIRST_CHILD_INDEX + 1))
+            {
+                return 0;
+            }
+        }
+        else if (!stream_body_code(plan, statement, 0))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Prelude, the loop, then at most a return
+static int stream_shape(StreamPlan *plan, ASTNode *function)
+{
+    plan->loop_index = -1;
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+
+        if (child->type == NODE_VAR_DECL)
+        {
+            continue;
+        }
+        if (child->type != NODE_STATEMENT)
+        {
+            return 0;
+        }
+        if (plan->loop_index < 0 && child->num_children == 1 &&
+            child->children[FIRST_CHILD_INDEX]->type == NODE_FOR_STATEMENT)
+        {
+            plan->loop_index = child_index;
+            plan->loop = child->children[FIRST_CHILD_INDEX];
+            if (!stream_loop(plan, function, plan->loop))
+            {
+                return 0;
+            }
+        }
+        else if (plan->loop_index < 0)
+        {
+            if (!stream_scalar_code(plan, child))
+            {
+                return 0;
+            }
+        }
+        else if (plan->result != NULL || child->token.id != INTERN_KW_RETURN || child->num_children != 1 ||
+                 !stream_scalar_code(plan, child->children[FIRST_CHILD_INDEX]))
+        {
+            return 0;
+        }
+        else
+        {
+            plan->result = child;
+        }
+    }
+    return plan->loop != NULL;
+}
+
+static ASTNode* stream_data_reference(StreamPlan *plan, const ASTNode *parameter)
+{
+    char name[STREAM_NAME_SIZE];
+    Arena *previous = ast_use_arena(&plan->scratch);
+    ASTNode *reference = create_node(NODE_EXPRESSION);
+
+    snprintf(name, sizeof(name), "%s_tdata", parameter->value);
+    set_node_value(reference, name);
+    ast_use_arena(previous);
+    return reference;
+}
+
+int stream_plan_function(ASTNode *function, StreamPlan *plan)
+{
+    int eligible = 1;
+
+    memset(plan, 0, sizeof(*plan));
+    arena_init(&plan->scratch, 0);
+    if (stream_refused(function))
+    {
+        return 0;
+    }
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        const ASTNode *child = function->children[child_index];
+
+        if (child->type == NODE_VAR_DECL && child->array_size > 0)
+        {
+            plan->array_count++;
+        }
+    }
+    if (plan->array_count == 0)
+    {
+        return 0;
+    }
+
+    // Elements travel as tdata words: integers of a built-in type
+    plan->ports = (StreamPort*)xrealloc(NULL, (size_t)plan->array_count * sizeof(StreamPort));
+    memset(plan->ports, 0, (size_t)plan->array_count * sizeof(StreamPort));
+    for (int child_index = 0, port_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+
+        if (child->type == NODE_VAR_DECL && child->array_size > 0)
+        {
+            plan->ports[port_index++].parameter = child;
+            eligible = eligible && child->value != NULL &&
+                       ((child->token.type == TOKEN_KEYWORD && child->token.id != INTERN_KW_VOID &&
+                         child->token.id != INTERN_KW_FLOAT && child->token.id != INTERN_KW_DOUBLE) ||
+                        ctype_explicit_width(token_text(child->token), NULL) > 0);
+        }
+    }
+    if (!eligible || !stream_shape(plan, function))
+    {
+        return 0;
+    }
+
+    plan->port_count = plan->array_count;
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        plan->ports[port_index].data = stream_data_reference(plan, plan->ports[port_index].parameter);
+    }
+    for (int binding_index = 0; binding_index < plan->binding_count; ++binding_index)
+    {
+        StreamBinding *binding = &plan->bindings[binding_index];
+
+        binding->data = find_port(plan, binding->original->children[FIRST_CHILD_INDEX])->data;
+    }
+    return plan->port_count;
+}
+
+void stream_plan_free(StreamPlan *plan)
+{
+    free(plan->ports);
+    free(plan->bindings);
+    arena_release(&plan->scratch);
+    memset(plan, 0, sizeof(*plan));
+}
+
+void stream_bind(StreamPlan *plan)
+{
+    for (int binding_index = 0; binding_index < plan->binding_count; ++binding_index)
+    {
+        StreamBinding *binding = &plan->bindings[binding_index];
+        binding->parent->children[binding->child_index] = binding->data;
+    }
+}
+
+void stream_unbind(StreamPlan *plan)
+{
+    for (int binding_index = 0; binding_index < plan->binding_count; ++binding_index)
+    {
+        StreamBinding *binding = &plan->bindings[binding_index];
+        binding->parent->children[binding->child_index] = binding->original;
+    }
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+int emit_stream_ports(const StreamPlan *plan, const ASTNode *parameter, OutputBuffer *out)
+{
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        const StreamPort *port = &plan->ports[port_index];
+        const char *name = parameter->value;
+
+        if (port->parameter != parameter)
+        {
+            continue;
+        }
+        if (port->is_output)
+        {
+            out_printf(out, "    %s_tdata : out %s;\n", name, ctype_to_vhdl(token_text(parameter->token)));
+            out_printf(out, "    %s_tvalid : out std_logic;\n", name);
+            out_printf(out, "    %s_tready : in  std_logic;\n", name);
+            out_printf(out, "    %s_tlast : out std_logic;\n", name);
+        }
+        else
+        {
+            out_printf(out, "    %s_tdata : in %s;\n", name, ctype_to_vhdl(token_text(parameter->token)));
+            out_printf(out, "    %s_tvalid : in  std_logic;\n", name);
+            out_printf(out, "    %s_tready : out std_logic;\n", name);
+            out_printf(out, "    %s_tlast : in  std_logic;\n", name);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+void emit_stream_signals(const StreamPlan *plan, OutputBuffer *out)
+{
+    // Locals of the body (the loop variable is declared with the function's)
+    for (int child_index = FIRST_STATEMENT_INDEX + 1; child_index < plan->loop->num_children - 1; ++child_index)
+    {
+        ASTNode *statement = plan->loop->children[child_index];
+
+        for (int statement_index = 0; statement->type == NODE_STATEMENT && statement_index < statement->num_children;
+             ++statement_index)
+        {
+            if (statement->children[statement_index]->type == NODE_VAR_DECL)
+            {
+                process_variable_declaration_for_signals(statement->children[statement_index], out);
+            }
+        }
+    }
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        if (plan->ports[port_index].is_output)
+        {
+            out_printf(out, "  signal %s_valid : std_logic", plan->ports[port_index].parameter->value);
+            emit_power_up_value("'0'", out);
+            out_puts(out, ";\n");
+        }
+    }
+    out_puts(out, "  signal stream_load : std_logic");
+    emit_power_up_value("'1'", out);
+    out_puts(out, ";\n");
+    out_puts(out, "  signal stream_flush : std_logic");
+    emit_power_up_value("'0'", out);
+    out_puts(out, ";\n");
+    out_puts(out, "  signal stream_fire : std_logic;\n");
+    out_puts(out, "  signal stream_last : std_logic;\n");
+}
+
+void emit_stream_control(const StreamPlan *plan, OutputBuffer *out)
+{
+    int64_t bound = 0;
+
+    out_puts(out, "  -- Stream: one loop iteration per beat\n");
+    out_puts(out, "  stream_fire <= '1' when stream_load = '0' and stream_flush = '0'");
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        const char *name = plan->ports[port_index].parameter->value;
+
+        if (plan->ports[port_index].is_output)
+        {
+            out_printf(out, " and (%s_valid = '0' or %s_tready = '1')", name, name);
+        }
+        else
+        {
+            out_printf(out, " and %s_tvalid = '1'", name);
+        }
+    }
+    out_puts(out, " else '0';\n");
+
+    // The frame ends on its trip count or early on an input tlast
+    out_puts(out, "  stream_last <= '1' when ");
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        if (!plan->ports[port_index].is_output)
+        {
+            out_printf(out, "%s_tlast = '1' or ", plan->ports[port_index].parameter->value);
+        }
+    }
+    out_puts(out, "signed(");
+    emit_mapped_signal_name(plan->variable, out);
+    if (is_literal(plan->bound, &bound))
+    {
+        out_printf(out, ") = %lld", (long long)(bound - 1));
+    }
+    else
+    {
+        out_puts(out, ") = signed(");
+        emit_mapped_signal_name(plan->bound->value, out);
+        out_puts(out, ") - 1");
+    }
+    out_puts(out, " else '0';\n");
+
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        const char *name = plan->ports[port_index].parameter->value;
+
+        if (plan->ports[port_index].is_output)
+        {
+            out_printf(out, "  %s_tvalid <= %s_valid;\n", name, name);
+        }
+        else
+        {
+            out_printf(out, "  %s_tready <= stream_fire;\n", name);
+        }
+    }
+}
+
+void emit_stream_reset(const StreamPlan *plan, OutputBuffer *out)
+{
+    out_puts(out, "      stream_load <= '1';\n");
+    out_puts(out, "      stream_flush <= '0';\n");
+    out_puts(out, "      done <= '0';\n");
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        if (plan->ports[port_index].is_output)
+        {
+            out_printf(out, "      %s_valid <= '0';\n", plan->ports[port_index].parameter->value);
+        }
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: statement output moved under the branch it runs in
+// -------------------------------------------------------------
+static void emit_stream_indented(OutputBuffer *lines, const char *indentation, OutputBuffer *out)
+{
+    size_t position = 0;
+
+    while (position < lines->length)
+    {
+        const char *line = lines->data + position;
+        const char *end = memchr(line, '\n', lines->length - position);
+        size_t length = (end != NULL) ? (size_t)(end - line) + 1 : lines->length - position;
+
+        out_puts(out, indentation);
+        out_write(out, line, length);
+        position += length;
+    }
+    lines->length = 0;
+}
+
+static void emit_stream_counter(const StreamPlan *plan, const char *value, OutputBuffer *out)
+{
+    out_puts(out, "        ");
+    emit_mapped_signal_name(plan->variable, out);
+    out_puts(out, " <= ");
+    if (value != NULL)
+    {
+        out_puts(out, value);
+    }
+    else
+    {
+        out_puts(out, "std_logic_vector(signed(");
+        emit_mapped_signal_name(plan->variable, out);
+        out_puts(out, ") + 1)");
+    }
+    out_puts(out, ";\n");
+}
+
+void emit_stream_beats(ASTNode *function, const StreamPlan *plan, OutputBuffer *out,
+                       void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    OutputBuffer lines;
+    ASTNode **statements = NULL;
+    Arena scratch;
+    Arena *previous_arena = NULL;
+    int count = 0;
+
+    output_buffer_init(&lines, NULL);
+    out_puts(out, "      done <= '0';\n");
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        const char *name = plan->ports[port_index].parameter->value;
+
+        if (plan->ports[port_index].is_output)
+        {
+            out_printf(out, "      if %s_tready = '1' then\n", name);
+            out_printf(out, "        %s_valid <= '0';\n", name);
+            out_puts(out, "      end if;\n");
+        }
+    }
+
+    // A beat: the loop body over the tdata of every stream, with the scalars
+    // it assigns forwarded to its later reads in the same beat
+    out_puts(out, "      if stream_fire = '1' then\n");
+    arena_init(&scratch, 0);
+    previous_arena = ast_use_arena(&scratch);
+    count = unroll_forward_statements(plan->loop, FIRST_STATEMENT_INDEX + 1, plan->loop->num_children - 1,
+                                      codegen_current_options()->unroll_limit, &statements);
+    ast_use_arena(previous_arena);
+    if (count < 0)
+    {
+        for (int child_index = FIRST_STATEMENT_INDEX + 1; child_index < plan->loop->num_children - 1; ++child_index)
+        {
+            node_generator(plan->loop->children[child_index], &lines);
+        }
+    }
+    for (int index = 0; index < count; ++index)
+    {
+        node_generator(statements[index], &lines);
+    }
+    free(statements);
+    arena_release(&scratch);
+    emit_stream_indented(&lines, STREAM_INDENT, out);
+    for (int port_index = 0; port_index < plan->port_count; ++port_index)
+    {
+        const char *name = plan->ports[port_index].parameter->value;
+
+        if (plan->ports[port_index].is_output)
+        {
+            out_printf(out, "        %s_valid <= '1';\n", name);
+            out_printf(out, "        %s_tlast <= stream_last;\n", name);
+        }
+    }
+    emit_stream_counter(plan, NULL, out);
+    out_puts(out, "        stream_flush <= stream_last;\n");
+
+    // Between frames: the result of the last one, the prelude of the next
+    out_puts(out, "      elsif stream_load = '1' or stream_flush = '1' then\n");
+    if (plan->result != NULL)
+    {
+        out_puts(out, "        if stream_flush = '1' then\n");
+        node_generator(plan->result, &lines);
+        emit_stream_indented(&lines, STREAM_INDENT STREAM_INDENT, out);
+        out_puts(out, "        end if;\n");
+    }
+    out_puts(out, "        done <= stream_flush;\n");
+    for (int child_index = 0; child_index < plan->loop_index; ++child_index)
+    {
+        if (function->children[child_index]->type == NODE_STATEMENT)
+        {
+            node_generator(function->children[child_index], &lines);
+        }
+    }
+    emit_stream_indented(&lines, STREAM_INDENT, out);
+    emit_stream_counter(plan, "(others => '0')", out);
+    out_puts(out, "        stream_load <= '0';\n");
+    out_puts(out, "        stream_flush <= '0';\n");
+    out_puts(out, "      end if;\n");
+    output_buffer_free(&lines);
+}
@@ -0,0 +1,93 @@
+// VHDL Code Generator - Stream Interfaces
+// -------------------------------------------------------------
+// Purpose: Turn the array parameters of a function that walks them in one
+//          counted loop into AXI-Stream ports (tdata/tvalid/tready/tlast),
+//          with the loop body executed once per beat (II=1)
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_STREAM_H
+#define CODEGEN_VHDL_STREAM_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "arena.h"
+
+// -------------------------------------------------------------
+// Stream plan
+// -------------------------------------------------------------
+typedef struct {
+    ASTNode *parameter;        // Array parameter
+    int is_output;             // Written as name[i] = value (else only read)
+    ASTNode *data;             // Reference to <name>_tdata, swapped in while bound
+} StreamPort;
+
+typedef struct {
+    ASTNode *parent;           // Node whose child is the element access
+    int child_index;
+    ASTNode *original;         // NODE_INDEX_EXPR name[i]
+    ASTNode *data;             // <name>_tdata reference
+} StreamBinding;
+
+typedef struct {
+    int array_count;           // Array parameters (0 when refused by pragma)
+    StreamPort *ports;         // Set only when the function is streamed
+    int port_count;
+    StreamBinding *bindings;
+    int binding_count;
+    int binding_capacity;
+    ASTNode *loop;             // NODE_FOR_STATEMENT run once per beat
+    int loop_index;            // Function child holding the loop
+    const char *variable;      // Loop variable, counts beats
+    ASTNode *bound;            // Trip count: literal or scalar parameter
+    ASTNode *result;           // Return statement after the loop, or NULL
+    Arena scratch;             // tdata reference nodes
+} StreamPlan;
+
+/**
+ * Plan the stream interface of function: its array parameters become
+ * streams when the body is a loop-free scalar prelude, one loop
+ * for (i = 0; i < bound; i++) that reads the arrays only as name[i] and
+ * writes each output array once as name[i] = value, and a final return.
+ * "#pragma compi stream off" on the first statement keeps plain ports.
+ *
+ * @return Number of stream ports, 0 if the function is generated as usual
+ *         (plan still needs stream_plan_free either way)
+ */
+int stream_plan_function(ASTNode *function, StreamPlan *plan);
+
+void stream_plan_free(StreamPlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+/**
+ * Emit the four AXI-Stream ports standing for parameter
+ *
+ * @return 1 if parameter is a stream, 0 if the caller emits its port
+ */
+int emit_stream_ports(const StreamPlan *plan, const ASTNode *parameter, OutputBuffer *out);
+
+// Declarations of the loop body locals and the beat control signals
+void emit_stream_signals(const StreamPlan *plan, OutputBuffer *out);
+
+// Concurrent handshake: a beat fires when every input is valid and every
+// output register is free or being drained
+void emit_stream_control(const StreamPlan *plan, OutputBuffer *out);
+
+// Reset branch of the process
+void emit_stream_reset(const StreamPlan *plan, OutputBuffer *out);
+
+/**
+ * Clocked branch of the process: one loop iteration per fired beat, and
+ * between frames (after reset and after the last beat) the result of the
+ * frame, a done pulse and the prelude of the next one. Call after
+ * stream_bind so element accesses read and write the tdata ports.
+ */
+void emit_stream_beats(ASTNode *function, const StreamPlan *plan, OutputBuffer *out,
+                       void (*node_generator)(ASTNode*, OutputBuffer*));
+
+// Point every element access at its tdata port (undo with stream_unbind)
+void stream_bind(StreamPlan *plan);
+void stream_unbind(StreamPlan *plan);
+
+#endif // CODEGEN_VHDL_STREAM_H
@@ -0,0 +1,475 @@
+// VHDL Code Generator - Strength Reduction Implementation
+// -------------------------------------------------------------
+// A multiply or divide by a literal does not need a general multiplier or
+// divider: the constant is known when the hardware is built.
+//
+//   x * c   c written in canonical signed digits (non-adjacent form) is a
+//           sum of +-2^k; each digit is a shifted copy of x, so a constant
+//           of up to STRENGTH_MAX_TERMS digits becomes that many adders
+//   x / 2^k an arithmetic shift, after adding 2^k - 1 to negative
+//           dividends so the quotient truncates towards zero as in C
+//   x / d   the high word of x * M, shifted by s and corrected by one for
+//           negative dividends (Hacker's Delight, 10-1); one DSP multiply
+//           instead of a 32-step divider
+//   x % d   x - (x / d) * d, over the lowered quotient
+//   x / 1   x, and x / -1 is -x; x % 1 and x % -1 are 0
+//
+// Expressions are computed at 32 bits, so the sequences are written for
+// 32-bit signed operands; unsigned 32-bit operands only get the forms whose
+// bits agree (multiplies, shifts and masks by powers of two).
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_strength.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "utils.h"
+#include "intern.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+// One signed digit of a constant: sign * 2^shift
+typedef struct {
+    int shift;
+    int negative;
+} StrengthTerm;
+
+// How an expression is lowered
+typedef struct {
+    InternId operator_id;      // *, / or %
+    ASTNode *operand;          // The non-constant operand
+    int64_t constant;
+    int is_unsigned;           // operand reads an unsigned 32-bit signal
+    StrengthTerm terms[STRENGTH_MAX_TERMS];   // Multiplies only
+    int term_count;
+} StrengthForm;
+
+// -------------------------------------------------------------
+// Helper: an int literal as the parser stores it ("42", "-42")
+// -------------------------------------------------------------
+static int strength_literal(const ASTNode *node, int64_t *value)
+{
+    const char *digits = NULL;
+    char *end = NULL;
+    long long parsed = 0;
+
+    if (node == NULL || node->type != NODE_EXPRESSION || node->value == NULL)
+    {
+        return 0;
+    }
+    digits = (node->value[0] == '-') ? node->value + 1 : node->value;
+    if (!isdigit((unsigned char)digits[0]))
+    {
+        return 0;
+    }
+    parsed = strtoll(node->value, &end, 10);
+    if (*end != '\0' || parsed > INT32_MAX || parsed < INT32_MIN)
+    {
+        return 0;
+    }
+    *value = parsed;
+    return 1;
+}
+
+// Helper: k if value is 2^k (value > 0), otherwise -1
+static int strength_log2(int64_t value)
+{
+    int shift = 0;
+
+    if (value <= 0 || (value & (value - 1)) != 0)
+    {
+        return -1;
+    }
+    while (((int64_t)1 << shift) != value)
+    {
+        ++shift;
+    }
+    return shift;
+}
+
+// -------------------------------------------------------------
+// Helper: whether the sequences may read operand (possibly several times):
+// no calls, no booleans, nothing wider than 32 bits. Sets *is_unsigned when
+// it reads an unsigned 32-bit signal (C then computes unsigned); narrower
+// unsigned signals are zero-extended and read as non-negative ints.
+// -------------------------------------------------------------
+static int strength_operand_ok(const ASTNode *function, const ASTNode *node, int *is_unsigned)
+{
+    const ASTNode *declaration = NULL;
+    const char *name = NULL;
+    int is_signed = 1;
+    int width = 0;
+
+    if (node == NULL || node->type == NODE_FUNC_CALL || is_node_boolean_expression((ASTNode*)node))
+    {
+        return 0;
+    }
+    if (node->type == NODE_EXPRESSION && (is_numeric_literal(node->value) || is_negative_numeric_literal(node->value)))
+    {
+        return 0; // Constant operands are folded, or real
+    }
+    if (node->type == NODE_EXPRESSION && node->value != NULL && node->num_children == 0)
+    {
+        name = (node->value[0] == '-') ? node->value + 1 : node->value;
+    }
+    else if (node->type == NODE_INDEX_EXPR && node->num_children == 2)
+    {
+        name = node->children[FIRST_CHILD_INDEX]->value;
+    }
+    if (name != NULL && function != NULL && (declaration = find_declaration(function, name)) != NULL)
+    {
+        width = ctype_explicit_width(token_text(declaration->token), &is_signed);
+    }
+    if (width > VHDL_BIT_WIDTH)
+    {
+        return 0;
+    }
+    if (width == VHDL_BIT_WIDTH && !is_signed)
+    {
+        *is_unsigned = 1;
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        // Array names and struct bases are checked by their parents
+        if ((node->type == NODE_INDEX_EXPR || node->type == NODE_MEMBER_EXPR) && child_index == FIRST_CHILD_INDEX)
+        {
+            continue;
+        }
+        if (!strength_operand_ok(function, node->children[child_index], is_unsigned))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Helper: a name, element or field: repeating it repeats no logic
+static int is_strength_leaf(const ASTNode *node)
+{
+    return node->type == NODE_EXPRESSION || node->type == NODE_INDEX_EXPR || node->type == NODE_MEMBER_EXPR;
+}
+
+// Canonical signed digits of magnitude, most significant first; 0 if there
+// are more than STRENGTH_MAX_TERMS
+static int strength_digits(uint64_t magnitude, StrengthTerm *terms)
+{
+    StrengthTerm reversed[64];
+    int count = 0;
+
+    for (int shift = 0; magnitude != 0; ++shift, magnitude >>= 1)
+    {
+        if ((magnitude & 1) == 0)
+        {
+            continue;
+        }
+        // ...11 -> +100 - 1: a run of ones costs two digits
+        reversed[count].shift = shift;
+        reversed[count].negative = (magnitude & 3) == 3;
+        if (reversed[count].negative)
+        {
+            ++magnitude;
+        }
+        else
+        {
+            --magnitude;
+        }
+        ++count;
+    }
+    if (count > STRENGTH_MAX_TERMS)
+    {
+        return 0;
+    }
+    for (int term_index = 0; term_index < count; ++term_index)
+    {
+        terms[term_index] = reversed[count - 1 - term_index];
+    }
+    return count;
+}
+
+// -------------------------------------------------------------
+// Plan: which form, if any, lowers node
+// -------------------------------------------------------------
+static int strength_plan(const ASTNode *node, StrengthForm *form)
+{
+    const CodegenOptions *options = codegen_current_options();
+    const ASTNode *function = node;
+    ASTNode *left = NULL;
+    ASTNode *right = NULL;
+    int64_t magnitude = 0;
+    int is_power_of_two = 0;
+
+    memset(form, 0, sizeof(*form));
+    if (!options->strength_reduce || node->type != NODE_BINARY_EXPR || node->value == NULL ||
+        node->num_children != 2)
+    {
+        return 0;
+    }
+    form->operator_id = node->token.id;
+    if (form->operator_id != INTERN_OP_MULTIPLY && form->operator_id != INTERN_OP_DIVIDE &&
+        form->operator_id != INTERN_OP_MODULO)
+    {
+        return 0;
+    }
+
+    left = node->children[FIRST_CHILD_INDEX];
+    right = node->children[FIRST_CHILD_INDEX + 1];
+    if (strength_literal(right, &form->constant) && !strength_literal(left, &magnitude))
+    {
+        form->operand = left;
+    }
+    else if (form->operator_id == INTERN_OP_MULTIPLY && strength_literal(left, &form->constant) &&
+             !strength_literal(right, &magnitude))
+    {
+        form->operand = right;
+    }
+    else
+    {
+        return 0;
+    }
+    while (function != NULL && function->type != NODE_FUNCTION_DECL)
+    {
+        function = function->parent;
+    }
+    if (!strength_operand_ok(function, form->operand, &form->is_unsigned))
+    {
+        return 0;
+    }
+
+    magnitude = (form->constant < 0) ? -form->constant : form->constant;
+    is_power_of_two = strength_log2(magnitude) >= 0;
+    if (magnitude == 0)
+    {
+        return 0; // Division by zero is left to C
+    }
+
+    if (form->operator_id == INTERN_OP_MULTIPLY)
+    {
+        form->term_count = strength_digits((uint64_t)magnitude, form->terms);
+        // Every digit past the first repeats the operand
+        return form->term_count == 1 || (form->term_count > 1 && is_strength_leaf(form->operand));
+    }
+    if (form->is_unsigned)
+    {
+        // An unsigned quotient of a negative divisor is no shift
+        return is_power_of_two && form->constant > 0;
+    }
+    return 1;
+}
+
+int strength_reducible(const ASTNode *node)
+{
+    StrengthForm form;
+    return strength_plan(node, &form);
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+static void emit_signed_operand(ASTNode *operand, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    out_puts(out, "signed(");
+    node_generator(operand, out);
+    out_putc(out, ')');
+}
+
+static void emit_shifted_term(ASTNode *operand, int shift, OutputBuffer *out,
+                              void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    if (shift == 0)
+    {
+        emit_signed_operand(operand, out, node_generator);
+        return;
+    }
+    out_puts(out, "shift_left(");
+    emit_signed_operand(operand, out, node_generator);
+    out_printf(out, ", %d)", shift);
+}
+
+// Shifted adds: positive digits first, so only an all-negative sum starts with a minus
+static void emit_shift_add(const StrengthForm *form, OutputBuffer *out,
+                           void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    int flip = form->constant < 0;
+    int emitted = 0;
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (int term_index = 0; term_index < form->term_count; ++term_index)
+        {
+            int negative = form->terms[term_index].negative != flip;
+
+            if (negative != (pass == 1))
+            {
+                continue;
+            }
+            if (emitted)
+            {
+                out_puts(out, negative ? " - " : " + ");
+            }
+            else if (negative)
+            {
+                out_putc(out, '-');
+            }
+            emit_shifted_term(form->operand, form->terms[term_index].shift, out, node_generator);
+            ++emitted;
+        }
+    }
+}
+
+// Helper: M and s with x / divisor = ((x * M) >> (32 + s)) for 32-bit x,
+// divisor >= 3 and no power of two (Hacker's Delight, 10-1)
+static void strength_magic(uint32_t divisor, int32_t *multiplier, int *shift)
+{
+    const uint32_t two31 = 0x80000000u;
+    uint32_t anc = two31 - 1 - two31 % divisor;
+    uint32_t q1 = two31 / anc;
+    uint32_t r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / divisor;
+    uint32_t r2 = two31 - q2 * divisor;
+    uint32_t delta = 0;
+    int precision = 31;
+
+    do
+    {
+        ++precision;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc)
+        {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= divisor)
+        {
+            ++q2;
+            r2 -= divisor;
+        }
+        delta = divisor - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    *multiplier = (int32_t)(q2 + 1);
+    *shift = precision - VHDL_BIT_WIDTH;
+}
+
+// Signed quotient of the operand by magnitude (>= 2), truncated towards zero
+static void emit_signed_quotient(const StrengthForm *form, int64_t magnitude, OutputBuffer *out,
+                                 void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    int shift = strength_log2(magnitude);
+    int32_t multiplier = 0;
+
+    if (shift > 0)
+    {
+        // Negative dividends are biased by 2^k - 1: the sign replicated, shifted down
+        out_puts(out, "shift_right(");
+        emit_signed_operand(form->operand, out, node_generator);
+        out_puts(out, " + signed(shift_right(unsigned(shift_right(");
+        emit_signed_operand(form->operand, out, node_generator);
+        out_printf(out, ", %d)), %d)), %d)", VHDL_BIT_WIDTH - 1, VHDL_BIT_WIDTH - shift, shift);
+        return;
+    }
+
+    strength_magic((uint32_t)magnitude, &multiplier, &shift);
+    if (shift > 0)
+    {
+        out_puts(out, "shift_right(");
+    }
+    out_puts(out, "resize(shift_right(");
+    emit_signed_operand(form->operand, out, node_generator);
+    out_printf(out, " * to_signed(%ld, %d), %d), %d)", (long)multiplier, VHDL_BIT_WIDTH,
+               VHDL_BIT_WIDTH, VHDL_BIT_WIDTH);
+    if (multiplier < 0)
+    {
+        // M above 2^31 is read back negative: add the x * 2^32 it lost
+        out_puts(out, " + ");
+        emit_signed_operand(form->operand, out, node_generator);
+    }
+    if (shift > 0)
+    {
+        out_printf(out, ", %d)", shift);
+    }
+    // Round negative quotients up to zero
+    out_puts(out, " + signed(shift_right(unsigned(");
+    node_generator(form->operand, out);
+    out_printf(out, "), %d))", VHDL_BIT_WIDTH - 1);
+}
+
+static void emit_unsigned_power_of_two(const StrengthForm *form, OutputBuffer *out,
+                                       void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    int shift = strength_log2(form->constant);
+
+    if (form->operator_id == INTERN_OP_DIVIDE)
+    {
+        out_puts(out, "shift_right(unsigned(");
+        node_generator(form->operand, out);
+        out_printf(out, "), %d)", shift);
+        return;
+    }
+    out_puts(out, "unsigned(");
+    node_generator(form->operand, out);
+    out_printf(out, ") and to_unsigned(%lld, %d)", (long long)(form->constant - 1), VHDL_BIT_WIDTH);
+}
+
+int strength_generate_expression(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    StrengthForm form;
+    int64_t magnitude = 0;
+
+    if (!strength_plan(node, &form))
+    {
+        return 0;
+    }
+    magnitude = (form.constant < 0) ? -form.constant : form.constant;
+
+    out_puts(out, "std_logic_vector(");
+    if (magnitude == 1 && form.operator_id == INTERN_OP_DIVIDE)
+    {
+        // x / -1 wraps INT_MIN to itself, as the negation does
+        out_puts(out, form.constant < 0 ? "-" : "");
+        emit_signed_operand(form.operand, out, node_generator);
+    }
+    else if (magnitude == 1 && form.operator_id == INTERN_OP_MODULO)
+    {
+        out_printf(out, "to_signed(0, %d)", VHDL_BIT_WIDTH);
+    }
+    else if (form.operator_id == INTERN_OP_MULTIPLY)
+    {
+        emit_shift_add(&form, out, node_generator);
+    }
+    else if (form.is_unsigned)
+    {
+        emit_unsigned_power_of_two(&form, out, node_generator);
+    }
+    else if (form.operator_id == INTERN_OP_DIVIDE)
+    {
+        // x / -d = -(x / d) under truncation
+        out_puts(out, form.constant < 0 ? "-(" : "");
+        emit_signed_quotient(&form, magnitude, out, node_generator);
+        out_puts(out, form.constant < 0 ? ")" : "");
+    }
+    else
+    {
+        // x % -d = x % d: the remainder takes the sign of the dividend
+        emit_signed_operand(form.operand, out, node_generator);
+        out_puts(out, " - ");
+        if (strength_log2(magnitude) > 0)
+        {
+            out_puts(out, "shift_left(");
+            emit_signed_quotient(&form, magnitude, out, node_generator);
+            out_printf(out, ", %d)", strength_log2(magnitude));
+        }
+        else
+        {
+            out_puts(out, "resize((");
+            emit_signed_quotient(&form, magnitude, out, node_generator);
+            out_printf(out, ") * to_signed(%lld, %d), %d)", (long long)magnitude, VHDL_BIT_WIDTH, VHDL_BIT_WIDTH);
+        }
+    }
+    out_putc(out, ')');
+    return 1;
+}
@@ -0,0 +1,35 @@
+// VHDL Code Generator - Strength Reduction
+// -------------------------------------------------------------
+// Purpose: Lower multiplies, divides and remainders by integer constants
+//          to shifts, shift-add networks and multiply-by-reciprocal
+//          sequences instead of full multipliers and dividers
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_STRENGTH_H
+#define CODEGEN_VHDL_STRENGTH_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+
+// Shift-add networks of at most this many terms replace a multiplier
+#define STRENGTH_MAX_TERMS 3
+
+/**
+ * Whether strength_generate_expression would lower node (under the current
+ * options), so resource sharing leaves it out of its units
+ */
+int strength_reducible(const ASTNode *node);
+
+/**
+ * Emit x * c, x / c or x % c for an int constant c with C semantics
+ * (division truncates towards zero):
+ *   - c = +-2^k: a shift, with a rounding bias for negative dividends
+ *   - multiply by a constant of few signed digits: shifted adds and subtracts
+ *   - other divisors: the high word of a multiply by a magic reciprocal
+ *   - remainders: x - (x / c) * c over the lowered quotient
+ *
+ * @return 1 if emitted, 0 if the expression is left to the plain operator
+ */
+int strength_generate_expression(ASTNode *node, OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+#endif // CODEGEN_VHDL_STRENGTH_H
@@ -0,0 +1,568 @@
+// VHDL Code Generator - Self-Checking Testbenches
+// -------------------------------------------------------------
+// One testbench entity "<function>_tb" per function whose ports are all
+// scalar integers of at most 32 bits, plus a C program that includes the
+// original source, calls each function on pseudo-random inputs and writes
+// "<function>.vec" (one line per vector: the inputs, then the result).
+//
+// The testbench drives the entity through the handshake it was generated
+// with and counts clock cycles:
+//   start/done        one call at a time, latency = start to done
+//   valid_in/out      a new vector every cycle, results checked in order
+//   neither           inputs held until result shows the expected value
+//   combinational     one vector per clock period, latency 0
+// and reports "cosim <name>: vectors=V errors=E latency=L cycles=C", where
+// L is the worst latency and C the cycles all V vectors took (sustained
+// throughput V/C results per cycle).
+// -------------------------------------------------------------
+
+#include "codegen_vhdl.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_stream.h"
+#include "symbol_structs.h"
+#include "token.h"
+#include "utils.h"
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ports wider than VHDL's integer range are not driven from vector files
+#define TESTBENCH_MAX_PORT_WIDTH 32
+
+// Random inputs use at most this many bits, so loops bounded by a
+// parameter stay short and products stay inside int
+#define TESTBENCH_VALUE_BITS 12
+
+// Cycles to wait for one result before counting it as a mismatch
+#define TESTBENCH_MAX_CYCLES 10000
+
+// Width and signedness of an integer port
+typedef struct {
+    int width;
+    int is_signed;
+} TestbenchPort;
+
+// Handshake of the entity under test
+typedef enum {
+    TESTBENCH_COMBINATIONAL,
+    TESTBENCH_HELD,            // Clocked, no handshake ports
+    TESTBENCH_START_DONE,
+    TESTBENCH_VALID
+} TestbenchProtocol;
+
+// Helper: int, char, intN_t and uintN_t of at most 32 bits
+static int testbench_port(const ASTNode *node, TestbenchPort *port)
+{
+    InternId type_id = node->token.id;
+
+    port->is_signed = 1;
+    if (type_id == INTERN_KW_INT)
+    {
+        port->width = 32;
+    }
+    else if (type_id == INTERN_KW_CHAR)
+    {
+        port->width = 8;
+    }
+    else
+    {
+        port->width = ctype_explicit_width(intern_text(type_id), &port->is_signed);
+    }
+    return port->width > 0 && port->width <= TESTBENCH_MAX_PORT_WIDTH &&
+           find_struct_index_id(type_id) < 0;
+}
+
+// Helper: 32-bit ports hold any 32-bit pattern, so vectors carry them as
+// signed values (VHDL integers) whatever their C signedness
+static int port_as_signed(const TestbenchPort *port)
+{
+    return port->is_signed || port->width == TESTBENCH_MAX_PORT_WIDTH;
+}
+
+// Helper: 1 if every port of function can be driven from a vector file
+static int testbench_supported(ASTNode *function)
+{
+    TestbenchPort port;
+    StreamPlan stream;
+    int streamed = 0;
+
+    if (function->token.id == INTERN_NONE || function->token.id == INTERN_KW_VOID ||
+        !testbench_port(function, &port))
+    {
+        return 0;
+    }
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *parameter = function->children[child_index];
+
+        if (parameter->type == NODE_VAR_DECL &&
+            (parameter->array_size > 0 || !testbench_port(parameter, &port)))
+        {
+            return 0;
+        }
+    }
+    // Streamed loops take their arrays as element streams
+    streamed = stream_plan_function(function, &stream);
+    stream_plan_free(&stream);
+    return !streamed;
+}
+
+static TestbenchProtocol testbench_protocol(ASTNode *function)
+{
+    int has_start = 0;
+    int has_valid = 0;
+    int has_clock = 0;
+
+    function_handshake(function, &has_start, &has_valid, &has_clock);
+    if (!has_clock)
+    {
+        return TESTBENCH_COMBINATIONAL;
+    }
+    if (has_start)
+    {
+        return TESTBENCH_START_DONE;
+    }
+    return has_valid ? TESTBENCH_VALID : TESTBENCH_HELD;
+}
+
+// -------------------------------------------------------------
+// VHDL
+// -------------------------------------------------------------
+static void emit_bench_header(OutputBuffer *out)
+{
+    out_puts(out, "-- Testbenches generated by compi\n\n");
+}
+
+// Helper: "std_logic_vector(to_signed(<value>, W))" for one port
+static void emit_port_value(const TestbenchPort *port, const char *value, OutputBuffer *out)
+{
+    out_printf(out, "std_logic_vector(to_%s(%s, %d))", port_as_signed(port) ? "signed" : "unsigned",
+               value, port->width);
+}
+
+// Drive every parameter from vector row index
+static void emit_drive_inputs(ASTNode *function, const char *index, const char *indent, OutputBuffer *out)
+{
+    TestbenchPort port;
+    int input_index = 0;
+
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *parameter = function->children[child_index];
+        char value[64];
+
+        if (parameter->type != NODE_VAR_DECL)
+        {
+            continue;
+        }
+        testbench_port(parameter, &port);
+        snprintf(value, sizeof(value), "inputs(%s, %d)", index, input_index++);
+        out_printf(out, "%stb_%s <= ", indent, parameter->value);
+        emit_port_value(&port, value, out);
+        out_puts(out, ";\n");
+    }
+}
+
+// Compare result with the expected value of row index
+static void emit_check(const TestbenchPort *result, const char *index, const char *indent, OutputBuffer *out)
+{
+    char value[64];
+
+    snprintf(value, sizeof(value), "expected(%s)", index);
+    out_printf(out, "%sif tb_result /= ", indent);
+    emit_port_value(result, value, out);
+    out_puts(out, " then\n");
+    out_printf(out, "%s  errors := errors + 1;\n", indent);
+    out_printf(out, "%s  report \"vector \" & integer'image(%s) & \": result mismatch\" severity warning;\n",
+               indent, index);
+    out_printf(out, "%send if;\n", indent);
+}
+
+static void emit_run_combinational(ASTNode *function, const TestbenchPort *result, OutputBuffer *out)
+{
+    out_puts(out, "    for index in 0 to count - 1 loop\n");
+    emit_drive_inputs(function, "index", "      ", out);
+    out_puts(out, "      wait for CLOCK_PERIOD;\n");
+    emit_check(result, "index", "      ", out);
+    out_puts(out, "      cycles := cycles + 1;\n");
+    out_puts(out, "    end loop;\n");
+}
+
+static void emit_run_held(ASTNode *function, const TestbenchPort *result, OutputBuffer *out)
+{
+    char value[64];
+
+    snprintf(value, sizeof(value), "expected(index)");
+    out_puts(out, "    for index in 0 to count - 1 loop\n");
+    emit_drive_inputs(function, "index", "      ", out);
+    out_puts(out, "      waited := 0;\n");
+    out_puts(out, "      loop\n");
+    out_puts(out, "        wait until rising_edge(clk);\n");
+    out_puts(out, "        wait for SAMPLE_DELAY;\n");
+    out_puts(out, "        waited := waited + 1;\n");
+    out_puts(out, "        exit when tb_result = ");
+    emit_port_value(result, value, out);
+    out_puts(out, " or waited = MAX_CYCLES;\n");
+    out_puts(out, "      end loop;\n");
+    emit_check(result, "index", "      ", out);
+    out_puts(out, "      cycles := cycles + waited;\n");
+    out_puts(out, "      if waited > latency then\n");
+    out_puts(out, "        latency := waited;\n");
+    out_puts(out, "      end if;\n");
+    out_puts(out, "    end loop;\n");
+}
+
+static void emit_run_start_done(ASTNode *function, const TestbenchPort *result, OutputBuffer *out)
+{
+    out_puts(out, "    for index in 0 to count - 1 loop\n");
+    emit_drive_inputs(function, "index", "      ", out);
+    out_puts(out, "      tb_start <= '1';\n");
+    out_puts(out, "      wait until rising_edge(clk);\n");
+    out_puts(out, "      wait for SAMPLE_DELAY;\n");
+    out_puts(out, "      tb_start <= '0';\n");
+    out_puts(out, "      waited := 1;\n");
+    out_puts(out, "      while tb_done /= '1' and waited < MAX_CYCLES loop\n");
+    out_puts(out, "        wait until rising_edge(clk);\n");
+    out_puts(out, "        wait for SAMPLE_DELAY;\n");
+    out_puts(out, "        waited := waited + 1;\n");
+    out_puts(out, "      end loop;\n");
+    emit_check(result, "index", "      ", out);
+    out_puts(out, "      cycles := cycles + waited;\n");
+    out_puts(out, "      if waited > latency then\n");
+    out_puts(out, "        latency := waited;\n");
+    out_puts(out, "      end if;\n");
+    out_puts(out, "      -- Let done fall before the next call\n");
+    out_puts(out, "      wait until rising_edge(clk);\n");
+    out_puts(out, "      wait for SAMPLE_DELAY;\n");
+    out_puts(out, "      cycles := cycles + 1;\n");
+    out_puts(out, "    end loop;\n");
+}
+
+static void emit_run_valid(ASTNode *function, const TestbenchPort *result, OutputBuffer *out)
+{
+    out_puts(out, "    -- A new vector every cycle; results are checked as they come out\n");
+    out_puts(out, "    while received < count and cycles < count + MAX_CYCLES loop\n");
+    out_puts(out, "      if issued < count then\n");
+    emit_drive_inputs(function, "issued", "        ", out);
+    out_puts(out, "        tb_valid_in <= '1';\n");
+    out_puts(out, "        issued := issued + 1;\n");
+    out_puts(out, "      else\n");
+    out_puts(out, "        tb_valid_in <= '0';\n");
+    out_puts(out, "      end if;\n");
+    out_puts(out, "      wait until rising_edge(clk);\n");
+    out_puts(out, "      wait for SAMPLE_DELAY;\n");
+    out_puts(out, "      cycles := cycles + 1;\n");
+    out_puts(out, "      if tb_valid_out = '1' then\n");
+    out_puts(out, "        if received = 0 then\n");
+    out_puts(out, "          latency := cycles;\n");
+    out_puts(out, "        end if;\n");
+    emit_check(result, "received", "        ", out);
+    out_puts(out, "        received := received + 1;\n");
+    out_puts(out, "      end if;\n");
+    out_puts(out, "    end loop;\n");
+    out_puts(out, "    errors := errors + (count - received);\n");
+}
+
+static void emit_testbench(ASTNode *function, int vector_count, OutputBuffer *out)
+{
+    const char *name = (function->value != NULL) ? function->value : DEFAULT_FUNCTION_NAME;
+    TestbenchProtocol protocol = testbench_protocol(function);
+    TestbenchPort result;
+    TestbenchPort port;
+    int input_count = 0;
+
+    testbench_port(function, &result);
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        input_count += (function->children[child_index]->type == NODE_VAR_DECL);
+    }
+
+    out_printf(out, "-- Testbench: %s\n", name);
+    emit_vhdl_header(out);
+    out_puts(out, "use STD.TEXTIO.ALL;\n\n");
+    out_printf(out, "entity %s_tb is\nend entity;\n\n", name);
+    out_printf(out, "architecture sim of %s_tb is\n", name);
+    out_puts(out, "  constant CLOCK_PERIOD : time := 10 ns;\n");
+    out_puts(out, "  constant SAMPLE_DELAY : time := 1 ns;\n");
+    out_printf(out, "  constant MAX_CYCLES : natural := %d;\n", TESTBENCH_MAX_CYCLES);
+    out_printf(out, "  constant MAX_VECTORS : natural := %d;\n", vector_count);
+    out_printf(out, "  constant INPUT_COUNT : natural := %d;\n", input_count);
+    out_puts(out, "  type input_table is array (0 to MAX_VECTORS - 1, 0 to INPUT_COUNT) of integer;\n");
+    out_puts(out, "  type result_table is array (0 to MAX_VECTORS - 1) of integer;\n");
+    out_puts(out, "  signal clk : std_logic := '0';\n");
+    out_puts(out, "  signal reset : std_logic := '1';\n");
+    out_puts(out, "  signal finished : boolean := false;\n");
+    if (protocol == TESTBENCH_START_DONE)
+    {
+        out_puts(out, "  signal tb_start : std_logic := '0';\n");
+        out_puts(out, "  signal tb_done : std_logic;\n");
+    }
+    else if (protocol == TESTBENCH_VALID)
+    {
+        out_puts(out, "  signal tb_valid_in : std_logic := '0';\n");
+        out_puts(out, "  signal tb_valid_out : std_logic;\n");
+    }
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *parameter = function->children[child_index];
+
+        if (parameter->type == NODE_VAR_DECL)
+        {
+            testbench_port(parameter, &port);
+            out_printf(out, "  signal tb_%s : std_logic_vector(%d downto 0) := (others => '0');\n",
+                       parameter->value, port.width - 1);
+        }
+    }
+    out_printf(out, "  signal tb_result : std_logic_vector(%d downto 0);\n", result.width - 1);
+    out_puts(out, "begin\n");
+
+    // Device under test
+    out_printf(out, "  dut : entity work.%s\n", name);
+    out_puts(out, "    port map (\n");
+    if (protocol != TESTBENCH_COMBINATIONAL)
+    {
+        out_puts(out, "      clk => clk,\n");
+        out_puts(out, "      reset => reset,\n");
+    }
+    if (protocol == TESTBENCH_VALID)
+    {
+        out_puts(out, "      valid_in => tb_valid_in,\n");
+    }
+    else if (protocol == TESTBENCH_START_DONE)
+    {
+        out_puts(out, "      start => tb_start,\n");
+    }
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *parameter = function->children[child_index];
+
+        if (parameter->type == NODE_VAR_DECL)
+        {
+            out_printf(out, "      %s => tb_%s,\n", parameter->value, parameter->value);
+        }
+    }
+    if (protocol == TESTBENCH_VALID)
+    {
+        out_puts(out, "      valid_out => tb_valid_out,\n");
+    }
+    else if (protocol == TESTBENCH_START_DONE)
+    {
+        out_puts(out, "      done => tb_done,\n");
+    }
+    out_puts(out, "      result => tb_result\n");
+    out_puts(out, "    );\n\n");
+    out_puts(out, "  clk <= not clk after CLOCK_PERIOD / 2 when not finished;\n\n");
+
+    // Stimulus and checker
+    out_puts(out, "  stimulus : process\n");
+    out_printf(out, "    file vectors : text open read_mode is \"%s.vec\";\n", name);
+    out_puts(out, "    variable row : line;\n");
+    out_puts(out, "    variable inputs : input_table;\n");
+    out_puts(out, "    variable expected : result_table;\n");
+    out_puts(out, "    variable count : natural := 0;\n");
+    out_puts(out, "    variable errors : natural := 0;\n");
+    out_puts(out, "    variable latency : natural := 0;\n");
+    out_puts(out, "    variable cycles : natural := 0;\n");
+    out_puts(out, "    variable waited : natural := 0;\n");
+    out_puts(out, "    variable issued : natural := 0;\n");
+    out_puts(out, "    variable received : natural := 0;\n");
+    out_puts(out, "  begin\n");
+    out_puts(out, "    while not endfile(vectors) and count < MAX_VECTORS loop\n");
+    out_puts(out, "      readline(vectors, row);\n");
+    out_puts(out, "      for input in 0 to INPUT_COUNT - 1 loop\n");
+    out_puts(out, "        read(row, inputs(count, input));\n");
+    out_puts(out, "      end loop;\n");
+    out_puts(out, "      read(row, expected(count));\n");
+    out_puts(out, "      count := count + 1;\n");
+    out_puts(out, "    end loop;\n");
+    out_puts(out, "    wait for 2 * CLOCK_PERIOD;\n");
+    out_puts(out, "    reset <= '0';\n");
+    if (protocol != TESTBENCH_COMBINATIONAL)
+    {
+        out_puts(out, "    wait until rising_edge(clk);\n");
+        out_puts(out, "    wait for SAMPLE_DELAY;\n");
+    }
+
+    switch (protocol)
+    {
+        case TESTBENCH_COMBINATIONAL:
+            emit_run_combinational(function, &result, out);
+            break;
+        case TESTBENCH_HELD:
+            emit_run_held(function, &result, out);
+            break;
+        case TESTBENCH_START_DONE:
+            emit_run_start_done(function, &result, out);
+            break;
+        case TESTBENCH_VALID:
+            emit_run_valid(function, &result, out);
+            break;
+    }
+
+    out_printf(out, "    report \"cosim %s: vectors=\" & integer'image(count) &\n", name);
+    out_puts(out, "           \" errors=\" & integer'image(errors) &\n");
+    out_puts(out, "           \" latency=\" & integer'image(latency) &\n");
+    out_puts(out, "           \" cycles=\" & integer'image(cycles);\n");
+    out_printf(out, "    assert errors = 0 report \"%s: \" & integer'image(errors) & \" mismatches\" severity error;\n",
+               name);
+    out_puts(out, "    finished <= true;\n");
+    out_puts(out, "    wait;\n");
+    out_puts(out, "  end process;\n");
+    out_puts(out, "end architecture;\n\n");
+}
+
+// -------------------------------------------------------------
+// C vector program
+// -------------------------------------------------------------
+static void emit_vectors_prologue(const char *source_path, OutputBuffer *out)
+{
+    out_puts(out, "/* Test vectors generated by compi: run from the simulation directory */\n");
+    out_puts(out, "#include <stdio.h>\n");
+    out_puts(out, "#include <stdint.h>\n");
+    out_puts(out, "#include <setjmp.h>\n");
+    out_puts(out, "#include <signal.h>\n\n");
+    out_puts(out, "#define main compi_tb_user_main\n");
+    out_printf(out, "#include \"%s\"\n", source_path);
+    out_puts(out, "#undef main\n\n");
+    out_puts(out, "static sigjmp_buf compi_tb_trap;\n");
+    out_puts(out, "static uint32_t compi_tb_state = 12345u;\n\n");
+    out_puts(out, "/* An input that divides by zero is skipped */\n");
+    out_puts(out, "static void compi_tb_on_trap(int signal_number)\n{\n");
+    out_puts(out, "    (void)signal_number;\n");
+    out_puts(out, "    siglongjmp(compi_tb_trap, 1);\n}\n\n");
+    out_puts(out, "static long long compi_tb_random(int width, int is_signed)\n{\n");
+    out_printf(out, "    int bits = width < %d ? width : %d;\n", TESTBENCH_VALUE_BITS, TESTBENCH_VALUE_BITS);
+    out_puts(out, "    long long value = 0;\n\n");
+    out_puts(out, "    compi_tb_state = compi_tb_state * 1664525u + 1013904223u;\n");
+    out_puts(out, "    value = (long long)(compi_tb_state >> 8) & ((1LL << bits) - 1);\n");
+    out_puts(out, "    return is_signed ? value - (1LL << (bits - 1)) : value;\n}\n\n");
+    out_puts(out, "/* The port's bits as the integer the testbench converts back */\n");
+    out_puts(out, "static long long compi_tb_port(long long value, int width, int as_signed)\n{\n");
+    out_puts(out, "    unsigned long long mask = (1ULL << width) - 1;\n");
+    out_puts(out, "    unsigned long long bits = (unsigned long long)value & mask;\n\n");
+    out_puts(out, "    if (as_signed && ((bits >> (width - 1)) & 1)) {\n");
+    out_puts(out, "        return (long long)(bits | ~mask);\n");
+    out_puts(out, "    }\n");
+    out_puts(out, "    return (long long)bits;\n}\n\n");
+}
+
+static void emit_vectors_function(ASTNode *function, int vector_count, OutputBuffer *out)
+{
+    const char *name = (function->value != NULL) ? function->value : DEFAULT_FUNCTION_NAME;
+    TestbenchPort result;
+    TestbenchPort port;
+    int first = 1;
+
+    testbench_port(function, &result);
+    out_printf(out, "static void compi_tb_%s(void)\n{\n", name);
+    out_printf(out, "    FILE *compi_tb_file = fopen(\"%s.vec\", \"w\");\n", name);
+    out_puts(out, "    volatile int compi_tb_count = 0;\n");
+    out_puts(out, "    volatile int compi_tb_attempts = 0;\n\n");
+    out_puts(out, "    if (compi_tb_file == NULL) {\n");
+    out_printf(out, "        perror(\"%s.vec\");\n", name);
+    out_puts(out, "        return;\n");
+    out_puts(out, "    }\n");
+    out_printf(out, "    while (compi_tb_count < %d && compi_tb_attempts++ < %d) {\n", vector_count, vector_count * 4);
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *parameter = function->children[child_index];
+
+        if (parameter->type == NODE_VAR_DECL)
+        {
+            testbench_port(parameter, &port);
+            out_printf(out, "        %s %s = (%s)compi_tb_random(%d, %d);\n", token_text(parameter->token),
+                       parameter->value, token_text(parameter->token), port.width, port.is_signed);
+        }
+    }
+    out_puts(out, "        long long compi_tb_value = 0;\n\n");
+    out_puts(out, "        if (sigsetjmp(compi_tb_trap, 1) != 0) {\n");
+    out_puts(out, "            continue;\n");
+    out_puts(out, "        }\n");
+    out_printf(out, "        compi_tb_value = (long long)%s(", name);
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *parameter = function->children[child_index];
+
+        if (parameter->type == NODE_VAR_DECL)
+        {
+            out_printf(out, "%s%s", first ? "" : ", ", parameter->value);
+            first = 0;
+        }
+    }
+    out_puts(out, ");\n");
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *parameter = function->children[child_index];
+
+        if (parameter->type == NODE_VAR_DECL)
+        {
+            testbench_port(parameter, &port);
+            out_printf(out, "        fprintf(compi_tb_file, \"%%lld \", compi_tb_port(%s, %d, %d));\n",
+                       parameter->value, port.width, port_as_signed(&port));
+        }
+    }
+    out_printf(out, "        fprintf(compi_tb_file, \"%%lld\\n\", compi_tb_port(compi_tb_value, %d, %d));\n",
+               result.width, port_as_signed(&result));
+    out_puts(out, "        compi_tb_count++;\n");
+    out_puts(out, "    }\n");
+    out_puts(out, "    fclose(compi_tb_file);\n");
+    out_printf(out, "    printf(\"%s_tb\\n\");\n}\n\n", name);
+}
+
+int generate_testbench(ParserContext *ctx, ASTNode *root, const char *source_path, int vector_count,
+                       OutputBuffer *vhdl, OutputBuffer *vectors)
+{
+    ParserContext *previous = parser_context_activate(ctx);
+    char *supported = (char*)calloc((size_t)(root->num_children > 0 ? root->num_children : 1), 1);
+    int count = 0;
+
+    if (supported == NULL)
+    {
+        perror("Failed to allocate memory for testbenches");
+        exit(EXIT_FAILURE);
+    }
+
+    emit_bench_header(vhdl);
+    emit_vectors_prologue(source_path, vectors);
+    for (int child_index = 0; child_index < root->num_children; ++child_index)
+    {
+        ASTNode *function = root->children[child_index];
+
+        // The vector program renames main away to supply its own
+        if (function->type != NODE_FUNCTION_DECL ||
+            (function->value != NULL && strcmp(function->value, "main") == 0))
+        {
+            continue;
+        }
+        if (!testbench_supported(function))
+        {
+            out_printf(vhdl, "-- %s: no testbench (ports must be integers of at most %d bits)\n\n",
+                       function->value ? function->value : DEFAULT_FUNCTION_NAME, TESTBENCH_MAX_PORT_WIDTH);
+            continue;
+        }
+        supported[child_index] = 1;
+        emit_testbench(function, vector_count, vhdl);
+        emit_vectors_function(function, vector_count, vectors);
+        count++;
+    }
+
+    // main() prints the testbench entities, one per line, as it writes their vectors
+    out_puts(vectors, "int main(void)\n{\n");
+    out_puts(vectors, "    signal(SIGFPE, compi_tb_on_trap);\n");
+    for (int child_index = 0; child_index < root->num_children; ++child_index)
+    {
+        if (supported[child_index])
+        {
+            const char *name = root->children[child_index]->value;
+
+            out_printf(vectors, "    compi_tb_%s();\n", name ? name : DEFAULT_FUNCTION_NAME);
+        }
+    }
+    out_puts(vectors, "    return 0;\n}\n");
+
+    free(supported);
+    parser_context_activate(previous);
+    return count;
+}
@@ -3,6 +3,8 @@
 
 #include "codegen_vhdl_types.h"
 #include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_fixed.h"
 #include "symbol_structs.h"
 #include "utils.h"
 #include <string.h>
@@ -11,168 +13,131 @@
 // -------------------------------------------------------------
 // Emit all struct type declarations as VHDL records
 // -------------------------------------------------------------
-void emit_all_struct_declarations(FILE *output_file)
+void emit_all_struct_declarations(OutputBuffer *out)
+{
+    emit_struct_declarations_from(0, out);
+}
+
+void emit_struct_declarations_from(int first, OutputBuffer *out)
 {
     int struct_idx = 0;
     int field_index = 0;
     
-    for (struct_idx = 0; struct_idx < g_struct_count; ++struct_idx)
+    for (struct_idx = first; struct_idx < struct_count(); ++struct_idx)
     {
-        StructInfo *struct_info = &g_structs[struct_idx];
+        const StructInfo *struct_info = struct_info_at(struct_idx);
         
-        fprintf(output_file, "-- Struct %s as VHDL record\n", struct_info->name);
-        fprintf(output_file, "type %s_t is record\n", struct_info->name);
+        out_puts(out, "-- Struct ");
+        out_puts(out, struct_info->name);
+        out_puts(out, " as VHDL record\n");
+        out_puts(out, "type ");
+        out_puts(out, struct_info->name);
+        out_puts(out, "_t is record\n");
         
         for (field_index = 0; field_index < struct_info->field_count; ++field_index)
         {
-            fprintf(output_file, "  %s : %s;\n", 
+            out_printf(out, "  %s : %s;\n", 
                     struct_info->fields[field_index].field_name, 
                     ctype_to_vhdl(struct_info->fields[field_index].field_type));
         }
         
-        fprintf(output_file, "end record;\n\n");
+        out_puts(out, "end record;\n\n");
     }
 }
 
 // -------------------------------------------------------------
 // Helper: Emit struct type signal declaration
 // -------------------------------------------------------------
-void emit_struct_signal_declaration(ASTNode *var_decl, FILE *output_file)
+void emit_struct_signal_declaration(ASTNode *var_decl, OutputBuffer *out)
 {
-    fprintf(output_file, "  signal %s : %s_t;\n", 
-            var_decl->value, var_decl->token.value);
+    out_printf(out, "  signal %s : %s_t;\n", 
+            var_decl->value, token_text(var_decl->token));
 }
 
 // -------------------------------------------------------------
-// Helper: Parse array dimensions from variable name
+// Helper: Emit one initializer element as a literal of the element type
 // -------------------------------------------------------------
-int parse_array_dimensions(const char *var_name, char *array_name, 
-                          char *array_size, int name_buf_size, int size_buf_size)
+void emit_array_element_literal(const ASTNode *var_decl, const char *element_value, OutputBuffer *out)
 {
-    const char *left_bracket = NULL;
-    const char *size_start = NULL;
-    const char *size_end = NULL;
-    int name_length = 0;
-    int size_length = 0;
-    
-    if (var_name == NULL || array_name == NULL || array_size == NULL)
-    {
-        return 0;
-    }
-    
-    left_bracket = strchr(var_name, '[');
-    if (left_bracket == NULL)
+    int bit_width = ctype_explicit_width(token_text(var_decl->token), NULL);
+
+    if (var_decl->token.id == INTERN_KW_INT)
     {
-        return 0;
+        bit_width = VHDL_BIT_WIDTH;
     }
-    
-    name_length = (int)(left_bracket - var_name);
-    if (name_length >= name_buf_size)
+
+    if (bit_width > 0)
     {
-        return 0;
+        char bit_string[BITSTRING_BUFFER_SIZE] = {0};
+        long long numeric_value = atoll(element_value);
+        int bit_position = 0;
+
+        // Elements of a fixed-point array hold their scaled value
+        fixed_element_value(var_decl->value, element_value, &numeric_value);
+        
+        // Two's complement bits of the element width (wrapping like the C conversion)
+        for (bit_position = bit_width - 1; bit_position >= 0; --bit_position)
+        {
+            int bit_index = (bit_width - 1) - bit_position;
+            bit_string[bit_index] = (((unsigned long long)numeric_value >> bit_position) & 1) ? '1' : '0';
+        }
+        bit_string[bit_width] = '\0';
+        
+        out_putc(out, '\"');
+        out_puts(out, bit_string);
+        out_putc(out, '\"');
     }
-    
-    strncpy(array_name, var_name, name_length);
-    array_name[name_length] = '\0';
-    
-    size_start = left_bracket + 1;
-    size_end = strchr(size_start, ']');
-    
-    if (size_end == NULL || size_end <= size_start)
+    else if (var_decl->token.id == INTERN_KW_CHAR)
     {
-        return 0;
+        out_putc(out, '\'');
+        out_puts(out, element_value);
+        out_putc(out, '\'');
     }
-    
-    size_length = (int)(size_end - size_start);
-    if (size_length >= size_buf_size)
+    else
     {
-        return 0;
+        // float/double and anything else: the literal as written
+        out_puts(out, element_value);
     }
-    
-    strncpy(array_size, size_start, size_length);
-    array_size[size_length] = '\0';
-    
-    return 1;
 }
 
 // -------------------------------------------------------------
 // Helper: Emit array initializer constant
 // -------------------------------------------------------------
 void emit_array_initializer_constant(ASTNode *var_decl, ASTNode *init_list, 
-                                     const char *array_name, FILE *output_file)
+                                     const char *array_name, OutputBuffer *out)
 {
     int element_index = 0;
-    const char *element_value = NULL;
     
-    fprintf(output_file, "  -- Array initialization\n");
-    fprintf(output_file, "  constant %s_init : %s_type := (", array_name, array_name);
+    out_puts(out, "  -- Array initialization\n");
+    out_printf(out, "  constant %s_init : %s_type := (", array_name, array_name);
     
     for (element_index = 0; element_index < init_list->num_children; ++element_index)
     {
-        element_value = init_list->children[element_index]->value;
         int is_last_element = (element_index == init_list->num_children - 1);
-        const char *separator = is_last_element ? "" : ", ";
         
-        if (strcmp(var_decl->token.value, C_TYPE_INT) == 0)
-        {
-            char bit_string[BITSTRING_BUFFER_SIZE] = {0};
-            int numeric_value = atoi(element_value);
-            int bit_position = 0;
-            
-            for (bit_position = VHDL_BIT_WIDTH - 1; bit_position >= 0; --bit_position)
-            {
-                int bit_index = (VHDL_BIT_WIDTH - 1) - bit_position;
-                bit_string[bit_index] = ((numeric_value >> bit_position) & 1) ? '1' : '0';
-            }
-            bit_string[VHDL_BIT_WIDTH] = '\0';
-            
-            fprintf(output_file, "\"%s\"%s", bit_string, separator);
-        }
-        else if (strcmp(var_decl->token.value, C_TYPE_FLOAT) == 0 || 
-                 strcmp(var_decl->token.value, C_TYPE_DOUBLE) == 0)
-        {
-            fprintf(output_file, "%s%s", element_value, separator);
-        }
-        else if (strcmp(var_decl->token.value, C_TYPE_CHAR) == 0)
-        {
-            fprintf(output_file, "'%s'%s", element_value, separator);
-        }
-        else
-        {
-            fprintf(output_file, "%s%s", element_value, separator);
-        }
+        emit_array_element_literal(var_decl, init_list->children[element_index]->value, out);
+        out_puts(out, is_last_element ? "" : ", ");
     }
     
-    fprintf(output_file, ");\n");
-    fprintf(output_file, "  signal %s : %s_type := %s_init;\n", 
+    out_puts(out, ");\n");
+    out_printf(out, "  signal %s : %s_type := %s_init;\n", 
             array_name, array_name, array_name);
 }
 
 // -------------------------------------------------------------
 // Helper: Emit array signal declaration
 // -------------------------------------------------------------
-void emit_array_signal_declaration(ASTNode *var_decl, FILE *output_file)
+void emit_array_signal_declaration(ASTNode *var_decl, OutputBuffer *out)
 {
-    char array_name[ARRAY_NAME_BUFFER_SIZE] = {0};
-    char array_size[ARRAY_SIZE_BUFFER_SIZE] = {0};
-    int array_element_count = 0;
-    const char *vhdl_element_type = NULL;
+    const char *array_name = var_decl->value;
     int has_initializer = 0;
     ASTNode *initializer_list = NULL;
     
-    if (!parse_array_dimensions(var_decl->value, array_name, array_size, 
-                                ARRAY_NAME_BUFFER_SIZE, ARRAY_SIZE_BUFFER_SIZE))
+    if (array_name == NULL || var_decl->array_size <= 0)
     {
         return;
     }
     
-    array_element_count = atoi(array_size) - 1;
-    vhdl_element_type = ctype_to_vhdl(var_decl->token.value);
-    
-    fprintf(output_file, "  type %s_type is array (0 to %d) of %s;\n", 
-            array_name, array_element_count, vhdl_element_type);
-    fprintf(output_file, "  signal %s : %s_type;\n", array_name, array_name);
-    
     // Check for array initializer
     has_initializer = (var_decl->num_children > 0 && 
                       var_decl->children[FIRST_CHILD_INDEX]->value != NULL &&
@@ -180,73 +145,79 @@ void emit_array_signal_declaration(ASTNode *var_decl, FILE *output_file)
     
     if (has_initializer)
     {
+        // The initialized signal is declared after its constant
+        out_printf(out, "  type %s_type is array (0 to %d) of %s;\n", array_name,
+                   var_decl->array_size - 1, ctype_to_vhdl(token_text(var_decl->token)));
         initializer_list = var_decl->children[FIRST_CHILD_INDEX];
-        emit_array_initializer_constant(var_decl, initializer_list, array_name, output_file);
+        emit_array_initializer_constant(var_decl, initializer_list, array_name, out);
+    }
+    else
+    {
+        emit_array_type_and_signal(array_name, ctype_to_vhdl(token_text(var_decl->token)),
+                                   var_decl->array_size, out);
     }
 }
 
 // -------------------------------------------------------------
 // Helper: Emit simple (non-array, non-struct) signal declaration
 // -------------------------------------------------------------
-void emit_simple_signal_declaration(ASTNode *var_decl, FILE *output_file)
+void emit_simple_signal_declaration(ASTNode *var_decl, OutputBuffer *out)
 {
     int is_result_variable = (strcmp(var_decl->value, RESERVED_PORT_NAME_RESULT) == 0);
     
     if (is_result_variable)
     {
-        fprintf(output_file, "  signal ");
-        fprintf(output_file, "%s%s", var_decl->value, SIGNAL_SUFFIX_LOCAL);
-        fprintf(output_file, " : %s;\n", ctype_to_vhdl(var_decl->token.value));
+        out_puts(out, "  signal ");
+        out_puts(out, var_decl->value);
+        out_puts(out, SIGNAL_SUFFIX_LOCAL);
+        out_puts(out, " : ");
+        out_puts(out, ctype_to_vhdl(token_text(var_decl->token)));
+        out_puts(out, ";\n");
     }
     else
     {
-        fprintf(output_file, "  signal %s : %s;\n", 
-                var_decl->value, ctype_to_vhdl(var_decl->token.value));
+        out_printf(out, "  signal %s : %s;\n", 
+                var_decl->value, ctype_to_vhdl(token_text(var_decl->token)));
     }
 }
 
 // -------------------------------------------------------------
 // Helper: Process a single variable declaration for signal emission
 // -------------------------------------------------------------
-void process_variable_declaration_for_signals(ASTNode *var_decl, FILE *output_file)
+void process_variable_declaration_for_signals(ASTNode *var_decl, OutputBuffer *out)
 {
     int struct_index = 0;
-    char *array_bracket = NULL;
     int is_struct_type = 0;
     int is_array_type = 0;
     
-    struct_index = find_struct_index(var_decl->token.value);
+    struct_index = find_struct_index_id(var_decl->token.id);
     is_struct_type = (struct_index >= 0);
     
     if (is_struct_type)
     {
-        emit_struct_signal_declaration(var_decl, output_file);
+        emit_struct_signal_declaration(var_decl, out);
         return;
     }
     
-    array_bracket = (var_decl->value != NULL) ? strchr(var_decl->value, '[') : NULL;
-    is_array_type = (array_bracket != NULL);
+    is_array_type = (var_decl->array_size > 0);
     
     if (is_array_type)
     {
-        emit_array_signal_declaration(var_decl, output_file);
+        emit_array_signal_declaration(var_decl, out);
     }
     else
     {
-        emit_simple_signal_declaration(var_decl, output_file);
+        emit_simple_signal_declaration(var_decl, out);
     }
 }
 
 // -------------------------------------------------------------
 // Helper: Process variable declarations inside for loops
 // -------------------------------------------------------------
-void process_for_loop_declarations(ASTNode *for_statement, FILE *output_file)
+void process_for_loop_declarations(ASTNode *for_statement, OutputBuffer *out)
 {
     int child_index = 0;
     ASTNode *for_child = NULL;
-    char *array_bracket = NULL;
-    char array_name[ARRAY_NAME_BUFFER_SIZE] = {0};
-    char array_size[ARRAY_SIZE_BUFFER_SIZE] = {0};
     
     for (child_index = 0; child_index < for_statement->num_children; ++child_index)
     {
@@ -257,25 +228,15 @@ void process_for_loop_declarations(ASTNode *for_statement, FILE *output_file)
             continue;
         }
         
-        array_bracket = (for_child->value != NULL) ? strchr(for_child->value, '[') : NULL;
-        
-        if (array_bracket != NULL)
+        if (for_child->array_size > 0)
         {
-            if (parse_array_dimensions(for_child->value, array_name, array_size,
-                                      ARRAY_NAME_BUFFER_SIZE, ARRAY_SIZE_BUFFER_SIZE))
-            {
-                int array_element_count = atoi(array_size) - 1;
-                const char *vhdl_element_type = ctype_to_vhdl(for_child->token.value);
-                
-                fprintf(output_file, "  type %s_type is array (0 to %d) of %s;\n", 
-                        array_name, array_element_count, vhdl_element_type);
-                fprintf(output_file, "  signal %s : %s_type;\n", array_name, array_name);
-            }
+            emit_array_type_and_signal(for_child->value, ctype_to_vhdl(token_text(for_child->token)),
+                                       for_child->array_size, out);
         }
         else
         {
-            fprintf(output_file, "  signal %s : %s;\n", 
-                    for_child->value, ctype_to_vhdl(for_child->token.value));
+            out_printf(out, "  signal %s : %s;\n", 
+                    for_child->value, ctype_to_vhdl(token_text(for_child->token)));
         }
     }
 }
@@ -283,7 +244,9 @@ void process_for_loop_declarations(ASTNode *for_statement, FILE *output_file)
 // -------------------------------------------------------------
 // Emit local signal declarations for a function
 // -------------------------------------------------------------
-void emit_function_local_signals(ASTNode *function_declaration, FILE *output_file)
+void emit_function_local_signals(ASTNode *function_declaration,
+                                 int (*declared_elsewhere)(const void*, const ASTNode*),
+                                 const void *context, OutputBuffer *out)
 {
     int child_index = 0;
     int statement_child_index = 0;
@@ -309,11 +272,15 @@ void emit_function_local_signals(ASTNode *function_declaration, FILE *output_fil
             
             if (statement_child->type == NODE_VAR_DECL)
             {
-                process_variable_declaration_for_signals(statement_child, output_file);
+                if (declared_elsewhere != NULL && declared_elsewhere(context, statement_child))
+                {
+                    continue;
+                }
+                process_variable_declaration_for_signals(statement_child, out);
             }
             else if (statement_child->type == NODE_FOR_STATEMENT)
             {
-                process_for_loop_declarations(statement_child, output_file);
+                process_for_loop_declarations(statement_child, out);
             }
         }
     }
@@ -6,34 +6,38 @@
 #ifndef CODEGEN_VHDL_TYPES_H
 #define CODEGEN_VHDL_TYPES_H
 
-#include <stdio.h>
+#include "output_buffer.h"
 #include "astnode.h"
 
 // -------------------------------------------------------------
 // Struct type declarations
 // -------------------------------------------------------------
-void emit_all_struct_declarations(FILE *output_file);
+void emit_all_struct_declarations(OutputBuffer *out);
+// Records of the structs registered from index first on (streaming output)
+void emit_struct_declarations_from(int first, OutputBuffer *out);
 
 // -------------------------------------------------------------
 // Signal declarations
 // -------------------------------------------------------------
-void emit_function_local_signals(ASTNode *function_declaration, FILE *output_file);
-void emit_struct_signal_declaration(ASTNode *var_decl, FILE *output_file);
-void emit_array_signal_declaration(ASTNode *var_decl, FILE *output_file);
-void emit_simple_signal_declaration(ASTNode *var_decl, FILE *output_file);
+// declared_elsewhere (may be NULL) claims declarations another module emits
+void emit_function_local_signals(ASTNode *function_declaration,
+                                 int (*declared_elsewhere)(const void*, const ASTNode*),
+                                 const void *context, OutputBuffer *out);
+void emit_struct_signal_declaration(ASTNode *var_decl, OutputBuffer *out);
+void emit_array_signal_declaration(ASTNode *var_decl, OutputBuffer *out);
+void emit_simple_signal_declaration(ASTNode *var_decl, OutputBuffer *out);
 
 // -------------------------------------------------------------
 // Array helpers
 // -------------------------------------------------------------
-int parse_array_dimensions(const char *var_name, char *array_name, 
-                          char *array_size, int name_buf_size, int size_buf_size);
 void emit_array_initializer_constant(ASTNode *var_decl, ASTNode *init_list, 
-                                     const char *array_name, FILE *output_file);
+                                     const char *array_name, OutputBuffer *out);
+void emit_array_element_literal(const ASTNode *var_decl, const char *element_value, OutputBuffer *out);
 
 // -------------------------------------------------------------
 // Declaration processing
 // -------------------------------------------------------------
-void process_variable_declaration_for_signals(ASTNode *var_decl, FILE *output_file);
-void process_for_loop_declarations(ASTNode *for_statement, FILE *output_file);
+void process_variable_declaration_for_signals(ASTNode *var_decl, OutputBuffer *out);
+void process_for_loop_declarations(ASTNode *for_statement, OutputBuffer *out);
 
 #endif // CODEGEN_VHDL_TYPES_H
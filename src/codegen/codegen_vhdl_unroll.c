@@ -0,0 +1,1161 @@
+// VHDL Code Generator - Loop Unrolling Implementation
+// -------------------------------------------------------------
+// A while loop inside a clocked process has no static bound, which most
+// synthesis tools reject. When start, bound and step of a for loop are
+// literals the iterations are known, so the loop is emitted as either
+//   - flattened iterations with the loop variable replaced by its value
+//     (full unrolling: every iteration in one clock cycle), or
+//   - a bounded VHDL for loop over trip_count / factor blocks whose body
+//     holds factor copies, plus the remaining iterations flattened.
+// Flattened copies are built as scratch trees with the loop variable
+// replaced by its value and folded, and chain through the scalars they
+// assign. In a bounded loop the loop variable is replaced by swapping its
+// identifier nodes for one scratch node whose text changes per copy; the
+// tree is restored after.
+// State machine functions are expanded in the tree instead: the copies are
+// spliced into the enclosing statement list before scheduling, so block RAM
+// banking and the list scheduler see constant indices and separate locals.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_unroll.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "intern.h"
+#include "optimize.h"
+#include "symbol_structs.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+
+#define UNROLL_NUMBER_SIZE 24             // Any int64_t in decimal, sign and NUL
+#define MAX_TRIP_COUNT (1 << 24)          // Larger loops stay while loops
+#define MAX_FLATTENED_ITERATIONS 1024     // Cap on copies of the body
+#define MAX_FORWARDED_NODES (1 << 16)     // Larger chained values keep the loop rolled
+
+// Identifier node of the loop variable, replaced while the body is emitted
+typedef struct {
+    ASTNode *parent;
+    int child_index;
+    ASTNode *original;
+} UnrollSwap;
+
+typedef struct {
+    UnrollSwap *swaps;
+    int count;
+    int capacity;
+} UnrollSwapList;
+
+// -------------------------------------------------------------
+// Helper: int literal, optionally negated by a unary minus
+// -------------------------------------------------------------
+static int unroll_literal(const ASTNode *node, int64_t *value)
+{
+    const char *text = NULL;
+    char *end = NULL;
+    long long parsed = 0;
+
+    if (node == NULL)
+    {
+        return 0;
+    }
+    if (node->type == NODE_UNARY_EXPR && node->token.id == INTERN_OP_MINUS &&
+        node->num_children == 1 && unroll_literal(node->children[FIRST_CHILD_INDEX], value))
+    {
+        *value = -*value;
+        return 1;
+    }
+    if (node->type != NODE_EXPRESSION || node->value == NULL)
+    {
+        return 0;
+    }
+
+    text = node->value;
+    if (!isdigit((unsigned char)text[(text[0] == '-') ? 1 : 0]))
+    {
+        return 0;
+    }
+    parsed = strtoll(text, &end, 10);
+    if (*end != '\0' || parsed > INT32_MAX || parsed < INT32_MIN)
+    {
+        return 0;
+    }
+    *value = parsed;
+    return 1;
+}
+
+static int is_loop_variable(const ASTNode *node, const char *variable)
+{
+    return node != NULL && node->type == NODE_EXPRESSION && node->value != NULL &&
+           strcmp(node->value, variable) == 0;
+}
+
+// -------------------------------------------------------------
+// Helper: 1 if the body writes the variable or leaves this loop early
+// -------------------------------------------------------------
+static int body_prevents_unrolling(const ASTNode *node, const char *variable, int nested_loop)
+{
+    if (node == NULL)
+    {
+        return 0;
+    }
+
+    switch (node->type)
+    {
+        case NODE_BREAK_STATEMENT:
+        case NODE_CONTINUE_STATEMENT:
+            return !nested_loop;
+
+        case NODE_WHILE_STATEMENT:
+        case NODE_FOR_STATEMENT:
+            nested_loop = 1;
+            break;
+
+        case NODE_ASSIGNMENT:
+            if (node->num_children > 0 && is_loop_variable(node->children[FIRST_CHILD_INDEX], variable))
+            {
+                return 1;
+            }
+            break;
+
+        case NODE_VAR_DECL:
+            if (node->value != NULL && strcmp(node->value, variable) == 0)
+            {
+                return 1;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (body_prevents_unrolling(node->children[child_index], variable, nested_loop))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------
+// Helper: iterations of "var <op> bound" starting at start
+// -------------------------------------------------------------
+static int count_iterations(InternId operator_id, int64_t start, int64_t bound, int64_t step, int64_t *trip_count)
+{
+    int64_t distance = 0;
+
+    switch (operator_id)
+    {
+        case INTERN_OP_LESS_EQUAL:
+            bound += 1;
+            /* fall through */
+        case INTERN_OP_LESS:
+            if (start >= bound)
+            {
+                *trip_count = 0;
+                return 1;
+            }
+            if (step < 0)
+            {
+                return 0; // Counts away from the bound
+            }
+            *trip_count = (bound - start + step - 1) / step;
+            return 1;
+
+        case INTERN_OP_GREATER_EQUAL:
+            bound -= 1;
+            /* fall through */
+        case INTERN_OP_GREATER:
+            if (start <= bound)
+            {
+                *trip_count = 0;
+                return 1;
+            }
+            if (step > 0)
+            {
+                return 0;
+            }
+            *trip_count = (start - bound - step - 1) / -step;
+            return 1;
+
+        case INTERN_OP_NOT_EQUAL:
+            distance = bound - start;
+            if (distance % step != 0 || distance / step < 0)
+            {
+                return 0; // Steps over the bound
+            }
+            *trip_count = distance / step;
+            return 1;
+
+        case INTERN_OP_EQUAL:
+            *trip_count = (start == bound) ? 1 : 0;
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+// -------------------------------------------------------------
+// Trip count analysis
+// -------------------------------------------------------------
+int analyze_for_loop(ASTNode *for_node, LoopBounds *bounds)
+{
+    ASTNode *init = NULL;
+    ASTNode *condition = NULL;
+    ASTNode *increment = NULL;
+    ASTNode *update = NULL;
+    int64_t bound = 0;
+    int increment_index = for_node->num_children - 1;
+
+    memset(bounds, 0, sizeof(*bounds));
+    if (for_node->num_children < 3)
+    {
+        return 0;
+    }
+
+    // var = start
+    init = for_node->children[FIRST_CHILD_INDEX];
+    if (init->type == NODE_VAR_DECL && init->array_size == 0 &&
+        (init->token.id == INTERN_KW_INT || ctype_explicit_width(token_text(init->token), NULL) > 0) &&
+        init->num_children == 1 && unroll_literal(init->children[FIRST_CHILD_INDEX], &bounds->start))
+    {
+        bounds->variable = init->value;
+        bounds->declared_in_loop = 1;
+    }
+    else if (init->type == NODE_ASSIGNMENT && init->num_children == 2 &&
+             init->children[FIRST_CHILD_INDEX]->type == NODE_EXPRESSION &&
+             unroll_literal(init->children[FIRST_CHILD_INDEX + 1], &bounds->start))
+    {
+        bounds->variable = init->children[FIRST_CHILD_INDEX]->value;
+    }
+    if (bounds->variable == NULL)
+    {
+        return 0;
+    }
+
+    // var <op> bound
+    condition = for_node->children[FIRST_STATEMENT_INDEX];
+    if (condition->type != NODE_BINARY_EXPR || condition->num_children != 2 || condition->value == NULL ||
+        !is_loop_variable(condition->children[FIRST_CHILD_INDEX], bounds->variable) ||
+        !unroll_literal(condition->children[FIRST_CHILD_INDEX + 1], &bound))
+    {
+        return 0;
+    }
+
+    // var = var +/- step
+    increment = for_node->children[increment_index];
+    if (increment_index <= FIRST_STATEMENT_INDEX || increment->type != NODE_ASSIGNMENT ||
+        increment->num_children != 2 ||
+        !is_loop_variable(increment->children[FIRST_CHILD_INDEX], bounds->variable))
+    {
+        return 0;
+    }
+    update = increment->children[FIRST_CHILD_INDEX + 1];
+    if (update->type != NODE_BINARY_EXPR || update->num_children != 2 || update->value == NULL ||
+        !is_loop_variable(update->children[FIRST_CHILD_INDEX], bounds->variable) ||
+        !unroll_literal(update->children[FIRST_CHILD_INDEX + 1], &bounds->step))
+    {
+        return 0;
+    }
+    if (update->token.id == INTERN_OP_MINUS)
+    {
+        bounds->step = -bounds->step;
+    }
+    else if (update->token.id != INTERN_OP_PLUS)
+    {
+        return 0;
+    }
+    if (bounds->step == 0)
+    {
+        return 0;
+    }
+
+    bounds->first_body_index = FIRST_STATEMENT_INDEX + 1;
+    bounds->last_body_index = increment_index;
+    for (int child_index = bounds->first_body_index; child_index < bounds->last_body_index; ++child_index)
+    {
+        if (body_prevents_unrolling(for_node->children[child_index], bounds->variable, 0))
+        {
+            return 0;
+        }
+    }
+
+    if (!count_iterations(condition->token.id, bounds->start, bound, bounds->step, &bounds->trip_count))
+    {
+        return 0;
+    }
+
+    // The final value must still be a C int
+    {
+        int64_t final_value = bounds->start + bounds->trip_count * bounds->step;
+        if (bounds->trip_count > MAX_TRIP_COUNT || final_value > INT32_MAX || final_value < INT32_MIN)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// -------------------------------------------------------------
+// Loop variable substitution
+// -------------------------------------------------------------
+static void collect_variable_uses(ASTNode *node, const char *variable, UnrollSwapList *list)
+{
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        ASTNode *child = node->children[child_index];
+
+        if (is_loop_variable(child, variable))
+        {
+            if (list->count >= list->capacity)
+            {
+                list->capacity = (list->capacity > 0) ? list->capacity * 2 : 16;
+                list->swaps = (UnrollSwap*)xrealloc(list->swaps, (size_t)list->capacity * sizeof(UnrollSwap));
+            }
+            list->swaps[list->count].parent = node;
+            list->swaps[list->count].child_index = child_index;
+            list->swaps[list->count].original = child;
+            list->count++;
+        }
+        else
+        {
+            collect_variable_uses(child, variable, list);
+        }
+    }
+}
+
+// Helper: formatted text allocated in arena at the length it needs
+#if defined(__GNUC__) || defined(__clang__)
+static const char* unroll_printf(Arena *arena, const char *format, ...) __attribute__((format(printf, 2, 3)));
+#endif
+static const char* unroll_printf(Arena *arena, const char *format, ...)
+{
+    va_list args;
+    int length = 0;
+    char *text = NULL;
+
+    va_start(args, format);
+    length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    text = (char*)arena_alloc(arena, (size_t)length + 1);
+    va_start(args, format);
+    vsnprintf(text, (size_t)length + 1, format, args);
+    va_end(args);
+    return text;
+}
+
+// Text of the loop variable in one body copy: iterator * scale + offset
+static const char* format_iteration_value(Arena *arena, const char *iterator, int64_t scale, int64_t offset)
+{
+    if (iterator == NULL)
+    {
+        return unroll_printf(arena, "%lld", (long long)offset);
+    }
+    if (scale < 0)
+    {
+        // Count-down loops read as offset - iterator * step
+        if (scale == -1)
+        {
+            return unroll_printf(arena, "(%lld - %s)", (long long)offset, iterator);
+        }
+        return unroll_printf(arena, "(%lld - %s * %lld)", (long long)offset, iterator, (long long)-scale);
+    }
+    if (scale == 1 && offset == 0)
+    {
+        return iterator;
+    }
+    if (offset == 0)
+    {
+        return unroll_printf(arena, "(%s * %lld)", iterator, (long long)scale);
+    }
+    if (scale == 1)
+    {
+        return unroll_printf(arena, "(%s %c %lld)", iterator, (offset < 0) ? '-' : '+',
+                             (long long)((offset < 0) ? -offset : offset));
+    }
+    return unroll_printf(arena, "(%s * %lld %c %lld)", iterator, (long long)scale, (offset < 0) ? '-' : '+',
+                         (long long)((offset < 0) ? -offset : offset));
+}
+
+static void emit_body_copy(ASTNode *for_node, const LoopBounds *bounds, ASTNode *replacement, const char *value,
+                           OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    set_node_value(replacement, value);
+    for (int child_index = bounds->first_body_index; child_index < bounds->last_body_index; ++child_index)
+    {
+        node_generator(for_node->children[child_index], out);
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: factor requested by "#pragma unroll [N]" (0 = no pragma)
+// -------------------------------------------------------------
+static int64_t requested_factor(const char *pragma, int64_t trip_count)
+{
+    if (pragma == NULL)
+    {
+        return 0;
+    }
+    if (*pragma == '(')
+    {
+        pragma++;
+    }
+    if (isdigit((unsigned char)*pragma))
+    {
+        int64_t factor = strtoll(pragma, NULL, 10);
+        return (factor > 0) ? factor : 1;
+    }
+    return (trip_count > 0) ? trip_count : 1; // Bare "unroll": fully
+}
+
+// Copies of the body per block: the pragma factor, or every iteration up to unroll_limit
+static int64_t unroll_factor(ASTNode *statement, const LoopBounds *bounds, int unroll_limit)
+{
+    int64_t factor = requested_factor(find_node_pragma(statement, "unroll"), bounds->trip_count);
+
+    if (factor == 0)
+    {
+        factor = (bounds->trip_count <= unroll_limit) ? bounds->trip_count : 1;
+    }
+    if (factor > MAX_FLATTENED_ITERATIONS)
+    {
+        factor = MAX_FLATTENED_ITERATIONS;
+    }
+    if (factor < 1)
+    {
+        factor = 1;
+    }
+    return factor;
+}
+
+// -------------------------------------------------------------
+// Flattened iterations
+// -------------------------------------------------------------
+// Every copy runs in the same clock cycle, where a signal keeps its old
+// value until the process ends. So the scalars a copy assigns are forwarded
+// instead: later copies read the assigned expression in place of the
+// signal, and one assignment per scalar carries the final value.
+
+// Value of a name at this point of the copies
+typedef struct {
+    const char *name;
+    ASTNode *value;            // Shared by the copies that read it
+    int64_t size;              // Nodes of value, shared subtrees counted per use
+    int assigned;              // Written by a copy (else a loop variable)
+} UnrollForward;
+
+typedef struct {
+    const ASTNode *function;   // Declarations that type the folded copies
+    int unroll_limit;
+    UnrollForward *forwards;
+    int forward_count;
+    int forward_capacity;
+    ASTNode **statements;      // Copies and final assignments, in emission order
+    int statement_count;
+    int statement_capacity;
+    int overflow;              // A value outgrew MAX_FORWARDED_NODES
+} UnrollFlattening;
+
+static UnrollForward* find_forward(UnrollFlattening *flattening, const char *name)
+{
+    for (int index = flattening->forward_count - 1; index >= 0; --index)
+    {
+        if (strcmp(flattening->forwards[index].name, name) == 0)
+        {
+            return &flattening->forwards[index];
+        }
+    }
+    return NULL;
+}
+
+static void push_forward(UnrollFlattening *flattening, const char *name, ASTNode *value, int64_t size, int assigned)
+{
+    UnrollForward *forward = NULL;
+
+    if (flattening->forward_count >= flattening->forward_capacity)
+    {
+        flattening->forward_capacity = (flattening->forward_capacity > 0) ? flattening->forward_capacity * 2 : 8;
+        flattening->forwards = (UnrollForward*)xrealloc(flattening->forwards,
+            (size_t)flattening->forward_capacity * sizeof(UnrollForward));
+    }
+    forward = &flattening->forwards[flattening->forward_count++];
+    forward->name = name;
+    forward->value = value;
+    forward->size = size;
+    forward->assigned = assigned;
+}
+
+static void remove_forward(UnrollFlattening *flattening, UnrollForward *forward)
+{
+    int index = (int)(forward - flattening->forwards);
+
+    memmove(forward, forward + 1, (size_t)(flattening->forward_count - index - 1) * sizeof(UnrollForward));
+    flattening->forward_count--;
+}
+
+static void append_statement(UnrollFlattening *flattening, ASTNode *statement)
+{
+    if (flattening->statement_count >= flattening->statement_capacity)
+    {
+        flattening->statement_capacity = (flattening->statement_capacity > 0) ?
+            flattening->statement_capacity * 2 : 16;
+        flattening->statements = (ASTNode**)xrealloc(flattening->statements,
+            (size_t)flattening->statement_capacity * sizeof(ASTNode*));
+    }
+    flattening->statements[flattening->statement_count++] = statement;
+}
+
+static ASTNode* unroll_number(int64_t value)
+{
+    char text[UNROLL_NUMBER_SIZE];
+    ASTNode *number = create_node(NODE_EXPRESSION);
+
+    snprintf(text, sizeof(text), "%lld", (long long)value);
+    set_node_value(number, text);
+    return number;
+}
+
+// "name = value;"
+static ASTNode* unroll_assignment(const char *name, ASTNode *value)
+{
+    ASTNode *statement = create_node(NODE_STATEMENT);
+    ASTNode *assignment = create_node(NODE_ASSIGNMENT);
+    ASTNode *target = create_node(NODE_EXPRESSION);
+
+    set_node_value(target, name);
+    add_child(assignment, target);
+    add_child(assignment, value);
+    add_child(statement, assignment);
+    return statement;
+}
+
+// "name = value;" unless value is the name itself
+static void append_assignment(UnrollFlattening *flattening, const UnrollForward *forward)
+{
+    if (forward->value->type == NODE_EXPRESSION && forward->value->value != NULL &&
+        strcmp(forward->value->value, forward->name) == 0)
+    {
+        return;
+    }
+    append_statement(flattening, unroll_assignment(forward->name, forward->value));
+}
+
+// 1 if node names a value (not the target of an assignment or its base)
+static int is_forwardable_read(const ASTNode *node, int is_target)
+{
+    return !is_target && node->type == NODE_EXPRESSION && node->value != NULL;
+}
+
+// Targets keep their name; only the index of an element target is read
+static int child_is_target(const ASTNode *node, int is_target, int child_index)
+{
+    if (node->type == NODE_ASSIGNMENT)
+    {
+        return child_index == FIRST_CHILD_INDEX;
+    }
+    return is_target && child_index == FIRST_CHILD_INDEX;
+}
+
+/**
+ * Deep copy of a body statement with the names forwarded to literals (loop
+ * variables, mostly) replaced, so folding sees them. Other forwarded names
+ * are left for substitute_forwards, after folding.
+ */
+static ASTNode* copy_substituted(UnrollFlattening *flattening, const ASTNode *node, int is_target)
+{
+    ASTNode *duplicate = create_node(node->type);
+    UnrollForward *forward = is_forwardable_read(node, is_target) ? find_forward(flattening, node->value) : NULL;
+    int32_t literal = 0;
+
+    duplicate->token = node->token;
+    duplicate->array_size = node->array_size;
+    if (forward != NULL && optimize_int_literal(forward->value, &literal))
+    {
+        duplicate->token = forward->value->token;
+        set_node_value(duplicate, forward->value->value);
+        return duplicate;
+    }
+    if (node->value != NULL)
+    {
+        set_node_value(duplicate, node->value);
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        add_child(duplicate, copy_substituted(flattening, node->children[child_index],
+                                              child_is_target(node, is_target, child_index)));
+    }
+    return duplicate;
+}
+
+// Reads of forwarded names in a folded copy replaced by their values
+static ASTNode* substitute_forwards(UnrollFlattening *flattening, ASTNode *node, int is_target, int64_t *size)
+{
+    UnrollForward *forward = is_forwardable_read(node, is_target) ? find_forward(flattening, node->value) : NULL;
+
+    if (forward != NULL)
+    {
+        *size += forward->size;
+        return forward->value;
+    }
+    (*size)++;
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        node->children[child_index] = substitute_forwards(flattening, node->children[child_index],
+                                                          child_is_target(node, is_target, child_index), size);
+    }
+    if (*size > MAX_FORWARDED_NODES)
+    {
+        flattening->overflow = 1;
+    }
+    return node;
+}
+
+static ASTNode* copy_folded(UnrollFlattening *flattening, const ASTNode *node, int64_t *size)
+{
+    ASTNode *copy = fold_subtree(flattening->function, copy_substituted(flattening, node, 0));
+
+    *size = 0;
+    return substitute_forwards(flattening, copy, 0, size);
+}
+
+// Helper: 1 if the subtree holds a loop, whose iterations would read a forwarded value only once
+static int contains_loop(const ASTNode *node)
+{
+    if (node->type == NODE_WHILE_STATEMENT || node->type == NODE_FOR_STATEMENT)
+    {
+        return 1;
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        if (contains_loop(node->children[child_index]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Helper: variable node writes (the array or struct of an element or field), or NULL
+static const char* written_name(const ASTNode *node)
+{
+    const ASTNode *target = NULL;
+
+    if (node->type == NODE_VAR_DECL)
+    {
+        return node->value;
+    }
+    if (node->type != NODE_ASSIGNMENT || node->num_children == 0)
+    {
+        return NULL;
+    }
+    target = node->children[FIRST_CHILD_INDEX];
+    while (target->type != NODE_EXPRESSION && target->num_children > 0)
+    {
+        target = target->children[FIRST_CHILD_INDEX];
+    }
+    return target->value;
+}
+
+// Assign the forwarded scalars node writes before it; with stop, forward them no further
+static void flush_written_forwards(UnrollFlattening *flattening, const ASTNode *node, int stop)
+{
+    const char *name = written_name(node);
+    UnrollForward *forward = (name != NULL) ? find_forward(flattening, name) : NULL;
+
+    if (forward != NULL)
+    {
+        if (forward->assigned)
+        {
+            append_assignment(flattening, forward);
+            forward->assigned = 0;
+        }
+        if (stop)
+        {
+            remove_forward(flattening, forward);
+        }
+    }
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        flush_written_forwards(flattening, node->children[child_index], stop);
+    }
+}
+
+static void flatten_loop(UnrollFlattening *flattening, const ASTNode *for_node, const LoopBounds *bounds,
+                         int64_t first_iteration);
+
+// A for loop that generate_unrolled_for_loop would unroll fully
+static int is_fully_unrolled(ASTNode *statement, int unroll_limit, LoopBounds *bounds)
+{
+    if (statement->type != NODE_STATEMENT || statement->num_children == 0 ||
+        statement->children[FIRST_CHILD_INDEX]->type != NODE_FOR_STATEMENT ||
+        !analyze_for_loop(statement->children[FIRST_CHILD_INDEX], bounds))
+    {
+        return 0;
+    }
+    return bounds->trip_count <= MAX_FLATTENED_ITERATIONS &&
+           unroll_factor(statement, bounds, unroll_limit) >= bounds->trip_count;
+}
+
+static void flatten_statement(UnrollFlattening *flattening, ASTNode *statement)
+{
+    ASTNode *inner = (statement->type == NODE_STATEMENT && statement->num_children == 1) ?
+                     statement->children[FIRST_CHILD_INDEX] : statement;
+    const char *name = NULL;
+    const ASTNode *value = NULL;
+    ASTNode *copy = NULL;
+    LoopBounds bounds;
+    int64_t size = 0;
+
+    if (inner->type == NODE_ASSIGNMENT && inner->num_children == 2 &&
+        inner->children[FIRST_CHILD_INDEX]->type == NODE_EXPRESSION)
+    {
+        name = inner->children[FIRST_CHILD_INDEX]->value;
+        value = inner->children[FIRST_CHILD_INDEX + 1];
+    }
+    else if (inner->type == NODE_VAR_DECL && inner->array_size == 0 && inner->num_children == 1 &&
+             find_struct_index_id(inner->token.id) < 0)
+    {
+        name = inner->value;
+        value = inner->children[FIRST_CHILD_INDEX];
+    }
+
+    // A scalar set to a value without calls: later copies read the value
+    if (name != NULL && optimize_is_pure(value))
+    {
+        UnrollForward *forward = find_forward(flattening, name);
+        ASTNode *folded = copy_folded(flattening, value, &size);
+
+        if (forward != NULL)
+        {
+            forward->value = folded;
+            forward->size = size;
+            forward->assigned = 1;
+        }
+        else
+        {
+            push_forward(flattening, name, folded, size, 1);
+        }
+        return;
+    }
+
+    // Inner loops unrolled fully are flattened into the same copies
+    if (is_fully_unrolled(statement, flattening->unroll_limit, &bounds))
+    {
+        flatten_loop(flattening, statement->children[FIRST_CHILD_INDEX], &bounds, 0);
+        return;
+    }
+
+    // Anything else is copied as it is, after the values of the scalars it
+    // writes; a loop reads them from the signals, every iteration
+    if (contains_loop(statement))
+    {
+        flush_written_forwards(flattening, statement, 1);
+        copy = copy_folded(flattening, statement, &size);
+    }
+    else
+    {
+        flush_written_forwards(flattening, statement, 0);
+        copy = copy_folded(flattening, statement, &size);
+        flush_written_forwards(flattening, statement, 1);
+    }
+    copy->parent = statement->parent;
+    append_statement(flattening, copy);
+}
+
+static void flatten_loop(UnrollFlattening *flattening, const ASTNode *for_node, const LoopBounds *bounds,
+                         int64_t first_iteration)
+{
+    for (int64_t iteration = first_iteration; iteration < bounds->trip_count && !flattening->overflow; ++iteration)
+    {
+        push_forward(flattening, bounds->variable, unroll_number(bounds->start + iteration * bounds->step), 1, 0);
+        for (int child_index = bounds->first_body_index; child_index < bounds->last_body_index; ++child_index)
+        {
+            flatten_statement(flattening, for_node->children[child_index]);
+        }
+        remove_forward(flattening, find_forward(flattening, bounds->variable));
+    }
+
+    // A variable declared outside the loop keeps its final value
+    if (!bounds->declared_in_loop)
+    {
+        UnrollForward *forward = find_forward(flattening, bounds->variable);
+        ASTNode *final_value = unroll_number(bounds->start + bounds->trip_count * bounds->step);
+
+        if (forward != NULL)
+        {
+            remove_forward(flattening, forward);
+        }
+        push_forward(flattening, bounds->variable, final_value, 1, 1);
+    }
+}
+
+// The scalars still forwarded get their final values
+static void append_final_assignments(UnrollFlattening *flattening)
+{
+    for (int index = 0; index < flattening->forward_count; ++index)
+    {
+        if (flattening->forwards[index].assigned)
+        {
+            append_assignment(flattening, &flattening->forwards[index]);
+        }
+    }
+}
+
+// Helper: function declaring node, which types the names of its copies
+static const ASTNode* enclosing_function(const ASTNode *node)
+{
+    while (node != NULL && node->type != NODE_FUNCTION_DECL)
+    {
+        node = node->parent;
+    }
+    return node;
+}
+
+// -------------------------------------------------------------
+// Unrolled for loop emission
+// -------------------------------------------------------------
+int generate_unrolled_for_loop(ASTNode *statement, ASTNode *for_node, int unroll_limit,
+                               OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    const char *pragma = find_node_pragma(statement, "unroll");
+    LoopBounds bounds;
+    UnrollSwapList uses = { NULL, 0, 0 };
+    UnrollFlattening flattening;
+    Arena scratch;
+    Arena *previous_arena = NULL;
+    ASTNode *replacement = NULL;
+    const char *iterator = NULL;
+    int64_t factor = 0;
+    int64_t blocks = 0;
+
+    if (!analyze_for_loop(for_node, &bounds))
+    {
+        if (pragma != NULL)
+        {
+            out_printf(out, "%s-- unroll pragma ignored: trip count is not constant\n", INDENT_LEVEL_3);
+        }
+        return 0;
+    }
+
+    factor = unroll_factor(statement, &bounds, unroll_limit);
+    blocks = (factor < bounds.trip_count) ? bounds.trip_count / factor : 0;
+
+    // Flattened iterations: all of them, or those left over after the blocks
+    memset(&flattening, 0, sizeof(flattening));
+    flattening.function = enclosing_function(statement);
+    flattening.unroll_limit = unroll_limit;
+    arena_init(&scratch, 0);
+    previous_arena = ast_use_arena(&scratch);
+    replacement = create_node(NODE_EXPRESSION);
+    flatten_loop(&flattening, for_node, &bounds, blocks * factor);
+    append_final_assignments(&flattening);
+    ast_use_arena(previous_arena);
+
+    if (flattening.overflow)
+    {
+        if (pragma != NULL)
+        {
+            out_printf(out, "%s-- unroll pragma ignored: unrolled values grow too large\n", INDENT_LEVEL_3);
+        }
+        free(flattening.forwards);
+        free(flattening.statements);
+        arena_release(&scratch);
+        return 0;
+    }
+
+    if (blocks == 0)
+    {
+        out_printf(out, "%s-- Unrolled %s: %lld iterations\n", INDENT_LEVEL_3,
+                   bounds.variable, (long long)bounds.trip_count);
+    }
+    else
+    {
+        for (int child_index = bounds.first_body_index; child_index < bounds.last_body_index; ++child_index)
+        {
+            collect_variable_uses(for_node->children[child_index], bounds.variable, &uses);
+        }
+        for (int use_index = 0; use_index < uses.count; ++use_index)
+        {
+            uses.swaps[use_index].parent->children[uses.swaps[use_index].child_index] = replacement;
+        }
+
+        iterator = unroll_printf(&scratch, "%s_iter", bounds.variable);
+        if (factor > 1)
+        {
+            out_printf(out, "%s-- Unrolled %s by %lld: %lld iterations\n", INDENT_LEVEL_3,
+                       bounds.variable, (long long)factor, (long long)bounds.trip_count);
+        }
+        else
+        {
+            out_printf(out, "%s-- Bounded loop over %s: %lld iterations\n", INDENT_LEVEL_3,
+                       bounds.variable, (long long)bounds.trip_count);
+        }
+        out_printf(out, "%sfor %s in 0 to %lld loop\n", INDENT_LEVEL_3, iterator, (long long)(blocks - 1));
+        for (int64_t copy = 0; copy < factor; ++copy)
+        {
+            emit_body_copy(for_node, &bounds, replacement,
+                           format_iteration_value(&scratch, iterator, factor * bounds.step,
+                                                  bounds.start + copy * bounds.step),
+                           out, node_generator);
+        }
+        out_printf(out, "%send loop;\n", INDENT_LEVEL_3);
+
+        for (int use_index = uses.count - 1; use_index >= 0; --use_index)
+        {
+            UnrollSwap *swap = &uses.swaps[use_index];
+            swap->parent->children[swap->child_index] = swap->original;
+        }
+        free(uses.swaps);
+    }
+
+    for (int index = 0; index < flattening.statement_count; ++index)
+    {
+        node_generator(flattening.statements[index], out);
+    }
+
+    free(flattening.forwards);
+    free(flattening.statements);
+    arena_release(&scratch);
+    return 1;
+}
+
+// -------------------------------------------------------------
+// Forwarding within one cycle
+// -------------------------------------------------------------
+int unroll_forward_statements(const ASTNode *parent, int first, int last, int unroll_limit,
+                              ASTNode ***statements)
+{
+    UnrollFlattening flattening;
+
+    memset(&flattening, 0, sizeof(flattening));
+    flattening.function = enclosing_function(parent);
+    flattening.unroll_limit = unroll_limit;
+    for (int child_index = first; child_index < last && !flattening.overflow; ++child_index)
+    {
+        flatten_statement(&flattening, parent->children[child_index]);
+    }
+    append_final_assignments(&flattening);
+    free(flattening.forwards);
+
+    if (flattening.overflow)
+    {
+        free(flattening.statements);
+        *statements = NULL;
+        return -1;
+    }
+    *statements = flattening.statements;
+    return flattening.statement_count;
+}
+
+// -------------------------------------------------------------
+// In-place expansion
+// -------------------------------------------------------------
+// A local of the body and its name in the current copy
+typedef struct {
+    const char *name;
+    const char *renamed;
+} UnrollRename;
+
+typedef struct {
+    UnrollRename *renames;
+    int count;
+    int capacity;
+} UnrollRenameList;
+
+static const char* unroll_renamed(const UnrollRenameList *list, const char *name)
+{
+    for (int index = list->count - 1; index >= 0; --index)
+    {
+        if (strcmp(list->renames[index].name, name) == 0)
+        {
+            return list->renames[index].renamed;
+        }
+    }
+    return name;
+}
+
+static void unroll_add_rename(UnrollExpansion *expansion, UnrollRenameList *list, const char *name, int64_t copy)
+{
+    if (list->count >= list->capacity)
+    {
+        list->capacity = (list->capacity > 0) ? list->capacity * 2 : 8;
+        list->renames = (UnrollRename*)xrealloc(list->renames, (size_t)list->capacity * sizeof(UnrollRename));
+    }
+    list->renames[list->count].name = name;
+    list->renames[list->count].renamed = unroll_printf(&expansion->scratch, "%s_u%lld", name, (long long)copy);
+    list->count++;
+}
+
+// Deep copy of one body statement for iteration copy (nodes go to the active scratch arena)
+static ASTNode* unroll_copy_node(UnrollExpansion *expansion, const ASTNode *node, const char *variable,
+                                 const char *value, int64_t copy, UnrollRenameList *renames)
+{
+    ASTNode *duplicate = create_node(node->type);
+    int scope = renames->count;
+
+    duplicate->token = node->token;
+    duplicate->array_size = node->array_size;
+    if (is_loop_variable(node, variable))
+    {
+        set_node_value(duplicate, value);
+        return duplicate;
+    }
+    if (node->value != NULL)
+    {
+        set_node_value(duplicate, (node->type == NODE_EXPRESSION) ? unroll_renamed(renames, node->value) : node->value);
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        add_child(duplicate, unroll_copy_node(expansion, node->children[child_index], variable, value, copy, renames));
+    }
+
+    switch (node->type)
+    {
+        case NODE_VAR_DECL:
+            // Visible to the statements after it in the enclosing block
+            if (node->value != NULL)
+            {
+                unroll_add_rename(expansion, renames, node->value, copy);
+                set_node_value(duplicate, renames->renames[renames->count - 1].renamed);
+            }
+            break;
+
+        case NODE_FOR_STATEMENT:
+        case NODE_WHILE_STATEMENT:
+        case NODE_IF_STATEMENT:
+        case NODE_ELSE_IF_STATEMENT:
+        case NODE_ELSE_STATEMENT:
+            renames->count = scope;
+            break;
+
+        default:
+            break;
+    }
+    return duplicate;
+}
+
+static int unroll_expand_children(UnrollExpansion *expansion, ASTNode *parent, int unroll_limit)
+{
+    LoopBounds bounds;
+    UnrollRenameList renames = { NULL, 0, 0 };
+    UnrollSplice *splice = NULL;
+    ASTNode **children = NULL;
+    int expanded = 0;
+    int found = 0;
+    int length = 0;
+    int position = 0;
+
+    // Inner loops first, so their copies are copied along
+    for (int child_index = 0; child_index < parent->num_children; ++child_index)
+    {
+        expanded += unroll_expand_children(expansion, parent->children[child_index], unroll_limit);
+    }
+
+    for (int child_index = 0; child_index < parent->num_children; ++child_index)
+    {
+        if (is_fully_unrolled(parent->children[child_index], unroll_limit, &bounds))
+        {
+            length += (int)bounds.trip_count * (bounds.last_body_index - bounds.first_body_index) +
+                      (bounds.declared_in_loop ? 0 : 1);
+            expanded++;
+            found = 1;
+        }
+        else
+        {
+            length++;
+        }
+    }
+    if (!found)
+    {
+        return expanded;
+    }
+
+    children = (ASTNode**)arena_alloc(&expansion->scratch, (size_t)(length > 0 ? length : 1) * sizeof(ASTNode*));
+    for (int child_index = 0; child_index < parent->num_children; ++child_index)
+    {
+        ASTNode *child = parent->children[child_index];
+        ASTNode *for_node = NULL;
+
+        if (!is_fully_unrolled(child, unroll_limit, &bounds))
+        {
+            children[position++] = child;
+            continue;
+        }
+
+        for_node = child->children[FIRST_CHILD_INDEX];
+        for (int64_t iteration = 0; iteration < bounds.trip_count; ++iteration)
+        {
+            const char *value = format_iteration_value(&expansion->scratch, NULL, 0,
+                                                       bounds.start + iteration * bounds.step);
+
+            renames.count = 0;
+            for (int body_index = bounds.first_body_index; body_index < bounds.last_body_index; ++body_index)
+            {
+                ASTNode *copy = unroll_copy_node(expansion, for_node->children[body_index], bounds.variable,
+                                                 value, iteration, &renames);
+
+                copy->parent = parent;
+                children[position++] = copy;
+            }
+        }
+        if (!bounds.declared_in_loop)
+        {
+            children[position] = unroll_assignment(bounds.variable,
+                unroll_number(bounds.start + bounds.trip_count * bounds.step));
+            children[position++]->parent = parent;
+        }
+    }
+    free(renames.renames);
+
+    if (expansion->count >= expansion->capacity)
+    {
+        expansion->capacity = (expansion->capacity > 0) ? expansion->capacity * 2 : 8;
+        expansion->splices = (UnrollSplice*)xrealloc(expansion->splices,
+            (size_t)expansion->capacity * sizeof(UnrollSplice));
+    }
+    splice = &expansion->splices[expansion->count++];
+    splice->parent = parent;
+    splice->children = parent->children;
+    splice->num_children = parent->num_children;
+    splice->capacity = parent->capacity;
+
+    parent->children = children;
+    parent->num_children = length;
+    parent->capacity = length;
+    return expanded;
+}
+
+int unroll_expand_function(ASTNode *function, int unroll_limit, UnrollExpansion *expansion)
+{
+    Arena *previous_arena = NULL;
+    int expanded = 0;
+
+    memset(expansion, 0, sizeof(*expansion));
+    arena_init(&expansion->scratch, 0);
+
+    previous_arena = ast_use_arena(&expansion->scratch);
+    expanded = unroll_expand_children(expansion, function, unroll_limit);
+    ast_use_arena(previous_arena);
+    return expanded;
+}
+
+void unroll_restore(UnrollExpansion *expansion)
+{
+    for (int index = expansion->count - 1; index >= 0; --index)
+    {
+        UnrollSplice *splice = &expansion->splices[index];
+
+        splice->parent->children = splice->children;
+        splice->parent->num_children = splice->num_children;
+        splice->parent->capacity = splice->capacity;
+    }
+    free(expansion->splices);
+    arena_release(&expansion->scratch);
+    memset(expansion, 0, sizeof(*expansion));
+}
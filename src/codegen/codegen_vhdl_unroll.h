@@ -0,0 +1,103 @@
+// VHDL Code Generator - Loop Unrolling
+// -------------------------------------------------------------
+// Purpose: Lower for loops with a constant trip count to flattened
+//          iterations or bounded VHDL for loops instead of while loops
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_UNROLL_H
+#define CODEGEN_VHDL_UNROLL_H
+
+#include <stdint.h>
+#include "output_buffer.h"
+#include "astnode.h"
+#include "arena.h"
+
+// -------------------------------------------------------------
+// Trip count analysis
+// -------------------------------------------------------------
+// for (var = start; var <op> bound; var = var +/- step) with literals only
+typedef struct {
+    const char *variable;      // Loop variable
+    int declared_in_loop;      // for (int var = ...): no signal holds it afterwards
+    int64_t start;
+    int64_t step;              // Non-zero, negative for count-down loops
+    int64_t trip_count;        // Iterations executed (may be 0)
+    int first_body_index;      // Body statements of the for node: [first, last)
+    int last_body_index;
+} LoopBounds;
+
+/**
+ * Recognise a for loop whose iterations are known at compile time: literal
+ * start, bound and step, and a body that neither writes the loop variable
+ * nor leaves the loop early (break/continue)
+ *
+ * @return 1 and bounds filled in, 0 if the loop must stay a while loop
+ */
+int analyze_for_loop(ASTNode *for_node, LoopBounds *bounds);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+/**
+ * Generate a for loop wrapped by statement (whose "#pragma unroll [N]"
+ * selects the factor; without one, loops of at most unroll_limit
+ * iterations are unrolled fully). Constant-trip loops become flattened
+ * iterations, or a bounded VHDL for loop whose body holds factor copies.
+ *
+ * Flattened iterations read the values earlier ones assigned to scalars
+ * (not the signals, which only update at the end of the cycle) and assign
+ * each scalar once. A scalar written under a condition or in an inner loop
+ * is read from its signal after that statement, and so are the values an
+ * iteration of a bounded loop leaves for the next: a loop carrying a value
+ * between iterations computes it fully unrolled only.
+ *
+ * @return 1 if the loop was emitted, 0 if the caller must emit the
+ *         regular while lowering
+ */
+int generate_unrolled_for_loop(ASTNode *statement, ASTNode *for_node, int unroll_limit,
+                               OutputBuffer *out, void (*node_generator)(ASTNode*, OutputBuffer*));
+
+/**
+ * The statements [first, last) of parent as they run in one clock cycle:
+ * the forwarding of flattened iterations applied to a single pass, so a
+ * scalar assigned by one statement is read as its value by the next ones
+ * and assigned once at the end. Nodes go to the active arena.
+ *
+ * @param statements Set to the rewritten statements (free() the array)
+ * @return Number of statements, or -1 if the values grow too large
+ */
+int unroll_forward_statements(const ASTNode *parent, int first, int last, int unroll_limit,
+                              ASTNode ***statements);
+
+// -------------------------------------------------------------
+// In-place expansion (state machine functions)
+// -------------------------------------------------------------
+// Statement list replaced while a function is expanded
+typedef struct {
+    ASTNode *parent;
+    ASTNode **children;
+    int num_children;
+    int capacity;
+} UnrollSplice;
+
+typedef struct {
+    UnrollSplice *splices;
+    int count;
+    int capacity;
+    Arena scratch;             // Body copies and spliced child vectors
+} UnrollExpansion;
+
+/**
+ * Replace every for loop of a function that generate_unrolled_for_loop
+ * would unroll fully by copies of its body, with the loop variable replaced
+ * by its value and the locals of the body renamed per copy (<name>_u<k>).
+ * Later passes then see constant array indices and independent copies.
+ * Loops left over for partial unrolling keep their shape.
+ *
+ * @return Number of loops expanded (undo with unroll_restore either way)
+ */
+int unroll_expand_function(ASTNode *function, int unroll_limit, UnrollExpansion *expansion);
+
+void unroll_restore(UnrollExpansion *expansion);
+
+#endif // CODEGEN_VHDL_UNROLL_H
@@ -0,0 +1,738 @@
+// VHDL Code Generator - Bit Widths Implementation
+// -------------------------------------------------------------
+// Every int becomes a 32-bit vector, and so does every adder, comparator
+// and register built from it, even for a loop counter that never passes
+// 15. Explicit-width types give the designer the exact width, and the
+// range analysis below finds it for plain int locals.
+//
+// The analysis is flow-insensitive: a local can only ever hold a value one
+// of its assignments computes, so its range is the union of the ranges of
+// all right-hand sides, evaluated over the ranges of the signals they read.
+// That is iterated to a fixed point; ranges still growing after a few
+// passes (accumulators) widen to all of int and keep their 32 bits.
+//
+// Expressions are still computed at 32 bits: a narrower signal is extended
+// where it is read and resized where it is stored, which wraps exactly like
+// the conversion to the C type it was declared with.
+// -------------------------------------------------------------
+
+#include "codegen_vhdl_widths.h"
+#include "codegen_vhdl_constants.h"
+#include "codegen_vhdl_helpers.h"
+#include "codegen_vhdl_unroll.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+// Passes before a range that is still growing widens to the whole int range
+#define WIDTH_MAX_PASSES 8
+#define WIDTH_TYPE_NAME_SIZE 24
+
+#define WIDTH_INT_MIN ((int64_t)INT32_MIN)
+#define WIDTH_INT_MAX ((int64_t)INT32_MAX)
+
+static _Thread_local const WidthPlan *s_active_plan = NULL;
+
+// Values a signal or expression can take; unknown until something is assigned
+typedef struct {
+    int64_t low;
+    int64_t high;
+    int known;
+} WidthRange;
+
+typedef struct {
+    InternId name_id;
+    ASTNode *declaration;      // NULL for parameters
+    int excluded;              // Parameter, or declared more than once
+    WidthRange range;
+} WidthCandidate;
+
+// One assignment: the value stored, or the range of a loop counter
+typedef struct {
+    InternId name_id;
+    const ASTNode *value;
+    WidthRange range;
+} WidthDefinition;
+
+typedef struct {
+    WidthCandidate *candidates;
+    int candidate_count;
+    int candidate_capacity;
+    WidthDefinition *definitions;
+    int definition_count;
+    int definition_capacity;
+} WidthAnalysis;
+
+// -------------------------------------------------------------
+// Interval arithmetic
+// -------------------------------------------------------------
+static WidthRange width_full(void)
+{
+    WidthRange range = { WIDTH_INT_MIN, WIDTH_INT_MAX, 1 };
+    return range;
+}
+
+static WidthRange width_unknown(void)
+{
+    WidthRange range = { 0, 0, 0 };
+    return range;
+}
+
+// Helper: a range, or all of int if C arithmetic would overflow there
+static WidthRange width_make(int64_t low, int64_t high)
+{
+    WidthRange range = { low, high, 1 };
+
+    if (low < WIDTH_INT_MIN || high > WIDTH_INT_MAX)
+    {
+        return width_full();
+    }
+    return range;
+}
+
+static WidthRange width_join(WidthRange first, WidthRange second)
+{
+    if (!first.known)
+    {
+        return second;
+    }
+    if (!second.known)
+    {
+        return first;
+    }
+    return width_make(first.low < second.low ? first.low : second.low,
+                      first.high > second.high ? first.high : second.high);
+}
+
+static int width_is_constant(WidthRange range)
+{
+    return range.known && range.low == range.high;
+}
+
+// Helper: smallest all-ones value covering value (value >= 0)
+static int64_t width_mask_above(int64_t value)
+{
+    int64_t mask = 0;
+
+    while (mask < value)
+    {
+        mask = (mask << 1) | 1;
+    }
+    return mask;
+}
+
+static WidthRange width_multiply(WidthRange left, WidthRange right)
+{
+    int64_t products[4] = {
+        left.low * right.low, left.low * right.high,
+        left.high * right.low, left.high * right.high
+    };
+    int64_t low = products[0];
+    int64_t high = products[0];
+
+    for (int index = 1; index < 4; ++index)
+    {
+        low = (products[index] < low) ? products[index] : low;
+        high = (products[index] > high) ? products[index] : high;
+    }
+    return width_make(low, high);
+}
+
+static WidthRange width_binary(InternId operator_id, WidthRange left, WidthRange right)
+{
+    int64_t divisor = right.low;
+
+    switch (operator_id)
+    {
+        case INTERN_OP_EQUAL:
+        case INTERN_OP_NOT_EQUAL:
+        case INTERN_OP_LESS:
+        case INTERN_OP_LESS_EQUAL:
+        case INTERN_OP_GREATER:
+        case INTERN_OP_GREATER_EQUAL:
+        case INTERN_OP_LOGICAL_AND:
+        case INTERN_OP_LOGICAL_OR:
+            return width_make(0, 1);
+        default:
+            break;
+    }
+    if (!left.known || !right.known)
+    {
+        return width_unknown();
+    }
+
+    switch (operator_id)
+    {
+        case INTERN_OP_PLUS:
+            return width_make(left.low + right.low, left.high + right.high);
+
+        case INTERN_OP_MINUS:
+            return width_make(left.low - right.high, left.high - right.low);
+
+        case INTERN_OP_MULTIPLY:
+            return width_multiply(left, right);
+
+        case INTERN_OP_DIVIDE:
+            // C division truncates, which is monotonic for a fixed divisor
+            if (!width_is_constant(right) || divisor == 0)
+            {
+                return width_full();
+            }
+            return (divisor > 0) ? width_make(left.low / divisor, left.high / divisor)
+                                 : width_make(left.high / divisor, left.low / divisor);
+
+        case INTERN_OP_MODULO:
+        {
+            int64_t largest = 0;
+
+            // The remainder takes the sign of the dividend
+            if (!width_is_constant(right) || divisor == 0)
+            {
+                return width_full();
+            }
+            largest = ((divisor < 0) ? -divisor : divisor) - 1;
+            return width_make((left.low >= 0) ? 0 : (left.low > -largest ? left.low : -largest),
+                              (left.high <= 0) ? 0 : (left.high < largest ? left.high : largest));
+        }
+
+        case INTERN_OP_BITWISE_AND:
+            if (left.low >= 0 && right.low >= 0)
+            {
+                return width_make(0, left.high < right.high ? left.high : right.high);
+            }
+            if (left.low >= 0 || right.low >= 0)
+            {
+                return width_make(0, (left.low >= 0) ? left.high : right.high);
+            }
+            return width_full();
+
+        case INTERN_OP_BITWISE_OR:
+        case INTERN_OP_BITWISE_XOR:
+            if (left.low >= 0 && right.low >= 0)
+            {
+                return width_make(0, width_mask_above(left.high > right.high ? left.high : right.high));
+            }
+            return width_full();
+
+        case INTERN_OP_SHIFT_LEFT:
+            if (!width_is_constant(right) || divisor < 0 || divisor >= VHDL_BIT_WIDTH || left.low < 0)
+            {
+                return width_full();
+            }
+            return width_make(left.low << divisor, left.high << divisor);
+
+        case INTERN_OP_SHIFT_RIGHT:
+            if (!width_is_constant(right) || divisor < 0 || divisor >= VHDL_BIT_WIDTH || left.low < 0)
+            {
+                return width_full();
+            }
+            return width_make(left.low >> divisor, left.high >> divisor);
+
+        default:
+            return width_full();
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: candidate lookup by name (-1 if none)
+// -------------------------------------------------------------
+static int width_find_candidate(const WidthAnalysis *analysis, InternId name_id)
+{
+    for (int index = 0; index < analysis->candidate_count; ++index)
+    {
+        if (analysis->candidates[index].name_id == name_id)
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+static const WidthSignal* width_find_signal(const WidthPlan *plan, InternId name_id, int is_array)
+{
+    if (plan == NULL || name_id == INTERN_NONE)
+    {
+        return NULL;
+    }
+    for (int index = 0; index < plan->signal_count; ++index)
+    {
+        if (plan->signals[index].name_id == name_id && plan->signals[index].is_array == is_array)
+        {
+            return &plan->signals[index];
+        }
+    }
+    return NULL;
+}
+
+// -------------------------------------------------------------
+// Helper: range of the value of an expression
+// -------------------------------------------------------------
+static WidthRange width_range_of(const WidthAnalysis *analysis, const WidthPlan *plan, const ASTNode *node)
+{
+    const char *text = NULL;
+
+    if (node == NULL)
+    {
+        return width_full();
+    }
+
+    switch (node->type)
+    {
+        case NODE_EXPRESSION:
+        {
+            char *end = NULL;
+            long long literal = 0;
+            int candidate = -1;
+            const WidthSignal *signal = NULL;
+
+            text = node->value;
+            if (text == NULL)
+            {
+                return width_full();
+            }
+            if (is_number_str(text))
+            {
+                literal = strtoll(text, &end, 10);
+                return (*end == '\0') ? width_make(literal, literal) : width_full();
+            }
+            candidate = width_find_candidate(analysis, intern_find(text, strlen(text)));
+            if (candidate >= 0 && !analysis->candidates[candidate].excluded)
+            {
+                return analysis->candidates[candidate].range;
+            }
+            signal = width_find_signal(plan, intern_find(text, strlen(text)), 0);
+            if (signal != NULL && signal->width < VHDL_BIT_WIDTH)
+            {
+                return signal->is_signed ? width_make(-((int64_t)1 << (signal->width - 1)),
+                                                      ((int64_t)1 << (signal->width - 1)) - 1)
+                                         : width_make(0, ((int64_t)1 << signal->width) - 1);
+            }
+            return width_full();
+        }
+
+        case NODE_UNARY_EXPR:
+        {
+            WidthRange operand = width_unknown();
+            InternId operator_id = INTERN_NONE;
+
+            if (node->value == NULL || node->num_children != 1)
+            {
+                return width_full();
+            }
+            operator_id = node->token.id;
+            if (operator_id == INTERN_OP_LOGICAL_NOT)
+            {
+                return width_make(0, 1);
+            }
+            operand = width_range_of(analysis, plan, node->children[FIRST_CHILD_INDEX]);
+            if (!operand.known)
+            {
+                return operand;
+            }
+            if (operator_id == INTERN_OP_MINUS)
+            {
+                return width_make(-operand.high, -operand.low);
+            }
+            if (operator_id == INTERN_OP_BITWISE_NOT)
+            {
+                return width_make(~operand.high, ~operand.low);
+            }
+            return width_full();
+        }
+
+        case NODE_BINARY_EXPR:
+            if (node->value == NULL || node->num_children != 2)
+            {
+                return width_full();
+            }
+            return width_binary(node->token.id,
+                                width_range_of(analysis, plan, node->children[FIRST_CHILD_INDEX]),
+                                width_range_of(analysis, plan, node->children[FIRST_CHILD_INDEX + 1]));
+
+        default:
+            // Array elements, struct fields and calls: anything an int holds
+            return width_full();
+    }
+}
+
+// -------------------------------------------------------------
+// Collection
+// -------------------------------------------------------------
+static void width_add_candidate(WidthAnalysis *analysis, const char *name, ASTNode *declaration)
+{
+    InternId name_id = intern_cstr(name);
+    int existing = width_find_candidate(analysis, name_id);
+    WidthCandidate *candidate = NULL;
+
+    if (existing >= 0)
+    {
+        analysis->candidates[existing].excluded = 1;
+        return;
+    }
+    if (analysis->candidate_count == analysis->candidate_capacity)
+    {
+        analysis->candidate_capacity = analysis->candidate_capacity ? analysis->candidate_capacity * 2 : 8;
+        analysis->candidates = xrealloc(analysis->candidates,
+                                        (size_t)analysis->candidate_capacity * sizeof(WidthCandidate));
+    }
+    candidate = &analysis->candidates[analysis->candidate_count++];
+    candidate->name_id = name_id;
+    candidate->declaration = declaration;
+    candidate->excluded = (declaration == NULL || declaration->token.id != INTERN_KW_INT);
+    candidate->range = width_unknown();
+}
+
+static void width_add_definition(WidthAnalysis *analysis, const char *name, const ASTNode *value, WidthRange range)
+{
+    WidthDefinition *definition = NULL;
+
+    if (analysis->definition_count == analysis->definition_capacity)
+    {
+        analysis->definition_capacity = analysis->definition_capacity ? analysis->definition_capacity * 2 : 16;
+        analysis->definitions = xrealloc(analysis->definitions,
+                                         (size_t)analysis->definition_capacity * sizeof(WidthDefinition));
+    }
+    definition = &analysis->definitions[analysis->definition_count++];
+    definition->name_id = intern_cstr(name);
+    definition->value = value;
+    definition->range = range;
+}
+
+static void width_collect(WidthAnalysis *analysis, ASTNode *node)
+{
+    LoopBounds bounds;
+    int64_t final_value = 0;
+
+    if (node == NULL)
+    {
+        return;
+    }
+
+    switch (node->type)
+    {
+        case NODE_VAR_DECL:
+            // Arrays and structs keep their types; other scalars only shadow
+            if (node->value != NULL && node->array_size == 0)
+            {
+                width_add_candidate(analysis, node->value, node);
+                if (node->num_children > 0)
+                {
+                    width_add_definition(analysis, node->value, node->children[FIRST_CHILD_INDEX], width_unknown());
+                }
+            }
+            return;
+
+        case NODE_ASSIGNMENT:
+            if (node->num_children == 2 && node->children[FIRST_CHILD_INDEX]->type == NODE_EXPRESSION &&
+                node->children[FIRST_CHILD_INDEX]->value != NULL)
+            {
+                width_add_definition(analysis, node->children[FIRST_CHILD_INDEX]->value,
+                                     node->children[FIRST_CHILD_INDEX + 1], width_unknown());
+            }
+            return;
+
+        case NODE_FOR_STATEMENT:
+            if (!analyze_for_loop(node, &bounds))
+            {
+                break;
+            }
+
+            // A constant-trip counter runs from start to its final value;
+            // the init and increment add nothing beyond that
+            final_value = bounds.start + bounds.trip_count * bounds.step;
+            width_add_definition(analysis, bounds.variable, NULL,
+                                 width_make(bounds.start < final_value ? bounds.start : final_value,
+                                            bounds.start > final_value ? bounds.start : final_value));
+            if (node->children[FIRST_CHILD_INDEX]->type == NODE_VAR_DECL)
+            {
+                width_add_candidate(analysis, bounds.variable, node->children[FIRST_CHILD_INDEX]);
+            }
+            for (int child_index = FIRST_STATEMENT_INDEX; child_index < node->num_children - 1; ++child_index)
+            {
+                width_collect(analysis, node->children[child_index]);
+            }
+            return;
+
+        default:
+            break;
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        width_collect(analysis, node->children[child_index]);
+    }
+}
+
+// -------------------------------------------------------------
+// Helper: bits needed for a range (signed when it reaches below zero)
+// -------------------------------------------------------------
+static int width_bits(WidthRange range, int *is_signed)
+{
+    int width = 1;
+
+    *is_signed = (range.low < 0);
+    if (!*is_signed)
+    {
+        while (width < VHDL_BIT_WIDTH && (range.high >> width) != 0)
+        {
+            width++;
+        }
+        return width;
+    }
+    while (width < VHDL_BIT_WIDTH &&
+           (range.low < -((int64_t)1 << (width - 1)) || range.high > ((int64_t)1 << (width - 1)) - 1))
+    {
+        width++;
+    }
+    return width;
+}
+
+// -------------------------------------------------------------
+// Helper: range analysis and retyping of the int locals
+// -------------------------------------------------------------
+static int width_narrow_locals(ASTNode *function, WidthPlan *plan)
+{
+    WidthAnalysis analysis;
+    int changed = 1;
+    int narrowed = 0;
+
+    memset(&analysis, 0, sizeof(analysis));
+    for (int child_index = 0; child_index < function->num_children; ++child_index)
+    {
+        ASTNode *child = function->children[child_index];
+
+        if (child->type == NODE_VAR_DECL && child->value != NULL)
+        {
+            width_add_candidate(&analysis, child->value, NULL);
+        }
+        else if (child->type == NODE_STATEMENT)
+        {
+            width_collect(&analysis, child);
+        }
+    }
+
+    for (int pass = 0; changed; ++pass)
+    {
+        changed = 0;
+        for (int definition_index = 0; definition_index < analysis.definition_count; ++definition_index)
+        {
+            const WidthDefinition *definition = &analysis.definitions[definition_index];
+            int candidate_index = width_find_candidate(&analysis, definition->name_id);
+            WidthCandidate *candidate = NULL;
+            WidthRange value = width_unknown();
+            WidthRange joined = width_unknown();
+
+            if (candidate_index < 0 || analysis.candidates[candidate_index].excluded)
+            {
+                continue;
+            }
+            candidate = &analysis.candidates[candidate_index];
+            value = (definition->value != NULL) ? width_range_of(&analysis, plan, definition->value)
+                                                : definition->range;
+            joined = width_join(candidate->range, value);
+            if (joined.known != candidate->range.known || joined.low != candidate->range.low ||
+                joined.high != candidate->range.high)
+            {
+                candidate->range = (pass >= WIDTH_MAX_PASSES) ? width_full() : joined;
+                changed = 1;
+            }
+        }
+    }
+
+    for (int candidate_index = 0; candidate_index < analysis.candidate_count; ++candidate_index)
+    {
+        const WidthCandidate *candidate = &analysis.candidates[candidate_index];
+        char type_name[WIDTH_TYPE_NAME_SIZE];
+        int is_signed = 0;
+        int width = 0;
+
+        // Never assigned: nothing to go by
+        if (candidate->excluded || !candidate->range.known)
+        {
+            continue;
+        }
+        width = width_bits(candidate->range, &is_signed);
+        if (width >= VHDL_BIT_WIDTH)
+        {
+            continue;
+        }
+
+        if (plan->retyped_count == plan->retyped_capacity)
+        {
+            plan->retyped_capacity = plan->retyped_capacity ? plan->retyped_capacity * 2 : 8;
+            plan->retyped = xrealloc(plan->retyped, (size_t)plan->retyped_capacity * sizeof(WidthRetype));
+        }
+        plan->retyped[plan->retyped_count].declaration = candidate->declaration;
+        plan->retyped[plan->retyped_count].type_id = candidate->declaration->token.id;
+        plan->retyped_count++;
+        snprintf(type_name, sizeof(type_name), "%sint%d_t", is_signed ? "" : "u", width);
+        candidate->declaration->token.id = intern_cstr(type_name);
+        narrowed++;
+    }
+
+    free(analysis.candidates);
+    free(analysis.definitions);
+    return narrowed;
+}
+
+// -------------------------------------------------------------
+// Helper: record the explicit-width declarations below node
+// -------------------------------------------------------------
+static void width_collect_signals(WidthPlan *plan, const ASTNode *node)
+{
+    if (node->type == NODE_VAR_DECL && node->value != NULL)
+    {
+        int is_signed = 0;
+        int width = ctype_explicit_width(token_text(node->token), &is_signed);
+        InternId name_id = intern_cstr(node->value);
+        int is_array = (node->array_size > 0);
+
+        if (width > 0 && width != VHDL_BIT_WIDTH && width_find_signal(plan, name_id, is_array) == NULL)
+        {
+            if (plan->signal_count == plan->signal_capacity)
+            {
+                plan->signal_capacity = plan->signal_capacity ? plan->signal_capacity * 2 : 8;
+                plan->signals = xrealloc(plan->signals, (size_t)plan->signal_capacity * sizeof(WidthSignal));
+            }
+            plan->signals[plan->signal_count].name_id = name_id;
+            plan->signals[plan->signal_count].width = width;
+            plan->signals[plan->signal_count].is_signed = is_signed;
+            plan->signals[plan->signal_count].is_array = is_array;
+            plan->signal_count++;
+        }
+        return;
+    }
+
+    for (int child_index = 0; child_index < node->num_children; ++child_index)
+    {
+        width_collect_signals(plan, node->children[child_index]);
+    }
+}
+
+// -------------------------------------------------------------
+// Width plan
+// -------------------------------------------------------------
+int width_plan_function(ASTNode *function, int infer, WidthPlan *plan)
+{
+    int narrowed = 0;
+    int width = 0;
+
+    memset(plan, 0, sizeof(*plan));
+
+    // Declared widths first: they bound what the int locals computed from them hold
+    width_collect_signals(plan, function);
+    if (infer)
+    {
+        narrowed = width_narrow_locals(function, plan);
+        width_collect_signals(plan, function);
+    }
+
+    width = ctype_explicit_width(token_text(function->token), &plan->result_signed);
+    plan->result_width = (width != VHDL_BIT_WIDTH) ? width : 0;
+    return narrowed;
+}
+
+void width_plan_free(WidthPlan *plan)
+{
+    for (int index = plan->retyped_count - 1; index >= 0; --index)
+    {
+        plan->retyped[index].declaration->token.id = plan->retyped[index].type_id;
+    }
+    free(plan->signals);
+    free(plan->retyped);
+    memset(plan, 0, sizeof(*plan));
+}
+
+const WidthPlan* width_plan_activate(const WidthPlan *plan)
+{
+    const WidthPlan *previous = s_active_plan;
+
+    s_active_plan = plan;
+    return previous;
+}
+
+// -------------------------------------------------------------
+// Lookups of the active plan
+// -------------------------------------------------------------
+static int width_lookup(const char *name, int is_array, int *is_signed)
+{
+    const WidthSignal *signal = NULL;
+
+    if (s_active_plan == NULL || name == NULL)
+    {
+        return 0;
+    }
+    signal = width_find_signal(s_active_plan, intern_find(name, strlen(name)), is_array);
+    if (signal == NULL)
+    {
+        return 0;
+    }
+    if (is_signed != NULL)
+    {
+        *is_signed = signal->is_signed;
+    }
+    return signal->width;
+}
+
+int width_of_signal(const char *name, int *is_signed)
+{
+    return width_lookup(name, 0, is_signed);
+}
+
+int width_of_array(const char *name, int *is_signed)
+{
+    return width_lookup(name, 1, is_signed);
+}
+
+int width_of_result(int *is_signed)
+{
+    if (s_active_plan == NULL)
+    {
+        return 0;
+    }
+    if (is_signed != NULL)
+    {
+        *is_signed = s_active_plan->result_signed;
+    }
+    return s_active_plan->result_width;
+}
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+void emit_width_fitted(ASTNode *value, int width, int is_signed, OutputBuffer *out,
+                       void (*node_generator)(ASTNode*, OutputBuffer*))
+{
+    int value_is_signed = 0;
+
+    if (width <= 0 || width == VHDL_BIT_WIDTH || is_node_boolean_expression(value) ||
+        (value->type == NODE_EXPRESSION && is_numeric_literal(value->value)))
+    {
+        node_generator(value, out);
+        return;
+    }
+
+    // Same width on both sides: a plain copy
+    if (value->type == NODE_EXPRESSION && width_of_signal(value->value, &value_is_signed) == width &&
+        value_is_signed == is_signed)
+    {
+        emit_mapped_signal_name(value->value, out);
+        return;
+    }
+
+    out_printf(out, "std_logic_vector(resize(%s(", is_signed ? "signed" : "unsigned");
+    node_generator(value, out);
+    out_printf(out, "), %d))", width);
+}
+
+void emit_width_extension_begin(int is_signed, OutputBuffer *out)
+{
+    out_printf(out, "std_logic_vector(resize(%s(", is_signed ? "signed" : "unsigned");
+}
+
+void emit_width_extension_end(OutputBuffer *out)
+{
+    out_printf(out, "), %d))", VHDL_BIT_WIDTH);
+}
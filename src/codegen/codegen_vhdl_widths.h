@@ -0,0 +1,86 @@
+// VHDL Code Generator - Bit Widths
+// -------------------------------------------------------------
+// Purpose: Size signals to the values they hold: explicit-width integers
+//          (intN_t, uintN_t, _BitInt(N)) keep their N bits, and with
+//          --narrow-widths int locals shrink to the range they can reach
+// -------------------------------------------------------------
+
+#ifndef CODEGEN_VHDL_WIDTHS_H
+#define CODEGEN_VHDL_WIDTHS_H
+
+#include "output_buffer.h"
+#include "astnode.h"
+#include "intern.h"
+
+// -------------------------------------------------------------
+// Width plan
+// -------------------------------------------------------------
+// A signal whose width is not the 32 bits of int
+typedef struct {
+    InternId name_id;
+    int width;
+    int is_signed;
+    int is_array;              // Width of the elements
+} WidthSignal;
+
+// A narrowed int declaration and the type it was parsed with
+typedef struct {
+    ASTNode *declaration;
+    InternId type_id;
+} WidthRetype;
+
+typedef struct {
+    WidthSignal *signals;
+    int signal_count;
+    int signal_capacity;
+    WidthRetype *retyped;      // Declarations whose type token was swapped
+    int retyped_count;
+    int retyped_capacity;
+    int result_width;          // Width of the result port
+    int result_signed;
+} WidthPlan;
+
+/**
+ * Collect the explicit-width signals of a function (ports and locals).
+ * With infer set, first bound every scalar int local declared once by a
+ * value-range analysis over all of its assignments and retype the ones that
+ * fit fewer bits as intW_t / uintW_t; loop counters of constant-trip for
+ * loops reach [start, final].
+ *
+ * @return Number of int locals narrowed (plan still needs width_plan_free,
+ *         which restores their types)
+ */
+int width_plan_function(ASTNode *function, int infer, WidthPlan *plan);
+
+void width_plan_free(WidthPlan *plan);
+
+// Make plan the one the emitters consult on this thread (NULL = none);
+// returns the previously active plan
+const WidthPlan* width_plan_activate(const WidthPlan *plan);
+
+// -------------------------------------------------------------
+// Emission
+// -------------------------------------------------------------
+// Width of a scalar signal in the active plan, 0 if it is a plain int
+int width_of_signal(const char *name, int *is_signed);
+
+// Width of the elements of an array signal, 0 if they are plain ints
+int width_of_array(const char *name, int *is_signed);
+
+// Width of the result port of the function being generated, 0 if it is int
+int width_of_result(int *is_signed);
+
+/**
+ * Emit value for a target of width bits: expressions are computed at 32
+ * bits and resized (wrapping like the C conversion); literals, booleans and
+ * signals of the target width are emitted unchanged.
+ */
+void emit_width_fitted(ASTNode *value, int width, int is_signed, OutputBuffer *out,
+                       void (*node_generator)(ASTNode*, OutputBuffer*));
+
+// Wrap a read of a narrower signal, extending it to the 32 bits that
+// expressions are computed at
+void emit_width_extension_begin(int is_signed, OutputBuffer *out);
+void emit_width_extension_end(OutputBuffer *out);
+
+#endif // CODEGEN_VHDL_WIDTHS_H
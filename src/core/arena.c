@@ -0,0 +1,89 @@
+#include "arena.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stdint.h>
+
+#define ARENA_ALIGNMENT (alignof(max_align_t))
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t used;
+    size_t capacity;
+    alignas(max_align_t) unsigned char bytes[];
+};
+
+static size_t align_up(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+void arena_init(Arena *arena, size_t block_size)
+{
+    arena->head = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->bytes_allocated = 0;
+    arena->bytes_reserved = 0;
+}
+
+// Start a new block able to hold at least `size` bytes
+static ArenaBlock* arena_grow(Arena *arena, size_t size)
+{
+    size_t capacity = arena->block_size;
+    ArenaBlock *block = NULL;
+
+    if (size > capacity) {
+        capacity = size;
+    }
+
+    block = (ArenaBlock*)xrealloc(NULL, sizeof(ArenaBlock) + capacity);
+
+    block->next = arena->head;
+    block->used = 0;
+    block->capacity = capacity;
+    arena->head = block;
+    arena->bytes_reserved += capacity;
+    return block;
+}
+
+void* arena_alloc(Arena *arena, size_t size)
+{
+    ArenaBlock *block = arena->head;
+    size_t rounded = align_up(size ? size : 1);
+    void *memory = NULL;
+
+    if (!block || block->capacity - block->used < rounded) {
+        block = arena_grow(arena, rounded);
+    }
+
+    memory = block->bytes + block->used;
+    block->used += rounded;
+    arena->bytes_allocated += rounded;
+    return memory;
+}
+
+char* arena_strdup(Arena *arena, const char *text)
+{
+    size_t length = strlen(text);
+    char *copy = (char*)arena_alloc(arena, length + 1);
+
+    memcpy(copy, text, length + 1);
+    return copy;
+}
+
+void arena_release(Arena *arena)
+{
+    ArenaBlock *block = arena->head;
+
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->head = NULL;
+    arena->bytes_allocated = 0;
+    arena->bytes_reserved = 0;
+}
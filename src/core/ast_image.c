@@ -0,0 +1,342 @@
+#include "ast_image.h"
+#include "utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define AST_IMAGE_ALIGNMENT 4
+#define AST_IMAGE_INITIAL_CAPACITY 256
+#define AST_IMAGE_FNV_OFFSET 2166136261u
+#define AST_IMAGE_FNV_PRIME 16777619u
+
+// -------------------------------------------------------------
+// Writing
+// -------------------------------------------------------------
+
+// Strings of an image being written; equal texts share one entry
+typedef struct {
+    AstImageString *entries;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *slots;           // Open-addressed entry index + 1 (0 = empty)
+    uint32_t slot_count;       // Power of two
+    OutputBuffer text;
+} AstStringPool;
+
+static uint32_t ast_string_hash(const char *text, size_t length)
+{
+    uint32_t hash = AST_IMAGE_FNV_OFFSET;
+
+    for (size_t index = 0; index < length; index++) {
+        hash = (hash ^ (unsigned char)text[index]) * AST_IMAGE_FNV_PRIME;
+    }
+    return hash;
+}
+
+static void ast_pool_rehash(AstStringPool *pool)
+{
+    uint32_t slot_count = pool->slot_count ? pool->slot_count * 2 : AST_IMAGE_INITIAL_CAPACITY;
+
+    free(pool->slots);
+    pool->slots = (uint32_t*)xrealloc(NULL, slot_count * sizeof(uint32_t));
+    memset(pool->slots, 0, slot_count * sizeof(uint32_t));
+    pool->slot_count = slot_count;
+    for (uint32_t entry = 0; entry < pool->count; entry++) {
+        const AstImageString *string = &pool->entries[entry];
+        uint32_t slot = ast_string_hash(pool->text.data + string->offset, string->length) & (slot_count - 1);
+
+        while (pool->slots[slot]) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        pool->slots[slot] = entry + 1;
+    }
+}
+
+static uint32_t ast_pool_add(AstStringPool *pool, const char *text)
+{
+    size_t length = 0;
+    uint32_t slot = 0;
+
+    if (!text) {
+        return AST_IMAGE_NONE;
+    }
+    length = strlen(text);
+    if ((pool->count + 1) * 2 > pool->slot_count) {
+        ast_pool_rehash(pool);
+    }
+
+    slot = ast_string_hash(text, length) & (pool->slot_count - 1);
+    while (pool->slots[slot]) {
+        const AstImageString *string = &pool->entries[pool->slots[slot] - 1];
+
+        if (string->length == length && memcmp(pool->text.data + string->offset, text, length) == 0) {
+            return pool->slots[slot] - 1;
+        }
+        slot = (slot + 1) & (pool->slot_count - 1);
+    }
+
+    if (pool->count >= pool->capacity) {
+        pool->capacity = pool->capacity ? pool->capacity * 2 : AST_IMAGE_INITIAL_CAPACITY;
+        pool->entries = (AstImageString*)xrealloc(pool->entries, pool->capacity * sizeof(AstImageString));
+    }
+    pool->entries[pool->count].offset = (uint32_t)pool->text.length;
+    pool->entries[pool->count].length = (uint32_t)length;
+    out_write(&pool->text, text, length + 1);
+    pool->slots[slot] = pool->count + 1;
+    return pool->count++;
+}
+
+void ast_image_write(const ASTNode *program, const StructTable *structs, OutputBuffer *out)
+{
+    AstImageHeader header;
+    AstStringPool pool;
+    const ASTNode **queue = NULL;
+    AstImageNode *nodes = NULL;
+    AstImageStruct *struct_records = NULL;
+    AstImageField *fields = NULL;
+    uint32_t node_count = 0;
+    uint32_t field_count = 0;
+    size_t queue_capacity = AST_IMAGE_INITIAL_CAPACITY;
+    static const char padding[AST_IMAGE_ALIGNMENT] = {0};
+
+    memset(&pool, 0, sizeof(pool));
+    output_buffer_init(&pool.text, NULL);
+
+    // Breadth-first, so every node's children get consecutive indices
+    queue = (const ASTNode**)xrealloc(NULL, queue_capacity * sizeof(ASTNode*));
+    if (program) {
+        queue[node_count++] = program;
+    }
+    nodes = (AstImageNode*)xrealloc(NULL, queue_capacity * sizeof(AstImageNode));
+    for (uint32_t node_idx = 0; node_idx < node_count; node_idx++) {
+        const ASTNode *node = queue[node_idx];
+        AstImageNode *record = NULL;
+
+        if (node_count + (size_t)node->num_children > queue_capacity) {
+            while (node_count + (size_t)node->num_children > queue_capacity) {
+                queue_capacity *= 2;
+            }
+            queue = (const ASTNode**)xrealloc((void*)queue, queue_capacity * sizeof(ASTNode*));
+            nodes = (AstImageNode*)xrealloc(nodes, queue_capacity * sizeof(AstImageNode));
+        }
+
+        record = &nodes[node_idx];
+        memset(record, 0, sizeof(*record));
+        record->type = (uint8_t)node->type;
+        record->token_type = (uint8_t)node->token.type;
+        record->token_line = node->token.line;
+        record->token_offset = node->token.offset;
+        record->token_length = node->token.length;
+        record->token_text = ast_pool_add(&pool, token_text(node->token));
+        record->value = ast_pool_add(&pool, node->value);
+        record->array_size = node->array_size;
+        record->first_child = node->num_children > 0 ? node_count : 0;
+        record->child_count = (uint32_t)node->num_children;
+        for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+            queue[node_count++] = node->children[child_idx];
+        }
+    }
+
+    struct_records = (AstImageStruct*)xrealloc(NULL, (size_t)structs->count * sizeof(AstImageStruct));
+    for (int struct_idx = 0; struct_idx < structs->count; struct_idx++) {
+        field_count += (uint32_t)structs->items[struct_idx].field_count;
+    }
+    fields = (AstImageField*)xrealloc(NULL, field_count * sizeof(AstImageField));
+    field_count = 0;
+    for (int struct_idx = 0; struct_idx < structs->count; struct_idx++) {
+        const StructInfo *info = &structs->items[struct_idx];
+
+        struct_records[struct_idx].name = ast_pool_add(&pool, info->name);
+        struct_records[struct_idx].first_field = field_count;
+        struct_records[struct_idx].field_count = (uint32_t)info->field_count;
+        for (int field_idx = 0; field_idx < info->field_count; field_idx++) {
+            fields[field_count].name = ast_pool_add(&pool, info->fields[field_idx].field_name);
+            fields[field_count].type = ast_pool_add(&pool, info->fields[field_idx].field_type);
+            field_count++;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, AST_IMAGE_MAGIC, AST_IMAGE_MAGIC_SIZE);
+    header.version = AST_IMAGE_VERSION;
+    header.byte_order = AST_IMAGE_BYTE_ORDER;
+    header.node_count = node_count;
+    header.node_offset = sizeof(header);
+    header.string_count = pool.count;
+    header.string_offset = header.node_offset + node_count * sizeof(AstImageNode);
+    header.struct_count = (uint32_t)structs->count;
+    header.struct_offset = header.string_offset + pool.count * sizeof(AstImageString);
+    header.field_count = field_count;
+    header.field_offset = header.struct_offset + header.struct_count * sizeof(AstImageStruct);
+    header.text_size = (uint32_t)pool.text.length;
+    header.text_offset = header.field_offset + field_count * sizeof(AstImageField);
+
+    out_write(out, (const char*)&header, sizeof(header));
+    out_write(out, (const char*)nodes, node_count * sizeof(AstImageNode));
+    out_write(out, (const char*)pool.entries, pool.count * sizeof(AstImageString));
+    out_write(out, (const char*)struct_records, header.struct_count * sizeof(AstImageStruct));
+    out_write(out, (const char*)fields, field_count * sizeof(AstImageField));
+    out_write(out, pool.text.data ? pool.text.data : "", pool.text.length);
+    out_write(out, padding, (AST_IMAGE_ALIGNMENT - pool.text.length % AST_IMAGE_ALIGNMENT) % AST_IMAGE_ALIGNMENT);
+
+    free((void*)queue);
+    free(nodes);
+    free(struct_records);
+    free(fields);
+    free(pool.entries);
+    free(pool.slots);
+    output_buffer_free(&pool.text);
+}
+
+// -------------------------------------------------------------
+// Reading
+// -------------------------------------------------------------
+
+int ast_image_recognize(const void *data, size_t length)
+{
+    return length >= AST_IMAGE_MAGIC_SIZE && memcmp(data, AST_IMAGE_MAGIC, AST_IMAGE_MAGIC_SIZE) == 0;
+}
+
+// Helper: count records of size bytes at offset lie within length bytes
+static int ast_section_fits(uint32_t offset, uint32_t count, size_t size, size_t length)
+{
+    return offset % AST_IMAGE_ALIGNMENT == 0 && (uint64_t)offset + (uint64_t)count * size <= length;
+}
+
+static int ast_string_valid(const AstImageHeader *header, uint32_t string_index, int optional)
+{
+    return string_index < header->string_count || (optional && string_index == AST_IMAGE_NONE);
+}
+
+int ast_image_open(AstImage *image, const void *data, size_t length)
+{
+    const AstImageHeader *header = (const AstImageHeader*)data;
+    const char *bytes = (const char*)data;
+    uint32_t next_child = 1;
+
+    memset(image, 0, sizeof(*image));
+    if ((uintptr_t)data % AST_IMAGE_ALIGNMENT != 0 || length < sizeof(*header) ||
+        !ast_image_recognize(data, length) || header->version != AST_IMAGE_VERSION ||
+        header->byte_order != AST_IMAGE_BYTE_ORDER || header->node_count == 0 ||
+        !ast_section_fits(header->node_offset, header->node_count, sizeof(AstImageNode), length) ||
+        !ast_section_fits(header->string_offset, header->string_count, sizeof(AstImageString), length) ||
+        !ast_section_fits(header->struct_offset, header->struct_count, sizeof(AstImageStruct), length) ||
+        !ast_section_fits(header->field_offset, header->field_count, sizeof(AstImageField), length) ||
+        !ast_section_fits(header->text_offset, header->text_size, 1, length)) {
+        return 0;
+    }
+
+    image->header = header;
+    image->nodes = (const AstImageNode*)(bytes + header->node_offset);
+    image->strings = (const AstImageString*)(bytes + header->string_offset);
+    image->structs = (const AstImageStruct*)(bytes + header->struct_offset);
+    image->fields = (const AstImageField*)(bytes + header->field_offset);
+    image->text = bytes + header->text_offset;
+
+    for (uint32_t string_idx = 0; string_idx < header->string_count; string_idx++) {
+        const AstImageString *string = &image->strings[string_idx];
+
+        if ((uint64_t)string->offset + string->length >= header->text_size ||
+            image->text[string->offset + string->length] != '\0') {
+            return 0;
+        }
+    }
+
+    // Child runs must tile nodes 1.. in order: a tree with children after parents
+    if (image->nodes[0].type != NODE_PROGRAM) {
+        return 0;
+    }
+    for (uint32_t node_idx = 0; node_idx < header->node_count; node_idx++) {
+        const AstImageNode *node = &image->nodes[node_idx];
+
+        if (node->type > NODE_MEMBER_EXPR || node->token_type > TOKEN_EOF || node->array_size < 0 ||
+            !ast_string_valid(header, node->token_text, 0) || !ast_string_valid(header, node->value, 1)) {
+            return 0;
+        }
+        if (node->child_count > 0) {
+            if (node->first_child != next_child || node->child_count > header->node_count - next_child) {
+                return 0;
+            }
+            next_child += node->child_count;
+        }
+    }
+    if (next_child != header->node_count) {
+        return 0;
+    }
+
+    for (uint32_t struct_idx = 0; struct_idx < header->struct_count; struct_idx++) {
+        const AstImageStruct *record = &image->structs[struct_idx];
+
+        if (!ast_string_valid(header, record->name, 0) ||
+            (uint64_t)record->first_field + record->field_count > header->field_count) {
+            return 0;
+        }
+    }
+    for (uint32_t field_idx = 0; field_idx < header->field_count; field_idx++) {
+        if (!ast_string_valid(header, image->fields[field_idx].name, 0) ||
+            !ast_string_valid(header, image->fields[field_idx].type, 0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+const char* ast_image_string(const AstImage *image, uint32_t string_index)
+{
+    if (string_index == AST_IMAGE_NONE) {
+        return NULL;
+    }
+    return image->text + image->strings[string_index].offset;
+}
+
+ASTNode* ast_image_load(const AstImage *image, Arena *arena, StructTable *structs)
+{
+    const AstImageHeader *header = image->header;
+    ASTNode *nodes = (ASTNode*)arena_alloc(arena, header->node_count * sizeof(ASTNode));
+    ASTNode **links = (ASTNode**)arena_alloc(arena, header->node_count * sizeof(ASTNode*));
+    char *text = (char*)arena_alloc(arena, header->text_size ? header->text_size : 1);
+    InternId *ids = (InternId*)xrealloc(NULL, header->string_count * sizeof(InternId));
+
+    // Only lexemes need interning, each distinct one once
+    memset(ids, 0, header->string_count * sizeof(InternId));
+    memcpy(text, image->text, header->text_size);
+    nodes[0].parent = NULL;
+    for (uint32_t node_idx = 0; node_idx < header->node_count; node_idx++) {
+        const AstImageNode *record = &image->nodes[node_idx];
+        const AstImageString *lexeme = &image->strings[record->token_text];
+        ASTNode *node = &nodes[node_idx];
+
+        // The empty lexeme (EOF) stays INTERN_NONE like a scanned one
+        if (ids[record->token_text] == INTERN_NONE && lexeme->length > 0) {
+            ids[record->token_text] = intern_string(image->text + lexeme->offset, lexeme->length);
+        }
+        node->type = (NodeType)record->type;
+        node->token.offset = record->token_offset;
+        node->token.length = record->token_length;
+        node->token.id = ids[record->token_text];
+        node->token.line = record->token_line;
+        node->token.type = record->token_type;
+        node->value = (record->value == AST_IMAGE_NONE) ? NULL : text + image->strings[record->value].offset;
+        node->children = record->child_count > 0 ? &links[record->first_child] : NULL;
+        node->num_children = (int)record->child_count;
+        node->capacity = (int)record->child_count;
+        node->array_size = record->array_size;
+        node->arena = arena;
+        for (uint32_t child_idx = 0; child_idx < record->child_count; child_idx++) {
+            links[record->first_child + child_idx] = &nodes[record->first_child + child_idx];
+            nodes[record->first_child + child_idx].parent = node;
+        }
+    }
+    free(ids);
+
+    struct_table_reset(structs);
+    for (uint32_t struct_idx = 0; struct_idx < header->struct_count; struct_idx++) {
+        const AstImageStruct *record = &image->structs[struct_idx];
+        int registered = struct_table_register(structs, ast_image_string(image, record->name));
+
+        for (uint32_t field_idx = record->first_field; field_idx < record->first_field + record->field_count; field_idx++) {
+            struct_table_add_field(structs, registered, ast_image_string(image, image->fields[field_idx].name),
+                                   ast_image_string(image, image->fields[field_idx].type));
+        }
+    }
+    return &nodes[0];
+}
@@ -1,48 +1,130 @@
 #include "astnode.h"
+#include "utils.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+_Static_assert(sizeof(void*) != 8 || sizeof(ASTNode) == 64, "ASTNode is expected to fill one 64-byte line");
+
+// Arena receiving new nodes on this thread (NULL = heap)
+static _Thread_local Arena *s_active_arena = NULL;
+
+Arena* ast_use_arena(Arena *arena)
+{
+    Arena *previous = s_active_arena;
+    s_active_arena = arena;
+    return previous;
+}
 
 // Create a new AST node
 ASTNode* create_node(NodeType type)
 {
 
-    ASTNode *node = (ASTNode*)malloc(sizeof(ASTNode));
+    ASTNode *node = NULL;
 
-    if (!node) {
-        perror("Failed to allocate memory for AST node");
-        exit(EXIT_FAILURE);
+    if (s_active_arena) {
+        node = (ASTNode*)arena_alloc(s_active_arena, sizeof(ASTNode));
+    } else {
+        node = (ASTNode*)xrealloc(NULL, sizeof(ASTNode));
     }
     
     node->type = type;
+    node->token = (Token){0};
     node->value = NULL;
     node->parent = NULL;
     node->children = NULL;
     node->num_children = 0;
     node->capacity = 0;
+    node->array_size = 0;
+    node->arena = s_active_arena;
     
     return node;
 }
 
-// Free an AST node and all its children
+// Free an AST node and all its children. Nodes waiting to be freed are
+// chained through their parent links, so any depth frees without recursion.
 void free_node(ASTNode *node)
 {
 
-    if (!node) {
+    ASTNode *pending = NULL;
+
+    // Arena-owned subtrees are released together with their arena
+    if (!node || node->arena) {
         return;
     }
-    
-    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
-        free_node(node->children[child_idx]);
+
+    node->parent = NULL;
+    pending = node;
+    while (pending) {
+        node = pending;
+        pending = node->parent;
+        for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+            ASTNode *child = node->children[child_idx];
+
+            if (child && !child->arena) {
+                child->parent = pending;
+                pending = child;
+            }
+        }
+        free(node->children);
+        free(node->value);
+        free(node);
+    }
+}
+
+// Replace the node's value with a copy of text
+void set_node_value(ASTNode *node, const char *text)
+{
+
+    char *copy = NULL;
+
+    if (node->arena) {
+        // Old arena copies are simply abandoned
+        node->value = text ? arena_strdup(node->arena, text) : NULL;
+        return;
+    }
+
+    if (text) {
+        copy = strdup(text);
+        if (!copy) {
+            perror("Failed to allocate memory for node value");
+            exit(EXIT_FAILURE);
+        }
     }
-    
-    free(node->children);
     free(node->value);
-    free(node);
+    node->value = copy;
+}
+
+// Set the operator of a binary or unary node
+void set_node_operator(ASTNode *node, InternId op)
+{
+
+    node->token.id = op;
+    node->token.type = TOKEN_OPERATOR;
+    set_node_value(node, intern_text(op));
 }
 
 // Add a child node
 void add_child(ASTNode *parent, ASTNode *child)
 {
 
+    if (parent->arena) {
+        // Arena vectors cannot be realloc'd; grow by copying into a new slot
+        if (parent->num_children >= parent->capacity) {
+            int new_capacity = parent->capacity ? parent->capacity * 2 : 4;
+            ASTNode **grown = (ASTNode**)arena_alloc(parent->arena,
+                                                     new_capacity * sizeof(ASTNode*));
+            if (parent->num_children > 0) {
+                memcpy(grown, parent->children, parent->num_children * sizeof(ASTNode*));
+            }
+            parent->children = grown;
+            parent->capacity = new_capacity;
+        }
+        parent->children[parent->num_children++] = child;
+        child->parent = parent;
+        return;
+    }
+
     if (!parent->children) {
         parent->capacity = 4;  // Start with space for 4 children
         parent->children = (ASTNode**)malloc(parent->capacity * sizeof(ASTNode*));
@@ -64,4 +146,86 @@ void add_child(ASTNode *parent, ASTNode *child)
     
     parent->children[parent->num_children++] = child;
     child->parent = parent;
-}
\ No newline at end of file
+}
+
+// Helper: advance past blanks within one line
+static const char* skip_pragma_blanks(const char *text)
+{
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    return text;
+}
+
+// Find "name args" among the newline-separated pragmas of a statement
+const char* find_node_pragma(const ASTNode *node, const char *name)
+{
+    size_t name_length = strlen(name);
+    const char *line = (node && node->type == NODE_STATEMENT) ? node->value : NULL;
+
+    while (line && *line) {
+        const char *word = skip_pragma_blanks(line);
+
+        // The "compi" vendor prefix is optional
+        if (strncmp(word, "compi", 5) == 0 && (word[5] == ' ' || word[5] == '\t')) {
+            word = skip_pragma_blanks(word + 5);
+        }
+        if (strncmp(word, name, name_length) == 0 &&
+            (word[name_length] == '\0' || word[name_length] == '\n' ||
+             word[name_length] == ' ' || word[name_length] == '\t')) {
+            return skip_pragma_blanks(word + name_length);
+        }
+
+        line = strchr(line, '\n');
+        if (line) {
+            line++;
+        }
+    }
+    return NULL;
+}
+
+int ast_depth(const ASTNode *root)
+{
+    typedef struct { const ASTNode *node; int depth; } DepthEntry;
+    DepthEntry *stack = NULL;
+    size_t count = 0;
+    size_t capacity = 64;
+    int deepest = 0;
+
+    if (!root) {
+        return 0;
+    }
+    stack = (DepthEntry*)xrealloc(NULL, capacity * sizeof(DepthEntry));
+    stack[count++] = (DepthEntry){ root, 1 };
+    while (count > 0) {
+        DepthEntry entry = stack[--count];
+
+        if (entry.depth > deepest) {
+            deepest = entry.depth;
+        }
+        if (count + (size_t)entry.node->num_children > capacity) {
+            while (count + (size_t)entry.node->num_children > capacity) {
+                capacity *= 2;
+            }
+            stack = (DepthEntry*)xrealloc(stack, capacity * sizeof(DepthEntry));
+        }
+        for (int child_idx = 0; child_idx < entry.node->num_children; child_idx++) {
+            if (entry.node->children[child_idx]) {
+                stack[count++] = (DepthEntry){ entry.node->children[child_idx], entry.depth + 1 };
+            }
+        }
+    }
+    free(stack);
+    return deepest;
+}
+
+size_t ast_stack_size(const ASTNode *root)
+{
+    size_t needed = (size_t)ast_depth(root) * AST_STACK_BYTES_PER_LEVEL;
+
+    if (needed <= AST_DEFAULT_STACK_BYTES / 2) {
+        return 0;
+    }
+    // Headroom for the frames above the walk itself
+    return needed + AST_DEFAULT_STACK_BYTES;
+}
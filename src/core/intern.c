@@ -0,0 +1,253 @@
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Entries live in fixed-size pages that never move once allocated, so a
+// pointer returned by intern_text() stays valid for the life of the process.
+// Insertions and hash probes take s_lock; intern_text()/intern_length() only
+// read published entries and stay lock-free.
+#define INTERN_PAGE_BITS 12
+#define INTERN_PAGE_SIZE (1u << INTERN_PAGE_BITS)
+#define INTERN_MAX_PAGES 16384
+#define INTERN_INITIAL_BUCKETS 4096
+#define INTERN_TEXT_BLOCK_SIZE (64 * 1024)
+
+typedef struct {
+    const char *text;
+    uint32_t length;
+    uint32_t hash;
+} InternEntry;
+
+// Storage block for string bytes
+typedef struct InternTextBlock {
+    struct InternTextBlock *next;
+    size_t used;
+    size_t capacity;
+    char bytes[];
+} InternTextBlock;
+
+static InternEntry *s_pages[INTERN_MAX_PAGES];
+static _Atomic uint32_t s_count = 0;    // Ids 1..s_count are in use (published)
+static uint32_t *s_buckets = NULL;      // Open-addressed table of ids
+static uint32_t s_bucket_count = 0;
+static InternTextBlock *s_text_blocks = NULL;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t s_seed_once = PTHREAD_ONCE_INIT;
+
+#define INTERN_TEXT_ENTRY(name, text) text,
+static const char *const s_predefined[] = {
+    INTERN_PREDEFINED(INTERN_TEXT_ENTRY)
+};
+#undef INTERN_TEXT_ENTRY
+
+static void intern_out_of_memory(void)
+{
+    perror("Failed to allocate memory for string interning");
+    exit(EXIT_FAILURE);
+}
+
+// FNV-1a, 32-bit
+static uint32_t hash_bytes(const char *text, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    size_t byte_idx = 0;
+
+    for (byte_idx = 0; byte_idx < length; byte_idx++) {
+        hash ^= (unsigned char)text[byte_idx];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static InternEntry* entry_for(InternId id)
+{
+    uint32_t index = id - 1;
+    return &s_pages[index >> INTERN_PAGE_BITS][index & (INTERN_PAGE_SIZE - 1)];
+}
+
+// Copy string bytes into block storage and NUL-terminate them
+static const char* store_text(const char *text, size_t length)
+{
+    InternTextBlock *block = s_text_blocks;
+    char *copy = NULL;
+
+    if (!block || block->capacity - block->used < length + 1) {
+        size_t capacity = INTERN_TEXT_BLOCK_SIZE;
+        if (length + 1 > capacity) {
+            capacity = length + 1;
+        }
+        block = (InternTextBlock *)malloc(sizeof(InternTextBlock) + capacity);
+        if (!block) {
+            intern_out_of_memory();
+        }
+        block->next = s_text_blocks;
+        block->used = 0;
+        block->capacity = capacity;
+        s_text_blocks = block;
+    }
+
+    copy = block->bytes + block->used;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    block->used += length + 1;
+    return copy;
+}
+
+static void grow_buckets(void)
+{
+    uint32_t new_count = s_bucket_count ? s_bucket_count * 2 : INTERN_INITIAL_BUCKETS;
+    uint32_t *new_buckets = (uint32_t *)calloc(new_count, sizeof(uint32_t));
+    uint32_t id = 0;
+
+    if (!new_buckets) {
+        intern_out_of_memory();
+    }
+
+    for (id = 1; id <= s_count; id++) {
+        uint32_t slot = entry_for(id)->hash & (new_count - 1);
+        while (new_buckets[slot] != INTERN_NONE) {
+            slot = (slot + 1) & (new_count - 1);
+        }
+        new_buckets[slot] = id;
+    }
+
+    free(s_buckets);
+    s_buckets = new_buckets;
+    s_bucket_count = new_count;
+}
+
+// Find the bucket holding the string, or the empty bucket where it belongs
+static uint32_t probe(const char *text, size_t length, uint32_t hash)
+{
+    uint32_t slot = hash & (s_bucket_count - 1);
+
+    while (s_buckets[slot] != INTERN_NONE) {
+        InternEntry *entry = entry_for(s_buckets[slot]);
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(entry->text, text, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & (s_bucket_count - 1);
+    }
+    return slot;
+}
+
+static InternId intern_locked(const char *text, size_t length);
+
+// Intern the predefined strings first so they get their enum ids
+static void seed_table(void)
+{
+    size_t predefined_idx = 0;
+
+    pthread_mutex_lock(&s_lock);
+    for (predefined_idx = 0; predefined_idx < INTERN_PREDEFINED_COUNT; predefined_idx++) {
+        intern_locked(s_predefined[predefined_idx], strlen(s_predefined[predefined_idx]));
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+static void seed_predefined(void)
+{
+    pthread_once(&s_seed_once, seed_table);
+}
+
+// Insert or find a string; caller holds s_lock
+static InternId intern_locked(const char *text, size_t length)
+{
+    uint32_t hash = hash_bytes(text, length);
+    uint32_t slot = 0;
+    uint32_t index = 0;
+    InternEntry *entry = NULL;
+
+    // Keep the load factor below one half
+    if ((s_count + 1) * 2 > s_bucket_count) {
+        grow_buckets();
+    }
+
+    slot = probe(text, length, hash);
+    if (s_buckets[slot] != INTERN_NONE) {
+        return s_buckets[slot];
+    }
+
+    index = s_count;
+    if ((index >> INTERN_PAGE_BITS) >= INTERN_MAX_PAGES) {
+        fprintf(stderr, "String intern table is full\n");
+        exit(EXIT_FAILURE);
+    }
+    if (!s_pages[index >> INTERN_PAGE_BITS]) {
+        s_pages[index >> INTERN_PAGE_BITS] = (InternEntry *)malloc(INTERN_PAGE_SIZE * sizeof(InternEntry));
+        if (!s_pages[index >> INTERN_PAGE_BITS]) {
+            intern_out_of_memory();
+        }
+    }
+
+    // Fill the entry before publishing its id to lock-free readers
+    entry = entry_for(index + 1);
+    entry->text = store_text(text, length);
+    entry->length = (uint32_t)length;
+    entry->hash = hash;
+    s_buckets[slot] = index + 1;
+    atomic_store_explicit(&s_count, index + 1, memory_order_release);
+    return index + 1;
+}
+
+InternId intern_string(const char *text, size_t length)
+{
+    InternId id = INTERN_NONE;
+
+    seed_predefined();
+    pthread_mutex_lock(&s_lock);
+    id = intern_locked(text, length);
+    pthread_mutex_unlock(&s_lock);
+    return id;
+}
+
+InternId intern_cstr(const char *text)
+{
+    if (!text) {
+        return INTERN_NONE;
+    }
+    return intern_string(text, strlen(text));
+}
+
+InternId intern_find(const char *text, size_t length)
+{
+    InternId id = INTERN_NONE;
+
+    if (!text) {
+        return INTERN_NONE;
+    }
+
+    seed_predefined();
+    pthread_mutex_lock(&s_lock);
+    id = s_buckets[probe(text, length, hash_bytes(text, length))];
+    pthread_mutex_unlock(&s_lock);
+    return id;
+}
+
+const char* intern_text(InternId id)
+{
+    seed_predefined();
+    if (id == INTERN_NONE || id > atomic_load_explicit(&s_count, memory_order_acquire)) {
+        return "";
+    }
+    return entry_for(id)->text;
+}
+
+size_t intern_length(InternId id)
+{
+    seed_predefined();
+    if (id == INTERN_NONE || id > atomic_load_explicit(&s_count, memory_order_acquire)) {
+        return 0;
+    }
+    return entry_for(id)->length;
+}
+
+size_t intern_count(void)
+{
+    seed_predefined();
+    return atomic_load_explicit(&s_count, memory_order_acquire);
+}
@@ -0,0 +1,160 @@
+#include "output_buffer.h"
+#include "utils.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Large enough for any long in decimal plus sign
+#define OUTPUT_INT_DIGITS 24
+
+void output_buffer_init(OutputBuffer *buffer, FILE *sink)
+{
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+    buffer->sink = sink;
+    buffer->bytes_written = 0;
+    buffer->write_failed = 0;
+}
+
+// Ensure room for `extra` more bytes plus the terminating NUL
+static void output_buffer_reserve(OutputBuffer *buffer, size_t extra)
+{
+    size_t needed = buffer->length + extra;
+    size_t capacity = buffer->capacity ? buffer->capacity : OUTPUT_BUFFER_INITIAL_CAPACITY;
+
+    if (buffer->data && needed <= buffer->capacity) {
+        return;
+    }
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    buffer->data = (char*)xrealloc(buffer->data, capacity + 1);
+    buffer->capacity = capacity;
+}
+
+static void output_buffer_drain(OutputBuffer *buffer)
+{
+    if (buffer->length == 0) {
+        return;
+    }
+    if (fwrite(buffer->data, 1, buffer->length, buffer->sink) != buffer->length) {
+        buffer->write_failed = 1;
+    }
+    buffer->bytes_written += buffer->length;
+    buffer->length = 0;
+    buffer->data[0] = '\0';
+}
+
+// Helper: stream out once enough output has accumulated
+static void output_buffer_appended(OutputBuffer *buffer)
+{
+    buffer->data[buffer->length] = '\0';
+    if (buffer->sink && buffer->length >= OUTPUT_BUFFER_FLUSH_THRESHOLD) {
+        output_buffer_drain(buffer);
+    }
+}
+
+int output_buffer_flush(OutputBuffer *buffer)
+{
+    if (buffer->sink) {
+        output_buffer_drain(buffer);
+        if (fflush(buffer->sink) != 0) {
+            buffer->write_failed = 1;
+        }
+    }
+    return !buffer->write_failed;
+}
+
+const char* output_buffer_data(const OutputBuffer *buffer)
+{
+    return buffer->data ? buffer->data : "";
+}
+
+char* output_buffer_take(OutputBuffer *buffer, size_t *length)
+{
+    char *data = NULL;
+
+    output_buffer_reserve(buffer, 0);
+    data = buffer->data;
+    data[buffer->length] = '\0';
+    if (length) {
+        *length = buffer->length;
+    }
+
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+    return data;
+}
+
+void output_buffer_free(OutputBuffer *buffer)
+{
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+void out_write(OutputBuffer *out, const char *text, size_t length)
+{
+    output_buffer_reserve(out, length);
+    memcpy(out->data + out->length, text, length);
+    out->length += length;
+    output_buffer_appended(out);
+}
+
+void out_puts(OutputBuffer *out, const char *text)
+{
+    out_write(out, text, strlen(text));
+}
+
+void out_putc(OutputBuffer *out, char character)
+{
+    output_buffer_reserve(out, 1);
+    out->data[out->length++] = character;
+    output_buffer_appended(out);
+}
+
+void out_int(OutputBuffer *out, long value)
+{
+    char digits[OUTPUT_INT_DIGITS];
+    size_t position = sizeof(digits);
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+
+    // Format right to left; avoids the printf machinery for the common case
+    do {
+        digits[--position] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        digits[--position] = '-';
+    }
+    out_write(out, digits + position, sizeof(digits) - position);
+}
+
+void out_printf(OutputBuffer *out, const char *format, ...)
+{
+    va_list args;
+    int needed = 0;
+
+    // Try to format in place; grow and retry only if the text did not fit
+    output_buffer_reserve(out, 0);
+    va_start(args, format);
+    needed = vsnprintf(out->data + out->length, out->capacity - out->length + 1, format, args);
+    va_end(args);
+    if (needed < 0) {
+        return;
+    }
+
+    if ((size_t)needed > out->capacity - out->length) {
+        output_buffer_reserve(out, (size_t)needed);
+        va_start(args, format);
+        vsnprintf(out->data + out->length, (size_t)needed + 1, format, args);
+        va_end(args);
+    }
+    out->length += (size_t)needed;
+    output_buffer_appended(out);
+}
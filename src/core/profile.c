@@ -0,0 +1,145 @@
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+static const char *s_phase_names[PROFILE_PHASE_COUNT] = {
+    "load",
+    "parse",
+    "symbols",
+    "optimize",
+    "codegen",
+};
+
+int profile_available(void)
+{
+#ifdef COMPI_PROFILING
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void profile_reset(CompileProfile *profile)
+{
+    memset(profile, 0, sizeof(*profile));
+}
+
+double profile_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+unsigned long profile_count_nodes(const ASTNode *node)
+{
+    const ASTNode **stack = NULL;
+    size_t depth = 0;
+    size_t capacity = 64;
+    unsigned long count = 0;
+
+    if (!node) {
+        return 0;
+    }
+    stack = (const ASTNode**)malloc(capacity * sizeof(ASTNode*));
+    if (!stack) {
+        return 0;
+    }
+    stack[depth++] = node;
+    while (depth > 0) {
+        node = stack[--depth];
+        count++;
+        if (depth + (size_t)node->num_children > capacity) {
+            const ASTNode **grown = NULL;
+
+            while (depth + (size_t)node->num_children > capacity) {
+                capacity *= 2;
+            }
+            grown = (const ASTNode**)realloc((void*)stack, capacity * sizeof(ASTNode*));
+            if (!grown) {
+                free((void*)stack);
+                return count;
+            }
+            stack = grown;
+        }
+        for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+            stack[depth++] = node->children[child_idx];
+        }
+    }
+    free((void*)stack);
+    return count;
+}
+
+long profile_peak_memory_kb(void)
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // Linux reports ru_maxrss in KiB
+    return usage.ru_maxrss;
+}
+
+void profile_print_text(const CompileProfile *profile, const char *filename, FILE *out)
+{
+    fprintf(out, "Time report for %s\n", filename ? filename : "<input>");
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++) {
+        double seconds = profile->phase_seconds[phase];
+        double share = profile->total_seconds > 0.0 ? 100.0 * seconds / profile->total_seconds : 0.0;
+        int nested = (phase == PROFILE_PHASE_SYMBOLS);
+
+        // Nested phases are indented under their parent, columns stay aligned
+        fprintf(out, "  %*s%-*s %10.3f ms %6.1f%%\n", nested ? 2 : 0, "", nested ? 8 : 10,
+                s_phase_names[phase], seconds * 1e3, share);
+    }
+    fprintf(out, "  %-10s %10.3f ms\n", "total", profile->total_seconds * 1e3);
+    fprintf(out, "  tokens         %lu\n", profile->token_count);
+    fprintf(out, "  ast nodes      %lu\n", profile->ast_node_count);
+    fprintf(out, "  symbol ops     %lu\n", profile->symbol_operations);
+    fprintf(out, "  source bytes   %zu\n", profile->source_bytes);
+    fprintf(out, "  ast bytes      %zu\n", profile->ast_bytes);
+    fprintf(out, "  output bytes   %zu\n", profile->output_bytes);
+    fprintf(out, "  cache hits     %lu\n", profile->cache_hits);
+    fprintf(out, "  cache misses   %lu\n", profile->cache_misses);
+    fprintf(out, "  peak memory    %ld KiB\n", profile->peak_memory_kb);
+}
+
+// Helper: write text as a JSON string literal
+static void print_json_string(const char *text, FILE *out)
+{
+    fputc('"', out);
+    for (const char *cursor = text; *cursor; cursor++) {
+        unsigned char character = (unsigned char)*cursor;
+
+        if (character == '"' || character == '\\') {
+            fprintf(out, "\\%c", character);
+        } else if (character < 0x20) {
+            fprintf(out, "\\u%04x", character);
+        } else {
+            fputc(character, out);
+        }
+    }
+    fputc('"', out);
+}
+
+void profile_print_json(const CompileProfile *profile, const char *filename, FILE *out)
+{
+    fprintf(out, "{\"file\": ");
+    print_json_string(filename ? filename : "", out);
+    fprintf(out, ", \"phases_ms\": {");
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++) {
+        fprintf(out, "%s\"%s\": %.3f", phase ? ", " : "", s_phase_names[phase],
+                profile->phase_seconds[phase] * 1e3);
+    }
+    fprintf(out, "}, \"total_ms\": %.3f", profile->total_seconds * 1e3);
+    fprintf(out, ", \"tokens\": %lu, \"ast_nodes\": %lu, \"symbol_ops\": %lu",
+            profile->token_count, profile->ast_node_count, profile->symbol_operations);
+    fprintf(out, ", \"source_bytes\": %zu, \"ast_bytes\": %zu, \"output_bytes\": %zu",
+            profile->source_bytes, profile->ast_bytes, profile->output_bytes);
+    fprintf(out, ", \"cache_hits\": %lu, \"cache_misses\": %lu", profile->cache_hits, profile->cache_misses);
+    fprintf(out, ", \"peak_memory_kb\": %ld}", profile->peak_memory_kb);
+}
@@ -1,43 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include "utils.h"
 
+void* xrealloc(void *memory, size_t size)
+{
+    void *grown = realloc(memory, size ? size : 1);
+
+    if (!grown) {
+        perror("Failed to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+void* grow_array(void *memory, int *capacity, int initial, size_t element_size)
+{
+    *capacity = *capacity ? *capacity * 2 : initial;
+    return xrealloc(memory, (size_t)*capacity * element_size);
+}
+
+// Helper function to get operator precedence from its interned id
+int get_precedence_id(InternId op)
+{
+    switch (op) {
+        case INTERN_OP_MULTIPLY:
+        case INTERN_OP_DIVIDE:
+        case INTERN_OP_MODULO:
+            return PREC_MULTIPLICATIVE;
+        case INTERN_OP_PLUS:
+        case INTERN_OP_MINUS:
+            return PREC_ADDITIVE;
+        case INTERN_OP_SHIFT_LEFT:
+        case INTERN_OP_SHIFT_RIGHT:
+            return PREC_SHIFT;
+        case INTERN_OP_LESS:
+        case INTERN_OP_LESS_EQUAL:
+        case INTERN_OP_GREATER:
+        case INTERN_OP_GREATER_EQUAL:
+            return PREC_RELATIONAL;
+        case INTERN_OP_EQUAL:
+        case INTERN_OP_NOT_EQUAL:
+            return PREC_EQUALITY;
+        case INTERN_OP_BITWISE_AND:
+            return PREC_BITWISE_AND;
+        case INTERN_OP_BITWISE_XOR:
+            return PREC_BITWISE_XOR;
+        case INTERN_OP_BITWISE_OR:
+            return PREC_BITWISE_OR;
+        case INTERN_OP_LOGICAL_AND:
+            return PREC_LOGICAL_AND;
+        case INTERN_OP_LOGICAL_OR:
+            return PREC_LOGICAL_OR;
+        default:
+            return PREC_UNKNOWN;
+    }
+}
+
 // Helper function to get operator precedence
 int get_precedence(const char *op)
 {
     if (!op) {
         return PREC_UNKNOWN;
     }
-    if (strcmp(op, "*") == 0 || strcmp(op, "/") == 0) {
-        return PREC_MULTIPLICATIVE;
-    }
-    if (strcmp(op, "+") == 0 || strcmp(op, "-") == 0) {
-        return PREC_ADDITIVE;
-    }
-    if (strcmp(op, "<<") == 0 || strcmp(op, ">>") == 0) {
-        return PREC_SHIFT;
-    }
-    if (strcmp(op, "<") == 0 || strcmp(op, "<=") == 0 ||
-        strcmp(op, ">") == 0 || strcmp(op, ">=") == 0) {
-        return PREC_RELATIONAL;
-    }
-    if (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) {
-        return PREC_EQUALITY;
-    }
-    if (strcmp(op, "&") == 0) {
-        return PREC_BITWISE_AND;
-    }
-    if (strcmp(op, "^") == 0) {
-        return PREC_BITWISE_XOR;
-    }
-    if (strcmp(op, "|") == 0) {
-        return PREC_BITWISE_OR;
-    }
-    if (strcmp(op, "&&") == 0) {
-        return PREC_LOGICAL_AND;
-    }
-    if (strcmp(op, "||") == 0) {
-        return PREC_LOGICAL_OR;
-    }
-    return PREC_UNKNOWN;
+    return get_precedence_id(intern_find(op, strlen(op)));
 }
 
 // Helper function to print tree branch decoration
@@ -102,28 +127,54 @@ int is_negative_literal(const char* value)
     return has_literal_chars;
 }
 
-// Print the AST recursively in a readable tree format
-void print_ast(ASTNode* node, int level)
+const char* identifier_name(const ASTNode *node)
 {
+    const char *name = NULL;
 
-    int is_last = 1;
-    int child_idx = 0;
-    ASTNode *parent = NULL;
+    if (node->type != NODE_EXPRESSION || !node->value || node->num_children > 0) {
+        return NULL;
+    }
+    name = (node->value[0] == '-') ? node->value + 1 : node->value;
+    return (isalpha((unsigned char)name[0]) || name[0] == '_') ? name : NULL;
+}
 
-    if (!node) {
-        return;
+ASTNode* find_callee(const ASTNode *function, const ASTNode *call)
+{
+    const ASTNode *program = function->parent;
+
+    if (!program || !call->value) {
+        return NULL;
     }
+    for (int child_idx = 0; child_idx < program->num_children; child_idx++) {
+        ASTNode *candidate = program->children[child_idx];
 
-    // Find if this node is the last child
-    if (node->parent) {
-        parent = node->parent;
-        for (child_idx = 0; child_idx < parent->num_children; child_idx++) {
-            if (parent->children[child_idx] == node) {
-                is_last = (child_idx == parent->num_children - 1);
-                break;
-            }
+        if (candidate->type == NODE_FUNCTION_DECL && candidate->value &&
+            strcmp(candidate->value, call->value) == 0) {
+            return candidate;
+        }
+    }
+    return NULL;
+}
+
+const ASTNode* find_declaration(const ASTNode *node, const char *name)
+{
+    if (node->type == NODE_VAR_DECL && node->value && strcmp(node->value, name) == 0) {
+        return node;
+    }
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        const ASTNode *found = node->children[child_idx] ?
+                               find_declaration(node->children[child_idx], name) : NULL;
+
+        if (found) {
+            return found;
         }
     }
+    return NULL;
+}
+
+// Print one node's line of the tree
+static void print_ast_node(const ASTNode *node, int level, int is_last)
+{
 
     print_tree_prefix(level, is_last);
 
@@ -135,12 +186,19 @@ void print_ast(ASTNode* node, int level)
         case NODE_FUNCTION_DECL:
             printf("FUNCTION: %s (returns: %s)\n",
                    node->value ? node->value : "(null)",
-                   node->token.value);
+                   token_text(node->token));
             break;
         case NODE_VAR_DECL:
-            printf("VAR: %s %s\n",
-                   node->token.value,
-                   node->value ? node->value : "(null)");
+            if (node->array_size > 0) {
+                printf("VAR: %s %s[%d]\n",
+                       token_text(node->token),
+                       node->value ? node->value : "(null)",
+                       node->array_size);
+            } else {
+                printf("VAR: %s %s\n",
+                       token_text(node->token),
+                       node->value ? node->value : "(null)");
+            }
             break;
         case NODE_STATEMENT:
             printf("STATEMENT\n");
@@ -154,9 +212,15 @@ void print_ast(ASTNode* node, int level)
         case NODE_ASSIGNMENT:
             printf("ASSIGN\n");
             break;
-        case NODE_BINARY_OP:
+        case NODE_UNARY_EXPR:
             printf("UNARY: %s\n", node->value ? node->value : "(unary)");
             break;
+        case NODE_INDEX_EXPR:
+            printf("INDEX\n");
+            break;
+        case NODE_MEMBER_EXPR:
+            printf("MEMBER: .%s\n", node->value ? node->value : "(null)");
+            break;
         case NODE_IF_STATEMENT:
             printf("IF\n");
             break;
@@ -179,26 +243,117 @@ void print_ast(ASTNode* node, int level)
             printf("NODE_TYPE_%d\n", node->type);
             break;
     }
+}
 
-    for (child_idx = 0; child_idx < node->num_children; child_idx++) {
-        print_ast(node->children[child_idx], level + 1);
+// Print the AST in a readable tree format, walking it with an explicit stack
+void print_ast(ASTNode* node, int level)
+{
+
+    typedef struct { const ASTNode *node; int level; int is_last; } PrintEntry;
+    PrintEntry *stack = NULL;
+    size_t depth = 0;
+    size_t capacity = 16;
+    int is_last = 1;
+    ASTNode *parent = NULL;
+
+    if (!node) {
+        return;
     }
+
+    // Find if this node is the last child
+    if (node->parent) {
+        parent = node->parent;
+        for (int child_idx = 0; child_idx < parent->num_children; child_idx++) {
+            if (parent->children[child_idx] == node) {
+                is_last = (child_idx == parent->num_children - 1);
+                break;
+            }
+        }
+    }
+
+    stack = (PrintEntry*)xrealloc(NULL, capacity * sizeof(PrintEntry));
+    stack[depth++] = (PrintEntry){ node, level, is_last };
+    while (depth > 0) {
+        PrintEntry entry = stack[--depth];
+
+        print_ast_node(entry.node, entry.level, entry.is_last);
+        if (depth + (size_t)entry.node->num_children > capacity) {
+            while (depth + (size_t)entry.node->num_children > capacity) {
+                capacity *= 2;
+            }
+            stack = (PrintEntry*)xrealloc(stack, capacity * sizeof(PrintEntry));
+        }
+        // Reversed, so the first child is printed next
+        for (int child_idx = entry.node->num_children; child_idx-- > 0;) {
+            if (entry.node->children[child_idx]) {
+                stack[depth++] = (PrintEntry){ entry.node->children[child_idx], entry.level + 1,
+                                               child_idx == entry.node->num_children - 1 };
+            }
+        }
+    }
+    free(stack);
+}
+
+// Helper function to recognise the explicit-width integer types
+int ctype_explicit_width(const char* ctype, int* is_signed)
+{
+    const char* digits = ctype;
+    int width = 0;
+    int signed_type = 1;
+
+    if (ctype == NULL) {
+        return 0;
+    }
+    if (*digits == 'u') {
+        signed_type = 0;
+        digits++;
+    }
+    if (strncmp(digits, "int", 3) != 0) {
+        return 0;
+    }
+    digits += 3;
+    if (*digits < '1' || *digits > '9') {
+        return 0;
+    }
+    while (isdigit((unsigned char)*digits) && width <= CTYPE_MAX_EXPLICIT_WIDTH) {
+        width = width * 10 + (*digits - '0');
+        digits++;
+    }
+    if (width > CTYPE_MAX_EXPLICIT_WIDTH || strcmp(digits, "_t") != 0) {
+        return 0;
+    }
+    if (is_signed != NULL) {
+        *is_signed = signed_type;
+    }
+    return width;
 }
 
 // Helper function to map C types to VHDL types
-char* ctype_to_vhdl(const char* ctype)
+const char* ctype_to_vhdl(const char* ctype)
 {
+    char explicit_type[CTYPE_VHDL_NAME_SIZE];
+    int width = 0;
 
-    // No local variables needed
-    if (strcmp(ctype, "int") == 0) {
-        return "std_logic_vector(31 downto 0)";
-    } else if (strcmp(ctype, "float") == 0) {
-        return "std_logic_vector(31 downto 0)"; // You may want to use 'real' for advanced VHDL
-    } else if (strcmp(ctype, "double") == 0) {
-        return "std_logic_vector(63 downto 0)"; // Or 'real'
-    } else if (strcmp(ctype, "char") == 0) {
-        return "std_logic_vector(7 downto 0)";
+    switch (intern_find(ctype, strlen(ctype))) {
+        case INTERN_KW_INT:
+            return "std_logic_vector(31 downto 0)";
+        case INTERN_KW_FLOAT:
+            return "std_logic_vector(31 downto 0)"; // You may want to use 'real' for advanced VHDL
+        case INTERN_KW_DOUBLE:
+            return "std_logic_vector(63 downto 0)"; // Or 'real'
+        case INTERN_KW_CHAR:
+            return "std_logic_vector(7 downto 0)";
+        default:
+            break;
+    }
+
+    // intN_t / uintN_t: exactly N bits (interned, so the text outlives the call)
+    width = ctype_explicit_width(ctype, NULL);
+    if (width > 0) {
+        snprintf(explicit_type, sizeof(explicit_type), "std_logic_vector(%d downto 0)", width - 1);
+        return intern_text(intern_cstr(explicit_type));
     }
+
     // Default fallback
     return "std_logic_vector(31 downto 0)";
-}
\ No newline at end of file
+}
@@ -1,5 +1,9 @@
 #include "error_handler.h"
+#include "parser_context.h"
+#include "utils.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 
 // ANSI color codes
@@ -16,10 +20,10 @@
 #define COLORED_OUTPUT_DISABLED 0
 #define MAX_SOURCE_LINE_LENGTH 1024
 #define INDENT_SPACES "    "
+#define DIAGNOSTIC_INITIAL_CAPACITY 16
 
-// Global counters
-static int error_count = 0;
-static int warning_count = 0;
+// Error and warning counts live in the current ParserContext, so threads
+// compiling separate units keep separate tallies
 static int colored_output_enabled = COLORED_OUTPUT_ENABLED;
 
 // Category names for display
@@ -51,7 +55,7 @@ static const char* get_color_for_severity(ErrorSeverity severity)
     {
         return COLOR_NONE;
     }
-    
+
     switch (severity)
     {
         case SEVERITY_INFO:
@@ -90,132 +94,375 @@ static const char* get_bold_color(void)
 }
 
 /**
- * Print formatted severity header with color
+ * Get color code for hints, codes and source context
  */
-static void print_severity_header(ErrorSeverity severity, ErrorCategory category)
+static const char* get_cyan_color(void)
 {
-    const char* color = get_color_for_severity(severity);
-    const char* reset = get_reset_color();
-    const char* bold = get_bold_color();
-    
-    fprintf(stderr, "%s%s%s[%s]%s ", 
-            bold, 
-            color, 
-            severity_labels[severity],
-            category_names[category],
-            reset);
+    if (!colored_output_enabled)
+    {
+        return COLOR_NONE;
+    }
+    return COLOR_CYAN;
 }
 
 /**
- * Print line number if valid
+ * Copy text into the list's string pool
+ *
+ * @return Its offset, or DIAGNOSTIC_NO_TEXT for NULL
  */
-static void print_line_number(int line)
+static size_t store_text(DiagnosticList *list, const char *text)
 {
-    if (line > INVALID_LINE_NUMBER)
+    size_t offset = list->text.length;
+
+    if (text == NULL)
     {
-        fprintf(stderr, "line %d: ", line);
+        return DIAGNOSTIC_NO_TEXT;
     }
+    out_write(&list->text, text, strlen(text) + 1);
+    return offset;
 }
 
 /**
- * Print formatted message with variadic arguments
+ * String of a record at offset (NULL if missing)
  */
-static void print_formatted_message(const char* format, va_list args)
+static const char* stored_text(const DiagnosticList *list, size_t offset)
 {
-    vfprintf(stderr, format, args);
-    fprintf(stderr, "\n");
+    return offset == DIAGNOSTIC_NO_TEXT ? NULL : output_buffer_data(&list->text) + offset;
 }
 
 /**
- * Update error and warning counters
+ * Empty a list but keep its storage
  */
-static void update_counters(ErrorSeverity severity)
+static void clear_diagnostics(DiagnosticList *list)
 {
-    if (severity == SEVERITY_ERROR)
+    list->count = 0;
+    list->note_count = 0;
+    list->text.length = 0;
+}
+
+/**
+ * Format a message into the pool
+ */
+static size_t store_formatted(DiagnosticList *list, const char *format, va_list args)
+{
+    char message[MAX_SOURCE_LINE_LENGTH];
+    char *text = message;
+    va_list measure;
+    int length = 0;
+    size_t offset = 0;
+
+    va_copy(measure, args);
+    length = vsnprintf(message, sizeof(message), format, measure);
+    va_end(measure);
+    if (length < 0)
     {
-        error_count++;
+        return store_text(list, "");
     }
-    else if (severity == SEVERITY_WARNING)
+    if ((size_t)length >= sizeof(message))
+    {
+        text = (char*)xrealloc(NULL, (size_t)length + 1);
+        vsnprintf(text, (size_t)length + 1, format, args);
+    }
+    offset = store_text(list, text);
+    if (text != message)
+    {
+        free(text);
+    }
+    return offset;
+}
+
+/**
+ * Append a record to the list
+ */
+static void add_record(DiagnosticList *list, ErrorSeverity severity, ErrorCategory category,
+                       const ErrorLocation *location, const char *error_code)
+{
+    DiagnosticRecord *record = NULL;
+
+    if (list->count == list->capacity)
+    {
+        list->records = (DiagnosticRecord*)grow_array(list->records, &list->capacity, DIAGNOSTIC_INITIAL_CAPACITY,
+                                                        sizeof(DiagnosticRecord));
+    }
+    record = &list->records[list->count++];
+    record->severity = severity;
+    record->category = category;
+    record->code = store_text(list, error_code);
+    record->filename = store_text(list, location ? location->filename : NULL);
+    record->source_line = store_text(list, location ? location->source_line : NULL);
+    record->message = DIAGNOSTIC_NO_TEXT;
+    record->line = location ? location->line : INVALID_LINE_NUMBER;
+    record->column = location ? location->column : INVALID_LINE_NUMBER;
+    record->first_note = list->note_count;
+    record->note_count = 0;
+}
+
+/**
+ * Append the severity/category header
+ */
+static void render_severity_header(OutputBuffer *out, ErrorSeverity severity, ErrorCategory category)
+{
+    out_printf(out, "%s%s%s[%s]%s ",
+               get_bold_color(),
+               get_color_for_severity(severity),
+               severity_labels[severity],
+               category_names[category],
+               get_reset_color());
+}
+
+/**
+ * Append source context with column indicator
+ */
+static void render_source_context(OutputBuffer *out, const char* source_line, int column)
+{
+    if (source_line == NULL || column <= INVALID_LINE_NUMBER)
+    {
+        return;
+    }
+
+    out_printf(out, "%s%s%s%s\n", INDENT_SPACES, get_cyan_color(), source_line, get_reset_color());
+
+    // Caret indicator at the column position
+    out_puts(out, INDENT_SPACES);
+    for (int i = 1; i < column; i++)
     {
-        warning_count++;
+        out_putc(out, ' ');
     }
+    out_printf(out, "^%s\n", get_reset_color());
 }
 
 /**
- * Print filename if available
+ * Append a hint or suggestion line
  */
-static void print_filename(const char* filename)
+static void render_note_text(OutputBuffer *out, int is_suggestion, const char *text)
 {
+    const char* magenta = colored_output_enabled ? COLOR_MAGENTA : COLOR_NONE;
+
+    if (is_suggestion)
+    {
+        out_printf(out, "%s%s%shelp:%s did you mean '%s'?\n",
+                   INDENT_SPACES, get_bold_color(), magenta, get_reset_color(), text);
+    }
+    else
+    {
+        out_printf(out, "%s%s%shint:%s %s\n",
+                   INDENT_SPACES, get_bold_color(), get_cyan_color(), get_reset_color(), text);
+    }
+}
+
+/**
+ * Append a record as text: "file:line:col: [code]severity[Category] message"
+ * or, without a file, "severity[Category] line N: message"
+ */
+static void render_text(OutputBuffer *out, const DiagnosticList *list, const DiagnosticRecord *record)
+{
+    const char *filename = stored_text(list, record->filename);
+    const char *code = stored_text(list, record->code);
+
     if (filename != NULL)
     {
-        fprintf(stderr, "%s:", filename);
+        out_printf(out, "%s:", filename);
+        if (record->line > INVALID_LINE_NUMBER)
+        {
+            out_printf(out, "%d:", record->line);
+            if (record->column > INVALID_LINE_NUMBER)
+            {
+                out_printf(out, "%d:", record->column);
+            }
+        }
+        out_putc(out, ' ');
+    }
+    if (code != NULL)
+    {
+        out_printf(out, "%s[%s]%s", get_cyan_color(), code, get_reset_color());
+    }
+    render_severity_header(out, record->severity, record->category);
+    if (filename == NULL && record->line > INVALID_LINE_NUMBER)
+    {
+        out_printf(out, "line %d: ", record->line);
+    }
+    out_puts(out, stored_text(list, record->message));
+    out_putc(out, '\n');
+    render_source_context(out, stored_text(list, record->source_line), record->column);
+    for (int note_idx = 0; note_idx < record->note_count; note_idx++)
+    {
+        const DiagnosticNote *note = &list->notes[record->first_note + note_idx];
+
+        render_note_text(out, note->is_suggestion, stored_text(list, note->text));
     }
 }
 
 /**
- * Print line and column numbers if valid
+ * Append text as a JSON string literal (null for NULL)
  */
-static void print_location(int line, int column)
+static void render_json_string(OutputBuffer *out, const char *text)
 {
-    if (line > INVALID_LINE_NUMBER)
+    if (text == NULL)
     {
-        fprintf(stderr, "%d:", line);
-        if (column > INVALID_LINE_NUMBER)
+        out_puts(out, "null");
+        return;
+    }
+    out_putc(out, '"');
+    for (const char *cursor = text; *cursor; cursor++)
+    {
+        unsigned char character = (unsigned char)*cursor;
+
+        if (character == '"' || character == '\\')
+        {
+            out_printf(out, "\\%c", character);
+        }
+        else if (character < 0x20)
         {
-            fprintf(stderr, "%d:", column);
+            out_printf(out, "\\u%04x", character);
+        }
+        else
+        {
+            out_putc(out, (char)character);
         }
     }
+    out_putc(out, '"');
 }
 
 /**
- * Print error code if provided
+ * Append the hints or the suggestions of a record as a JSON array
  */
-static void print_error_code(const char* error_code)
+static void render_json_notes(OutputBuffer *out, const DiagnosticList *list,
+                              const DiagnosticRecord *record, int suggestions)
 {
-    if (error_code != NULL)
+    int first = 1;
+
+    out_putc(out, '[');
+    for (int note_idx = 0; note_idx < record->note_count; note_idx++)
     {
-        const char* cyan = colored_output_enabled ? COLOR_CYAN : COLOR_NONE;
-        const char* reset = get_reset_color();
-        fprintf(stderr, "%s[%s]%s", cyan, error_code, reset);
+        const DiagnosticNote *note = &list->notes[record->first_note + note_idx];
+
+        if (note->is_suggestion == suggestions)
+        {
+            out_puts(out, first ? "" : ", ");
+            render_json_string(out, stored_text(list, note->text));
+            first = 0;
+        }
     }
+    out_putc(out, ']');
 }
 
 /**
- * Print source context with column indicator
+ * Append a record as one JSON object and a newline (never coloured)
  */
-static void print_source_context(const char* source_line, int column)
+static void render_json(OutputBuffer *out, const DiagnosticList *list, const DiagnosticRecord *record)
 {
-    if (source_line == NULL || column <= INVALID_LINE_NUMBER)
+    out_printf(out, "{\"severity\": \"%s\", \"category\": \"%s\", \"file\": ",
+               severity_labels[record->severity], category_names[record->category]);
+    render_json_string(out, stored_text(list, record->filename));
+    out_printf(out, ", \"line\": %d, \"column\": %d, \"code\": ", record->line, record->column);
+    render_json_string(out, stored_text(list, record->code));
+    out_puts(out, ", \"message\": ");
+    render_json_string(out, stored_text(list, record->message));
+    out_puts(out, ", \"source\": ");
+    render_json_string(out, stored_text(list, record->source_line));
+    out_puts(out, ", \"hints\": ");
+    render_json_notes(out, list, record, 0);
+    out_puts(out, ", \"suggestions\": ");
+    render_json_notes(out, list, record, 1);
+    out_puts(out, "}\n");
+}
+
+/**
+ * Write rendered output with one locked write
+ */
+static void write_output(FILE *stream, const OutputBuffer *out)
+{
+    flockfile(stream);
+    fwrite(output_buffer_data(out), 1, out->length, stream);
+    funlockfile(stream);
+}
+
+/**
+ * Update error and warning counters
+ */
+static void update_counters(ErrorSeverity severity)
+{
+    if (severity == SEVERITY_ERROR)
+    {
+        parser_context_current()->error_count++;
+    }
+    else if (severity == SEVERITY_WARNING)
     {
+        parser_context_current()->warning_count++;
+    }
+}
+
+/**
+ * Record a message in the current context's list; an unbuffered list
+ * writes it out at once
+ */
+static void report(ErrorSeverity severity, ErrorCategory category, const ErrorLocation *location,
+                   const char *error_code, const char *format, va_list args)
+{
+    DiagnosticList *list = &parser_context_current()->diagnostics;
+    DiagnosticRecord *record = NULL;
+    size_t message = 0;
+
+    if (!list->buffered)
+    {
+        clear_diagnostics(list);
+    }
+    add_record(list, severity, category, location, error_code);
+    message = store_formatted(list, format, args);
+    record = &list->records[list->count - 1];
+    record->message = message;
+
+    if (!list->buffered)
+    {
+        OutputBuffer out;
+
+        output_buffer_init(&out, NULL);
+        render_text(&out, list, record);
+        write_output(stderr, &out);
+        output_buffer_free(&out);
+    }
+}
+
+/**
+ * Attach a hint or suggestion to the last record (written at once when
+ * the list is unbuffered)
+ */
+static void add_note(int is_suggestion, const char *text)
+{
+    DiagnosticList *list = &parser_context_current()->diagnostics;
+    DiagnosticNote *note = NULL;
+
+    if (!list->buffered || list->count == 0)
+    {
+        OutputBuffer out;
+
+        output_buffer_init(&out, NULL);
+        render_note_text(&out, is_suggestion, text);
+        write_output(stderr, &out);
+        output_buffer_free(&out);
         return;
     }
-    
-    const char* reset = get_reset_color();
-    const char* cyan = colored_output_enabled ? COLOR_CYAN : COLOR_NONE;
-    
-    fprintf(stderr, "%s%s%s%s\n", INDENT_SPACES, cyan, source_line, reset);
-    
-    // Print caret indicator at the column position
-    fprintf(stderr, "%s", INDENT_SPACES);
-    for (int i = 1; i < column; i++)
+    if (list->note_count == list->note_capacity)
     {
-        fprintf(stderr, " ");
+        list->notes = (DiagnosticNote*)grow_array(list->notes, &list->note_capacity, DIAGNOSTIC_INITIAL_CAPACITY,
+                                                    sizeof(DiagnosticNote));
     }
-    fprintf(stderr, "^%s\n", reset);
+    note = &list->notes[list->note_count++];
+    note->is_suggestion = is_suggestion;
+    note->text = store_text(list, text);
+    list->records[list->count - 1].note_count++;
 }
 
-void report_message(ErrorSeverity severity, ErrorCategory category, 
+void report_message(ErrorSeverity severity, ErrorCategory category,
                    int line, const char* format, ...)
 {
+    ErrorLocation location = { NULL, line, INVALID_LINE_NUMBER, NULL };
     va_list args;
-    
-    print_severity_header(severity, category);
-    print_line_number(line);
-    
+
     va_start(args, format);
-    print_formatted_message(format, args);
+    report(severity, category, &location, NULL, format, args);
     va_end(args);
-    
+
     update_counters(severity);
 }
 
@@ -224,134 +471,120 @@ void report_message_ex(ErrorSeverity severity, ErrorCategory category,
                       const char* format, ...)
 {
     va_list args;
-    const char* color = get_color_for_severity(severity);
-    const char* reset = get_reset_color();
-    const char* bold = get_bold_color();
-    
-    // Print filename:line:column if available
-    if (location != NULL && location->filename != NULL)
-    {
-        print_filename(location->filename);
-        print_location(location->line, location->column);
-        fprintf(stderr, " ");
-    }
-    
-    // Print error code if provided
-    print_error_code(error_code);
-    
-    // Print severity and category header
-    fprintf(stderr, "%s%s%s[%s]%s ", 
-            bold, 
-            color, 
-            severity_labels[severity],
-            category_names[category],
-            reset);
-    
-    // Print line number if location not already shown and line is valid
-    if (location != NULL && location->filename == NULL && location->line > INVALID_LINE_NUMBER)
-    {
-        fprintf(stderr, "line %d: ", location->line);
-    }
-    
-    // Print formatted message
+
     va_start(args, format);
-    print_formatted_message(format, args);
+    report(severity, category, location, error_code, format, args);
     va_end(args);
-    
-    // Print source context if available
-    if (location != NULL)
-    {
-        print_source_context(location->source_line, location->column);
-    }
-    
+
     update_counters(severity);
 }
 
 void add_error_hint(const char* format, ...)
 {
+    char hint[MAX_SOURCE_LINE_LENGTH];
     va_list args;
-    const char* cyan = colored_output_enabled ? COLOR_CYAN : COLOR_NONE;
-    const char* bold = get_bold_color();
-    const char* reset = get_reset_color();
-    
-    fprintf(stderr, "%s%s%shint:%s ", INDENT_SPACES, bold, cyan, reset);
-    
+
     va_start(args, format);
-    vfprintf(stderr, format, args);
+    vsnprintf(hint, sizeof(hint), format, args);
     va_end(args);
-    
-    fprintf(stderr, "\n");
+
+    add_note(0, hint);
 }
 
 void add_suggestion(const char* suggestion)
 {
-    const char* magenta = colored_output_enabled ? COLOR_MAGENTA : COLOR_NONE;
-    const char* bold = get_bold_color();
-    const char* reset = get_reset_color();
-    
-    fprintf(stderr, "%s%s%shelp:%s did you mean '%s'?\n", 
-            INDENT_SPACES, bold, magenta, reset, suggestion);
+    add_note(1, suggestion);
 }
 
 void log_info(ErrorCategory category, int line, const char* format, ...)
 {
+    ErrorLocation location = { NULL, line, INVALID_LINE_NUMBER, NULL };
     va_list args;
+
     va_start(args, format);
-    
-    print_severity_header(SEVERITY_INFO, category);
-    print_line_number(line);
-    print_formatted_message(format, args);
-    
+    report(SEVERITY_INFO, category, &location, NULL, format, args);
     va_end(args);
 }
 
 void log_warning(ErrorCategory category, int line, const char* format, ...)
 {
+    ErrorLocation location = { NULL, line, INVALID_LINE_NUMBER, NULL };
     va_list args;
+
     va_start(args, format);
-    
-    print_severity_header(SEVERITY_WARNING, category);
-    print_line_number(line);
-    print_formatted_message(format, args);
-    
+    report(SEVERITY_WARNING, category, &location, NULL, format, args);
     va_end(args);
-    
-    warning_count++;
+
+    parser_context_current()->warning_count++;
 }
 
 void log_error(ErrorCategory category, int line, const char* format, ...)
 {
+    ErrorLocation location = { NULL, line, INVALID_LINE_NUMBER, NULL };
     va_list args;
+
     va_start(args, format);
-    
-    print_severity_header(SEVERITY_ERROR, category);
-    print_line_number(line);
-    print_formatted_message(format, args);
-    
+    report(SEVERITY_ERROR, category, &location, NULL, format, args);
     va_end(args);
-    
-    error_count++;
+
+    parser_context_current()->error_count++;
+}
+
+void diagnostics_flush(DiagnosticList *list, FILE *stream, DiagnosticFormat format)
+{
+    OutputBuffer out;
+
+    if (list->count == 0)
+    {
+        return;
+    }
+    output_buffer_init(&out, NULL);
+    for (int record_idx = 0; record_idx < list->count; record_idx++)
+    {
+        if (format == DIAGNOSTIC_FORMAT_JSON)
+        {
+            render_json(&out, list, &list->records[record_idx]);
+        }
+        else
+        {
+            render_text(&out, list, &list->records[record_idx]);
+        }
+    }
+    write_output(stream, &out);
+    output_buffer_free(&out);
+    clear_diagnostics(list);
+}
+
+void diagnostics_free(DiagnosticList *list)
+{
+    free(list->records);
+    free(list->notes);
+    output_buffer_free(&list->text);
+    list->records = NULL;
+    list->notes = NULL;
+    list->count = list->capacity = 0;
+    list->note_count = list->note_capacity = 0;
 }
 
 int get_error_count(void)
 {
-    return error_count;
+    return parser_context_current()->error_count;
 }
 
 int get_warning_count(void)
 {
-    return warning_count;
+    return parser_context_current()->warning_count;
 }
 
 void reset_error_counters(void)
 {
-    error_count = 0;
-    warning_count = 0;
+    parser_context_current()->error_count = 0;
+    parser_context_current()->warning_count = 0;
 }
 
 int has_errors(void)
 {
-    return error_count > INVALID_LINE_NUMBER;
+    return parser_context_current()->error_count > 0;
 }
 
 void set_colored_output(int enable)
@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "intern.h"
+#include "utils.h"
+
+// Starting capacity of the leaf, operator and flattening stacks
+#define BALANCE_INITIAL_CAPACITY 16
+
+// Leaves and operator nodes of the chains being balanced. A chain appends
+// its own after those of the chains enclosing it and drops them when done.
+typedef struct {
+    ASTNode **leaves;          // In source order
+    int leaf_count;
+    int leaf_capacity;
+    ASTNode **operators;       // In preorder, so a chain's root comes first
+    int operator_count;
+    int operator_capacity;
+} BalanceChain;
+
+// Helper: associative operators; + and * only for operands known to wrap at
+// 32 bits, where any grouping gives the same bits
+static int is_balanced_operator(InternId op)
+{
+    switch (op) {
+        case INTERN_OP_PLUS:
+        case INTERN_OP_MULTIPLY:
+        case INTERN_OP_BITWISE_AND:
+        case INTERN_OP_BITWISE_OR:
+        case INTERN_OP_BITWISE_XOR:
+        case INTERN_OP_LOGICAL_AND:
+        case INTERN_OP_LOGICAL_OR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void chain_add_leaf(BalanceChain *chain, ASTNode *leaf)
+{
+    if (chain->leaf_count == chain->leaf_capacity) {
+        chain->leaves = (ASTNode**)grow_array(chain->leaves, &chain->leaf_capacity, BALANCE_INITIAL_CAPACITY,
+                                                 sizeof(ASTNode*));
+    }
+    chain->leaves[chain->leaf_count++] = leaf;
+}
+
+static void chain_add_operator(BalanceChain *chain, ASTNode *node)
+{
+    if (chain->operator_count == chain->operator_capacity) {
+        chain->operators = (ASTNode**)grow_array(chain->operators, &chain->operator_capacity,
+                                                   BALANCE_INITIAL_CAPACITY, sizeof(ASTNode*));
+    }
+    chain->operators[chain->operator_count++] = node;
+}
+
+// Helper: node is one more link of a chain of op
+static int continues_chain(const ASTNode *node, InternId op)
+{
+    return node->type == NODE_BINARY_EXPR && node->num_children == 2 &&
+           node->children[0] && node->children[1] && node->token.id == op;
+}
+
+/**
+ * Append the leaves (in source order) and operator nodes of the op chain
+ * under root, with an explicit stack: parsed chains are as deep as they
+ * are long.
+ *
+ * @return Height of the chain in op nodes
+ */
+static int flatten_chain(BalanceChain *chain, ASTNode *root, InternId op)
+{
+    typedef struct { ASTNode *node; int height; } ChainEntry;
+    ChainEntry *stack = NULL;
+    int count = 0;
+    int capacity = 0;
+    int height = 0;
+
+    stack = (ChainEntry*)grow_array(NULL, &capacity, BALANCE_INITIAL_CAPACITY, sizeof(ChainEntry));
+    stack[count++] = (ChainEntry){ root, 1 };
+    while (count > 0) {
+        ChainEntry entry = stack[--count];
+
+        if (entry.height > 1 && !continues_chain(entry.node, op)) {
+            chain_add_leaf(chain, entry.node);
+            continue;
+        }
+        chain_add_operator(chain, entry.node);
+        if (entry.height > height) {
+            height = entry.height;
+        }
+        if (count + 2 > capacity) {
+            stack = (ChainEntry*)grow_array(stack, &capacity, BALANCE_INITIAL_CAPACITY, sizeof(ChainEntry));
+        }
+        // Right first, so the left operand is taken next
+        stack[count++] = (ChainEntry){ entry.node->children[1], entry.height + 1 };
+        stack[count++] = (ChainEntry){ entry.node->children[0], entry.height + 1 };
+    }
+    free(stack);
+    return height;
+}
+
+// Helper: ceil(log2(leaf_count)), the height of a balanced chain
+static int balanced_height(int leaf_count)
+{
+    int height = 0;
+
+    while ((1 << height) < leaf_count) {
+        height++;
+    }
+    return height;
+}
+
+/**
+ * Rebuild leaves [first, first + count) over the chain's operator nodes,
+ * the left half taking the extra leaf. Recursion depth is log2(count).
+ *
+ * @return The subtree's root
+ */
+static ASTNode* build_balanced(BalanceChain *chain, int first, int count, int *next_operator)
+{
+    ASTNode *node = NULL;
+    int left_count = (count + 1) / 2;
+
+    if (count == 1) {
+        return chain->leaves[first];
+    }
+    node = chain->operators[(*next_operator)++];
+    node->children[0] = build_balanced(chain, first, left_count, next_operator);
+    node->children[1] = build_balanced(chain, first + left_count, count - left_count, next_operator);
+    node->children[0]->parent = node;
+    node->children[1]->parent = node;
+    return node;
+}
+
+static int balance_node(OptimizeWrapScope *scope, BalanceChain *chain, ASTNode *node, int *rewrites);
+
+/**
+ * Balance the leaves of the chain rooted at node, then regroup the chain
+ * itself if it is deeper than needed and every leaf allows it. The root
+ * node stays the root, so the parent's link needs no update.
+ *
+ * @return 1 if the chain's value wraps at 32 bits
+ */
+static int balance_chain(OptimizeWrapScope *scope, BalanceChain *chain, ASTNode *node, InternId op,
+                         int *rewrites)
+{
+    int first_leaf = chain->leaf_count;
+    int first_operator = chain->operator_count;
+    int height = flatten_chain(chain, node, op);
+    int leaf_count = chain->leaf_count - first_leaf;
+    int leaves_wrap = 1;
+    int next_operator = first_operator;
+    int arithmetic = (op == INTERN_OP_PLUS || op == INTERN_OP_MULTIPLY);
+
+    // Entries are read by index: nested chains may move the arrays
+    for (int leaf_idx = 0; leaf_idx < leaf_count; leaf_idx++) {
+        leaves_wrap &= balance_node(scope, chain, chain->leaves[first_leaf + leaf_idx], rewrites);
+    }
+
+    // Bitwise operators are associative for any int operands, and && and ||
+    // still evaluate (and short-circuit) left to right when regrouped
+    if ((leaves_wrap || !arithmetic) && height > balanced_height(leaf_count)) {
+        build_balanced(chain, first_leaf, leaf_count, &next_operator);
+        (*rewrites)++;
+    }
+    chain->leaf_count = first_leaf;
+    chain->operator_count = first_operator;
+    return leaves_wrap || op == INTERN_OP_LOGICAL_AND || op == INTERN_OP_LOGICAL_OR;
+}
+
+// Balance every chain under node; returns 1 if node's value wraps at 32 bits
+static int balance_node(OptimizeWrapScope *scope, BalanceChain *chain, ASTNode *node, int *rewrites)
+{
+    InternId op = INTERN_NONE;
+    int first_wraps = 1;
+    int children_wrap = 1;
+
+    if (node->type == NODE_BINARY_EXPR) {
+        op = node->token.id;
+        if (is_balanced_operator(op) && continues_chain(node, op)) {
+            return balance_chain(scope, chain, node, op, rewrites);
+        }
+    }
+
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        if (node->children[child_idx]) {
+            int wraps = balance_node(scope, chain, node->children[child_idx], rewrites);
+
+            children_wrap &= wraps;
+            if (child_idx == 0) {
+                first_wraps = wraps;
+            }
+        }
+    }
+
+    return optimize_wraps_at_int(scope, node, first_wraps, children_wrap);
+}
+
+int balance_expressions(ASTNode *program)
+{
+    return balance_expressions_function(program, NULL);
+}
+
+int balance_expressions_function(ASTNode *program, ASTNode *only)
+{
+    OptimizeWrapScope scope;
+    BalanceChain chain;
+    int rewrites = 0;
+
+    if (!program) {
+        return 0;
+    }
+
+    memset(&chain, 0, sizeof(chain));
+    optimize_wrap_scope_init(&scope, program);
+
+    for (int child_idx = 0; child_idx < program->num_children; child_idx++) {
+        ASTNode *function = program->children[child_idx];
+
+        if (function->type != NODE_FUNCTION_DECL || (only && function != only)) {
+            continue;
+        }
+        optimize_wrap_scope_enter(&scope, function);
+        balance_node(&scope, &chain, function, &rewrites);
+    }
+
+    optimize_wrap_scope_free(&scope);
+    free(chain.leaves);
+    free(chain.operators);
+    return rewrites;
+}
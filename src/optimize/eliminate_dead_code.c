@@ -0,0 +1,520 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "optimize.h"
+#include "symbol_table.h"
+#include "intern.h"
+#include "utils.h"
+
+// What an if statement reduces to once its literal conditions are known
+typedef enum {
+    BRANCH_KEEP,               // Still decided at run time
+    BRANCH_REMOVE,             // No branch is ever taken
+    BRANCH_SPLICE              // Exactly one branch is taken; it replaces the if
+} BranchOutcome;
+
+// Names declared and read in one function
+typedef struct {
+    SymbolTable locals;        // Name -> 1 for every local declaration
+    SymbolTable reads;         // Name -> number of reads
+    SymbolTable kept_writes;   // Name -> 1 if a write to it calls a function
+} FunctionUsage;
+
+// Helper: construct wrapped by a non-return NODE_STATEMENT, or NULL
+static ASTNode* wrapped_construct(const ASTNode *statement)
+{
+    if (statement->type != NODE_STATEMENT || optimize_is_return_statement(statement) ||
+        statement->num_children != 1) {
+        return NULL;
+    }
+    return statement->children[0];
+}
+
+// Helper: for loops store an optional init before the condition
+static int for_condition_index(const ASTNode *for_node)
+{
+    if (for_node->num_children > 0 &&
+        (for_node->children[0]->type == NODE_VAR_DECL ||
+         for_node->children[0]->type == NODE_ASSIGNMENT)) {
+        return 1;
+    }
+    return 0;
+}
+
+// Helper: index of the first else-if/else branch of an if node
+static int first_branch_index(const ASTNode *if_node)
+{
+    for (int child_idx = 1; child_idx < if_node->num_children; child_idx++) {
+        NodeType type = if_node->children[child_idx]->type;
+        if (type == NODE_ELSE_IF_STATEMENT || type == NODE_ELSE_STATEMENT) {
+            return child_idx;
+        }
+    }
+    return if_node->num_children;
+}
+
+static int is_terminator(const ASTNode *statement);
+
+// Helper: last statement in children[first, end) leaves the block
+static int block_terminates(const ASTNode *block, int first, int end)
+{
+    for (int child_idx = end - 1; child_idx >= first; child_idx--) {
+        if (block->children[child_idx]->type == NODE_STATEMENT) {
+            return is_terminator(block->children[child_idx]);
+        }
+    }
+    return 0;
+}
+
+// Statement after which nothing in the same block runs: return, break,
+// continue, or an if/else whose every branch ends in one of those
+static int is_terminator(const ASTNode *statement)
+{
+    const ASTNode *construct = NULL;
+    int branch_idx = 0;
+    int has_else = 0;
+
+    if (optimize_is_return_statement(statement)) {
+        return 1;
+    }
+    construct = wrapped_construct(statement);
+    if (!construct) {
+        return 0;
+    }
+    if (construct->type == NODE_BREAK_STATEMENT || construct->type == NODE_CONTINUE_STATEMENT) {
+        return 1;
+    }
+    if (construct->type != NODE_IF_STATEMENT) {
+        return 0;
+    }
+
+    branch_idx = first_branch_index(construct);
+    if (!block_terminates(construct, 1, branch_idx)) {
+        return 0;
+    }
+    for (; branch_idx < construct->num_children; branch_idx++) {
+        const ASTNode *branch = construct->children[branch_idx];
+        int first = branch->type == NODE_ELSE_IF_STATEMENT ? 1 : 0;
+
+        has_else |= branch->type == NODE_ELSE_STATEMENT;
+        if (!block_terminates(branch, first, branch->num_children)) {
+            return 0;
+        }
+    }
+    return has_else;
+}
+
+// Helper: any statement in children[first, first statement run) declares a variable
+static int declares_locals(const ASTNode *block, int first)
+{
+    for (int child_idx = first; child_idx < block->num_children; child_idx++) {
+        const ASTNode *construct = wrapped_construct(block->children[child_idx]);
+        if (block->children[child_idx]->type != NODE_STATEMENT) {
+            break;
+        }
+        if (construct && construct->type == NODE_VAR_DECL) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Helper: copy of the child vector, so the node can be refilled with add_child
+static ASTNode** detach_children(ASTNode *node, int *count)
+{
+    ASTNode **children = NULL;
+
+    *count = node->num_children;
+    if (*count == 0) {
+        return NULL;
+    }
+    children = (ASTNode**)xrealloc(NULL, (size_t)*count * sizeof(ASTNode*));
+    memcpy(children, node->children, (size_t)*count * sizeof(ASTNode*));
+    node->num_children = 0;
+    return children;
+}
+
+// Helper: drop children[index] and close the gap
+static void remove_child_at(ASTNode *node, int index)
+{
+    free_node(node->children[index]);
+    memmove(&node->children[index], &node->children[index + 1],
+            (size_t)(node->num_children - index - 1) * sizeof(ASTNode*));
+    node->num_children--;
+}
+
+// -------------------------------------------------------------
+// Unreachable statements and constant conditions
+// -------------------------------------------------------------
+
+// Resolve literal conditions of an if chain. Leading false branches are
+// removed (an else-if may become the new if); a true else-if ends the chain.
+static BranchOutcome prune_if(ASTNode *if_node, ASTNode **live, int *live_first, int *rewrites)
+{
+    int32_t condition = 0;
+    int branch_idx = 0;
+
+    while (if_node->num_children > 0 && optimize_int_literal(if_node->children[0], &condition)) {
+        ASTNode **children = NULL;
+        ASTNode *branch = NULL;
+        int count = 0;
+
+        if (condition) {
+            *live = if_node;
+            *live_first = 1;
+            return BRANCH_SPLICE;
+        }
+
+        branch_idx = first_branch_index(if_node);
+        if (branch_idx >= if_node->num_children) {
+            return BRANCH_REMOVE;
+        }
+        branch = if_node->children[branch_idx];
+        if (branch->type == NODE_ELSE_STATEMENT) {
+            *live = branch;
+            *live_first = 0;
+            return BRANCH_SPLICE;
+        }
+
+        // if (0) {...} else if (c) {...} ... -> if (c) {...} ...
+        children = detach_children(if_node, &count);
+        for (int child_idx = 0; child_idx < branch->num_children; child_idx++) {
+            add_child(if_node, branch->children[child_idx]);
+        }
+        for (int child_idx = branch_idx + 1; child_idx < count; child_idx++) {
+            add_child(if_node, children[child_idx]);
+        }
+        for (int child_idx = 0; child_idx < branch_idx; child_idx++) {
+            free_node(children[child_idx]);
+        }
+        branch->num_children = 0;
+        free_node(branch);
+        free(children);
+        (*rewrites)++;
+    }
+
+    branch_idx = first_branch_index(if_node);
+    while (branch_idx < if_node->num_children) {
+        ASTNode *branch = if_node->children[branch_idx];
+
+        if (branch->type != NODE_ELSE_IF_STATEMENT || branch->num_children == 0 ||
+            !optimize_int_literal(branch->children[0], &condition)) {
+            branch_idx++;
+            continue;
+        }
+
+        (*rewrites)++;
+        if (!condition) {
+            remove_child_at(if_node, branch_idx);
+            continue;
+        }
+
+        // A true else-if is the final else; later branches never run
+        remove_child_at(branch, 0);
+        branch->type = NODE_ELSE_STATEMENT;
+        while (if_node->num_children > branch_idx + 1) {
+            remove_child_at(if_node, branch_idx + 1);
+        }
+        break;
+    }
+    return BRANCH_KEEP;
+}
+
+static void simplify_block(ASTNode *block, int first, int *rewrites);
+
+// Append what remains of one statement to block
+static void append_statement(ASTNode *block, ASTNode *statement, int *rewrites)
+{
+    ASTNode *construct = wrapped_construct(statement);
+    ASTNode *live = NULL;
+    int live_first = 0;
+    int32_t condition = 0;
+    int condition_idx = 0;
+
+    if (!construct) {
+        add_child(block, statement);
+        return;
+    }
+
+    switch (construct->type) {
+        case NODE_IF_STATEMENT:
+            simplify_block(construct, 1, rewrites);
+            for (int branch_idx = first_branch_index(construct); branch_idx < construct->num_children; branch_idx++) {
+                ASTNode *branch = construct->children[branch_idx];
+                simplify_block(branch, branch->type == NODE_ELSE_IF_STATEMENT ? 1 : 0, rewrites);
+            }
+
+            switch (prune_if(construct, &live, &live_first, rewrites)) {
+                case BRANCH_REMOVE:
+                    free_node(statement);
+                    (*rewrites)++;
+                    return;
+                case BRANCH_SPLICE:
+                    // Declarations would leak out of their block scope
+                    if (declares_locals(live, live_first)) {
+                        break;
+                    }
+                    for (int child_idx = live_first; child_idx < live->num_children &&
+                         live->children[child_idx]->type == NODE_STATEMENT; child_idx++) {
+                        add_child(block, live->children[child_idx]);
+                        live->children[child_idx] = NULL;
+                    }
+                    free_node(statement);
+                    (*rewrites)++;
+                    return;
+                case BRANCH_KEEP:
+                default:
+                    break;
+            }
+            break;
+
+        case NODE_WHILE_STATEMENT:
+            simplify_block(construct, 1, rewrites);
+            if (construct->num_children > 0 &&
+                optimize_int_literal(construct->children[0], &condition) && !condition) {
+                free_node(statement);
+                (*rewrites)++;
+                return;
+            }
+            break;
+
+        case NODE_FOR_STATEMENT:
+            condition_idx = for_condition_index(construct);
+            simplify_block(construct, condition_idx + 1, rewrites);
+            if (condition_idx < construct->num_children &&
+                optimize_int_literal(construct->children[condition_idx], &condition) && !condition) {
+                (*rewrites)++;
+                // for (i = 0; 0; ...) still runs its init assignment once
+                if (condition_idx == 1 && construct->children[0]->type == NODE_ASSIGNMENT) {
+                    statement->children[0] = construct->children[0];
+                    statement->children[0]->parent = statement;
+                    construct->children[0] = NULL;
+                    free_node(construct);
+                    break;
+                }
+                free_node(statement);
+                return;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    add_child(block, statement);
+}
+
+// Simplify the statements in block->children[first..]; other children
+// (conditions, else branches, for increments) are kept in place
+static void simplify_block(ASTNode *block, int first, int *rewrites)
+{
+    ASTNode **children = NULL;
+    int count = 0;
+    int reachable = 1;
+
+    children = detach_children(block, &count);
+    for (int child_idx = 0; child_idx < count; child_idx++) {
+        ASTNode *child = children[child_idx];
+        int appended_from = block->num_children;
+
+        if (child_idx < first || child->type != NODE_STATEMENT) {
+            add_child(block, child);
+            continue;
+        }
+        if (!reachable) {
+            free_node(child);
+            (*rewrites)++;
+            continue;
+        }
+
+        append_statement(block, child, rewrites);
+        if (block->num_children > appended_from &&
+            is_terminator(block->children[block->num_children - 1])) {
+            reachable = 0;
+        }
+    }
+    free(children);
+}
+
+// -------------------------------------------------------------
+// Unused locals
+// -------------------------------------------------------------
+
+// Helper: name of the variable an assignment target writes (a, a[i], a.f)
+static const char* written_name(const ASTNode *target)
+{
+    while (target && (target->type == NODE_INDEX_EXPR || target->type == NODE_MEMBER_EXPR) &&
+           target->num_children > 0) {
+        target = target->children[0];
+    }
+    if (!target || target->type != NODE_EXPRESSION || !target->value) {
+        return NULL;
+    }
+    return target->value;
+}
+
+// Helper: bump the read count of an identifier
+static void count_read(FunctionUsage *usage, const char *name)
+{
+    InternId id = intern_cstr(name);
+    int reads = 0;
+
+    symbol_lookup(&usage->reads, id, &reads);
+    symbol_define(&usage->reads, id, reads + 1);
+}
+
+static void count_reads(FunctionUsage *usage, const ASTNode *node);
+
+// Reads inside an assignment target: indices are read, the variable is not
+static void count_target_reads(FunctionUsage *usage, const ASTNode *target)
+{
+    if (target->type == NODE_INDEX_EXPR && target->num_children == 2) {
+        count_target_reads(usage, target->children[0]);
+        count_reads(usage, target->children[1]);
+    } else if (target->type == NODE_MEMBER_EXPR && target->num_children == 1) {
+        count_target_reads(usage, target->children[0]);
+    } else if (target->type != NODE_EXPRESSION) {
+        count_reads(usage, target);
+    }
+}
+
+static void count_reads(FunctionUsage *usage, const ASTNode *node)
+{
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_VAR_DECL) {
+        symbol_define(&usage->locals, intern_cstr(node->value), 1);
+    } else if (node->type == NODE_ASSIGNMENT && node->num_children > 0) {
+        const char *name = written_name(node->children[0]);
+
+        // Such a write stays (see is_dead_store), and so must the signal
+        if (name && (node->num_children != 2 || !optimize_is_pure(node->children[1]))) {
+            symbol_define(&usage->kept_writes, intern_cstr(name), 1);
+        }
+        count_target_reads(usage, node->children[0]);
+        for (int child_idx = 1; child_idx < node->num_children; child_idx++) {
+            count_reads(usage, node->children[child_idx]);
+        }
+        return;
+    } else if (node->type == NODE_EXPRESSION && node->value &&
+               (isalpha((unsigned char)node->value[0]) || node->value[0] == '_')) {
+        count_read(usage, node->value);
+    }
+
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        count_reads(usage, node->children[child_idx]);
+    }
+}
+
+// Helper: local that is declared in the function and never read
+static int is_unused_local(const FunctionUsage *usage, const char *name)
+{
+    InternId id = INTERN_NONE;
+
+    if (!name) {
+        return 0;
+    }
+    id = intern_find(name, strlen(name));
+    return id != INTERN_NONE && symbol_lookup(&usage->locals, id, NULL) &&
+           !symbol_lookup(&usage->reads, id, NULL);
+}
+
+// Helper: statement only declares or writes an unused local
+static int is_dead_store(const FunctionUsage *usage, const ASTNode *statement)
+{
+    const ASTNode *construct = wrapped_construct(statement);
+
+    if (!construct) {
+        return 0;
+    }
+    if (construct->type == NODE_VAR_DECL) {
+        return is_unused_local(usage, construct->value) && optimize_is_pure(construct) &&
+               !symbol_lookup(&usage->kept_writes, intern_find(construct->value, strlen(construct->value)), NULL);
+    }
+    if (construct->type == NODE_ASSIGNMENT && construct->num_children == 2) {
+        return is_unused_local(usage, written_name(construct->children[0])) &&
+               optimize_is_pure(construct->children[1]);
+    }
+    return 0;
+}
+
+static void remove_dead_stores(const FunctionUsage *usage, ASTNode *node, int *rewrites)
+{
+    int child_idx = 0;
+
+    while (child_idx < node->num_children) {
+        ASTNode *child = node->children[child_idx];
+
+        if (child->type == NODE_STATEMENT && is_dead_store(usage, child)) {
+            remove_child_at(node, child_idx);
+            (*rewrites)++;
+            continue;
+        }
+        // Statements never nest inside expressions
+        if (child->type == NODE_STATEMENT || child->type == NODE_IF_STATEMENT ||
+            child->type == NODE_ELSE_IF_STATEMENT || child->type == NODE_ELSE_STATEMENT ||
+            child->type == NODE_WHILE_STATEMENT || child->type == NODE_FOR_STATEMENT) {
+            remove_dead_stores(usage, child, rewrites);
+        }
+        child_idx++;
+    }
+}
+
+// Drop unused locals until removing one no longer frees another
+static void remove_unused_locals(FunctionUsage *usage, ASTNode *function, int *rewrites)
+{
+    int removed = 0;
+
+    do {
+        symbol_table_clear(&usage->locals);
+        symbol_table_clear(&usage->reads);
+        symbol_table_clear(&usage->kept_writes);
+
+        for (int child_idx = 0; child_idx < function->num_children; child_idx++) {
+            // Parameters are ports, not locals
+            if (function->children[child_idx]->type != NODE_VAR_DECL) {
+                count_reads(usage, function->children[child_idx]);
+            }
+        }
+
+        removed = 0;
+        remove_dead_stores(usage, function, &removed);
+        *rewrites += removed;
+    } while (removed > 0);
+}
+
+int eliminate_dead_code(ASTNode *program)
+{
+    return eliminate_dead_code_function(program, NULL);
+}
+
+int eliminate_dead_code_function(ASTNode *program, ASTNode *only)
+{
+    FunctionUsage usage;
+    int rewrites = 0;
+
+    if (!program) {
+        return 0;
+    }
+
+    symbol_table_init(&usage.locals);
+    symbol_table_init(&usage.reads);
+    symbol_table_init(&usage.kept_writes);
+
+    for (int child_idx = 0; child_idx < program->num_children; child_idx++) {
+        ASTNode *function = program->children[child_idx];
+        if (function->type != NODE_FUNCTION_DECL || (only && function != only)) {
+            continue;
+        }
+        simplify_block(function, 0, &rewrites);
+        remove_unused_locals(&usage, function, &rewrites);
+    }
+
+    symbol_table_free(&usage.locals);
+    symbol_table_free(&usage.reads);
+    symbol_table_free(&usage.kept_writes);
+    return rewrites;
+}
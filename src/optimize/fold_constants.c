@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "optimize.h"
+#include "symbol_table.h"
+#include "intern.h"
+#include "utils.h"
+
+// Large enough for any int32_t in decimal plus sign and NUL
+#define LITERAL_TEXT_SIZE 16
+
+
+// Folding and propagation feed each other; this bounds the ping-pong
+#define MAX_FOLD_ROUNDS 8
+
+// A local variable considered for constant propagation
+typedef struct {
+    int32_t value;
+    int declarations;          // NODE_VAR_DECLs with this name in the function
+    int writes;                // Assignments to the name (parameters count as one)
+    int has_literal;           // Every declaration was a scalar int = literal
+} ConstantCandidate;
+
+typedef struct {
+    SymbolTable names;         // Name -> candidate index
+    ConstantCandidate *candidates;
+    int count;
+    int capacity;
+} FunctionConstants;
+
+// Helper: wrap a 64-bit intermediate to C int (two's complement)
+static int32_t wrap_int32(int64_t value)
+{
+    return (int32_t)(uint32_t)(uint64_t)value;
+}
+
+// Helper: turn node into the literal `value` in place (children are dropped)
+static void become_literal(ASTNode *node, int32_t value)
+{
+    char text[LITERAL_TEXT_SIZE];
+
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        free_node(node->children[child_idx]);
+    }
+    node->num_children = 0;
+
+    snprintf(text, sizeof(text), "%ld", (long)value);
+    node->type = NODE_EXPRESSION;
+    set_node_value(node, text);
+    node->token.type = TOKEN_NUMBER;
+    node->token.id = intern_cstr(text);
+}
+
+// Helper: replace node by one of its children, returning the survivor
+static ASTNode* replace_with_child(ASTNode *node, int keep_index)
+{
+    ASTNode *kept = node->children[keep_index];
+
+    node->children[keep_index] = NULL;
+    kept->parent = node->parent;
+    free_node(node);
+    return kept;
+}
+
+// Evaluate `left op right` with C int semantics; 0 if it must stay unfolded
+static int evaluate_binary(InternId op, int32_t left, int32_t right, int32_t *result)
+{
+    int64_t wide_left = left;
+    int64_t wide_right = right;
+
+    switch (op) {
+        case INTERN_OP_PLUS:          *result = wrap_int32(wide_left + wide_right); return 1;
+        case INTERN_OP_MINUS:         *result = wrap_int32(wide_left - wide_right); return 1;
+        case INTERN_OP_MULTIPLY:      *result = wrap_int32(wide_left * wide_right); return 1;
+        case INTERN_OP_BITWISE_AND:   *result = left & right; return 1;
+        case INTERN_OP_BITWISE_OR:    *result = left | right; return 1;
+        case INTERN_OP_BITWISE_XOR:   *result = left ^ right; return 1;
+        case INTERN_OP_EQUAL:         *result = left == right; return 1;
+        case INTERN_OP_NOT_EQUAL:     *result = left != right; return 1;
+        case INTERN_OP_LESS:          *result = left < right; return 1;
+        case INTERN_OP_LESS_EQUAL:    *result = left <= right; return 1;
+        case INTERN_OP_GREATER:       *result = left > right; return 1;
+        case INTERN_OP_GREATER_EQUAL: *result = left >= right; return 1;
+        case INTERN_OP_LOGICAL_AND:   *result = left && right; return 1;
+        case INTERN_OP_LOGICAL_OR:    *result = left || right; return 1;
+        case INTERN_OP_DIVIDE:
+        case INTERN_OP_MODULO:
+            // Division by zero and INT_MIN / -1 are undefined in C
+            if (right == 0 || (left == INT32_MIN && right == -1)) {
+                return 0;
+            }
+            *result = (op == INTERN_OP_DIVIDE) ? left / right : left % right;
+            return 1;
+        case INTERN_OP_SHIFT_LEFT:
+            if (right < 0 || right >= 32) {
+                return 0;
+            }
+            *result = (int32_t)((uint32_t)left << right);
+            return 1;
+        case INTERN_OP_SHIFT_RIGHT:
+            // Negative operands shift arithmetically in C but logically in the
+            // generated unsigned hardware, so only fold the unambiguous case
+            if (right < 0 || right >= 32 || left < 0) {
+                return 0;
+            }
+            *result = left >> right;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// (x op c1) op c2 -> x op (c1 op c2) for associative, commutative operators,
+// and (x +/- c1) +/- c2 -> x +/- c for additive chains. The caller checks
+// that x wraps at 32 bits, as the combined literal does.
+static int reassociate(ASTNode *node, InternId op)
+{
+    ASTNode *inner = node->children[0];
+    InternId inner_op = INTERN_NONE;
+    int32_t inner_constant = 0;
+    int32_t outer_constant = 0;
+    int32_t combined = 0;
+    int additive = (op == INTERN_OP_PLUS || op == INTERN_OP_MINUS);
+
+    if (!additive && op != INTERN_OP_MULTIPLY && op != INTERN_OP_BITWISE_AND &&
+        op != INTERN_OP_BITWISE_OR && op != INTERN_OP_BITWISE_XOR) {
+        return 0;
+    }
+    if (inner->type != NODE_BINARY_EXPR || inner->num_children != 2 ||
+        !optimize_int_literal(inner->children[1], &inner_constant) ||
+        !optimize_int_literal(node->children[1], &outer_constant)) {
+        return 0;
+    }
+
+    inner_op = inner->token.id;
+    if (additive) {
+        int64_t offset = 0;
+
+        if (inner_op != INTERN_OP_PLUS && inner_op != INTERN_OP_MINUS) {
+            return 0;
+        }
+        offset = (inner_op == INTERN_OP_PLUS ? (int64_t)inner_constant : -(int64_t)inner_constant) +
+                 (op == INTERN_OP_PLUS ? (int64_t)outer_constant : -(int64_t)outer_constant);
+        // Keep the literal non-negative so codegen emits a plain subtraction
+        if (offset < 0 && offset != INT32_MIN) {
+            set_node_operator(node, INTERN_OP_MINUS);
+            combined = wrap_int32(-offset);
+        } else {
+            set_node_operator(node, INTERN_OP_PLUS);
+            combined = wrap_int32(offset);
+        }
+    } else if (inner_op != op || !evaluate_binary(op, inner_constant, outer_constant, &combined)) {
+        return 0;
+    }
+
+    become_literal(node->children[1], combined);
+    node->children[0] = replace_with_child(inner, 0);
+    node->children[0]->parent = node;
+    return 1;
+}
+
+/**
+ * Algebraic identities; returns the replacement node or NULL when none
+ * applies. left_wraps/right_wraps tell whether each operand wraps at 32
+ * bits: x*0 is not 0 for a NaN, nor x+0 the same type as a double x, so
+ * the literal's operand must be an int.
+ */
+static ASTNode* simplify_identity(ASTNode *node, InternId op, int left_wraps, int right_wraps, int *rewrites)
+{
+    ASTNode *left = node->children[0];
+    ASTNode *right = node->children[1];
+    int32_t constant = 0;
+    int left_is_constant = right_wraps && optimize_int_literal(left, &constant);
+    int32_t left_constant = constant;
+    int right_is_constant = left_wraps && optimize_int_literal(right, &constant);
+    int32_t right_constant = constant;
+    int keep = -1;
+
+    switch (op) {
+        case INTERN_OP_PLUS:
+        case INTERN_OP_BITWISE_OR:
+        case INTERN_OP_BITWISE_XOR:
+            if (right_is_constant && right_constant == 0) {
+                keep = 0;
+            } else if (left_is_constant && left_constant == 0) {
+                keep = 1;
+            }
+            break;
+        case INTERN_OP_MINUS:
+        case INTERN_OP_SHIFT_LEFT:
+        case INTERN_OP_SHIFT_RIGHT:
+            if (right_is_constant && right_constant == 0) {
+                keep = 0;
+            }
+            break;
+        case INTERN_OP_DIVIDE:
+            if (right_is_constant && right_constant == 1) {
+                keep = 0;
+            }
+            break;
+        case INTERN_OP_MULTIPLY:
+        case INTERN_OP_BITWISE_AND:
+            if ((right_is_constant && right_constant == 0 && optimize_is_pure(left)) ||
+                (left_is_constant && left_constant == 0 && optimize_is_pure(right))) {
+                become_literal(node, 0);
+                (*rewrites)++;
+                return node;
+            }
+            if (op == INTERN_OP_MULTIPLY) {
+                if (right_is_constant && right_constant == 1) {
+                    keep = 0;
+                } else if (left_is_constant && left_constant == 1) {
+                    keep = 1;
+                }
+            } else if (right_is_constant && right_constant == -1) {
+                keep = 0;
+            } else if (left_is_constant && left_constant == -1) {
+                keep = 1;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // A comparison turned into a bare operand would change its VHDL type
+    if (keep < 0 || optimize_is_boolean_valued(node->children[keep])) {
+        return NULL;
+    }
+    (*rewrites)++;
+    return replace_with_child(node, keep);
+}
+
+/**
+ * Fold one subtree bottom-up; returns the node that now stands in its place
+ * and sets *wraps to whether its value wraps at 32 bits
+ */
+static ASTNode* fold_node(const OptimizeWrapScope *scope, ASTNode *node, int *rewrites, int *wraps)
+{
+    InternId op = INTERN_NONE;
+    int32_t left = 0;
+    int32_t right = 0;
+    int32_t result = 0;
+    int first_wraps = 1;
+    int last_wraps = 1;
+    int children_wrap = 1;
+    ASTNode *simplified = NULL;
+
+    *wraps = 0;
+    if (!node) {
+        return NULL;
+    }
+
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        int child_wraps = 0;
+
+        node->children[child_idx] = fold_node(scope, node->children[child_idx], rewrites, &child_wraps);
+        if (node->children[child_idx]) {
+            node->children[child_idx]->parent = node;
+            children_wrap &= child_wraps;
+            last_wraps = child_wraps;
+            if (child_idx == 0) {
+                first_wraps = child_wraps;
+            }
+        }
+    }
+    *wraps = optimize_wraps_at_int(scope, node, first_wraps, children_wrap);
+
+    if (node->type == NODE_UNARY_EXPR && node->num_children == 1 &&
+        optimize_int_literal(node->children[0], &left)) {
+        op = node->token.id;
+        if (op == INTERN_OP_LOGICAL_NOT) {
+            become_literal(node, !left);
+        } else if (op == INTERN_OP_BITWISE_NOT) {
+            become_literal(node, ~left);
+        } else if (op == INTERN_OP_MINUS) {
+            become_literal(node, wrap_int32(-(int64_t)left));
+        } else {
+            return node;
+        }
+        (*rewrites)++;
+        *wraps = 1;
+        return node;
+    }
+
+    if (node->type != NODE_BINARY_EXPR || node->num_children != 2 ||
+        !node->children[0] || !node->children[1]) {
+        return node;
+    }
+
+    op = node->token.id;
+    if (optimize_int_literal(node->children[0], &left) && optimize_int_literal(node->children[1], &right) &&
+        evaluate_binary(op, left, right, &result)) {
+        become_literal(node, result);
+        (*rewrites)++;
+        *wraps = 1;
+        return node;
+    }
+
+    // Only an int x may take a literal combined with C int arithmetic: a
+    // double or 64-bit x would have the literals folded in its own type
+    if (first_wraps && reassociate(node, op)) {
+        op = node->token.id;
+        (*rewrites)++;
+    }
+
+    // An identity keeps the int operand or becomes the literal 0
+    simplified = simplify_identity(node, op, first_wraps, last_wraps, rewrites);
+    return simplified ? simplified : node;
+}
+
+ASTNode* fold_subtree(const ASTNode *function, ASTNode *node)
+{
+    OptimizeWrapScope scope;
+    ASTNode *folded = node;
+
+    optimize_wrap_scope_init(&scope, function ? function->parent : NULL);
+    if (function) {
+        optimize_wrap_scope_enter(&scope, function);
+    }
+
+    for (int round = 0; round < MAX_FOLD_ROUNDS; round++) {
+        int rewrites = 0;
+        int wraps = 0;
+
+        folded = fold_node(&scope, folded, &rewrites, &wraps);
+        if (rewrites == 0) {
+            break;
+        }
+    }
+
+    optimize_wrap_scope_free(&scope);
+    return folded;
+}
+
+// -------------------------------------------------------------
+// Constant propagation
+// -------------------------------------------------------------
+
+// Helper: candidate slot for a name, created on first sight
+static ConstantCandidate* candidate_for(FunctionConstants *constants, const char *name)
+{
+    InternId id = intern_cstr(name);
+    int index = 0;
+
+    if (symbol_lookup(&constants->names, id, &index)) {
+        return &constants->candidates[index];
+    }
+
+    if (constants->count >= constants->capacity) {
+        constants->capacity = constants->capacity ? constants->capacity * 2 : 16;
+        constants->candidates = (ConstantCandidate*)xrealloc(constants->candidates,
+            (size_t)constants->capacity * sizeof(ConstantCandidate));
+    }
+    index = constants->count++;
+    memset(&constants->candidates[index], 0, sizeof(ConstantCandidate));
+    constants->candidates[index].has_literal = 1;
+    symbol_define(&constants->names, id, index);
+    return &constants->candidates[index];
+}
+
+// Record declarations and writes of every name in a function body
+static void collect_candidates(FunctionConstants *constants, const ASTNode *node)
+{
+    ConstantCandidate *candidate = NULL;
+    int32_t value = 0;
+
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_VAR_DECL && node->value) {
+        candidate = candidate_for(constants, node->value);
+        candidate->declarations++;
+        if (node->array_size == 0 && node->token.id == INTERN_KW_INT &&
+            node->num_children == 1 && optimize_int_literal(node->children[0], &value)) {
+            candidate->value = value;
+        } else {
+            candidate->has_literal = 0;
+        }
+    } else if (node->type == NODE_ASSIGNMENT && node->num_children > 0 &&
+               node->children[0]->type == NODE_EXPRESSION && node->children[0]->value) {
+        candidate_for(constants, node->children[0]->value)->writes++;
+    }
+
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        collect_candidates(constants, node->children[child_idx]);
+    }
+}
+
+// Replace reads of propagatable names with their literal value
+static void substitute_constants(FunctionConstants *constants, ASTNode *node, int *rewrites)
+{
+    InternId id = INTERN_NONE;
+    int index = 0;
+
+    if (!node) {
+        return;
+    }
+
+    if (node->type == NODE_EXPRESSION && node->value &&
+        (isalpha((unsigned char)node->value[0]) || node->value[0] == '_')) {
+        id = intern_find(node->value, strlen(node->value));
+        if (id != INTERN_NONE && symbol_lookup(&constants->names, id, &index)) {
+            const ConstantCandidate *candidate = &constants->candidates[index];
+            if (candidate->declarations == 1 && candidate->writes == 0 && candidate->has_literal) {
+                become_literal(node, candidate->value);
+                (*rewrites)++;
+            }
+        }
+        return;
+    }
+
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        substitute_constants(constants, node->children[child_idx], rewrites);
+    }
+}
+
+static void propagate_function_constants(FunctionConstants *constants, ASTNode *function, int *rewrites)
+{
+    symbol_table_clear(&constants->names);
+    constants->count = 0;
+
+    // Parameters are inputs, never constants
+    for (int child_idx = 0; child_idx < function->num_children; child_idx++) {
+        ASTNode *child = function->children[child_idx];
+        if (child->type == NODE_VAR_DECL && child->value) {
+            candidate_for(constants, child->value)->writes++;
+        } else {
+            collect_candidates(constants, child);
+        }
+    }
+
+    for (int child_idx = 0; child_idx < function->num_children; child_idx++) {
+        if (function->children[child_idx]->type != NODE_VAR_DECL) {
+            substitute_constants(constants, function->children[child_idx], rewrites);
+        }
+    }
+}
+
+int fold_constants(ASTNode *program)
+{
+    return fold_constants_function(program, NULL);
+}
+
+int fold_constants_function(ASTNode *program, ASTNode *only)
+{
+    FunctionConstants constants;
+    OptimizeWrapScope scope;
+    int total_rewrites = 0;
+
+    if (!program) {
+        return 0;
+    }
+
+    memset(&constants, 0, sizeof(constants));
+    symbol_table_init(&constants.names);
+    optimize_wrap_scope_init(&scope, program);
+
+    for (int round = 0; round < MAX_FOLD_ROUNDS; round++) {
+        int rewrites = 0;
+
+        for (int child_idx = 0; child_idx < program->num_children; child_idx++) {
+            ASTNode *function = program->children[child_idx];
+            int wraps = 0;
+
+            if (function->type != NODE_FUNCTION_DECL || (only && function != only)) {
+                continue;
+            }
+            optimize_wrap_scope_enter(&scope, function);
+            fold_node(&scope, function, &rewrites, &wraps);
+            propagate_function_constants(&constants, function, &rewrites);
+        }
+
+        total_rewrites += rewrites;
+        if (rewrites == 0) {
+            break;
+        }
+    }
+
+    symbol_table_free(&constants.names);
+    optimize_wrap_scope_free(&scope);
+    free(constants.candidates);
+    return total_rewrites;
+}
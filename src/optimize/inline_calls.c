@@ -0,0 +1,308 @@
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "symbol_table.h"
+#include "intern.h"
+#include "utils.h"
+
+// Inlined bodies may call further small functions; this bounds the nesting
+// (and ends mutual recursion)
+#define MAX_INLINE_DEPTH 8
+
+// What a callee name stands for while its body is substituted
+typedef struct {
+    ASTNode *value;            // Expression over the caller's names (NULL = not yet assigned)
+    int uses;                  // Copies made of value
+    int impure;                // value calls a function: must be used exactly once
+} InlineBinding;
+
+typedef struct {
+    SymbolTable functions;     // Function name -> index among the program children
+    const ASTNode *program;
+    int limit;
+    SymbolTable names;         // Callee name -> binding index (one call at a time)
+    InlineBinding *bindings;
+    int count;
+    int capacity;
+} InlineContext;
+
+// Helper: a scalar of a built-in type (struct types are identifiers)
+static int is_scalar_declaration(const ASTNode *node)
+{
+    return node->type == NODE_VAR_DECL && node->value && node->array_size == 0 &&
+           node->token.type == TOKEN_KEYWORD && node->token.id != INTERN_KW_VOID;
+}
+
+static int count_nodes(const ASTNode *node)
+{
+    int count = 1;
+
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        count += count_nodes(node->children[child_idx]);
+    }
+    return count;
+}
+
+// Helper: fresh copy of a subtree in the active arena
+static ASTNode* clone_tree(const ASTNode *node)
+{
+    ASTNode *copy = create_node(node->type);
+
+    copy->token = node->token;
+    copy->array_size = node->array_size;
+    set_node_value(copy, node->value);
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        add_child(copy, clone_tree(node->children[child_idx]));
+    }
+    return copy;
+}
+
+static void bind_name(InlineContext *context, const char *name, ASTNode *value)
+{
+    int index = context->count;
+
+    if (context->count == context->capacity) {
+        context->capacity = context->capacity ? context->capacity * 2 : 8;
+        context->bindings = (InlineBinding*)xrealloc(context->bindings,
+                                                     (size_t)context->capacity * sizeof(InlineBinding));
+    }
+    context->count++;
+    context->bindings[index].value = value;
+    context->bindings[index].uses = 0;
+    context->bindings[index].impure = value ? !optimize_is_pure(value) : 0;
+    symbol_define(&context->names, intern_cstr(name), index);
+}
+
+// Helper: a binding whose value is dropped or copied must not lose or repeat a call
+static int binding_consistent(const InlineBinding *binding)
+{
+    return !binding->impure || binding->uses == 1;
+}
+
+// Copy of a callee expression with every callee name replaced by its value;
+// *ok is cleared when a name has no value
+static ASTNode* substitute(InlineContext *context, const ASTNode *node, int *ok)
+{
+    const char *name = identifier_name(node);
+    ASTNode *copy = NULL;
+    int index = 0;
+
+    if (name) {
+        if (!symbol_lookup(&context->names, intern_find(name, strlen(name)), &index) ||
+            !context->bindings[index].value) {
+            *ok = 0;
+            return clone_tree(node);
+        }
+        context->bindings[index].uses++;
+        copy = clone_tree(context->bindings[index].value);
+        if (node->value[0] == '-') {
+            ASTNode *negation = create_node(NODE_UNARY_EXPR);
+            set_node_value(negation, "-");
+            add_child(negation, copy);
+            copy = negation;
+        }
+        return copy;
+    }
+
+    // Call names and field names are not variables
+    copy = create_node(node->type);
+    copy->token = node->token;
+    copy->array_size = node->array_size;
+    set_node_value(copy, node->value);
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        add_child(copy, substitute(context, node->children[child_idx], ok));
+    }
+    return copy;
+}
+
+// Helper: "#pragma compi inline [off]" on the first statement of a function
+// (1 = always inline, -1 = never, 0 = size decides)
+static int inline_request(const ASTNode *function)
+{
+    for (int child_idx = 0; child_idx < function->num_children; child_idx++) {
+        const ASTNode *child = function->children[child_idx];
+        const char *arguments = NULL;
+
+        if (child->type != NODE_STATEMENT) {
+            continue;
+        }
+        arguments = find_node_pragma(child, "inline");
+        if (!arguments) {
+            return 0;
+        }
+        return (strncmp(arguments, "off", 3) == 0) ? -1 : 1;
+    }
+    return 0;
+}
+
+// Helper: bind the body of the callee statement by statement up to its
+// return; returns the substituted return value, or NULL if the body is
+// not a straight sequence of scalar declarations and assignments
+static ASTNode* substitute_body(InlineContext *context, const ASTNode *callee, int *ok)
+{
+    int index = 0;
+
+    for (int child_idx = 0; child_idx < callee->num_children; child_idx++) {
+        const ASTNode *statement = callee->children[child_idx];
+        const ASTNode *construct = NULL;
+        const char *name = NULL;
+
+        if (statement->type == NODE_VAR_DECL) {
+            continue; // Parameters, bound by the caller
+        }
+        if (statement->type != NODE_STATEMENT || statement->num_children != 1) {
+            return NULL;
+        }
+        if (optimize_is_return_statement(statement)) {
+            // Statements after the return are dead
+            return substitute(context, statement->children[0], ok);
+        }
+
+        construct = statement->children[0];
+        if (is_scalar_declaration(construct) && construct->num_children <= 1) {
+            bind_name(context, construct->value,
+                      construct->num_children ? substitute(context, construct->children[0], ok) : NULL);
+        } else if (construct->type == NODE_ASSIGNMENT && construct->num_children == 2 &&
+                   (name = identifier_name(construct->children[0])) != NULL &&
+                   construct->children[0]->value[0] != '-' &&
+                   symbol_lookup(&context->names, intern_find(name, strlen(name)), &index)) {
+            // The overwritten value keeps its binding (and use count)
+            bind_name(context, name, substitute(context, construct->children[1], ok));
+        } else {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+// Inlined replacement of call, or NULL to keep the call
+static ASTNode* inline_call(InlineContext *context, const ASTNode *caller, const ASTNode *call)
+{
+    const ASTNode *callee = NULL;
+    ASTNode *result = NULL;
+    Arena *previous_arena = NULL;
+    int function_idx = 0;
+    int parameter_count = 0;
+    int request = 0;
+    int ok = 1;
+
+    if (!call->value ||
+        !symbol_lookup(&context->functions, intern_find(call->value, strlen(call->value)), &function_idx)) {
+        return NULL;
+    }
+    callee = context->program->children[function_idx];
+    request = inline_request(callee);
+    if (callee == caller || request < 0 || callee->token.type != TOKEN_KEYWORD ||
+        callee->token.id == INTERN_KW_VOID) {
+        return NULL;
+    }
+
+    // Copies live as long as the caller's tree
+    previous_arena = ast_use_arena(call->arena);
+    symbol_table_clear(&context->names);
+    context->count = 0;
+
+    for (int child_idx = 0; child_idx < callee->num_children && ok; child_idx++) {
+        const ASTNode *parameter = callee->children[child_idx];
+
+        if (parameter->type != NODE_VAR_DECL) {
+            continue;
+        }
+        if (!is_scalar_declaration(parameter) || parameter_count >= call->num_children) {
+            ok = 0;
+            break;
+        }
+        bind_name(context, parameter->value, clone_tree(call->children[parameter_count++]));
+    }
+    ok = ok && parameter_count == call->num_children;
+
+    if (ok) {
+        result = substitute_body(context, callee, &ok);
+    }
+    for (int index = 0; index < context->count; index++) {
+        ok = ok && binding_consistent(&context->bindings[index]);
+        free_node(context->bindings[index].value);
+    }
+    if (result && (!ok || optimize_is_boolean_valued(result) ||
+                   (request == 0 && count_nodes(result) > context->limit))) {
+        free_node(result);
+        result = NULL;
+    }
+
+    ast_use_arena(previous_arena);
+    return result;
+}
+
+// Replace the inlinable calls below node, innermost first
+static void inline_in_tree(InlineContext *context, const ASTNode *caller, ASTNode *node, int depth,
+                           int *rewrites)
+{
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        ASTNode *child = node->children[child_idx];
+        ASTNode *replacement = NULL;
+
+        if (!child) {
+            continue;
+        }
+        inline_in_tree(context, caller, child, depth, rewrites);
+
+        // A call made for nothing but its side effects stays a call
+        if (child->type != NODE_FUNC_CALL ||
+            (node->type == NODE_STATEMENT && !optimize_is_return_statement(node))) {
+            continue;
+        }
+        replacement = inline_call(context, caller, child);
+        if (!replacement) {
+            continue;
+        }
+        node->children[child_idx] = replacement;
+        replacement->parent = node;
+        free_node(child);
+        (*rewrites)++;
+
+        // The callee's own calls
+        if (depth + 1 < MAX_INLINE_DEPTH) {
+            inline_in_tree(context, caller, replacement, depth + 1, rewrites);
+        }
+    }
+}
+
+int inline_calls(ASTNode *program, int limit)
+{
+    return inline_calls_function(program, NULL, limit);
+}
+
+int inline_calls_function(ASTNode *program, ASTNode *only, int limit)
+{
+    InlineContext context;
+    int rewrites = 0;
+
+    if (!program) {
+        return 0;
+    }
+
+    memset(&context, 0, sizeof(context));
+    symbol_table_init(&context.functions);
+    symbol_table_init(&context.names);
+    context.program = program;
+    context.limit = limit;
+
+    for (int child_idx = 0; child_idx < program->num_children; child_idx++) {
+        const ASTNode *function = program->children[child_idx];
+        if (function->type == NODE_FUNCTION_DECL && function->value) {
+            symbol_define(&context.functions, intern_cstr(function->value), child_idx);
+        }
+    }
+
+    for (int child_idx = 0; child_idx < program->num_children; child_idx++) {
+        ASTNode *function = program->children[child_idx];
+        if (function->type == NODE_FUNCTION_DECL && (!only || function == only)) {
+            inline_in_tree(&context, function, function, 0, &rewrites);
+        }
+    }
+
+    symbol_table_free(&context.functions);
+    symbol_table_free(&context.names);
+    free(context.bindings);
+    return rewrites;
+}
@@ -0,0 +1,271 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "optimize.h"
+#include "intern.h"
+#include "utils.h"
+
+// Widest operand type whose arithmetic still wraps at 32 bits (C int)
+#define OPTIMIZE_MAX_WRAP_WIDTH 32
+
+// Passes feed each other (folding exposes dead branches, removing dead
+// writes exposes constants); this bounds the alternation
+#define MAX_OPTIMIZE_ROUNDS 4
+
+void optimize_options_default(OptimizeOptions *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->fold_constants = 1;
+    options->eliminate_dead_code = 1;
+    options->inline_calls = 1;
+    options->inline_limit = DEFAULT_INLINE_LIMIT;
+    options->balance_expressions = 1;
+}
+
+void optimize_options_none(OptimizeOptions *options)
+{
+    memset(options, 0, sizeof(*options));
+}
+
+// Helper: the pass schedule over every function of program, or only over
+// `only` when given
+static int optimize_functions(ASTNode *program, ASTNode *only, const OptimizeOptions *options)
+{
+    int rewrites = 0;
+
+    // Inlined bodies are folded together with their arguments
+    if (options->inline_calls) {
+        rewrites += inline_calls_function(program, only, options->inline_limit);
+    }
+
+    for (int round = 0; round < MAX_OPTIMIZE_ROUNDS; round++) {
+        int round_rewrites = 0;
+
+        if (options->fold_constants) {
+            round_rewrites += fold_constants_function(program, only);
+        }
+        if (options->eliminate_dead_code) {
+            round_rewrites += eliminate_dead_code_function(program, only);
+        }
+
+        rewrites += round_rewrites;
+        // A lone pass already runs to its own fixed point
+        if (round_rewrites == 0 || !(options->fold_constants && options->eliminate_dead_code)) {
+            break;
+        }
+    }
+
+    // Last, so folding still sees the literals at the end of parsed chains
+    if (options->balance_expressions) {
+        rewrites += balance_expressions_function(program, only);
+    }
+
+    return rewrites;
+}
+
+int optimize_program(ASTNode *program, const OptimizeOptions *options)
+{
+    if (!program || !options) {
+        return 0;
+    }
+    return optimize_functions(program, NULL, options);
+}
+
+int optimize_function(ASTNode *program, ASTNode *function, const OptimizeOptions *options)
+{
+    if (!program || !function || !options) {
+        return 0;
+    }
+    return optimize_functions(program, function, options);
+}
+
+int optimize_int_literal(const ASTNode *node, int32_t *value)
+{
+    const char *digits = NULL;
+    long long parsed = 0;
+
+    if (!node || node->type != NODE_EXPRESSION || !node->value) {
+        return 0;
+    }
+
+    digits = node->value[0] == '-' ? node->value + 1 : node->value;
+    // Leading zeros would be octal in C; leave those alone
+    if (!isdigit((unsigned char)digits[0]) || (digits[0] == '0' && digits[1] != '\0')) {
+        return 0;
+    }
+    for (const char *cursor = digits; *cursor; cursor++) {
+        if (!isdigit((unsigned char)*cursor)) {
+            return 0;
+        }
+    }
+
+    parsed = strtoll(node->value, NULL, 10);
+    if (parsed < INT32_MIN || parsed > INT32_MAX) {
+        return 0;
+    }
+    *value = (int32_t)parsed;
+    return 1;
+}
+
+int optimize_is_pure(const ASTNode *node)
+{
+    if (node->type == NODE_FUNC_CALL) {
+        return 0;
+    }
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        if (node->children[child_idx] && !optimize_is_pure(node->children[child_idx])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int optimize_is_boolean_valued(const ASTNode *node)
+{
+    if (node->type != NODE_BINARY_EXPR && node->type != NODE_UNARY_EXPR) {
+        return 0;
+    }
+    switch (node->token.id) {
+        case INTERN_OP_EQUAL:
+        case INTERN_OP_NOT_EQUAL:
+        case INTERN_OP_LESS:
+        case INTERN_OP_LESS_EQUAL:
+        case INTERN_OP_GREATER:
+        case INTERN_OP_GREATER_EQUAL:
+        case INTERN_OP_LOGICAL_AND:
+        case INTERN_OP_LOGICAL_OR:
+            return node->type == NODE_BINARY_EXPR;
+        case INTERN_OP_LOGICAL_NOT:
+            return node->type == NODE_UNARY_EXPR;
+        default:
+            return 0;
+    }
+}
+
+int optimize_is_return_statement(const ASTNode *node)
+{
+    return node->type == NODE_STATEMENT && node->token.id == INTERN_KW_RETURN;
+}
+
+// Helper: int, char and intN_t/uintN_t up to 32 bits promote to C int (or
+// unsigned int) and wrap there
+static int type_wraps_at_int(InternId type_id)
+{
+    int width = 0;
+
+    if (type_id == INTERN_KW_INT || type_id == INTERN_KW_CHAR) {
+        return 1;
+    }
+    width = ctype_explicit_width(intern_text(type_id), NULL);
+    return width > 0 && width <= OPTIMIZE_MAX_WRAP_WIDTH;
+}
+
+// Helper: 1 if every binding of name in the table wraps at 32 bits
+static void define_wrapping(SymbolTable *table, const char *name, int wraps)
+{
+    InternId id = intern_cstr(name);
+    int previous = 0;
+
+    // A name declared twice with different types is treated as not wrapping
+    if (symbol_lookup(table, id, &previous)) {
+        wraps = wraps && previous;
+    }
+    symbol_define(table, id, wraps);
+}
+
+static void collect_wrapping_locals(SymbolTable *locals, const ASTNode *node)
+{
+    if (node->type == NODE_VAR_DECL && node->value) {
+        define_wrapping(locals, node->value, type_wraps_at_int(node->token.id));
+    }
+    for (int child_idx = 0; child_idx < node->num_children; child_idx++) {
+        if (node->children[child_idx]) {
+            collect_wrapping_locals(locals, node->children[child_idx]);
+        }
+    }
+}
+
+void optimize_wrap_scope_init(OptimizeWrapScope *scope, const ASTNode *program)
+{
+    symbol_table_init(&scope->functions);
+    symbol_table_init(&scope->locals);
+    if (!program || program->type != NODE_PROGRAM) {
+        return;
+    }
+    for (int child_idx = 0; child_idx < program->num_children; child_idx++) {
+        const ASTNode *function = program->children[child_idx];
+
+        if (function->type == NODE_FUNCTION_DECL && function->value) {
+            define_wrapping(&scope->functions, function->value, type_wraps_at_int(function->token.id));
+        }
+    }
+}
+
+void optimize_wrap_scope_enter(OptimizeWrapScope *scope, const ASTNode *function)
+{
+    symbol_table_clear(&scope->locals);
+    collect_wrapping_locals(&scope->locals, function);
+}
+
+void optimize_wrap_scope_free(OptimizeWrapScope *scope)
+{
+    symbol_table_free(&scope->functions);
+    symbol_table_free(&scope->locals);
+}
+
+// Helper: a binary operator whose result is an int comparison or truth value
+static int is_truth_operator(InternId op)
+{
+    switch (op) {
+        case INTERN_OP_EQUAL:
+        case INTERN_OP_NOT_EQUAL:
+        case INTERN_OP_LESS:
+        case INTERN_OP_LESS_EQUAL:
+        case INTERN_OP_GREATER:
+        case INTERN_OP_GREATER_EQUAL:
+        case INTERN_OP_LOGICAL_AND:
+        case INTERN_OP_LOGICAL_OR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int optimize_wraps_at_int(const OptimizeWrapScope *scope, const ASTNode *node, int first_wraps,
+                          int children_wrap)
+{
+    int32_t literal = 0;
+    int value = 0;
+
+    switch (node->type) {
+        case NODE_EXPRESSION:
+            if (!node->value) {
+                return 0;
+            }
+            if (optimize_int_literal(node, &literal)) {
+                return 1;
+            }
+            return symbol_lookup(&scope->locals, intern_find(node->value, strlen(node->value)), &value) &&
+                   value;
+        case NODE_INDEX_EXPR:
+            // Declarations of arrays carry their element type
+            return node->num_children > 0 && first_wraps;
+        case NODE_FUNC_CALL:
+            return node->value &&
+                   symbol_lookup(&scope->functions, intern_find(node->value, strlen(node->value)), &value) &&
+                   value;
+        case NODE_UNARY_EXPR:
+            return node->token.id == INTERN_OP_LOGICAL_NOT || children_wrap;
+        case NODE_BINARY_EXPR:
+            if (is_truth_operator(node->token.id)) {
+                return 1;
+            }
+            // A shift has the type of its left operand
+            if (node->token.id == INTERN_OP_SHIFT_LEFT || node->token.id == INTERN_OP_SHIFT_RIGHT) {
+                return first_wraps;
+            }
+            return children_wrap;
+        default:
+            return 0;
+    }
+}
@@ -11,43 +11,42 @@
 #include "parse_function.h"
 #include "parse_statement.h"
 #include "codegen_vhdl.h"
+#include "parser_context.h"
 #include <ctype.h>
 
-// Current token shared by parsing modules
-extern Token current_token;
 
 // Forward declarations
-static ASTNode* parse_struct_declaration(FILE *input, ASTNode *program_node);
-static ASTNode* parse_function_declaration(FILE *input, Token return_type, ASTNode *program_node);
-static void skip_to_semicolon(FILE *input);
+static ASTNode* parse_struct_declaration(ParserContext *ctx, ASTNode *program_node);
+static ASTNode* parse_function_declaration(ParserContext *ctx, Token return_type, ASTNode *program_node);
+static void skip_to_semicolon(ParserContext *ctx);
 
 // Skip tokens until we find a semicolon or EOF
-static void skip_to_semicolon(FILE *input)
+static void skip_to_semicolon(ParserContext *ctx)
 {
-    while (!match(TOKEN_SEMICOLON) && !match(TOKEN_EOF)) {
-        advance(input);
+    while (!ctx_match(ctx, TOKEN_SEMICOLON) && !ctx_match(ctx, TOKEN_EOF)) {
+        ctx_advance(ctx);
     }
-    if (match(TOKEN_SEMICOLON)) {
-        advance(input);
+    if (ctx_match(ctx, TOKEN_SEMICOLON)) {
+        ctx_advance(ctx);
     }
 }
 
 // Parse struct declaration or function returning struct
-static ASTNode* parse_struct_declaration(FILE *input, ASTNode *program_node)
+static ASTNode* parse_struct_declaration(ParserContext *ctx, ASTNode *program_node)
 {
-    advance(input); // consume 'struct'
+    ctx_advance(ctx); // consume 'struct'
     
-    if (!match(TOKEN_IDENTIFIER)) {
-        printf("Warning: 'struct' without name at line %d\n", current_token.line);
+    if (!ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        printf("Warning: 'struct' without name at line %d\n", ctx->current_token.line);
         return NULL;
     }
     
-    Token struct_name_token = current_token;
-    advance(input);
+    Token struct_name_token = ctx->current_token;
+    ctx_advance(ctx);
     
     // struct definition: struct Name { ... };
-    if (match(TOKEN_BRACE_OPEN)) {
-        ASTNode *struct_node = parse_struct(input, struct_name_token);
+    if (ctx_match(ctx, TOKEN_BRACE_OPEN)) {
+        ASTNode *struct_node = parse_struct(ctx, struct_name_token);
         if (struct_node) {
             add_child(program_node, struct_node);
         }
@@ -55,81 +54,269 @@ static ASTNode* parse_struct_declaration(FILE *input, ASTNode *program_node)
     }
     
     // Function returning struct: struct Name funcname(...) { ... }
-    if (match(TOKEN_IDENTIFIER)) {
-        Token function_name = current_token;
-        advance(input);
+    if (ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        Token function_name = ctx->current_token;
+        ctx_advance(ctx);
         
-        if (match(TOKEN_PARENTHESIS_OPEN)) {
-            ASTNode *function_node = parse_function(input, struct_name_token, function_name);
+        if (ctx_match(ctx, TOKEN_PARENTHESIS_OPEN)) {
+            ASTNode *function_node = parse_function(ctx, struct_name_token, function_name);
             if (function_node) {
                 add_child(program_node, function_node);
             }
             return function_node;
         } else {
             printf("Warning: Expected '(' after function name for struct return function '%s'\n", 
-                   function_name.value);
+                   token_text(function_name));
         }
     } else {
         printf("Warning: 'struct %s' not followed by function name or '{'\n", 
-               struct_name_token.value);
+               token_text(struct_name_token));
     }
     
     return NULL;
 }
 
 // Parse function declaration with primitive return type
-static ASTNode* parse_function_declaration(FILE *input, Token return_type, ASTNode *program_node)
+static ASTNode* parse_function_declaration(ParserContext *ctx, Token return_type, ASTNode *program_node)
 {
-    if (!match(TOKEN_IDENTIFIER)) {
-        printf("Warning: Expected identifier after type at line %d\n", current_token.line);
-        advance(input);
+    if (!ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        printf("Warning: Expected identifier after type at line %d\n", ctx->current_token.line);
+        ctx_advance(ctx);
         return NULL;
     }
     
-    Token function_name = current_token;
-    advance(input);
+    Token function_name = ctx->current_token;
+    ctx_advance(ctx);
     
-    if (match(TOKEN_PARENTHESIS_OPEN)) {
-        ASTNode *function_node = parse_function(input, return_type, function_name);
+    if (ctx_match(ctx, TOKEN_PARENTHESIS_OPEN)) {
+        ASTNode *function_node = parse_function(ctx, return_type, function_name);
         if (function_node) {
             add_child(program_node, function_node);
         }
         return function_node;
     } else {
         printf("Warning: Global variable declarations not yet implemented\n");
-        skip_to_semicolon(input);
+        skip_to_semicolon(ctx);
         return NULL;
     }
 }
 
-// Parse the entire program: delegates to specialized modules
-ASTNode* parse_program(FILE *input)
+// Parse one struct or function declaration starting at the current token
+static void parse_declaration(ParserContext *ctx, ASTNode *program_node)
 {
-    ASTNode *program_node = create_node(NODE_PROGRAM);
+    if (ctx->current_token.id == INTERN_KW_STRUCT) {
+        parse_struct_declaration(ctx, program_node);
+        return;
+    }
+
+    // Primitive or known type function
+    Token return_type = ctx->current_token;
+    ctx_advance(ctx);
+    parse_function_declaration(ctx, return_type, program_node);
+}
+
+// Skip the rest of a declaration after a syntax error: through its ';' or
+// its braced body, whichever closes it
+static void synchronize_declaration(ParserContext *ctx)
+{
+    int brace_depth = 0;
+
+    while (!ctx_match(ctx, TOKEN_EOF)) {
+        if (ctx_match(ctx, TOKEN_BRACE_OPEN)) {
+            brace_depth++;
+        } else if (ctx_match(ctx, TOKEN_BRACE_CLOSE) && brace_depth > 0) {
+            if (--brace_depth == 0) {
+                ctx_advance(ctx);
+                // struct S { ... };
+                if (ctx_match(ctx, TOKEN_SEMICOLON)) {
+                    ctx_advance(ctx);
+                }
+                return;
+            }
+        } else if (ctx_match(ctx, TOKEN_SEMICOLON) && brace_depth == 0) {
+            ctx_advance(ctx);
+            return;
+        }
+        ctx_advance(ctx);
+    }
+}
+
+// Streaming: each declaration gets an arena of its own and is handed to
+// the sink instead of staying in the program. Most are small, so their
+// blocks are too.
+#define DECLARATION_ARENA_BLOCK_SIZE (16 * 1024)
+
+typedef struct {
+    DeclarationSink sink;
+    void *data;
+    int first_errors;          // ctx->error_count when parsing started
+    Arena *arena;              // Of the declaration being parsed (NULL between them)
+} DeclarationStream;
+
+static void declaration_arena_begin(DeclarationStream *stream)
+{
+    stream->arena = (Arena*)xrealloc(NULL, sizeof(Arena));
+    arena_init(stream->arena, DECLARATION_ARENA_BLOCK_SIZE);
+    ast_use_arena(stream->arena);
+}
 
-    advance(input); // prime tokenizer
+static void declaration_arena_free(DeclarationStream *stream)
+{
+    if (stream->arena) {
+        arena_release(stream->arena);
+        free(stream->arena);
+        stream->arena = NULL;
+    }
+}
+
+// Helper: detach what one declaration added to the program and pass it on;
+// after a syntax error nothing is generated, so it is only released
+static void declaration_arena_end(ParserContext *ctx, DeclarationStream *stream,
+                                  ASTNode *program_node, int first_child)
+{
+    ASTNode *declaration = NULL;
 
-    while (!match(TOKEN_EOF)) {
+    ast_use_arena(ctx->arena);
+    if (program_node->num_children > first_child) {
+        declaration = program_node->children[first_child];
+    }
+    program_node->num_children = first_child;
+    if (declaration && ctx->error_count == stream->first_errors) {
+        Arena *arena = stream->arena;
+
+        stream->arena = NULL;
+        stream->sink(stream->data, program_node, declaration, arena);
+        return;
+    }
+    declaration_arena_free(stream);
+}
+
+// Parse every declaration of the loaded source: delegates to specialized
+// modules, recovering from syntax errors at declaration boundaries
+static ASTNode* parse_translation_unit(ParserContext *ctx, ASTNode *program_node,
+                                       DeclarationStream *stream)
+{
+    ParserRecovery recovery;
+    volatile int first_child = 0;
+
+    ctx_advance(ctx); // prime tokenizer
+
+    while (!ctx_match(ctx, TOKEN_EOF)) {
         #ifdef DEBUG
         printf("Parsing token: type=%d, value='%s'\n", 
-               current_token.type, 
-               current_token.value ? current_token.value : "");
+               ctx->current_token.type, 
+               token_text(ctx->current_token));
         #endif
         
-        if (match(TOKEN_KEYWORD)) {
-            if (strcmp(current_token.value, "struct") == 0) {
-                parse_struct_declaration(input, program_node);
-                continue;
-            }
-            
-            // Primitive or known type function
-            Token return_type = current_token;
-            advance(input);
-            parse_function_declaration(input, return_type, program_node);
+        if (!ctx_match(ctx, TOKEN_KEYWORD)) {
+            ctx_advance(ctx); // Skip unknown token
+            continue;
+        }
+
+        if (stream) {
+            first_child = program_node->num_children;
+            declaration_arena_begin(stream);
+        }
+        parser_recovery_push(ctx, &recovery);
+        if (setjmp(recovery.target) == 0) {
+            parse_declaration(ctx, program_node);
         } else {
-            advance(input); // Skip unknown token
+            parser_recovery_restore(ctx, &recovery);
+            synchronize_declaration(ctx);
         }
+        parser_recovery_pop(ctx, &recovery);
+        if (stream) {
+            declaration_arena_end(ctx, stream, program_node, first_child);
+        }
+    }
+    
+    return program_node;
+}
+
+// Symbol tables describe one translation unit at a time
+static void reset_unit_state(ParserContext *ctx)
+{
+    struct_table_reset(&ctx->structs);
+    symbol_table_clear(&ctx->arrays);
+    ctx->loop_depth = 0;
+    ctx->recover_target = NULL;
+    ctx->last_error_offset = -1;
+}
+
+// Parse the source loaded into ctx; syntax errors return NULL
+static ASTNode* parse_unit(ParserContext *ctx, DeclarationStream *stream)
+{
+    ASTNode *volatile program_node = NULL;
+    ParserContext *previous_context = parser_context_activate(ctx);
+    Arena *previous_arena = ctx->arena ? ast_use_arena(ctx->arena) : NULL;
+    jmp_buf *previous_target = ctx->abort_target;
+    jmp_buf abort_target;
+    int previous_errors = ctx->error_count;
+
+    reset_unit_state(ctx);
+    ctx->abort_target = &abort_target;
+
+    // Syntax errors are all reported, then the unit fails as a whole
+    if (setjmp(abort_target) == 0) {
+        program_node = create_node(NODE_PROGRAM);
+        parse_translation_unit(ctx, program_node, stream);
+    }
+    if (stream && stream->arena) {
+        // A fatal error left a declaration half parsed
+        ast_use_arena(ctx->arena);
+        declaration_arena_free(stream);
+    }
+    if (ctx->error_count > previous_errors) {
+        // Nodes not yet linked into the tree are reclaimed with the arena
+        free_node(program_node);
+        program_node = NULL;
+    }
+
+    ctx->abort_target = previous_target;
+    ctx_lexer_end(ctx);
+    if (ctx->arena) {
+        ast_use_arena(previous_arena);
+    }
+    parser_context_activate(previous_context);
+    return program_node;
+}
+
+ASTNode* parse_program_ctx(ParserContext *ctx)
+{
+    return parse_unit(ctx, NULL);
+}
+
+ASTNode* parse_program_stream(ParserContext *ctx, DeclarationSink sink, void *data)
+{
+    DeclarationStream stream = { sink, data, ctx->error_count, NULL };
+
+    return parse_unit(ctx, &stream);
+}
+
+// Parse the entire program with the default context (errors exit once all
+// of them are reported)
+ASTNode* parse_program(FILE *input)
+{
+    ParserContext *ctx = parser_context_default();
+    ParserContext *previous_context = parser_context_activate(ctx);
+    ASTNode *program_node = create_node(NODE_PROGRAM);
+
+    reset_unit_state(ctx);
+    ctx->current_line = current_line;
+
+    // Load the whole stream up front; a NULL stream keeps the source
+    // installed by lexer_begin_memory()
+    if (input) {
+        ctx_lexer_begin(ctx, input);
+    }
+    parse_translation_unit(ctx, program_node, NULL);
+    if (ctx->error_count > 0) {
+        exit(EXIT_FAILURE);
     }
     
+    ctx_lexer_end(ctx);
+    current_token = ctx->current_token;
+    current_line = ctx->current_line;
+    parser_context_activate(previous_context);
     return program_node;
-}
\ No newline at end of file
+}
@@ -3,211 +3,183 @@
 #include <string.h>
 #include <ctype.h>
 #include "token.h"
+#include "parser_context.h"
+#include "profile.h"
 #include "utils.h"
 #include "parse_expression.h"
 #include "symbol_arrays.h"
 #include "symbol_structs.h"
 
 // Buffer size constants
-#define IDENTIFIER_BUFFER_SIZE 128
 #define NEGATED_VALUE_BUFFER_SIZE 128
-#define INDEX_EXPRESSION_BUFFER_SIZE 512
-// Full expression buffer = identifier + '[' + index + ']' + '\0'
-#define FULL_EXPRESSION_BUFFER_SIZE (IDENTIFIER_BUFFER_SIZE + INDEX_EXPRESSION_BUFFER_SIZE + 3)
-#define OPERATOR_COPY_BUFFER_SIZE 8
 
-// Forward declarations for helper functions (mutual recursion with parse_primary)
-static ASTNode* parse_logical_not(FILE *input);
-static ASTNode* parse_bitwise_not(FILE *input);
-static ASTNode* parse_unary_minus(FILE *input);
+// Kinds of ExprOperator
+#define EXPR_OPEN_PARENTHESIS 0
+#define EXPR_PREFIX 1
+#define EXPR_BINARY 2
 
-// Safe append helper to avoid strncat truncation warnings
-static inline void safe_append(char *dst, size_t dst_size, const char *src)
+#define EXPR_INITIAL_STACK 64
+
+static void expr_push_operand(ParserContext *ctx, ASTNode *operand)
 {
-    size_t used = strlen(dst);
-    if (used >= dst_size - 1) {
-        return;
+    if (ctx->expr_operand_count >= ctx->expr_operand_capacity) {
+        ctx->expr_operands = (ASTNode**)grow_array(ctx->expr_operands, &ctx->expr_operand_capacity,
+                                                   EXPR_INITIAL_STACK, sizeof(ASTNode*));
     }
-    size_t available_space = dst_size - 1 - used;
-    size_t copy = strlen(src);
-    if (copy > available_space) {
-        copy = available_space;
-    }
-    memcpy(dst + used, src, copy);
-    dst[used + copy] = '\0';
+    ctx->expr_operands[ctx->expr_operand_count++] = operand;
 }
 
-static inline void safe_copy(char *dst, size_t dst_size, const char *src)
+static void expr_push_operator(ParserContext *ctx, int kind, Token token, int precedence)
 {
-    if (!dst_size) {
-        return;
-    }
-    size_t n = strlen(src);
-    if (n >= dst_size) {
-        n = dst_size - 1;
+    ExprOperator *entry = NULL;
+
+    if (ctx->expr_operator_count >= ctx->expr_operator_capacity) {
+        ctx->expr_operators = (ExprOperator*)grow_array(ctx->expr_operators, &ctx->expr_operator_capacity,
+                                                        EXPR_INITIAL_STACK, sizeof(ExprOperator));
     }
-    memcpy(dst, src, n);
-    dst[n] = '\0';
+    entry = &ctx->expr_operators[ctx->expr_operator_count++];
+    entry->kind = kind;
+    entry->token = token;
+    entry->precedence = precedence;
 }
 
-// Helper: Parse logical NOT operator (!)
-static ASTNode* parse_logical_not(FILE *input)
+// Helper: kind of the innermost pending operator above base (-1 = none)
+static int expr_top_kind(const ParserContext *ctx, int base)
 {
-    ASTNode *operand = NULL;
-    ASTNode *not_node = NULL;
-    
-    advance(input);
-    operand = parse_primary(input);
-    if (!operand) {
-        return NULL;
-    }
-    
-    not_node = create_node(NODE_BINARY_OP);
-    not_node->value = strdup("!");
-    add_child(not_node, operand);
-    return not_node;
+    return ctx->expr_operator_count > base ? ctx->expr_operators[ctx->expr_operator_count - 1].kind : -1;
 }
 
-// Helper: Parse bitwise NOT operator (~)
-static ASTNode* parse_bitwise_not(FILE *input)
+// Helper: replace the top two operands by the binary operator on top
+static void expr_reduce_binary(ParserContext *ctx)
 {
-    ASTNode *operand = NULL;
-    ASTNode *not_node = NULL;
-    
-    advance(input);
-    operand = parse_primary(input);
-    if (!operand) {
-        return NULL;
-    }
-    
-    not_node = create_node(NODE_BINARY_OP);
-    not_node->value = strdup("~");
-    add_child(not_node, operand);
-    return not_node;
+    ExprOperator entry = ctx->expr_operators[--ctx->expr_operator_count];
+    ASTNode *right_operand = ctx->expr_operands[--ctx->expr_operand_count];
+    ASTNode *left_operand = ctx->expr_operands[--ctx->expr_operand_count];
+    ASTNode *binary_expr = create_node(NODE_BINARY_EXPR);
+
+    binary_expr->token = entry.token;
+    set_node_operator(binary_expr, entry.token.id);
+    add_child(binary_expr, left_operand);
+    add_child(binary_expr, right_operand);
+    expr_push_operand(ctx, binary_expr);
 }
 
-// Helper: Parse unary minus operator (-)
-static ASTNode* parse_unary_minus(FILE *input)
+// Helper: apply the '!', '~' and '-' prefixes waiting for the operand on top
+static void expr_apply_prefixes(ParserContext *ctx, int base)
 {
-    ASTNode *operand = NULL;
-    ASTNode *result_node = NULL;
-    ASTNode *zero_node = NULL;
-    ASTNode *binary_expr = NULL;
     char negated_value[NEGATED_VALUE_BUFFER_SIZE] = {0};
-    
-    advance(input);
-    operand = parse_primary(input);
-    if (!operand) {
-        return NULL;
-    }
-    
-    if (operand->type == NODE_EXPRESSION && operand->value) {
-        snprintf(negated_value, sizeof(negated_value), "-%s", operand->value);
-        result_node = create_node(NODE_EXPRESSION);
-        result_node->value = strdup(negated_value);
-        free_node(operand);
-        return result_node;
+
+    while (expr_top_kind(ctx, base) == EXPR_PREFIX) {
+        InternId op = ctx->expr_operators[--ctx->expr_operator_count].token.id;
+        ASTNode *operand = ctx->expr_operands[ctx->expr_operand_count - 1];
+        ASTNode *unary_node = NULL;
+
+        // Negative numeric literals stay literals
+        if (op == INTERN_OP_MINUS && operand->type == NODE_EXPRESSION && operand->token.type == TOKEN_NUMBER) {
+            snprintf(negated_value, sizeof(negated_value), "-%s", operand->value);
+            set_node_value(operand, negated_value);
+            continue;
+        }
+
+        unary_node = create_node(NODE_UNARY_EXPR);
+        set_node_operator(unary_node, op);
+        add_child(unary_node, operand);
+        ctx->expr_operands[ctx->expr_operand_count - 1] = unary_node;
     }
-    
-    zero_node = create_node(NODE_EXPRESSION);
-    zero_node->value = strdup("0");
-    binary_expr = create_node(NODE_BINARY_EXPR);
-    binary_expr->value = strdup("-");
-    add_child(binary_expr, zero_node);
-    add_child(binary_expr, operand);
-    return binary_expr;
 }
 
-// Helper: Parse parenthesized expression
-static ASTNode* parse_parenthesized_expr(FILE *input)
+// Helper: Validate array bounds if the index is a constant number
+static void validate_array_bounds(ParserContext *ctx, const ASTNode *array, const ASTNode *index)
 {
-    ASTNode *expr_node = NULL;
-    
-    advance(input);
-    expr_node = parse_expression_prec(input, PREC_PARENTHESIZED_MIN);
+    int index_value = 0;
+    int array_size = 0;
     
-    if (!consume(input, TOKEN_PARENTHESIS_CLOSE)) {
-        printf("Error (line %d): Expected ')' after expression\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (array->type != NODE_EXPRESSION || index->type != NODE_EXPRESSION ||
+        !is_number_str(index->value)) {
+        return;
     }
     
-    return expr_node;
-}
-
-// Helper: Parse field access (e.g., struct.field.subfield)
-static void parse_field_access(FILE *input, char *identifier_buffer, size_t buffer_size)
-{
-    while (match(TOKEN_OPERATOR) && strcmp(current_token.value, ".") == 0) {
-        advance(input);
-        
-        if (!match(TOKEN_IDENTIFIER)) {
-            printf("Error (line %d): Expected field name after '.'\n", current_token.line);
-            exit(EXIT_FAILURE);
-        }
-        
-        safe_append(identifier_buffer, buffer_size, "__");
-        safe_append(identifier_buffer, buffer_size, current_token.value);
-        advance(input);
+    index_value = atoi(index->value);
+    PROFILE_TIMER_START(ctx, symbol_timer);
+    array_size = array_table_size(&ctx->arrays, array->value);
+    PROFILE_TIMER_STOP(ctx, symbol_timer, PROFILE_PHASE_SYMBOLS);
+    PROFILE_COUNT(ctx, symbol_operations, 1);
+    
+    if (array_size > 0 && (index_value < 0 || index_value >= array_size)) {
+        parser_syntax_error(ctx, "Array index %d out of bounds for '%s' with size %d",
+                            index_value, array->value, array_size);
     }
 }
 
-// Helper: Parse array index expression
-static void parse_array_index(FILE *input, char *index_buffer, size_t buffer_size)
+// Helper: Parse field access suffix: base.field
+static ASTNode* parse_member_suffix(ParserContext *ctx, ASTNode *base)
 {
-    int parenthesis_depth = 0;
+    ASTNode *member_node = NULL;
     
-    advance(input);
-    
-    while (!match(TOKEN_EOF)) {
-        if (match(TOKEN_BRACKET_CLOSE) && parenthesis_depth == 0) {
-            break;
-        }
-        
-        if (match(TOKEN_PARENTHESIS_OPEN)) {
-            safe_append(index_buffer, buffer_size, "(");
-            advance(input);
-            parenthesis_depth++;
-            continue;
-        }
-        
-        if (match(TOKEN_PARENTHESIS_CLOSE)) {
-            safe_append(index_buffer, buffer_size, ")");
-            advance(input);
-            if (parenthesis_depth > 0) {
-                parenthesis_depth--;
-            }
-            continue;
-        }
-        
-        if (current_token.value) {
-            safe_append(index_buffer, buffer_size, current_token.value);
-        }
-        advance(input);
+    ctx_advance(ctx);
+    if (!ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        parser_syntax_error(ctx, "Expected field name after '.'");
     }
     
-    if (!consume(input, TOKEN_BRACKET_CLOSE)) {
-        printf("Error (line %d): Expected ']' after array index in expression\n", current_token.line);
-        exit(EXIT_FAILURE);
-    }
+    member_node = create_node(NODE_MEMBER_EXPR);
+    member_node->token = ctx->current_token;
+    set_node_value(member_node, token_text(ctx->current_token));
+    add_child(member_node, base);
+    ctx_advance(ctx);
+    return member_node;
 }
 
-// Helper: Validate array bounds if index is a constant number
-static void validate_array_bounds(const char *identifier_name, const char *index_expr)
+// Helper: Parse array index suffix: base[expression]
+static ASTNode* parse_index_suffix(ParserContext *ctx, ASTNode *base)
 {
-    int index_value = 0;
-    int array_size = 0;
+    ASTNode *index_node = NULL;
+    ASTNode *index_expr = NULL;
     
-    if (!is_number_str(index_expr)) {
-        return;
+    ctx_advance(ctx);
+    index_expr = parse_expression_prec(ctx, PREC_PARENTHESIZED_MIN);
+    if (!index_expr) {
+        parser_syntax_error(ctx, "Expected index expression after '['");
     }
     
-    index_value = atoi(index_expr);
-    array_size = find_array_size(identifier_name);
+    if (!ctx_consume(ctx, TOKEN_BRACKET_CLOSE)) {
+        parser_syntax_error(ctx, "Expected ']' after array index in expression");
+    }
     
-    if (array_size > 0 && (index_value < 0 || index_value >= array_size)) {
-        printf("Error (line %d): Array index %d out of bounds for '%s' with size %d\n",
-               current_token.line, index_value, identifier_name, array_size);
-        exit(EXIT_FAILURE);
+    validate_array_bounds(ctx, base, index_expr);
+    
+    index_node = create_node(NODE_INDEX_EXPR);
+    add_child(index_node, base);
+    add_child(index_node, index_expr);
+    return index_node;
+}
+
+/**
+ * Parses the field accesses and array indexes following an identifier.
+ * 
+ * Syntax: identifier ( '.' field | '[' expression ']' )*
+ * 
+ * The identifier itself has already been consumed.
+ * 
+ * @param ctx             Parser context
+ * @param identifier_token The identifier token
+ * @return                NODE_EXPRESSION for a bare identifier, otherwise the
+ *                        outermost NODE_MEMBER_EXPR / NODE_INDEX_EXPR
+ */
+ASTNode* parse_postfix_access(ParserContext *ctx, Token identifier_token)
+{
+    ASTNode *access_node = create_node(NODE_EXPRESSION);
+    
+    access_node->token = identifier_token;
+    set_node_value(access_node, token_text(identifier_token));
+    
+    for (;;) {
+        if (ctx_match(ctx, TOKEN_OPERATOR) && ctx->current_token.id == INTERN_OP_DOT) {
+            access_node = parse_member_suffix(ctx, access_node);
+        } else if (ctx_match(ctx, TOKEN_BRACKET_OPEN)) {
+            access_node = parse_index_suffix(ctx, access_node);
+        } else {
+            return access_node;
+        }
     }
 }
 
@@ -221,33 +193,33 @@ static void validate_array_bounds(const char *identifier_name, const char *index
  * This function consumes the opening parenthesis, parses comma-separated arguments,
  * and expects a closing parenthesis.
  * 
- * @param input         Input file stream
+ * @param ctx           Parser context
  * @param function_name Name of the function being called (for error messages)
  * @return              NODE_FUNC_CALL node with arguments as children
  */
-ASTNode* parse_function_call_args(FILE *input, const char *function_name)
+ASTNode* parse_function_call_args(ParserContext *ctx, const char *function_name)
 {
     ASTNode *call_node = NULL;
     ASTNode *arg_node = NULL;
     
     call_node = create_node(NODE_FUNC_CALL);
-    call_node->value = strdup(function_name);
+    set_node_value(call_node, function_name);
     
     // Consume opening parenthesis
-    advance(input);
+    ctx_advance(ctx);
     
     // Parse zero or more comma-separated arguments
-    while (!match(TOKEN_PARENTHESIS_CLOSE) && !match(TOKEN_EOF))
+    while (!ctx_match(ctx, TOKEN_PARENTHESIS_CLOSE) && !ctx_match(ctx, TOKEN_EOF))
     {
-        arg_node = parse_expression_prec(input, PREC_TOP_LEVEL_MIN);
+        arg_node = parse_expression_prec(ctx, PREC_TOP_LEVEL_MIN);
         if (arg_node)
         {
             add_child(call_node, arg_node);
         }
         
-        if (match(TOKEN_COMMA))
+        if (ctx_match(ctx, TOKEN_COMMA))
         {
-            advance(input);
+            ctx_advance(ctx);
             continue;
         }
         else
@@ -256,11 +228,9 @@ ASTNode* parse_function_call_args(FILE *input, const char *function_name)
         }
     }
     
-    if (!consume(input, TOKEN_PARENTHESIS_CLOSE))
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_CLOSE))
     {
-        printf("Error (line %d): Expected ')' after function call arguments for '%s'\n",
-               current_token.line, function_name);
-        exit(EXIT_FAILURE);
+        parser_syntax_error(ctx, "Expected ')' after function call arguments for '%s'", function_name);
     }
     
     return call_node;
@@ -275,135 +245,138 @@ ASTNode* parse_function_call_args(FILE *input, const char *function_name)
  * This function consumes the opening parenthesis, parses comma-separated arguments,
  * and expects a closing parenthesis.
  * 
- * @param input         Input file stream
+ * @param ctx           Parser context
  * @param function_name Name of the function being called
  * @return              NODE_FUNC_CALL node with arguments as children
  */
-static ASTNode* parse_function_call(FILE *input, const char *function_name)
+static ASTNode* parse_function_call(ParserContext *ctx, const char *function_name)
 {
-    return parse_function_call_args(input, function_name);
+    return parse_function_call_args(ctx, function_name);
 }
 
 // Helper: Parse identifier with optional field access, array indexing, or function call
-static ASTNode* parse_identifier(FILE *input)
+static ASTNode* parse_identifier(ParserContext *ctx)
 {
-    ASTNode *identifier_node = NULL;
-    char identifier_name[IDENTIFIER_BUFFER_SIZE] = {0};
-    char index_expression[INDEX_EXPRESSION_BUFFER_SIZE] = {0};
-    char full_expression[FULL_EXPRESSION_BUFFER_SIZE] = {0};
+    Token identifier_token = ctx->current_token;
     
-    safe_copy(identifier_name, sizeof(identifier_name), current_token.value);
-    advance(input);
+    ctx_advance(ctx);
     
     // Check for function call: identifier(args)
-    if (match(TOKEN_PARENTHESIS_OPEN))
-    {
-        return parse_function_call(input, identifier_name);
-    }
-    
-    // Handle field access (e.g., struct.field)
-    parse_field_access(input, identifier_name, sizeof(identifier_name));
-    
-    // Handle array indexing
-    if (match(TOKEN_BRACKET_OPEN))
+    if (ctx_match(ctx, TOKEN_PARENTHESIS_OPEN))
     {
-        parse_array_index(input, index_expression, sizeof(index_expression));
-        
-        identifier_node = create_node(NODE_EXPRESSION);
-        snprintf(full_expression, sizeof(full_expression), "%s[%s]", identifier_name, index_expression);
-        identifier_node->value = strdup(full_expression);
-        
-        validate_array_bounds(identifier_name, index_expression);
-        return identifier_node;
+        return parse_function_call(ctx, token_text(identifier_token));
     }
     
-    // Simple identifier
-    identifier_node = create_node(NODE_EXPRESSION);
-    identifier_node->value = strdup(identifier_name);
-    return identifier_node;
+    return parse_postfix_access(ctx, identifier_token);
 }
 
 // Helper: Parse number literal
-static ASTNode* parse_number(FILE *input)
+static ASTNode* parse_number(ParserContext *ctx)
 {
     ASTNode *number_node = create_node(NODE_EXPRESSION);
-    number_node->value = strdup(current_token.value);
-    advance(input);
+    number_node->token = ctx->current_token;
+    set_node_value(number_node, token_text(ctx->current_token));
+    ctx_advance(ctx);
     return number_node;
 }
 
-// Primary: identifiers, numbers, unary minus, logical/bitwise NOT, parentheses, field & array access
-ASTNode* parse_primary(FILE *input)
+// Primary: identifiers (with field access, array indexing or a call) and
+// numbers; prefix operators and parentheses belong to parse_expression_prec
+ASTNode* parse_primary(ParserContext *ctx)
 {
-    // Logical NOT operator
-    if (match(TOKEN_OPERATOR) && strcmp(current_token.value, "!") == 0) {
-        return parse_logical_not(input);
-    }
-    
-    // Bitwise NOT operator
-    if (match(TOKEN_OPERATOR) && strcmp(current_token.value, "~") == 0) {
-        return parse_bitwise_not(input);
-    }
-    
-    // Unary minus operator
-    if (match(TOKEN_OPERATOR) && strcmp(current_token.value, "-") == 0) {
-        return parse_unary_minus(input);
-    }
-    
-    // Parenthesized expression
-    if (match(TOKEN_PARENTHESIS_OPEN)) {
-        return parse_parenthesized_expr(input);
-    }
-    
     // Identifier (with optional field access and array indexing)
-    if (match(TOKEN_IDENTIFIER)) {
-        return parse_identifier(input);
+    if (ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        return parse_identifier(ctx);
     }
     
     // Number literal
-    if (match(TOKEN_NUMBER)) {
-        return parse_number(input);
+    if (ctx_match(ctx, TOKEN_NUMBER)) {
+        return parse_number(ctx);
     }
     
     return NULL;
 }
 
-ASTNode* parse_expression_prec(FILE *input, int min_prec)
+/**
+ * Precedence climbing over explicit operand/operator stacks, so neither
+ * long operator chains nor deeply nested parentheses and prefixes recurse.
+ * Binary operators are left-associative; inside parentheses only operators
+ * of at least PREC_PARENTHESIZED_MIN continue the expression.
+ */
+ASTNode* parse_expression_prec(ParserContext *ctx, int min_prec)
 {
-    ASTNode *left_operand = NULL;
-    ASTNode *right_operand = NULL;
-    ASTNode *binary_expr = NULL;
-    const char *operator = NULL;
-    int operator_precedence = 0;
-    char operator_copy[OPERATOR_COPY_BUFFER_SIZE] = {0};
+    int operand_base = ctx->expr_operand_count;
+    int operator_base = ctx->expr_operator_count;
+    int open_parentheses = 0;
+    ASTNode *operand = NULL;
 
-    left_operand = parse_primary(input);
-    if (!left_operand) {
-        return NULL;
-    }
-    while (match(TOKEN_OPERATOR)) {
-        operator = current_token.value;
-        operator_precedence = get_precedence(operator);
-        if (operator_precedence < min_prec) {
-            break;
+    for (;;) {
+        InternId op = ctx->current_token.id;
+
+        // Operand position: prefixes and '(' stack up before a primary
+        if (ctx_match(ctx, TOKEN_OPERATOR) &&
+            (op == INTERN_OP_LOGICAL_NOT || op == INTERN_OP_BITWISE_NOT || op == INTERN_OP_MINUS)) {
+            expr_push_operator(ctx, EXPR_PREFIX, ctx->current_token, 0);
+            ctx_advance(ctx);
+            continue;
         }
-        safe_copy(operator_copy, sizeof(operator_copy), operator);
-        advance(input);
-        right_operand = parse_expression_prec(input, operator_precedence + 1);
-        if (!right_operand) {
-            printf("Error (line %d): Expected right operand after operator '%s'\n", current_token.line, operator_copy);
-            exit(EXIT_FAILURE);
+        if (ctx_match(ctx, TOKEN_PARENTHESIS_OPEN)) {
+            expr_push_operator(ctx, EXPR_OPEN_PARENTHESIS, ctx->current_token, 0);
+            open_parentheses++;
+            ctx_advance(ctx);
+            continue;
+        }
+
+        operand = parse_primary(ctx);
+        if (!operand) {
+            while (expr_top_kind(ctx, operator_base) == EXPR_PREFIX) {
+                ctx->expr_operator_count--;
+            }
+            if (expr_top_kind(ctx, operator_base) == EXPR_BINARY) {
+                parser_syntax_error(ctx, "Expected right operand after operator '%s'",
+                                    token_text(ctx->expr_operators[ctx->expr_operator_count - 1].token));
+            }
+            ctx->expr_operand_count = operand_base;
+            ctx->expr_operator_count = operator_base;
+            return NULL;
+        }
+        expr_push_operand(ctx, operand);
+        expr_apply_prefixes(ctx, operator_base);
+
+        // Operator position: close parentheses until an operator continues
+        for (;;) {
+            int level_min = (open_parentheses > 0) ? PREC_PARENTHESIZED_MIN : min_prec;
+            int operator_precedence = get_precedence_id(ctx->current_token.id);
+
+            if (ctx_match(ctx, TOKEN_OPERATOR) && operator_precedence >= level_min) {
+                while (expr_top_kind(ctx, operator_base) == EXPR_BINARY &&
+                       ctx->expr_operators[ctx->expr_operator_count - 1].precedence >= operator_precedence) {
+                    expr_reduce_binary(ctx);
+                }
+                expr_push_operator(ctx, EXPR_BINARY, ctx->current_token, operator_precedence);
+                ctx_advance(ctx);
+                break;
+            }
+            if (open_parentheses == 0) {
+                while (ctx->expr_operator_count > operator_base) {
+                    expr_reduce_binary(ctx);
+                }
+                return ctx->expr_operands[--ctx->expr_operand_count];
+            }
+            if (!ctx_consume(ctx, TOKEN_PARENTHESIS_CLOSE)) {
+                parser_syntax_error(ctx, "Expected ')' after expression");
+            }
+            while (expr_top_kind(ctx, operator_base) == EXPR_BINARY) {
+                expr_reduce_binary(ctx);
+            }
+            ctx->expr_operator_count--;
+            open_parentheses--;
+            expr_apply_prefixes(ctx, operator_base);
         }
-        binary_expr = create_node(NODE_BINARY_EXPR);
-        binary_expr->value = strdup(operator_copy);
-        add_child(binary_expr, left_operand);
-        add_child(binary_expr, right_operand);
-        left_operand = binary_expr;
     }
-    return left_operand;
 }
 
-ASTNode* parse_expression(FILE *input)
+ASTNode* parse_expression(ParserContext *ctx)
 { 
-    return parse_expression_prec(input, PREC_TOP_LEVEL_MIN);
+    return parse_expression_prec(ctx, PREC_TOP_LEVEL_MIN);
 }
@@ -6,70 +6,87 @@
 #include "symbol_arrays.h"
 #include "parse.h" // create_node/add_child
 #include "token.h"
+#include "parser_context.h"
 
 // Constants
-#define MAX_ARRAYS 128
 #define INITIAL_BRACE_DEPTH 1
 
-extern Token current_token;
-extern ArrayInfo g_arrays[MAX_ARRAYS];
-extern int g_array_count;
 
-static void parse_function_parameters(FILE *input, ASTNode *function_node);
-static void parse_function_body(FILE *input, ASTNode *function_node);
+static void parse_function_parameters(ParserContext *ctx, ASTNode *function_node);
+static void parse_function_body(ParserContext *ctx, ASTNode *function_node);
 
 // Helper: Parse a single function parameter (type and name)
-static ASTNode* parse_single_parameter(FILE *input, Token *parameter_type)
+static ASTNode* parse_single_parameter(ParserContext *ctx, Token *parameter_type)
 {
     Token parameter_name = (Token){0};
     ASTNode *parameter_node = NULL;
     
     // Handle struct types
-    if (strcmp(current_token.value, "struct") == 0) {
-        advance(input);
-        if (!match(TOKEN_IDENTIFIER)) {
-            printf("Error (line %d): Expected struct name in parameter list\n", current_token.line);
-            return NULL;
+    if (ctx->current_token.id == INTERN_KW_STRUCT) {
+        ctx_advance(ctx);
+        if (!ctx_match(ctx, TOKEN_IDENTIFIER)) {
+            parser_syntax_error(ctx, "Expected struct name in parameter list");
         }
-        *parameter_type = current_token;
-        advance(input);
+        *parameter_type = ctx->current_token;
+        ctx_advance(ctx);
     } else {
-        *parameter_type = current_token;
-        advance(input);
+        *parameter_type = ctx->current_token;
+        ctx_advance(ctx);
     }
     
-    // Get parameter name
-    if (!match(TOKEN_IDENTIFIER)) {
-        printf("Error (line %d): Expected parameter name\n", current_token.line);
+    // f(void): no parameters
+    if (parameter_type->id == INTERN_KW_VOID && ctx_match(ctx, TOKEN_PARENTHESIS_CLOSE)) {
         return NULL;
     }
     
-    parameter_name = current_token;
-    advance(input);
+    // Get parameter name
+    if (!ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        parser_syntax_error(ctx, "Expected parameter name");
+    }
+    
+    parameter_name = ctx->current_token;
+    ctx_advance(ctx);
     
     // Create parameter node
     parameter_node = create_node(NODE_VAR_DECL);
     parameter_node->token = *parameter_type;
-    parameter_node->value = strdup(parameter_name.value);
+    set_node_value(parameter_node, token_text(parameter_name));
+    
+    // Array parameter: name[size]
+    if (ctx_match(ctx, TOKEN_BRACKET_OPEN)) {
+        ctx_advance(ctx);
+        if (!ctx_match(ctx, TOKEN_NUMBER)) {
+            parser_syntax_error(ctx, "Expected array size in parameter list");
+        }
+        parameter_node->array_size = atoi(token_text(ctx->current_token));
+        ctx_advance(ctx);
+        array_table_register(&ctx->arrays, token_text(parameter_name), parameter_node->array_size);
+        
+        if (!ctx_consume(ctx, TOKEN_BRACKET_CLOSE)) {
+            parser_syntax_error(ctx, "Expected ']' after array size");
+        }
+    }
     
     return parameter_node;
 }
 
 // Helper: Parse all function parameters
-static void parse_function_parameters(FILE *input, ASTNode *function_node)
+static void parse_function_parameters(ParserContext *ctx, ASTNode *function_node)
 {
     Token parameter_type = (Token){0};
     ASTNode *parameter_node = NULL;
     
-    if (!consume(input, TOKEN_PARENTHESIS_OPEN)) {
-        printf("Error (line %d): Expected '(' after function name\n", current_token.line);
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_OPEN)) {
         free_node(function_node);
-        exit(EXIT_FAILURE);
+        parser_syntax_error(ctx, "Expected '(' after function name");
     }
     
-    while (!match(TOKEN_PARENTHESIS_CLOSE) && !match(TOKEN_EOF)) {
-        if (match(TOKEN_KEYWORD)) {
-            parameter_node = parse_single_parameter(input, &parameter_type);
+    // A '{' or ';' means the ')' is missing: stop there rather than read the
+    // body as parameters
+    while (!ctx_match(ctx, TOKEN_PARENTHESIS_CLOSE) && !ctx_match(ctx, TOKEN_EOF) &&
+           !ctx_match(ctx, TOKEN_BRACE_OPEN) && !ctx_match(ctx, TOKEN_SEMICOLON)) {
+        if (ctx_match(ctx, TOKEN_KEYWORD)) {
+            parameter_node = parse_single_parameter(ctx, &parameter_type);
             if (!parameter_node) {
                 break;
             }
@@ -77,42 +94,44 @@ static void parse_function_parameters(FILE *input, ASTNode *function_node)
             add_child(function_node, parameter_node);
             
             // Handle comma between parameters
-            if (match(TOKEN_COMMA)) {
-                advance(input);
+            if (ctx_match(ctx, TOKEN_COMMA)) {
+                ctx_advance(ctx);
             }
         } else {
-            advance(input);
+            ctx_advance(ctx);
         }
     }
     
-    if (!consume(input, TOKEN_PARENTHESIS_CLOSE)) {
-        printf("Error (line %d): Expected ')' after parameter list\n", current_token.line);
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_CLOSE)) {
         free_node(function_node);
-        exit(EXIT_FAILURE);
+        parser_syntax_error(ctx, "Expected ')' after parameter list");
     }
 }
 
 // Helper: Parse function body (statements within braces)
-static void parse_function_body(FILE *input, ASTNode *function_node)
+static void parse_function_body(ParserContext *ctx, ASTNode *function_node)
 {
     int brace_depth = INITIAL_BRACE_DEPTH;
     ASTNode *statement_node = NULL;
     
-    if (!consume(input, TOKEN_BRACE_OPEN)) {
-        printf("Error (line %d): Expected '{' to start function body\n", current_token.line);
+    if (!ctx_consume(ctx, TOKEN_BRACE_OPEN)) {
         free_node(function_node);
-        exit(EXIT_FAILURE);
+        parser_syntax_error(ctx, "Expected '{' to start function body");
     }
     
-    while (brace_depth > 0 && !match(TOKEN_EOF)) {
-        if (match(TOKEN_BRACE_OPEN)) {
+    while (brace_depth > 0 && !ctx_match(ctx, TOKEN_EOF)) {
+        if (ctx_match(ctx, TOKEN_BRACE_OPEN)) {
             brace_depth++;
-            advance(input);
-        } else if (match(TOKEN_BRACE_CLOSE)) {
+            symbol_scope_push(&ctx->arrays);
+            ctx_advance(ctx);
+        } else if (ctx_match(ctx, TOKEN_BRACE_CLOSE)) {
             brace_depth--;
-            advance(input);
+            if (brace_depth > 0) {
+                symbol_scope_pop(&ctx->arrays);
+            }
+            ctx_advance(ctx);
         } else {
-            statement_node = parse_statement(input);
+            statement_node = parse_statement_with_recovery(ctx);
             if (statement_node) {
                 add_child(function_node, statement_node);
             }
@@ -120,23 +139,25 @@ static void parse_function_body(FILE *input, ASTNode *function_node)
     }
 }
 
-ASTNode* parse_function(FILE *input, Token return_type, Token function_name)
+ASTNode* parse_function(ParserContext *ctx, Token return_type, Token function_name)
 {
     ASTNode *function_node = NULL;
     
     // Initialize function node
     function_node = create_node(NODE_FUNCTION_DECL);
     function_node->token = return_type;
-    function_node->value = strdup(function_name.value);
+    set_node_value(function_node, token_text(function_name));
     
-    // Reset global array count for this function scope
-    g_array_count = 0;
+    // Arrays declared in this function are only visible inside it
+    symbol_scope_push(&ctx->arrays);
     
     // Parse function parameters
-    parse_function_parameters(input, function_node);
+    parse_function_parameters(ctx, function_node);
     
     // Parse function body
-    parse_function_body(input, function_node);
+    parse_function_body(ctx, function_node);
+    
+    symbol_scope_pop(&ctx->arrays);
     
     return function_node;
 }
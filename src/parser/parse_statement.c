@@ -9,97 +9,52 @@
 #include "utils.h"
 #include "parse.h" // create_node/add_child
 #include "token.h"
-
-// Constants
-#define MAX_ARRAYS 128
-#define ARRAY_SIZE_BUFFER_SIZE 256
-#define LHS_BUFFER_SIZE 1024
-#define INDEX_BUFFER_SIZE 512
-#define BASE_NAME_BUFFER_SIZE 128
-#define GENERAL_BUFFER_SIZE 1024
-#define INITIAL_PARENTHESIS_DEPTH 0
-
-static inline void safe_append(char *dst, size_t dst_size, const char *src)
-{
-    size_t used = strlen(dst);
-    if (used >= dst_size - 1) {
-        return;
-    }
-    size_t available_space = dst_size - 1 - used;
-    size_t copy_length = strlen(src);
-    if (copy_length > available_space) {
-        copy_length = available_space;
-    }
-    memcpy(dst + used, src, copy_length);
-    dst[used + copy_length] = '\0';
-}
-
-static inline void safe_copy(char *dst, size_t dst_size, const char *src, size_t limit)
-{
-    if (!dst_size) {
-        return;
-    }
-    size_t source_length = strlen(src);
-    if (source_length > limit) {
-        source_length = limit;
-    }
-    if (source_length >= dst_size) {
-        source_length = dst_size - 1;
-    }
-    memcpy(dst, src, source_length);
-    dst[source_length] = '\0';
-}
-
-extern Token current_token;
-extern int g_array_count;
-extern ArrayInfo g_arrays[MAX_ARRAYS];
-
-static int s_loop_depth = 0;
+#include "parser_context.h"
+#include "profile.h"
+#include <setjmp.h>
 
 // Forward declarations
-static ASTNode* parse_variable_declaration(FILE *input, Token type_token);
-static ASTNode* parse_assignment_or_expression(FILE *input);
-static ASTNode* parse_return_statement(FILE *input);
-static ASTNode* parse_if_statement(FILE *input);
-static ASTNode* parse_while_statement(FILE *input);
-static ASTNode* parse_for_statement(FILE *input);
-static ASTNode* parse_break_statement(FILE *input);
-static ASTNode* parse_continue_statement(FILE *input);
+static ASTNode* parse_variable_declaration(ParserContext *ctx, Token type_token);
+static ASTNode* parse_assignment_or_expression(ParserContext *ctx);
+static ASTNode* parse_return_statement(ParserContext *ctx);
+static ASTNode* parse_if_statement(ParserContext *ctx);
+static ASTNode* parse_while_statement(ParserContext *ctx);
+static ASTNode* parse_for_statement(ParserContext *ctx);
+static ASTNode* parse_break_statement(ParserContext *ctx);
+static ASTNode* parse_continue_statement(ParserContext *ctx);
 
 // Helper: Parse array or struct initializer list
-static ASTNode* parse_initializer_list(FILE *input, int is_array)
+static ASTNode* parse_initializer_list(ParserContext *ctx, int is_array)
 {
     ASTNode *init_list = NULL;
     ASTNode *elem = NULL;
     
-    advance(input);
+    ctx_advance(ctx);
     init_list = create_node(NODE_EXPRESSION);
-    init_list->value = strdup(is_array ? "array_init" : "struct_init");
+    set_node_value(init_list, is_array ? "array_init" : "struct_init");
     
-    while (!match(TOKEN_BRACE_CLOSE) && !match(TOKEN_EOF)) {
-        if (match(TOKEN_NUMBER) || match(TOKEN_IDENTIFIER)) {
+    while (!ctx_match(ctx, TOKEN_BRACE_CLOSE) && !ctx_match(ctx, TOKEN_EOF)) {
+        if (ctx_match(ctx, TOKEN_NUMBER) || ctx_match(ctx, TOKEN_IDENTIFIER)) {
             elem = create_node(NODE_EXPRESSION);
-            elem->value = strdup(current_token.value);
+            set_node_value(elem, token_text(ctx->current_token));
             add_child(init_list, elem);
-            advance(input);
-        } else if (match(TOKEN_COMMA)) {
-            advance(input);
+            ctx_advance(ctx);
+        } else if (ctx_match(ctx, TOKEN_COMMA)) {
+            ctx_advance(ctx);
         } else {
-            advance(input);
+            ctx_advance(ctx);
         }
     }
     
-    if (!consume(input, TOKEN_BRACE_CLOSE)) {
-        printf("Error (line %d): Expected '}' after %s initializer\n", 
-               current_token.line, is_array ? "array" : "struct");
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_BRACE_CLOSE)) {
+        parser_syntax_error(ctx, "Expected '}' after %s initializer", is_array ? "array" : "struct");
     }
     
     return init_list;
 }
 
 // Helper: Parse variable declaration with optional initialization
-static ASTNode* parse_variable_declaration(FILE *input, Token type_token)
+static ASTNode* parse_variable_declaration(ParserContext *ctx, Token type_token)
 {
     Token name_token = {0};
     ASTNode *var_decl_node = NULL;
@@ -107,229 +62,127 @@ static ASTNode* parse_variable_declaration(FILE *input, Token type_token)
     ASTNode *init_list = NULL;
     int is_struct = 0;
     int is_array = 0;
-    char arr_size_buf[ARRAY_SIZE_BUFFER_SIZE] = {0};
-    char buf[GENERAL_BUFFER_SIZE] = {0};
     
     // Check if it's a struct type
-    if (strcmp(type_token.value, "struct") == 0) {
-        if (!match(TOKEN_IDENTIFIER)) {
-            printf("Error (line %d): Expected struct name after 'struct'\n", current_token.line);
-            exit(EXIT_FAILURE);
+    if (type_token.id == INTERN_KW_STRUCT) {
+        if (!ctx_match(ctx, TOKEN_IDENTIFIER)) {
+            parser_syntax_error(ctx, "Expected struct name after 'struct'");
         }
-        type_token = current_token;
-        advance(input);
+        type_token = ctx->current_token;
+        ctx_advance(ctx);
         is_struct = 1;
     }
     
     // Get variable name
-    if (!match(TOKEN_IDENTIFIER)) {
-        printf("Error (line %d): Expected variable name after type\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        parser_syntax_error(ctx, "Expected variable name after type");
     }
     
-    name_token = current_token;
-    advance(input);
+    name_token = ctx->current_token;
+    ctx_advance(ctx);
     
     var_decl_node = create_node(NODE_VAR_DECL);
     var_decl_node->token = type_token;
-    var_decl_node->value = strdup(name_token.value);
+    set_node_value(var_decl_node, token_text(name_token));
     
     // Handle array declaration
-    if (match(TOKEN_BRACKET_OPEN)) {
+    if (ctx_match(ctx, TOKEN_BRACKET_OPEN)) {
         is_array = 1;
-        advance(input);
+        ctx_advance(ctx);
         
-        if (!match(TOKEN_NUMBER)) {
-            printf("Error (line %d): Expected array size after '['\n", current_token.line);
-            exit(EXIT_FAILURE);
+        if (!ctx_match(ctx, TOKEN_NUMBER)) {
+            parser_syntax_error(ctx, "Expected array size after '['");
         }
         
-        snprintf(arr_size_buf, sizeof(arr_size_buf), "%s", current_token.value);
-        snprintf(buf, sizeof(buf), "%s[%s]", name_token.value, current_token.value);
-        free(var_decl_node->value);
-        var_decl_node->value = strdup(buf);
-        advance(input);
+        var_decl_node->array_size = atoi(token_text(ctx->current_token));
+        ctx_advance(ctx);
         
-        register_array(name_token.value, atoi(arr_size_buf));
+        PROFILE_TIMER_START(ctx, symbol_timer);
+        array_table_register(&ctx->arrays, token_text(name_token), var_decl_node->array_size);
+        PROFILE_TIMER_STOP(ctx, symbol_timer, PROFILE_PHASE_SYMBOLS);
+        PROFILE_COUNT(ctx, symbol_operations, 1);
         
-        if (!consume(input, TOKEN_BRACKET_CLOSE)) {
-            printf("Error (line %d): Expected ']' after array size\n", current_token.line);
-            exit(EXIT_FAILURE);
+        if (!ctx_consume(ctx, TOKEN_BRACKET_CLOSE)) {
+            parser_syntax_error(ctx, "Expected ']' after array size");
         }
     }
     
     // Handle initialization
-    if (match(TOKEN_OPERATOR) && strcmp(current_token.value, "=") == 0) {
-        advance(input);
+    if (ctx_match(ctx, TOKEN_OPERATOR) && ctx->current_token.id == INTERN_OP_ASSIGN) {
+        ctx_advance(ctx);
         
-        if (is_array && match(TOKEN_BRACE_OPEN)) {
-            init_list = parse_initializer_list(input, 1);
+        if (is_array && ctx_match(ctx, TOKEN_BRACE_OPEN)) {
+            init_list = parse_initializer_list(ctx, 1);
             add_child(var_decl_node, init_list);
-        } else if (is_struct && match(TOKEN_BRACE_OPEN)) {
-            init_list = parse_initializer_list(input, 0);
+        } else if (is_struct && ctx_match(ctx, TOKEN_BRACE_OPEN)) {
+            init_list = parse_initializer_list(ctx, 0);
             add_child(var_decl_node, init_list);
         } else {
-            init_expr = parse_expression(input);
+            init_expr = parse_expression(ctx);
             if (init_expr) {
                 add_child(var_decl_node, init_expr);
             }
-            while (!match(TOKEN_SEMICOLON) && !match(TOKEN_EOF)) {
-                advance(input);
-            }
         }
     }
     
-    if (!consume(input, TOKEN_SEMICOLON)) {
-        printf("Error (line %d): Expected ';' after variable declaration\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_SEMICOLON)) {
+        parser_syntax_error(ctx, "Expected ';' after variable declaration");
     }
     
     return var_decl_node;
 }
 
-// Helper: Parse left-hand side expression (identifier with optional field access and array indexing)
-static void parse_lhs_expression(FILE *input, Token lhs_token, char *lhs_buf, size_t lhs_buf_size,
-                                  char *idx_buf, size_t idx_buf_size, char *base_name, size_t base_name_size)
-{
-    int paren_depth = INITIAL_PARENTHESIS_DEPTH;
-    int arr_size = 0;
-    int idx_val = 0;
-    size_t len = 0;
-    const char *delim = NULL;
-    
-    snprintf(lhs_buf, lhs_buf_size, "%s", lhs_token.value);
-    
-    // Handle field access (struct.field)
-    while (match(TOKEN_OPERATOR) && current_token.value && strcmp(current_token.value, ".") == 0) {
-        advance(input);
-        if (!match(TOKEN_IDENTIFIER)) {
-            printf("Error (line %d): Expected field name after '.' in assignment\n", current_token.line);
-            exit(EXIT_FAILURE);
-        }
-        safe_append(lhs_buf, lhs_buf_size, "__");
-        safe_append(lhs_buf, lhs_buf_size, current_token.value);
-        advance(input);
-    }
-    
-    // Handle array indexing
-    if (match(TOKEN_BRACKET_OPEN)) {
-        advance(input);
-        memset(idx_buf, 0, idx_buf_size);
-        
-        while (!match(TOKEN_EOF)) {
-            if (match(TOKEN_BRACKET_CLOSE) && paren_depth == 0) {
-                break;
-            }
-            if (match(TOKEN_PARENTHESIS_OPEN)) {
-                safe_append(idx_buf, idx_buf_size, "(");
-                advance(input);
-                paren_depth++;
-                continue;
-            }
-            if (match(TOKEN_PARENTHESIS_CLOSE)) {
-                safe_append(idx_buf, idx_buf_size, ")");
-                advance(input);
-                if (paren_depth > 0) {
-                    paren_depth--;
-                }
-                continue;
-            }
-            if (current_token.value) {
-                safe_append(idx_buf, idx_buf_size, current_token.value);
-            }
-            advance(input);
-        }
-        
-        if (!consume(input, TOKEN_BRACKET_CLOSE)) {
-            printf("Error (line %d): Expected ']' after array index in assignment\n", current_token.line);
-            exit(EXIT_FAILURE);
-        }
-        
-        safe_append(lhs_buf, lhs_buf_size, "[");
-        safe_append(lhs_buf, lhs_buf_size, idx_buf);
-        safe_append(lhs_buf, lhs_buf_size, "]");
-        
-        // Validate array bounds
-        if (is_number_str(idx_buf)) {
-            memset(base_name, 0, base_name_size);
-            delim = strstr(lhs_buf, "__");
-            len = delim ? (size_t)(delim - lhs_buf) : strcspn(lhs_buf, "[");
-            if (len >= base_name_size) {
-                len = base_name_size - 1;
-            }
-            safe_copy(base_name, base_name_size, lhs_buf, len);
-            arr_size = find_array_size(base_name);
-            if (arr_size > 0) {
-                idx_val = atoi(idx_buf);
-                if (idx_val < 0 || idx_val >= arr_size) {
-                    printf("Error (line %d): Array index %d out of bounds for '%s' with size %d\n",
-                           current_token.line, idx_val, base_name, arr_size);
-                    exit(EXIT_FAILURE);
-                }
-            }
-        }
-    }
-}
-
 // Helper: Parse assignment statement or expression statement
 // Helper: Parse function call as statement (standalone call that doesn't use return value)
-static ASTNode* parse_standalone_function_call(FILE *input, const char *function_name)
+static ASTNode* parse_standalone_function_call(ParserContext *ctx, const char *function_name)
 {
     ASTNode *func_call_node = NULL;
     
     // Use shared helper to parse function call arguments
-    func_call_node = parse_function_call_args(input, function_name);
+    func_call_node = parse_function_call_args(ctx, function_name);
     
     // Expect semicolon after statement
-    if (!consume(input, TOKEN_SEMICOLON))
+    if (!ctx_consume(ctx, TOKEN_SEMICOLON))
     {
-        printf("Error (line %d): Expected ';' after function call\n", current_token.line);
-        exit(EXIT_FAILURE);
+        parser_syntax_error(ctx, "Expected ';' after function call");
     }
     
     return func_call_node;
 }
 
-static ASTNode* parse_assignment_or_expression(FILE *input)
+static ASTNode* parse_assignment_or_expression(ParserContext *ctx)
 {
-    Token lhs_token = current_token;
+    Token lhs_token = ctx->current_token;
     ASTNode *assign_node = NULL;
     ASTNode *lhs_expr = NULL;
     ASTNode *rhs_node = NULL;
-    char lhs_buf[LHS_BUFFER_SIZE] = {0};
-    char idx_buf[INDEX_BUFFER_SIZE] = {0};
-    char base_name[BASE_NAME_BUFFER_SIZE] = {0};
     
-    advance(input);
+    ctx_advance(ctx);
     
     // Check for function call: identifier(...)
-    if (match(TOKEN_PARENTHESIS_OPEN))
+    if (ctx_match(ctx, TOKEN_PARENTHESIS_OPEN))
     {
-        return parse_standalone_function_call(input, lhs_token.value);
+        return parse_standalone_function_call(ctx, token_text(lhs_token));
     }
     
-    parse_lhs_expression(input, lhs_token, lhs_buf, sizeof(lhs_buf),
-                        idx_buf, sizeof(idx_buf), base_name, sizeof(base_name));
-    
-    lhs_expr = create_node(NODE_EXPRESSION);
-    lhs_expr->value = strdup(lhs_buf);
+    // Left-hand side: identifier with optional field access and array indexing
+    lhs_expr = parse_postfix_access(ctx, lhs_token);
     
-    if (match(TOKEN_OPERATOR) && strcmp(current_token.value, "=") == 0)
+    if (ctx_match(ctx, TOKEN_OPERATOR) && ctx->current_token.id == INTERN_OP_ASSIGN)
     {
-        advance(input);
+        ctx_advance(ctx);
         assign_node = create_node(NODE_ASSIGNMENT);
         add_child(assign_node, lhs_expr);
         
-        rhs_node = parse_expression(input);
+        rhs_node = parse_expression(ctx);
         if (rhs_node)
         {
             add_child(assign_node, rhs_node);
         }
         
-        if (!consume(input, TOKEN_SEMICOLON))
+        if (!ctx_consume(ctx, TOKEN_SEMICOLON))
         {
-            printf("Error (line %d): Expected ';' after assignment\n", current_token.line);
-            exit(EXIT_FAILURE);
+            parser_syntax_error(ctx, "Expected ';' after assignment");
         }
         
         return assign_node;
@@ -337,13 +190,13 @@ static ASTNode* parse_assignment_or_expression(FILE *input)
     else
     {
         // Not an assignment, skip to semicolon
-        while (!match(TOKEN_SEMICOLON) && !match(TOKEN_EOF))
+        while (!ctx_match(ctx, TOKEN_SEMICOLON) && !ctx_match(ctx, TOKEN_EOF))
         {
-            advance(input);
+            ctx_advance(ctx);
         }
-        if (match(TOKEN_SEMICOLON))
+        if (ctx_match(ctx, TOKEN_SEMICOLON))
         {
-            advance(input);
+            ctx_advance(ctx);
         }
         free_node(lhs_expr);
         return NULL;
@@ -351,55 +204,51 @@ static ASTNode* parse_assignment_or_expression(FILE *input)
 }
 
 // Helper: Parse return statement
-static ASTNode* parse_return_statement(FILE *input)
+static ASTNode* parse_return_statement(ParserContext *ctx)
 {
     ASTNode *stmt_node = create_node(NODE_STATEMENT);
     ASTNode *return_expr = NULL;
     
-    stmt_node->token = current_token;
-    advance(input);
+    stmt_node->token = ctx->current_token;
+    ctx_advance(ctx);
     
-    return_expr = parse_expression(input);
+    return_expr = parse_expression(ctx);
     if (return_expr) {
         add_child(stmt_node, return_expr);
     }
     
-    if (!consume(input, TOKEN_SEMICOLON)) {
-        printf("Error (line %d): Expected ';' after return statement\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_SEMICOLON)) {
+        parser_syntax_error(ctx, "Expected ';' after return statement");
     }
     
     return stmt_node;
 }
 
 // Helper: Parse else-if or else block
-static void parse_else_blocks(FILE *input, ASTNode *if_node)
+static void parse_else_blocks(ParserContext *ctx, ASTNode *if_node)
 {
     ASTNode *elseif_cond = NULL;
     ASTNode *elseif_node = NULL;
     ASTNode *else_node = NULL;
     ASTNode *inner_stmt = NULL;
     
-    while (match(TOKEN_KEYWORD) && strcmp(current_token.value, "else") == 0) {
-        advance(input);
+    while (ctx_match(ctx, TOKEN_KEYWORD) && ctx->current_token.id == INTERN_KW_ELSE) {
+        ctx_advance(ctx);
         
-        if (match(TOKEN_KEYWORD) && strcmp(current_token.value, "if") == 0) {
+        if (ctx_match(ctx, TOKEN_KEYWORD) && ctx->current_token.id == INTERN_KW_IF) {
             // else if
-            advance(input);
-            if (!consume(input, TOKEN_PARENTHESIS_OPEN)) {
-                printf("Error (line %d): Expected '(' after 'else if'\n", current_token.line);
-                exit(EXIT_FAILURE);
+            ctx_advance(ctx);
+            if (!ctx_consume(ctx, TOKEN_PARENTHESIS_OPEN)) {
+                parser_syntax_error(ctx, "Expected '(' after 'else if'");
             }
             
-            elseif_cond = parse_expression(input);
+            elseif_cond = parse_expression(ctx);
             
-            if (!consume(input, TOKEN_PARENTHESIS_CLOSE)) {
-                printf("Error (line %d): Expected ')' after else if condition\n", current_token.line);
-                exit(EXIT_FAILURE);
+            if (!ctx_consume(ctx, TOKEN_PARENTHESIS_CLOSE)) {
+                parser_syntax_error(ctx, "Expected ')' after else if condition");
             }
-            if (!consume(input, TOKEN_BRACE_OPEN)) {
-                printf("Error (line %d): Expected '{' after else if condition\n", current_token.line);
-                exit(EXIT_FAILURE);
+            if (!ctx_consume(ctx, TOKEN_BRACE_OPEN)) {
+                parser_syntax_error(ctx, "Expected '{' after else if condition");
             }
             
             elseif_node = create_node(NODE_ELSE_IF_STATEMENT);
@@ -407,38 +256,39 @@ static void parse_else_blocks(FILE *input, ASTNode *if_node)
                 add_child(elseif_node, elseif_cond);
             }
             
-            while (!match(TOKEN_BRACE_CLOSE) && !match(TOKEN_EOF)) {
-                inner_stmt = parse_statement(input);
+            symbol_scope_push(&ctx->arrays);
+            while (!ctx_match(ctx, TOKEN_BRACE_CLOSE) && !ctx_match(ctx, TOKEN_EOF)) {
+                inner_stmt = parse_statement_with_recovery(ctx);
                 if (inner_stmt) {
                     add_child(elseif_node, inner_stmt);
                 }
             }
+            symbol_scope_pop(&ctx->arrays);
             
-            if (!consume(input, TOKEN_BRACE_CLOSE)) {
-                printf("Error (line %d): Expected '}' after else if block\n", current_token.line);
-                exit(EXIT_FAILURE);
+            if (!ctx_consume(ctx, TOKEN_BRACE_CLOSE)) {
+                parser_syntax_error(ctx, "Expected '}' after else if block");
             }
             
             add_child(if_node, elseif_node);
         } else {
             // else
-            if (!consume(input, TOKEN_BRACE_OPEN)) {
-                printf("Error (line %d): Expected '{' after else\n", current_token.line);
-                exit(EXIT_FAILURE);
+            if (!ctx_consume(ctx, TOKEN_BRACE_OPEN)) {
+                parser_syntax_error(ctx, "Expected '{' after else");
             }
             
             else_node = create_node(NODE_ELSE_STATEMENT);
             
-            while (!match(TOKEN_BRACE_CLOSE) && !match(TOKEN_EOF)) {
-                inner_stmt = parse_statement(input);
+            symbol_scope_push(&ctx->arrays);
+            while (!ctx_match(ctx, TOKEN_BRACE_CLOSE) && !ctx_match(ctx, TOKEN_EOF)) {
+                inner_stmt = parse_statement_with_recovery(ctx);
                 if (inner_stmt) {
                     add_child(else_node, inner_stmt);
                 }
             }
+            symbol_scope_pop(&ctx->arrays);
             
-            if (!consume(input, TOKEN_BRACE_CLOSE)) {
-                printf("Error (line %d): Expected '}' after else block\n", current_token.line);
-                exit(EXIT_FAILURE);
+            if (!ctx_consume(ctx, TOKEN_BRACE_CLOSE)) {
+                parser_syntax_error(ctx, "Expected '}' after else block");
             }
             
             add_child(if_node, else_node);
@@ -448,28 +298,25 @@ static void parse_else_blocks(FILE *input, ASTNode *if_node)
 }
 
 // Helper: Parse if statement
-static ASTNode* parse_if_statement(FILE *input)
+static ASTNode* parse_if_statement(ParserContext *ctx)
 {
     ASTNode *cond_expr = NULL;
     ASTNode *if_node = NULL;
     ASTNode *inner_stmt = NULL;
     
-    advance(input);
+    ctx_advance(ctx);
     
-    if (!consume(input, TOKEN_PARENTHESIS_OPEN)) {
-        printf("Error (line %d): Expected '(' after 'if'\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_OPEN)) {
+        parser_syntax_error(ctx, "Expected '(' after 'if'");
     }
     
-    cond_expr = parse_expression(input);
+    cond_expr = parse_expression(ctx);
     
-    if (!consume(input, TOKEN_PARENTHESIS_CLOSE)) {
-        printf("Error (line %d): Expected ')' after if condition\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_CLOSE)) {
+        parser_syntax_error(ctx, "Expected ')' after if condition");
     }
-    if (!consume(input, TOKEN_BRACE_OPEN)) {
-        printf("Error (line %d): Expected '{' after if condition\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_BRACE_OPEN)) {
+        parser_syntax_error(ctx, "Expected '{' after if condition");
     }
     
     if_node = create_node(NODE_IF_STATEMENT);
@@ -477,46 +324,44 @@ static ASTNode* parse_if_statement(FILE *input)
         add_child(if_node, cond_expr);
     }
     
-    while (!match(TOKEN_BRACE_CLOSE) && !match(TOKEN_EOF)) {
-        inner_stmt = parse_statement(input);
+    symbol_scope_push(&ctx->arrays);
+    while (!ctx_match(ctx, TOKEN_BRACE_CLOSE) && !ctx_match(ctx, TOKEN_EOF)) {
+        inner_stmt = parse_statement_with_recovery(ctx);
         if (inner_stmt) {
             add_child(if_node, inner_stmt);
         }
     }
+    symbol_scope_pop(&ctx->arrays);
     
-    if (!consume(input, TOKEN_BRACE_CLOSE)) {
-        printf("Error (line %d): Expected '}' after if block\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_BRACE_CLOSE)) {
+        parser_syntax_error(ctx, "Expected '}' after if block");
     }
     
-    parse_else_blocks(input, if_node);
+    parse_else_blocks(ctx, if_node);
     
     return if_node;
 }
 
 // Helper: Parse while statement
-static ASTNode* parse_while_statement(FILE *input)
+static ASTNode* parse_while_statement(ParserContext *ctx)
 {
     ASTNode *cond_expr = NULL;
     ASTNode *while_node = NULL;
     ASTNode *inner_stmt = NULL;
     
-    advance(input);
+    ctx_advance(ctx);
     
-    if (!consume(input, TOKEN_PARENTHESIS_OPEN)) {
-        printf("Error (line %d): Expected '(' after 'while'\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_OPEN)) {
+        parser_syntax_error(ctx, "Expected '(' after 'while'");
     }
     
-    cond_expr = parse_expression(input);
+    cond_expr = parse_expression(ctx);
     
-    if (!consume(input, TOKEN_PARENTHESIS_CLOSE)) {
-        printf("Error (line %d): Expected ')' after while condition\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_CLOSE)) {
+        parser_syntax_error(ctx, "Expected ')' after while condition");
     }
-    if (!consume(input, TOKEN_BRACE_OPEN)) {
-        printf("Error (line %d): Expected '{' after while condition\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_BRACE_OPEN)) {
+        parser_syntax_error(ctx, "Expected '{' after while condition");
     }
     
     while_node = create_node(NODE_WHILE_STATEMENT);
@@ -524,25 +369,26 @@ static ASTNode* parse_while_statement(FILE *input)
         add_child(while_node, cond_expr);
     }
     
-    s_loop_depth++;
-    while (!match(TOKEN_BRACE_CLOSE) && !match(TOKEN_EOF)) {
-        inner_stmt = parse_statement(input);
+    ctx->loop_depth++;
+    symbol_scope_push(&ctx->arrays);
+    while (!ctx_match(ctx, TOKEN_BRACE_CLOSE) && !ctx_match(ctx, TOKEN_EOF)) {
+        inner_stmt = parse_statement_with_recovery(ctx);
         if (inner_stmt) {
             add_child(while_node, inner_stmt);
         }
     }
-    s_loop_depth--;
+    symbol_scope_pop(&ctx->arrays);
+    ctx->loop_depth--;
     
-    if (!consume(input, TOKEN_BRACE_CLOSE)) {
-        printf("Error (line %d): Expected '}' after while block\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_BRACE_CLOSE)) {
+        parser_syntax_error(ctx, "Expected '}' after while block");
     }
     
     return while_node;
 }
 
 // Helper: Parse for-loop initialization
-static ASTNode* parse_for_init(FILE *input)
+static ASTNode* parse_for_init(ParserContext *ctx)
 {
     ASTNode *init_node = NULL;
     ASTNode *init_stmt = NULL;
@@ -551,50 +397,47 @@ static ASTNode* parse_for_init(FILE *input)
     ASTNode *lhs_expr_tmp = NULL;
     ASTNode *rhs_expr = NULL;
     Token temp_lhs = {0};
-    long saved_pos = 0;
-    Token saved_token = {0};
+    LexerMark saved_mark;
     
-    if (match(TOKEN_SEMICOLON)) {
+    if (ctx_match(ctx, TOKEN_SEMICOLON)) {
         return NULL;
     }
     
-    saved_pos = ftell(input);
-    saved_token = current_token;
+    saved_mark = ctx_lexer_mark(ctx);
     
-    if (match(TOKEN_KEYWORD) && (strcmp(current_token.value, "int") == 0 ||
-                                  strcmp(current_token.value, "float") == 0 ||
-                                  strcmp(current_token.value, "char") == 0 ||
-                                  strcmp(current_token.value, "double") == 0)) {
-        init_stmt = parse_statement(input);
+    if (ctx_match(ctx, TOKEN_KEYWORD) && (ctx->current_token.id == INTERN_KW_INT ||
+                                  ctx->current_token.id == INTERN_KW_FLOAT ||
+                                  ctx->current_token.id == INTERN_KW_CHAR ||
+                                  ctx->current_token.id == INTERN_KW_DOUBLE ||
+                                  ctype_explicit_width(token_text(ctx->current_token), NULL) > 0)) {
+        init_stmt = parse_statement(ctx);
         if (init_stmt && init_stmt->num_children > 0) {
             child0 = init_stmt->children[0];
             if (child0->type == NODE_VAR_DECL || child0->type == NODE_ASSIGNMENT) {
                 init_node = child0;
             }
         }
-    } else if (match(TOKEN_IDENTIFIER)) {
-        temp_lhs = current_token;
-        advance(input);
-        if (match(TOKEN_OPERATOR) && strcmp(current_token.value, "=") == 0) {
-            advance(input);
+    } else if (ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        temp_lhs = ctx->current_token;
+        ctx_advance(ctx);
+        if (ctx_match(ctx, TOKEN_OPERATOR) && ctx->current_token.id == INTERN_OP_ASSIGN) {
+            ctx_advance(ctx);
             assign_tmp = create_node(NODE_ASSIGNMENT);
             lhs_expr_tmp = create_node(NODE_EXPRESSION);
-            lhs_expr_tmp->value = strdup(temp_lhs.value);
+            set_node_value(lhs_expr_tmp, token_text(temp_lhs));
             add_child(assign_tmp, lhs_expr_tmp);
             
-            rhs_expr = parse_expression(input);
+            rhs_expr = parse_expression(ctx);
             if (rhs_expr) {
                 add_child(assign_tmp, rhs_expr);
             }
             
-            if (!consume(input, TOKEN_SEMICOLON)) {
-                printf("Error (line %d): Expected ';' after for-init assignment\n", current_token.line);
-                exit(EXIT_FAILURE);
+            if (!ctx_consume(ctx, TOKEN_SEMICOLON)) {
+                parser_syntax_error(ctx, "Expected ';' after for-init assignment");
             }
             init_node = assign_tmp;
         } else {
-            fseek(input, saved_pos, SEEK_SET);
-            current_token = saved_token;
+            ctx_lexer_reset_to(ctx, &saved_mark);
         }
     }
     
@@ -602,7 +445,7 @@ static ASTNode* parse_for_init(FILE *input)
 }
 
 // Helper: Parse for-loop increment
-static ASTNode* parse_for_increment(FILE *input)
+static ASTNode* parse_for_increment(ParserContext *ctx)
 {
     ASTNode *incr_expr = NULL;
     ASTNode *lhs = NULL;
@@ -611,39 +454,39 @@ static ASTNode* parse_for_increment(FILE *input)
     ASTNode *op_r = NULL;
     Token inc_lhs = {0};
     
-    if (match(TOKEN_PARENTHESIS_CLOSE)) {
+    if (ctx_match(ctx, TOKEN_PARENTHESIS_CLOSE)) {
         return NULL;
     }
     
-    if (match(TOKEN_IDENTIFIER)) {
-        inc_lhs = current_token;
-        advance(input);
+    if (ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        inc_lhs = ctx->current_token;
+        ctx_advance(ctx);
         
-        if (match(TOKEN_OPERATOR) && (strcmp(current_token.value, "++") == 0 ||
-                                       strcmp(current_token.value, "--") == 0)) {
+        if (ctx_match(ctx, TOKEN_OPERATOR) && (ctx->current_token.id == INTERN_OP_INCREMENT ||
+                                       ctx->current_token.id == INTERN_OP_DECREMENT)) {
             incr_expr = create_node(NODE_ASSIGNMENT);
             lhs = create_node(NODE_EXPRESSION);
-            lhs->value = strdup(inc_lhs.value);
+            set_node_value(lhs, token_text(inc_lhs));
             add_child(incr_expr, lhs);
             
             rhs = create_node(NODE_BINARY_EXPR);
-            rhs->value = strdup(strcmp(current_token.value, "++") == 0 ? "+" : "-");
+            set_node_operator(rhs, ctx->current_token.id == INTERN_OP_INCREMENT ? INTERN_OP_PLUS : INTERN_OP_MINUS);
             op_l = create_node(NODE_EXPRESSION);
-            op_l->value = strdup(inc_lhs.value);
+            set_node_value(op_l, token_text(inc_lhs));
             op_r = create_node(NODE_EXPRESSION);
-            op_r->value = strdup("1");
+            set_node_value(op_r, "1");
             add_child(rhs, op_l);
             add_child(rhs, op_r);
             add_child(incr_expr, rhs);
-            advance(input);
-        } else if (match(TOKEN_OPERATOR) && strcmp(current_token.value, "=") == 0) {
-            advance(input);
+            ctx_advance(ctx);
+        } else if (ctx_match(ctx, TOKEN_OPERATOR) && ctx->current_token.id == INTERN_OP_ASSIGN) {
+            ctx_advance(ctx);
             incr_expr = create_node(NODE_ASSIGNMENT);
             lhs = create_node(NODE_EXPRESSION);
-            lhs->value = strdup(inc_lhs.value);
+            set_node_value(lhs, token_text(inc_lhs));
             add_child(incr_expr, lhs);
             
-            rhs = parse_expression(input);
+            rhs = parse_expression(ctx);
             if (rhs) {
                 add_child(incr_expr, rhs);
             }
@@ -654,7 +497,7 @@ static ASTNode* parse_for_increment(FILE *input)
 }
 
 // Helper: Parse for statement
-static ASTNode* parse_for_statement(FILE *input)
+static ASTNode* parse_for_statement(ParserContext *ctx)
 {
     ASTNode *init_node = NULL;
     ASTNode *cond_expr = NULL;
@@ -663,40 +506,36 @@ static ASTNode* parse_for_statement(FILE *input)
     ASTNode *true_expr = NULL;
     ASTNode *inner = NULL;
     
-    advance(input);
+    ctx_advance(ctx);
     
-    if (!consume(input, TOKEN_PARENTHESIS_OPEN)) {
-        printf("Error (line %d): Expected '(' after 'for'\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_OPEN)) {
+        parser_syntax_error(ctx, "Expected '(' after 'for'");
     }
     
     // Parse initialization
-    init_node = parse_for_init(input);
+    init_node = parse_for_init(ctx);
     
-    if (match(TOKEN_SEMICOLON)) {
-        advance(input);
+    if (ctx_match(ctx, TOKEN_SEMICOLON)) {
+        ctx_advance(ctx);
     }
     
     // Parse condition
-    if (!match(TOKEN_SEMICOLON)) {
-        cond_expr = parse_expression(input);
+    if (!ctx_match(ctx, TOKEN_SEMICOLON)) {
+        cond_expr = parse_expression(ctx);
     }
     
-    if (!consume(input, TOKEN_SEMICOLON)) {
-        printf("Error (line %d): Expected ';' after for condition\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_SEMICOLON)) {
+        parser_syntax_error(ctx, "Expected ';' after for condition");
     }
     
     // Parse increment
-    incr_expr = parse_for_increment(input);
+    incr_expr = parse_for_increment(ctx);
     
-    if (!consume(input, TOKEN_PARENTHESIS_CLOSE)) {
-        printf("Error (line %d): Expected ')' after for header\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_PARENTHESIS_CLOSE)) {
+        parser_syntax_error(ctx, "Expected ')' after for header");
     }
-    if (!consume(input, TOKEN_BRACE_OPEN)) {
-        printf("Error (line %d): Expected '{' after for header\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_BRACE_OPEN)) {
+        parser_syntax_error(ctx, "Expected '{' after for header");
     }
     
     // Build for node
@@ -710,23 +549,24 @@ static ASTNode* parse_for_statement(FILE *input)
         add_child(for_node, cond_expr);
     } else {
         true_expr = create_node(NODE_EXPRESSION);
-        true_expr->value = strdup("1");
+        set_node_value(true_expr, "1");
         add_child(for_node, true_expr);
     }
     
     // Parse body
-    s_loop_depth++;
-    while (!match(TOKEN_BRACE_CLOSE) && !match(TOKEN_EOF)) {
-        inner = parse_statement(input);
+    ctx->loop_depth++;
+    symbol_scope_push(&ctx->arrays);
+    while (!ctx_match(ctx, TOKEN_BRACE_CLOSE) && !ctx_match(ctx, TOKEN_EOF)) {
+        inner = parse_statement_with_recovery(ctx);
         if (inner) {
             add_child(for_node, inner);
         }
     }
-    s_loop_depth--;
+    symbol_scope_pop(&ctx->arrays);
+    ctx->loop_depth--;
     
-    if (!consume(input, TOKEN_BRACE_CLOSE)) {
-        printf("Error (line %d): Expected '}' after for body\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_BRACE_CLOSE)) {
+        parser_syntax_error(ctx, "Expected '}' after for body");
     }
     
     if (incr_expr) {
@@ -737,20 +577,18 @@ static ASTNode* parse_for_statement(FILE *input)
 }
 
 // Helper: Parse break statement
-static ASTNode* parse_break_statement(FILE *input)
+static ASTNode* parse_break_statement(ParserContext *ctx)
 {
     ASTNode *break_node = NULL;
     
-    if (s_loop_depth <= 0) {
-        printf("Error (line %d): 'break' not within a loop\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (ctx->loop_depth <= 0) {
+        parser_syntax_error(ctx, "'break' not within a loop");
     }
     
-    advance(input);
+    ctx_advance(ctx);
     
-    if (!consume(input, TOKEN_SEMICOLON)) {
-        printf("Error (line %d): Expected ';' after 'break'\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_SEMICOLON)) {
+        parser_syntax_error(ctx, "Expected ';' after 'break'");
     }
     
     break_node = create_node(NODE_BREAK_STATEMENT);
@@ -758,42 +596,68 @@ static ASTNode* parse_break_statement(FILE *input)
 }
 
 // Helper: Parse continue statement
-static ASTNode* parse_continue_statement(FILE *input)
+static ASTNode* parse_continue_statement(ParserContext *ctx)
 {
     ASTNode *continue_node = NULL;
     
-    if (s_loop_depth <= 0) {
-        printf("Error (line %d): 'continue' not within a loop\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (ctx->loop_depth <= 0) {
+        parser_syntax_error(ctx, "'continue' not within a loop");
     }
     
-    advance(input);
+    ctx_advance(ctx);
     
-    if (!consume(input, TOKEN_SEMICOLON)) {
-        printf("Error (line %d): Expected ';' after 'continue'\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_SEMICOLON)) {
+        parser_syntax_error(ctx, "Expected ';' after 'continue'");
     }
     
     continue_node = create_node(NODE_CONTINUE_STATEMENT);
     return continue_node;
 }
 
-ASTNode* parse_statement(FILE *input)
+// Helper: Record a pragma on the statement it precedes (one per line, outermost first)
+static void attach_pragma(ASTNode *stmt_node, const char *pragma)
+{
+    size_t pragma_length = strlen(pragma);
+    size_t existing_length = stmt_node->value ? strlen(stmt_node->value) + 1 : 0;
+    char *joined = (char*)xrealloc(NULL, pragma_length + existing_length + 1);
+
+    memcpy(joined, pragma, pragma_length);
+    if (stmt_node->value) {
+        joined[pragma_length] = '\n';
+        memcpy(joined + pragma_length + 1, stmt_node->value, existing_length);
+    } else {
+        joined[pragma_length] = '\0';
+    }
+    set_node_value(stmt_node, joined);
+    free(joined);
+}
+
+ASTNode* parse_statement(ParserContext *ctx)
 {
     ASTNode *stmt_node = NULL;
     ASTNode *sub_statement = NULL;
     
+    // #pragma annotates the statement that follows it
+    if (ctx_match(ctx, TOKEN_PRAGMA)) {
+        Token pragma = ctx->current_token;
+        ctx_advance(ctx);
+        stmt_node = parse_statement(ctx);
+        attach_pragma(stmt_node, token_text(pragma));
+        return stmt_node;
+    }
+    
     stmt_node = create_node(NODE_STATEMENT);
     
     // Variable declaration
-    if (match(TOKEN_KEYWORD) && (strcmp(current_token.value, "int") == 0 ||
-                                  strcmp(current_token.value, "float") == 0 ||
-                                  strcmp(current_token.value, "char") == 0 ||
-                                  strcmp(current_token.value, "double") == 0 ||
-                                  strcmp(current_token.value, "struct") == 0)) {
-        Token type_token = current_token;
-        advance(input);
-        sub_statement = parse_variable_declaration(input, type_token);
+    if (ctx_match(ctx, TOKEN_KEYWORD) && (ctx->current_token.id == INTERN_KW_INT ||
+                                  ctx->current_token.id == INTERN_KW_FLOAT ||
+                                  ctx->current_token.id == INTERN_KW_CHAR ||
+                                  ctx->current_token.id == INTERN_KW_DOUBLE ||
+                                  ctx->current_token.id == INTERN_KW_STRUCT ||
+                                  ctype_explicit_width(token_text(ctx->current_token), NULL) > 0)) {
+        Token type_token = ctx->current_token;
+        ctx_advance(ctx);
+        sub_statement = parse_variable_declaration(ctx, type_token);
         if (sub_statement) {
             add_child(stmt_node, sub_statement);
         }
@@ -801,8 +665,8 @@ ASTNode* parse_statement(FILE *input)
     }
     
     // Assignment or expression statement
-    if (match(TOKEN_IDENTIFIER)) {
-        sub_statement = parse_assignment_or_expression(input);
+    if (ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        sub_statement = parse_assignment_or_expression(ctx);
         if (sub_statement) {
             add_child(stmt_node, sub_statement);
         }
@@ -810,13 +674,13 @@ ASTNode* parse_statement(FILE *input)
     }
     
     // Return statement
-    if (match(TOKEN_KEYWORD) && strcmp(current_token.value, "return") == 0) {
-        return parse_return_statement(input);
+    if (ctx_match(ctx, TOKEN_KEYWORD) && ctx->current_token.id == INTERN_KW_RETURN) {
+        return parse_return_statement(ctx);
     }
     
     // If statement
-    if (match(TOKEN_KEYWORD) && strcmp(current_token.value, "if") == 0) {
-        sub_statement = parse_if_statement(input);
+    if (ctx_match(ctx, TOKEN_KEYWORD) && ctx->current_token.id == INTERN_KW_IF) {
+        sub_statement = parse_if_statement(ctx);
         if (sub_statement) {
             add_child(stmt_node, sub_statement);
         }
@@ -824,8 +688,8 @@ ASTNode* parse_statement(FILE *input)
     }
     
     // While statement
-    if (match(TOKEN_KEYWORD) && strcmp(current_token.value, "while") == 0) {
-        sub_statement = parse_while_statement(input);
+    if (ctx_match(ctx, TOKEN_KEYWORD) && ctx->current_token.id == INTERN_KW_WHILE) {
+        sub_statement = parse_while_statement(ctx);
         if (sub_statement) {
             add_child(stmt_node, sub_statement);
         }
@@ -833,8 +697,8 @@ ASTNode* parse_statement(FILE *input)
     }
     
     // For statement
-    if (match(TOKEN_KEYWORD) && strcmp(current_token.value, "for") == 0) {
-        sub_statement = parse_for_statement(input);
+    if (ctx_match(ctx, TOKEN_KEYWORD) && ctx->current_token.id == INTERN_KW_FOR) {
+        sub_statement = parse_for_statement(ctx);
         if (sub_statement) {
             add_child(stmt_node, sub_statement);
         }
@@ -842,9 +706,9 @@ ASTNode* parse_statement(FILE *input)
     }
     
     // Break statement
-    if ((match(TOKEN_KEYWORD) && strcmp(current_token.value, "break") == 0) ||
-        (match(TOKEN_IDENTIFIER) && strcmp(current_token.value, "break") == 0)) {
-        sub_statement = parse_break_statement(input);
+    if ((ctx_match(ctx, TOKEN_KEYWORD) && ctx->current_token.id == INTERN_KW_BREAK) ||
+        (ctx_match(ctx, TOKEN_IDENTIFIER) && ctx->current_token.id == INTERN_KW_BREAK)) {
+        sub_statement = parse_break_statement(ctx);
         if (sub_statement) {
             add_child(stmt_node, sub_statement);
         }
@@ -852,9 +716,9 @@ ASTNode* parse_statement(FILE *input)
     }
     
     // Continue statement
-    if ((match(TOKEN_KEYWORD) && strcmp(current_token.value, "continue") == 0) ||
-        (match(TOKEN_IDENTIFIER) && strcmp(current_token.value, "continue") == 0)) {
-        sub_statement = parse_continue_statement(input);
+    if ((ctx_match(ctx, TOKEN_KEYWORD) && ctx->current_token.id == INTERN_KW_CONTINUE) ||
+        (ctx_match(ctx, TOKEN_IDENTIFIER) && ctx->current_token.id == INTERN_KW_CONTINUE)) {
+        sub_statement = parse_continue_statement(ctx);
         if (sub_statement) {
             add_child(stmt_node, sub_statement);
         }
@@ -862,12 +726,78 @@ ASTNode* parse_statement(FILE *input)
     }
     
     // Unknown/empty statement - skip to semicolon
-    while (!match(TOKEN_SEMICOLON) && !match(TOKEN_BRACE_CLOSE) && !match(TOKEN_EOF)) {
-        advance(input);
+    while (!ctx_match(ctx, TOKEN_SEMICOLON) && !ctx_match(ctx, TOKEN_BRACE_CLOSE) && !ctx_match(ctx, TOKEN_EOF)) {
+        ctx_advance(ctx);
     }
-    if (match(TOKEN_SEMICOLON)) {
-        advance(input);
+    if (ctx_match(ctx, TOKEN_SEMICOLON)) {
+        ctx_advance(ctx);
     }
     
     return stmt_node;
 }
+
+// Helper: keywords that can only start a statement
+static int starts_statement(const ParserContext *ctx)
+{
+    if (ctx_match(ctx, TOKEN_PRAGMA)) {
+        return 1;
+    }
+    switch (ctx->current_token.id) {
+        case INTERN_KW_IF:
+        case INTERN_KW_WHILE:
+        case INTERN_KW_FOR:
+        case INTERN_KW_RETURN:
+        case INTERN_KW_BREAK:
+        case INTERN_KW_CONTINUE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Skip the rest of a statement after a syntax error: through its ';' or
+ * its braced body, or up to the '}' closing the enclosing block or the
+ * next keyword that starts a statement (the one missing a ';' before it).
+ */
+static void synchronize_statement(ParserContext *ctx, uint32_t start_offset)
+{
+    int brace_depth = 0;
+
+    while (!ctx_match(ctx, TOKEN_EOF)) {
+        if (brace_depth == 0 && ctx->current_token.offset > start_offset && starts_statement(ctx)) {
+            return;
+        }
+        if (ctx_match(ctx, TOKEN_BRACE_OPEN)) {
+            brace_depth++;
+        } else if (ctx_match(ctx, TOKEN_BRACE_CLOSE)) {
+            if (brace_depth == 0) {
+                return;
+            }
+            if (--brace_depth == 0) {
+                ctx_advance(ctx);
+                return;
+            }
+        } else if (ctx_match(ctx, TOKEN_SEMICOLON) && brace_depth == 0) {
+            ctx_advance(ctx);
+            return;
+        }
+        ctx_advance(ctx);
+    }
+}
+
+ASTNode* parse_statement_with_recovery(ParserContext *ctx)
+{
+    ParserRecovery recovery;
+    ASTNode *volatile statement = NULL;
+
+    parser_recovery_push(ctx, &recovery);
+    if (setjmp(recovery.target) == 0) {
+        statement = parse_statement(ctx);
+    } else {
+        parser_recovery_restore(ctx, &recovery);
+        synchronize_statement(ctx, recovery.start_offset);
+    }
+    parser_recovery_pop(ctx, &recovery);
+    return statement;
+}
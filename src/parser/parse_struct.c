@@ -5,130 +5,77 @@
 #include "symbol_structs.h"
 #include "parse.h"
 #include "token.h"
+#include "parser_context.h"
+#include "profile.h"
 
-#define MAX_STRUCT_FIELDS 32
-
-static inline void safe_copy(char *dst, size_t dst_size, const char *src)
-{
-    if (!dst_size) {
-        return;
-    }
-    size_t copy_length = strlen(src);
-    if (copy_length >= dst_size) {
-        copy_length = dst_size - 1;
-    }
-    memcpy(dst, src, copy_length);
-    dst[copy_length] = '\0';
-}
-
-extern Token current_token;
 
 // Forward declarations
-static void register_struct_in_table(int struct_index, Token struct_name_token);
-static ASTNode* parse_struct_field(FILE *input, int struct_index);
-static void register_field_in_struct(int struct_index, Token field_type, Token field_name);
-
-
-// Register struct name in global struct table
-static void register_struct_in_table(int struct_index, Token struct_name_token)
-{
-    if (g_struct_count < (int)(sizeof(g_structs)/sizeof(g_structs[0]))) {
-        safe_copy(g_structs[struct_index].name, 
-                  sizeof(g_structs[struct_index].name), 
-                  struct_name_token.value);
-        g_structs[struct_index].field_count = 0;
-    }
-}
-
-// Register a field in the struct's field table
-static void register_field_in_struct(int struct_index, Token field_type, Token field_name)
-{
-    if (struct_index != g_struct_count || 
-        g_struct_count >= (int)(sizeof(g_structs)/sizeof(g_structs[0]))) {
-        return;
-    }
-    
-    StructInfo *struct_info = &g_structs[struct_index];
-    if (struct_info->field_count >= MAX_STRUCT_FIELDS) {
-        return;
-    }
-    
-    int field_index = struct_info->field_count;
-    safe_copy(struct_info->fields[field_index].field_name, 
-              sizeof(struct_info->fields[field_index].field_name), 
-              field_name.value);
-    safe_copy(struct_info->fields[field_index].field_type, 
-              sizeof(struct_info->fields[field_index].field_type), 
-              field_type.value);
-    struct_info->field_count++;
-}
+static ASTNode* parse_struct_field(ParserContext *ctx, int struct_index);
 
 // Parse a single struct field: type name;
-static ASTNode* parse_struct_field(FILE *input, int struct_index)
+static ASTNode* parse_struct_field(ParserContext *ctx, int struct_index)
 {
-    if (!match(TOKEN_KEYWORD)) {
+    if (!ctx_match(ctx, TOKEN_KEYWORD)) {
         return NULL;
     }
     
-    Token field_type = current_token;
-    advance(input);
+    Token field_type = ctx->current_token;
+    ctx_advance(ctx);
     
-    if (!match(TOKEN_IDENTIFIER)) {
-        printf("Error (line %d): Expected field name in struct\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_match(ctx, TOKEN_IDENTIFIER)) {
+        parser_syntax_error(ctx, "Expected field name in struct");
     }
     
-    Token field_name = current_token;
-    advance(input);
+    Token field_name = ctx->current_token;
+    ctx_advance(ctx);
     
     ASTNode *field_node = create_node(NODE_VAR_DECL);
     field_node->token = field_type;
-    field_node->value = strdup(field_name.value);
+    set_node_value(field_node, token_text(field_name));
     
-    register_field_in_struct(struct_index, field_type, field_name);
+    PROFILE_TIMER_START(ctx, symbol_timer);
+    struct_table_add_field(&ctx->structs, struct_index, token_text(field_name), token_text(field_type));
+    PROFILE_TIMER_STOP(ctx, symbol_timer, PROFILE_PHASE_SYMBOLS);
+    PROFILE_COUNT(ctx, symbol_operations, 1);
     
-    if (!consume(input, TOKEN_SEMICOLON)) {
-        printf("Error (line %d): Expected ';' after struct field\n", current_token.line);
-        exit(EXIT_FAILURE);
+    if (!ctx_consume(ctx, TOKEN_SEMICOLON)) {
+        parser_syntax_error(ctx, "Expected ';' after struct field");
     }
     
     return field_node;
 }
 
 // Parse struct definition: struct Name { type field; ... };
-ASTNode* parse_struct(FILE *input, Token struct_name_token)
+ASTNode* parse_struct(ParserContext *ctx, Token struct_name_token)
 {
-    if (!consume(input, TOKEN_BRACE_OPEN)) {
-        printf("Error (line %d): Expected '{' after struct name\n", current_token.line);
-        return NULL;
+    if (!ctx_consume(ctx, TOKEN_BRACE_OPEN)) {
+        parser_syntax_error(ctx, "Expected '{' after struct name");
     }
     
     ASTNode *struct_node = create_node(NODE_STRUCT_DECL);
-    struct_node->value = strdup(struct_name_token.value);
+    set_node_value(struct_node, token_text(struct_name_token));
     
-    int struct_index = g_struct_count;
-    register_struct_in_table(struct_index, struct_name_token);
+    PROFILE_TIMER_START(ctx, symbol_timer);
+    int struct_index = struct_table_register(&ctx->structs, token_text(struct_name_token));
+    PROFILE_TIMER_STOP(ctx, symbol_timer, PROFILE_PHASE_SYMBOLS);
+    PROFILE_COUNT(ctx, symbol_operations, 1);
     
     // Parse all fields
-    while (!match(TOKEN_BRACE_CLOSE) && !match(TOKEN_EOF)) {
-        ASTNode *field_node = parse_struct_field(input, struct_index);
+    while (!ctx_match(ctx, TOKEN_BRACE_CLOSE) && !ctx_match(ctx, TOKEN_EOF)) {
+        ASTNode *field_node = parse_struct_field(ctx, struct_index);
         if (field_node) {
             add_child(struct_node, field_node);
         } else {
             // Skip unknown tokens
-            advance(input);
+            ctx_advance(ctx);
         }
     }
     
-    if (!consume(input, TOKEN_BRACE_CLOSE)) {
-        printf("Error (line %d): Expected '}' after struct body\n", current_token.line);
+    if (!ctx_consume(ctx, TOKEN_BRACE_CLOSE)) {
+        parser_syntax_error(ctx, "Expected '}' after struct body");
     }
-    if (!consume(input, TOKEN_SEMICOLON)) {
-        printf("Error (line %d): Expected ';' after struct declaration\n", current_token.line);
-    }
-    
-    if (struct_index == g_struct_count) {
-        g_struct_count++;
+    if (!ctx_consume(ctx, TOKEN_SEMICOLON)) {
+        parser_syntax_error(ctx, "Expected ';' after struct declaration");
     }
     
     return struct_node;
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "parser_context.h"
+#include "error_handler.h"
+
+// Longest source line quoted under a syntax error
+#define SOURCE_LINE_MAX 1024
+
+// Context behind the legacy API (zeroed tables are valid empty tables)
+static ParserContext s_default_context = {
+    .current_line = 1,
+    .max_errors = PARSER_DEFAULT_MAX_ERRORS,
+    .last_error_offset = -1
+};
+
+// Context activated on this thread (NULL = default)
+static _Thread_local ParserContext *s_active_context = NULL;
+
+void parser_context_init(ParserContext *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->current_line = 1;
+    ctx->max_errors = PARSER_DEFAULT_MAX_ERRORS;
+    ctx->last_error_offset = -1;
+    symbol_table_init(&ctx->arrays);
+}
+
+void parser_context_destroy(ParserContext *ctx)
+{
+    source_buffer_release(&ctx->source);
+    symbol_table_free(&ctx->arrays);
+    struct_table_free(&ctx->structs);
+    diagnostics_free(&ctx->diagnostics);
+    free(ctx->expr_operands);
+    free(ctx->expr_operators);
+    ctx->expr_operands = NULL;
+    ctx->expr_operators = NULL;
+    ctx->expr_operand_count = ctx->expr_operand_capacity = 0;
+    ctx->expr_operator_count = ctx->expr_operator_capacity = 0;
+    ctx->bound_input = NULL;
+    ctx->source_exhausted = 0;
+}
+
+ParserContext* parser_context_default(void)
+{
+    return &s_default_context;
+}
+
+ParserContext* parser_context_current(void)
+{
+    return s_active_context ? s_active_context : parser_context_default();
+}
+
+ParserContext* parser_context_activate(ParserContext *ctx)
+{
+    ParserContext *previous = s_active_context;
+    s_active_context = ctx;
+    return previous;
+}
+
+// Helper: abandon the unit without counting another error
+static void parser_abort(ParserContext *ctx)
+{
+    if (ctx->abort_target) {
+        longjmp(*ctx->abort_target, 1);
+    }
+    exit(EXIT_FAILURE);
+}
+
+void parser_fatal(ParserContext *ctx)
+{
+    ctx->error_count++;
+    parser_abort(ctx);
+}
+
+// Helper: copy the source line holding offset (without its newline)
+static const char* source_line_at(const SourceBuffer *source, size_t offset, char *line)
+{
+    size_t start = offset;
+    size_t end = offset;
+
+    if (!source->data || offset > source->length) {
+        return NULL;
+    }
+    while (start > 0 && source->data[start - 1] != '\n') {
+        start--;
+    }
+    while (end < source->length && source->data[end] != '\n' && end - start < SOURCE_LINE_MAX - 1) {
+        end++;
+    }
+    memcpy(line, source->data + start, end - start);
+    line[end - start] = '\0';
+    return line;
+}
+
+void parser_syntax_error(ParserContext *ctx, const char *format, ...)
+{
+    Token token = ctx->current_token;
+    char line[SOURCE_LINE_MAX];
+    char message[SOURCE_LINE_MAX];
+    ErrorLocation location;
+    va_list args;
+
+    if ((long)token.offset != ctx->last_error_offset) {
+        ctx->last_error_offset = (long)token.offset;
+        va_start(args, format);
+        vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+
+        location.filename = ctx->filename;
+        location.line = token.line;
+        location.column = ctx_token_column(ctx, token);
+        location.source_line = source_line_at(&ctx->source, token.offset, line);
+        report_message_ex(SEVERITY_ERROR, ERROR_CATEGORY_PARSER, &location, NULL, "%s", message);
+
+        if (ctx->max_errors > 0 && ctx->error_count >= ctx->max_errors) {
+            report_message(SEVERITY_INFO, ERROR_CATEGORY_PARSER, 0,
+                           "%d errors reported, stopping (--max-errors=N to change)", ctx->error_count);
+            parser_abort(ctx);
+        }
+    }
+    if (ctx->recover_target) {
+        longjmp(*ctx->recover_target, 1);
+    }
+    parser_abort(ctx);
+}
+
+void parser_recovery_push(ParserContext *ctx, ParserRecovery *recovery)
+{
+    recovery->outer = ctx->recover_target;
+    recovery->start_offset = ctx->current_token.offset;
+    recovery->loop_depth = ctx->loop_depth;
+    recovery->scope_depth = ctx->arrays.scope_depth;
+    recovery->expr_operand_count = ctx->expr_operand_count;
+    recovery->expr_operator_count = ctx->expr_operator_count;
+    ctx->recover_target = &recovery->target;
+}
+
+void parser_recovery_restore(ParserContext *ctx, const ParserRecovery *recovery)
+{
+    while (ctx->arrays.scope_depth > recovery->scope_depth) {
+        symbol_scope_pop(&ctx->arrays);
+    }
+    ctx->loop_depth = recovery->loop_depth;
+    ctx->expr_operand_count = recovery->expr_operand_count;
+    ctx->expr_operator_count = recovery->expr_operator_count;
+}
+
+void parser_recovery_pop(ParserContext *ctx, const ParserRecovery *recovery)
+{
+    ctx->recover_target = recovery->outer;
+}
@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "source_buffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SOURCE_BUFFER_HAVE_MMAP 1
+#else
+#define SOURCE_BUFFER_HAVE_MMAP 0
+#endif
+
+// Block size used when a stream cannot be mapped
+#define READ_BLOCK_SIZE (64 * 1024)
+
+static void source_buffer_reset(SourceBuffer *buffer)
+{
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->pos = 0;
+    buffer->storage = SOURCE_STORAGE_NONE;
+    buffer->mapped_length = 0;
+}
+
+#if SOURCE_BUFFER_HAVE_MMAP
+// Try to map a regular file; returns 1 if the buffer now views the file
+static int try_map_file(SourceBuffer *buffer, FILE *input)
+{
+    struct stat file_info;
+    long start_offset = 0;
+    void *mapping = NULL;
+    int fd = fileno(input);
+
+    if (fd < 0 || fstat(fd, &file_info) != 0 || !S_ISREG(file_info.st_mode)) {
+        return 0;
+    }
+
+    // Flush pending writes so the mapping sees them, and find where stdio is
+    fflush(input);
+    start_offset = ftell(input);
+    if (start_offset < 0 || (off_t)start_offset > file_info.st_size) {
+        return 0;
+    }
+
+    if (file_info.st_size == 0 || (off_t)start_offset == file_info.st_size) {
+        // Nothing left to scan; an empty buffer is a valid result
+        return 1;
+    }
+
+    mapping = mmap(NULL, (size_t)file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return 0;
+    }
+
+    buffer->data = (const char *)mapping;
+    buffer->length = (size_t)file_info.st_size;
+    buffer->pos = (size_t)start_offset;
+    buffer->storage = SOURCE_STORAGE_MAPPED;
+    buffer->mapped_length = (size_t)file_info.st_size;
+    return 1;
+}
+#endif
+
+// Read the rest of a stream into a growable heap block
+static int read_stream_blocks(SourceBuffer *buffer, FILE *input)
+{
+    char *block = NULL;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t bytes_read = 0;
+
+    do {
+        if (capacity - used < READ_BLOCK_SIZE) {
+            size_t new_capacity = capacity ? capacity * 2 : READ_BLOCK_SIZE;
+            char *grown = (char *)realloc(block, new_capacity);
+            if (!grown) {
+                free(block);
+                return 0;
+            }
+            block = grown;
+            capacity = new_capacity;
+        }
+        bytes_read = fread(block + used, 1, capacity - used, input);
+        used += bytes_read;
+    } while (bytes_read > 0);
+
+    if (ferror(input)) {
+        free(block);
+        return 0;
+    }
+
+    buffer->data = block;
+    buffer->length = used;
+    buffer->pos = 0;
+    buffer->storage = SOURCE_STORAGE_HEAP;
+    return 1;
+}
+
+int source_buffer_from_file(SourceBuffer *buffer, FILE *input)
+{
+    source_buffer_reset(buffer);
+
+    if (!input) {
+        return 0;
+    }
+
+#if SOURCE_BUFFER_HAVE_MMAP
+    if (try_map_file(buffer, input)) {
+        // Leave the stream consumed, as if it had been read to the end
+        fseek(input, 0, SEEK_END);
+        return 1;
+    }
+#endif
+
+    return read_stream_blocks(buffer, input);
+}
+
+void source_buffer_from_memory(SourceBuffer *buffer, const char *data, size_t length)
+{
+    source_buffer_reset(buffer);
+    buffer->data = data;
+    buffer->length = data ? length : 0;
+}
+
+int source_column(const SourceBuffer *buffer, size_t offset)
+{
+    size_t line_start = offset;
+
+    if (!buffer || !buffer->data || offset > buffer->length) {
+        return 0;
+    }
+    while (line_start > 0 && buffer->data[line_start - 1] != '\n') {
+        line_start--;
+    }
+    return (int)(offset - line_start) + 1;
+}
+
+void source_buffer_release(SourceBuffer *buffer)
+{
+    if (!buffer) {
+        return;
+    }
+
+    switch (buffer->storage) {
+        case SOURCE_STORAGE_HEAP:
+            free((void *)buffer->data);
+            break;
+#if SOURCE_BUFFER_HAVE_MMAP
+        case SOURCE_STORAGE_MAPPED:
+            munmap((void *)buffer->data, buffer->mapped_length);
+            break;
+#endif
+        default:
+            break;
+    }
+
+    source_buffer_reset(buffer);
+}
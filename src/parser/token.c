@@ -1,20 +1,181 @@
 #include "token.h"
+#include "parser_context.h"
+#include "profile.h"
+#include "utils.h"
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
+#include <limits.h>
 
-// Current token and functions to manage the token stream
+// Current token of the legacy API (mirrors the default ParserContext)
 Token current_token;
 int current_line = 1; // Track current line number
 
-// List of C keywords
-const char *keywords[] = {
-    "if", "else", "while", "for", "return", "break", "continue",
-    "struct",
-    "int", "float", "char", "double", "void",
-    NULL
+// Keyword table indexed by a perfect hash of (length, first byte, last byte).
+// The slots were chosen so every keyword lands alone; the lexer resolves
+// keywords here without touching the (locked) intern table.
+#define KEYWORD_SLOTS 32
+#define KEYWORD_MIN_LENGTH 2 // "if"
+#define KEYWORD_MAX_LENGTH 8 // "continue"
+#define keyword_slot(text, length) \
+    (((length) + (unsigned char)(text)[0] + (unsigned char)(text)[(length) - 1]) & (KEYWORD_SLOTS - 1))
+
+typedef struct {
+    const char *text;
+    uint8_t length;
+    InternId id;
+} KeywordSlot;
+
+static const KeywordSlot s_keyword_slots[KEYWORD_SLOTS] = {
+    [0] = { "int", 3, INTERN_KW_INT },
+    [1] = { "while", 5, INTERN_KW_WHILE },
+    [6] = { "return", 6, INTERN_KW_RETURN },
+    [13] = { "struct", 6, INTERN_KW_STRUCT },
+    [14] = { "else", 4, INTERN_KW_ELSE },
+    [15] = { "double", 6, INTERN_KW_DOUBLE },
+    [16] = { "continue", 8, INTERN_KW_CONTINUE },
+    [17] = { "if", 2, INTERN_KW_IF },
+    [18] = { "break", 5, INTERN_KW_BREAK },
+    [25] = { "char", 4, INTERN_KW_CHAR },
+    [27] = { "for", 3, INTERN_KW_FOR },
+    [30] = { "void", 4, INTERN_KW_VOID },
+    [31] = { "float", 5, INTERN_KW_FLOAT },
 };
 
+// Predefined id of the keyword spelled by text, INTERN_NONE if it is none
+static InternId keyword_id(const char *text, size_t length)
+{
+    const KeywordSlot *slot = NULL;
+
+    if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH) {
+        return INTERN_NONE;
+    }
+    slot = &s_keyword_slots[keyword_slot(text, length)];
+    if (slot->length != length || memcmp(slot->text, text, length) != 0) {
+        return INTERN_NONE;
+    }
+    return slot->id;
+}
+
+// Check if a string is a keyword
+int is_keyword(const char *str)
+{
+    return keyword_id(str, strlen(str)) != INTERN_NONE;
+}
+
+// -------------------------------------------------------------------------
+// Context-based lexer API
+// -------------------------------------------------------------------------
+
+// Load a stream into the context's source buffer
+int ctx_lexer_begin(ParserContext *ctx, FILE *input)
+{
+    int loaded = 0;
+
+    source_buffer_release(&ctx->source);
+    loaded = source_buffer_from_file(&ctx->source, input);
+    ctx->bound_input = input;
+    ctx->source_exhausted = 0;
+    return loaded;
+}
+
+// Scan caller-owned memory; the buffer must outlive the parse
+void ctx_lexer_begin_memory(ParserContext *ctx, const char *data, size_t length)
+{
+    source_buffer_release(&ctx->source);
+    source_buffer_from_memory(&ctx->source, data, length);
+    ctx->bound_input = NULL;
+    ctx->source_exhausted = 0;
+}
+
+// Release the source buffer
+void ctx_lexer_end(ParserContext *ctx)
+{
+    source_buffer_release(&ctx->source);
+    ctx->bound_input = NULL;
+    ctx->source_exhausted = 0;
+}
+
+// Get the next token and update the context's current token
+void ctx_advance(ParserContext *ctx)
+{
+    ctx->current_token = lexer_scan(&ctx->source, &ctx->current_line);
+    PROFILE_COUNT(ctx, token_count, 1);
+    if (ctx->current_token.type == TOKEN_EOF) {
+        ctx->source_exhausted = 1;
+    }
+}
+
+// Check if current token matches expected type
+int ctx_match(const ParserContext *ctx, TokenType type)
+{
+    return ctx->current_token.type == type;
+}
+
+// Consume the current token if it matches expected type
+int ctx_consume(ParserContext *ctx, TokenType type)
+{
+
+    if (ctx_match(ctx, type)) {
+        ctx_advance(ctx);
+        return 1;
+    }
+    return 0;
+}
+
+LexerMark ctx_lexer_mark(const ParserContext *ctx)
+{
+    LexerMark mark;
+
+    mark.pos = ctx->source.pos;
+    mark.line = ctx->current_line;
+    mark.token = ctx->current_token;
+    return mark;
+}
+
+void ctx_lexer_reset_to(ParserContext *ctx, const LexerMark *mark)
+{
+    ctx->source.pos = mark->pos;
+    ctx->current_line = mark->line;
+    ctx->current_token = mark->token;
+    ctx->source_exhausted = 0;
+}
+
+int ctx_token_column(const ParserContext *ctx, Token token)
+{
+    return source_column(&ctx->source, token.offset);
+}
+
+// -------------------------------------------------------------------------
+// Legacy API: the default context, mirrored into current_token/current_line
+// -------------------------------------------------------------------------
+
+// Pick up globals the caller may have reset (e.g. current_line = 1)
+static ParserContext* legacy_enter(void)
+{
+    ParserContext *ctx = parser_context_default();
+
+    ctx->current_token = current_token;
+    ctx->current_line = current_line;
+    return ctx;
+}
+
+static void legacy_leave(const ParserContext *ctx)
+{
+    current_token = ctx->current_token;
+    current_line = ctx->current_line;
+}
+
+// Make sure the lexer scans the given stream; loads it on first use
+static void bind_input(ParserContext *ctx, FILE *input)
+{
+    if (!input) {
+        return; // Keep scanning the buffer installed by lexer_begin_memory
+    }
+    if (input != ctx->bound_input || ctx->source_exhausted) {
+        ctx_lexer_begin(ctx, input);
+    }
+}
+
 // Get the next token and update current_token
 void advance(FILE *input)
 {
@@ -40,219 +201,363 @@ int consume(FILE *input, TokenType type)
     return 0;
 }
 
-// Check if a string is a keyword
-int is_keyword(const char *str)
+int lexer_begin(FILE *input)
 {
+    return ctx_lexer_begin(parser_context_default(), input);
+}
 
-    int keyword_idx = 0;
-    for (keyword_idx = 0; keywords[keyword_idx] != NULL; keyword_idx++) {
-        if (strcmp(str, keywords[keyword_idx]) == 0) {
-            return 1;
-        }
-    }
-    return 0;
+void lexer_begin_memory(const char *data, size_t length)
+{
+    ctx_lexer_begin_memory(parser_context_default(), data, length);
+}
+
+void lexer_end(void)
+{
+    ctx_lexer_end(parser_context_default());
+}
+
+const SourceBuffer* lexer_source(void)
+{
+    return &parser_context_default()->source;
+}
+
+LexerMark lexer_mark(void)
+{
+    return ctx_lexer_mark(legacy_enter());
+}
+
+void lexer_reset_to(const LexerMark *mark)
+{
+    ParserContext *ctx = parser_context_default();
+
+    ctx_lexer_reset_to(ctx, mark);
+    legacy_leave(ctx);
 }
 
 // Get the next token from input
 Token get_next_token(FILE *input)
 {
-    
-    Token token = {0};
-    int current_char = 0;        // Current character being read
-    int lookahead_char = 0;      // Lookahead character for multi-char tokens
-    int value_idx = 0;           // Index for building token value string
-    int prev = 0;
+    ParserContext *ctx = legacy_enter();
+
+    bind_input(ctx, input);
+    ctx_advance(ctx);
+    current_line = ctx->current_line;
+    return ctx->current_token;
+}
 
-    token.line = current_line; // Track line at start of token
+_Static_assert(sizeof(Token) == 16, "Token is expected to stay 16 bytes");
 
-    // Skip whitespace
-    while ((current_char = fgetc(input)) != EOF && isspace(current_char)) {
-        if (current_char == '\n') {
-            current_line++; // Increment line on newline
+int token_column(Token token)
+{
+    return ctx_token_column(parser_context_default(), token);
+}
+
+// Scan the next token using the legacy line counter
+Token lexer_next_token(SourceBuffer *source)
+{
+    return lexer_scan(source, &current_line);
+}
+
+// Character classes of the lexer, one table lookup per byte instead of the
+// locale-aware <ctype.h> calls. Bytes outside ASCII have no class.
+#define LEX_BLANK 0x01      // Whitespace other than '\n'
+#define LEX_NEWLINE 0x02
+#define LEX_IDENT_START 0x04
+#define LEX_IDENT 0x08      // Letters, digits and '_'
+#define LEX_NUMBER 0x10     // Digits and '.', the body of a number
+#define LEX_DIGIT_ONLY 0x20
+
+#define LEX_SPACE (LEX_BLANK | LEX_NEWLINE)
+#define LEX_LETTER (LEX_IDENT_START | LEX_IDENT)
+#define LEX_DIGIT (LEX_IDENT | LEX_NUMBER | LEX_DIGIT_ONLY)
+
+#define lex_class(c) (s_char_class[(unsigned char)(c)])
+
+static const uint8_t s_char_class[UCHAR_MAX + 1] = {
+    ['a'] = LEX_LETTER, ['b'] = LEX_LETTER, ['c'] = LEX_LETTER, ['d'] = LEX_LETTER,
+    ['e'] = LEX_LETTER, ['f'] = LEX_LETTER, ['g'] = LEX_LETTER, ['h'] = LEX_LETTER,
+    ['i'] = LEX_LETTER, ['j'] = LEX_LETTER, ['k'] = LEX_LETTER, ['l'] = LEX_LETTER,
+    ['m'] = LEX_LETTER, ['n'] = LEX_LETTER, ['o'] = LEX_LETTER, ['p'] = LEX_LETTER,
+    ['q'] = LEX_LETTER, ['r'] = LEX_LETTER, ['s'] = LEX_LETTER, ['t'] = LEX_LETTER,
+    ['u'] = LEX_LETTER, ['v'] = LEX_LETTER, ['w'] = LEX_LETTER, ['x'] = LEX_LETTER,
+    ['y'] = LEX_LETTER, ['z'] = LEX_LETTER,
+    ['A'] = LEX_LETTER, ['B'] = LEX_LETTER, ['C'] = LEX_LETTER, ['D'] = LEX_LETTER,
+    ['E'] = LEX_LETTER, ['F'] = LEX_LETTER, ['G'] = LEX_LETTER, ['H'] = LEX_LETTER,
+    ['I'] = LEX_LETTER, ['J'] = LEX_LETTER, ['K'] = LEX_LETTER, ['L'] = LEX_LETTER,
+    ['M'] = LEX_LETTER, ['N'] = LEX_LETTER, ['O'] = LEX_LETTER, ['P'] = LEX_LETTER,
+    ['Q'] = LEX_LETTER, ['R'] = LEX_LETTER, ['S'] = LEX_LETTER, ['T'] = LEX_LETTER,
+    ['U'] = LEX_LETTER, ['V'] = LEX_LETTER, ['W'] = LEX_LETTER, ['X'] = LEX_LETTER,
+    ['Y'] = LEX_LETTER, ['Z'] = LEX_LETTER,
+    ['_'] = LEX_LETTER,
+    ['0'] = LEX_DIGIT, ['1'] = LEX_DIGIT, ['2'] = LEX_DIGIT, ['3'] = LEX_DIGIT, ['4'] = LEX_DIGIT,
+    ['5'] = LEX_DIGIT, ['6'] = LEX_DIGIT, ['7'] = LEX_DIGIT, ['8'] = LEX_DIGIT, ['9'] = LEX_DIGIT,
+    ['.'] = LEX_NUMBER,
+    [' '] = LEX_BLANK, ['\t'] = LEX_BLANK, ['\r'] = LEX_BLANK, ['\v'] = LEX_BLANK, ['\f'] = LEX_BLANK,
+    ['\n'] = LEX_NEWLINE,
+};
+
+// Operator and punctuation scanner: a two-state DFA per first byte. The
+// entry gives the one-character token and the bytes that extend it to a
+// two-character operator; every state is accepting and nothing is longer
+// than two bytes. Bytes without an entry scan as one-character operators
+// whose lexeme is interned.
+typedef struct {
+    uint8_t type;           // TokenType of the one-character token
+    uint8_t id;             // Its predefined intern id
+    char next[2];           // Second bytes that extend it ('\0' if unused)
+    uint8_t next_id[2];     // Predefined ids of the two-character operators
+} OperatorState;
+
+_Static_assert(INTERN_PREDEFINED_END <= UINT8_MAX, "operator ids must fit OperatorState");
+
+static const OperatorState s_operator_states[UCHAR_MAX + 1] = {
+    [';'] = { TOKEN_SEMICOLON, INTERN_PUNCT_SEMICOLON, { 0 }, { 0 } },
+    ['('] = { TOKEN_PARENTHESIS_OPEN, INTERN_PUNCT_PAREN_OPEN, { 0 }, { 0 } },
+    [')'] = { TOKEN_PARENTHESIS_CLOSE, INTERN_PUNCT_PAREN_CLOSE, { 0 }, { 0 } },
+    ['{'] = { TOKEN_BRACE_OPEN, INTERN_PUNCT_BRACE_OPEN, { 0 }, { 0 } },
+    ['}'] = { TOKEN_BRACE_CLOSE, INTERN_PUNCT_BRACE_CLOSE, { 0 }, { 0 } },
+    ['['] = { TOKEN_BRACKET_OPEN, INTERN_PUNCT_BRACKET_OPEN, { 0 }, { 0 } },
+    [']'] = { TOKEN_BRACKET_CLOSE, INTERN_PUNCT_BRACKET_CLOSE, { 0 }, { 0 } },
+    [','] = { TOKEN_COMMA, INTERN_PUNCT_COMMA, { 0 }, { 0 } },
+    ['='] = { TOKEN_OPERATOR, INTERN_OP_ASSIGN, { '=' }, { INTERN_OP_EQUAL } },
+    ['!'] = { TOKEN_OPERATOR, INTERN_OP_LOGICAL_NOT, { '=' }, { INTERN_OP_NOT_EQUAL } },
+    ['<'] = { TOKEN_OPERATOR, INTERN_OP_LESS, { '=', '<' }, { INTERN_OP_LESS_EQUAL, INTERN_OP_SHIFT_LEFT } },
+    ['>'] = { TOKEN_OPERATOR, INTERN_OP_GREATER, { '=', '>' },
+              { INTERN_OP_GREATER_EQUAL, INTERN_OP_SHIFT_RIGHT } },
+    ['&'] = { TOKEN_OPERATOR, INTERN_OP_BITWISE_AND, { '&' }, { INTERN_OP_LOGICAL_AND } },
+    ['|'] = { TOKEN_OPERATOR, INTERN_OP_BITWISE_OR, { '|' }, { INTERN_OP_LOGICAL_OR } },
+    ['+'] = { TOKEN_OPERATOR, INTERN_OP_PLUS, { '+' }, { INTERN_OP_INCREMENT } },
+    ['-'] = { TOKEN_OPERATOR, INTERN_OP_MINUS, { '-' }, { INTERN_OP_DECREMENT } },
+    ['*'] = { TOKEN_OPERATOR, INTERN_OP_MULTIPLY, { 0 }, { 0 } },
+    ['/'] = { TOKEN_OPERATOR, INTERN_OP_DIVIDE, { 0 }, { 0 } },
+    ['%'] = { TOKEN_OPERATOR, INTERN_OP_MODULO, { 0 }, { 0 } },
+    ['^'] = { TOKEN_OPERATOR, INTERN_OP_BITWISE_XOR, { 0 }, { 0 } },
+    ['~'] = { TOKEN_OPERATOR, INTERN_OP_BITWISE_NOT, { 0 }, { 0 } },
+    ['.'] = { TOKEN_OPERATOR, INTERN_OP_DOT, { 0 }, { 0 } },
+};
+
+#define PRAGMA_DIRECTIVE_LENGTH 6 // strlen("pragma")
+
+// Helper: "pragma" followed by a blank or the end of the line
+static int is_pragma_directive(const char *directive, const char *end)
+{
+    if (end - directive < PRAGMA_DIRECTIVE_LENGTH ||
+        strncmp(directive, "pragma", PRAGMA_DIRECTIVE_LENGTH) != 0) {
+        return 0;
+    }
+    directive += PRAGMA_DIRECTIVE_LENGTH;
+    return directive == end || (lex_class(*directive) & LEX_SPACE);
+}
+
+#define BIT_INT_KEYWORD_LENGTH 7  // strlen("_BitInt")
+#define UNSIGNED_KEYWORD_LENGTH 8 // strlen("unsigned")
+
+// Helper: skip blanks (not newlines, so line counting stays with the caller)
+static const char* skip_blanks(const char *cursor, const char *end)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t')) {
+        cursor++;
+    }
+    return cursor;
+}
+
+// Helper: the next '\n' at or after cursor, or end if there is none
+static const char* line_end(const char *cursor, const char *end)
+{
+    const char *newline = cursor < end ? memchr(cursor, '\n', (size_t)(end - cursor)) : NULL;
+
+    return newline ? newline : end;
+}
+
+// Helper: newlines in [cursor, end), found with memchr so long comments are
+// scanned a vector at a time by the C library
+static int count_newlines(const char *cursor, const char *end)
+{
+    int count = 0;
+
+    while (cursor < end && (cursor = memchr(cursor, '\n', (size_t)(end - cursor))) != NULL) {
+        count++;
+        cursor++;
+    }
+    return count;
+}
+
+// Helper: end of the block comment whose body starts at body: past the first
+// "*/" inside the body, or end if it is unterminated
+static const char* skip_block_comment(const char *body, const char *end)
+{
+    const char *star = body;
+
+    while (star < end && (star = memchr(star, '*', (size_t)(end - star))) != NULL) {
+        if (star + 1 < end && star[1] == '/') {
+            return star + 2;
         }
+        star++;
     }
-    if (current_char == EOF) {
-        token.type = TOKEN_EOF;
-        token.value[0] = '\0';
-        return token;
+    return end;
+}
+
+// Helper: "_BitInt(N)" at cursor, interned as the intN_t / uintN_t type it
+// stands for. Returns the end of the type, or NULL if it is not one.
+static const char* scan_bit_int(const char *cursor, const char *end, int is_signed, InternId *id)
+{
+    char type_name[sizeof("uint64_t")];
+    int width = 0;
+
+    if (end - cursor < BIT_INT_KEYWORD_LENGTH ||
+        strncmp(cursor, "_BitInt", BIT_INT_KEYWORD_LENGTH) != 0) {
+        return NULL;
+    }
+    cursor = skip_blanks(cursor + BIT_INT_KEYWORD_LENGTH, end);
+    if (cursor >= end || *cursor != '(') {
+        return NULL;
+    }
+    cursor = skip_blanks(cursor + 1, end);
+    while (cursor < end && (lex_class(*cursor) & LEX_DIGIT_ONLY) && width <= CTYPE_MAX_EXPLICIT_WIDTH) {
+        width = width * 10 + (*cursor - '0');
+        cursor++;
+    }
+    cursor = skip_blanks(cursor, end);
+    if (width < 1 || width > CTYPE_MAX_EXPLICIT_WIDTH || cursor >= end || *cursor != ')') {
+        return NULL;
     }
+    snprintf(type_name, sizeof(type_name), "%sint%d_t", is_signed ? "" : "u", width);
+    *id = intern_cstr(type_name);
+    return cursor + 1;
+}
 
-    // Handle comments starting with // or /* */
-    if (current_char == '/') {
-        lookahead_char = fgetc(input);
-        if (lookahead_char == '/') {
-            // Line comment
-            while ((current_char = fgetc(input)) != EOF && current_char != '\n');
-            if (current_char == '\n') {
-                current_line++; // Increment line on comment newline
-            }
-            return get_next_token(input);
-        } else if (lookahead_char == '*') {
-            // Block comment
-            prev = 0;
-            while ((current_char = fgetc(input)) != EOF) {
-                if (current_char == '\n') {
-                    current_line++;
-                }
-                if (prev == '*' && current_char == '/') {
-                    break;
-                }
-                prev = current_char;
+// Scan the next token from a source buffer using pointer arithmetic
+Token lexer_scan(SourceBuffer *source, int *line)
+{
+    Token token = {0};
+    const char *base = source->data;
+    const char *cursor = base + source->pos;
+    const char *end = base + source->length;
+    const char *start = NULL;
+    const OperatorState *state = NULL;
+    uint8_t char_class = 0;
+
+    for (;;) {
+        // Skip whitespace
+        while (cursor < end && (lex_class(*cursor) & LEX_SPACE)) {
+            if (*cursor == '\n') {
+                (*line)++; // Increment line on newline
             }
-            return get_next_token(input);
-        } else {
-            // It's just the division operator
-            if (lookahead_char != EOF) {
-                ungetc(lookahead_char, input);
+            cursor++;
+        }
+
+        // Handle comments starting with // or /* */
+        if (cursor + 1 < end && cursor[0] == '/' && cursor[1] == '/') {
+            // Line comment (the newline is consumed by the whitespace loop)
+            cursor = line_end(cursor + 2, end);
+            continue;
+        }
+        if (cursor + 1 < end && cursor[0] == '/' && cursor[1] == '*') {
+            // Block comment; the closing '*' must follow the opening "/*"
+            const char *comment_end = skip_block_comment(cursor + 2, end);
+
+            *line += count_newlines(cursor + 2, comment_end);
+            cursor = comment_end;
+            continue;
+        }
+        if (cursor < end && *cursor == '#') {
+            // #pragma is scanned as a token below; other directives are skipped
+            const char *directive = skip_blanks(cursor + 1, end);
+
+            if (is_pragma_directive(directive, end)) {
+                break;
             }
-            token.type = TOKEN_OPERATOR;
-            token.value[0] = '/';
-            token.value[1] = '\0';
-            return token;
+            cursor = line_end(cursor, end);
+            continue;
         }
+        break;
     }
 
+    token.line = (uint32_t)*line; // Track line at start of token
+    token.offset = (uint32_t)(cursor - base);
+
+    if (cursor >= end) {
+        source->pos = source->length;
+        token.type = TOKEN_EOF;
+        token.id = INTERN_NONE;
+        return token;
+    }
+
+    start = cursor;
+    char_class = lex_class(*cursor);
+
+    // Pragma: the rest of the line, without "#pragma" and surrounding blanks
+    if (*cursor == '#') {
+        const char *text = NULL;
+
+        cursor = skip_blanks(cursor + 1, end) + PRAGMA_DIRECTIVE_LENGTH;
+        text = skip_blanks(cursor, end);
+        cursor = line_end(text, end);
+        while (cursor > text && (lex_class(cursor[-1]) & LEX_SPACE)) {
+            cursor--;
+        }
+        token.id = intern_string(text, (size_t)(cursor - text));
+        token.type = TOKEN_PRAGMA;
+    }
     // Identifier or keyword
-    if (isalpha(current_char) || current_char == '_') {
-        value_idx = 0;
-        token.value[value_idx++] = current_char;
-        while ((current_char = fgetc(input)) != EOF && (isalnum(current_char) || current_char == '_')) {
-            if (value_idx < 255) {
-                token.value[value_idx++] = current_char;
-            }
+    else if (char_class & LEX_IDENT_START) {
+        const char *type_end = NULL;
+        InternId type_id = INTERN_NONE;
+
+        cursor++;
+        while (cursor < end && (lex_class(*cursor) & LEX_IDENT)) {
+            cursor++;
         }
-        token.value[value_idx] = '\0';
-        if (current_char != EOF) {
-            ungetc(current_char, input);
+
+        // Explicit-width integers: intN_t, uintN_t and [unsigned] _BitInt(N),
+        // the latter folded into one token spelled as the matching intN_t
+        if (cursor - start == UNSIGNED_KEYWORD_LENGTH && strncmp(start, "unsigned", UNSIGNED_KEYWORD_LENGTH) == 0) {
+            type_end = scan_bit_int(skip_blanks(cursor, end), end, 0, &type_id);
+        } else if (cursor - start == BIT_INT_KEYWORD_LENGTH) {
+            type_end = scan_bit_int(start, end, 1, &type_id);
         }
-        token.type = is_keyword(token.value) ? TOKEN_KEYWORD : TOKEN_IDENTIFIER;
-        return token;
-    } 
-    // Number
-    else if (isdigit(current_char)) {
-        value_idx = 0;
-        token.value[value_idx++] = current_char;
-        while ((current_char = fgetc(input)) != EOF && (isdigit(current_char) || current_char == '.')) {
-            if (value_idx < 255) {
-                token.value[value_idx++] = current_char;
-            }
+        if (type_end != NULL) {
+            cursor = type_end;
+            token.id = type_id;
+            token.type = TOKEN_KEYWORD;
+        } else if ((token.id = keyword_id(start, (size_t)(cursor - start))) != INTERN_NONE) {
+            token.type = TOKEN_KEYWORD;
+        } else {
+            token.id = intern_string(start, (size_t)(cursor - start));
+            token.type = ctype_explicit_width(token_text(token), NULL) > 0 ? TOKEN_KEYWORD : TOKEN_IDENTIFIER;
         }
-        token.value[value_idx] = '\0';
-        if (current_char != EOF) {
-            ungetc(current_char, input);
+    }
+    // Number
+    else if (char_class & LEX_DIGIT_ONLY) {
+        cursor++;
+        while (cursor < end && (lex_class(*cursor) & LEX_NUMBER)) {
+            cursor++;
         }
+        token.id = intern_string(start, (size_t)(cursor - start));
         token.type = TOKEN_NUMBER;
-        return token;
-    } 
+    }
     // Operators and punctuation (including multi-char ops)
     else {
-        lookahead_char = fgetc(input);
-        token.value[0] = (char)current_char;
-        token.value[1] = '\0';
-        token.value[2] = '\0';
-        // Punctuation
-        switch (current_char) {
-            case ';':
-                token.type = TOKEN_SEMICOLON;
-                if (lookahead_char != EOF) {
-                    ungetc(lookahead_char, input);
-                }
-                return token;
-            case '(':
-                token.type = TOKEN_PARENTHESIS_OPEN;
-                if (lookahead_char != EOF) {
-                    ungetc(lookahead_char, input);
-                }
-                return token;
-            case ')':
-                token.type = TOKEN_PARENTHESIS_CLOSE;
-                if (lookahead_char != EOF) {
-                    ungetc(lookahead_char, input);
-                }
-                return token;
-            case '{':
-                token.type = TOKEN_BRACE_OPEN;
-                if (lookahead_char != EOF) {
-                    ungetc(lookahead_char, input);
-                }
-                return token;
-            case '}':
-                token.type = TOKEN_BRACE_CLOSE;
-                if (lookahead_char != EOF) {
-                    ungetc(lookahead_char, input);
-                }
-                return token;
-            case '[':
-                token.type = TOKEN_BRACKET_OPEN;
-                if (lookahead_char != EOF) {
-                    ungetc(lookahead_char, input);
-                }
-                return token;
-            case ']':
-                token.type = TOKEN_BRACKET_CLOSE;
-                if (lookahead_char != EOF) {
-                    ungetc(lookahead_char, input);
-                }
-                return token;
-            case ',':
-                token.type = TOKEN_COMMA;
-                if (lookahead_char != EOF) {
-                    ungetc(lookahead_char, input);
-                }
-                return token;
-            default:
-                break;
-        }
-        // Multi-character operators: ==, !=, <=, >=, <<, >>, &&, ||, ++, --
-        token.type = TOKEN_OPERATOR;
-        if (current_char == '=' && lookahead_char == '=') {
-            token.value[0] = '=';
-            token.value[1] = '=';
-            token.value[2] = '\0';
-        } else if (current_char == '!' && lookahead_char == '=') {
-            token.value[0] = '!';
-            token.value[1] = '=';
-            token.value[2] = '\0';
-        } else if (current_char == '<' && lookahead_char == '=') {
-            token.value[0] = '<';
-            token.value[1] = '=';
-            token.value[2] = '\0';
-        } else if (current_char == '>' && lookahead_char == '=') {
-            token.value[0] = '>';
-            token.value[1] = '=';
-            token.value[2] = '\0';
-        } else if (current_char == '<' && lookahead_char == '<') {
-            token.value[0] = '<';
-            token.value[1] = '<';
-            token.value[2] = '\0';
-        } else if (current_char == '>' && lookahead_char == '>') {
-            token.value[0] = '>';
-            token.value[1] = '>';
-            token.value[2] = '\0';
-        } else if (current_char == '&' && lookahead_char == '&') {
-            token.value[0] = '&';
-            token.value[1] = '&';
-            token.value[2] = '\0';
-        } else if (current_char == '|' && lookahead_char == '|') {
-            token.value[0] = '|';
-            token.value[1] = '|';
-            token.value[2] = '\0';
-        } else if (current_char == '+' && lookahead_char == '+') {
-            token.value[0] = '+';
-            token.value[1] = '+';
-            token.value[2] = '\0';
-        } else if (current_char == '-' && lookahead_char == '-') {
-            token.value[0] = '-';
-            token.value[1] = '-';
-            token.value[2] = '\0';
+        state = &s_operator_states[(unsigned char)*cursor++];
+        if (state->id == INTERN_NONE) {
+            token.type = TOKEN_OPERATOR;
+            token.id = intern_string(start, 1);
         } else {
-            // Single-character operator
-            if (lookahead_char != EOF) {
-                ungetc(lookahead_char, input);
+            token.type = state->type;
+            token.id = state->id;
+            if (cursor < end && *cursor != '\0') {
+                if (*cursor == state->next[0]) {
+                    token.id = state->next_id[0];
+                    cursor++;
+                } else if (*cursor == state->next[1]) {
+                    token.id = state->next_id[1];
+                    cursor++;
+                }
             }
-            token.value[0] = (char)current_char;
-            token.value[1] = '\0';
         }
-        return token;
     }
+
+    token.length = (uint32_t)(cursor - start);
+    source->pos = (size_t)(cursor - base);
+    return token;
 }
@@ -1,49 +1,57 @@
 #include <string.h>
 #include <ctype.h>
 #include "symbol_arrays.h"
+#include "parser_context.h"
 
-ArrayInfo g_arrays[128];
-int g_array_count = 0;
-
-int find_array_size(const char *name)
+int array_table_size(const SymbolTable *arrays, const char *name)
 {
 
-    int array_idx = 0;
+    int size = -1;
+
     if (!name) {
         return -1;
     }
 
-    for (array_idx = 0; array_idx < g_array_count; array_idx++) {
-        if (strcmp(g_arrays[array_idx].name, name) == 0) {
-            return g_arrays[array_idx].size;
-        }
+    // Names never interned cannot have been registered
+    if (!symbol_lookup(arrays, intern_find(name, strlen(name)), &size)) {
+        return -1;
     }
 
-    return -1;
+    return size;
 }
 
-void register_array(const char *name, int size)
+void array_table_register(SymbolTable *arrays, const char *name, int size)
 {
 
-    int array_idx = 0;
-
     if (!name || size <= 0) {
         return;
     }
-    if (g_array_count >= (int)(sizeof(g_arrays) / sizeof(g_arrays[0]))) {
-        return;
-    }
 
-    // Prevent duplicates; update size if already present
-    for (array_idx = 0; array_idx < g_array_count; array_idx++) {
-        if (strcmp(g_arrays[array_idx].name, name) == 0) {
-            g_arrays[array_idx].size = size;
-            return;
-        }
-    }
+    // Redeclaring in the same scope updates the size
+    symbol_define(arrays, intern_cstr(name), size);
+}
 
-    strncpy(g_arrays[g_array_count].name, name, sizeof(g_arrays[g_array_count].name) - 1);
-    g_arrays[g_array_count].name[sizeof(g_arrays[g_array_count].name) - 1] = '\0';
-    g_arrays[g_array_count].size = size;
-    g_array_count++;
+int find_array_size(const char *name)
+{
+    return array_table_size(&parser_context_current()->arrays, name);
+}
+
+void register_array(const char *name, int size)
+{
+    array_table_register(&parser_context_current()->arrays, name, size);
+}
+
+void array_scope_push(void)
+{
+    symbol_scope_push(&parser_context_current()->arrays);
+}
+
+void array_scope_pop(void)
+{
+    symbol_scope_pop(&parser_context_current()->arrays);
+}
+
+void reset_array_symbols(void)
+{
+    symbol_table_clear(&parser_context_current()->arrays);
 }
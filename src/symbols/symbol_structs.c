@@ -1,47 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "symbol_structs.h"
+#include "parser_context.h"
+#include "utils.h"
 
-// Definition of global struct table
-StructInfo g_structs[64];
-int g_struct_count = 0;
+#define INITIAL_STRUCT_CAPACITY 16
+#define INITIAL_FIELD_CAPACITY 8
 
-int find_struct_index(const char *name)
+int struct_table_register(StructTable *table, const char *name)
 {
-    int struct_idx = 0;
+    InternId name_id = INTERN_NONE;
+    StructInfo *struct_info = NULL;
+    int struct_idx = -1;
 
     if (!name) {
         return -1;
     }
 
-    for (struct_idx = 0; struct_idx < g_struct_count; struct_idx++) {
-        if (strcmp(g_structs[struct_idx].name, name) == 0) {
-            return struct_idx;
-        }
+    name_id = intern_cstr(name);
+
+    // A redefinition starts over with an empty field list
+    if (symbol_lookup(&table->index, name_id, &struct_idx)) {
+        struct_info = &table->items[struct_idx];
+        struct_info->field_count = 0;
+        symbol_table_clear(&struct_info->field_lookup);
+        return struct_idx;
+    }
+
+    if (table->count >= table->capacity) {
+        table->items = (StructInfo*)grow_array(table->items, &table->capacity,
+                                               INITIAL_STRUCT_CAPACITY, sizeof(StructInfo));
     }
 
-    return -1;
+    struct_idx = table->count++;
+    struct_info = &table->items[struct_idx];
+    struct_info->name = intern_text(name_id);
+    struct_info->fields = NULL;
+    struct_info->field_count = 0;
+    struct_info->field_capacity = 0;
+    symbol_table_init(&struct_info->field_lookup);
+    symbol_define(&table->index, name_id, struct_idx);
+    return struct_idx;
 }
 
-const char* struct_field_type(const char *struct_name, const char *field_name)
+void struct_table_add_field(StructTable *table, int struct_index,
+                            const char *field_name, const char *field_type)
 {
-    int idx = -1;
-    int field_index = 0;
+    StructInfo *struct_info = NULL;
+    InternId field_id = INTERN_NONE;
 
-    if (!struct_name || !field_name) {
+    if (struct_index < 0 || struct_index >= table->count || !field_name || !field_type) {
+        return;
+    }
+
+    struct_info = &table->items[struct_index];
+    if (struct_info->field_count >= struct_info->field_capacity) {
+        struct_info->fields = (StructField*)grow_array(struct_info->fields, &struct_info->field_capacity,
+                                                       INITIAL_FIELD_CAPACITY, sizeof(StructField));
+    }
+
+    field_id = intern_cstr(field_name);
+    struct_info->fields[struct_info->field_count].field_name = intern_text(field_id);
+    struct_info->fields[struct_info->field_count].field_type = intern_text(intern_cstr(field_type));
+    symbol_define(&struct_info->field_lookup, field_id, struct_info->field_count);
+    struct_info->field_count++;
+}
+
+int struct_table_find(const StructTable *table, InternId name)
+{
+    int struct_idx = -1;
+
+    if (!symbol_lookup(&table->index, name, &struct_idx)) {
+        return -1;
+    }
+    return struct_idx;
+}
+
+const StructInfo* struct_table_at(const StructTable *table, int struct_index)
+{
+    if (struct_index < 0 || struct_index >= table->count) {
         return NULL;
     }
+    return &table->items[struct_index];
+}
 
-    idx = find_struct_index(struct_name);
+const char* struct_table_field_type(const StructTable *table, InternId struct_name,
+                                    InternId field_name)
+{
+    const StructInfo *struct_info = struct_table_at(table, struct_table_find(table, struct_name));
+    int field_index = 0;
 
-    if (idx < 0) {
+    if (!struct_info || !symbol_lookup(&struct_info->field_lookup, field_name, &field_index)) {
         return NULL;
     }
+    return struct_info->fields[field_index].field_type;
+}
+
+void struct_table_reset(StructTable *table)
+{
+    int struct_idx = 0;
+
+    for (struct_idx = 0; struct_idx < table->count; struct_idx++) {
+        free(table->items[struct_idx].fields);
+        symbol_table_free(&table->items[struct_idx].field_lookup);
+    }
+    table->count = 0;
+    symbol_table_clear(&table->index);
+}
+
+void struct_table_free(StructTable *table)
+{
+    struct_table_reset(table);
+    free(table->items);
+    symbol_table_free(&table->index);
+    table->items = NULL;
+    table->capacity = 0;
+}
+
+int register_struct(const char *name)
+{
+    return struct_table_register(&parser_context_current()->structs, name);
+}
+
+void add_struct_field(int struct_index, const char *field_name, const char *field_type)
+{
+    struct_table_add_field(&parser_context_current()->structs, struct_index, field_name, field_type);
+}
+
+void reset_struct_symbols(void)
+{
+    struct_table_reset(&parser_context_current()->structs);
+}
+
+int struct_count(void)
+{
+    return parser_context_current()->structs.count;
+}
+
+const StructInfo* struct_info_at(int struct_index)
+{
+    return struct_table_at(&parser_context_current()->structs, struct_index);
+}
+
+int find_struct_index_id(InternId name)
+{
+    return struct_table_find(&parser_context_current()->structs, name);
+}
+
+int find_struct_index(const char *name)
+{
+    if (!name) {
+        return -1;
+    }
+
+    return find_struct_index_id(intern_find(name, strlen(name)));
+}
 
-    for (field_index = 0; field_index < g_structs[idx].field_count; field_index++) {
-        if (strcmp(g_structs[idx].fields[field_index].field_name, field_name) == 0) {
-            return g_structs[idx].fields[field_index].field_type;
-        }
+const char* struct_field_type(const char *struct_name, const char *field_name)
+{
+    if (!struct_name || !field_name) {
+        return NULL;
     }
 
-    return NULL;
+    return struct_table_field_type(&parser_context_current()->structs,
+                                   intern_find(struct_name, strlen(struct_name)),
+                                   intern_find(field_name, strlen(field_name)));
 }
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "symbol_table.h"
+#include "utils.h"
+
+#define SYMBOL_INITIAL_SLOTS 64
+#define SYMBOL_INITIAL_BINDINGS 32
+#define SYMBOL_INITIAL_SCOPES 8
+
+// Integer hash for intern ids (ids are dense, so spread them out)
+static unsigned int hash_id(InternId name)
+{
+    unsigned int hash = name * 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+// Slot holding name, or the empty slot where it belongs
+static int find_slot(const SymbolTable *table, InternId name)
+{
+    int mask = table->slot_count - 1;
+    int slot = (int)(hash_id(name) & (unsigned int)mask);
+
+    while (table->slot_names[slot] != INTERN_NONE && table->slot_names[slot] != name) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static void rehash(SymbolTable *table)
+{
+    InternId *old_names = table->slot_names;
+    int *old_bindings = table->slot_bindings;
+    int old_count = table->slot_count;
+    int slot_idx = 0;
+
+    table->slot_count = old_count ? old_count * 2 : SYMBOL_INITIAL_SLOTS;
+    table->slot_names = (InternId*)calloc((size_t)table->slot_count, sizeof(InternId));
+    table->slot_bindings = (int*)xrealloc(NULL, (size_t)table->slot_count * sizeof(int));
+    if (!table->slot_names) {
+        perror("Failed to allocate memory for symbol table");
+        exit(EXIT_FAILURE);
+    }
+
+    for (slot_idx = 0; slot_idx < old_count; slot_idx++) {
+        if (old_names[slot_idx] != INTERN_NONE) {
+            int slot = find_slot(table, old_names[slot_idx]);
+            table->slot_names[slot] = old_names[slot_idx];
+            table->slot_bindings[slot] = old_bindings[slot_idx];
+        }
+    }
+
+    free(old_names);
+    free(old_bindings);
+}
+
+void symbol_table_init(SymbolTable *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+void symbol_table_free(SymbolTable *table)
+{
+    free(table->bindings);
+    free(table->slot_names);
+    free(table->slot_bindings);
+    free(table->scope_marks);
+    symbol_table_init(table);
+}
+
+void symbol_table_clear(SymbolTable *table)
+{
+    if (table->slot_names) {
+        memset(table->slot_names, 0, (size_t)table->slot_count * sizeof(InternId));
+    }
+    table->used_slots = 0;
+    table->binding_count = 0;
+    table->scope_depth = 0;
+}
+
+void symbol_scope_push(SymbolTable *table)
+{
+    if (table->scope_depth >= table->scope_capacity) {
+        table->scope_marks = (int*)grow_array(table->scope_marks, &table->scope_capacity,
+                                               SYMBOL_INITIAL_SCOPES, sizeof(int));
+    }
+    table->scope_marks[table->scope_depth++] = table->binding_count;
+}
+
+void symbol_scope_pop(SymbolTable *table)
+{
+    int mark = 0;
+
+    if (table->scope_depth <= 0) {
+        return;
+    }
+
+    mark = table->scope_marks[--table->scope_depth];
+    while (table->binding_count > mark) {
+        SymbolBinding *binding = &table->bindings[--table->binding_count];
+        table->slot_bindings[find_slot(table, binding->name)] = binding->shadowed;
+    }
+}
+
+void symbol_define(SymbolTable *table, InternId name, int value)
+{
+    SymbolBinding *binding = NULL;
+    int slot = 0;
+    int visible = -1;
+
+    if (name == INTERN_NONE) {
+        return;
+    }
+
+    // Keep the load factor below one half
+    if ((table->used_slots + 1) * 2 > table->slot_count) {
+        rehash(table);
+    }
+
+    slot = find_slot(table, name);
+    if (table->slot_names[slot] == INTERN_NONE) {
+        table->slot_names[slot] = name;
+        table->slot_bindings[slot] = -1;
+        table->used_slots++;
+    }
+
+    visible = table->slot_bindings[slot];
+    if (visible >= 0 && table->bindings[visible].scope_depth == table->scope_depth) {
+        table->bindings[visible].value = value;
+        return;
+    }
+
+    if (table->binding_count >= table->binding_capacity) {
+        table->bindings = (SymbolBinding*)grow_array(table->bindings, &table->binding_capacity,
+                                                      SYMBOL_INITIAL_BINDINGS, sizeof(SymbolBinding));
+    }
+
+    binding = &table->bindings[table->binding_count];
+    binding->name = name;
+    binding->value = value;
+    binding->scope_depth = table->scope_depth;
+    binding->shadowed = visible;
+    table->slot_bindings[slot] = table->binding_count++;
+}
+
+int symbol_lookup(const SymbolTable *table, InternId name, int *value)
+{
+    int slot = 0;
+    int binding_idx = -1;
+
+    if (name == INTERN_NONE || table->slot_count == 0) {
+        return 0;
+    }
+
+    slot = find_slot(table, name);
+    if (table->slot_names[slot] == INTERN_NONE) {
+        return 0;
+    }
+
+    binding_idx = table->slot_bindings[slot];
+    if (binding_idx < 0) {
+        return 0;
+    }
+    if (value) {
+        *value = table->bindings[binding_idx].value;
+    }
+    return 1;
+}
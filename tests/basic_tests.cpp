@@ -1,18 +1,26 @@
 #include <gtest/gtest.h>
 extern "C" {
 #include "astnode.h"
+#include "arena.h"
 #include "parse.h"
 #include "token.h"
 #include "utils.h"
 #include "symbol_arrays.h"
+#include "symbol_structs.h"
+#include "parser_context.h"
+#include "codegen_vhdl.h"
+#include "output_buffer.h"
+#include "ast_image.h"
 }
 #include <cstdio>
 #include <cstring>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Provide externs for internal globals needed by tests
 extern "C" {
-    extern int g_array_count; // declared in utils.c
     extern Token current_token; // defined in token.c
 }
 
@@ -45,9 +53,66 @@ TEST(ASTNodeTests, DynamicChildGrowth) {
     free_node(parent);
 }
 
+// Test that arena-owned trees grow child vectors and copy node values
+TEST(ASTNodeTests, ArenaOwnedTree) {
+    Arena arena;
+    arena_init(&arena, 128); // small blocks to force block chaining
+    Arena* previous = ast_use_arena(&arena);
+
+    ASTNode* parent = create_node(NODE_STATEMENT);
+    EXPECT_EQ(parent->arena, &arena);
+    char text[] = "alpha";
+    set_node_value(parent, text);
+    text[0] = 'X';
+    EXPECT_STREQ(parent->value, "alpha");
+
+    const int kAdd = 50;
+    for (int i = 0; i < kAdd; ++i) {
+        ASTNode* c = create_node(NODE_EXPRESSION);
+        set_node_value(c, std::to_string(i).c_str());
+        add_child(parent, c);
+    }
+    ASSERT_EQ(parent->num_children, kAdd);
+    for (int i = 0; i < kAdd; ++i) {
+        EXPECT_EQ(parent->children[i]->parent, parent);
+        EXPECT_EQ(std::string(parent->children[i]->value), std::to_string(i));
+    }
+    EXPECT_GT(arena.bytes_reserved, (size_t)128);
+
+    free_node(parent); // no-op for arena nodes
+    EXPECT_EQ(ast_use_arena(previous), &arena);
+    arena_release(&arena);
+    EXPECT_EQ(arena.bytes_reserved, (size_t)0);
+
+    // Back on the heap once the arena is deactivated
+    ASTNode* heap_node = create_node(NODE_EXPRESSION);
+    EXPECT_EQ(heap_node->arena, nullptr);
+    free_node(heap_node);
+}
+
+// Test parsing a whole program into an arena
+TEST(ASTNodeTests, ParseIntoArena) {
+    const char* src = "int add(int a, int b) { int c = a + b; return c; }";
+    Arena arena;
+    arena_init(&arena, 0);
+    Arena* previous = ast_use_arena(&arena);
+    current_line = 1;
+    lexer_begin_memory(src, strlen(src));
+    ASTNode* program = parse_program(NULL);
+    ast_use_arena(previous);
+
+    ASSERT_NE(program, nullptr);
+    ASSERT_EQ(program->num_children, 1);
+    EXPECT_STREQ(program->children[0]->value, "add");
+    EXPECT_EQ(program->children[0]->arena, &arena);
+    EXPECT_GT(arena.bytes_allocated, (size_t)0);
+    arena_release(&arena);
+}
+
 // Test get_precedence ordering relationships
 TEST(UtilsTests, OperatorPrecedenceOrdering) {
     EXPECT_GT(get_precedence("*"), get_precedence("+"));
+    EXPECT_EQ(get_precedence("%"), get_precedence("*"));
     EXPECT_GT(get_precedence("+"), get_precedence("<<"));
     EXPECT_GT(get_precedence("<<"), get_precedence("<"));
     EXPECT_GT(get_precedence("<"), get_precedence("=="));
@@ -72,7 +137,7 @@ TEST(UtilsTests, IsNumberStr) {
 
 // Test registering and querying array sizes (no duplicates)
 TEST(UtilsTests, RegisterArrayAndLookup) {
-    g_array_count = 0; // reset global state for test isolation
+    reset_array_symbols(); // reset global state for test isolation
     register_array("arr", 5);
     EXPECT_EQ(find_array_size("arr"), 5);
     // Re-register with different size should update
@@ -82,6 +147,52 @@ TEST(UtilsTests, RegisterArrayAndLookup) {
     EXPECT_EQ(find_array_size("none"), -1);
 }
 
+// Test that inner scopes shadow array sizes and restore them on exit
+TEST(UtilsTests, ScopedArraySymbols) {
+    reset_array_symbols();
+    register_array("buf", 4);
+    array_scope_push();
+    EXPECT_EQ(find_array_size("buf"), 4);
+    register_array("buf", 16);
+    register_array("tmp", 2);
+    EXPECT_EQ(find_array_size("buf"), 16);
+    array_scope_pop();
+    EXPECT_EQ(find_array_size("buf"), 4);
+    EXPECT_EQ(find_array_size("tmp"), -1);
+
+    // No fixed cap on the number of arrays
+    for (int i = 0; i < 1000; ++i) {
+        register_array(("a" + std::to_string(i)).c_str(), i + 1);
+    }
+    EXPECT_EQ(find_array_size("a0"), 1);
+    EXPECT_EQ(find_array_size("a999"), 1000);
+    reset_array_symbols();
+    EXPECT_EQ(find_array_size("a999"), -1);
+}
+
+// Test struct registration, field lookup and growth past the old limits
+TEST(UtilsTests, StructSymbolTable) {
+    reset_struct_symbols();
+    for (int i = 0; i < 100; ++i) {
+        int index = register_struct(("S" + std::to_string(i)).c_str());
+        EXPECT_EQ(index, i);
+    }
+    int point = register_struct("Point");
+    for (int i = 0; i < 40; ++i) {
+        add_struct_field(point, ("f" + std::to_string(i)).c_str(), i % 2 ? "char" : "int");
+    }
+    EXPECT_EQ(struct_count(), 101);
+    EXPECT_EQ(find_struct_index("Point"), point);
+    EXPECT_EQ(find_struct_index_id(intern_cstr("S42")), 42);
+    EXPECT_EQ(find_struct_index("Missing"), -1);
+    EXPECT_EQ(struct_info_at(point)->field_count, 40);
+    EXPECT_STREQ(struct_field_type("Point", "f39"), "char");
+    EXPECT_STREQ(struct_field_type("Point", "f0"), "int");
+    EXPECT_EQ(struct_field_type("Point", "nope"), nullptr);
+    reset_struct_symbols();
+    EXPECT_EQ(struct_count(), 0);
+}
+
 // Test tokenization of identifiers, numbers, and multi-char operators
 TEST(TokenTests, BasicLexing) {
     const char* src = "int x = a + 42; // comment\nif (x==43) x = x-1;";
@@ -93,7 +204,7 @@ TEST(TokenTests, BasicLexing) {
     advance(f); // prime first token
     // int
     EXPECT_EQ(current_token.type, TOKEN_KEYWORD);
-    EXPECT_STREQ(current_token.value, "int");
+    EXPECT_STREQ(token_text(current_token), "int");
     advance(f); // x
     EXPECT_EQ(current_token.type, TOKEN_IDENTIFIER);
     advance(f); // =
@@ -110,17 +221,207 @@ TEST(TokenTests, BasicLexing) {
     // if
     while (current_token.type != TOKEN_KEYWORD && current_token.type != TOKEN_EOF) advance(f);
     EXPECT_EQ(current_token.type, TOKEN_KEYWORD);
-    EXPECT_STREQ(current_token.value, "if");
+    EXPECT_STREQ(token_text(current_token), "if");
     // scan until ==
     bool saw_eqeq = false;
     while (current_token.type != TOKEN_EOF) {
-        if (current_token.type == TOKEN_OPERATOR && strcmp(current_token.value, "==") == 0) { saw_eqeq = true; break; }
+        if (current_token.type == TOKEN_OPERATOR && strcmp(token_text(current_token), "==") == 0) { saw_eqeq = true; break; }
         advance(f);
     }
     EXPECT_TRUE(saw_eqeq);
     fclose(f);
 }
 
+// Test lexing from an in-memory buffer, including token source offsets
+TEST(TokenTests, MemorySourceOffsets) {
+    static const char src[] = "/* head */ while (count<=10) count++;";
+    current_line = 1;
+    lexer_begin_memory(src, strlen(src));
+    advance(NULL);
+    EXPECT_EQ(current_token.type, TOKEN_KEYWORD);
+    EXPECT_STREQ(token_text(current_token), "while");
+    EXPECT_EQ(current_token.offset, 11u);
+    EXPECT_EQ(current_token.length, 5u);
+    advance(NULL); // (
+    advance(NULL); // count
+    EXPECT_EQ(strncmp(src + current_token.offset, "count", current_token.length), 0);
+    advance(NULL); // <=
+    EXPECT_STREQ(token_text(current_token), "<=");
+    EXPECT_EQ(current_token.length, 2u);
+    while (current_token.type != TOKEN_EOF) advance(NULL);
+    lexer_end();
+}
+
+// Test that #pragma lines become one token and other directives are skipped
+TEST(TokenTests, PragmaAndDirectiveLines) {
+    static const char src[] = "#include <stdio.h>\n  #  pragma  unroll 4  \nfor\n#pragma\nx";
+    current_line = 1;
+    lexer_begin_memory(src, strlen(src));
+    advance(NULL);
+    EXPECT_EQ(current_token.type, TOKEN_PRAGMA);
+    EXPECT_STREQ(token_text(current_token), "unroll 4");
+    EXPECT_EQ(current_token.line, 2);
+    advance(NULL);
+    EXPECT_STREQ(token_text(current_token), "for");
+    EXPECT_EQ(current_token.line, 3);
+    advance(NULL);
+    EXPECT_EQ(current_token.type, TOKEN_PRAGMA);
+    EXPECT_STREQ(token_text(current_token), "");
+    advance(NULL);
+    EXPECT_STREQ(token_text(current_token), "x");
+    EXPECT_EQ(current_token.line, 5);
+    lexer_end();
+}
+
+// Test that a saved lexer mark restores position, line and current token
+TEST(TokenTests, MarkAndReset) {
+    static const char src[] = "a\nb\nc";
+    current_line = 1;
+    lexer_begin_memory(src, strlen(src));
+    advance(NULL); // a
+    LexerMark mark = lexer_mark();
+    advance(NULL); // b
+    advance(NULL); // c
+    EXPECT_EQ(current_token.line, 3);
+    lexer_reset_to(&mark);
+    EXPECT_STREQ(token_text(current_token), "a");
+    advance(NULL);
+    EXPECT_STREQ(token_text(current_token), "b");
+    EXPECT_EQ(current_token.line, 2);
+    lexer_end();
+}
+
+// Test that tokens stay compact and identical lexemes share one interned id
+TEST(TokenTests, CompactInternedTokens) {
+    static const char src[] = "alpha beta alpha";
+    EXPECT_EQ(sizeof(Token), 16u);
+    current_line = 1;
+    lexer_begin_memory(src, strlen(src));
+    advance(NULL);
+    Token first = current_token;
+    advance(NULL);
+    Token second = current_token;
+    advance(NULL);
+    EXPECT_EQ(first.id, current_token.id);
+    EXPECT_NE(first.id, second.id);
+    EXPECT_EQ(token_text(first), token_text(current_token)); // canonical pointer
+    EXPECT_EQ(token_column(second), 7);
+    lexer_end();
+}
+
+// Test that identifiers longer than 255 characters are kept intact
+TEST(TokenTests, LongIdentifierNotTruncated) {
+    std::string name(300, 'v');
+    std::string src = "int f(int " + name + ") { return " + name + "; }";
+    current_line = 1;
+    lexer_begin_memory(src.c_str(), src.size());
+    ASTNode* program = parse_program(NULL);
+    ASSERT_NE(program, nullptr);
+    ASSERT_EQ(program->num_children, 1);
+    ASTNode* function = program->children[0];
+    ASSERT_GE(function->num_children, 2);
+    EXPECT_EQ(std::string(function->children[0]->value), name);
+    EXPECT_EQ(std::string(function->children[1]->children[0]->value), name);
+    free_node(program);
+}
+
+// Test that every keyword hashes to its predefined id and near misses do not
+TEST(TokenTests, KeywordPerfectHash) {
+    for (InternId id = INTERN_KW_IF; id <= INTERN_KW_VOID; id++) {
+        const char* text = intern_text(id);
+        current_line = 1;
+        lexer_begin_memory(text, strlen(text));
+        advance(NULL);
+        EXPECT_EQ(current_token.type, TOKEN_KEYWORD) << text;
+        EXPECT_EQ(current_token.id, id) << text;
+        EXPECT_TRUE(is_keyword(text)) << text;
+        lexer_end();
+    }
+    for (const char* text : {"iff", "i", "in", "fi", "voids", "doubl", "tni", "continues", "While"}) {
+        EXPECT_FALSE(is_keyword(text)) << text;
+    }
+    EXPECT_TRUE(is_keyword("int"));
+}
+
+// Test that the operator DFA takes the longest operator and tags punctuation
+TEST(TokenTests, OperatorAndPunctuationTable) {
+    static const char src[] = "<<=>>>=!!=&&&|||++--+-*/%^~.;(){}[],@ a\t\v\f\r\nb";
+    static const char* const expected[] = {
+        "<<", "=", ">>", ">=", "!", "!=", "&&", "&", "||", "|", "++", "--", "+", "-",
+        "*", "/", "%", "^", "~", ".", ";", "(", ")", "{", "}", "[", "]", ",", "@", "a", "b"
+    };
+    current_line = 1;
+    lexer_begin_memory(src, strlen(src));
+    advance(NULL);
+    for (const char* text : expected) {
+        EXPECT_STREQ(token_text(current_token), text);
+        EXPECT_EQ(current_token.id, intern_cstr(text)) << text;
+        advance(NULL);
+    }
+    EXPECT_EQ(current_token.type, TOKEN_EOF);
+    current_line = 1;
+    lexer_begin_memory(src, strlen(src));
+    for (int token_idx = 0; token_idx < 20; token_idx++) {
+        advance(NULL);
+        EXPECT_EQ(current_token.type, TOKEN_OPERATOR);
+    }
+    advance(NULL);
+    EXPECT_EQ(current_token.type, TOKEN_SEMICOLON);
+    advance(NULL);
+    EXPECT_EQ(current_token.type, TOKEN_PARENTHESIS_OPEN);
+    for (int token_idx = 0; token_idx < 6; token_idx++) {
+        advance(NULL);
+    }
+    EXPECT_EQ(current_token.type, TOKEN_COMMA);
+    for (int token_idx = 0; token_idx < 3; token_idx++) {
+        advance(NULL);
+    }
+    EXPECT_STREQ(token_text(current_token), "b");
+    EXPECT_EQ(current_token.line, 2);
+    lexer_end();
+}
+
+// Test that keywords and operators intern to their predefined ids
+TEST(UtilsTests, PredefinedInternIds) {
+    EXPECT_EQ(intern_cstr("while"), (InternId)INTERN_KW_WHILE);
+    EXPECT_EQ(intern_cstr("<<"), (InternId)INTERN_OP_SHIFT_LEFT);
+    EXPECT_STREQ(intern_text(INTERN_OP_LOGICAL_OR), "||");
+    EXPECT_TRUE(intern_is_keyword(intern_cstr("struct")));
+    EXPECT_FALSE(intern_is_keyword(intern_cstr("structure")));
+    EXPECT_TRUE(is_keyword("double"));
+    EXPECT_FALSE(is_keyword("=="));
+    EXPECT_EQ(get_precedence_id(INTERN_OP_MULTIPLY), PREC_MULTIPLICATIVE);
+    EXPECT_EQ(get_precedence_id(INTERN_OP_ASSIGN), PREC_UNKNOWN);
+    EXPECT_EQ(get_precedence_id(intern_cstr("foo")), PREC_UNKNOWN);
+
+    const char* src = "a <= b";
+    lexer_begin_memory(src, strlen(src));
+    current_line = 1;
+    advance(NULL);
+    advance(NULL);
+    EXPECT_EQ(current_token.id, (InternId)INTERN_OP_LESS_EQUAL);
+}
+
+// Test that operator nodes carry their interned operator id
+TEST(ParserTests, OperatorNodesCarryInternedId) {
+    const char* src = "a + b * c == !d";
+    ParserContext ctx;
+
+    parser_context_init(&ctx);
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    ctx_advance(&ctx);
+    ASTNode* expr = parse_expression(&ctx);
+
+    ASSERT_NE(expr, nullptr);
+    EXPECT_EQ(expr->token.id, (InternId)INTERN_OP_EQUAL);
+    EXPECT_EQ(expr->children[0]->token.id, (InternId)INTERN_OP_PLUS);
+    EXPECT_EQ(expr->children[0]->children[1]->token.id, (InternId)INTERN_OP_MULTIPLY);
+    EXPECT_EQ(expr->children[1]->token.id, (InternId)INTERN_OP_LOGICAL_NOT);
+    EXPECT_STREQ(expr->children[0]->value, "+");
+    free_node(expr);
+    parser_context_destroy(&ctx);
+}
+
 // Test negative literal detection utility
 TEST(UtilsTests, NegativeLiteralDetection) {
     EXPECT_TRUE(is_negative_literal("-123"));
@@ -138,6 +439,54 @@ TEST(ParserTests, Placeholder) {
     EXPECT_LT(get_precedence("+"), get_precedence("*"));
 }
 
+// Index, member and unary expressions are parsed into structured nodes
+TEST(ParserTests, StructuredAccessExpressions) {
+    const char* src =
+        "struct P { int v; }; int f(int i) { int arr[4]; struct P p; "
+        "arr[i + 1] = p.v; return -arr[arr[0]]; }";
+    ParserContext ctx;
+    Arena arena;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    ASTNode* program = parse_program_ctx(&ctx);
+    ASSERT_NE(program, nullptr);
+
+    // Function children: parameter, then one statement node per statement
+    ASTNode* function = program->children[program->num_children - 1];
+    ASSERT_EQ(function->num_children, 5);
+
+    ASTNode* decl = function->children[1]->children[0];
+    EXPECT_EQ(decl->type, NODE_VAR_DECL);
+    EXPECT_STREQ(decl->value, "arr");
+    EXPECT_EQ(decl->array_size, 4);
+
+    // arr[i + 1] = p.v;
+    ASTNode* assign = function->children[3]->children[0];
+    ASSERT_EQ(assign->type, NODE_ASSIGNMENT);
+    ASTNode* lhs = assign->children[0];
+    ASSERT_EQ(lhs->type, NODE_INDEX_EXPR);
+    EXPECT_STREQ(lhs->children[0]->value, "arr");
+    EXPECT_EQ(lhs->children[1]->type, NODE_BINARY_EXPR);
+    ASTNode* rhs = assign->children[1];
+    ASSERT_EQ(rhs->type, NODE_MEMBER_EXPR);
+    EXPECT_STREQ(rhs->value, "v");
+    EXPECT_STREQ(rhs->children[0]->value, "p");
+
+    // return -arr[arr[0]];
+    ASTNode* ret = function->children[4]->children[0];
+    ASSERT_EQ(ret->type, NODE_UNARY_EXPR);
+    EXPECT_STREQ(ret->value, "-");
+    ASTNode* outer = ret->children[0];
+    ASSERT_EQ(outer->type, NODE_INDEX_EXPR);
+    EXPECT_EQ(outer->children[1]->type, NODE_INDEX_EXPR);
+
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+}
+
 // Test function call AST node creation
 TEST(FunctionCallTests, CreateFunctionCallNode) {
     ASTNode* call_node = create_node(NODE_FUNC_CALL);
@@ -251,6 +600,265 @@ TEST(FunctionCallTests, FunctionCallInAssignment) {
     free_node(assign_node);
 }
 
+// Compile src with its own ParserContext and return the generated VHDL
+static std::string compile_with_context(const char* src) {
+    ParserContext ctx;
+    Arena arena;
+    std::string vhdl;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    ASTNode* program = parse_program_ctx(&ctx);
+
+    if (program) {
+        OutputBuffer out;
+        output_buffer_init(&out, NULL);
+        generate_vhdl_buffer(&ctx, program, &out);
+        vhdl.assign(output_buffer_data(&out), out.length);
+        output_buffer_free(&out);
+    }
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+    return vhdl;
+}
+
+// Separate contexts compile concurrently and match a sequential run
+TEST(ParserContextTests, ParallelContextsMatchSequential) {
+    const char* sources[] = {
+        "struct P { int x; int y; }; int f(int a) { struct P p; p.x = a; return p.x; }",
+        "int g(int a, int b) { int arr[4]; arr[0] = a; while (a < b) { a = a + 1; } return arr[0]; }",
+        "struct Q { float v; }; float h(float s) { struct Q q; q.v = s; return q.v; }",
+        "int k(int n) { for (int i = 0; i < 8; i++) { n = n << 1; } return n; }",
+    };
+    const size_t count = sizeof(sources) / sizeof(sources[0]);
+    std::vector<std::string> expected(count);
+    std::vector<std::string> actual(count);
+
+    for (size_t i = 0; i < count; i++) {
+        expected[i] = compile_with_context(sources[i]);
+        ASSERT_FALSE(expected[i].empty());
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < count; i++) {
+        workers.emplace_back([&, i]() {
+            for (int round = 0; round < 20; round++) {
+                actual[i] = compile_with_context(sources[i]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(actual[i], expected[i]);
+    }
+}
+
+// A fatal parse error unwinds to parse_program_ctx instead of exiting
+TEST(ParserContextTests, FatalErrorReturnsNull) {
+    const char* src = "int f(int a) { return a + ; }";
+    ParserContext ctx;
+    Arena arena;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    EXPECT_EQ(parse_program_ctx(&ctx), nullptr);
+    EXPECT_GT(ctx.error_count, 0);
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+}
+
+// Each statement and declaration is a recovery point, so independent
+// errors are all reported in one pass and the functions in between parse
+TEST(ParserContextTests, RecoversAndReportsEveryError) {
+    const char* src =
+        "int f(int a) { int x = a + ; int y = 2 return y; }\n"
+        "int g(int b { return b; }\n"
+        "int h(int c) { if (c > 1 { c = 2; } break; return c; }\n"
+        "int ok(void) { return 1; }\n";
+    ParserContext ctx;
+    Arena arena;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    EXPECT_EQ(parse_program_ctx(&ctx), nullptr);
+    EXPECT_EQ(ctx.error_count, 5);
+    EXPECT_EQ(ctx.loop_depth, 0);
+    EXPECT_EQ(ctx.arrays.scope_depth, 0);
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+}
+
+TEST(ParserContextTests, MaxErrorsStopsParsing) {
+    std::string src = "int f(int a) {\n";
+    ParserContext ctx;
+    Arena arena;
+
+    for (int line = 0; line < 10; line++) {
+        src += "    a = a + ;\n";
+    }
+    src += "}\n";
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx.max_errors = 3;
+    ctx_lexer_begin_memory(&ctx, src.c_str(), src.size());
+    EXPECT_EQ(parse_program_ctx(&ctx), nullptr);
+    EXPECT_EQ(ctx.error_count, 3);
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+}
+
+// Prefixes, groups and precedence come out as the old recursive parser
+// built them, and nesting far past the call stack's reach still parses
+TEST(ParserContextTests, DeepExpressionsParseIteratively) {
+    const int depth = 100000;
+    std::string nested;
+    std::string sum = "a";
+    for (int i = 0; i < depth; i++) {
+        nested += "-(";
+        sum += " + a";
+    }
+    nested += "a";
+    nested.append(depth, ')');
+    std::string src = "int f(int a) { int b = -(a + 2) * ~a - -3; int c = " + nested +
+                      "; return " + sum + "; }";
+    ParserContext ctx;
+    Arena arena;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx_lexer_begin_memory(&ctx, src.c_str(), src.size());
+    ASTNode* program = parse_program_ctx(&ctx);
+    ASSERT_NE(program, nullptr);
+    ASTNode* function = program->children[0];
+    ASSERT_EQ(function->num_children, 4);
+    ASTNode* b_decl = function->children[1]->children[0];
+    ASSERT_EQ(b_decl->type, NODE_VAR_DECL);
+    ASTNode* b_init = b_decl->children[0];
+    ASSERT_EQ(b_init->type, NODE_BINARY_EXPR);
+    EXPECT_STREQ(b_init->value, "-");
+    EXPECT_STREQ(b_init->children[1]->value, "-3");
+    ASTNode* product = b_init->children[0];
+    EXPECT_STREQ(product->value, "*");
+    EXPECT_EQ(product->children[0]->type, NODE_UNARY_EXPR);
+    EXPECT_STREQ(product->children[0]->children[0]->value, "+");
+    EXPECT_STREQ(product->children[1]->value, "~");
+    EXPECT_EQ(ast_depth(program), depth + 5);
+    EXPECT_GT(ast_stack_size(program), (size_t)AST_DEFAULT_STACK_BYTES);
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+}
+
+// An AST image reloads into a tree that generates the same VHDL, and
+// truncated or corrupted images are rejected
+TEST(AstImageTests, RoundTripMatchesParse) {
+    const char* src =
+        "struct P { int x; int y; };\n"
+        "int f(struct P p, int a) { int arr[4]; arr[0] = a; if (a > 3) { a = -a; } return p.x + arr[0]; }\n"
+        "int g(int n) { for (int i = 0; i < 8; i++) { n = n << 1; } return f(n, n); }\n";
+    std::string expected = compile_with_context(src);
+    ParserContext ctx;
+    Arena arena;
+    OutputBuffer image;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    ASTNode* program = parse_program_ctx(&ctx);
+    ASSERT_NE(program, nullptr);
+    output_buffer_init(&image, NULL);
+    ast_image_write(program, &ctx.structs, &image);
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+
+    // Copy into aligned storage as a mapped file would be
+    std::vector<uint32_t> data((image.length + 3) / 4);
+    memcpy(data.data(), image.data, image.length);
+    AstImage view;
+    ASSERT_TRUE(ast_image_open(&view, data.data(), image.length));
+    EXPECT_FALSE(ast_image_open(&view, data.data(), image.length - 4));
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ASSERT_TRUE(ast_image_open(&view, data.data(), image.length));
+    program = ast_image_load(&view, &arena, &ctx.structs);
+    ASSERT_NE(program, nullptr);
+    EXPECT_EQ(program->children[0]->parent, program);
+    OutputBuffer out;
+    output_buffer_init(&out, NULL);
+    generate_vhdl_buffer(&ctx, program, &out);
+    EXPECT_EQ(std::string(output_buffer_data(&out), out.length), expected);
+    output_buffer_free(&out);
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+
+    // A child link pointing outside its run fails validation
+    AstImageNode* nodes = (AstImageNode*)((char*)data.data() + view.header->node_offset);
+    nodes[0].first_child = 2;
+    EXPECT_FALSE(ast_image_open(&view, data.data(), image.length));
+    output_buffer_free(&image);
+}
+
+// Append primitives build the text in memory when there is no sink
+TEST(OutputBufferTests, AppendsInMemory) {
+    OutputBuffer out;
+    output_buffer_init(&out, NULL);
+
+    out_puts(&out, "signal ");
+    out_write(&out, "abcdef", 3);
+    out_putc(&out, ':');
+    out_int(&out, -42);
+    out_int(&out, 0);
+    out_printf(&out, " %s(%d)", "to_unsigned", 32);
+    EXPECT_STREQ(output_buffer_data(&out), "signal abc:-420 to_unsigned(32)");
+
+    size_t length = 0;
+    char* text = output_buffer_take(&out, &length);
+    EXPECT_EQ(length, strlen("signal abc:-420 to_unsigned(32)"));
+    EXPECT_STREQ(output_buffer_data(&out), "");
+    free(text);
+    output_buffer_free(&out);
+}
+
+// A streaming buffer drains in chunks and reproduces the exact byte stream
+TEST(OutputBufferTests, StreamsLargeOutputToSink) {
+    FILE* sink = tmpfile();
+    ASSERT_NE(sink, nullptr);
+    OutputBuffer out;
+    output_buffer_init(&out, sink);
+    std::string expected;
+
+    for (int line = 0; line < 200000; line++) {
+        out_puts(&out, "      result <= ");
+        out_int(&out, line);
+        out_puts(&out, ";\n");
+        expected += "      result <= " + std::to_string(line) + ";\n";
+    }
+    EXPECT_GT(out.bytes_written, 0u);
+    EXPECT_LT(out.length, (size_t)OUTPUT_BUFFER_FLUSH_THRESHOLD);
+    ASSERT_TRUE(output_buffer_flush(&out));
+    output_buffer_free(&out);
+
+    std::string written(expected.size(), '\0');
+    rewind(sink);
+    ASSERT_EQ(fread(&written[0], 1, written.size(), sink), written.size());
+    EXPECT_EQ(fgetc(sink), EOF);
+    EXPECT_EQ(written, expected);
+    fclose(sink);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,432 @@
+#include <gtest/gtest.h>
+extern "C" {
+#include "batch.h"
+#include "compile_stream.h"
+#include "parse.h"
+}
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <filesystem>
+#include <sys/stat.h>
+
+static std::string write_temp_file(const std::string& name, const std::string& text) {
+    std::string path = ::testing::TempDir() + name;
+    std::ofstream out(path);
+    out << text;
+    return path;
+}
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// Output names follow the input, optionally redirected to an output directory
+TEST(BatchTests, DefaultOutputPaths) {
+    BatchList batch;
+    batch_init(&batch);
+    batch_add(&batch, "kernels/fir.c", NULL, NULL);
+    batch_add(&batch, "kernels/fir.c", NULL, "out/");
+    batch_add(&batch, "adder.c", "custom.vhdl", "out");
+    batch_add(&batch, "noext", NULL, NULL);
+
+    ASSERT_EQ(batch.count, 4);
+    EXPECT_STREQ(batch.jobs[0].output_path, "kernels/fir.vhdl");
+    EXPECT_STREQ(batch.jobs[1].output_path, "out/fir.vhdl");
+    EXPECT_STREQ(batch.jobs[2].output_path, "custom.vhdl");
+    EXPECT_STREQ(batch.jobs[3].output_path, "noext.vhdl");
+    batch_free(&batch);
+}
+
+// Manifest lines list inputs with optional outputs; comments are skipped
+TEST(BatchTests, LoadManifest) {
+    std::string manifest = write_temp_file("compi_manifest.txt",
+        "# kernels\n"
+        "a.c\n"
+        "\n"
+        "b.c   b_out.vhdl\n");
+    BatchList batch;
+    batch_init(&batch);
+
+    ASSERT_TRUE(batch_load_manifest(&batch, manifest.c_str(), NULL));
+    ASSERT_EQ(batch.count, 2);
+    EXPECT_STREQ(batch.jobs[0].input_path, "a.c");
+    EXPECT_STREQ(batch.jobs[0].output_path, "a.vhdl");
+    EXPECT_STREQ(batch.jobs[1].input_path, "b.c");
+    EXPECT_STREQ(batch.jobs[1].output_path, "b_out.vhdl");
+    batch_free(&batch);
+    std::remove(manifest.c_str());
+}
+
+// Inputs that would write the same output are rejected instead of racing
+TEST(BatchTests, RejectsCollidingOutputs) {
+    std::string manifest = write_temp_file("compi_manifest_clash.txt",
+        "c.c clash.vhdl\n"
+        "d.c clash.vhdl\n");
+    BatchList batch;
+    batch_init(&batch);
+
+    EXPECT_TRUE(batch_add(&batch, "a/k.c", NULL, "out"));
+    EXPECT_FALSE(batch_add(&batch, "b/k.c", NULL, "out"));
+    EXPECT_TRUE(batch_add(&batch, "b/k.c", NULL, NULL));
+    EXPECT_FALSE(batch_add(&batch, "other.c", "out/k.vhdl", NULL));
+    EXPECT_FALSE(batch_load_manifest(&batch, manifest.c_str(), NULL));
+
+    ASSERT_EQ(batch.count, 3);
+    EXPECT_STREQ(batch.jobs[0].output_path, "out/k.vhdl");
+    EXPECT_STREQ(batch.jobs[1].output_path, "b/k.vhdl");
+    EXPECT_STREQ(batch.jobs[2].input_path, "c.c");
+    batch_free(&batch);
+    std::remove(manifest.c_str());
+}
+
+// A pooled run compiles every input and reports the failing ones
+TEST(BatchTests, RunReportsFailures) {
+    std::string good = write_temp_file("compi_batch_good.c",
+        "int add(int a, int b) { return a + b; }\n");
+    std::string bad = write_temp_file("compi_batch_bad.c",
+        "int broken(int a) { return a + ; }\n");
+    CompileOptions options = { 0, 0 };
+    BatchList batch;
+    batch_init(&batch);
+    for (int copy = 0; copy < 4; copy++) {
+        std::string output = ::testing::TempDir() + "compi_batch_good" + std::to_string(copy) + ".vhdl";
+        batch_add(&batch, good.c_str(), output.c_str(), NULL);
+    }
+    batch_add(&batch, bad.c_str(), NULL, NULL);
+    batch_add(&batch, (::testing::TempDir() + "compi_batch_missing.c").c_str(), NULL, NULL);
+
+    EXPECT_EQ(batch_run(&batch, 3, &options), 2);
+    EXPECT_TRUE(batch.jobs[0].succeeded);
+    EXPECT_TRUE(batch.jobs[3].succeeded);
+    EXPECT_FALSE(batch.jobs[4].succeeded);
+    EXPECT_GT(batch.jobs[4].error_count, 0);
+    EXPECT_FALSE(batch.jobs[5].succeeded);
+    EXPECT_NE(read_file(batch.jobs[0].output_path).find("entity add"), std::string::npos);
+
+    for (int job_idx = 0; job_idx < 5; job_idx++) {
+        std::remove(batch.jobs[job_idx].output_path);
+    }
+    batch_free(&batch);
+    std::remove(good.c_str());
+    std::remove(bad.c_str());
+}
+
+// --time-report counters describe the compiled unit
+TEST(BatchTests, TimeReportCountsUnit) {
+    std::string source = write_temp_file("compi_profile.c",
+        "int f(int a) { int arr[4]; arr[0] = a; return arr[0]; }\n");
+    std::string output = ::testing::TempDir() + "compi_profile.vhdl";
+    CompileOptions options = { 0, 0, TIME_REPORT_TEXT };
+    CompileProfile profile;
+    int error_count = -1;
+
+    ASSERT_TRUE(compile_unit(source.c_str(), output.c_str(), &options, &error_count, &profile));
+    EXPECT_EQ(error_count, 0);
+    if (profile_available()) {
+        EXPECT_GT(profile.token_count, 10u);
+        EXPECT_GT(profile.ast_node_count, 5u);
+        EXPECT_GE(profile.symbol_operations, 2u);
+        EXPECT_EQ(profile.output_bytes, read_file(output).size());
+    }
+    EXPECT_EQ(profile.source_bytes == 0, !profile_available());
+    EXPECT_GE(profile.total_seconds, profile.phase_seconds[PROFILE_PHASE_PARSE]);
+    EXPECT_GE(profile.phase_seconds[PROFILE_PHASE_PARSE], profile.phase_seconds[PROFILE_PHASE_SYMBOLS]);
+
+    std::remove(output.c_str());
+    std::remove(source.c_str());
+}
+
+// --cache-dir splices unchanged functions; an edit only regenerates its own
+// function and the callers that inline it
+TEST(BatchTests, CacheSplicesUnchangedFunctions) {
+    std::string cache = ::testing::TempDir() + "compi_cache";
+    std::string output = ::testing::TempDir() + "compi_cache.vhdl";
+    std::string plain_output = ::testing::TempDir() + "compi_cache_plain.vhdl";
+    const char* text =
+        "int scale(int a) { return a * 3; }\nint add(int a, int b) { return a + b; }\n"
+        "int twice(int a) { while (a > 100) { a = a - 1; } return scale(a) + scale(a + 1); }\n";
+    std::string source = write_temp_file("compi_cache.c", text);
+    CompileOptions options = { 0, 0, TIME_REPORT_TEXT };
+    CompileProfile profile;
+
+    std::filesystem::remove_all(cache);
+    std::filesystem::create_directory(cache);
+    codegen_options_default(&options.codegen);
+    ASSERT_TRUE(compile_unit(source.c_str(), plain_output.c_str(), &options, NULL, NULL));
+    options.codegen.cache_dir = cache.c_str();
+    ASSERT_TRUE(compile_unit(source.c_str(), output.c_str(), &options, NULL, &profile));
+    ASSERT_TRUE(compile_unit(source.c_str(), output.c_str(), &options, NULL, &profile));
+    EXPECT_EQ(read_file(output), read_file(plain_output));
+    if (profile_available()) {
+        EXPECT_EQ(profile.cache_hits, 3u);
+        EXPECT_EQ(profile.cache_misses, 0u);
+    }
+
+    // add is untouched; scale and its caller twice are not
+    write_temp_file("compi_cache.c", std::string(text).replace(std::string(text).find("* 3"), 3, "* 5"));
+    ASSERT_TRUE(compile_unit(source.c_str(), output.c_str(), &options, NULL, &profile));
+    EXPECT_NE(read_file(output).find("shift_left(signed(a), 2)"), std::string::npos) << read_file(output);
+    if (profile_available()) {
+        EXPECT_EQ(profile.cache_hits, 1u);
+        EXPECT_EQ(profile.cache_misses, 2u);
+    }
+
+    std::remove(output.c_str());
+    std::remove(plain_output.c_str());
+    std::remove(source.c_str());
+    std::filesystem::remove_all(cache);
+}
+
+// Editing a struct layout regenerates the functions declared with it, and
+// entries can be read by other users
+TEST(BatchTests, CacheCoversStructLayouts) {
+    std::string cache = ::testing::TempDir() + "compi_cache_structs";
+    std::string output = ::testing::TempDir() + "compi_cache_structs.vhdl";
+    std::string plain_output = ::testing::TempDir() + "compi_cache_structs_plain.vhdl";
+    const std::string text =
+        "struct P { int x; int y; };\n"
+        "struct P make(int a) { struct P p; p.x = a; p.y = a + 1; return p; }\n"
+        "int get(struct P p) { return p.x + p.y; }\n"
+        "int other(int a) { return a - 1; }\n";
+    std::string source = write_temp_file("compi_cache_structs.c", text);
+    CompileOptions options = { 0, 0, TIME_REPORT_TEXT };
+    CompileProfile profile;
+
+    std::filesystem::remove_all(cache);
+    std::filesystem::create_directory(cache);
+    codegen_options_default(&options.codegen);
+    options.codegen.cache_dir = cache.c_str();
+    ASSERT_TRUE(compile_unit(source.c_str(), output.c_str(), &options, NULL, NULL));
+    mode_t mask = umask(0);
+    umask(mask);
+    for (const auto& entry : std::filesystem::directory_iterator(cache)) {
+        EXPECT_EQ(static_cast<mode_t>(entry.status().permissions()), 0644 & ~mask) << entry.path();
+    }
+
+    write_temp_file("compi_cache_structs.c",
+                    std::string(text).replace(text.find("int x; int y;"), 13, "int y; int8_t x;"));
+    ASSERT_TRUE(compile_unit(source.c_str(), output.c_str(), &options, NULL, &profile));
+    options.codegen.cache_dir = NULL;
+    ASSERT_TRUE(compile_unit(source.c_str(), plain_output.c_str(), &options, NULL, NULL));
+    EXPECT_EQ(read_file(output), read_file(plain_output));
+    if (profile_available()) {
+        EXPECT_EQ(profile.cache_hits, 1u);
+        EXPECT_EQ(profile.cache_misses, 2u);
+    }
+
+    std::remove(output.c_str());
+    std::remove(plain_output.c_str());
+    std::remove(source.c_str());
+    std::filesystem::remove_all(cache);
+}
+
+// An entry whose stored input differs is a miss even under the right name
+TEST(BatchTests, CacheComparesStoredInput) {
+    std::string cache = ::testing::TempDir() + "compi_cache_input";
+    std::string output = ::testing::TempDir() + "compi_cache_input.vhdl";
+    std::string source = write_temp_file("compi_cache_input.c", "int inc(int a) { return a + 1; }\n");
+    CompileOptions options = { 0, 0, TIME_REPORT_TEXT };
+    CompileProfile profile;
+    std::string expected;
+
+    std::filesystem::remove_all(cache);
+    std::filesystem::create_directory(cache);
+    codegen_options_default(&options.codegen);
+    options.codegen.cache_dir = cache.c_str();
+    ASSERT_TRUE(compile_unit(source.c_str(), output.c_str(), &options, NULL, NULL));
+    expected = read_file(output);
+
+    // Same file name and length, one byte of the stored input changed
+    for (const auto& entry : std::filesystem::directory_iterator(cache)) {
+        std::string stored = read_file(entry.path().string());
+        size_t header_end = stored.find('\n');
+
+        ASSERT_NE(header_end, std::string::npos);
+        stored[header_end + 1] ^= 1;
+        std::ofstream(entry.path(), std::ios::binary) << stored;
+    }
+    ASSERT_TRUE(compile_unit(source.c_str(), output.c_str(), &options, NULL, &profile));
+    EXPECT_EQ(read_file(output), expected);
+    if (profile_available()) {
+        EXPECT_EQ(profile.cache_hits, 0u);
+        EXPECT_EQ(profile.cache_misses, 1u);
+    }
+
+    std::remove(output.c_str());
+    std::remove(source.c_str());
+    std::filesystem::remove_all(cache);
+}
+
+// --split writes one design file per function, in parallel, with the struct
+// records in a shared package; the entity text matches the combined output
+TEST(BatchTests, SplitWritesOneFilePerFunction) {
+    std::string dir = ::testing::TempDir() + "compi_split";
+    std::string source = write_temp_file("compi_split.c",
+        "struct Point { int x; int y; };\n"
+        "int sum(struct Point p) { return p.x + p.y; }\n"
+        "int scale(int a) { return a * 3; }\n"
+        "int twice(int a) { return scale(a) + scale(a + 1); }\n"
+        "int add(int a, int b) { return a + b; }\n");
+    std::string combined = dir + "/combined.vhdl";
+    std::string listing = dir + "/split-kernels.vhdl";
+    CompileOptions options = { 0, 0, TIME_REPORT_OFF };
+    std::string whole;
+
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+    codegen_options_default(&options.codegen);
+    ASSERT_TRUE(compile_unit(source.c_str(), combined.c_str(), &options, NULL, NULL));
+    options.split_units = 1;
+    options.codegen_jobs = 4;
+    ASSERT_TRUE(compile_unit(source.c_str(), listing.c_str(), &options, NULL, NULL));
+
+    std::string package = read_file(listing);
+    EXPECT_NE(package.find("package split_kernels_types is"), std::string::npos) << package;
+    EXPECT_NE(package.find("type Point_t is record"), std::string::npos);
+    EXPECT_NE(package.find("--   split-kernels.twice.vhd"), std::string::npos);
+
+    whole = read_file(combined);
+    for (const char* name : { "sum", "scale", "twice", "add" }) {
+        std::string unit = read_file(dir + "/split-kernels." + name + ".vhd");
+        std::string entity = unit.substr(unit.find("-- Function: "));
+
+        ASSERT_FALSE(unit.empty()) << name;
+        EXPECT_NE(unit.find("use work.split_kernels_types.all;"), std::string::npos) << name;
+        EXPECT_NE(whole.find(entity), std::string::npos) << name;
+        EXPECT_EQ(unit.find("-- Function: ", unit.find("-- Function: ") + 1), std::string::npos) << name;
+    }
+
+    std::remove(source.c_str());
+    std::filesystem::remove_all(dir);
+}
+
+// Split batch units sharing --out-dir keep their functions apart, even with
+// the same name, and the directory is created
+TEST(BatchTests, SplitBatchUnitsShareOutDir) {
+    std::string dir = ::testing::TempDir() + "compi_split_batch";
+    std::string out_dir = dir + "/out/vhdl";
+    std::string first = write_temp_file("compi_split_first.c", "int scale(int a) { return a - 7; }\n");
+    std::string second = write_temp_file("compi_split_second.c", "int scale(int a) { return a + 5; }\n");
+    CompileOptions options = { 0, 0, TIME_REPORT_OFF };
+    BatchList batch;
+
+    std::filesystem::remove_all(dir);
+    codegen_options_default(&options.codegen);
+    options.split_units = 1;
+    ASSERT_TRUE(batch_make_directory(out_dir.c_str()));
+    batch_init(&batch);
+    batch_add(&batch, first.c_str(), NULL, out_dir.c_str());
+    batch_add(&batch, second.c_str(), NULL, out_dir.c_str());
+    EXPECT_EQ(batch_run(&batch, 2, &options), 0);
+    batch_free(&batch);
+
+    std::string first_unit = read_file(out_dir + "/compi_split_first.scale.vhd");
+    std::string second_unit = read_file(out_dir + "/compi_split_second.scale.vhd");
+    EXPECT_NE(first_unit.find("a - 7"), std::string::npos) << first_unit;
+    EXPECT_NE(second_unit.find("a + 5"), std::string::npos) << second_unit;
+    EXPECT_NE(read_file(out_dir + "/compi_split_first.vhdl").find("--   compi_split_first.scale.vhd"),
+              std::string::npos);
+
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+    std::filesystem::remove_all(dir);
+}
+
+// A ".ast" output holds the front-end result; compiling it again gives the
+// same VHDL as compiling the source
+TEST(BatchTests, AstImageStagesMatchDirectCompile) {
+    std::string source = write_temp_file("compi_stage.c",
+        "struct Point { int x; int y; };\n"
+        "int sum(struct Point p) { return p.x + p.y; }\n"
+        "int scale(int a) { int t = 4; return a * t; }\n");
+    std::string image = ::testing::TempDir() + "compi_stage.ast";
+    std::string staged = ::testing::TempDir() + "compi_stage.vhdl";
+    std::string direct = ::testing::TempDir() + "compi_direct.vhdl";
+    CompileOptions options = { 0, 0, TIME_REPORT_OFF };
+
+    optimize_options_default(&options.optimize);
+    codegen_options_default(&options.codegen);
+    ASSERT_TRUE(compile_unit(source.c_str(), direct.c_str(), &options, NULL, NULL));
+    ASSERT_TRUE(compile_unit(source.c_str(), image.c_str(), &options, NULL, NULL));
+    EXPECT_EQ(read_file(image).compare(0, 8, "compiAST"), 0);
+    ASSERT_TRUE(compile_unit(image.c_str(), staged.c_str(), &options, NULL, NULL));
+    EXPECT_EQ(read_file(staged), read_file(direct));
+
+    std::remove(image.c_str());
+    std::remove(staged.c_str());
+    std::remove(direct.c_str());
+    std::remove(source.c_str());
+}
+
+// Streaming gives the same VHDL when no function calls one defined later
+TEST(BatchTests, StreamMatchesWholeProgram) {
+    std::string source = write_temp_file("compi_stream.c",
+        "struct Point { int x; int y; };\n"
+        "int sum(struct Point p) { return p.x + p.y; }\n"
+        "int twice(int a) { return a + a; }\n"
+        "int scale(int a) { int t = 4; return twice(a) * t; }\n");
+    std::string whole = ::testing::TempDir() + "compi_stream_whole.vhdl";
+    std::string streamed = ::testing::TempDir() + "compi_stream.vhdl";
+    CompileOptions options = { 0, 0, TIME_REPORT_OFF };
+
+    optimize_options_default(&options.optimize);
+    codegen_options_default(&options.codegen);
+    ASSERT_TRUE(compile_unit(source.c_str(), whole.c_str(), &options, NULL, NULL));
+    options.stream = 1;
+    ASSERT_TRUE(compile_unit(source.c_str(), streamed.c_str(), &options, NULL, NULL));
+    EXPECT_EQ(read_file(streamed), read_file(whole));
+
+    std::remove(whole.c_str());
+    std::remove(streamed.c_str());
+    std::remove(source.c_str());
+}
+
+// Only called functions stay in memory, and a caller defined before its
+// callee waits for it
+TEST(BatchTests, StreamReleasesUncalledFunctions) {
+    std::string text = "int first(int a) { return later(a) + 1; }\n";
+    for (int index = 0; index < 50; index++) {
+        text += "int f" + std::to_string(index) + "(int a) { int b = a * " +
+                std::to_string(index + 3) + "; if (b > 9) { b = b - 1; } return b; }\n";
+    }
+    text += "int later(int a) { return a - 2; }\n";
+    ParserContext ctx;
+    Arena arena;
+    OutputBuffer out;
+    OptimizeOptions optimize;
+    CompileStreamStats stats;
+
+    optimize_options_default(&optimize);
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx.diagnostics.buffered = 1;
+    output_buffer_init(&out, NULL);
+    ctx_lexer_begin_memory(&ctx, text.c_str(), text.size());
+    ASSERT_TRUE(compile_stream(&ctx, &optimize, &out, &stats));
+    std::string vhdl(output_buffer_data(&out), out.length);
+    output_buffer_free(&out);
+
+    EXPECT_EQ(stats.function_count, 52);
+    EXPECT_EQ(stats.retained_count, 1);
+    EXPECT_LT(vhdl.find("entity later is"), vhdl.find("entity first is"));
+    EXPECT_NE(vhdl.find("entity f49 is"), std::string::npos);
+
+    // The whole program holds every function at once
+    Arena whole_arena;
+    arena_init(&whole_arena, 0);
+    ctx.arena = &whole_arena;
+    ctx_lexer_begin_memory(&ctx, text.c_str(), text.size());
+    ASSERT_NE(parse_program_ctx(&ctx), nullptr);
+    EXPECT_LT(stats.peak_ast_bytes * 4, whole_arena.bytes_reserved);
+
+    parser_context_destroy(&ctx);
+    arena_release(&whole_arena);
+    arena_release(&arena);
+}
@@ -0,0 +1,1066 @@
+#include <gtest/gtest.h>
+extern "C" {
+#include "parse.h"
+#include "parser_context.h"
+#include "codegen_vhdl.h"
+#include "output_buffer.h"
+#include "arena.h"
+}
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Default code generation options, for tests to adjust
+static CodegenOptions codegen_defaults() {
+    CodegenOptions options;
+    codegen_options_default(&options);
+    return options;
+}
+
+// Number of non-overlapping occurrences of text in vhdl
+static int count_of(const std::string& vhdl, const std::string& text) {
+    int count = 0;
+    for (size_t at = vhdl.find(text); at != std::string::npos; at = vhdl.find(text, at + text.size())) {
+        count++;
+    }
+    return count;
+}
+
+// Parse src and generate it with the given options (no optimization passes)
+static std::string generate_with_options(const char* src, CodegenOptions options) {
+    ParserContext ctx;
+    Arena arena;
+    std::string vhdl;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx.codegen = &options;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    ASTNode* program = parse_program_ctx(&ctx);
+    if (program) {
+        OutputBuffer out;
+        output_buffer_init(&out, NULL);
+        generate_vhdl_buffer(&ctx, program, &out);
+        vhdl.assign(output_buffer_data(&out), out.length);
+        output_buffer_free(&out);
+    }
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+    return vhdl;
+}
+
+static const char* kMultiplyAccumulate =
+    "int mac(int a, int b, int c, int d) {\n"
+    "    int t = a * b + c;\n"
+    "    int u = t * d - a;\n"
+    "    return (u + t) * (c - d) + b;\n"
+    "}\n";
+
+// Arithmetic keeps the grouping of the C source
+TEST(CodegenTests, ParenthesizesLooserOperands) {
+    std::string vhdl = generate_with_options(
+        "int f(int a, int b, int c) { int x = (a + b) * c; int y = a - (b - c); return a * b + c; }",
+        codegen_defaults());
+    EXPECT_NE(vhdl.find("x <= (a + b) * c;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("y <= a - (b - c);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= a * b + c;"), std::string::npos) << vhdl;
+}
+
+// Without --pipeline-stages the entity has no handshake
+TEST(PipelineTests, DisabledByDefault) {
+    std::string vhdl = generate_with_options(kMultiplyAccumulate, codegen_defaults());
+    EXPECT_EQ(vhdl.find("valid_in"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("pipe1_"), std::string::npos) << vhdl;
+}
+
+// Operator levels are spread over the stages; late readers get delay registers
+TEST(PipelineTests, SplitsDataflowIntoStages) {
+    CodegenOptions options = codegen_defaults();
+    options.pipeline_stages = 3;
+
+    std::string vhdl = generate_with_options(kMultiplyAccumulate, options);
+
+    EXPECT_NE(vhdl.find("valid_in  : in  std_logic;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("valid_out : out std_logic;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("signal valid_pipe : std_logic_vector(1 to 3);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("pipe1_5 <= a * b + c;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("pipe2_7 <= pipe1_5 * pipe1_3 - pipe1_0;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("pipe2_1 <= pipe1_1;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= (pipe2_7 + pipe2_5) * pipe2_9 + pipe2_1;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("valid_out <= valid_pipe(3);"), std::string::npos) << vhdl;
+    // Locals are folded into the dataflow instead of becoming signals
+    EXPECT_EQ(vhdl.find("signal t "), std::string::npos) << vhdl;
+}
+
+// A shallow expression never gets more stages than operator levels
+TEST(PipelineTests, StageCountCappedByDepth) {
+    CodegenOptions options = codegen_defaults();
+    options.pipeline_stages = 4;
+
+    std::string vhdl = generate_with_options("int add(int a, int b) { return a + b; }", options);
+
+    EXPECT_NE(vhdl.find("signal valid_pipe : std_logic_vector(1 to 1);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= a + b;"), std::string::npos) << vhdl;
+}
+
+// Comparisons stay inside the stage that reads them
+TEST(PipelineTests, BooleansAreNotRegistered) {
+    CodegenOptions options = codegen_defaults();
+    options.pipeline_stages = 2;
+
+    std::string vhdl = generate_with_options("int lt(int a, int b) { return (a + b) < (a - b); }", options);
+
+    EXPECT_NE(vhdl.find("pipe1_2 <= a + b;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= unsigned(pipe1_2) < unsigned(pipe1_3);"), std::string::npos) << vhdl;
+}
+
+// Control flow is generated as before, behind a one-stage handshake
+TEST(PipelineTests, UnsupportedFunctionKeepsHandshake) {
+    CodegenOptions options = codegen_defaults();
+    options.pipeline_stages = 3;
+
+    std::string vhdl = generate_with_options(
+        "int count(int a) { int s = 0; while (s < a) { s = s + 1; } return s; }", options);
+
+    EXPECT_NE(vhdl.find("while unsigned(s) < unsigned(a) loop"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= s;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("pipe1_"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("valid_out <= valid_pipe(1);"), std::string::npos) << vhdl;
+}
+
+static const char* kBranchMultiplies =
+    "int f(int a, int b, int c, int d, int s) {\n"
+    "    int r = 0;\n"
+    "    if (s > 0) {\n"
+    "        r = a * b;\n"
+    "    } else if (s < a) {\n"
+    "        r = c * d;\n"
+    "    } else {\n"
+    "        r = (a + b) * d;\n"
+    "    }\n"
+    "    return r;\n"
+    "}\n";
+
+// Multiplies in exclusive arms use one multiplier behind operand muxes
+TEST(SharingTests, BindsExclusiveMultiplies) {
+    CodegenOptions options = codegen_defaults();
+    options.share_limit = 4;
+
+    std::string vhdl = generate_with_options(kBranchMultiplies, options);
+    EXPECT_NE(vhdl.find("signal mul0_y : std_logic_vector(31 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_EQ(count_of(vhdl, "r <= mul0_y;"), 3) << vhdl;
+    EXPECT_NE(vhdl.find("mul0_a <= a when (unsigned(s) > to_unsigned(0, 32)) else c when "
+                        "not (unsigned(s) > to_unsigned(0, 32)) and (unsigned(s) < unsigned(a)) else a + b;"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("mul0_y <= mul0_a * mul0_b;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("r <= a * b;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("mul1_"), std::string::npos) << vhdl;
+}
+
+// The limit caps how many operations one unit multiplexes
+TEST(SharingTests, LimitSplitsUnits) {
+    CodegenOptions options = codegen_defaults();
+    options.share_limit = 2;
+
+    std::string vhdl = generate_with_options(kBranchMultiplies, options);
+    EXPECT_NE(vhdl.find("mul0_a <= a when (unsigned(s) > to_unsigned(0, 32)) else c;"), std::string::npos) << vhdl;
+    EXPECT_EQ(count_of(vhdl, "r <= mul0_y;"), 2) << vhdl;
+    EXPECT_EQ(vhdl.find("mul1_"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("r <= (a + b) * d;"), std::string::npos) << vhdl;
+}
+
+// Operations in the same arm run in the same cycle and keep their own unit
+TEST(SharingTests, SameArmIsNotShared) {
+    CodegenOptions options = codegen_defaults();
+    options.share_limit = 4;
+
+    std::string vhdl = generate_with_options(
+        "int f(int a, int b, int s) { int r = 0; int q = 0; if (s > 0) { r = a * b; q = a * a; } return r + q; }",
+        options);
+
+    EXPECT_EQ(vhdl.find("mul0_"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("r <= a * b;"), std::string::npos) << vhdl;
+}
+
+// Adders are only bound on request
+TEST(SharingTests, AddersOptIn) {
+    const char* src =
+        "int f(int a, int b, int s) { int r = 0; if (s > 0) { r = a + b; } else { r = b + s; } return r; }";
+
+    CodegenOptions options = codegen_defaults();
+    options.share_limit = 4;
+    EXPECT_EQ(generate_with_options(src, options).find("add0_"), std::string::npos);
+
+    options.share_adders = 1;
+    std::string vhdl = generate_with_options(src, options);
+    EXPECT_NE(vhdl.find("add0_a <= a when (unsigned(s) > to_unsigned(0, 32)) else b;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("add0_y <= add0_a + add0_b;"), std::string::npos) << vhdl;
+}
+
+// Small constant-trip loops are flattened with the index substituted and folded
+TEST(UnrollTests, FullyUnrollsSmallLoops) {
+    std::string vhdl = generate_with_options(
+        "int f(int a) { int arr[4]; for (int i = 0; i < 4; i++) { arr[i] = a + i; } return a; }",
+        codegen_defaults());
+
+    EXPECT_NE(vhdl.find("arr(0) <= a;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("arr(1) <= a + 1;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("arr(3) <= a + 3;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("while"), std::string::npos) << vhdl;
+}
+
+// Each copy reads the value the previous one assigned, not the stale signal
+TEST(UnrollTests, ChainsIterationsThroughAssignedScalars) {
+    CodegenOptions options = codegen_defaults();
+    options.strength_reduce = 0;
+    std::string vhdl = generate_with_options(
+        "int f(int a) { int s = 0; for (int i = 0; i < 4; i++) { s = s + a * i; } return s; }",
+        options);
+
+    EXPECT_NE(vhdl.find("s <= s + a + a * 2 + a * 3;"), std::string::npos) << vhdl;
+    EXPECT_EQ(count_of(vhdl, "s <= s"), 1) << vhdl;
+
+    vhdl = generate_with_options(
+        "int g(int a) { int s = 0; int p = 1;\n"
+        "for (int i = 0; i < 3; i++) { int t = p * a; p = t; s = s + t; } return s; }",
+        codegen_defaults());
+    EXPECT_NE(vhdl.find("p <= p * a * a * a;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= s + p * a + p * a * a + p * a * a * a;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("t <= p * a * a * a;"), std::string::npos) << vhdl;
+}
+
+// A write under a condition reads the chained value; later copies read the signal again
+TEST(UnrollTests, ConditionalWriteEndsTheChain) {
+    std::string vhdl = generate_with_options(
+        "int f(int a) { int s = 0; for (int i = 0; i < 2; i++) { s = s + i; if (a > i) { s = s + a; } } return s; }",
+        codegen_defaults());
+    size_t chained = vhdl.find("s <= s + 1;");
+    size_t branch = vhdl.find("if unsigned(a) > to_unsigned(1, 32) then");
+
+    EXPECT_EQ(vhdl.find("s <= s;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= s + a;"), std::string::npos) << vhdl;
+    EXPECT_NE(chained, std::string::npos) << vhdl;
+    EXPECT_NE(branch, std::string::npos) << vhdl;
+    EXPECT_LT(chained, branch) << vhdl;
+    EXPECT_NE(vhdl.find("s <= s + 1 + a;"), std::string::npos) << vhdl;
+}
+
+// Values that would grow without bound keep the loop rolled
+TEST(UnrollTests, OversizedChainKeepsWhile) {
+    std::string vhdl = generate_with_options(
+        "int f(int a) { int x = a;\n"
+        "#pragma unroll\n"
+        "for (int i = 0; i < 40; i++) { x = x * x; } return x; }",
+        codegen_defaults());
+
+    EXPECT_NE(vhdl.find("-- unroll pragma ignored: unrolled values grow too large"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("x <= x * x;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("while"), std::string::npos) << vhdl;
+}
+
+// #pragma unroll N replicates the body N times inside a bounded loop
+TEST(UnrollTests, PartialUnrollByPragma) {
+    std::string vhdl = generate_with_options(
+        "int f(int a) { int s = 0; int k = 0;\n"
+        "#pragma unroll 4\n"
+        "for (k = 0; k < 10; k = k + 1) { s = s + k; } return s; }",
+        codegen_defaults());
+
+    EXPECT_NE(vhdl.find("for k_iter in 0 to 1 loop"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= s + (k_iter * 4 + 3);"), std::string::npos) << vhdl;
+    // Remainder iterations chained, then the final value of the loop variable
+    EXPECT_NE(vhdl.find("s <= s + 8 + 9;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("k <= 10;"), std::string::npos) << vhdl;
+}
+
+// Beyond the limit a constant-trip loop is still bounded, counting down here
+TEST(UnrollTests, LargeLoopBecomesBoundedLoop) {
+    std::string vhdl = generate_with_options(
+        "int f(int a) { int s = 0; for (int j = 40; j > 0; j = j - 2) { s = s + j; } return s; }",
+        codegen_defaults());
+
+    EXPECT_NE(vhdl.find("for j_iter in 0 to 19 loop"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= s + (40 - j_iter * 2);"), std::string::npos) << vhdl;
+}
+
+// Iterator names and values are as long as the loop variable needs
+TEST(UnrollTests, LongLoopVariableKeepsItsName) {
+    std::string variable(120, 'v');
+    std::string source = "int f(int a) { int s = 0; for (int " + variable + " = 40; " + variable + " > 0; " +
+                         variable + " = " + variable + " - 2) { s = s + " + variable + "; } return s; }";
+    std::string vhdl = generate_with_options(source.c_str(), codegen_defaults());
+
+    EXPECT_NE(vhdl.find("for " + variable + "_iter in 0 to 19 loop"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= s + (40 - " + variable + "_iter * 2);"), std::string::npos) << vhdl;
+}
+
+// Loops that leave early or have a runtime bound keep the while lowering
+TEST(UnrollTests, UnknownTripCountKeepsWhile) {
+    std::string vhdl = generate_with_options(
+        "int f(int n) { int s = 0;\n"
+        "#pragma unroll\n"
+        "for (int i = 0; i < n; i++) { s = s + i; }\n"
+        "for (int j = 0; j < 4; j++) { if (s > 3) { break; } s = s + 1; } return s; }",
+        codegen_defaults());
+
+    EXPECT_NE(vhdl.find("-- unroll pragma ignored: trip count is not constant"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("while unsigned(i) < unsigned(n) loop"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("while unsigned(j) < to_unsigned(4, 32) loop"), std::string::npos) << vhdl;
+}
+
+// With the limit at 0 only pragmas unroll fully
+TEST(UnrollTests, LimitZeroOnlyHonoursPragmas) {
+    CodegenOptions options = codegen_defaults();
+    options.unroll_limit = 0;
+    std::string vhdl = generate_with_options(
+        "int f(int a) { int s = 0; for (int i = 0; i < 2; i++) { s = s + i; }\n"
+        "#pragma compi unroll\n"
+        "for (int j = 0; j < 2; j++) { s = s + j; } return s; }",
+        options);
+
+    EXPECT_NE(vhdl.find("for i_iter in 0 to 1 loop"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("j_iter"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= s + 1;"), std::string::npos) << vhdl;
+}
+
+static const char* kSubtractGcd =
+    "int gcd(int a, int b) {\n"
+    "    int x = a;\n"
+    "    int y = b;\n"
+    "    while (x != y) {\n"
+    "        if (x > y) { x = x - y; } else { y = y - x; }\n"
+    "    }\n"
+    "    return x;\n"
+    "}\n";
+
+// Only functions with data-dependent control get the start/done handshake
+TEST(FsmTests, OnlyLoopFunctionsAreSequenced) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+
+    std::string plain = generate_with_options(
+        "int f(int a) { int s = 0; for (int i = 0; i < 4; i++) { s = s + a; } return s; }", options);
+    std::string loop = generate_with_options(kSubtractGcd, codegen_defaults());
+
+    EXPECT_EQ(plain.find("start"), std::string::npos) << plain;
+    EXPECT_EQ(loop.find("state_type"), std::string::npos) << loop;
+    EXPECT_NE(loop.find("while unsigned(x) /= unsigned(y) loop"), std::string::npos) << loop;
+}
+
+// The loop test, the if and the return become states of one case statement
+TEST(FsmTests, WhileLoopBecomesStates) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    std::string vhdl = generate_with_options(kSubtractGcd, options);
+
+    EXPECT_NE(vhdl.find("    start : in  std_logic;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("    done  : out std_logic;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("type state_type is (state_idle, state_0,"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        when state_idle =>\n"
+                        "          if start = '1' then\n"
+                        "            state <= state_0;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        when state_1 =>\n"
+                        "          if unsigned(x) /= unsigned(y) then\n"
+                        "            state <= state_2;\n"
+                        "          else\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("          result <= x;\n"
+                        "          done <= '1';\n"
+                        "          state <= state_idle;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("while"), std::string::npos) << vhdl;
+}
+
+// Independent statements share a state, a dependent one waits for the next
+TEST(FsmTests, ListSchedulingPacksIndependentStatements) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    std::string vhdl = generate_with_options(
+        "int f(int a, int b) { int x = a + 1; int y = b + 2; int z = x + y;\n"
+        "while (z > 0) { z = z - 1; } return z; }",
+        options);
+
+    EXPECT_NE(vhdl.find("        when state_0 =>\n"
+                        "          x <= a + 1;\n"
+                        "          y <= b + 2;\n"
+                        "          state <= state_1;\n"
+                        "        when state_1 =>\n"
+                        "          z <= x + y;\n"), std::string::npos) << vhdl;
+}
+
+// break jumps past the loop, continue to the increment; locals of the body get signals
+TEST(FsmTests, BreakAndContinueAreJumps) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    std::string vhdl = generate_with_options(
+        "int f(int n, int key) { int s = 0; int i = 0;\n"
+        "for (i = 0; i < n; i++) { int v = i * 2; if (v == key) { break; } if (v > 8) { continue; } s = s + v; }\n"
+        "return s; }",
+        options);
+
+    EXPECT_NE(vhdl.find("  signal v : std_logic_vector(31 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("i <= i + 1;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= s;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("exit;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("next;"), std::string::npos) << vhdl;
+}
+
+static const char* kTableSum =
+    "int f(int n) { int table[16] = {1, 2, 3, 4}; int s = 0; int i = 0;\n"
+    "while (i < n) { s = s + table[i]; i = i + 1; } return s; }";
+
+// An initialized array is declared once, after its constant
+TEST(CodegenTests, InitializedArrayDeclaredOnce) {
+    std::string vhdl = generate_with_options("int f(int a) { int t[2] = {1, 2}; return t[a]; }", codegen_defaults());
+    EXPECT_NE(vhdl.find("  signal t : t_type := t_init;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("  signal t : t_type;"), std::string::npos) << vhdl;
+}
+
+// Below the threshold, arrays keep the register lowering
+TEST(MemoryTests, SmallArraysStayRegisters) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    std::string vhdl = generate_with_options(kTableSum, options);
+
+    EXPECT_EQ(vhdl.find("table_ram"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= s + table(i);"), std::string::npos) << vhdl;
+}
+
+// A read-only table becomes a ROM read one state before its value is used
+TEST(MemoryTests, RomReadPresentsAddressOneStateAhead) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    options.bram_threshold = 16;
+    std::string vhdl = generate_with_options(kTableSum, options);
+
+    EXPECT_NE(vhdl.find("  signal table_addr_a : integer range 0 to 15;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  table_addr_a <= to_integer(unsigned(i)) when state = state_2 else\n    0;"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  table_ram : process(clk)"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        table_dout_a <= table(table_addr_a);"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("table_we_a"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  table_en_a <= '1' when state = state_2 else '0';"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        when state_3 =>\n"
+                        "          s <= s + table_dout_a;\n"), std::string::npos) << vhdl;
+}
+
+// Two reads in one statement use the second port; writes go through port a
+TEST(MemoryTests, SecondReadUsesPortB) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    options.bram_threshold = 8;
+    std::string vhdl = generate_with_options(
+        "int f(int n) { int buf[8]; int s = 0; int i = 0;\n"
+        "while (i < n) { buf[i] = n + i; s = buf[0] + buf[1]; i = i + 1; } return s; }",
+        options);
+
+    EXPECT_NE(vhdl.find("  signal buf_addr_a : integer range 0 to 7;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  buf_din_a <= n + i when state = "), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("          buf(buf_addr_a) <= buf_din_a;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        buf_dout_b <= buf(buf_addr_b);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= buf_dout_a + buf_dout_b;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("buf(i) <="), std::string::npos) << vhdl;
+}
+
+static const char* kPartitionedDot =
+    "int f(int c) {\n"
+    "#pragma compi partition cyclic factor=4\n"
+    "int t[8] = {1, 2, 3, 4, 5, 6, 7, 8}; int s = 0;\n"
+    "for (int i = 0; i < 4; i++) { int v = t[i] * c; s = s + v; } return s; }";
+
+// Unrolled copies read one bank each, so all four addresses go out in one state
+TEST(MemoryTests, CyclicBanksServeUnrolledReadsInOneState) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    std::string vhdl = generate_with_options(kPartitionedDot, options);
+
+    EXPECT_NE(vhdl.find("  type t_bank_type is array (0 to 1) of std_logic_vector(31 downto 0);"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  signal t_bank1 : t_bank_type := (\"00000000000000000000000000000010\", "
+                        "\"00000000000000000000000000000110\");"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("  signal t : t_type"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  t_bank3_addr_a <= 0 when state = state_0 else"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("          v_u0 <= t_bank0_dout_a * c;\n"
+                        "          v_u1 <= t_bank1_dout_a * c;\n"
+                        "          v_u2 <= t_bank2_dout_a * c;\n"
+                        "          v_u3 <= t_bank3_dout_a * c;\n"), std::string::npos) << vhdl;
+}
+
+// "complete" keeps an array in registers whatever its size; variable indices undo banking
+TEST(MemoryTests, PartitionNeedsConstantIndices) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    options.bram_threshold = 4;
+    std::string complete = generate_with_options(
+        "int f(int n) {\n#pragma compi partition complete\nint t[4] = {1, 2, 3, 4}; int s = 0; int i = 0;\n"
+        "while (i < n) { s = s + t[i]; i = i + 1; } return s; }", options);
+    std::string variable = generate_with_options(
+        "int f(int n) {\n#pragma compi partition cyclic factor=2\nint t[4] = {1, 2, 3, 4}; int s = 0; int i = 0;\n"
+        "while (i < n) { s = s + t[i]; i = i + 1; } return s; }", options);
+
+    EXPECT_EQ(complete.find("t_ram"), std::string::npos) << complete;
+    EXPECT_NE(complete.find("s <= s + t(i);"), std::string::npos) << complete;
+    EXPECT_EQ(variable.find("t_bank"), std::string::npos) << variable;
+    EXPECT_NE(variable.find("  signal t_addr_a : integer range 0 to 3;"), std::string::npos) << variable;
+}
+
+// intN_t, uintN_t and _BitInt(N) keep exactly N bits; stores wrap, reads extend
+TEST(WidthTests, ExplicitWidthTypes) {
+    std::string vhdl = generate_with_options(
+        "uint12_t f(uint12_t a, _BitInt(5) b) { unsigned _BitInt(20) acc = a * 3; int8_t k = b;\n"
+        "uint8_t lut[2] = {1, 255}; return acc + k + lut[1]; }",
+        codegen_defaults());
+
+    EXPECT_NE(vhdl.find("    a : in std_logic_vector(11 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("    b : in std_logic_vector(4 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("    result : out std_logic_vector(11 downto 0)"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  signal acc : std_logic_vector(19 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  constant lut_init : lut_type := (\"00000001\", \"11111111\");"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("acc <= std_logic_vector(resize(unsigned(std_logic_vector(shift_left(signed("
+                        "std_logic_vector(resize(unsigned(a), 32))), 2) - signed(std_logic_vector(resize(unsigned(a), 32))))), 20));"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("std_logic_vector(resize(signed(k), 32))"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= std_logic_vector(resize(unsigned("), std::string::npos) << vhdl;
+}
+
+// Counters and flags shrink to their value range; accumulators keep 32 bits
+TEST(WidthTests, NarrowsIntLocalsToTheirRange) {
+    const char* src =
+        "int f(int n) { int total = 0; int flag = 0; int low = n & 7; int i;\n"
+        "for (i = 0; i < 10; i = i + 1) { total = total + n; } flag = low > 3; return total + flag + low; }";
+    CodegenOptions options = codegen_defaults();
+    std::string plain = generate_with_options(src, options);
+    options.narrow_widths = 1;
+    std::string vhdl = generate_with_options(src, options);
+
+    EXPECT_NE(plain.find("  signal flag : std_logic_vector(31 downto 0);"), std::string::npos) << plain;
+    EXPECT_NE(vhdl.find("  signal total : std_logic_vector(31 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  signal flag : std_logic_vector(0 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  signal low : std_logic_vector(2 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  signal i : std_logic_vector(3 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("low <= std_logic_vector(resize(unsigned(unsigned(n) and unsigned(7)), 3));"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= total + std_logic_vector(resize(unsigned(flag), 32))"),
+              std::string::npos) << vhdl;
+}
+
+TEST(FixedPointTests, ParsesFormats) {
+    int integer_bits = 0;
+    int fraction_bits = 0;
+
+    EXPECT_EQ(codegen_parse_fixed_point("Q16.16", &integer_bits, &fraction_bits), 1);
+    EXPECT_EQ(integer_bits, 16);
+    EXPECT_EQ(fraction_bits, 16);
+    EXPECT_EQ(codegen_parse_fixed_point("8.24", &integer_bits, &fraction_bits), 1);
+    EXPECT_EQ(fraction_bits, 24);
+    EXPECT_EQ(codegen_parse_fixed_point("Q0.8", &integer_bits, &fraction_bits), 0);
+    EXPECT_EQ(codegen_parse_fixed_point("Q40.40", &integer_bits, &fraction_bits), 0);
+    EXPECT_EQ(codegen_parse_fixed_point("Q16", &integer_bits, &fraction_bits), 0);
+}
+
+// Literals are scaled by 2^n, products shifted back by n, formats aligned on
+// stores; without --fixed-point only the pragma'd declaration is lowered
+TEST(FixedPointTests, LowersRealArithmetic) {
+    const char* src =
+        "float f(float x, int k) { float acc = x * 0.5;\n"
+        "#pragma compi fixed Q8.8\n"
+        "float gain = 1.25;\n"
+        "if (acc < -0.25) { acc = acc + gain; } int whole = acc; return whole + k; }";
+    CodegenOptions options = codegen_defaults();
+    std::string plain = generate_with_options(src, options);
+    options.fixed_integer_bits = 16;
+    options.fixed_fraction_bits = 16;
+    std::string vhdl = generate_with_options(src, options);
+
+    EXPECT_NE(plain.find("acc <= x * 0.5;"), std::string::npos) << plain;
+    EXPECT_NE(vhdl.find("  signal gain : std_logic_vector(15 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("acc <= std_logic_vector(resize(shift_right(signed(x) * to_signed(32768, 32), 16), 32));"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("gain <= std_logic_vector(to_signed(320, 16));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("if signed(acc) < to_signed(-16384, 32) then"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("(signed(acc) + shift_left(resize(signed(gain), 32), 8))"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("whole <= std_logic_vector(resize(shift_right(signed(acc) + "
+                        "(shift_right(signed(acc), 31) and to_signed(65535, 32)), 16), 32));"),
+              std::string::npos) << vhdl;
+}
+
+// A negative value stored into an int truncates toward zero: -2.5 becomes
+// -2, where a plain arithmetic shift would give -3
+TEST(FixedPointTests, IntStoreRoundsTowardZero) {
+    CodegenOptions options = codegen_defaults();
+    options.fixed_integer_bits = 8;
+    options.fixed_fraction_bits = 8;
+    std::string vhdl = generate_with_options(
+        "int f(int k) { float v = -2.5; int w = v; return w + k; }", options);
+
+    EXPECT_NE(vhdl.find("v <= std_logic_vector(to_signed(-640, 16));"), std::string::npos) << vhdl;
+    // -640 + 255 = -385, and -385 >> 8 = -2
+    EXPECT_NE(vhdl.find("w <= std_logic_vector(resize(shift_right(signed(v) + "
+                        "(shift_right(signed(v), 15) and to_signed(255, 16)), 8), 32));"),
+              std::string::npos) << vhdl;
+}
+
+// Powers of two shift, few-digit constants become shifted adds; larger
+// expressions are not repeated for a second digit
+TEST(StrengthTests, MultipliesBecomeShiftAdds) {
+    const char* src =
+        "int f(int x, int y) { int a = x * 8; int b = 10 * x; int c = x * -3; int d = (x + y) * 7;\n"
+        "int e = x * 683; return a + b + c + d + e; }";
+    CodegenOptions options = codegen_defaults();
+    options.strength_reduce = 0;
+    std::string plain = generate_with_options(src, options);
+    std::string vhdl = generate_with_options(src, codegen_defaults());
+
+    EXPECT_NE(plain.find("a <= x * 8;"), std::string::npos) << plain;
+    EXPECT_NE(vhdl.find("a <= std_logic_vector(shift_left(signed(x), 3));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("b <= std_logic_vector(shift_left(signed(x), 3) + shift_left(signed(x), 1));"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("c <= std_logic_vector(signed(x) - shift_left(signed(x), 2));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("d <= (x + y) * 7;"), std::string::npos) << vhdl;
+    // 683 = 1024 - 256 - 64 - 16 - 4 - 1: too many digits
+    EXPECT_NE(vhdl.find("e <= x * 683;"), std::string::npos) << vhdl;
+}
+
+// Quotients truncate towards zero: a biased shift for 2^k, a magic
+// reciprocal otherwise; remainders subtract the quotient back
+TEST(StrengthTests, DividesBecomeShiftsAndReciprocals) {
+    const char* src =
+        "int f(int x, uint32_t u) { int q = x / 42; int p = x / -4; int r = x % 10; int m = u % 16;\n"
+        "int v = u / 3; return q + p + r + m + v; }";
+    std::string vhdl = generate_with_options(src, codegen_defaults());
+
+    EXPECT_NE(vhdl.find("q <= std_logic_vector(shift_right(resize(shift_right(signed(x) * "
+                        "to_signed(818089009, 32), 32), 32), 3) + signed(shift_right(unsigned(x), 31)));"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("p <= std_logic_vector(-(shift_right(signed(x) + signed(shift_right(unsigned("
+                        "shift_right(signed(x), 31)), 30)), 2)));"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("r <= std_logic_vector(signed(x) - resize((shift_right(resize(shift_right(signed(x) * "
+                        "to_signed(1717986919, 32), 32), 32), 2)"),
+              std::string::npos) << vhdl;
+    // Unsigned operands: masks and logical shifts only
+    EXPECT_NE(vhdl.find("m <= std_logic_vector(unsigned(u) and to_unsigned(15, 32));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("v <= u / 3;"), std::string::npos) << vhdl;
+}
+
+// Divisors of magnitude 1 need no logic; INT_MIN is 2^31 with a minus sign
+TEST(StrengthTests, UnitAndIntMinConstants) {
+    const char* src =
+        "int f(int x, uint32_t u) { int a = x / 1; int b = x / -1; int c = x % -1; int d = u / 1;\n"
+        "int e = x / -2147483648; int g = x % -2147483648; int h = x * -2147483648;\n"
+        "return a + b + c + d + e + g + h; }";
+    std::string vhdl = generate_with_options(src, codegen_defaults());
+
+    EXPECT_NE(vhdl.find("a <= std_logic_vector(signed(x));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("b <= std_logic_vector(-signed(x));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("c <= std_logic_vector(to_signed(0, 32));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("d <= std_logic_vector(signed(u));"), std::string::npos) << vhdl;
+    // Only INT_MIN itself divides to 1 (and -x wraps back to INT_MIN)
+    EXPECT_NE(vhdl.find("e <= std_logic_vector(-(shift_right(signed(x) + signed(shift_right(unsigned("
+                        "shift_right(signed(x), 31)), 1)), 31)));"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("g <= std_logic_vector(signed(x) - shift_left(shift_right(signed(x) + "
+                        "signed(shift_right(unsigned(shift_right(signed(x), 31)), 1)), 31), 31));"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("h <= std_logic_vector(-shift_left(signed(x), 31));"), std::string::npos) << vhdl;
+}
+
+// Pure straight-line functions drop clock, reset and process; a local that
+// reads itself or a loop keeps the registered lowering
+TEST(CombinationalTests, PureFunctionsAreConcurrent) {
+    const char* src =
+        "int mix(int a, int b) { int p = a * b; int s; s = p + a; return s ^ b; }\n"
+        "int nop() { int x; x = x / 42; return x; }";
+    CodegenOptions options = codegen_defaults();
+    std::string plain = generate_with_options(src, options);
+    options.combinational = 1;
+    std::string vhdl = generate_with_options(src, options);
+
+    EXPECT_NE(plain.find("entity mix is\n  port (\n    clk   : in  std_logic;"), std::string::npos) << plain;
+    EXPECT_NE(vhdl.find("entity mix is\n  port (\n    a : in"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("begin\n  p <= a * b;\n  s <= p + a;\n  result <= unsigned(s) xor unsigned(b);\n"
+                        "end architecture;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("entity nop is\n  port (\n    clk   : in  std_logic;"), std::string::npos) << vhdl;
+}
+
+// The pragma works without the option; instances of combinational callees
+// have no clock to map
+TEST(CombinationalTests, PragmaAndCallsCompose) {
+    const char* src =
+        "int inc(int a) {\n#pragma compi combinational\nreturn a + 1; }\n"
+        "int twice(int a) {\n#pragma compi combinational\nint b = inc(a); return inc(b); }\n"
+        "int loop(int n) {\n#pragma compi combinational\nint i = 0; while (i < n) { i = i + 1; } return i; }";
+    std::string vhdl = generate_with_options(src, codegen_defaults());
+
+    EXPECT_NE(vhdl.find("entity twice is\n  port (\n    a : in"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  inc_0_inst : entity work.inc\n    port map (\n      a => inc_0_a,"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  b <= inc_0_result;\n  result <= inc_1_result;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("entity loop is\n  port (\n    clk"), std::string::npos) << vhdl;
+}
+
+// Arrays walked by the loop counter become streams (also under --fsm): one
+// iteration per beat, tready from the beat condition, tlast from the bound
+TEST(StreamTests, ArrayParametersBecomeStreams) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    std::string vhdl = generate_with_options(
+        "int scale(int x[64], int y[64], int k, int n) { int peak = 0;\n"
+        "for (int i = 0; i < n; i++) { y[i] = x[i] + k; if (x[i] > peak) { peak = x[i]; } }\n"
+        "return peak; }", options);
+
+    EXPECT_NE(vhdl.find("    x_tdata : in std_logic_vector(31 downto 0);\n    x_tvalid : in  std_logic;\n"
+                        "    x_tready : out std_logic;\n    x_tlast : in  std_logic;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("    y_tvalid : out std_logic;\n    y_tready : in  std_logic;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("    done  : out std_logic;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("stream_fire <= '1' when stream_load = '0' and stream_flush = '0' and x_tvalid = '1' "
+                        "and (y_valid = '0' or y_tready = '1') else '0';"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("stream_last <= '1' when x_tlast = '1' or signed(i) = signed(n) - 1 else '0';"),
+              std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("y_tdata <= x_tdata + k;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        y_valid <= '1';\n        y_tlast <= stream_last;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        if stream_flush = '1' then\n          result <= peak;\n        end if;\n"
+                        "        done <= stream_flush;\n        peak <= 0;\n"), std::string::npos) << vhdl;
+}
+
+// Other accesses keep the plain ports, as does the pragma
+TEST(StreamTests, OtherAccessesKeepPlainPorts) {
+    std::string vhdl = generate_with_options(
+        "int rev(int x[4]) { int s = 0; for (int i = 0; i < 4; i++) { s = s + x[3 - i]; } return s; }\n"
+        "int sum(int x[4]) {\n#pragma compi stream off\n"
+        "int s = 0; for (int i = 0; i < 4; i++) { s = s + x[i]; } return s; }", codegen_defaults());
+
+    EXPECT_EQ(vhdl.find("_tdata"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("entity rev is\n  port (\n    clk   : in  std_logic;\n    reset : in  std_logic;\n"
+                        "    x : in"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("entity sum is\n  port (\n    clk   : in  std_logic;\n    reset : in  std_logic;\n"
+                        "    x : in"), std::string::npos) << vhdl;
+}
+
+// A beat reads the values it assigned itself, not the signals, which only
+// update when the beat ends: y gets this beat's t and the sum before it
+TEST(StreamTests, BeatForwardsItsOwnAssignments) {
+    std::string vhdl = generate_with_options(
+        "int acc(int x[16], int y[16], int k) { int s = 0;\n"
+        "for (int i = 0; i < 16; i++) { int t = x[i] * k; t = t + 1; y[i] = t + s; s = s + t; }\n"
+        "return s; }", codegen_defaults());
+    size_t beat = vhdl.find("      if stream_fire = '1' then\n");
+    size_t between = vhdl.find("      elsif stream_load = '1'");
+
+    ASSERT_NE(beat, std::string::npos) << vhdl;
+    std::string body = vhdl.substr(beat, between - beat);
+    EXPECT_NE(body.find("        y_tdata <= x_tdata * k + 1 + s;\n"), std::string::npos) << body;
+    EXPECT_NE(body.find("        s <= s + (x_tdata * k + 1);\n"), std::string::npos) << body;
+    EXPECT_NE(body.find("        t <= x_tdata * k + 1;\n"), std::string::npos) << body;
+    EXPECT_EQ(count_of(body, " t <= "), 1) << body;
+}
+
+// Independent statements issue every cycle: each reads its iteration's
+// counter through the delay registers and runs under its stage's valid bit
+TEST(ModuloTests, LoopIssuesEveryCycle) {
+    std::string vhdl = generate_with_options(
+        "int sum(int n, int k) { int s = 0; int i = 0;\n#pragma compi pipeline\n"
+        "while (i < n) { int a = i * k; int b = a + 3; s = s + b; i = i + 1; }\nreturn s; }",
+        codegen_defaults());
+
+    EXPECT_NE(vhdl.find("    start : in  std_logic;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("    done  : out std_logic;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  signal pipe_valid : std_logic_vector(1 to 3);\n"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("pipe_phase"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("      i_d1 <= i;\n      pipe_valid(2 to 3) <= pipe_valid(1 to 2);\n"), std::string::npos)
+        << vhdl;
+    EXPECT_NE(vhdl.find("        if pipe_issuing = '1' then\n          if unsigned(i) < unsigned(n) then\n"
+                        "            pipe_valid(1) <= '1';\n            i <= i + 1;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        if pipe_valid(1) = '1' then\n          a <= i_d1 * k;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        if pipe_valid(2) = '1' then\n          b <= a + 3;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        if pipe_issuing = '0' and unsigned(pipe_valid) = 0 then\n          result <= s;\n"
+                        "          done <= '1';\n"), std::string::npos) << vhdl;
+}
+
+// Back-to-back calls: the start of the second call, taken the cycle after
+// done, puts the counter, the prelude and the valid and phase registers
+// back to where the first call began, for for and while loops alike
+TEST(ModuloTests, StartRestartsTheLoop) {
+    std::string vhdl = generate_with_options(
+        "int up(int n, int k) { int s = 0;\n#pragma compi pipeline\n"
+        "for (int i = 0; i < n; i++) { s = s + i * k; }\nreturn s; }\n"
+        "int down(int n, int k) { int s = 1; int i = 0;\n#pragma compi pipeline II=2\n"
+        "while (i < n) { s = s + (i ^ k); i = i + 1; }\nreturn s; }",
+        codegen_defaults());
+    size_t down = vhdl.find("entity down is");
+
+    ASSERT_NE(down, std::string::npos) << vhdl;
+    std::string first = vhdl.substr(0, down);
+    std::string second = vhdl.substr(down);
+    EXPECT_NE(first.find("      if pipe_busy = '0' then\n        if start = '1' then\n          s <= 0;\n"
+                         "          i <= 0;\n          pipe_busy <= '1';\n          pipe_issuing <= '1';\n"
+                         "          pipe_valid <= (others => '0');\n        end if;\n"), std::string::npos) << first;
+    EXPECT_NE(second.find("        if start = '1' then\n          s <= 1;\n          i <= 0;\n"
+                          "          pipe_busy <= '1';\n          pipe_issuing <= '1';\n"
+                          "          pipe_valid <= (others => '0');\n          pipe_phase <= 0;\n        end if;\n"),
+              std::string::npos) << second;
+    // The first call ends idle, so the next start is taken
+    EXPECT_NE(second.find("          done <= '1';\n          pipe_busy <= '0';\n"), std::string::npos) << second;
+}
+
+// A recurrence longer than the requested II raises it and is reported;
+// loops it cannot schedule keep the usual lowering with a note
+TEST(ModuloTests, RecurrenceLimitsInterval) {
+    std::string vhdl = generate_with_options(
+        "int acc(int n, int k) { int s = 1;\n#pragma compi pipeline II=1\n"
+        "for (int i = 0; i < n; i++) { int t = s * k; s = t + i; }\nreturn s; }\n"
+        "int early(int n) { int s = 0;\n#pragma compi pipeline\n"
+        "for (int i = 0; i < n; i++) { if (s > 9) { break; } s = s + i; }\nreturn s; }",
+        codegen_defaults());
+
+    // II=2: a new iteration issues on every other phase
+    EXPECT_NE(vhdl.find("  signal pipe_valid : std_logic_vector(1 to 2);\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  signal pipe_phase : integer range 0 to 1;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        if pipe_issuing = '1' and pipe_phase = 1 then\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("        if pipe_valid(1) = '1' then\n          t <= s * k;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("s <= t + i_d2;\n"), std::string::npos) << vhdl;
+    EXPECT_EQ(count_of(vhdl, "signal pipe_valid"), 1) << vhdl;
+    EXPECT_NE(vhdl.find("entity early is\n  port (\n    clk   : in  std_logic;\n    reset : in  std_logic;\n"
+                        "    n : in"), std::string::npos) << vhdl;
+}
+
+// A repeated formula is computed once, operands in either order; the
+// expression inside it is only hoisted when it is also used on its own
+TEST(CseTests, RepeatedExpressionsShareOneSignal) {
+    const char* src =
+        "int f(int a, int b, int c, int d) { int x = a * b + c; int y = c + b * a - d; int z = 0;\n"
+        "if (d > 0) { z = a * b; } else { z = a - b; } return x + y + z + (a - b); }";
+    CodegenOptions options = codegen_defaults();
+    options.eliminate_common = 0;
+    std::string plain = generate_with_options(src, options);
+    options.eliminate_common = 1;
+    std::string vhdl = generate_with_options(src, options);
+
+    EXPECT_EQ(plain.find("cse_"), std::string::npos) << plain;
+    EXPECT_NE(vhdl.find("  signal cse_0 : std_logic_vector(31 downto 0);\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  cse_0 <= a * b;\n  cse_1 <= cse_0 + c;\n"
+                        "  cse_2 <= a - b;\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("x <= cse_1;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("y <= cse_1 - d;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("z <= cse_0;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= x + y + z + cse_2;"), std::string::npos) << vhdl;
+}
+
+// Loop bodies and single uses keep their expressions
+TEST(CseTests, LoopsAndSingleUsesStayInPlace) {
+    CodegenOptions options = codegen_defaults();
+    options.eliminate_common = 1;
+    std::string vhdl = generate_with_options(
+        "int f(int a, int b) { int s = a * b; for (int i = 0; i < 4; i++) { s = s + a * b; }\n"
+        "return s + (a - b); }", options);
+
+    EXPECT_EQ(vhdl.find("cse_"), std::string::npos) << vhdl;
+}
+
+// Parse src and estimate it with the given options (names are cleared:
+// they point into the released arena)
+static std::vector<CodegenEstimate> estimate_with_options(const char* src, const CodegenOptions& options,
+                                                          std::string* json = nullptr) {
+    ParserContext ctx;
+    Arena arena;
+    std::vector<CodegenEstimate> result;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx.codegen = &options;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    ASTNode* program = parse_program_ctx(&ctx);
+    if (program) {
+        CodegenEstimate* estimates = nullptr;
+        int count = estimate_vhdl(&ctx, program, &estimates);
+        result.assign(estimates, estimates + count);
+        for (CodegenEstimate& estimate : result) {
+            estimate.name = nullptr;
+        }
+        if (json) {
+            OutputBuffer out;
+            output_buffer_init(&out, NULL);
+            estimate_print_json(estimates, count, "k.c", &out);
+            json->assign(output_buffer_data(&out), out.length);
+            output_buffer_free(&out);
+        }
+        free(estimates);
+    }
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+    return result;
+}
+
+// Operators are charged by width: a multiply takes DSPs, a constant one
+// only shifts and adds, a divider is as deep as its quotient is wide
+TEST(EstimateTests, ChargesOperatorsByWidth) {
+    CodegenOptions options = codegen_defaults();
+    std::string json;
+
+    std::vector<CodegenEstimate> estimates = estimate_with_options(
+        "int mac(int a, int b, int c) { return a * b + c; }\n"
+        "int narrow(int8_t a, int8_t b) { return a * b; }\n"
+        "int scale(int a) { return a * 8; }\n"
+        "int quotient(int a, int b) { return a / b; }\n", options, &json);
+
+    ASSERT_EQ(estimates.size(), 4u);
+    EXPECT_EQ(estimates[0].dsps, 4);
+    EXPECT_EQ(estimates[0].luts, 32);
+    EXPECT_EQ(estimates[0].depth, 2);
+    EXPECT_EQ(estimates[0].registers, 32);
+    EXPECT_EQ(estimates[1].dsps, 1);
+    EXPECT_EQ(estimates[2].dsps, 0);
+    EXPECT_EQ(estimates[2].luts, 0);
+    EXPECT_EQ(estimates[3].luts, 32 * 32);
+    EXPECT_EQ(estimates[3].depth, 32);
+    EXPECT_EQ(json.rfind("{\"file\": \"k.c\", \"entities\": [{\"name\": \"mac\", \"luts\": 32, ", 0), 0u) << json;
+    EXPECT_NE(json.find("\"total\": {\"luts\": 1056, "), std::string::npos) << json;
+}
+
+// Unrolled loops count once per copy and index arrays by constants;
+// pipelining splits the depth over the stages
+TEST(EstimateTests, FollowsLoweringOptions) {
+    const char* src =
+        "int sum(int x) { int acc = 0; for (int i = 0; i < 4; i++) { acc = acc + x * i; } return acc; }\n"
+        "int chain(int a, int b, int c, int d) { return ((a + b) * c + d) * a + b; }\n";
+    CodegenOptions options = codegen_defaults();
+
+    std::vector<CodegenEstimate> plain = estimate_with_options(src, options);
+    options.unroll_limit = 0;
+    std::vector<CodegenEstimate> rolled = estimate_with_options(src, options);
+    options.pipeline_stages = 2;
+    std::vector<CodegenEstimate> pipelined = estimate_with_options(src, options);
+
+    ASSERT_EQ(plain.size(), 2u);
+    EXPECT_EQ(plain[0].luts, 4 * 32);
+    EXPECT_EQ(plain[0].dsps, 0);
+    EXPECT_GT(rolled[0].dsps, 0);
+    EXPECT_EQ(plain[1].depth, 5);
+    EXPECT_EQ(pipelined[1].depth, 3);
+    EXPECT_GT(pipelined[1].registers, plain[1].registers);
+}
+
+// Parse src and generate its testbenches; returns the testbench count
+static int testbench_with_options(const char* src, const CodegenOptions& options,
+                                  std::string* vhdl, std::string* vectors) {
+    ParserContext ctx;
+    Arena arena;
+    int count = -1;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx.codegen = &options;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    ASTNode* program = parse_program_ctx(&ctx);
+    if (program) {
+        OutputBuffer bench;
+        OutputBuffer program_text;
+        output_buffer_init(&bench, NULL);
+        output_buffer_init(&program_text, NULL);
+        count = generate_testbench(&ctx, program, "/src/k.c", 16, &bench, &program_text);
+        vhdl->assign(output_buffer_data(&bench), bench.length);
+        vectors->assign(output_buffer_data(&program_text), program_text.length);
+        output_buffer_free(&program_text);
+        output_buffer_free(&bench);
+    }
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+    return count;
+}
+
+// Integer functions get a testbench and a vector writer; struct and array
+// parameters and main do not
+TEST(TestbenchTests, CoversIntegerFunctions) {
+    CodegenOptions options = codegen_defaults();
+    std::string vhdl;
+    std::string vectors;
+
+    int count = testbench_with_options(
+        "struct P { int x; };\n"
+        "int add(int a, uint8_t b) { return a + b; }\n"
+        "int getx(struct P p) { return p.x; }\n"
+        "int first(int v[4]) { return v[0]; }\n"
+        "int main() { return add(1, 2); }\n", options, &vhdl, &vectors);
+
+    EXPECT_EQ(count, 1);
+    EXPECT_NE(vhdl.find("entity add_tb is"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("      b => tb_b,\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("tb_b <= std_logic_vector(to_unsigned(inputs(index, 1), 8));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("-- getx: no testbench"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("-- first: no testbench"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("main_tb"), std::string::npos) << vhdl;
+    EXPECT_NE(vectors.find("#include \"/src/k.c\""), std::string::npos) << vectors;
+    EXPECT_NE(vectors.find("compi_tb_value = (long long)add(a, b);"), std::string::npos) << vectors;
+    EXPECT_NE(vectors.find("    compi_tb_add();\n"), std::string::npos) << vectors;
+}
+
+// The testbench follows the handshake the entity was generated with
+TEST(TestbenchTests, FollowsEntityHandshake) {
+    const char* src = "int mac(int a, int b, int c) { return a * b + c; }\n";
+    CodegenOptions options = codegen_defaults();
+    std::string vhdl;
+    std::string vectors;
+
+    testbench_with_options(src, options, &vhdl, &vectors);
+    EXPECT_NE(vhdl.find("exit when tb_result ="), std::string::npos) << vhdl;
+    options.pipeline_stages = 2;
+    testbench_with_options(src, options, &vhdl, &vectors);
+    EXPECT_NE(vhdl.find("valid_in => tb_valid_in,"), std::string::npos) << vhdl;
+    options.pipeline_stages = 0;
+    options.combinational = 1;
+    testbench_with_options(src, options, &vhdl, &vectors);
+    EXPECT_EQ(vhdl.find("clk => clk"), std::string::npos) << vhdl;
+    options.combinational = 0;
+    options.fsm = 1;
+    testbench_with_options("int steps(int n) { int i = 0; while (i < n) { i = i + 1; } return i; }\n",
+                           options, &vhdl, &vectors);
+    EXPECT_NE(vhdl.find("start => tb_start,"), std::string::npos) << vhdl;
+}
+
+static const char* kSearch =
+    "int search(int n, int a) {\n"
+    "    int found = 0;\n"
+    "    int k = 0;\n"
+    "    int sum = 7;\n"
+    "    while (k < n) { if (found == 0) { sum = sum + a; } if (k > 9) { found = 1; } k = k + 1; }\n"
+    "    return sum;\n"
+    "}\n";
+
+// Only the control path is reset (FSM state, done, locals read by a
+// condition, from their initializer); a process with none of it has no
+// reset logic at all
+TEST(ResetTests, ResetsOnlyControlRegisters) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    options.reset = RESET_ASYNC;
+    std::string vhdl = generate_with_options(kSearch, options);
+    std::string plain = generate_with_options("int add(int a, int b) { int s = a + b; return s * a; }\n", options);
+
+    EXPECT_NE(vhdl.find("  process(clk, reset)\n  begin\n    if reset = '1' then\n"
+                        "      state <= state_idle;\n      done <= '0';\n      found <= 0;\n      k <= 0;\n"
+                        "    elsif rising_edge(clk) then\n"), std::string::npos) << vhdl;
+    EXPECT_NE(plain.find("  process(clk)\n  begin\n    if rising_edge(clk) then\n"), std::string::npos) << plain;
+    EXPECT_EQ(plain.find("if reset"), std::string::npos) << plain;
+    EXPECT_NE(plain.find("    reset : in  std_logic;\n"), std::string::npos) << plain;
+}
+
+// --reset=sync tests the reset last inside the clock edge; --reset=none
+// gives the control registers power-up values instead
+TEST(ResetTests, SyncAndNoneStyles) {
+    CodegenOptions options = codegen_defaults();
+    options.fsm = 1;
+    options.reset = RESET_SYNC;
+    std::string sync = generate_with_options(kSearch, options);
+    options.reset = RESET_NONE;
+    std::string none = generate_with_options(kSearch, options);
+
+    EXPECT_NE(sync.find("  process(clk)\n  begin\n    if rising_edge(clk) then\n"), std::string::npos) << sync;
+    EXPECT_NE(sync.find("      if reset = '1' then\n        state <= state_idle;\n        done <= '0';\n"
+                        "        found <= 0;\n        k <= 0;\n      end if;\n    end if;\n  end process;\n"),
+              std::string::npos) << sync;
+    EXPECT_EQ(none.find("if reset"), std::string::npos) << none;
+    EXPECT_NE(none.find("    done  : out std_logic := '0';\n"), std::string::npos) << none;
+    EXPECT_NE(none.find("  signal state : state_type := state_idle;\n"), std::string::npos) << none;
+}
@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+extern "C" {
+#include "optimize.h"
+#include "parse.h"
+#include "parser_context.h"
+#include "codegen_vhdl.h"
+#include "output_buffer.h"
+#include "arena.h"
+}
+#include <cstring>
+#include <string>
+
+// Parse src, run the enabled passes and return the generated VHDL
+static std::string optimize_and_generate(const char* src, const OptimizeOptions& options,
+                                         int* rewrites = nullptr) {
+    ParserContext ctx;
+    Arena arena;
+    std::string vhdl;
+
+    parser_context_init(&ctx);
+    arena_init(&arena, 0);
+    ctx.arena = &arena;
+    ctx_lexer_begin_memory(&ctx, src, strlen(src));
+    ASTNode* program = parse_program_ctx(&ctx);
+    if (program) {
+        int count = optimize_program(program, &options);
+        if (rewrites) {
+            *rewrites = count;
+        }
+        OutputBuffer out;
+        output_buffer_init(&out, NULL);
+        generate_vhdl_buffer(&ctx, program, &out);
+        vhdl.assign(output_buffer_data(&out), out.length);
+        output_buffer_free(&out);
+    }
+    parser_context_destroy(&ctx);
+    arena_release(&arena);
+    return vhdl;
+}
+
+static std::string fold(const char* src, int* rewrites = nullptr) {
+    OptimizeOptions options;
+    optimize_options_none(&options);
+    options.fold_constants = 1;
+    return optimize_and_generate(src, options, rewrites);
+}
+
+// Literal subexpressions and constant chains collapse to one literal
+TEST(FoldConstantsTests, FoldsLiteralArithmetic) {
+    std::string vhdl = fold("int f(int a) { int t = (3 + 4) * 2 - (1 << 3); int r = 23 % 5; return a + 2 + 5 - 10; }");
+
+    EXPECT_NE(vhdl.find("t <= 6;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("r <= 3;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= a - 3;"), std::string::npos) << vhdl;
+}
+
+// x*1, x+0, x^0, x<<0 reduce to x; x*0 only when no call would be lost
+TEST(FoldConstantsTests, SimplifiesIdentities) {
+    std::string vhdl = fold(
+        "int g(int a) { return a; }\n"
+        "int f(int a, int b) { int z = 0; z = a * 1 + 0; z = (b ^ 0) << 0; z = b * 0; z = g(a) * 0; return z; }");
+
+    EXPECT_NE(vhdl.find("z <= a;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("z <= b;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("z <= 0;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("z <= g_0_result * 0;"), std::string::npos) << vhdl;
+}
+
+// Variables initialised with a literal and never written are substituted
+TEST(FoldConstantsTests, PropagatesUnassignedConstants) {
+    std::string vhdl = fold("int add(int a) { int sum = 6; int w = 1; w = a; return sum + 6 + 7 == 6; }\n"
+                            "int k(int a) { int n = 3; for (int i = 0; i < n; i++) { a = a + w; } return a + n; }");
+
+    EXPECT_NE(vhdl.find("result <= 0;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= a + 3;"), std::string::npos) << vhdl;
+    // The propagated bound gives the loop a constant trip count
+    EXPECT_NE(vhdl.find("-- Unrolled i: 3 iterations"), std::string::npos) << vhdl;
+    // w is reassigned, so it stays a signal; the copies chain through a
+    EXPECT_NE(vhdl.find("a <= a + w + w + w;"), std::string::npos) << vhdl;
+}
+
+// Undefined or hardware-ambiguous operations are left for the design to show
+TEST(FoldConstantsTests, LeavesUnsafeExpressions) {
+    std::string vhdl = fold("int f(int a) { return (5 / 0) + (-8 >> 1) + (1 << 40) + 0.5 + 010; }");
+
+    EXPECT_NE(vhdl.find("5 / 0"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("shift_right"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("to_integer(unsigned(40))"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("0.5"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("010"), std::string::npos) << vhdl;
+}
+
+// Literals next to a double operand are not combined with C int
+// arithmetic, which would wrap them or drop the operand's type
+TEST(FoldConstantsTests, KeepsLiteralsOfWideOperands) {
+    std::string vhdl = fold("double f(double d) { return d * 65536 * 65536 + 0; }\n"
+                            "int64_t g(int64_t x) { return x + 2147483647 + 1; }\n"
+                            "int8_t k(int8_t b) { return b + 1 + 2; }\n"
+                            "int h(int a) { return a + 2147483647 + 1; }");
+
+    EXPECT_NE(vhdl.find("result <= d * 65536 * 65536 + 0;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("signed(x + 2147483647 + 1)"), std::string::npos) << vhdl;
+    // Narrow explicit-width types promote to int like char does
+    EXPECT_NE(vhdl.find("signed(std_logic_vector(resize(signed(b), 32)) + 3)"), std::string::npos) << vhdl;
+    // An int still wraps at 32 bits
+    EXPECT_NE(vhdl.find("result <= a + to_signed(-2147483648, 32);"), std::string::npos) << vhdl;
+}
+
+// With every pass disabled the tree is untouched
+TEST(FoldConstantsTests, DisabledPassChangesNothing) {
+    OptimizeOptions options;
+    int rewrites = -1;
+    optimize_options_none(&options);
+
+    std::string vhdl = optimize_and_generate("int f(int a) { return a + 1 * 2; }", options, &rewrites);
+    EXPECT_EQ(rewrites, 0);
+    EXPECT_NE(vhdl.find("a + 1 * 2"), std::string::npos) << vhdl;
+}
+
+static std::string eliminate(const char* src) {
+    OptimizeOptions options;
+    optimize_options_none(&options);
+    options.eliminate_dead_code = 1;
+    return optimize_and_generate(src, options);
+}
+
+// Nothing after return/break in the same block is emitted
+TEST(DeadCodeTests, DropsUnreachableStatements) {
+    std::string vhdl = eliminate(
+        "int f(int a) { int s = 0; for (int i = 0; i < 4; i++) { s = s + i; break; s = 100; }\n"
+        "  if (a) { return s; } else { return a; } s = 7; return 0; }");
+
+    EXPECT_NE(vhdl.find("exit;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("s <= 100;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("s <= 7;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("result <= 0;"), std::string::npos) << vhdl;
+    // The increment is part of the loop, not code after the break
+    EXPECT_NE(vhdl.find("i <= i + 1;"), std::string::npos) << vhdl;
+}
+
+// Literal conditions select their branch at compile time
+TEST(DeadCodeTests, ResolvesConstantBranches) {
+    std::string vhdl = eliminate(
+        "int f(int a) { int k = 0;\n"
+        "  if (0) { k = 5; } else if (a > 2) { k = 1; } else if (1) { k = 2; } else { k = 3; }\n"
+        "  if (1) { k = k + 1; } while (0) { k = 9; } return k; }");
+
+    EXPECT_EQ(vhdl.find("k <= 5;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("k <= 3;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("k <= 9;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("while"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("if unsigned(a) > to_unsigned(2, 32) then"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("else\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("k <= 2;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("k <= k + 1;"), std::string::npos) << vhdl;
+}
+
+// Locals that are never read lose their signal and every write
+TEST(DeadCodeTests, RemovesUnusedLocals) {
+    std::string vhdl = eliminate(
+        "int g(int a) { return a; }\n"
+        "int f(int a, int b) { int unused = a + 1; int chain = b; int chained = chain * 2;\n"
+        "  int lut[4]; lut[1] = a; int call = g(a); return b; }");
+
+    EXPECT_EQ(vhdl.find("signal unused"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("signal chain"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("lut"), std::string::npos) << vhdl;
+    // A call is kept even when its result is unused
+    EXPECT_NE(vhdl.find("call <= g_0_result;"), std::string::npos) << vhdl;
+}
+
+// A write that calls a function is kept, so its local keeps its signal
+TEST(DeadCodeTests, KeepsDeclarationOfKeptWrite) {
+    std::string vhdl = eliminate(
+        "int sq(int a) { return a * a; }\n"
+        "int f(int a) { int w; w = sq(a); return a; }");
+
+    EXPECT_NE(vhdl.find("w <= sq_0_result;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("signal w"), std::string::npos) << vhdl;
+}
+
+// Folding and elimination together: a propagated constant leaves no signal
+TEST(DeadCodeTests, CombinesWithFolding) {
+    OptimizeOptions options;
+    optimize_options_default(&options);
+
+    std::string vhdl = optimize_and_generate(
+        "int f(int a) { int limit = 3; if (limit > 5) { a = 0; } return a + limit; }", options);
+    EXPECT_EQ(vhdl.find("limit"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("a <= 0;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= a + 3;"), std::string::npos) << vhdl;
+}
+
+static std::string inline_and_fold(const char* src, int limit) {
+    OptimizeOptions options;
+    optimize_options_none(&options);
+    options.inline_calls = 1;
+    options.inline_limit = limit;
+    options.fold_constants = 1;
+    return optimize_and_generate(src, options);
+}
+
+// Small straight-line callees are substituted and folded into the caller
+TEST(InlineTests, InlinesSmallCallees) {
+    std::string vhdl = inline_and_fold(
+        "int scale(int v, int k) { int t = v * k; return t + 1; }\n"
+        "int f(int a) { return scale(a, 1) + 2; }\n"
+        "int g(int a, int b) { return scale(scale(a, b), 2); }", DEFAULT_INLINE_LIMIT);
+
+    EXPECT_NE(vhdl.find("result <= a + 3;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= (a * b + 1) * 2 + 1;"), std::string::npos) << vhdl;
+    EXPECT_EQ(vhdl.find("scale_0_inst"), std::string::npos) << vhdl;
+}
+
+// The pragma and the size limit keep calls, which become entity instances
+TEST(InlineTests, KeepsLargeAndPragmaCallees) {
+    const char* src =
+        "int mul(int a, int b) {\n#pragma compi inline off\nreturn a * b; }\n"
+        "int inc(int a) { return a + 1; }\n"
+        "int f(int x) { return mul(x, 3) + inc(x); }";
+    std::string vhdl = inline_and_fold(src, DEFAULT_INLINE_LIMIT);
+    std::string limited = inline_and_fold(src, 0);
+
+    EXPECT_NE(vhdl.find("  signal mul_0_b : std_logic_vector(31 downto 0);"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  mul_0_b <= 3;"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("  mul_0_inst : entity work.mul\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("      result => mul_0_result\n"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("result <= mul_0_result + (x + 1);"), std::string::npos) << vhdl;
+    EXPECT_NE(limited.find("result <= mul_0_result + inc_0_result;"), std::string::npos) << limited;
+}
+
+static std::string balance(const char* src, int* rewrites = nullptr) {
+    OptimizeOptions options;
+    optimize_options_none(&options);
+    options.balance_expressions = 1;
+    return optimize_and_generate(src, options, rewrites);
+}
+
+// Left-deep chains become log2(n) deep, operands keep their order
+TEST(BalanceTests, BalancesAssociativeChains) {
+    int rewrites = 0;
+    std::string vhdl = balance(
+        "int f(int a, int b, int c, int d, int e) { return a + b + c + d + (a * b * c * d * e); }\n"
+        "int g(int a, int b, int c, int d) { return a < b && b < c && c < d && a != d; }", &rewrites);
+
+    EXPECT_EQ(rewrites, 3);
+    EXPECT_NE(vhdl.find("result <= a + b + c + (d + a * b * c * (d * e));"), std::string::npos) << vhdl;
+    EXPECT_NE(vhdl.find("(unsigned(a) < unsigned(b)) and (unsigned(b) < unsigned(c))"), std::string::npos) << vhdl;
+}
+
+// Floating and 64-bit operands do not wrap at 32 bits, so their + and *
+// chains keep the source grouping
+TEST(BalanceTests, KeepsChainsThatDoNotWrapAt32Bits) {
+    int rewrites = 0;
+    std::string vhdl = balance(
+        "float f(float x, float y, float z, float w) { return x + y + z + w; }\n"
+        "int g(int a, int64_t b, int c, int d) { return a + b + c + d; }\n"
+        "int h(uint8_t a, int16_t b, char c, int d) { return a + b + c + d; }", &rewrites);
+
+    EXPECT_EQ(rewrites, 1);
+    EXPECT_NE(vhdl.find("result <= x + y + z + w;"), std::string::npos) << vhdl;
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+extern "C" {
+#include "synthetic.h"
+#include "parse.h"
+#include "parser_context.h"
+#include "arena.h"
+}
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Every benchmark workload must stay inside the C subset compi accepts
+TEST(SyntheticInputTests, WorkloadsParseCleanly) {
+    for (int workload = 0; workload < SYNTH_WORKLOAD_COUNT; workload++) {
+        size_t length = 0;
+        char* source = synth_generate((SynthWorkload)workload, 1, 1u, &length);
+        ParserContext ctx;
+        Arena arena;
+
+        parser_context_init(&ctx);
+        arena_init(&arena, 0);
+        ctx.arena = &arena;
+        ctx_lexer_begin_memory(&ctx, source, length);
+        ASTNode* program = parse_program_ctx(&ctx);
+
+        EXPECT_NE(program, nullptr) << synth_workload_name((SynthWorkload)workload);
+        EXPECT_EQ(ctx.error_count, 0) << synth_workload_name((SynthWorkload)workload);
+        EXPECT_GT(length, 10000u);
+
+        parser_context_destroy(&ctx);
+        arena_release(&arena);
+        free(source);
+    }
+}
+
+// Same parameters give the same text, so runs compare across commits
+TEST(SyntheticInputTests, GenerationIsDeterministic) {
+    size_t first_length = 0;
+    size_t second_length = 0;
+    char* first = synth_generate(SYNTH_MIXED, 2, 7u, &first_length);
+    char* second = synth_generate(SYNTH_MIXED, 2, 7u, &second_length);
+    char* reseeded = synth_generate(SYNTH_MIXED, 2, 8u, NULL);
+
+    ASSERT_EQ(first_length, second_length);
+    EXPECT_EQ(std::memcmp(first, second, first_length), 0);
+    EXPECT_NE(std::string(first), std::string(reseeded));
+    EXPECT_EQ(synth_workload_from_name("arrays"), SYNTH_ARRAYS);
+    EXPECT_EQ(synth_workload_from_name("nope"), -1);
+
+    free(first);
+    free(second);
+    free(reseeded);
+}
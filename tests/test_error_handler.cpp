@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 extern "C" {
     #include "error_handler.h"
+    #include "parser_context.h"
 }
 #include <sstream>
 #include <string>
@@ -435,3 +436,51 @@ TEST_F(ErrorHandlerTest, CompleteErrorReport) {
     EXPECT_EQ(get_error_count(), 1);
 }
 
+
+// ===== Buffered Diagnostics Tests =====
+
+// A buffered list writes nothing until flushed, then everything in order
+TEST_F(ErrorHandlerTest, BufferedDiagnosticsFlushInOrder) {
+    StderrCapture capture;
+    DiagnosticList *list = &parser_context_current()->diagnostics;
+    ErrorLocation loc = { "unit.c", 3, 7, "int x = ;" };
+
+    list->buffered = 1;
+    report_message_ex(SEVERITY_ERROR, ERROR_CATEGORY_PARSER, &loc, NULL, "First %d", 1);
+    add_error_hint("Write an expression");
+    log_warning(ERROR_CATEGORY_SEMANTIC, 9, "Second");
+    EXPECT_EQ(capture.get_output(), "");
+    EXPECT_EQ(get_error_count(), 1);
+    EXPECT_EQ(get_warning_count(), 1);
+
+    diagnostics_flush(list, stderr, DIAGNOSTIC_FORMAT_TEXT);
+    list->buffered = 0;
+    std::string output = capture.get_output();
+    size_t first = output.find("unit.c:3:7: error[Parser] First 1");
+    size_t hint = output.find("hint: Write an expression");
+    size_t second = output.find("warning[Semantic] line 9: Second");
+    ASSERT_NE(first, std::string::npos);
+    ASSERT_NE(hint, std::string::npos);
+    ASSERT_NE(second, std::string::npos);
+    EXPECT_LT(first, hint);
+    EXPECT_LT(hint, second);
+    EXPECT_EQ(list->count, 0);
+}
+
+TEST_F(ErrorHandlerTest, BufferedDiagnosticsAsJson) {
+    StderrCapture capture;
+    DiagnosticList *list = &parser_context_current()->diagnostics;
+    ErrorLocation loc = { "unit.c", 3, 7, "char c = \"\\\";" };
+
+    set_colored_output(1);
+    list->buffered = 1;
+    report_message_ex(SEVERITY_ERROR, ERROR_CATEGORY_LEXER, &loc, "E0001", "Bad \"quote\"");
+    add_suggestion("'\\\\'");
+    diagnostics_flush(list, stderr, DIAGNOSTIC_FORMAT_JSON);
+    list->buffered = 0;
+
+    EXPECT_EQ(capture.get_output(),
+              "{\"severity\": \"error\", \"category\": \"Lexer\", \"file\": \"unit.c\", "
+              "\"line\": 3, \"column\": 7, \"code\": \"E0001\", \"message\": \"Bad \\\"quote\\\"\", "
+              "\"source\": \"char c = \\\"\\\\\\\";\", \"hints\": [], \"suggestions\": [\"'\\\\\\\\'\"]}\n");
+}